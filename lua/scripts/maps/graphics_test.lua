@@ -2,6 +2,10 @@
 -- graphics_test.lua
 --
 -- A simple map with one player sprite on a distinct visual layer of tiles. Used for debugging purposes.
+--
+-- The map also serves as a lighting benchmark. A dark light overlay covers the map and a flickering light is
+-- placed at every point of a grid across the entire map, along with a light that follows the player. Enable
+-- the advanced video statistics to see how many lights were drawn in each frame.
 --------------------------------------------------------------------------------
 local ns = {}
 setmetatable(ns, {__index = _G})
@@ -30,6 +34,16 @@ TileManager = {};
 TreasureManager = {};
 TransitionManager= {};
 
+-- Set to false to draw the map without the lighting benchmark
+LIGHT_BENCHMARK = true;
+
+-- The number of map grid units between two lights of the benchmark, and the radius of every light
+LIGHT_SPACING = 4;
+LIGHT_RADIUS = 3.0;
+
+-- The number of milliseconds that have passed since the map was loaded, which animates the flickering of the lights
+light_time = 0;
+
 -- All custom map functions are contained within the following table.
 -- String keys in this table serves as the names of these functions.
 functions = {};
@@ -65,19 +79,44 @@ function Load(m)
 
 
 	Map:SetCamera(sprites["claudius"]);
+
+	if (LIGHT_BENCHMARK == true) then
+		VideoManager:EnableLightOverlay(hoa_video.Color(0.0, 0.0, 0.1, 0.85));
+	end
 	IfPrintDebug(DEBUG, "Map loading complete");
 end -- Load(m)
 
 
 
 function Update()
-	-- Nothing required
+	light_time = light_time + SystemManager:GetUpdateTime();
 end
 
 
 
 function Draw()
 	Map:DrawMapLayers();
+
+	if (LIGHT_BENCHMARK == true) then
+		DrawBenchmarkLights();
+	end
+end
+
+
+
+-- Adds a light at every point of a grid across the map. Lights outside of the screen are discarded by the map.
+function DrawBenchmarkLights()
+	local seconds = light_time / 1000;
+	for x = LIGHT_SPACING, 128, LIGHT_SPACING do
+		for y = LIGHT_SPACING, 96, LIGHT_SPACING do
+			-- Give every light its own phase so that neighboring lights do not flicker together
+			local flicker = 0.85 + 0.15 * math.sin(seconds * 7 + x * 1.3 + y * 0.7);
+			Map:DrawLight(x, y, LIGHT_RADIUS * flicker, hoa_video.Color(1.0, 0.8, 0.5, flicker));
+		end
+	end
+
+	local player = sprites["claudius"];
+	Map:DrawLight(player.x_position, player.y_position - 1, 6.0, hoa_video.Color(1.0, 1.0, 1.0, 1.0));
 end
 
 
@@ -64,6 +64,7 @@ void TextBox::ClearText() {
 	_finished = true;
 	_num_chars = 0;
 	_text.clear();
+	_text_layouts.clear();
 	_text_save.clear();
 }
 
@@ -300,6 +301,7 @@ void TextBox::_ReformatText() {
 	ustring temp_str = _text_save;
 	const size_t temp_length = temp_str.length();
 	_text.clear();
+	_text_layouts.clear();
 	_num_chars = 0;
 
 	// If font not set, return (leave _text vector empty)
@@ -372,27 +374,29 @@ void TextBox::_AddLine(const ustring& line) {
 	ustring temp_line = line;
 
 	while (temp_line.empty() == false) {
-		int32 text_width = TextManager->CalculateTextWidth(_text_style.font, line);
+		// The layout holds the width of every prefix of the line, so no substring needs to be measured on its own
+		const TextLayout* layout = TextManager->GetTextLayout(_text_style.font, temp_line);
+		if (layout == nullptr)
+			return;
 
 		// If the text can fit in the text box, add the whole line and return
-		if (text_width < _width) {
+		if (layout->GetWidth() < _width) {
 			_text.push_back(temp_line);
+			_text_layouts.push_back(*layout);
 			_num_chars += static_cast<int32>(temp_line.size());
 			return;
 		}
 
 		// Otherwise, find the maximum number of words which can fit and make that substring a line
 		// Word boundaries are found by calling the _IsCharacterBreakable() method
-		ustring wrapped_line;
 		int32 num_wrapped_chars = 0;
 		int32 last_breakable_index = -1;
 		int32 line_length = static_cast<int32>(temp_line.length());
 
 		while (num_wrapped_chars < line_length) {
-			wrapped_line += temp_line[num_wrapped_chars];
-
 			if (_IsBreakableChar(temp_line[num_wrapped_chars])) {
-				int32 text_width = TextManager->CalculateTextWidth(_text_style.font, wrapped_line);
+				// The width of the line up to and including the breakable character
+				int32 text_width = layout->widths[num_wrapped_chars + 1];
 
 				if (text_width < _width) {
 					// We haven't gone past the breaking point: mark this as a possible breaking point
@@ -411,14 +415,16 @@ void TextBox::_AddLine(const ustring& line) {
 		} // while (num_wrapped_chars < line_length)
 
 		// Figure out the number of characters in the wrapped line and construct the wrapped line
-		text_width = TextManager->CalculateTextWidth(_text_style.font, wrapped_line);
+		int32 text_width = layout->widths[min(num_wrapped_chars + 1, line_length)];
 		if (text_width >= _width && last_breakable_index != -1) {
 			num_wrapped_chars = last_breakable_index;
 		}
-		wrapped_line = temp_line.substr(0, num_wrapped_chars);
+		ustring wrapped_line = temp_line.substr(0, num_wrapped_chars);
 
 		// Add the new wrapped line to the text.
+		layout = TextManager->GetTextLayout(_text_style.font, wrapped_line);
 		_text.push_back(wrapped_line);
+		_text_layouts.push_back(*layout);
 		_num_chars += static_cast<int32>(wrapped_line.size());
 
 		// If there is no more text remaining, we are finished.
@@ -458,8 +464,11 @@ void TextBox::_DrawTextLines(float text_x, float text_y, ScreenRect scissor_rect
 
 	// Iterate through the loop for every line of text and draw it
 	for (int32 line = 0; line < static_cast<int32>(_text.size()); ++line) {
+		// The layout of each line was measured when the text was formatted, so characters are drawn from it without measuring them again
+		const TextLayout& layout = _text_layouts[line];
+
 		// (1): Calculate the x draw offset for this line and move to that position
-		float line_width = static_cast<float>(TextManager->CalculateTextWidth(_text_style.font, _text[line]));
+		float line_width = static_cast<float>(layout.GetWidth());
 		int32 x_align = VideoManager->_ConvertXAlign(_text_xalign);
 		float x_offset = text_x + ((x_align + 1) * line_width) * 0.5f * VideoManager->_current_context.coordinate_system.GetHorizontalDirection();
 
@@ -469,7 +478,7 @@ void TextBox::_DrawTextLines(float text_x, float text_y, ScreenRect scissor_rect
 
 		// (2): Draw the text depending on the display mode and whether or not the gradual display is finished
 		if (_finished || _mode == VIDEO_TEXT_INSTANT) {
-			TextManager->Draw(_text[line], _text_style);
+			TextManager->DrawLayout(layout, 0, line_size, _text_style);
 		}
 
 		else if (_mode == VIDEO_TEXT_CHAR) {
@@ -478,14 +487,13 @@ void TextBox::_DrawTextLines(float text_x, float text_y, ScreenRect scissor_rect
 
 			// If the current character to draw is after this line, render the entire line
 			if (num_chars_drawn + line_size < cur_char) {
-				TextManager->Draw(_text[line], _text_style);
+				TextManager->DrawLayout(layout, 0, line_size, _text_style);
 			}
 			// The current character to draw is on this line: figure out which characters on this line should be drawn
 			else {
 				int32 num_completed_chars = cur_char - num_chars_drawn;
 				if (num_completed_chars > 0) {
-					ustring substring = _text[line].substr(0, num_completed_chars);
-					TextManager->Draw(substring);
+					TextManager->DrawLayout(layout, 0, num_completed_chars, _text_style);
 				}
 			}
 		} // else if (_mode == VIDEO_TEXT_CHAR)
@@ -498,7 +506,7 @@ void TextBox::_DrawTextLines(float text_x, float text_y, ScreenRect scissor_rect
 
 			// If the current character to draw is after this line, draw the whole line
 			if (num_chars_drawn + line_size <= cur_char) {
-				TextManager->Draw(_text[line], _text_style);
+				TextManager->DrawLayout(layout, 0, line_size, _text_style);
 			}
 			// The current character is on this line: draw any previous characters on this line as well as the current character
 			else {
@@ -506,20 +514,16 @@ void TextBox::_DrawTextLines(float text_x, float text_y, ScreenRect scissor_rect
 
 				// Continue only if this line has at least one character that should be drawn
 				if (num_completed_chars >= 0) {
-					ustring substring;
-
 					// Draw any fully completed characters at full opacity
 					if (num_completed_chars > 0) {
-						substring = _text[line].substr(0, num_completed_chars);
-						TextManager->Draw(substring, _text_style);
+						TextManager->DrawLayout(layout, 0, num_completed_chars, _text_style);
 					}
 
 					// Draw the current character that is being faded in at the appropriate alpha level
 					Color old_color = _text_style.color;
 					_text_style.color[3] *= cur_percent;
 
-					VideoManager->MoveRelative(static_cast<float>(TextManager->CalculateTextWidth(_text_style.font, substring)), 0.0f);
-					TextManager->Draw(_text[line].substr(num_completed_chars, 1), _text_style);
+					TextManager->DrawLayout(layout, num_completed_chars, 1, _text_style);
 					_text_style.color = old_color;
 				}
 			}
@@ -533,14 +537,14 @@ void TextBox::_DrawTextLines(float text_x, float text_y, ScreenRect scissor_rect
 
 			// If this line comes before the line being rendered, simply draw the line and be done with it
 			if (line < lines) {
-				TextManager->Draw(_text[line], _text_style);
+				TextManager->DrawLayout(layout, 0, line_size, _text_style);
 			}
 			// Otherwise if this is the line being rendered, determine the amount of alpha for the line being faded in and draw it
 			else if (line == lines) {
 				Color old_color = _text_style.color;
 				_text_style.color[3] *= cur_percent;
 
-				TextManager->Draw(_text[line], _text_style);
+				TextManager->DrawLayout(layout, 0, line_size, _text_style);
 				_text_style.color = old_color;
 			}
 		} // else if (_mode == VIDEO_TEXT_FADELINE)
@@ -554,25 +558,19 @@ void TextBox::_DrawTextLines(float text_x, float text_y, ScreenRect scissor_rect
 
 			// If the current character comes after this line, simply render the entire line
 			if (num_chars_drawn + line_size <= cur_char) {
-				TextManager->Draw(_text[line], _text_style);
+				TextManager->DrawLayout(layout, 0, line_size, _text_style);
 			}
 			// If the line contains the current character, draw all previous characters as well as the current one
 			else if (num_completed_chars >= 0) {
-				ustring substring;
-
 				// If there are already completed characters on this line, draw them in full
 				if (num_completed_chars > 0) {
-					substring = _text[line].substr(0, num_completed_chars);
-					TextManager->Draw(substring, _text_style);
+					TextManager->DrawLayout(layout, 0, num_completed_chars, _text_style);
 				}
 
-				// Now draw the current character from the line, partially scissored according to the amount that is complete
-				ustring cur_char_string = _text[line].substr(num_completed_chars, 1);
-
 				// Create a rectangle for the current character, in window coordinates
 				int32 char_x, char_y, char_w, char_h;
 				char_x = static_cast<int32>(x_offset + VideoManager->_current_context.coordinate_system.GetHorizontalDirection()
-					* TextManager->CalculateTextWidth(_text_style.font, substring));
+					* layout.positions[num_completed_chars]);
 				char_y = static_cast<int32>(text_y - VideoManager->_current_context.coordinate_system.GetVerticalDirection()
 					* (_font_properties->height + _font_properties->descent));
 
@@ -582,13 +580,11 @@ void TextBox::_DrawTextLines(float text_x, float text_y, ScreenRect scissor_rect
 				if (VideoManager->_current_context.coordinate_system.GetVerticalDirection() < 0.0f)
 					char_x = static_cast<int32>(VideoManager->_current_context.coordinate_system.GetLeft()) - char_x;
 
-				char_w = TextManager->CalculateTextWidth(_text_style.font, cur_char_string);
+				char_w = layout.positions[num_completed_chars + 1] - layout.positions[num_completed_chars];
 				char_h = _font_properties->height;
 
 				// Multiply the width by percentage done to determine the scissoring dimensions
 				char_w = static_cast<int32>(cur_percent * char_w);
-				VideoManager->MoveRelative(VideoManager->_current_context.coordinate_system.GetHorizontalDirection()
-					* TextManager->CalculateTextWidth(_text_style.font, substring), 0.0f);
 
 				// Construct the scissor rectangle using the character dimensions and draw the revealing character
 				VideoManager->PushState();
@@ -596,7 +592,7 @@ void TextBox::_DrawTextLines(float text_x, float text_y, ScreenRect scissor_rect
 				scissor_rect.Intersect(char_scissor_rect);
 				VideoManager->EnableScissoring();
 				VideoManager->SetScissorRect(scissor_rect);
-				TextManager->Draw(cur_char_string, _text_style);
+				TextManager->DrawLayout(layout, num_completed_chars, 1, _text_style);
 				VideoManager->PopState();
 			}
 			// In the else case, the current character is before the line, so we don't draw anything for this line at all
@@ -604,7 +600,7 @@ void TextBox::_DrawTextLines(float text_x, float text_y, ScreenRect scissor_rect
 
 		else {
 			// Invalid display mode: just render the text instantly
-			TextManager->Draw(_text[line]);
+			TextManager->DrawLayout(layout, 0, line_size, TextManager->GetDefaultStyle());
 			IF_PRINT_WARNING(VIDEO_DEBUG) << "an unknown/unsupported text display mode was active: " << _mode << endl;
 		}
 
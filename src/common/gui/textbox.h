@@ -231,6 +231,9 @@ private:
 	//! \brief An array of wide strings, one for each line of text.
 	std::vector<hoa_utils::ustring> _text;
 
+	//! \brief The measured layout of each line of text in the _text vector, so that no line is measured again when it is drawn
+	std::vector<hoa_video::TextLayout> _text_layouts;
+
 	//! \brief The unedited text for reformatting
 	hoa_utils::ustring _text_save;
 
@@ -242,7 +245,7 @@ private:
 	**/
 	bool _IsBreakableChar(uint16 character);
 
-	/** \brief Adds a new line of text to the _text vector.
+	/** \brief Adds a new line of text to the _text vector and its layout to the _text_layouts vector.
 	*** \param line The unicode text string to add as a new line
 	*** If the line is too long to fit in the width of the textbox, it will automatically
 	*** be split into multiple lines through word wrapping.
@@ -80,13 +80,18 @@ namespace hoa_video {
 	class StillImage;
 	class AnimatedImage;
 	class CompositeImage;
+	class QuadBuffer;
 
 	class TextureController;
 
 	class TextSupervisor;
 	class FontGlyph;
+	class GlyphPage;
 	class FontProperties;
+	class TextLayout;
+	class TextStyle;
 	class TextImage;
+	class NumberImage;
 
 	class Interpolator;
 
@@ -102,7 +107,17 @@ namespace hoa_video {
 		class FixedTexSheet;
 		class VariableTexSheet;
 		class FixedTexNode;
-		class VariableTexNode;
+		class VariableTexRect;
+		class TexSheetStatistics;
+
+		class TextureAtlasPage;
+		class TextureAtlasSource;
+		class TextureAtlasEntry;
+		class TextureAtlasIndex;
+
+		class ImageCache;
+
+		class PixelKernels;
 
 		class ImageMemory;
 
@@ -110,19 +125,29 @@ namespace hoa_video {
 		class ImageTexture;
 		class TextTexture;
 		class TextElement;
+		class NumberStrip;
 		class AnimationFrame;
 		class ImageElement;
 
 		class ParticleManager;
+		class ParticleUpdateJob;
+		class ParticlePool;
+		class ParticlePoolStatistics;
 		class ParticleSystem;
 		class ParticleSystemDef;
-		class Particle;
+		class ParticleArrays;
+		class ParticleStep;
 		class ParticleVertex;
+		class ParticleInstance;
 		class ParticleTexCoord;
+		class ParticleShader;
 		class ParticleKeyframe;
 
+		class LightCompositor;
+		class RenderState;
 		class ScreenFader;
 		class ShakeForce;
+		class SpriteBatch;
 	}
 }
 
@@ -162,6 +187,7 @@ namespace hoa_input {
 // Settings declarations, see src/engine/
 namespace hoa_system {
 	extern bool SYSTEM_DEBUG;
+	class ProfileEngine;
 	class SystemEngine;
 	class Timer;
 }
@@ -255,6 +281,7 @@ namespace hoa_battle {
 
 		class IndicatorElement;
 		class IndicatorText;
+		class IndicatorNumber;
 		class IndicatorImage;
 		class IndicatorSupervisor;
 
@@ -289,7 +316,11 @@ namespace hoa_map {
 
 	namespace private_map {
 		class TileSupervisor;
-		class MapTile;
+
+		class MapBinaryHeader;
+		class MapBinaryFile;
+		class MapLoader;
+		class MapLoaderCache;
 
 		class MapRectangle;
 		class MapFrame;
@@ -161,49 +161,11 @@ bool AudioDescriptor::LoadAudio(const string& filename, AUDIO_LOAD load_type, ui
 	FreeAudio();
 
 	// Load the input file for the audio
-	if (filename.size() <= 3) { // Name of file is at least 3 letters (so the extension is in there)
-		IF_PRINT_WARNING(AUDIO_DEBUG) << "file name argument is too short: " << filename << endl;
+	_input = CreateAudioInput(filename);
+	if (_input == nullptr)
 		return false;
-	}
-	// Convert the file extension to uppercase and use it to create the proper input type
-	string file_extension = filename.substr(filename.size() - 3, 3);
-	for (string::iterator i = file_extension.begin(); i != file_extension.end(); i++)
-		*i = toupper(*i);
 
-	// Based on the extension of the file, load properly one
-	if (file_extension.compare("WAV") == 0) {
-		_input = new WavFile(filename);
-	}
-	else if (file_extension.compare("OGG") == 0) {
-		_input = new OggFile(filename);
-	}
-	else {
-		IF_PRINT_WARNING(AUDIO_DEBUG) << "failed due to unsupported input file extension: " << file_extension << endl;
-		return false;
-	}
-
-	if (_input->Initialize() == false) {
-		IF_PRINT_WARNING(AUDIO_DEBUG) << "failed to load and initialize audio file: " << filename << endl;
-		return false;
-	}
-
-	// Retreive audio data properties from the newly initialized input
-	if (_input->GetBitsPerSample() == 8) {
-		if (_input->GetNumberChannels() == 1) {
-			_format = AL_FORMAT_MONO8;
-		}
-		else {
-			_format = AL_FORMAT_STEREO8;
-		}
-	}
-	else { // 16 bits per sample
-		if (_input->GetNumberChannels() == 1) {
-			_format = AL_FORMAT_MONO16;
-		}
-		else {
-			_format = AL_FORMAT_STEREO16;
-		}
-	}
+	_DetermineFormat();
 
 	// Load the audio data depending upon the load type requested
 	if (load_type == AUDIO_LOAD_STATIC) {
@@ -277,6 +239,40 @@ bool AudioDescriptor::LoadAudio(const string& filename, AUDIO_LOAD load_type, ui
 
 
 
+bool AudioDescriptor::LoadDecodedAudio(const AudioMemory& decoded_audio) {
+	if (!AUDIO_ENABLE)
+		return true;
+
+	FreeAudio();
+
+	if (decoded_audio.GetData() == nullptr || decoded_audio.GetDataSize() == 0) {
+		IF_PRINT_WARNING(AUDIO_DEBUG) << "decoded audio contained no data: " << decoded_audio.GetFilename() << endl;
+		return false;
+	}
+
+	// The copy retains the properties of the audio for seeking and for GetFilename(), just as the file input does for audio
+	// that is loaded from a file
+	_input = new AudioMemory(decoded_audio);
+	_DetermineFormat();
+
+	// Only the OpenAL buffer is created here. The audio data was decoded by the caller, possibly on another thread.
+	_buffer = new AudioBuffer[1];
+	_buffer->FillBuffer(decoded_audio.GetData(), _format, decoded_audio.GetDataSize(), decoded_audio.GetSamplesPerSecond());
+
+	_AcquireSource();
+	if (_source == nullptr) {
+		IF_PRINT_WARNING(AUDIO_DEBUG) << "could not acquire audio source for new audio file: " << decoded_audio.GetFilename() << endl;
+	}
+
+	if (AudioManager->CheckALError())
+		IF_PRINT_WARNING(AUDIO_DEBUG) << "OpenAL generated the following error: " << AudioManager->CreateALErrorString() << endl;
+
+	_state = AUDIO_STATE_STOPPED;
+	return true;
+} // bool AudioDescriptor::LoadDecodedAudio(const AudioMemory& decoded_audio)
+
+
+
 void AudioDescriptor::FreeAudio() {
 	if (_source != nullptr)
 		Stop();
@@ -800,6 +796,27 @@ void AudioDescriptor::_PrepareStreamingBuffers() {
 	}
 }
 
+
+
+void AudioDescriptor::_DetermineFormat() {
+	if (_input->GetBitsPerSample() == 8) {
+		if (_input->GetNumberChannels() == 1) {
+			_format = AL_FORMAT_MONO8;
+		}
+		else {
+			_format = AL_FORMAT_STEREO8;
+		}
+	}
+	else { // 16 bits per sample
+		if (_input->GetNumberChannels() == 1) {
+			_format = AL_FORMAT_MONO16;
+		}
+		else {
+			_format = AL_FORMAT_STEREO16;
+		}
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // SoundDescriptor class methods
 ////////////////////////////////////////////////////////////////////////////////
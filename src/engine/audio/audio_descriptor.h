@@ -88,7 +88,7 @@ public:
 	*** \param size The size of the data in number of bytes
 	*** \param frequency The audio frequency of the data in samples per second
 	**/
-	void FillBuffer(uint8* data, ALenum format, uint32 size, uint32 frequency)
+	void FillBuffer(const uint8* data, ALenum format, uint32 size, uint32 frequency)
 		{ alBufferData(buffer, format, data, size, frequency); }
 
 	//! \brief Returns true if this class object holds a reference to a valid OpenAL buffer
@@ -209,6 +209,15 @@ public:
 	**/
 	virtual bool LoadAudio(const std::string& filename, AUDIO_LOAD load_type, uint32 stream_buffer_size);
 
+	/** \brief Loads audio statically from data that has already been decoded into memory
+	*** \param decoded_audio The decoded audio data, which is copied and may be destroyed after this call
+	*** \return True if the audio was succesfully loaded, false if there was an error
+	***
+	*** This is equivalent to loading the audio from its file with AUDIO_LOAD_STATIC, except that the file is not read
+	*** or decoded. Only the OpenAL buffer is created and filled, which allows the decoding to be done on another thread.
+	**/
+	bool LoadDecodedAudio(const private_audio::AudioMemory& decoded_audio);
+
 	/** \brief Frees all data resources and resets class parameters
 	***
 	*** It resets the _state and _offset class members, as well as deleting _data, _stream, _input, _buffer, and resets _source.
@@ -402,6 +411,9 @@ private:
 	*** ones must be refilled. This function should only be called for streaming audio.
 	**/
 	void _PrepareStreamingBuffers();
+
+	//! \brief Sets the _format member from the properties of the _input member
+	void _DetermineFormat();
 }; // class AudioDescriptor
 
 
@@ -458,6 +458,43 @@ uint32 AudioMemory::Read(uint8* buffer, uint32 size, bool& end) {
 	return read;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Audio input functions
+////////////////////////////////////////////////////////////////////////////////
+
+AudioInput* CreateAudioInput(const string& filename) {
+	// Name of file is at least 3 letters (so the extension is in there)
+	if (filename.size() <= 3) {
+		IF_PRINT_WARNING(AUDIO_DEBUG) << "file name argument is too short: " << filename << endl;
+		return nullptr;
+	}
+
+	// Convert the file extension to uppercase and use it to create the proper input type
+	string file_extension = filename.substr(filename.size() - 3, 3);
+	for (string::iterator i = file_extension.begin(); i != file_extension.end(); i++)
+		*i = toupper(*i);
+
+	AudioInput* input = nullptr;
+	if (file_extension.compare("WAV") == 0) {
+		input = new WavFile(filename);
+	}
+	else if (file_extension.compare("OGG") == 0) {
+		input = new OggFile(filename);
+	}
+	else {
+		IF_PRINT_WARNING(AUDIO_DEBUG) << "failed due to unsupported input file extension: " << file_extension << endl;
+		return nullptr;
+	}
+
+	if (input->Initialize() == false) {
+		IF_PRINT_WARNING(AUDIO_DEBUG) << "failed to load and initialize audio file: " << filename << endl;
+		delete input;
+		return nullptr;
+	}
+
+	return input;
+}
+
 } // namespace private_audio
 
 } // namespace hoa_audio
@@ -257,6 +257,10 @@ public:
 	uint32 Read(uint8* buffer, uint32 size, bool& end);
 	//@}
 
+	//! \brief Returns the decoded audio data, which is GetDataSize() bytes long
+	const uint8* GetData() const
+		{ return _audio_data; }
+
 private:
 	//! \brief The memory location where all the audio is stored
 	uint8* _audio_data;
@@ -265,6 +269,14 @@ private:
 	uint32 _data_position;
 }; // class AudioMemory : public AudioInput
 
+/** \brief Creates and initializes the audio input appropriate for a file
+*** \param filename The name of the audio file, which must have a .wav or .ogg file extension
+*** \return A pointer to the initialized input, or nullptr if the file is not supported or could not be initialized
+***
+*** This function does not use OpenAL, so it may be called from any thread. The caller takes ownership of the returned input.
+**/
+AudioInput* CreateAudioInput(const std::string& filename);
+
 } // namespace private_audio
 
 } // namespace hoa_audio
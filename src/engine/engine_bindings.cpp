@@ -336,6 +336,7 @@ void BindEngineCode() {
 			.def("EnableLightning", &VideoEngine::EnableLightning)
 			.def("DisableLightning", &VideoEngine::DisableLightning)
 			.def("DrawOverlays", &VideoEngine::DrawOverlays)
+			.def("DrawLight", &VideoEngine::DrawLight)
 			.def("AddParticleEffect", &VideoEngine::AddParticleEffect)
 			.def("StopAllParticleEffects", &VideoEngine::StopAllParticleEffects)
 
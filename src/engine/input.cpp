@@ -18,6 +18,7 @@
 #include "script.h"
 
 #include "mode_manager.h"
+#include "profiler.h"
 #include "system.h"
 
 using namespace std;
@@ -346,8 +347,9 @@ void InputEngine::_KeyEventHandler(SDL_KeyboardEvent& key_event) {
 			_any_key_press = false; // We don't treat Ctrl+key presses as an "any key"
 
 			if (key_event.keysym.sym == SDLK_a) {
-				// Ctrl+A: "Advanced" display of video engine information
+				// Ctrl+A: "Advanced" display of video engine information and the profiler overlay
 				VideoManager->ToggleAdvancedDisplay();
+				ProfileManager->SetOverlayEnabled(!ProfileManager->IsOverlayEnabled());
 			}
 			else if (key_event.keysym.sym == SDLK_f) {
 				// Ctrl+F: "Fullscreen" toggle
@@ -360,6 +362,24 @@ void InputEngine::_KeyEventHandler(SDL_KeyboardEvent& key_event) {
 				ModeManager->DEBUG_ToggleGraphicsEnabled();
 				return;
 			}
+			else if (key_event.keysym.sym == SDLK_p) {
+				// Ctrl+P: "Profile" capture start and stop
+				if (ProfileManager->IsCapturing() == false) {
+					ProfileManager->StartCapture();
+					return;
+				}
+
+				static uint32 i = 1;
+				string path = "";
+				while (true) {
+					path = hoa_utils::GetUserDataPath(true) + "profile_" + NumberToString<uint32>(i) + ".json";
+					if (!DoesFileExist(path))
+						break;
+					i++;
+				}
+				ProfileManager->StopCapture(path);
+				return;
+			}
 			else if (key_event.keysym.sym == SDLK_q) {
 				// Ctrl+Q: "Quit" command requested
 				_quit_press = true;
@@ -372,6 +392,8 @@ void InputEngine::_KeyEventHandler(SDL_KeyboardEvent& key_event) {
 			}
 			else if (key_event.keysym.sym == SDLK_s) {
 				// Ctrl+S: "Screenshot" generation request
+				// Files from earlier runs are skipped. Screenshots are written asynchronously, so the file of the previous
+				// request may not exist yet and the number must be advanced after every request.
 				static uint32 i = 1;
 				string path = "";
 				while (true) {
@@ -381,6 +403,7 @@ void InputEngine::_KeyEventHandler(SDL_KeyboardEvent& key_event) {
 					i++;
 				}
 				VideoManager->MakeScreenshot(path);
+				i++;
 				return;
 			}
 			else if (key_event.keysym.sym == SDLK_t) {
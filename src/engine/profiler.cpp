@@ -0,0 +1,359 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file   profiler.cpp
+*** \author agent
+*** \brief  Source file for measuring where the processor time of each frame is spent
+*** ***************************************************************************/
+
+#include <cstdio>
+#include <fstream>
+
+#include <SDL2/SDL.h>
+
+#include "profiler.h"
+#include "video.h"
+#include "text.h"
+
+using namespace std;
+using namespace hoa_utils;
+using namespace hoa_video;
+
+template<> hoa_system::ProfileEngine* Singleton<hoa_system::ProfileEngine>::_singleton_reference = nullptr;
+
+namespace hoa_system {
+
+ProfileEngine* ProfileManager = nullptr;
+
+namespace {
+
+//! \brief The buffer of the thread that this variable is read from, or nullptr if the thread has not recorded any zones yet
+thread_local ProfileThreadBuffer* thread_buffer = nullptr;
+
+//! \brief The length of the previous frame that the full width of the overlay represents, in nanoseconds (two frames at 60 frames per second)
+const uint64_t OVERLAY_WIDTH_TIME = 33333333;
+
+//! \brief The time within a frame at which the overlay draws a marker, in nanoseconds (one frame at 60 frames per second)
+const uint64_t OVERLAY_MARKER_TIME = 16666667;
+
+//! \brief The height of each row of zones in the overlay, in the standard coordinate system
+const float OVERLAY_ROW_HEIGHT = 14.0f;
+
+//! \brief Returns a color for a zone that is the same every time the zone is drawn and differs for most other zones
+Color ZoneColor(const char* name) {
+	uint32 hash = 2166136261u;
+	for (const char* c = name; *c != '\0'; c++) {
+		hash ^= static_cast<uint8>(*c);
+		hash *= 16777619u;
+	}
+
+	return Color(0.35f + 0.6f * static_cast<float>(hash & 0xFF) / 255.0f,
+		0.35f + 0.6f * static_cast<float>((hash >> 8) & 0xFF) / 255.0f,
+		0.35f + 0.6f * static_cast<float>((hash >> 16) & 0xFF) / 255.0f, 0.85f);
+}
+
+//! \brief Writes a string surrounded by quotes, escaping the characters that JSON does not permit within a string
+void WriteJSONString(ofstream& file, const char* text) {
+	file << '"';
+	for (const char* c = text; *c != '\0'; c++) {
+		if (*c == '"' || *c == '\\')
+			file << '\\' << *c;
+		else if (static_cast<uint8>(*c) < 0x20)
+			file << ' ';
+		else
+			file << *c;
+	}
+	file << '"';
+}
+
+//! \brief Writes a time in nanoseconds as a number of microseconds, which is the unit used by trace events
+void WriteMicroseconds(ofstream& file, uint64_t nanoseconds) {
+	char text[32];
+	sprintf(text, "%llu.%03u", static_cast<unsigned long long>(nanoseconds / 1000), static_cast<uint32>(nanoseconds % 1000));
+	file << text;
+}
+
+} // namespace
+
+// -----------------------------------------------------------------------------
+// ProfileThreadBuffer Class
+// -----------------------------------------------------------------------------
+
+ProfileThreadBuffer::ProfileThreadBuffer(uint32 thread_id, const string& thread_name) :
+	thread_id(thread_id),
+	thread_name(thread_name),
+	depth(0),
+	_records(PROFILE_ZONES_PER_THREAD),
+	_num_written(0)
+{}
+
+
+
+void ProfileThreadBuffer::AddRecord(const char* name, uint64_t start, uint64_t end, uint32 depth) {
+	ProfileRecord& record = _records[_num_written % PROFILE_ZONES_PER_THREAD];
+	record.name = name;
+	record.start = start;
+	record.end = end;
+	record.depth = depth;
+
+	// The zone must be visible to other threads before the count that includes it
+	SDL_MemoryBarrierRelease();
+	_num_written = _num_written + 1;
+}
+
+
+
+uint64_t ProfileThreadBuffer::GetNumWritten() const {
+	uint64_t num_written = _num_written;
+	SDL_MemoryBarrierAcquire();
+	return num_written;
+}
+
+// -----------------------------------------------------------------------------
+// ProfileZone Class
+// -----------------------------------------------------------------------------
+
+ProfileZone::ProfileZone(const char* name) :
+	_name(name),
+	_buffer(nullptr),
+	_start(0)
+{
+	if (ProfileManager == nullptr || ProfileManager->IsRecording() == false)
+		return;
+
+	_buffer = ProfileManager->GetThreadBuffer();
+	_buffer->depth++;
+	_start = ProfileManager->GetTime();
+}
+
+
+
+ProfileZone::~ProfileZone() {
+	if (_buffer == nullptr || ProfileManager == nullptr)
+		return;
+
+	_buffer->depth--;
+	_buffer->AddRecord(_name, _start, ProfileManager->GetTime(), _buffer->depth);
+}
+
+// -----------------------------------------------------------------------------
+// ProfileEngine Class
+// -----------------------------------------------------------------------------
+
+ProfileEngine::ProfileEngine() :
+	_counter_start(SDL_GetPerformanceCounter()),
+	_counter_frequency(SDL_GetPerformanceFrequency()),
+	_capturing(false),
+	_capture_start(0),
+	_overlay_enabled(false),
+	_frame_start(0),
+	_previous_frame_start(0),
+	_previous_frame_end(0),
+	_main_buffer(nullptr),
+	_buffers_mutex(SDL_CreateMutex())
+{
+	IF_PRINT_DEBUG(SYSTEM_DEBUG) << "constructor invoked" << endl;
+
+	SDL_AtomicSet(&_recording, 0);
+}
+
+
+
+ProfileEngine::~ProfileEngine() {
+	IF_PRINT_DEBUG(SYSTEM_DEBUG) << "destructor invoked" << endl;
+
+	SDL_AtomicSet(&_recording, 0);
+	ProfileManager = nullptr;
+
+	for (uint32 i = 0; i < _buffers.size(); i++)
+		delete _buffers[i];
+	_buffers.clear();
+	SDL_DestroyMutex(_buffers_mutex);
+}
+
+
+
+bool ProfileEngine::SingletonInitialize() {
+	if (_buffers_mutex == nullptr) {
+		PRINT_ERROR << "failed to create the mutex for the profiler thread buffers: " << SDL_GetError() << endl;
+		return false;
+	}
+
+	// The engine is initialized by the main thread, so the first buffer belongs to it
+	_main_buffer = GetThreadBuffer();
+	return true;
+}
+
+
+
+uint64_t ProfileEngine::GetTime() const {
+	// Splitting the counter into whole seconds and a remainder keeps the conversion from overflowing
+	uint64_t counter = SDL_GetPerformanceCounter() - _counter_start;
+	return (counter / _counter_frequency) * 1000000000ull + ((counter % _counter_frequency) * 1000000000ull) / _counter_frequency;
+}
+
+
+
+void ProfileEngine::BeginFrame() {
+	uint64_t now = GetTime();
+	_previous_frame_start = _frame_start;
+	_previous_frame_end = now;
+	_frame_start = now;
+}
+
+
+
+bool ProfileEngine::StartCapture() {
+	if (_capturing == true) {
+		IF_PRINT_WARNING(SYSTEM_DEBUG) << "a capture is already in progress" << endl;
+		return false;
+	}
+
+	_capturing = true;
+	_capture_start = GetTime();
+	_UpdateRecording();
+	return true;
+}
+
+
+
+bool ProfileEngine::StopCapture(const string& filename) {
+	if (_capturing == false) {
+		IF_PRINT_WARNING(SYSTEM_DEBUG) << "no capture was in progress" << endl;
+		return false;
+	}
+
+	_capturing = false;
+	_UpdateRecording();
+	return _WriteTrace(filename, _capture_start);
+}
+
+
+
+void ProfileEngine::DrawOverlay() {
+	if (_main_buffer == nullptr || _previous_frame_end <= _previous_frame_start)
+		return;
+
+	VideoManager->PushState();
+	VideoManager->SetStandardCoordSys();
+	VideoManager->SetDrawFlags(VIDEO_X_LEFT, VIDEO_Y_BOTTOM, VIDEO_BLEND, 0);
+
+	const float bottom = VIDEO_STANDARD_RESOLUTION_HEIGHT;
+	const float scale = VIDEO_STANDARD_RESOLUTION_WIDTH / static_cast<float>(OVERLAY_WIDTH_TIME);
+	const float overlay_height = OVERLAY_ROW_HEIGHT * PROFILE_OVERLAY_MAX_DEPTH;
+
+	VideoManager->Move(0.0f, bottom);
+	VideoManager->DrawRectangle(VIDEO_STANDARD_RESOLUTION_WIDTH, overlay_height, Color(0.0f, 0.0f, 0.0f, 0.5f));
+
+	// Zones are stored in the order that they ended, so walking backwards from the newest zone finds every zone of
+	// the previous frame. Zones that ended after the frame, such as those of the current frame, are skipped.
+	uint64_t num_written = _main_buffer->GetNumWritten();
+	for (uint64_t i = num_written; i > ProfileThreadBuffer::GetFirstHeld(num_written); i--) {
+		const ProfileRecord& record = _main_buffer->GetRecord(i - 1);
+		if (record.end < _previous_frame_start)
+			break;
+		if (record.start < _previous_frame_start || record.end > _previous_frame_end || record.depth >= PROFILE_OVERLAY_MAX_DEPTH)
+			continue;
+
+		float x = (record.start - _previous_frame_start) * scale;
+		float width = (record.end - record.start) * scale;
+		if (x >= VIDEO_STANDARD_RESOLUTION_WIDTH || width < 1.0f)
+			continue;
+
+		VideoManager->Move(x, bottom - record.depth * OVERLAY_ROW_HEIGHT);
+		VideoManager->DrawRectangle(width, OVERLAY_ROW_HEIGHT - 1.0f, ZoneColor(record.name));
+	}
+
+	// The marker shows how much of the frame fits within the time given to a frame at 60 frames per second
+	VideoManager->Move(OVERLAY_MARKER_TIME * scale, bottom);
+	VideoManager->DrawRectangle(2.0f, overlay_height, Color::white);
+
+	char text[64];
+	sprintf(text, "Frame: %.2f ms", (_previous_frame_end - _previous_frame_start) / 1000000.0f);
+	VideoManager->Move(8.0f, bottom - overlay_height - 4.0f);
+	TextManager->Draw(text);
+
+	VideoManager->PopState();
+} // void ProfileEngine::DrawOverlay()
+
+
+
+ProfileThreadBuffer* ProfileEngine::GetThreadBuffer() {
+	if (thread_buffer != nullptr)
+		return thread_buffer;
+
+	SDL_LockMutex(_buffers_mutex);
+	uint32 thread_id = _buffers.size() + 1;
+	string thread_name = (thread_id == 1) ? "Main" : ("Thread " + NumberToString(thread_id));
+	thread_buffer = new ProfileThreadBuffer(thread_id, thread_name);
+	_buffers.push_back(thread_buffer);
+	SDL_UnlockMutex(_buffers_mutex);
+
+	return thread_buffer;
+}
+
+
+
+bool ProfileEngine::_WriteTrace(const string& filename, uint64_t since) {
+	ofstream file(filename.c_str());
+	if (file.fail() == true) {
+		PRINT_ERROR << "failed to open the profiler trace file for writing: " << filename << endl;
+		return false;
+	}
+
+	uint32 num_events = 0;
+	file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+	SDL_LockMutex(_buffers_mutex);
+	for (uint32 i = 0; i < _buffers.size(); i++) {
+		const ProfileThreadBuffer* buffer = _buffers[i];
+		if (i > 0)
+			file << ",";
+		file << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->thread_id << ",\"args\":{\"name\":";
+		WriteJSONString(file, buffer->thread_name.c_str());
+		file << "}}";
+
+		uint64_t num_written = buffer->GetNumWritten();
+		uint64_t first_held = ProfileThreadBuffer::GetFirstHeld(num_written);
+		if (first_held > 0 && buffer->GetRecord(first_held).start > since) {
+			PRINT_WARNING << "only the last " << PROFILE_ZONES_PER_THREAD << " zones of each thread are kept, so the zones at "
+				<< "the start of the capture were dropped for thread: " << buffer->thread_name << endl;
+		}
+
+		for (uint64_t j = first_held; j < num_written; j++) {
+			const ProfileRecord& record = buffer->GetRecord(j);
+			if (record.start < since)
+				continue;
+
+			file << ",\n{\"name\":";
+			WriteJSONString(file, record.name);
+			file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread_id << ",\"ts\":";
+			WriteMicroseconds(file, record.start);
+			file << ",\"dur\":";
+			WriteMicroseconds(file, record.end - record.start);
+			file << "}";
+			num_events++;
+		}
+	}
+	SDL_UnlockMutex(_buffers_mutex);
+
+	file << "\n]}\n";
+	file.close();
+	if (file.fail() == true) {
+		PRINT_ERROR << "failed to write the profiler trace file: " << filename << endl;
+		return false;
+	}
+
+	if (SYSTEM_DEBUG)
+		cout << "SYSTEM: wrote " << num_events << " profiler zones to " << filename << endl;
+	return true;
+} // bool ProfileEngine::_WriteTrace(const string& filename, uint64_t since)
+
+} // namespace hoa_system
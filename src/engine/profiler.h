@@ -0,0 +1,269 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file   profiler.h
+*** \author agent
+*** \brief  Header file for measuring where the processor time of each frame is spent
+***
+*** Code is measured by placing a PROFILE_ZONE at the start of a block:
+***
+*** \code
+*** void ObjectSupervisor::Update() {
+***     PROFILE_ZONE("ObjectSupervisor::Update");
+***     ...
+*** }
+*** \endcode
+***
+*** The zone records the time at which the block was entered and left, in
+*** nanoseconds, for as long as the profiler is recording. Nothing is recorded
+*** otherwise, so an idle zone costs no more than reading a flag. Recording
+*** takes place while a capture is in progress or while the profiler overlay
+*** is shown.
+***
+*** - A capture is started and stopped with Ctrl+P, or by starting the game
+***   with the --profile option. When it stops, every zone recorded during the
+***   capture is written in the Chrome trace event format, which can be opened
+***   with chrome://tracing or https://ui.perfetto.dev. Only the last
+***   PROFILE_ZONES_PER_THREAD zones of each thread are kept, so the start of a
+***   long capture is dropped from the trace. A warning is printed when this
+***   happens.
+*** - The overlay is shown along with the advanced video information (Ctrl+A).
+***   It draws the zones of the main thread for the previous frame as a flame
+***   bar along the bottom of the screen.
+*** ***************************************************************************/
+
+#pragma once
+
+#include <SDL2/SDL_atomic.h>
+#include <SDL2/SDL_mutex.h>
+
+#include "utils.h"
+#include "defs.h"
+
+//! \brief Concatenates two tokens after expanding them, which is needed to use __LINE__ in a name
+#define PROFILE_CONCATENATE_TOKENS(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_TOKENS(a, b)
+
+/** \brief Measures the time spent from this point until the end of the enclosing block
+*** \param name A string literal naming the zone. The string must remain valid for as long as the program runs.
+**/
+#define PROFILE_ZONE(name) hoa_system::ProfileZone PROFILE_CONCATENATE(_profile_zone_, __LINE__)(name)
+
+namespace hoa_system {
+
+//! \brief The singleton pointer responsible for profiling, or nullptr if the profiler does not exist
+extern ProfileEngine* ProfileManager;
+
+//! \brief The number of zones that are kept for each thread. Once a thread has recorded this many, its oldest zones are overwritten
+const uint32 PROFILE_ZONES_PER_THREAD = 32768;
+
+//! \brief The largest depth of nested zones that the overlay draws
+const uint32 PROFILE_OVERLAY_MAX_DEPTH = 8;
+
+/** ****************************************************************************
+*** \brief A single measured zone
+*** ***************************************************************************/
+class ProfileRecord {
+public:
+	//! \brief The name that the zone was given, which is a string literal
+	const char* name;
+
+	//! \brief The times at which the zone was entered and left, in nanoseconds since the profiler was created
+	uint64_t start, end;
+
+	//! \brief The number of zones that were already open on the same thread when this zone was entered
+	uint32 depth;
+}; // class ProfileRecord
+
+
+/** ****************************************************************************
+*** \brief Holds the zones recorded by a single thread
+***
+*** Each thread is given a buffer of its own the first time it records a zone,
+*** so that zones are recorded without any locking. The main thread reads the
+*** buffers of other threads while those threads may still be recording, such
+*** as the particle workers that overlap with the next frame. A zone is only
+*** counted once it has been written completely, so the reader takes the number
+*** of written zones first and then reads zones up to that number. When a full
+*** buffer keeps being written to as it is read, its oldest zones may already
+*** have been replaced by newer ones.
+***
+*** Zones are identified by their index among every zone that was ever added
+*** to the buffer. Only the last PROFILE_ZONES_PER_THREAD of them are held.
+*** ***************************************************************************/
+class ProfileThreadBuffer {
+public:
+	/** \param thread_id The identifier of the thread as it appears in a trace
+	*** \param thread_name The name of the thread as it appears in a trace
+	**/
+	ProfileThreadBuffer(uint32 thread_id, const std::string& thread_name);
+
+	//! \brief Adds a zone to the buffer, overwriting the oldest zone if the buffer is full
+	void AddRecord(const char* name, uint64_t start, uint64_t end, uint32 depth);
+
+	//! \brief Returns the total number of zones that have been completely written to the buffer
+	uint64_t GetNumWritten() const;
+
+	//! \brief Returns the index of the oldest zone that the buffer still holds, given the result of GetNumWritten()
+	static uint64_t GetFirstHeld(uint64_t num_written)
+		{ return (num_written > PROFILE_ZONES_PER_THREAD) ? (num_written - PROFILE_ZONES_PER_THREAD) : 0; }
+
+	/** \brief Returns a zone held by the buffer
+	*** \param index The index of the zone, which must be at least GetFirstHeld() and less than GetNumWritten()
+	**/
+	const ProfileRecord& GetRecord(uint64_t index) const
+		{ return _records[index % PROFILE_ZONES_PER_THREAD]; }
+
+	//! \brief The identifier and name of the thread
+	uint32 thread_id;
+	std::string thread_name;
+
+	//! \brief The number of zones that the thread currently has open
+	uint32 depth;
+
+private:
+	//! \brief The recorded zones, used as a ring buffer
+	std::vector<ProfileRecord> _records;
+
+	//! \brief The total number of zones that have ever been added to the buffer. Only the owning thread changes this value
+	volatile uint64_t _num_written;
+}; // class ProfileThreadBuffer
+
+
+/** ****************************************************************************
+*** \brief Measures the time spent in a block of code
+***
+*** This should not be used directly, but through the PROFILE_ZONE macro.
+*** ***************************************************************************/
+class ProfileZone {
+public:
+	ProfileZone(const char* name);
+
+	~ProfileZone();
+
+private:
+	//! \brief The name of the zone
+	const char* _name;
+
+	//! \brief The buffer that the zone is added to, or nullptr if the profiler was not recording when the zone was entered
+	ProfileThreadBuffer* _buffer;
+
+	//! \brief The time at which the zone was entered
+	uint64_t _start;
+}; // class ProfileZone
+
+
+/** ****************************************************************************
+*** \brief Records zones and exports them as traces or as an on-screen overlay
+***
+*** \note This class is a singleton. Unlike the other engine singletons, its
+*** global pointer is reset to nullptr when it is destroyed, since zones that
+*** are left after that point must be able to tell that it no longer exists.
+*** ***************************************************************************/
+class ProfileEngine : public hoa_utils::Singleton<ProfileEngine> {
+	friend class hoa_utils::Singleton<ProfileEngine>;
+
+public:
+	~ProfileEngine();
+
+	bool SingletonInitialize();
+
+	//! \brief Returns true if zones are currently being recorded
+	bool IsRecording()
+		{ return (SDL_AtomicGet(&_recording) != 0); }
+
+	//! \brief Returns the number of nanoseconds that have passed since the profiler was created
+	uint64_t GetTime() const;
+
+	/** \brief Marks the beginning of a new frame
+	*** This is called by the main loop at the start of every frame. The overlay draws the zones that were recorded
+	*** between the last two calls.
+	**/
+	void BeginFrame();
+
+	//! \name Capture methods
+	//@{
+	/** \brief Starts recording all zones for a capture
+	*** \return False if a capture is already in progress
+	**/
+	bool StartCapture();
+
+	/** \brief Stops the capture in progress and writes its zones to a file
+	*** \param filename The name of the file to write the trace to
+	*** \return False if no capture was in progress or if the file could not be written
+	**/
+	bool StopCapture(const std::string& filename);
+
+	bool IsCapturing() const
+		{ return _capturing; }
+	//@}
+
+	//! \name Overlay methods
+	//@{
+	void SetOverlayEnabled(bool enabled)
+		{ _overlay_enabled = enabled; _UpdateRecording(); }
+
+	bool IsOverlayEnabled() const
+		{ return _overlay_enabled; }
+
+	/** \brief Draws the zones of the main thread for the previous frame as a flame bar
+	*** This is called by the video engine at the end of every frame while the overlay is enabled.
+	**/
+	void DrawOverlay();
+	//@}
+
+	/** \brief Returns the buffer that the calling thread records its zones to, creating it if necessary
+	*** \note This is only meant to be called by ProfileZone
+	**/
+	ProfileThreadBuffer* GetThreadBuffer();
+
+private:
+	ProfileEngine();
+
+	//! \brief Non-zero while zones are being recorded. This is read by every thread that enters a zone
+	SDL_atomic_t _recording;
+
+	//! \brief The value of the performance counter when the profiler was created, and the counter's frequency
+	uint64_t _counter_start, _counter_frequency;
+
+	//! \brief True while a capture is in progress
+	bool _capturing;
+
+	//! \brief The time at which the capture in progress was started
+	uint64_t _capture_start;
+
+	//! \brief True while the overlay is shown
+	bool _overlay_enabled;
+
+	//! \brief The time at which the current frame began, and the times at which the previous frame began and ended
+	uint64_t _frame_start, _previous_frame_start, _previous_frame_end;
+
+	//! \brief The buffer of the main thread, which is the thread that created the profiler
+	ProfileThreadBuffer* _main_buffer;
+
+	//! \brief The buffers of all threads that have recorded zones
+	std::vector<ProfileThreadBuffer*> _buffers;
+
+	//! \brief Guards the creation of new buffers
+	SDL_mutex* _buffers_mutex;
+
+	//! \brief Starts or stops recording depending on whether a capture is in progress or the overlay is shown
+	void _UpdateRecording()
+		{ SDL_AtomicSet(&_recording, (_capturing == true || _overlay_enabled == true) ? 1 : 0); }
+
+	/** \brief Writes the zones recorded since a point in time in the Chrome trace event format
+	*** \param filename The name of the file to write
+	*** \param since Zones that were entered before this time are not written
+	*** \return False if the file could not be written
+	**/
+	bool _WriteTrace(const std::string& filename, uint64_t since);
+}; // class ProfileEngine : public hoa_utils::Singleton<ProfileEngine>
+
+} // namespace hoa_system
@@ -0,0 +1,154 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    capture_framebuffer.cpp
+*** \author  agent
+*** \brief   Source file for the CaptureFramebuffer class
+*** ***************************************************************************/
+
+#include <cstdio>
+
+#include "capture_framebuffer.h"
+#include "video.h"
+
+using namespace std;
+using namespace hoa_utils;
+
+namespace hoa_video {
+
+namespace private_video {
+
+// The OpenGL 1.1 headers of some platforms do not define these
+static const GLenum CAPTURE_GL_READ_FRAMEBUFFER = 0x8CA8;
+static const GLenum CAPTURE_GL_DRAW_FRAMEBUFFER = 0x8CA9;
+static const GLenum CAPTURE_GL_READ_FRAMEBUFFER_BINDING = 0x8CAA;
+static const GLenum CAPTURE_GL_DRAW_FRAMEBUFFER_BINDING = 0x8CA6;
+static const GLenum CAPTURE_GL_COLOR_ATTACHMENT0 = 0x8CE0;
+static const GLenum CAPTURE_GL_FRAMEBUFFER_COMPLETE = 0x8CD5;
+
+CaptureFramebuffer::CaptureFramebuffer() :
+	_available(-1),
+	_read_framebuffer(0),
+	_draw_framebuffer(0),
+	_GenFramebuffers(nullptr),
+	_DeleteFramebuffers(nullptr),
+	_BindFramebuffer(nullptr),
+	_FramebufferTexture2D(nullptr),
+	_CheckFramebufferStatus(nullptr),
+	_BlitFramebuffer(nullptr)
+{}
+
+
+
+bool CaptureFramebuffer::IsAvailable() {
+	if (_available < 0)
+		_LoadFunctions();
+	return (_available == 1);
+}
+
+
+
+bool CaptureFramebuffer::Blit(GLuint source, int32 source_x, int32 source_y, int32 source_width, int32 source_height,
+	GLuint destination, int32 destination_x, int32 destination_y, int32 destination_width, int32 destination_height)
+{
+	if (IsAvailable() == false)
+		return false;
+
+	if (_read_framebuffer == 0) {
+		_GenFramebuffers(1, &_read_framebuffer);
+		_GenFramebuffers(1, &_draw_framebuffer);
+	}
+
+	// The window or the offscreen framebuffer of the headless target must be bound again once the blit is done
+	GLint previous_read = 0;
+	GLint previous_draw = 0;
+	glGetIntegerv(CAPTURE_GL_READ_FRAMEBUFFER_BINDING, &previous_read);
+	glGetIntegerv(CAPTURE_GL_DRAW_FRAMEBUFFER_BINDING, &previous_draw);
+
+	_BindFramebuffer(CAPTURE_GL_READ_FRAMEBUFFER, _read_framebuffer);
+	_FramebufferTexture2D(CAPTURE_GL_READ_FRAMEBUFFER, CAPTURE_GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, source, 0);
+	_BindFramebuffer(CAPTURE_GL_DRAW_FRAMEBUFFER, _draw_framebuffer);
+	_FramebufferTexture2D(CAPTURE_GL_DRAW_FRAMEBUFFER, CAPTURE_GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, destination, 0);
+
+	bool success = (_CheckFramebufferStatus(CAPTURE_GL_READ_FRAMEBUFFER) == CAPTURE_GL_FRAMEBUFFER_COMPLETE &&
+		_CheckFramebufferStatus(CAPTURE_GL_DRAW_FRAMEBUFFER) == CAPTURE_GL_FRAMEBUFFER_COMPLETE);
+	if (success == true) {
+		_BlitFramebuffer(source_x, source_y, source_x + source_width, source_y + source_height,
+			destination_x, destination_y, destination_x + destination_width, destination_y + destination_height,
+			GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	}
+	else {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "a texture could not be attached to a framebuffer object" << endl;
+	}
+
+	// Detaching the textures ensures that they can never be both sampled and attached to a bound framebuffer
+	_FramebufferTexture2D(CAPTURE_GL_READ_FRAMEBUFFER, CAPTURE_GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+	_FramebufferTexture2D(CAPTURE_GL_DRAW_FRAMEBUFFER, CAPTURE_GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+	_BindFramebuffer(CAPTURE_GL_READ_FRAMEBUFFER, static_cast<GLuint>(previous_read));
+	_BindFramebuffer(CAPTURE_GL_DRAW_FRAMEBUFFER, static_cast<GLuint>(previous_draw));
+
+	return success;
+} // bool CaptureFramebuffer::Blit(...)
+
+
+
+void CaptureFramebuffer::Release() {
+	if (_read_framebuffer != 0) {
+		_DeleteFramebuffers(1, &_read_framebuffer);
+		_DeleteFramebuffers(1, &_draw_framebuffer);
+		_read_framebuffer = 0;
+		_draw_framebuffer = 0;
+	}
+
+	// The functions of a new context may differ, so they are retrieved again
+	_available = -1;
+}
+
+
+
+bool CaptureFramebuffer::_LoadFunctions() {
+	_available = 0;
+
+	const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+	int32 major = 0;
+	int32 minor = 0;
+	if (version == nullptr || sscanf(version, "%d.%d", &major, &minor) != 2) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "could not determine the OpenGL version" << endl;
+		return false;
+	}
+
+	// Framebuffer objects became core functionality in OpenGL 3.0, with the same function names as the extension
+	if (major < 3 && VideoManager->IsGLExtensionSupported("GL_ARB_framebuffer_object") == false) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "OpenGL " << version << " does not support framebuffer blits, "
+			<< "screen captures will not be scaled" << endl;
+		return false;
+	}
+
+	_GenFramebuffers = reinterpret_cast<GenFramebuffersFunction>(VideoManager->GetGLFunction("glGenFramebuffers"));
+	_DeleteFramebuffers = reinterpret_cast<DeleteFramebuffersFunction>(VideoManager->GetGLFunction("glDeleteFramebuffers"));
+	_BindFramebuffer = reinterpret_cast<BindFramebufferFunction>(VideoManager->GetGLFunction("glBindFramebuffer"));
+	_FramebufferTexture2D = reinterpret_cast<FramebufferTexture2DFunction>(VideoManager->GetGLFunction("glFramebufferTexture2D"));
+	_CheckFramebufferStatus = reinterpret_cast<CheckFramebufferStatusFunction>(VideoManager->GetGLFunction("glCheckFramebufferStatus"));
+	_BlitFramebuffer = reinterpret_cast<BlitFramebufferFunction>(VideoManager->GetGLFunction("glBlitFramebuffer"));
+
+	if (_GenFramebuffers == nullptr || _DeleteFramebuffers == nullptr || _BindFramebuffer == nullptr ||
+		_FramebufferTexture2D == nullptr || _CheckFramebufferStatus == nullptr || _BlitFramebuffer == nullptr)
+	{
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to retrieve the framebuffer object functions, screen captures will not be scaled" << endl;
+		return false;
+	}
+
+	_available = 1;
+	return true;
+} // bool CaptureFramebuffer::_LoadFunctions()
+
+} // namespace private_video
+
+} // namespace hoa_video
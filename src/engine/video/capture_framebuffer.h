@@ -0,0 +1,125 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    capture_framebuffer.h
+*** \author  agent
+*** \brief   Header file for the CaptureFramebuffer class
+***
+*** Screen captures are drawn as backdrops by the menu, pause, shop, and save
+*** modes. A capture that is drawn at a lower resolution than the screen is
+*** scaled down from a full size capture by blitting one texture into another
+*** through a pair of framebuffer objects, which filters the image on the
+*** graphics card without reading it back.
+***
+*** Framebuffer blits require OpenGL 3.0 or the ARB_framebuffer_object
+*** extension. Without them captures are always made at the full resolution.
+*** ***************************************************************************/
+
+#pragma once
+
+#ifdef _VS
+	#include <GL/glew.h>
+#endif
+
+// OpenGL includes
+#ifdef __APPLE__
+	#include <OpenGL/gl.h>
+#else
+	#include <GL/gl.h>
+#endif
+
+#include "defs.h"
+#include "utils.h"
+
+#ifndef APIENTRY
+	#define APIENTRY
+#endif
+
+namespace hoa_video {
+
+namespace private_video {
+
+/** ****************************************************************************
+*** \brief Copies and scales rectangles between textures on the graphics card
+***
+*** The VideoEngine owns the only object of this class. Its framebuffer objects
+*** are created the first time that a blit is made and are kept for all later
+*** blits, so that a capture does not create any OpenGL objects once the first
+*** capture has been made.
+***
+*** \note The framebuffer objects belong to the OpenGL context, so Release()
+*** must be called before the context is destroyed.
+*** ***************************************************************************/
+class CaptureFramebuffer {
+public:
+	CaptureFramebuffer();
+
+	~CaptureFramebuffer()
+		{}
+
+	//! \brief Returns true if the OpenGL context supports framebuffer blits
+	bool IsAvailable();
+
+	/** \brief Copies a rectangle of one texture into a rectangle of another, scaling it with linear filtering
+	*** \param source The texture to copy from
+	*** \param source_x The left edge of the rectangle to copy from, in pixels
+	*** \param source_y The bottom edge of the rectangle to copy from, in pixels
+	*** \param source_width The width of the rectangle to copy from, in pixels
+	*** \param source_height The height of the rectangle to copy from, in pixels
+	*** \param destination The texture to copy to, which must not be the same as the source
+	*** \param destination_x The left edge of the rectangle to copy to, in pixels
+	*** \param destination_y The bottom edge of the rectangle to copy to, in pixels
+	*** \param destination_width The width of the rectangle to copy to, in pixels
+	*** \param destination_height The height of the rectangle to copy to, in pixels
+	*** \return False if blits are not available or either texture could not be attached
+	***
+	*** The framebuffers that were bound before the blit are bound again afterwards. The scissor test must be disabled.
+	**/
+	bool Blit(GLuint source, int32 source_x, int32 source_y, int32 source_width, int32 source_height,
+		GLuint destination, int32 destination_x, int32 destination_y, int32 destination_width, int32 destination_height);
+
+	/** \brief Deletes the framebuffer objects and forgets the functions of the current context
+	*** This must be called before the OpenGL context is lost. The objects are created again when they are needed.
+	**/
+	void Release();
+
+private:
+	typedef void (APIENTRY *GenFramebuffersFunction)(GLsizei, GLuint*);
+	typedef void (APIENTRY *DeleteFramebuffersFunction)(GLsizei, const GLuint*);
+	typedef void (APIENTRY *BindFramebufferFunction)(GLenum, GLuint);
+	typedef void (APIENTRY *FramebufferTexture2DFunction)(GLenum, GLenum, GLenum, GLuint, GLint);
+	typedef GLenum (APIENTRY *CheckFramebufferStatusFunction)(GLenum);
+	typedef void (APIENTRY *BlitFramebufferFunction)(GLint, GLint, GLint, GLint, GLint, GLint, GLint, GLint, GLbitfield, GLenum);
+
+	//! \brief Whether framebuffer blits are supported: 1 if they are, 0 if they are not, or -1 if this has not been determined
+	int8 _available;
+
+	//! \brief The framebuffer objects that the source and destination textures are attached to, or zero if they have not been created
+	GLuint _read_framebuffer, _draw_framebuffer;
+
+	//! \brief The framebuffer object functions, which are retrieved when a blit is first made
+	//@{
+	GenFramebuffersFunction _GenFramebuffers;
+	DeleteFramebuffersFunction _DeleteFramebuffers;
+	BindFramebufferFunction _BindFramebuffer;
+	FramebufferTexture2DFunction _FramebufferTexture2D;
+	CheckFramebufferStatusFunction _CheckFramebufferStatus;
+	BlitFramebufferFunction _BlitFramebuffer;
+	//@}
+
+	/** \brief Determines if framebuffer blits are supported and retrieves their functions
+	*** \return False if they are not supported
+	**/
+	bool _LoadFunctions();
+}; // class CaptureFramebuffer
+
+} // namespace private_video
+
+} // namespace hoa_video
@@ -15,21 +15,7 @@ using namespace hoa_video::private_video;
 namespace hoa_video {
 
 ParticleEffectID VideoEngine::AddParticleEffect(const string &filename, float x, float y, bool reload) {
-	ParticleEffectDef *def = nullptr;
-
-	bool effect_loaded = _particle_effect_defs.find(filename) != _particle_effect_defs.end();
-
-	if(effect_loaded && !reload)
-	{
-		def = _particle_effect_defs[filename];
-	}
-	else
-	{
-		def = _particle_manager.LoadEffect(filename);
-		if(effect_loaded)
-			delete _particle_effect_defs[filename];
-		_particle_effect_defs[filename] = def;
-	}
+	const ParticleEffectDef *def = _particle_manager.GetEffectDefinition(filename, reload);
 
 	if(!def)
 	{
@@ -50,6 +36,29 @@ ParticleEffectID VideoEngine::AddParticleEffect(const string &filename, float x,
 }
 
 
+//-----------------------------------------------------------------------------
+// PreloadParticleEffects: loads the definitions of effects that are going to be
+//                         added later, so that adding them does not have to
+//                         read their files and images
+//-----------------------------------------------------------------------------
+
+bool VideoEngine::PreloadParticleEffects(const vector<string> &filenames)
+{
+	return _particle_manager.PreloadEffects(filenames);
+}
+
+
+//-----------------------------------------------------------------------------
+// UnloadUnusedParticleEffects: deletes the definitions of all effects which are
+//                              not currently active
+//-----------------------------------------------------------------------------
+
+void VideoEngine::UnloadUnusedParticleEffects()
+{
+	_particle_manager.UnloadUnusedEffects();
+}
+
+
 //-----------------------------------------------------------------------------
 // DrawParticleEffects: call this once per frame. You should call this after
 //                      rendering things like tiles, characters, and monsters,
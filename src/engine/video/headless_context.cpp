@@ -0,0 +1,282 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    headless_context.cpp
+*** \author  agent
+*** \brief   Source file for the HeadlessContext class
+*** ***************************************************************************/
+
+#include <cstring>
+
+#ifdef USE_EGL
+	#include <EGL/egl.h>
+	#include <EGL/eglext.h>
+#endif
+
+#include "headless_context.h"
+
+// These are part of OpenGL 3.0 and ARB_framebuffer_object, which the OpenGL 1.1 headers do not define
+#ifndef GL_FRAMEBUFFER
+	#define GL_FRAMEBUFFER 0x8D40
+#endif
+#ifndef GL_RENDERBUFFER
+	#define GL_RENDERBUFFER 0x8D41
+#endif
+#ifndef GL_COLOR_ATTACHMENT0
+	#define GL_COLOR_ATTACHMENT0 0x8CE0
+#endif
+#ifndef GL_DEPTH_STENCIL_ATTACHMENT
+	#define GL_DEPTH_STENCIL_ATTACHMENT 0x821A
+#endif
+#ifndef GL_DEPTH24_STENCIL8
+	#define GL_DEPTH24_STENCIL8 0x88F0
+#endif
+#ifndef GL_FRAMEBUFFER_COMPLETE
+	#define GL_FRAMEBUFFER_COMPLETE 0x8CD5
+#endif
+
+#if defined(USE_EGL) && !defined(EGL_PLATFORM_SURFACELESS_MESA)
+	#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+using namespace std;
+using namespace hoa_utils;
+
+namespace hoa_video {
+
+namespace private_video {
+
+HeadlessContext::HeadlessContext() :
+	_display(nullptr),
+	_context(nullptr),
+	_framebuffer(0),
+	_color_buffer(0),
+	_depth_stencil_buffer(0),
+	_GenFramebuffers(nullptr),
+	_DeleteFramebuffers(nullptr),
+	_BindFramebuffer(nullptr),
+	_GenRenderbuffers(nullptr),
+	_DeleteRenderbuffers(nullptr),
+	_BindRenderbuffer(nullptr),
+	_RenderbufferStorage(nullptr),
+	_FramebufferRenderbuffer(nullptr),
+	_CheckFramebufferStatus(nullptr)
+{}
+
+
+
+bool HeadlessContext::Create(int32 width, int32 height) {
+	if (width <= 0 || height <= 0) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "invalid framebuffer size: " << width << "x" << height << endl;
+		return false;
+	}
+
+	if (IsCreated() == false && _CreateContext() == false)
+		return false;
+
+	_DestroyFramebuffer();
+	return _CreateFramebuffer(width, height);
+}
+
+
+
+void HeadlessContext::Destroy() {
+	if (IsCreated() == false)
+		return;
+
+	_DestroyFramebuffer();
+
+#ifdef USE_EGL
+	EGLDisplay display = static_cast<EGLDisplay>(_display);
+	eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	eglDestroyContext(display, static_cast<EGLContext>(_context));
+	eglTerminate(display);
+#endif
+
+	_display = nullptr;
+	_context = nullptr;
+}
+
+
+
+void HeadlessContext::Present() {
+	glFinish();
+}
+
+
+
+void* HeadlessContext::GetFunction(const char* name) const {
+#ifdef USE_EGL
+	return reinterpret_cast<void*>(eglGetProcAddress(name));
+#else
+	IF_PRINT_WARNING(VIDEO_DEBUG) << "headless rendering is not supported by this build, unable to retrieve: " << name << endl;
+	return nullptr;
+#endif
+}
+
+
+
+bool HeadlessContext::IsExtensionSupported(const char* name) const {
+	const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+	if (extensions == nullptr)
+		return false;
+
+	// The name must match an entire entry of the space separated list, not only the start of a longer name
+	size_t length = strlen(name);
+	for (const char* found = strstr(extensions, name); found != nullptr; found = strstr(found + length, name)) {
+		bool starts = (found == extensions || found[-1] == ' ');
+		bool ends = (found[length] == ' ' || found[length] == '\0');
+		if (starts == true && ends == true)
+			return true;
+	}
+	return false;
+}
+
+
+
+bool HeadlessContext::_CreateContext() {
+#ifdef USE_EGL
+	// The surfaceless platform of Mesa requires neither a display server nor a graphics card. If it is not
+	// available, the default display is tried instead, which works with the drivers of most graphics cards.
+	EGLDisplay display = EGL_NO_DISPLAY;
+	PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+		reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+	if (get_platform_display != nullptr)
+		display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	if (display == EGL_NO_DISPLAY)
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint major, minor;
+	if (display == EGL_NO_DISPLAY || eglInitialize(display, &major, &minor) == EGL_FALSE) {
+		PRINT_ERROR << "failed to initialize an EGL display" << endl;
+		return false;
+	}
+
+	// No surface is ever created, so the context must be able to be made current without one
+	const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+	if (extensions == nullptr || strstr(extensions, "EGL_KHR_surfaceless_context") == nullptr) {
+		PRINT_ERROR << "EGL " << major << "." << minor << " does not support surfaceless contexts" << endl;
+		eglTerminate(display);
+		return false;
+	}
+
+	// The engine draws with the fixed function pipeline, so a desktop OpenGL context with the compatibility profile is required
+	const EGLint config_attributes[] = {
+		EGL_SURFACE_TYPE, 0,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint config_count = 0;
+	if (eglBindAPI(EGL_OPENGL_API) == EGL_FALSE ||
+		eglChooseConfig(display, config_attributes, &config, 1, &config_count) == EGL_FALSE || config_count == 0)
+	{
+		PRINT_ERROR << "EGL does not provide a configuration for desktop OpenGL" << endl;
+		eglTerminate(display);
+		return false;
+	}
+
+	EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, nullptr);
+	if (context == EGL_NO_CONTEXT) {
+		PRINT_ERROR << "failed to create an EGL context, error code: " << eglGetError() << endl;
+		eglTerminate(display);
+		return false;
+	}
+
+	if (eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context) == EGL_FALSE) {
+		PRINT_ERROR << "failed to make the EGL context current, error code: " << eglGetError() << endl;
+		eglDestroyContext(display, context);
+		eglTerminate(display);
+		return false;
+	}
+
+	_display = static_cast<void*>(display);
+	_context = static_cast<void*>(context);
+
+	_GenFramebuffers = reinterpret_cast<GenFunction>(GetFunction("glGenFramebuffers"));
+	_DeleteFramebuffers = reinterpret_cast<DeleteFunction>(GetFunction("glDeleteFramebuffers"));
+	_BindFramebuffer = reinterpret_cast<BindFunction>(GetFunction("glBindFramebuffer"));
+	_GenRenderbuffers = reinterpret_cast<GenFunction>(GetFunction("glGenRenderbuffers"));
+	_DeleteRenderbuffers = reinterpret_cast<DeleteFunction>(GetFunction("glDeleteRenderbuffers"));
+	_BindRenderbuffer = reinterpret_cast<BindFunction>(GetFunction("glBindRenderbuffer"));
+	_RenderbufferStorage = reinterpret_cast<RenderbufferStorageFunction>(GetFunction("glRenderbufferStorage"));
+	_FramebufferRenderbuffer = reinterpret_cast<FramebufferRenderbufferFunction>(GetFunction("glFramebufferRenderbuffer"));
+	_CheckFramebufferStatus = reinterpret_cast<CheckFramebufferStatusFunction>(GetFunction("glCheckFramebufferStatus"));
+
+	if (_GenFramebuffers == nullptr || _DeleteFramebuffers == nullptr || _BindFramebuffer == nullptr ||
+		_GenRenderbuffers == nullptr || _DeleteRenderbuffers == nullptr || _BindRenderbuffer == nullptr ||
+		_RenderbufferStorage == nullptr || _FramebufferRenderbuffer == nullptr || _CheckFramebufferStatus == nullptr)
+	{
+		PRINT_ERROR << "OpenGL " << glGetString(GL_VERSION) << " does not support framebuffer objects" << endl;
+		Destroy();
+		return false;
+	}
+
+	if (VIDEO_DEBUG) {
+		cout << "VIDEO: headless rendering with EGL " << major << "." << minor << ", OpenGL " << glGetString(GL_VERSION)
+			<< " (" << glGetString(GL_RENDERER) << ")" << endl;
+	}
+	return true;
+#else
+	PRINT_ERROR << "headless rendering is not supported by this build, it must be built with the USE_EGL option" << endl;
+	return false;
+#endif
+} // bool HeadlessContext::_CreateContext()
+
+
+
+bool HeadlessContext::_CreateFramebuffer(int32 width, int32 height) {
+	_GenRenderbuffers(1, &_color_buffer);
+	_BindRenderbuffer(GL_RENDERBUFFER, _color_buffer);
+	_RenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+	_GenRenderbuffers(1, &_depth_stencil_buffer);
+	_BindRenderbuffer(GL_RENDERBUFFER, _depth_stencil_buffer);
+	_RenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	_BindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	_GenFramebuffers(1, &_framebuffer);
+	_BindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+	_FramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _color_buffer);
+	_FramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, _depth_stencil_buffer);
+
+	GLenum status = _CheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		PRINT_ERROR << "the offscreen framebuffer is not complete, status: " << status << endl;
+		_DestroyFramebuffer();
+		return false;
+	}
+
+	// Without a surface there is no default viewport, so it is set to cover the whole framebuffer
+	glViewport(0, 0, width, height);
+	return true;
+}
+
+
+
+void HeadlessContext::_DestroyFramebuffer() {
+	if (_framebuffer != 0) {
+		_BindFramebuffer(GL_FRAMEBUFFER, 0);
+		_DeleteFramebuffers(1, &_framebuffer);
+		_framebuffer = 0;
+	}
+	if (_color_buffer != 0) {
+		_DeleteRenderbuffers(1, &_color_buffer);
+		_color_buffer = 0;
+	}
+	if (_depth_stencil_buffer != 0) {
+		_DeleteRenderbuffers(1, &_depth_stencil_buffer);
+		_depth_stencil_buffer = 0;
+	}
+}
+
+} // namespace private_video
+
+} // namespace hoa_video
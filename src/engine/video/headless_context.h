@@ -0,0 +1,146 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    headless_context.h
+*** \author  agent
+*** \brief   Header file for the HeadlessContext class
+***
+*** The headless context allows the game to run on a machine with neither a
+*** display server nor a graphics card, such as a build server, so that maps,
+*** battles, and the test mode can be run to measure frame times. It creates
+*** an OpenGL context through EGL, preferring the surfaceless platform of Mesa,
+*** and renders every frame into an offscreen framebuffer object instead of a
+*** window.
+***
+*** EGL is only used when the game is built with the USE_EGL option. Otherwise
+*** the context can not be created and the headless target is unavailable.
+*** ***************************************************************************/
+
+#pragma once
+
+// OpenGL includes
+#ifdef __APPLE__
+	#include <OpenGL/gl.h>
+#else
+	#include <GL/gl.h>
+#endif
+
+#include "defs.h"
+#include "utils.h"
+
+#ifndef APIENTRY
+	#define APIENTRY
+#endif
+
+namespace hoa_video {
+
+namespace private_video {
+
+/** ****************************************************************************
+*** \brief An OpenGL context that renders into an offscreen framebuffer
+***
+*** The VideoEngine owns the only object of this class and uses it in place of
+*** a SDL window when its target is VIDEO_TARGET_HEADLESS. The framebuffer has a
+*** color and a combined depth and stencil buffer, the same as the buffers that
+*** are requested for a window, so everything that the engine draws (including
+*** the stencil operations of particle effects and screenshots) behaves the
+*** same as it does in a window.
+***
+*** \note The EGL display and context are held as untyped pointers so that this
+*** header does not depend on the EGL headers.
+*** ***************************************************************************/
+class HeadlessContext {
+public:
+	HeadlessContext();
+
+	~HeadlessContext()
+		{ Destroy(); }
+
+	/** \brief Creates the context and a framebuffer of the given size, and makes the framebuffer current
+	*** \param width The width of the framebuffer, in pixels
+	*** \param height The height of the framebuffer, in pixels
+	*** \return False if the context or the framebuffer could not be created
+	***
+	*** If the context already exists, only the framebuffer is recreated at the new size. The context and
+	*** everything that was created in it, such as textures, remains valid in this case.
+	**/
+	bool Create(int32 width, int32 height);
+
+	//! \brief Destroys the framebuffer and the context, if they exist
+	void Destroy();
+
+	//! \brief Returns true if the context has been created
+	bool IsCreated() const
+		{ return (_context != nullptr); }
+
+	/** \brief Waits for all drawing of the current frame to finish
+	*** This takes the place of swapping the buffers of a window, so that the time taken by each frame includes
+	*** the time taken to render it.
+	**/
+	void Present();
+
+	/** \brief Retrieves an OpenGL function that is not part of OpenGL 1.1
+	*** \param name The name of the function
+	*** \return A pointer to the function, or nullptr if it is not available
+	**/
+	void* GetFunction(const char* name) const;
+
+	/** \brief Determines if the context supports an OpenGL extension
+	*** \param name The name of the extension, such as "GL_ARB_instanced_arrays"
+	**/
+	bool IsExtensionSupported(const char* name) const;
+
+private:
+	typedef void (APIENTRY *GenFunction)(GLsizei, GLuint*);
+	typedef void (APIENTRY *DeleteFunction)(GLsizei, const GLuint*);
+	typedef void (APIENTRY *BindFunction)(GLenum, GLuint);
+	typedef void (APIENTRY *RenderbufferStorageFunction)(GLenum, GLenum, GLsizei, GLsizei);
+	typedef void (APIENTRY *FramebufferRenderbufferFunction)(GLenum, GLenum, GLenum, GLuint);
+	typedef GLenum (APIENTRY *CheckFramebufferStatusFunction)(GLenum);
+
+	//! \brief The EGLDisplay and EGLContext of the context, or nullptr if the context has not been created
+	void* _display;
+	void* _context;
+
+	//! \brief The framebuffer object that is drawn to, and its color and depth/stencil renderbuffers
+	GLuint _framebuffer;
+	GLuint _color_buffer;
+	GLuint _depth_stencil_buffer;
+
+	//! \brief The framebuffer object functions, which are retrieved once the context has been created
+	//@{
+	GenFunction _GenFramebuffers;
+	DeleteFunction _DeleteFramebuffers;
+	BindFunction _BindFramebuffer;
+	GenFunction _GenRenderbuffers;
+	DeleteFunction _DeleteRenderbuffers;
+	BindFunction _BindRenderbuffer;
+	RenderbufferStorageFunction _RenderbufferStorage;
+	FramebufferRenderbufferFunction _FramebufferRenderbuffer;
+	CheckFramebufferStatusFunction _CheckFramebufferStatus;
+	//@}
+
+	/** \brief Creates the EGL display and context and makes the context current without a surface
+	*** \return False if EGL is unavailable or did not provide a suitable context
+	**/
+	bool _CreateContext();
+
+	/** \brief Creates the framebuffer and its renderbuffers and binds the framebuffer
+	*** \return False if the framebuffer is not complete
+	**/
+	bool _CreateFramebuffer(int32 width, int32 height);
+
+	//! \brief Deletes the framebuffer and its renderbuffers, if they exist
+	void _DestroyFramebuffer();
+}; // class HeadlessContext
+
+} // namespace private_video
+
+} // namespace hoa_video
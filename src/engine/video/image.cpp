@@ -248,22 +248,29 @@ bool ImageDescriptor::LoadMultiImageFromElementSize(vector<StillImage>& images,
 
 
 bool ImageDescriptor::LoadMultiImageFromElementGrid(vector<StillImage>& images, const string& filename,
-		const uint32 grid_rows, const uint32 grid_cols)
+		const uint32 grid_rows, const uint32 grid_cols, ImageMemory* decoded_image)
 {
-	if (DoesFileExist(filename) == false) {
-		IF_PRINT_WARNING(VIDEO_DEBUG) << "function call failed because the file requested did not exist: " << filename << endl;
-		return false;
-	}
-
 	// First retrieve the dimensions of the multi image (in pixels)
 	uint32 img_height, img_width, bpp;
-	try {
-		GetImageInfo(filename, img_height, img_width, bpp);
+	if (decoded_image != nullptr && decoded_image->pixels != nullptr && decoded_image->rgb_format == false) {
+		img_height = decoded_image->height;
+		img_width = decoded_image->width;
 	}
-	catch (Exception e) {
-		if (VIDEO_DEBUG)
-			cerr << e.ToString() << endl;
-		return false;
+	else {
+		decoded_image = nullptr;
+		if (DoesFileExist(filename) == false) {
+			IF_PRINT_WARNING(VIDEO_DEBUG) << "function call failed because the file requested did not exist: " << filename << endl;
+			return false;
+		}
+
+		try {
+			GetImageInfo(filename, img_height, img_width, bpp);
+		}
+		catch (Exception e) {
+			if (VIDEO_DEBUG)
+				cerr << e.ToString() << endl;
+			return false;
+		}
 	}
 
 	// Make sure that the number of grid rows and columns divide evenly into the image size
@@ -289,7 +296,7 @@ bool ImageDescriptor::LoadMultiImageFromElementGrid(vector<StillImage>& images,
 			i->_width = static_cast<float>(elem_width);
 	}
 
-	return _LoadMultiImage(images, filename, grid_rows, grid_cols);
+	return _LoadMultiImage(images, filename, grid_rows, grid_cols, decoded_image);
 } // bool ImageDescriptor::LoadMultiImageFromElementGrid(...)
 
 
@@ -459,9 +466,9 @@ void ImageDescriptor::_RemoveTextureReference() {
 	if (_texture->RemoveReference() == true) {
 		_texture->texture_sheet->RemoveTexture(_texture);
 
-		// If the image exceeds 512 in either width or height, it has an un-shared texture sheet, which we
-		// should now delete that the image is being removed
-		if (_texture->width > 512 || _texture->height > 512) {
+		// If the image has an un-shared texture sheet (because it is too large to share one, or the sheet is a texture
+		// atlas page), we should now delete the sheet once the last image in it is removed
+		if (_texture->texture_sheet->shared == false && _texture->texture_sheet->GetNumberTextures() == 0) {
 			TextureManager->_RemoveSheet(_texture->texture_sheet);
 		}
 // 		else {
@@ -515,15 +522,15 @@ void ImageDescriptor::_DrawOrientation() const {
 		x_scale = -x_scale;
 	if (current_context.coordinate_system.GetVerticalDirection() < 0.0f)
 		y_scale = -y_scale;
-	glScalef(x_scale, y_scale, 1.0f);
+	VideoManager->Scale(x_scale, y_scale);
 }
 
 
 
 void ImageDescriptor::_DrawTexture(const Color* draw_color) const {
-	// Array of the four vertexes defined on the 2D plane for glDrawArrays()
-	// This is no longer const, because when tiling the background for the menu's
-	// sometimes you need to draw part of a texture
+	// Array of the four vertexes defined on the 2D plane. These are transformed by the current modelview
+	// matrix when they are added to the sprite batch. This is no longer const, because when tiling the
+	// background for the menu's sometimes you need to draw part of a texture
 	float vert_coords[] = {
 		_u1, _v1,
 		_u2, _v1,
@@ -535,26 +542,27 @@ void ImageDescriptor::_DrawTexture(const Color* draw_color) const {
 	if (draw_color == nullptr)
 		draw_color = _color;
 
-	// Set blending parameters
+	// Determine the blending mode to draw with
+	SpriteBlendMode blend_mode = SPRITE_BLEND_NONE;
 	if (VideoManager->_current_context.blend) {
-		glEnable(GL_BLEND);
 		if (VideoManager->_current_context.blend == 1)
-			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); // Normal blending
+			blend_mode = SPRITE_BLEND_NORMAL;
 		else
-			glBlendFunc(GL_SRC_ALPHA, GL_ONE); // Additive blending
+			blend_mode = SPRITE_BLEND_ADDITIVE;
 	}
 	else if (_blend) {
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); // Normal blending
+		blend_mode = SPRITE_BLEND_NORMAL;
 	}
-	else {
-		glDisable(GL_BLEND);
+
+	// Unichrome images use their first color for all four vertices
+	Color vertex_colors[4];
+	for (uint32 i = 0; i < 4; i++) {
+		vertex_colors[i] = (_unichrome_vertices == true) ? draw_color[0] : draw_color[i];
 	}
 
-	glEnableClientState(GL_VERTEX_ARRAY);
-	glVertexPointer(2, GL_FLOAT, 0, vert_coords);
+	SpriteBatch& batch = VideoManager->_sprite_batch;
 
-	// If we have a valid image texture poiner, setup texture coordinates and the texture coordinate array for glDrawArrays()
+	// If we have a valid image texture poiner, setup texture coordinates for the quad
 	if (_texture != nullptr) {
 		// Set the texture coordinates
 		float s0, s1, t0, t1;
@@ -578,7 +586,7 @@ void ImageDescriptor::_DrawTexture(const Color* draw_color) const {
 			t1 = temp;
 		}
 
-		// Place the texture coordinates in a 4x2 array mirroring the structure of the vertex array for use in glDrawArrays().
+		// Place the texture coordinates in a 4x2 array mirroring the structure of the vertex array
 		float tex_coords[] = {
 			s0, t1,
 			s1, t1,
@@ -586,56 +594,17 @@ void ImageDescriptor::_DrawTexture(const Color* draw_color) const {
 			s0, t0,
 		};
 
-		// Enable texturing and bind texture
-		glEnable(GL_TEXTURE_2D);
-		TextureManager->_BindTexture(_texture->texture_sheet->tex_id);
+		// Changing the smoothing of the sheet will flush the batch if any filtering parameters need to change
 		_texture->texture_sheet->Smooth(_texture->smooth);
 
-		// Enable and setup the texture coordinate array
-		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-		glTexCoordPointer(2, GL_FLOAT, 0, tex_coords);
-
-		if (_unichrome_vertices == true) {
-			glColor4fv((GLfloat*)draw_color[0].GetColors());
-			glDisableClientState(GL_COLOR_ARRAY);
-		}
-		else {
-			glEnableClientState(GL_COLOR_ARRAY);
-			glColorPointer(4, GL_FLOAT, 0, (GLfloat*)draw_color);
-		}
+		batch.SetState(_texture->texture_sheet->tex_id, blend_mode, false);
+		batch.AddQuad(vert_coords, tex_coords, vertex_colors);
 	} // if (_texture != nullptr)
 
 	// Otherwise there is no image texture, so we're drawing pure color on the vertices
 	else {
-		// Use a single call to glColor for unichrome images, or a setup a gl color array for multiple colors
-		if (_unichrome_vertices == true) {
-			glColor4fv((GLfloat*)draw_color[0].GetColors());
-			glDisableClientState(GL_COLOR_ARRAY);
-		}
-		else {
-			glEnableClientState(GL_COLOR_ARRAY);
-			glColorPointer(4, GL_FLOAT, 0, (GLfloat*)draw_color);
-		}
-
-		// Disable texturing as we're using pure colour
-		glDisable(GL_TEXTURE_2D);
-	}
-
-	// Use a vertex array to draw all of the vertices
-	glDrawArrays(GL_QUADS, 0, 4);
-	glDisableClientState(GL_VERTEX_ARRAY);
-
-	if (_texture != nullptr)
-		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-
-	if (glIsEnabled(GL_COLOR_ARRAY))
-		glDisableClientState(GL_COLOR_ARRAY);
-
-	if (VideoManager->_current_context.blend || _blend == true)
-		glDisable(GL_BLEND);
-
-	if (VideoManager->CheckGLError() == true) {
-		IF_PRINT_WARNING(VIDEO_DEBUG) << "an OpenGL error occurred: " << VideoManager->CreateGLErrorString() << endl;
+		batch.SetState(0, blend_mode, false);
+		batch.AddQuad(vert_coords, nullptr, vertex_colors);
 	}
 } // void ImageDescriptor::_DrawTexture(const Color* color_array) const
 
@@ -743,7 +712,7 @@ void ImageDescriptor::_GetJpgImageInfo(const std::string& filename, uint32& rows
 
 
 bool ImageDescriptor::_LoadMultiImage(vector<StillImage>& images, const string &filename,
-	const uint32 grid_rows, const uint32 grid_cols)
+	const uint32 grid_rows, const uint32 grid_cols, ImageMemory* decoded_image)
 {
 	uint32 current_image;
 	uint32 x, y;
@@ -771,18 +740,34 @@ bool ImageDescriptor::_LoadMultiImage(vector<StillImage>& images, const string &
 		}
 	}
 
-	// If the image elements are not all loaded, then load the multi image file
-	// from disk and create enough memory to copy over individual sub-image elements from it
+	// If the multi image was packed into the texture atlas, the missing elements can be registered directly from
+	// their location in the atlas without reading the multi image file at all
+	if (need_load == true && decoded_image == nullptr) {
+		TextureManager->_LoadImagesFromAtlas(filename, grid_rows, grid_cols, tags);
+
+		// Some elements may still be missing if the atlas did not have all of them
+		need_load = false;
+		for (uint32 i = 0; i < tags.size(); i++) {
+			loaded[i] = TextureManager->_IsImageTextureRegistered(filename + tags[i]);
+			if (loaded[i] == false)
+				need_load = true;
+		}
+	}
+
+	// If the image elements are not all loaded, then load the multi image file from disk (unless it has
+	// already been decoded) and create enough memory to copy over individual sub-image elements from it
 	ImageMemory multi_image;
 	ImageMemory sub_image;
+	// Points to whichever image data the sub-image elements are copied from
+	ImageMemory* source_image = (decoded_image != nullptr) ? decoded_image : &multi_image;
 	if (need_load) {
-		if (multi_image.LoadImage(filename) == false) {
+		if (decoded_image == nullptr && multi_image.LoadImage(filename) == false) {
 			IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to load multi image file: " << filename << endl;
 			return false;
 		}
 
-		sub_image.width = multi_image.width / grid_cols;
-		sub_image.height = multi_image.height / grid_rows;
+		sub_image.width = source_image->width / grid_cols;
+		sub_image.height = source_image->height / grid_rows;
 		sub_image.pixels = malloc(sub_image.width * sub_image.height * 4);
 		if (sub_image.pixels == nullptr) {
 			PRINT_ERROR << "failed to malloc memory for multi image file: " << filename << endl;
@@ -825,8 +810,8 @@ bool ImageDescriptor::_LoadMultiImage(vector<StillImage>& images, const string &
 				images.at(current_image)._filename = filename;
 
 				for (int32 i = 0; i < sub_image.height; i++) {
-					memcpy((uint8*)sub_image.pixels + 4 * sub_image.width * i, (uint8*)multi_image.pixels + (((x * multi_image.height / grid_rows) + i) *
-						multi_image.width + y * multi_image.width / grid_cols) * 4, 4 * sub_image.width);
+					memcpy((uint8*)sub_image.pixels + 4 * sub_image.width * i, (uint8*)source_image->pixels + (((x * source_image->height / grid_rows) + i) *
+						source_image->width + y * source_image->width / grid_cols) * 4, 4 * sub_image.width);
 				}
 
 				img = new ImageTexture(filename, tags[current_image], sub_image.width, sub_image.height);
@@ -1019,7 +1004,7 @@ void StillImage::Draw(const Color& draw_color) const {
 		return;
 	}
 
-	glPushMatrix();
+	VideoManager->PushMatrix();
 	_DrawOrientation();
 
 	float modulation = VideoManager->_screen_fader.GetFadeModulation();
@@ -1040,7 +1025,7 @@ void StillImage::Draw(const Color& draw_color) const {
 		_DrawTexture(modulated_colors);
 	}
 
-	glPopMatrix();
+	VideoManager->PopMatrix();
 } // void StillImage::Draw(const Color& draw_color) const
 
 
@@ -1578,7 +1563,7 @@ void CompositeImage::Draw(const Color& draw_color) const {
 		coord_sys.GetVerticalDirection();
 
 	// Save the draw cursor position as we move to draw each element
-	glPushMatrix();
+	VideoManager->PushMatrix();
 
 	VideoManager->MoveRelative(x_align_offset, y_align_offset);
 
@@ -1608,7 +1593,7 @@ void CompositeImage::Draw(const Color& draw_color) const {
 		x_off += x_shake;
 		y_off += y_shake;
 
-		glPushMatrix();
+		VideoManager->PushMatrix();
 		VideoManager->MoveRelative(x_off * coord_sys.GetHorizontalDirection(),
 			y_off * coord_sys.GetVerticalDirection());
 
@@ -1620,7 +1605,7 @@ void CompositeImage::Draw(const Color& draw_color) const {
 		if (coord_sys.GetVerticalDirection() < 0.0f)
 			y_scale = -y_scale;
 
-		glScalef(x_scale, y_scale, 1.0f);
+		VideoManager->Scale(x_scale, y_scale);
 
 		if (skip_modulation)
 			_elements[i].image._DrawTexture(_color);
@@ -1632,9 +1617,9 @@ void CompositeImage::Draw(const Color& draw_color) const {
 			modulated_colors[3] = _color[3] * fade_color;
 			_elements[i].image._DrawTexture(modulated_colors);
 		}
-		glPopMatrix();
+		VideoManager->PopMatrix();
 	}
-	glPopMatrix();
+	VideoManager->PopMatrix();
 } // void CompositeImage::Draw(const Color& draw_color) const
 
 
@@ -216,7 +216,22 @@ public:
 	*** \note All image elements within the multi image should be of the same size
 	**/
 	static bool LoadMultiImageFromElementGrid(std::vector<StillImage>& images, const std::string& filename,
-		const uint32 grid_rows, const uint32 grid_cols);
+		const uint32 grid_rows, const uint32 grid_cols)
+		{ return LoadMultiImageFromElementGrid(images, filename, grid_rows, grid_cols, nullptr); }
+
+	/** \brief Loads a multi image into a vector of StillImage objects from image data that has already been decoded
+	*** \param images Reference to the vector of StillImages to be loaded with elements from the multi image
+	*** \param filename The name of the multi image file that the image data was decoded from
+	*** \param grid_rows The number of rows of image elements contained in the multi image
+	*** \param grid_cols The number of columns of image elements contained in the multi image
+	*** \param decoded_image The RGBA image data of the multi image file. If nullptr, the file is loaded from disk
+	*** \return True upon successful loading, false if there was an error
+	***
+	*** This allows the expensive decoding of an image file to be done ahead of time (for example, on another thread),
+	*** leaving only the upload of the image elements to texture memory. The image data is not modified or freed.
+	**/
+	static bool LoadMultiImageFromElementGrid(std::vector<StillImage>& images, const std::string& filename,
+		const uint32 grid_rows, const uint32 grid_cols, private_video::ImageMemory* decoded_image);
 
 	/** \brief Saves a vector of images into a single image file (a multi image)
 	*** \param images A reference to the vector of StillImage pointers to save into a multi image
@@ -275,7 +290,7 @@ protected:
 	***
 	*** \note This method modifies the draw cursor position and does not restore it before finishing. Therefore
 	*** under most circumstances, you will want to call VideoManager->PushState()/PopState(), or
-	*** glPushMatrix()/glPopMatrix() before and after calling this function. The latter is preferred due to the
+	*** VideoManager->PushMatrix()/PopMatrix() before and after calling this function. The latter is preferred due to the
 	*** lower cost of the call, but some circumstances may require using the former when more state information
 	*** needs to be retained.
 	**/
@@ -284,6 +299,9 @@ protected:
 	/** \brief Draws the OpenGL texture referred to by the object on the screen
 	*** \param draw_color A non-nullptr pointer to an array of four valid Color objects
 	***
+	*** The quad is not drawn immediately, but is added to the video engine's sprite batch along with the
+	*** current modelview transformation. It will be drawn when the batch is next flushed.
+	***
 	*** This method is typically a helper method to other draw calls in some way. It assumes that
 	*** all of the appropriate transformation, scaling, and other image property opertaions have been
 	*** completed prior to the calling of this function. The draw_color argument is usually nothing
@@ -316,10 +334,11 @@ private:
 	*** \param filename The name of the multi image file to read
 	*** \param grid_rows The number of rows of image elements in the multi image
 	*** \param grid_cols The number of columns of image elements in the multi image
+	*** \param decoded_image Optional image data that was already decoded from the file, used instead of reading the file
 	*** \return True if the image file was loaded and parsed successfully, false if there was an error.
 	**/
 	static bool _LoadMultiImage(std::vector<StillImage>& images, const std::string& filename,
-		const uint32 grid_rows, const uint32 grid_cols);
+		const uint32 grid_rows, const uint32 grid_cols, private_video::ImageMemory* decoded_image = nullptr);
 }; // class ImageDescriptor
 
 
@@ -336,6 +355,7 @@ class StillImage : public ImageDescriptor {
 	friend class AnimatedImage;
 	friend class CompositeImage;
 	friend class TextureController;
+	friend class QuadBuffer;
 	friend class private_video::ParticleSystem;
 
 public:
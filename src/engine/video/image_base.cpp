@@ -17,6 +17,7 @@
 #include <math.h>
 
 #include "image_base.h"
+#include "pixel_kernels.h"
 #include "video.h"
 
 using namespace std;
@@ -70,13 +71,21 @@ bool ImageMemory::LoadImage(const string& filename) {
 
 	// NOTE: We could technically try uppercase forms of the file extension, or also include the .jpeg extension name,
 	// but Allacrost's file standard states that only the .png and .jpg image file extensions are suppported.
-	if (extension == ".png")
-		return _LoadPngImage(filename);
-	else if (extension == ".jpg")
-		return _LoadJpgImage(filename);
+	if (extension != ".png" && extension != ".jpg") {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "unsupported file extension: \"" << extension << "\" for filename: " << filename << endl;
+		return false;
+	}
+
+	// Images that were decoded previously can be read back from the image cache without decoding them again
+	ImageCache* cache = (TextureManager != nullptr) ? &TextureManager->_image_cache : nullptr;
+	if (cache != nullptr && cache->Load(filename, *this) == true)
+		return true;
 
-	IF_PRINT_WARNING(VIDEO_DEBUG) << "unsupported file extension: \"" << extension << "\" for filename: " << filename << endl;
-	return false;
+	bool success = (extension == ".png") ? _LoadPngImage(filename) : _LoadJpgImage(filename);
+	if (success == true && cache != nullptr)
+		cache->Store(filename, *this);
+
+	return success;
 }
 
 
@@ -111,17 +120,11 @@ void ImageMemory::ConvertToGrayscale() {
 		return;
 	}
 
-	uint8 format_bytes = (rgb_format ? 3 : 4);
-	uint8* end_position = static_cast<uint8*>(pixels) + (width * height * format_bytes);
-
-	for (uint8* i = static_cast<uint8*>(pixels); i < end_position; i += format_bytes) {
-		// Compute the grayscale value for this pixel based on RGB values: 0.30R + 0.59G + 0.11B
-		uint8 value = static_cast<uint8>((30 * *(i) + 59 * *(i + 1) + 11 * *(i + 2)) * 0.01f);
-		*i = value;
-		*(i + 1) = value;
-		*(i + 2) = value;
-		// *(i + 3) for RGBA is the alpha value and is left unmodified
-	}
+	// The grayscale value of each pixel is computed from its RGB values: 0.30R + 0.59G + 0.11B
+	if (rgb_format == true)
+		GetPixelKernels().grayscale_rgb(static_cast<uint8*>(pixels), width * height);
+	else
+		GetPixelKernels().grayscale_rgba(static_cast<uint8*>(pixels), width * height);
 }
 
 
@@ -141,15 +144,7 @@ void ImageMemory::RGBAToRGB() {
 		return;
 	}
 
-	uint8* pixel_index = static_cast<uint8*>(pixels);
-	uint8* pixel_source = pixel_index;
-
-	for (int32 i = 0; i < height * width; i++, pixel_index += 4) {
-		int32 index = 3 * i;
-		pixel_source[index] = *pixel_index;
-		pixel_source[index + 1] = *(pixel_index + 1);
-		pixel_source[index + 2] = *(pixel_index + 2);
-	}
+	GetPixelKernels().rgba_to_rgb(static_cast<uint8*>(pixels), static_cast<uint8*>(pixels), width * height);
 
 	// Reduce the memory consumed by 1/4 since we no longer need to contain alpha data
 	void* new_pixels = realloc(pixels, width * height * 3);
@@ -277,6 +272,7 @@ bool ImageMemory::_LoadPngImage(const string& filename) {
 	// this is mostly just byteswapping and adding extra data - we want everything in four channels
 	// for the moment, anyway
 	uint32 bpp = png_get_channels(png_ptr, info_ptr);
+	const PixelKernels& kernels = GetPixelKernels();
 	uint8* img_pixel = nullptr;
 	uint8* dst_pixel = nullptr;
 
@@ -301,51 +297,22 @@ bool ImageMemory::_LoadPngImage(const string& filename) {
 	}
 	else if (bpp == 1) {
 		for (uint32 y = 0; y < static_cast<uint32>(height); y++) {
-			for (uint32 x = 0; x < static_cast<uint32>(width); x++) {
-				img_pixel = row_pointers[y] + (x * bpp);
-				dst_pixel = ((uint8*)pixels) + ((y * width) + x) * 4;
-				dst_pixel[0] = img_pixel[0];
-				dst_pixel[1] = img_pixel[0];
-				dst_pixel[2] = img_pixel[0];
-				dst_pixel[3] = 0xFF;
-			}
+			kernels.grey_to_rgba(row_pointers[y], ((uint8*)pixels) + (y * width * 4), width);
 		}
 	}
 	else if (bpp == 3) {
 		for (uint32 y = 0; y < static_cast<uint32>(height); y++) {
-			for (uint32 x = 0; x < static_cast<uint32>(width); x++) {
-				img_pixel = row_pointers[y] + (x * bpp);
-				dst_pixel = ((uint8*)pixels) + ((y * width) + x) * 4;
-				dst_pixel[0] = img_pixel[0];
-				dst_pixel[1] = img_pixel[1];
-				dst_pixel[2] = img_pixel[2];
-				dst_pixel[3] = 0xFF;
-			}
+			kernels.rgb_to_rgba(row_pointers[y], ((uint8*)pixels) + (y * width * 4), width);
 		}
 	}
 	else if (bpp == 4) {
+		// When a pixel is fully transparent and the texture smoothing option is enabled in the video engine,
+		// this causes OpenGL to use GL_LINEAR, which performs a linear average between pixels. Unfortunately,
+		// this results in a white outline to be seen when moving between transparent and non-transparent pixels
+		// in an image. To eliminate this unwanted artifact, we set the RGB values for all transparent pixels to
+		// 0 (black).
 		for (uint32 y = 0; y < static_cast<uint32>(height); y++) {
-			for (uint32 x = 0; x < static_cast<uint32>(width); x++) {
-				img_pixel = row_pointers[y] + (x * bpp);
-				dst_pixel = ((uint8*)pixels) + ((y * width) + x) * 4;
-				// When a pixel is fully transparent and the texture smoothing option is enabled in the video engine,
-				// this causes OpenGL to use GL_LINEAR, which performs a linear average between pixels. Unfortunately,
-				// this results in a white outline to be seen when moving between transparent and non-transparent pixels
-				// in an image. To eliminate this unwanted artifact, we set the RGB values for all transparent pixels to
-				// 0 (black).
-				if (img_pixel[3] == 0) {
-					dst_pixel[0] = 0;
-					dst_pixel[1] = 0;
-					dst_pixel[2] = 0;
-					dst_pixel[3] = img_pixel[3];
-				}
-				else {
-					dst_pixel[0] = img_pixel[0];
-					dst_pixel[1] = img_pixel[1];
-					dst_pixel[2] = img_pixel[2];
-					dst_pixel[3] = img_pixel[3];
-				}
-			}
+			kernels.clear_transparent_rgba(row_pointers[y], ((uint8*)pixels) + (y * width * 4), width);
 		}
 	}
 	else {
@@ -400,35 +367,17 @@ bool ImageMemory::_LoadJpgImage(const string& filename) {
 
 	// swizzle everything so it's in the format we want
 	uint32 bpp = cinfo.output_components;
-	uint8* img_pixel = nullptr;
-	uint8* dst_pixel = nullptr;
 
 	if (bpp == 3) {
 		for (uint32 y = 0; y < cinfo.output_height; y++) {
 			jpeg_read_scanlines(&cinfo, buffer, 1);
-
-			for(uint32 x = 0; x < cinfo.output_width; x++) {
-				img_pixel = buffer[0] + (x * bpp);
-				dst_pixel = ((uint8 *)pixels) + ((y * cinfo.output_width) + x) * 3;
-
-				dst_pixel[0] = img_pixel[0];
-				dst_pixel[1] = img_pixel[1];
-				dst_pixel[2] = img_pixel[2];
-			}
+			memcpy(((uint8 *)pixels) + (y * row_stride), buffer[0], row_stride);
 		}
 	}
 	else if (bpp == 4) {
 		for (uint32 y = 0; y < cinfo.output_height; y++) {
 			jpeg_read_scanlines(&cinfo, buffer, 1);
-
-			for (uint32 x = 0; x < cinfo.output_width; x++) {
-				img_pixel = buffer[0] + (x * bpp);
-				dst_pixel = ((uint8 *)pixels) + ((y * cinfo.output_width) + x) * 3;
-
-				dst_pixel[0] = img_pixel[0];
-				dst_pixel[1] = img_pixel[1];
-				dst_pixel[2] = img_pixel[2];
-			}
+			GetPixelKernels().rgba_to_rgb(buffer[0], ((uint8 *)pixels) + (y * cinfo.output_width * 3), cinfo.output_width);
 		}
 	}
 	else {
@@ -0,0 +1,344 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    image_cache.cpp
+*** \author  agent
+*** \brief   Source file for the decoded image disk cache
+*** ***************************************************************************/
+
+#ifdef _WIN32
+	#include <direct.h>
+#else
+	#include <dirent.h>
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+#include "image_cache.h"
+#include "image_base.h"
+#include "video.h"
+
+using namespace std;
+using namespace hoa_utils;
+
+namespace hoa_video {
+
+namespace private_video {
+
+//! \brief Images in this directory are temporary copies of textures and are never cached
+static const string TEMP_IMAGE_DIRECTORY = "img/temp/";
+
+//! \brief Used to sort cache files from the oldest to the most recently modified
+static bool _CompareFileTimes(const pair<uint64_t, pair<string, uint64_t> >& a, const pair<uint64_t, pair<string, uint64_t> >& b) {
+	return a.first < b.first;
+}
+
+
+
+ImageCache::ImageCache() :
+	_size_limit(0),
+	_cache_size(0),
+	_hit_count(0),
+	_miss_count(0),
+	_write_count(0),
+	_lock(nullptr)
+{
+	_lock = SDL_CreateMutex();
+}
+
+
+
+ImageCache::~ImageCache() {
+	IF_PRINT_DEBUG(VIDEO_DEBUG) << "image cache hits: " << _hit_count << ", misses: " << _miss_count << ", size: " << _cache_size << " bytes" << endl;
+
+	if (_lock != nullptr)
+		SDL_DestroyMutex(_lock);
+}
+
+
+
+bool ImageCache::Initialize(const string& directory, uint64_t size_limit) {
+	_size_limit = 0;
+	if (size_limit == 0 || _lock == nullptr)
+		return true;
+
+	if (MakeDirectory(directory) == false) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to create the image cache directory, images will not be cached: " << directory << endl;
+		return false;
+	}
+
+	_directory = directory;
+	_size_limit = size_limit;
+
+	// Find every existing cache file and order them by the time they were last written
+	vector<string> filenames;
+#ifdef _WIN32
+	WIN32_FIND_DATAA file_data;
+	HANDLE search = FindFirstFileA((_directory + "*").c_str(), &file_data);
+	if (search != INVALID_HANDLE_VALUE) {
+		do {
+			filenames.push_back(file_data.cFileName);
+		} while (FindNextFileA(search, &file_data) != 0);
+		FindClose(search);
+	}
+#else
+	DIR* dir = opendir(_directory.c_str());
+	if (dir != nullptr) {
+		struct dirent* entry;
+		while ((entry = readdir(dir)) != nullptr) {
+			filenames.push_back(entry->d_name);
+		}
+		closedir(dir);
+	}
+#endif
+
+	vector<pair<uint64_t, pair<string, uint64_t> > > files;
+	for (uint32 i = 0; i < filenames.size(); i++) {
+		const string& name = filenames[i];
+		if (name == "." || name == "..")
+			continue;
+
+		string cache_filename = _directory + name;
+		// Temporary files are left behind if the game exits while a file is being written
+		if (name.length() <= IMAGE_CACHE_EXTENSION.length() ||
+			name.compare(name.length() - IMAGE_CACHE_EXTENSION.length(), IMAGE_CACHE_EXTENSION.length(), IMAGE_CACHE_EXTENSION) != 0)
+		{
+			remove(cache_filename.c_str());
+			continue;
+		}
+
+		uint64_t size = 0;
+		uint64_t modify_time = 0;
+		if (GetFileStatus(cache_filename, size, modify_time) == true)
+			files.push_back(make_pair(modify_time, make_pair(cache_filename, size)));
+	}
+	sort(files.begin(), files.end(), _CompareFileTimes);
+
+	SDL_LockMutex(_lock);
+	_files.clear();
+	_cache_size = 0;
+	for (uint32 i = 0; i < files.size(); i++) {
+		_files.push_back(files[i].second);
+		_cache_size += files[i].second.second;
+	}
+	_EnforceSizeLimit();
+	SDL_UnlockMutex(_lock);
+
+	return true;
+} // bool ImageCache::Initialize(const string& directory, uint64_t size_limit)
+
+
+
+bool ImageCache::Load(const string& filename, ImageMemory& image) {
+	if (IsEnabled() == false || _IsCacheable(filename) == false)
+		return false;
+
+	uint64_t source_size = 0;
+	uint64_t source_time = 0;
+	if (GetFileStatus(filename, source_size, source_time) == false)
+		return false;
+
+	string cache_filename = _MakeCacheFilename(filename);
+	const uint8* data = nullptr;
+	size_t size = 0;
+
+#ifndef _WIN32
+	int file_descriptor = open(cache_filename.c_str(), O_RDONLY);
+	if (file_descriptor >= 0) {
+		struct stat file_status;
+		if (fstat(file_descriptor, &file_status) == 0 && file_status.st_size >= static_cast<off_t>(sizeof(ImageCacheHeader))) {
+			size = static_cast<size_t>(file_status.st_size);
+			void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+			if (mapping != MAP_FAILED)
+				data = static_cast<const uint8*>(mapping);
+		}
+		close(file_descriptor);
+	}
+#else
+	vector<uint8> buffer;
+	ifstream file(cache_filename.c_str(), ios::in | ios::binary);
+	if (file.good() == true) {
+		file.seekg(0, ios::end);
+		size = static_cast<size_t>(file.tellg());
+		file.seekg(0, ios::beg);
+		if (size >= sizeof(ImageCacheHeader)) {
+			buffer.resize(size);
+			if (file.read(reinterpret_cast<char*>(&buffer[0]), size).good() == true)
+				data = &buffer[0];
+		}
+	}
+#endif
+
+	bool valid = false;
+	if (data != nullptr) {
+		const ImageCacheHeader* header = reinterpret_cast<const ImageCacheHeader*>(data);
+		size_t pixel_size = static_cast<size_t>(header->width) * header->height * (header->rgb_format ? 3 : 4);
+		valid = (memcmp(header->magic, IMAGE_CACHE_MAGIC, sizeof(header->magic)) == 0
+			&& header->version == IMAGE_CACHE_VERSION && header->byte_order == IMAGE_CACHE_BYTE_ORDER
+			&& header->source_size == source_size && header->source_time == source_time
+			&& header->filename_length == filename.length()
+			&& size == sizeof(ImageCacheHeader) + header->filename_length + pixel_size
+			&& memcmp(data + sizeof(ImageCacheHeader), filename.data(), filename.length()) == 0);
+
+		// The pixels are copied out of the file because ImageMemory owns and frees its pixel buffer
+		if (valid == true) {
+			image.pixels = malloc(pixel_size);
+			if (image.pixels != nullptr) {
+				memcpy(image.pixels, data + sizeof(ImageCacheHeader) + header->filename_length, pixel_size);
+				image.width = header->width;
+				image.height = header->height;
+				image.rgb_format = (header->rgb_format != 0);
+			}
+			else {
+				valid = false;
+			}
+		}
+
+#ifndef _WIN32
+		munmap(const_cast<uint8*>(data), size);
+#endif
+	}
+
+	SDL_LockMutex(_lock);
+	if (valid == true) {
+		_hit_count++;
+		_AddFile(cache_filename, size);
+	}
+	else {
+		_miss_count++;
+	}
+	SDL_UnlockMutex(_lock);
+
+	return valid;
+} // bool ImageCache::Load(const string& filename, ImageMemory& image)
+
+
+
+void ImageCache::Store(const string& filename, const ImageMemory& image) {
+	if (IsEnabled() == false || _IsCacheable(filename) == false || image.pixels == nullptr)
+		return;
+
+	ImageCacheHeader header;
+	memcpy(header.magic, IMAGE_CACHE_MAGIC, sizeof(header.magic));
+	header.version = IMAGE_CACHE_VERSION;
+	header.byte_order = IMAGE_CACHE_BYTE_ORDER;
+	if (GetFileStatus(filename, header.source_size, header.source_time) == false)
+		return;
+	header.width = image.width;
+	header.height = image.height;
+	header.rgb_format = image.rgb_format ? 1 : 0;
+	header.filename_length = filename.length();
+
+	size_t pixel_size = static_cast<size_t>(image.width) * image.height * (image.rgb_format ? 3 : 4);
+	uint64_t file_size = sizeof(ImageCacheHeader) + filename.length() + pixel_size;
+
+	// Images that would take up most of the cache by themselves are not worth caching
+	if (file_size > _size_limit / 4)
+		return;
+
+	string cache_filename = _MakeCacheFilename(filename);
+	SDL_LockMutex(_lock);
+	string temp_filename = cache_filename + ".tmp" + NumberToString(_write_count++);
+	SDL_UnlockMutex(_lock);
+
+	// The file is written under a temporary name and then renamed, so that a partially written file is never read
+	ofstream file(temp_filename.c_str(), ios::out | ios::binary | ios::trunc);
+	if (file.is_open() == false) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to open image cache file for writing: " << temp_filename << endl;
+		return;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(filename.data(), filename.length());
+	file.write(static_cast<const char*>(image.pixels), pixel_size);
+	file.close();
+
+	if (file.fail() == true || MoveFile(temp_filename, cache_filename) == false) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to write image cache file: " << cache_filename << endl;
+		remove(temp_filename.c_str());
+		return;
+	}
+
+	SDL_LockMutex(_lock);
+	_AddFile(cache_filename, file_size);
+	_EnforceSizeLimit();
+	SDL_UnlockMutex(_lock);
+} // void ImageCache::Store(const string& filename, const ImageMemory& image)
+
+
+
+uint64_t ImageCache::GetCacheSize() {
+	SDL_LockMutex(_lock);
+	uint64_t size = _cache_size;
+	SDL_UnlockMutex(_lock);
+	return size;
+}
+
+
+
+void ImageCache::GetStatistics(uint32& hit_count, uint32& miss_count) {
+	SDL_LockMutex(_lock);
+	hit_count = _hit_count;
+	miss_count = _miss_count;
+	SDL_UnlockMutex(_lock);
+}
+
+
+
+bool ImageCache::_IsCacheable(const string& filename) const {
+	return (filename.compare(0, TEMP_IMAGE_DIRECTORY.length(), TEMP_IMAGE_DIRECTORY) != 0);
+}
+
+
+
+string ImageCache::_MakeCacheFilename(const string& filename) const {
+	// 64-bit FNV-1a hash of the filename
+	uint64_t hash = 14695981039346656037ULL;
+	for (uint32 i = 0; i < filename.length(); i++) {
+		hash ^= static_cast<uint8>(filename[i]);
+		hash *= 1099511628211ULL;
+	}
+
+	char name[17];
+	snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+	return _directory + name + IMAGE_CACHE_EXTENSION;
+}
+
+
+
+void ImageCache::_AddFile(const string& cache_filename, uint64_t size) {
+	for (list<pair<string, uint64_t> >::iterator i = _files.begin(); i != _files.end(); i++) {
+		if (i->first == cache_filename) {
+			_cache_size -= i->second;
+			_files.erase(i);
+			break;
+		}
+	}
+
+	_files.push_back(make_pair(cache_filename, size));
+	_cache_size += size;
+}
+
+
+
+void ImageCache::_EnforceSizeLimit() {
+	while (_cache_size > _size_limit && _files.empty() == false) {
+		remove(_files.front().first.c_str());
+		_cache_size -= _files.front().second;
+		_files.pop_front();
+	}
+}
+
+} // namespace private_video
+
+} // namespace hoa_video
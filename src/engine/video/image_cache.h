@@ -0,0 +1,171 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    image_cache.h
+*** \author  agent
+*** \brief   Header file for the decoded image disk cache
+***
+*** Decoding PNG and JPG images and converting their pixels to the format used
+*** by the video engine makes up a large part of the time spent starting the
+*** game and reloading textures after the video settings change. The image
+*** cache stores the pixel data of every decoded image in the user data
+*** directory, so that the next time the image is loaded its pixels can simply
+*** be read back from the cache.
+***
+*** Each cached image is stored in its own file, named after a hash of the
+*** image filename. The file begins with a header (ImageCacheHeader), followed by
+*** the image filename and the pixel data exactly as ImageMemory holds it.
+*** ***************************************************************************/
+
+#pragma once
+
+#include <SDL2/SDL_mutex.h>
+
+#include "defs.h"
+#include "utils.h"
+
+namespace hoa_video {
+
+namespace private_video {
+
+//! \brief The default maximum size, in bytes, of all files in the image cache
+const uint64_t DEFAULT_IMAGE_CACHE_SIZE = 128 * 1024 * 1024;
+
+//! \brief The four characters that every image cache file begins with
+const char IMAGE_CACHE_MAGIC[4] = { 'H', 'O', 'A', 'I' };
+
+//! \brief The version of the image cache file format. This must be incremented whenever the layout of the format changes
+const uint32 IMAGE_CACHE_VERSION = 1;
+
+//! \brief Written to every header in native byte order so that files written on a machine of different endianness are rejected
+const uint32 IMAGE_CACHE_BYTE_ORDER = 0x01020304;
+
+//! \brief The filename extension given to image cache files
+const std::string IMAGE_CACHE_EXTENSION = ".img";
+
+//! \brief The header found at the beginning of every image cache file
+class ImageCacheHeader {
+public:
+	char magic[4];
+	uint32 version;
+	uint32 byte_order;
+
+	//! \brief The size and last modification time of the image file when it was cached
+	uint64_t source_size, source_time;
+
+	//! \brief The dimensions of the image, in pixels
+	uint32 width, height;
+
+	//! \brief Non-zero if the pixel data is in RGB format, zero if it is in RGBA format
+	uint32 rgb_format;
+
+	//! \brief The number of characters in the image filename that follows the header
+	uint32 filename_length;
+}; // class ImageCacheHeader
+
+
+/** ****************************************************************************
+*** \brief Stores the pixel data of decoded images on disk
+***
+*** A cached image is only used when the size and modification time of its image
+*** file are the same as when it was cached. Otherwise the image is decoded again
+*** and the cache file is replaced.
+***
+*** The total size of all cache files is limited. When the limit is exceeded, the
+*** least recently used files are deleted until the cache is within the limit
+*** again. Files are considered in the order of their modification time when the
+*** cache is initialized.
+***
+*** \note The methods of this class may be called from any thread, since images
+*** are also decoded by background loading threads.
+*** ***************************************************************************/
+class ImageCache {
+public:
+	ImageCache();
+
+	~ImageCache();
+
+	/** \brief Prepares the cache for use
+	*** \param directory The directory to store the cache files in, ending with a path separator
+	*** \param size_limit The maximum size, in bytes, of all cache files. Zero disables the cache.
+	*** \return False if the directory could not be created, in which case the cache remains disabled
+	**/
+	bool Initialize(const std::string& directory, uint64_t size_limit);
+
+	bool IsEnabled() const
+		{ return _size_limit > 0; }
+
+	/** \brief Reads the pixel data of an image from the cache
+	*** \param filename The filename of the image
+	*** \param image The object to store the image data in. Its pixels member must be nullptr.
+	*** \return True if the image was found in the cache and is up to date with its image file
+	**/
+	bool Load(const std::string& filename, ImageMemory& image);
+
+	/** \brief Writes the pixel data of a decoded image to the cache
+	*** \param filename The filename that the image was decoded from
+	*** \param image The decoded image data
+	**/
+	void Store(const std::string& filename, const ImageMemory& image);
+
+	//! \name Class Member Accessor Methods
+	//@{
+	uint64_t GetSizeLimit() const
+		{ return _size_limit; }
+
+	//! \brief Returns the size, in bytes, of all files in the cache
+	uint64_t GetCacheSize();
+
+	//! \brief Returns the number of images that were and were not found in the cache
+	void GetStatistics(uint32& hit_count, uint32& miss_count);
+	//@}
+
+private:
+	//! \brief The directory that the cache files are stored in
+	std::string _directory;
+
+	//! \brief The maximum size, in bytes, of all cache files
+	uint64_t _size_limit;
+
+	//! \brief The size, in bytes, of all cache files
+	uint64_t _cache_size;
+
+	//! \brief The name and size of every cache file, from least to most recently used
+	std::list<std::pair<std::string, uint64_t> > _files;
+
+	//! \brief The number of images that were and were not found in the cache
+	uint32 _hit_count, _miss_count;
+
+	//! \brief Incremented for every file written so that threads writing at the same time use different temporary files
+	uint32 _write_count;
+
+	//! \brief Guards every member above from being modified by more than one thread at a time
+	SDL_mutex* _lock;
+
+	//! \brief Returns true if images with the given filename may be cached
+	bool _IsCacheable(const std::string& filename) const;
+
+	//! \brief Returns the name of the cache file that holds an image
+	std::string _MakeCacheFilename(const std::string& filename) const;
+
+	/** \brief Adds a cache file to the end of the least recently used list, replacing any previous entry for the file
+	*** \param cache_filename The name of the cache file
+	*** \param size The size of the file, in bytes
+	*** \note The lock must be held when this is called
+	**/
+	void _AddFile(const std::string& cache_filename, uint64_t size);
+
+	//! \brief Deletes the least recently used files until the cache is within its size limit. The lock must be held when this is called.
+	void _EnforceSizeLimit();
+}; // class ImageCache
+
+} // namespace private_video
+
+} // namespace hoa_video
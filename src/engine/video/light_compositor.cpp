@@ -0,0 +1,299 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    light_compositor.cpp
+*** \author  agent
+*** \brief   Source file for the LightCompositor class
+*** ***************************************************************************/
+
+#include <cstdio>
+
+#include "light_compositor.h"
+#include "video.h"
+
+using namespace std;
+using namespace hoa_utils;
+
+namespace hoa_video {
+
+namespace private_video {
+
+// The OpenGL 1.1 headers of some platforms do not define these
+static const GLenum LIGHT_GL_FRAMEBUFFER = 0x8D40;
+static const GLenum LIGHT_GL_FRAMEBUFFER_BINDING = 0x8CA6;
+static const GLenum LIGHT_GL_COLOR_ATTACHMENT0 = 0x8CE0;
+static const GLenum LIGHT_GL_FRAMEBUFFER_COMPLETE = 0x8CD5;
+
+LightCompositor::LightCompositor() :
+	_num_lights(0),
+	_num_composited_lights(0),
+	_available(-1),
+	_framebuffer(0),
+	_light_map(INVALID_TEXTURE_ID),
+	_light_map_width(0),
+	_light_map_height(0),
+	_light_texture(INVALID_TEXTURE_ID),
+	_GenFramebuffers(nullptr),
+	_DeleteFramebuffers(nullptr),
+	_BindFramebuffer(nullptr),
+	_FramebufferTexture2D(nullptr),
+	_CheckFramebufferStatus(nullptr)
+{}
+
+
+
+void LightCompositor::AddLight(float x, float y, float x_radius, float y_radius, const Color& color) {
+	if (x + x_radius < 0.0f || x - x_radius > 1.0f || y + y_radius < 0.0f || y - y_radius > 1.0f)
+		return;
+
+	if (_num_lights * 8 >= _vertices.size()) {
+		_vertices.resize(_vertices.size() + 64 * 8);
+		_tex_coords.resize(_tex_coords.size() + 64 * 8);
+		_colors.resize(_colors.size() + 64 * 4);
+	}
+
+	float* vertices = &_vertices[_num_lights * 8];
+	vertices[0] = x - x_radius; vertices[1] = y - y_radius;
+	vertices[2] = x + x_radius; vertices[3] = y - y_radius;
+	vertices[4] = x + x_radius; vertices[5] = y + y_radius;
+	vertices[6] = x - x_radius; vertices[7] = y + y_radius;
+
+	float* tex_coords = &_tex_coords[_num_lights * 8];
+	tex_coords[0] = 0.0f; tex_coords[1] = 0.0f;
+	tex_coords[2] = 1.0f; tex_coords[3] = 0.0f;
+	tex_coords[4] = 1.0f; tex_coords[5] = 1.0f;
+	tex_coords[6] = 0.0f; tex_coords[7] = 1.0f;
+
+	// The light texture is modulated by the premultiplied color of the light
+	Color premultiplied = color * color.GetAlpha();
+	for (uint32 i = 0; i < 4; i++)
+		_colors[_num_lights * 4 + i] = premultiplied;
+
+	_num_lights++;
+}
+
+
+
+bool LightCompositor::Composite(const Color& overlay) {
+	_num_composited_lights = 0;
+	if (_available < 0)
+		_LoadFunctions();
+	if (_available == 0)
+		return false;
+
+	SpriteBatch& batch = VideoManager->_sprite_batch;
+	RenderState& state = VideoManager->_render_state;
+	const private_video::Context& context = VideoManager->_current_context;
+
+	if (_CreateObjects(context.viewport.width, context.viewport.height) == false)
+		return false;
+
+	// ---------- (1) Draw the lights into the light map
+	batch.Flush();
+
+	// The window or the offscreen framebuffer of the headless target must be bound again once the lights are drawn
+	GLint previous_framebuffer = 0;
+	glGetIntegerv(LIGHT_GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+	_BindFramebuffer(LIGHT_GL_FRAMEBUFFER, _framebuffer);
+	glViewport(0, 0, _light_map_width, _light_map_height);
+
+	GLfloat projection[16];
+	glGetFloatv(GL_PROJECTION_MATRIX, projection);
+	glMatrixMode(GL_PROJECTION);
+	glLoadIdentity();
+	glOrtho(0.0f, 1.0f, 0.0f, 1.0f, -1.0f, 1.0f);
+	glMatrixMode(GL_MODELVIEW);
+	// The sprite batch transforms the lights by the video engine's copy of the modelview matrix, so it must be changed as well
+	const float identity[16] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+	VideoManager->PushMatrix();
+	VideoManager->SetTransform(identity);
+
+	state.Disable(GL_SCISSOR_TEST);
+	state.SetColorMask(true);
+	state.SetClearColor(overlay * overlay.GetAlpha());
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	batch.SetState(_light_texture, SPRITE_BLEND_LIGHT, false);
+	batch.AddQuads(&_vertices[0], &_tex_coords[0], &_colors[0], _num_lights);
+	batch.Flush();
+
+	_BindFramebuffer(LIGHT_GL_FRAMEBUFFER, static_cast<GLuint>(previous_framebuffer));
+	glViewport(context.viewport.left, context.viewport.top, context.viewport.width, context.viewport.height);
+	glMatrixMode(GL_PROJECTION);
+	glLoadMatrixf(projection);
+	glMatrixMode(GL_MODELVIEW);
+	if (context.scissoring_enabled == true)
+		state.Enable(GL_SCISSOR_TEST);
+
+	// ---------- (2) Draw the light map over the entire coordinate system
+	const CoordSys& coordinate_system = context.coordinate_system;
+	const float vertices[] = {
+		coordinate_system.GetLeft(), coordinate_system.GetBottom(),
+		coordinate_system.GetRight(), coordinate_system.GetBottom(),
+		coordinate_system.GetRight(), coordinate_system.GetTop(),
+		coordinate_system.GetLeft(), coordinate_system.GetTop()
+	};
+	const float tex_coords[] = {
+		0.0f, 0.0f,
+		1.0f, 0.0f,
+		1.0f, 1.0f,
+		0.0f, 1.0f
+	};
+	const Color colors[] = { Color::white, Color::white, Color::white, Color::white };
+
+	batch.SetState(_light_map, SPRITE_BLEND_PREMULTIPLIED, false);
+	batch.AddQuad(vertices, tex_coords, colors);
+	VideoManager->PopMatrix();
+
+	_num_composited_lights = _num_lights;
+
+	if (VideoManager->CheckGLError() == true) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "an OpenGL error occurred: " << VideoManager->CreateGLErrorString() << endl;
+	}
+	return true;
+} // bool LightCompositor::Composite(const Color& overlay)
+
+
+
+void LightCompositor::Release() {
+	_DestroyLightMap();
+	if (_light_texture != INVALID_TEXTURE_ID) {
+		TextureManager->_DeleteTexture(_light_texture);
+		_light_texture = INVALID_TEXTURE_ID;
+	}
+
+	// The functions of a new context may differ, so they are retrieved again
+	_available = -1;
+}
+
+
+
+bool LightCompositor::_LoadFunctions() {
+	_available = 0;
+
+	const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+	int32 major = 0;
+	int32 minor = 0;
+	if (version == nullptr || sscanf(version, "%d.%d", &major, &minor) != 2) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "could not determine the OpenGL version" << endl;
+		return false;
+	}
+
+	// Framebuffer objects became core functionality in OpenGL 3.0, with the same function names as the extension
+	if (major < 3 && VideoManager->IsGLExtensionSupported("GL_ARB_framebuffer_object") == false) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "OpenGL " << version << " does not support framebuffer objects, "
+			<< "the light overlay will be drawn without lights" << endl;
+		return false;
+	}
+
+	_GenFramebuffers = reinterpret_cast<GenFramebuffersFunction>(VideoManager->GetGLFunction("glGenFramebuffers"));
+	_DeleteFramebuffers = reinterpret_cast<DeleteFramebuffersFunction>(VideoManager->GetGLFunction("glDeleteFramebuffers"));
+	_BindFramebuffer = reinterpret_cast<BindFramebufferFunction>(VideoManager->GetGLFunction("glBindFramebuffer"));
+	_FramebufferTexture2D = reinterpret_cast<FramebufferTexture2DFunction>(VideoManager->GetGLFunction("glFramebufferTexture2D"));
+	_CheckFramebufferStatus = reinterpret_cast<CheckFramebufferStatusFunction>(VideoManager->GetGLFunction("glCheckFramebufferStatus"));
+
+	if (_GenFramebuffers == nullptr || _DeleteFramebuffers == nullptr || _BindFramebuffer == nullptr ||
+		_FramebufferTexture2D == nullptr || _CheckFramebufferStatus == nullptr)
+	{
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to retrieve the framebuffer object functions, the light overlay will be drawn without lights" << endl;
+		return false;
+	}
+
+	_available = 1;
+	return true;
+} // bool LightCompositor::_LoadFunctions()
+
+
+
+bool LightCompositor::_CreateObjects(int32 width, int32 height) {
+	if (_light_texture == INVALID_TEXTURE_ID) {
+		_light_texture = TextureManager->_CreateBlankGLTexture(LIGHT_TEXTURE_SIZE, LIGHT_TEXTURE_SIZE);
+		if (_light_texture == INVALID_TEXTURE_ID) {
+			IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to create the light texture" << endl;
+			return false;
+		}
+
+		// Every channel holds the strength of the light, which falls off smoothly from the center to the edge
+		vector<uint8> pixels(LIGHT_TEXTURE_SIZE * LIGHT_TEXTURE_SIZE * 4);
+		const float half_size = LIGHT_TEXTURE_SIZE / 2.0f;
+		for (int32 y = 0; y < LIGHT_TEXTURE_SIZE; y++) {
+			for (int32 x = 0; x < LIGHT_TEXTURE_SIZE; x++) {
+				float dx = (x + 0.5f - half_size) / half_size;
+				float dy = (y + 0.5f - half_size) / half_size;
+				float falloff = 1.0f - (dx * dx + dy * dy);
+				falloff = (falloff > 0.0f) ? falloff * falloff : 0.0f;
+
+				uint8 value = static_cast<uint8>(falloff * 255.0f + 0.5f);
+				uint8* pixel = &pixels[(y * LIGHT_TEXTURE_SIZE + x) * 4];
+				pixel[0] = value;
+				pixel[1] = value;
+				pixel[2] = value;
+				pixel[3] = value;
+			}
+		}
+
+		// _CreateBlankGLTexture() leaves the new texture bound
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, LIGHT_TEXTURE_SIZE, LIGHT_TEXTURE_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+
+	// Lights are smooth, so the light map loses nothing by being far smaller than the screen
+	int32 light_map_width = static_cast<int32>(RoundUpPow2(static_cast<uint32>(max(1, width / LIGHT_MAP_DIVISOR))));
+	int32 light_map_height = static_cast<int32>(RoundUpPow2(static_cast<uint32>(max(1, height / LIGHT_MAP_DIVISOR))));
+	if (_light_map != INVALID_TEXTURE_ID && light_map_width == _light_map_width && light_map_height == _light_map_height)
+		return true;
+
+	_DestroyLightMap();
+	_light_map = TextureManager->_CreateBlankGLTexture(light_map_width, light_map_height);
+	if (_light_map == INVALID_TEXTURE_ID) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to create the light map texture" << endl;
+		return false;
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	GLint previous_framebuffer = 0;
+	glGetIntegerv(LIGHT_GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+	_GenFramebuffers(1, &_framebuffer);
+	_BindFramebuffer(LIGHT_GL_FRAMEBUFFER, _framebuffer);
+	_FramebufferTexture2D(LIGHT_GL_FRAMEBUFFER, LIGHT_GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _light_map, 0);
+	bool complete = (_CheckFramebufferStatus(LIGHT_GL_FRAMEBUFFER) == LIGHT_GL_FRAMEBUFFER_COMPLETE);
+	_BindFramebuffer(LIGHT_GL_FRAMEBUFFER, static_cast<GLuint>(previous_framebuffer));
+
+	if (complete == false) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "the light map could not be attached to a framebuffer object" << endl;
+		_DestroyLightMap();
+		return false;
+	}
+
+	_light_map_width = light_map_width;
+	_light_map_height = light_map_height;
+	return true;
+} // bool LightCompositor::_CreateObjects(int32 width, int32 height)
+
+
+
+void LightCompositor::_DestroyLightMap() {
+	if (_framebuffer != 0) {
+		_DeleteFramebuffers(1, &_framebuffer);
+		_framebuffer = 0;
+	}
+	if (_light_map != INVALID_TEXTURE_ID) {
+		TextureManager->_DeleteTexture(_light_map);
+		_light_map = INVALID_TEXTURE_ID;
+	}
+	_light_map_width = 0;
+	_light_map_height = 0;
+}
+
+} // namespace private_video
+
+} // namespace hoa_video
@@ -0,0 +1,184 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    light_compositor.h
+*** \author  agent
+*** \brief   Header file for the LightCompositor class
+***
+*** The light overlay darkens the whole screen with a single color. Lights cut
+*** holes into that darkness. Instead of drawing every light onto the screen,
+*** the lights of a frame are collected and drawn together into a light map: a
+*** small texture that holds the light overlay with the lights removed from it.
+*** The light map is then drawn over the screen once. The cost of a light is a
+*** single quad in a texture that is a fraction of the size of the screen, so a
+*** map may use dozens of lights without a noticeable effect on the frame rate.
+***
+*** The light map is drawn into through a framebuffer object, which requires
+*** OpenGL 3.0 or the ARB_framebuffer_object extension. Without them the light
+*** overlay is drawn without any lights.
+*** ***************************************************************************/
+
+#pragma once
+
+#ifdef _VS
+	#include <GL/glew.h>
+#endif
+
+// OpenGL includes
+#ifdef __APPLE__
+	#include <OpenGL/gl.h>
+#else
+	#include <GL/gl.h>
+#endif
+
+#include "defs.h"
+#include "utils.h"
+
+#include "color.h"
+
+#ifndef APIENTRY
+	#define APIENTRY
+#endif
+
+namespace hoa_video {
+
+namespace private_video {
+
+//! \brief The light map is this many times smaller than the viewport in each dimension
+const int32 LIGHT_MAP_DIVISOR = 4;
+
+//! \brief The width and height of the texture that holds the falloff of a single light, in pixels
+const int32 LIGHT_TEXTURE_SIZE = 64;
+
+/** ****************************************************************************
+*** \brief Accumulates the lights of a frame into a light map and draws it over the screen
+***
+*** The VideoEngine owns the only object of this class. VideoEngine::DrawLight()
+*** adds lights to it during the frame, and VideoEngine::DrawOverlays() draws
+*** the light map in place of the light overlay and then clears the lights.
+***
+*** The light map holds the light overlay with premultiplied alpha. It is
+*** cleared to the overlay color, and each light multiplies the light map by
+*** one minus its own color, so that a white light removes the overlay entirely
+*** at its center and a colored light removes only its share of a colored
+*** overlay. All lights are drawn with a single draw call, and the light map is
+*** drawn over the screen with another.
+***
+*** \note The textures and framebuffer object belong to the OpenGL context, so
+*** Release() must be called before the context is destroyed.
+*** ***************************************************************************/
+class LightCompositor {
+public:
+	LightCompositor();
+
+	~LightCompositor()
+		{}
+
+	/** \brief Adds a light to the current frame
+	*** \param x The x coordinate of the center of the light, where 0.0f is the left edge of the screen and 1.0f is the right edge
+	*** \param y The y coordinate of the center of the light, where 0.0f is the bottom edge of the screen and 1.0f is the top edge
+	*** \param x_radius The horizontal radius of the light, as a fraction of the width of the screen
+	*** \param y_radius The vertical radius of the light, as a fraction of the height of the screen
+	*** \param color The color of the light. Its alpha is the strength of the light at its center
+	***
+	*** Lights that lie entirely outside of the screen are ignored.
+	**/
+	void AddLight(float x, float y, float x_radius, float y_radius, const Color& color);
+
+	//! \brief Returns true if no lights have been added since the lights were last cleared
+	bool IsEmpty() const
+		{ return (_num_lights == 0); }
+
+	//! \brief Removes all of the lights that have been added
+	void ClearLights()
+		{ _num_lights = 0; }
+
+	//! \brief Returns the number of lights that were drawn by the most recent call to Composite()
+	uint32 GetNumCompositedLights() const
+		{ return _num_composited_lights; }
+
+	/** \brief Draws the lights into the light map and draws the light map over the current coordinate system
+	*** \param overlay The color of the light overlay
+	*** \return False if the light map could not be drawn, in which case the caller should draw the overlay without lights
+	***
+	*** The lights are not cleared by this call.
+	**/
+	bool Composite(const Color& overlay);
+
+	/** \brief Deletes the textures and framebuffer object and forgets the functions of the current context
+	*** This must be called before the OpenGL context is lost. The objects are created again when they are needed.
+	**/
+	void Release();
+
+private:
+	typedef void (APIENTRY *GenFramebuffersFunction)(GLsizei, GLuint*);
+	typedef void (APIENTRY *DeleteFramebuffersFunction)(GLsizei, const GLuint*);
+	typedef void (APIENTRY *BindFramebufferFunction)(GLenum, GLuint);
+	typedef void (APIENTRY *FramebufferTexture2DFunction)(GLenum, GLenum, GLenum, GLuint, GLint);
+	typedef GLenum (APIENTRY *CheckFramebufferStatusFunction)(GLenum);
+
+	//! \brief The number of lights that have been added since the lights were last cleared
+	uint32 _num_lights;
+
+	//! \brief The number of lights that were drawn by the most recent call to Composite()
+	uint32 _num_composited_lights;
+
+	/** \brief The quads of the lights that have been added, in light map coordinates
+	*** These grow to hold the largest number of lights that a frame has used and are never shrunk.
+	**/
+	//@{
+	std::vector<float> _vertices;
+	std::vector<float> _tex_coords;
+	std::vector<Color> _colors;
+	//@}
+
+	//! \brief Whether framebuffer objects are supported: 1 if they are, 0 if they are not, or -1 if this has not been determined
+	int8 _available;
+
+	//! \brief The framebuffer object that the light map is attached to, or zero if it has not been created
+	GLuint _framebuffer;
+
+	//! \brief The texture that holds the light map, or INVALID_TEXTURE_ID if it has not been created
+	GLuint _light_map;
+
+	//! \brief The size of the light map texture, in pixels
+	int32 _light_map_width, _light_map_height;
+
+	//! \brief The texture that holds the falloff of a single light, or INVALID_TEXTURE_ID if it has not been created
+	GLuint _light_texture;
+
+	//! \brief The framebuffer object functions, which are retrieved when the light map is first drawn
+	//@{
+	GenFramebuffersFunction _GenFramebuffers;
+	DeleteFramebuffersFunction _DeleteFramebuffers;
+	BindFramebufferFunction _BindFramebuffer;
+	FramebufferTexture2DFunction _FramebufferTexture2D;
+	CheckFramebufferStatusFunction _CheckFramebufferStatus;
+	//@}
+
+	/** \brief Determines if framebuffer objects are supported and retrieves their functions
+	*** \return False if they are not supported
+	**/
+	bool _LoadFunctions();
+
+	/** \brief Creates the light texture and creates the light map for the size of the viewport if needed
+	*** \param width The width of the viewport, in pixels
+	*** \param height The height of the viewport, in pixels
+	*** \return False if any of the objects could not be created
+	**/
+	bool _CreateObjects(int32 width, int32 height);
+
+	//! \brief Deletes the light map and its framebuffer object
+	void _DestroyLightMap();
+}; // class LightCompositor
+
+} // namespace private_video
+
+} // namespace hoa_video
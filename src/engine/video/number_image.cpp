@@ -0,0 +1,213 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    number_image.cpp
+*** \author  agent
+*** \brief   Source file for drawing numbers from prerendered characters
+*** ***************************************************************************/
+
+#include "video.h"
+#include "number_image.h"
+
+using namespace std;
+using namespace hoa_utils;
+using namespace hoa_video::private_video;
+
+namespace hoa_video {
+
+NumberImage::NumberImage() :
+	ImageDescriptor(),
+	_strip(nullptr),
+	_character_count(0)
+{}
+
+
+
+NumberImage::NumberImage(const TextStyle& style) :
+	ImageDescriptor(),
+	_strip(nullptr),
+	_character_count(0)
+{
+	SetStyle(style);
+}
+
+
+
+void NumberImage::Clear() {
+	_character_count = 0;
+	_width = 0.0f;
+	_height = 0.0f;
+}
+
+
+
+void NumberImage::Draw(const Color& draw_color) const {
+	// Don't draw anything if there is nothing to draw or the number is completely transparent (invisible)
+	if (_strip == nullptr || _character_count == 0 || _width <= 0.0f || IsFloatEqual(draw_color[3], 0.0f) == true) {
+		return;
+	}
+
+	VideoManager->PushMatrix();
+	// After this call the modelview is scaled so that the image spans from zero to one on both axes
+	_DrawOrientation();
+
+	float modulation = VideoManager->_screen_fader.GetFadeModulation();
+	Color fade_color = draw_color * Color(modulation, modulation, modulation, 1.0f);
+	Color vertex_colors[4];
+	for (uint32 i = 0; i < 4; i++) {
+		vertex_colors[i] = ((_unichrome_vertices == true) ? _color[0] : _color[i]) * fade_color;
+	}
+
+	SpriteBlendMode blend_mode = SPRITE_BLEND_NONE;
+	if (VideoManager->_current_context.blend) {
+		if (VideoManager->_current_context.blend == 1)
+			blend_mode = SPRITE_BLEND_NORMAL;
+		else
+			blend_mode = SPRITE_BLEND_ADDITIVE;
+	}
+	else if (_blend) {
+		blend_mode = SPRITE_BLEND_NORMAL;
+	}
+
+	SpriteBatch& batch = VideoManager->_sprite_batch;
+	int32 x_position = 0;
+	for (uint32 i = 0; i < _character_count; i++) {
+		TextTexture* texture = _strip->textures[_characters[i]];
+
+		// The character texture is missing if it could not be rendered
+		if (texture->texture_sheet != nullptr) {
+			float left = static_cast<float>(x_position) / _width;
+			float right = static_cast<float>(x_position + texture->width) / _width;
+			float vertices[] = {
+				left, 0.0f,
+				right, 0.0f,
+				right, 1.0f,
+				left, 1.0f
+			};
+
+			float tex_coords[] = {
+				texture->u1, texture->v2,
+				texture->u2, texture->v2,
+				texture->u2, texture->v1,
+				texture->u1, texture->v1
+			};
+
+			// The characters of a style are usually in the same texture sheet, so the whole number is drawn as a single batch
+			texture->texture_sheet->Smooth(texture->smooth);
+			batch.SetState(texture->texture_sheet->tex_id, blend_mode, false);
+			batch.AddQuad(vertices, tex_coords, vertex_colors);
+		}
+
+		x_position += _strip->advances[_characters[i]];
+	}
+
+	VideoManager->PopMatrix();
+} // void NumberImage::Draw(const Color& draw_color) const
+
+
+
+void NumberImage::SetStyle(const TextStyle& style) {
+	NumberStrip* strip = TextManager->_GetNumberStrip(style);
+	if (strip == nullptr) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "text style had an invalid font: " << style.font << endl;
+		return;
+	}
+
+	_style = style;
+	_strip = strip;
+	_UpdateDimensions();
+}
+
+
+
+void NumberImage::SetNumber(int32 number, bool show_sign) {
+	_character_count = 0;
+
+	if (number < 0)
+		_AddCharacter('-');
+	else if (show_sign == true && number > 0)
+		_AddCharacter('+');
+
+	// The magnitude is computed in unsigned arithmetic so that the most negative number does not overflow
+	uint32 magnitude = (number < 0) ? (0U - static_cast<uint32>(number)) : static_cast<uint32>(number);
+	_AddDigits(magnitude, 1);
+	_UpdateDimensions();
+}
+
+
+
+void NumberImage::SetTime(uint32 hours, uint32 minutes, uint32 seconds) {
+	_character_count = 0;
+	_AddDigits(hours, 2);
+	_AddCharacter(':');
+	_AddDigits(minutes, 2);
+	_AddCharacter(':');
+	_AddDigits(seconds, 2);
+	_UpdateDimensions();
+}
+
+
+
+void NumberImage::_AddDigits(uint32 number, uint32 minimum_digits) {
+	// The digits are found from the least significant to the most significant
+	uint8 digits[10];
+	uint32 digit_count = 0;
+	do {
+		digits[digit_count++] = static_cast<uint8>(number % 10);
+		number /= 10;
+	} while (number > 0);
+
+	for (uint32 i = digit_count; i < minimum_digits; i++) {
+		_AddCharacter('0');
+	}
+
+	while (digit_count > 0) {
+		_AddCharacter(static_cast<char>('0' + digits[--digit_count]));
+	}
+}
+
+
+
+void NumberImage::_AddCharacter(char character) {
+	if (_character_count >= NUMBER_IMAGE_MAX_CHARACTERS) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "exceeded the maximum number of characters: " << NUMBER_IMAGE_MAX_CHARACTERS << endl;
+		return;
+	}
+
+	size_t index = NUMBER_STRIP_CHARACTERS.find(character);
+	if (index == string::npos) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "character can not be displayed: " << character << endl;
+		return;
+	}
+
+	_characters[_character_count++] = static_cast<uint8>(index);
+}
+
+
+
+void NumberImage::_UpdateDimensions() {
+	_width = 0.0f;
+	_height = 0.0f;
+	if (_strip == nullptr || _character_count == 0)
+		return;
+
+	// The width extends to the right edge of whichever character reaches the farthest, like the width of a rendered line of text
+	int32 x_position = 0;
+	int32 width = 0;
+	for (uint32 i = 0; i < _character_count; i++) {
+		width = max(width, x_position + _strip->textures[_characters[i]]->width);
+		x_position += _strip->advances[_characters[i]];
+	}
+
+	_width = static_cast<float>(width);
+	_height = static_cast<float>(_strip->height);
+}
+
+} // namespace hoa_video
@@ -0,0 +1,176 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    number_image.h
+*** \author  agent
+*** \brief   Header file for drawing numbers from prerendered characters
+***
+*** Numbers such as hit points and damage amounts change frequently. Displaying
+*** them with a TextImage renders a new texture with SDL_ttf every time the value
+*** changes. A NumberImage instead draws each character of the number from a
+*** strip of characters that is rendered only once for each text style, so
+*** changing its value costs no more than writing a few bytes.
+*** ***************************************************************************/
+
+#pragma once
+
+#include "defs.h"
+#include "utils.h"
+
+#include "image.h"
+#include "text.h"
+
+namespace hoa_video {
+
+namespace private_video {
+
+//! \brief Every character that a NumberImage is able to display
+const std::string NUMBER_STRIP_CHARACTERS = "0123456789+-:.,%";
+
+/** ****************************************************************************
+*** \brief The prerendered characters of one text style that numbers are drawn from
+***
+*** Each character of NUMBER_STRIP_CHARACTERS is rendered to its own text texture.
+*** These textures are shared through the text texture cache of the texture
+*** controller, and the strip holds a reference to each of them so that they are
+*** never evicted. Strips are created and owned by the TextSupervisor.
+*** ***************************************************************************/
+class NumberStrip {
+public:
+	//! \brief The texture of each character, in the same order as NUMBER_STRIP_CHARACTERS
+	std::vector<TextTexture*> textures;
+
+	//! \brief The distance to advance the draw position after each character, in pixels
+	std::vector<int32> advances;
+
+	//! \brief The height of the character textures, in pixels
+	int32 height;
+}; // class NumberStrip
+
+} // namespace private_video
+
+//! \brief The maximum number of characters that a NumberImage may display
+const uint32 NUMBER_IMAGE_MAX_CHARACTERS = 16;
+
+/** ****************************************************************************
+*** \brief Represents a number drawn from prerendered characters
+***
+*** The image looks the same as a TextImage of the same number and style would.
+*** Setting a new value does not allocate any memory or render any text, so it
+*** is safe to do so every frame.
+***
+*** \note The first time that a text style is used by any NumberImage, the
+*** characters of that style are rendered. This is done when the style is set.
+*** ***************************************************************************/
+class NumberImage : public ImageDescriptor {
+public:
+	//! \brief Constructs an image that displays nothing until a style and a value are set
+	NumberImage();
+
+	//! \brief Constructs an image that displays nothing until a value is set
+	NumberImage(const TextStyle& style);
+
+	~NumberImage()
+		{}
+
+	// ---------- Public methods
+
+	//! \brief Clears the value displayed by the image
+	void Clear();
+
+	//! \brief Draws the number to the screen
+	void Draw() const
+		{ Draw(Color::white); }
+
+	/** \brief Draws the number to the screen with a color modulation
+	*** \param draw_color The color to modulate the number by
+	**/
+	void Draw(const Color& draw_color) const;
+
+	//! \brief Dervied from ImageDescriptor, this method is not used by NumberImage
+	void EnableGrayScale()
+		{}
+
+	//! \brief Dervied from ImageDescriptor, this method is not used by NumberImage
+	void DisableGrayScale()
+		{}
+
+	void SetStatic(bool is_static)
+		{ _is_static = is_static; }
+
+	//! \brief The width and height of a NumberImage are determined by its value and may not be changed
+	void SetWidth(float)
+		{}
+
+	void SetHeight(float)
+		{}
+
+	void SetDimensions(float, float)
+		{}
+
+	//! \brief Sets the color for the image (for all four verteces).
+	void SetColor(const Color &color)
+		{ _color[0] = _color[1] = _color[2] = _color[3] = color; }
+
+	/** \brief Sets the style that the number is drawn in
+	*** \param style The text style to use. Its font must already be loaded.
+	**/
+	void SetStyle(const TextStyle& style);
+
+	/** \brief Sets the number to display
+	*** \param number The value of the number
+	*** \param show_sign If true, a plus sign is displayed in front of positive numbers
+	**/
+	void SetNumber(int32 number, bool show_sign = false);
+
+	/** \brief Sets a length of time to display in the format HH:MM:SS
+	*** \param hours The number of hours, which is displayed with at least two digits
+	*** \param minutes The number of minutes, which should be less than 60
+	*** \param seconds The number of seconds, which should be less than 60
+	**/
+	void SetTime(uint32 hours, uint32 minutes, uint32 seconds);
+
+	//! \name Class Member Access Functions
+	//@{
+	const TextStyle& GetStyle() const
+		{ return _style; }
+	//@}
+
+private:
+	//! \brief The style to draw the number in
+	TextStyle _style;
+
+	//! \brief The prerendered characters of the style. This is nullptr if no valid style has been set.
+	private_video::NumberStrip* _strip;
+
+	//! \brief The characters to display, as indices into NUMBER_STRIP_CHARACTERS
+	uint8 _characters[NUMBER_IMAGE_MAX_CHARACTERS];
+
+	//! \brief The number of characters in the _characters array
+	uint32 _character_count;
+
+	// ---------- Private methods
+
+	/** \brief Adds the decimal digits of a number to the end of the displayed characters
+	*** \param number The number to add the digits of
+	*** \param minimum_digits If the number has fewer digits than this, it is padded with leading zeros
+	**/
+	void _AddDigits(uint32 number, uint32 minimum_digits);
+
+	/** \brief Adds a character to the end of the displayed characters
+	*** \param character The character to add, which must be one of NUMBER_STRIP_CHARACTERS
+	**/
+	void _AddCharacter(char character);
+
+	//! \brief Sets the width and height of the image according to the displayed characters
+	void _UpdateDimensions();
+}; // class NumberImage : public ImageDescriptor
+
+} // namespace hoa_video
@@ -12,10 +12,9 @@
  * \author  Raj Sharma (roos)
  * \brief   Header file for particle data
  *
- * This file contains structure(s) for representing a single particle. In theory,
- * we should be able to just have one structure which holds all properties for
- * a particle, but in fact we have two: one for the position, and one for everything
- * else. The reason is that having the positions separated is more efficient
+ * This file contains the structures for representing particles. The properties
+ * of all particles in a system are kept in a ParticleArrays object, while the
+ * vertex and texture coordinate structures hold the data that is fed to OpenGL
  * for rendering.
  *****************************************************************************/
 
@@ -31,6 +30,24 @@ namespace hoa_video {
 
 namespace private_video {
 
+/*!***************************************************************************
+ *  \brief when we change a property of an effect, it affects all of the
+ *         systems contained within that effect. So, this structure contains
+ *         any relevant parameters that particle systems need to know about.
+ *****************************************************************************/
+
+class EffectParameters
+{
+public:
+
+	//! orientation of the effect, called with ParticleEffect::SetOrientation()
+	float orientation;
+
+	//! attraction point, particles gravitate towards this
+	float attractor_x, attractor_y;
+};
+
+
 /*!***************************************************************************
  *  \brief this is used in the vertex array for DrawArrays(). Every time
  *         the particle system is rendered, we need to iterate through all the
@@ -49,6 +66,34 @@ public:
 };
 
 
+/*!***************************************************************************
+ *  \brief this is used in the instance array of the particle shader. Each
+ *         particle needs only one of these instead of four vertices, four
+ *         colors and four texture coordinates, and the vertex shader expands
+ *         it into the particle's quad. The texture coordinates are the same
+ *         for every particle of a system, so they are not part of the record.
+ *****************************************************************************/
+
+class ParticleInstance
+{
+public:
+
+	//! position of the center of the particle
+	float _x;
+	float _y;
+
+	//! half of the width and height of the particle's quad
+	float _half_width;
+	float _half_height;
+
+	//! the angle to rotate the quad by, in radians
+	float _angle;
+
+	//! color of the particle
+	float _color[4];
+};
+
+
 /*!***************************************************************************
  *  \brief this is used in texture coordinate array for DrawArrays()
  *         Unless animated particles are used, this can be generated just once
@@ -65,102 +110,152 @@ public:
 
 
 /*!***************************************************************************
- *  \brief this is the structure we use to represent a particle
+ *  \brief this is the structure we use to represent the particles of a system
+ *
+ *  Particles are stored as a structure of arrays: each property has an array
+ *  of its own, indexed by particle. The update kernels in particle_kernels.h
+ *  walk these arrays several particles at a time with SIMD instructions, which
+ *  would not be possible if the properties of each particle were interleaved.
+ *
+ *  Keyframed properties (size, rotation speed and color) are interpolated
+ *  between a start and an end value. Those values already include the random
+ *  variations of the current and next keyframes, so that interpolating them
+ *  is the same computation for every particle.
  *****************************************************************************/
 
-
-class Particle
+class ParticleArrays
 {
 public:
 
+	//! \brief resizes every array to hold the given number of particles
+	void Resize(uint32 count);
+
+	//! \brief copies all properties of the particle at index src to index dest
+	void Move(uint32 src, uint32 dest);
+
+	//! \brief returns the color of the particle at index i
+	Color GetColor(uint32 i) const
+		{ return Color(red[i], green[i], blue[i], alpha[i]); }
+
 	//! position
-	float  x;
-	float  y;
+	std::vector<float> x;
+	std::vector<float> y;
 
 	//! size
-	float  size_x;
-	float  size_y;
+	std::vector<float> size_x;
+	std::vector<float> size_y;
 
 	//! velocity
-	float  velocity_x;
-	float  velocity_y;
+	std::vector<float> velocity_x;
+	std::vector<float> velocity_y;
 
 	//! store the combined velocity (particle + wind + wave) so we only have
 	//! to calculate it once
-	float combined_velocity_x;
-	float combined_velocity_y;
+	std::vector<float> combined_velocity_x;
+	std::vector<float> combined_velocity_y;
 
-	//! color
-	Color  color;
+	//! color, one array per channel
+	std::vector<float> red;
+	std::vector<float> green;
+	std::vector<float> blue;
+	std::vector<float> alpha;
 
 	//! current rotation angle
-	float  rotation_angle;
+	std::vector<float> rotation_angle;
 
 	//! rotation speed
-	float  rotation_speed;
+	std::vector<float> rotation_speed;
 
 	//! seconds since particle was spawned
-	float  time;
+	std::vector<float> time;
 
 	//! lifetime (when the particle is supposed to die)
-	float  lifetime;
+	std::vector<float> lifetime;
+
+	//! one over the lifetime, so that the keyframe time of a particle can be
+	//! found without a division
+	std::vector<float> inverse_lifetime;
 
 	//! this is 2 * pi / wavelength. The reason we store this weird
 	//! number instead of the wavelength is because that's what we
 	//! will ultimately plug into the sin function
-	float wave_length_coefficient;
+	std::vector<float> wave_length_coefficient;
 
 	//! half the amplitude of the wave. We store half the amplitude
 	//! instead of the whole amplitude because that's what gets multiplied
 	//! with the sin function
-	float wave_half_amplitude;
+	std::vector<float> wave_half_amplitude;
 
 	//! acceleration, i.e. change in velocity per second. The most common use
 	//! for this is for simulating gravity. If you have multiple constant
 	//! forces acting on particles, then this vector should be the sum of
 	//! those forces.
-	float acceleration_x;
-	float acceleration_y;
+	std::vector<float> acceleration_x;
+	std::vector<float> acceleration_y;
 
 	//! tangential acceleration- just like normal acceleration, except it
 	//! is applied in the tangent direction. positive = clockwise.
-	float tangential_acceleration;
+	std::vector<float> tangential_acceleration;
 
 	//! radial acceleration- acceleration towards (negative) or away (positive)
 	//! from an attractor. Note that the default attractor is the emitter position.
 	//! The client can set an attractor for the entire effect by calling
 	//! ParticleEffect::SetAttractor(x,y)
-	float radial_acceleration;
+	std::vector<float> radial_acceleration;
 
 	//! wind velocity. this gets added to the particle's velocity each frame.
 	//! note that different particles might also have a slightly different wind
 	//! velocity, if the system has some wind velocity variation
-	float wind_velocity_x;
-	float wind_velocity_y;
+	std::vector<float> wind_velocity_x;
+	std::vector<float> wind_velocity_y;
 
 	//! damping- the particle's velocity gets multiplied by this value each second.
 	//! So for example, a damping of .6 means that a particle slows down by 40% each
 	//! second.
-	float damping;
+	std::vector<float> damping;
 
 	//! when a particle is created, it is given a rotation direction: either
 	//! 1 (clockwise) or -1 (counterclockwise)
-	float rotation_direction;
-
-	//! property variations
-	float current_size_variation_x;
-	float current_size_variation_y;
-	float next_size_variation_x;
-	float next_size_variation_y;
-	float current_rotation_speed_variation;
-	float next_rotation_speed_variation;
-	Color current_color_variation;
-	Color next_color_variation;
-
-	//! keep track of current and next keyframes
-	ParticleKeyframe *current_keyframe;
-	ParticleKeyframe *next_keyframe;
-};
+	std::vector<float> rotation_direction;
+
+	//! index of the keyframe that each particle is currently on
+	std::vector<uint32> keyframe;
+
+	//! keyframe time (0.0 to 1.0) of the current keyframe
+	std::vector<float> keyframe_start;
+
+	//! one over the keyframe time between the current and next keyframes, or
+	//! zero if the particle is on its last keyframe
+	std::vector<float> keyframe_scale;
+
+	//! keyframe time at which the particle advances to another keyframe. This is
+	//! FLT_MAX if the particle is on its last keyframe
+	std::vector<float> next_keyframe_time;
+
+	//! keyframed property values (including variations) at the current keyframe
+	std::vector<float> start_size_x;
+	std::vector<float> start_size_y;
+	std::vector<float> start_rotation_speed;
+	std::vector<float> start_red;
+	std::vector<float> start_green;
+	std::vector<float> start_blue;
+	std::vector<float> start_alpha;
+
+	//! keyframed property values (including variations) at the next keyframe
+	std::vector<float> end_size_x;
+	std::vector<float> end_size_y;
+	std::vector<float> end_rotation_speed;
+	std::vector<float> end_red;
+	std::vector<float> end_green;
+	std::vector<float> end_blue;
+	std::vector<float> end_alpha;
+
+	//! scratch arrays which hold the wave speed and damping factor of each particle
+	//! for the update in progress. These are computed with scalar code because
+	//! there are no SIMD equivalents of sinf() and powf()
+	std::vector<float> wave_speed;
+	std::vector<float> damping_factor;
+}; // class ParticleArrays
 
 }
 
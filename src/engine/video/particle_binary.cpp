@@ -0,0 +1,564 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    particle_binary.cpp
+*** \author  agent
+*** \brief   Source file for the compiled binary particle effect format
+*** ***************************************************************************/
+
+#include <algorithm>
+
+#include "script.h"
+
+#include "particle_binary.h"
+#include "particle_emitter.h"
+
+using namespace std;
+using namespace hoa_utils;
+using namespace hoa_script;
+
+namespace hoa_video {
+
+namespace private_video {
+
+//! \brief The names of the stencil operations in definition files, indexed by their VIDEO_STENCIL_OP value
+static const char* const _STENCIL_OP_NAMES[4] = { "zero", "one", "incr", "decr" };
+
+//! \brief Returns the given offset rounded up to the next multiple of four bytes
+static uint32 _AlignOffset(uint32 offset) {
+	return (offset + 3) & ~static_cast<uint32>(3);
+}
+
+//! \brief Used to sort the keyframes of a particle system by time
+static bool _KeyframeTimeLess(const ParticleBinaryKeyframe& a, const ParticleBinaryKeyframe& b) {
+	return a.time < b.time;
+}
+
+/** \brief Reads a table of four floats holding color data
+*** \param script The open definition file, with the keyframe table open
+*** \param parameter_name The name of the table to read
+*** \param color An array of four floats to store the color in, which is set to zero if the table is invalid
+**/
+static void _ReadColor(ReadScriptDescriptor& script, const string& parameter_name, float color[4]) {
+	vector<float> color_values;
+
+	script.ReadFloatVector(parameter_name, color_values);
+	if (color_values.size() < 4) {
+		PRINT_WARNING << "failed to read color " << parameter_name << " from particle definition file: " << script.GetFilename() << endl;
+		color_values.assign(4, 0.0f);
+	}
+
+	for (uint32 i = 0; i < 4; ++i)
+		color[i] = color_values[i];
+}
+
+// ****************************************************************************
+// ***** ParticleBinaryData class methods
+// ****************************************************************************
+
+bool ParticleBinaryData::ReadScript(const string& source_filename) {
+	Clear();
+
+	if (ComputeFileChecksum(source_filename, source_checksum, source_size) == false) {
+		PRINT_WARNING << "failed to read the particle definition file: " << source_filename << endl;
+		return false;
+	}
+
+	ReadScriptDescriptor script;
+	if (script.OpenFile(source_filename) == false) {
+		PRINT_WARNING << "failed to open the particle definition file: " << source_filename << endl;
+		return false;
+	}
+
+	if (script.DoesTableExist("systems") == false) {
+		PRINT_WARNING << "missing 'systems' table in particle definition file: " << source_filename << endl;
+		script.CloseFile();
+		return false;
+	}
+
+	script.OpenTable("systems");
+	uint32 number_of_systems = script.GetTableSize();
+	if (number_of_systems == 0) {
+		PRINT_WARNING << "no particle systems were defined in the particle definition file: " << source_filename << endl;
+		script.CloseAllTables();
+		script.CloseFile();
+		return false;
+	}
+
+	systems.resize(number_of_systems);
+	vector<string> frame_filenames;
+	vector<int32> frame_times;
+
+	// Read each particle system table
+	for (uint32 system_number = 0; system_number < number_of_systems; ++system_number) {
+		ParticleBinarySystem& system = systems[system_number];
+		memset(&system, 0, sizeof(system));
+
+		if (script.DoesTableExist(system_number) == false) {
+			PRINT_WARNING << "failed to read system table #" << system_number << " in particle definition file: " << source_filename << endl;
+			script.CloseAllTables();
+			script.CloseFile();
+			Clear();
+			return false;
+		}
+		script.OpenTable(system_number);
+
+		// ---------- (1) Read the emitter table
+		if (script.DoesTableExist("emitter") == false) {
+			PRINT_WARNING << "failed to read emitter table in system table #" << system_number
+				<< " in particle definition file: " << source_filename << endl;
+			script.CloseAllTables();
+			script.CloseFile();
+			Clear();
+			return false;
+		}
+		script.OpenTable("emitter");
+
+		system.x = script.ReadFloat("x");
+		system.y = script.ReadFloat("y");
+		system.x2 = script.ReadFloat("x2");
+		system.y2 = script.ReadFloat("y2");
+		system.center_x = script.ReadFloat("center_x");
+		system.center_y = script.ReadFloat("center_y");
+		system.x_variation = script.ReadFloat("x_variation");
+		system.y_variation = script.ReadFloat("y_variation");
+		system.radius = script.ReadFloat("radius");
+
+		string shape_string = script.ReadString("shape");
+		if (shape_string == "point")
+			system.shape = EMITTER_SHAPE_POINT;
+		else if (shape_string == "line")
+			system.shape = EMITTER_SHAPE_LINE;
+		else if (shape_string == "circle outline")
+			system.shape = EMITTER_SHAPE_CIRCLE;
+		else if (shape_string == "circle")
+			system.shape = EMITTER_SHAPE_FILLED_CIRCLE;
+		else if (shape_string == "rectangle")
+			system.shape = EMITTER_SHAPE_FILLED_RECTANGLE;
+		else {
+			system.shape = EMITTER_SHAPE_INVALID;
+			PRINT_WARNING << "unknown emitter shape: " << shape_string << ", when reading system table #" << system_number
+				<< " in particle definition file: " << source_filename << endl;
+		}
+
+		system.omnidirectional = script.ReadBool("omnidirectional") ? 1 : 0;
+		system.orientation = script.ReadFloat("orientation");
+		system.outer_cone = script.ReadFloat("outer_cone");
+		system.inner_cone = script.ReadFloat("inner_cone");
+		system.initial_speed = script.ReadFloat("initial_speed");
+		system.initial_speed_variation = script.ReadFloat("initial_speed_variation");
+		system.emission_rate = script.ReadFloat("emission_rate");
+		system.start_time = script.ReadFloat("start_time");
+
+		string mode_string = script.ReadString("emitter_mode");
+		if (mode_string == "looping")
+			system.emitter_mode = EMITTER_MODE_LOOPING;
+		else if (mode_string == "one shot")
+			system.emitter_mode = EMITTER_MODE_ONE_SHOT;
+		else if (mode_string == "burst")
+			system.emitter_mode = EMITTER_MODE_BURST;
+		else if (mode_string == "always")
+			system.emitter_mode = EMITTER_MODE_ALWAYS;
+		else {
+			system.emitter_mode = EMITTER_MODE_INVALID;
+			PRINT_WARNING << "unknown emitter mode: " << mode_string << ", when reading system table #" << system_number
+				<< " in particle definition file: " << source_filename << endl;
+		}
+
+		string spin_string = script.ReadString("spin");
+		if (spin_string == "random")
+			system.spin = EMITTER_SPIN_RANDOM;
+		else if (spin_string == "counterclockwise")
+			system.spin = EMITTER_SPIN_COUNTERCLOCKWISE;
+		else if (spin_string == "clockwise")
+			system.spin = EMITTER_SPIN_CLOCKWISE;
+		else {
+			system.spin = EMITTER_SPIN_INVALID;
+			PRINT_WARNING << "unknown emitter spin: " << spin_string << ", when reading system table #" << system_number
+				<< " in particle definition file: " << source_filename << endl;
+		}
+
+		script.CloseTable(); // close the emitter table
+
+		// ---------- (2) Read the keyframes table
+		if (script.DoesTableExist("keyframes") == false) {
+			PRINT_WARNING << "failed to read keyframes table in system table #" << system_number
+				<< " in particle definition file: " << source_filename << endl;
+			script.CloseAllTables();
+			script.CloseFile();
+			Clear();
+			return false;
+		}
+		script.OpenTable("keyframes");
+
+		system.first_keyframe = keyframes.size();
+		system.keyframe_count = script.GetTableSize();
+		// At least one keyframe must be present
+		if (system.keyframe_count == 0) {
+			PRINT_WARNING << "no keyframes were defined in system table #" << system_number
+				<< " in particle definition file: " << source_filename << endl;
+			script.CloseAllTables();
+			script.CloseFile();
+			Clear();
+			return false;
+		}
+
+		for (uint32 i = 0; i < system.keyframe_count; ++i) {
+			ParticleBinaryKeyframe keyframe;
+
+			// Keyframe tables are unnamed in the definition file. Unnammed Lua tables begin at index 1, not 0.
+			script.OpenTable(i + 1);
+			keyframe.size_x = script.ReadFloat("size_x");
+			keyframe.size_y = script.ReadFloat("size_y");
+			_ReadColor(script, "color", keyframe.color);
+			keyframe.rotation_speed = script.ReadFloat("rotation_speed");
+			keyframe.size_variation_x = script.ReadFloat("size_variation_x");
+			keyframe.size_variation_y = script.ReadFloat("size_variation_y");
+			_ReadColor(script, "color_variation", keyframe.color_variation);
+			keyframe.rotation_speed_variation = script.ReadFloat("rotation_speed_variation");
+			keyframe.time = script.ReadFloat("time");
+			script.CloseTable();
+
+			keyframes.push_back(keyframe);
+		}
+		script.CloseTable(); // close the keyframes table
+
+		// Particles locate their keyframe with a binary search, so the keyframes must be in time order
+		stable_sort(keyframes.begin() + system.first_keyframe, keyframes.end(), _KeyframeTimeLess);
+
+		// ---------- (3) Read the animation frames and times
+		frame_filenames.clear();
+		frame_times.clear();
+		script.ReadStringVector("animation_frames", frame_filenames);
+		// At least one animation frame must be present
+		if (frame_filenames.empty() == true) {
+			PRINT_WARNING << "failed to read animation frames in system table #" << system_number
+				<< " in particle definition file: " << source_filename << endl;
+			script.CloseAllTables();
+			script.CloseFile();
+			Clear();
+			return false;
+		}
+
+		script.ReadIntVector("animation_frame_times", frame_times);
+		// Make sure that the frames and times tables are of equal size
+		if (frame_times.size() != frame_filenames.size()) {
+			PRINT_WARNING << "animation_frames and animation_frame_times tables were of unequal size in system table #"
+				<< system_number << " in particle definition file: " << source_filename << endl;
+			script.CloseAllTables();
+			script.CloseFile();
+			Clear();
+			return false;
+		}
+
+		system.first_frame = frames.size();
+		system.frame_count = frame_filenames.size();
+		for (uint32 i = 0; i < frame_filenames.size(); ++i) {
+			// Test that each animation frame file exists
+			if (DoesFileExist(frame_filenames[i]) == false) {
+				PRINT_WARNING << "animation frame file did not exist: " << frame_filenames[i] << ", in system table #"
+					<< system_number << " in particle definition file: " << source_filename << endl;
+				script.CloseAllTables();
+				script.CloseFile();
+				Clear();
+				return false;
+			}
+
+			ParticleBinaryFrame frame;
+			frame.filename_index = find(filenames.begin(), filenames.end(), frame_filenames[i]) - filenames.begin();
+			frame.frame_time = frame_times[i];
+			if (frame.filename_index == filenames.size())
+				filenames.push_back(frame_filenames[i]);
+			frames.push_back(frame);
+		}
+
+		// ---------- (4) Read the remaining particle system data
+		system.enabled = script.ReadBool("enabled") ? 1 : 0;
+		system.blend_mode = script.ReadInt("blend_mode");
+		system.system_lifetime = script.ReadFloat("system_lifetime");
+
+		system.particle_lifetime = script.ReadFloat("particle_lifetime");
+		system.particle_lifetime_variation = script.ReadFloat("particle_lifetime_variation");
+		system.max_particles = script.ReadInt("max_particles");
+
+		system.damping = script.ReadFloat("damping");
+		system.damping_variation = script.ReadFloat("damping_variation");
+
+		system.acceleration_x = script.ReadFloat("acceleration_x");
+		system.acceleration_y = script.ReadFloat("acceleration_y");
+		system.acceleration_variation_x = script.ReadFloat("acceleration_variation_x");
+		system.acceleration_variation_y = script.ReadFloat("acceleration_variation_y");
+
+		system.wind_velocity_x = script.ReadFloat("wind_velocity_x");
+		system.wind_velocity_y = script.ReadFloat("wind_velocity_y");
+		system.wind_velocity_variation_x = script.ReadFloat("wind_velocity_variation_x");
+		system.wind_velocity_variation_y = script.ReadFloat("wind_velocity_variation_y");
+
+		system.wave_motion_used = script.ReadBool("wave_motion_used") ? 1 : 0;
+		system.wave_length = script.ReadFloat("wave_length");
+		system.wave_length_variation = script.ReadFloat("wave_length_variation");
+		system.wave_amplitude = script.ReadFloat("wave_amplitude");
+		system.wave_amplitude_variation = script.ReadFloat("wave_amplitude_variation");
+
+		system.tangential_acceleration = script.ReadFloat("tangential_acceleration");
+		system.tangential_acceleration_variation = script.ReadFloat("tangential_acceleration_variation");
+
+		system.radial_acceleration = script.ReadFloat("radial_acceleration");
+		system.radial_acceleration_variation = script.ReadFloat("radial_acceleration_variation");
+
+		system.user_defined_attractor = script.ReadBool("user_defined_attractor") ? 1 : 0;
+		system.attractor_falloff = script.ReadFloat("attractor_falloff");
+
+		system.rotation_used = script.ReadBool("rotation_used") ? 1 : 0;
+		system.rotate_to_velocity = script.ReadBool("rotate_to_velocity") ? 1 : 0;
+
+		system.speed_scale_used = script.ReadBool("speed_scale_used") ? 1 : 0;
+		system.speed_scale = script.ReadFloat("speed_scale");
+		system.min_speed_scale = script.ReadFloat("min_speed_scale");
+		system.max_speed_scale = script.ReadFloat("max_speed_scale");
+
+		system.smooth_animation = script.ReadBool("smooth_animation") ? 1 : 0;
+		system.modify_stencil = script.ReadBool("modify_stencil") ? 1 : 0;
+
+		string stencil_string = script.ReadString("stencil_op");
+		system.stencil_op = -1;
+		for (int32 i = 0; i < 4; ++i) {
+			if (stencil_string == _STENCIL_OP_NAMES[i])
+				system.stencil_op = i;
+		}
+		if (system.stencil_op == -1) {
+			PRINT_WARNING << "unknown stencil_op: " << stencil_string << ", when reading system table #" << system_number
+				<< " in particle definition file: " << source_filename << endl;
+		}
+
+		system.use_stencil = script.ReadBool("use_stencil") ? 1 : 0;
+		system.random_initial_angle = script.ReadBool("random_initial_angle") ? 1 : 0;
+
+		script.CloseTable(); // close the system_number table
+	} // for (uint32 system_number = 0; system_number < number_of_systems; ++system_number)
+
+	script.CloseAllTables();
+	script.CloseFile();
+	return true;
+} // bool ParticleBinaryData::ReadScript(const string& source_filename)
+
+
+
+bool ParticleBinaryData::ReadBinary(const string& binary_filename, const string& source_filename) {
+	Clear();
+
+	uint32 checksum = 0;
+	uint32 size = 0;
+	if (ComputeFileChecksum(source_filename, checksum, size) == false) {
+		PRINT_WARNING << "could not read the particle definition file that the binary file is compiled from: " << source_filename << endl;
+		return false;
+	}
+
+	ifstream file(binary_filename.c_str(), ios::in | ios::binary);
+	if (file.fail()) {
+		return false;
+	}
+
+	file.seekg(0, ios::end);
+	size_t file_size = static_cast<size_t>(file.tellg());
+	file.seekg(0, ios::beg);
+	if (file_size < sizeof(ParticleBinaryHeader)) {
+		PRINT_WARNING << "binary particle file was too small to be valid: " << binary_filename << endl;
+		return false;
+	}
+
+	vector<uint8> buffer(file_size);
+	file.read(reinterpret_cast<char*>(&buffer[0]), file_size);
+	if (file.fail()) {
+		PRINT_WARNING << "failed to read binary particle file: " << binary_filename << endl;
+		return false;
+	}
+
+	ParticleBinaryHeader header;
+	memcpy(&header, &buffer[0], sizeof(header));
+	if (memcmp(header.magic, PARTICLE_BINARY_MAGIC, sizeof(PARTICLE_BINARY_MAGIC)) != 0 || header.version != PARTICLE_BINARY_VERSION ||
+		header.byte_order != PARTICLE_BINARY_BYTE_ORDER || header.file_size != file_size)
+	{
+		PRINT_WARNING << "binary particle file was malformed or of an unsupported version: " << binary_filename << endl;
+		return false;
+	}
+
+	if (header.source_checksum != checksum || header.source_size != size) {
+		PRINT_WARNING << "binary particle file is out of date with its particle definition file and will not be used: " << binary_filename << endl;
+		return false;
+	}
+
+	// Every section must lie within the file and be large enough to hold the records that the header declares
+	if (header.system_offset < sizeof(ParticleBinaryHeader) ||
+		header.system_offset + static_cast<uint64_t>(header.system_count) * sizeof(ParticleBinarySystem) > header.keyframe_offset ||
+		header.keyframe_offset + static_cast<uint64_t>(header.keyframe_count) * sizeof(ParticleBinaryKeyframe) > header.frame_offset ||
+		header.frame_offset + static_cast<uint64_t>(header.frame_count) * sizeof(ParticleBinaryFrame) > header.filename_offset ||
+		header.filename_offset > file_size)
+	{
+		PRINT_WARNING << "binary particle file was malformed: " << binary_filename << endl;
+		return false;
+	}
+
+	source_checksum = header.source_checksum;
+	source_size = header.source_size;
+	systems.resize(header.system_count);
+	keyframes.resize(header.keyframe_count);
+	frames.resize(header.frame_count);
+	if (systems.empty() == false)
+		memcpy(&systems[0], &buffer[header.system_offset], systems.size() * sizeof(ParticleBinarySystem));
+	if (keyframes.empty() == false)
+		memcpy(&keyframes[0], &buffer[header.keyframe_offset], keyframes.size() * sizeof(ParticleBinaryKeyframe));
+	if (frames.empty() == false)
+		memcpy(&frames[0], &buffer[header.frame_offset], frames.size() * sizeof(ParticleBinaryFrame));
+
+	// Read in the filenames, making sure that none of them extend beyond the end of the file
+	uint32 offset = header.filename_offset;
+	for (uint32 i = 0; i < header.filename_count; ++i) {
+		uint32 length = 0;
+		if (offset + sizeof(uint32) > file_size) {
+			PRINT_WARNING << "binary particle file was malformed: " << binary_filename << endl;
+			Clear();
+			return false;
+		}
+		memcpy(&length, &buffer[offset], sizeof(uint32));
+		offset += sizeof(uint32);
+		if (offset + static_cast<uint64_t>(length) > file_size) {
+			PRINT_WARNING << "binary particle file was malformed: " << binary_filename << endl;
+			Clear();
+			return false;
+		}
+
+		filenames.push_back(string(reinterpret_cast<const char*>(&buffer[offset]), length));
+		offset = _AlignOffset(offset + length);
+	}
+
+	if (_Validate() == false) {
+		PRINT_WARNING << "binary particle file contained records that refer to missing data: " << binary_filename << endl;
+		Clear();
+		return false;
+	}
+
+	return true;
+} // bool ParticleBinaryData::ReadBinary(const string& binary_filename, const string& source_filename)
+
+
+
+bool ParticleBinaryData::WriteBinary(const string& binary_filename) const {
+	if (_Validate() == false) {
+		PRINT_ERROR << "particle data contained records that refer to missing data, the binary file was not written: " << binary_filename << endl;
+		return false;
+	}
+
+	ParticleBinaryHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, PARTICLE_BINARY_MAGIC, sizeof(PARTICLE_BINARY_MAGIC));
+	header.version = PARTICLE_BINARY_VERSION;
+	header.byte_order = PARTICLE_BINARY_BYTE_ORDER;
+	header.source_checksum = source_checksum;
+	header.source_size = source_size;
+	header.system_count = systems.size();
+	header.keyframe_count = keyframes.size();
+	header.frame_count = frames.size();
+	header.filename_count = filenames.size();
+
+	// ---------- (1) Determine the layout of the binary file
+	header.system_offset = _AlignOffset(sizeof(ParticleBinaryHeader));
+	header.keyframe_offset = header.system_offset + systems.size() * sizeof(ParticleBinarySystem);
+	header.frame_offset = header.keyframe_offset + keyframes.size() * sizeof(ParticleBinaryKeyframe);
+	header.filename_offset = header.frame_offset + frames.size() * sizeof(ParticleBinaryFrame);
+	uint32 offset = header.filename_offset;
+	for (uint32 i = 0; i < filenames.size(); ++i) {
+		offset = _AlignOffset(offset + sizeof(uint32) + filenames[i].length());
+	}
+	header.file_size = offset;
+
+	// ---------- (2) Write each section of the file
+	vector<uint8> output(header.file_size, 0);
+	memcpy(&output[0], &header, sizeof(header));
+	if (systems.empty() == false)
+		memcpy(&output[header.system_offset], &systems[0], systems.size() * sizeof(ParticleBinarySystem));
+	if (keyframes.empty() == false)
+		memcpy(&output[header.keyframe_offset], &keyframes[0], keyframes.size() * sizeof(ParticleBinaryKeyframe));
+	if (frames.empty() == false)
+		memcpy(&output[header.frame_offset], &frames[0], frames.size() * sizeof(ParticleBinaryFrame));
+	offset = header.filename_offset;
+	for (uint32 i = 0; i < filenames.size(); ++i) {
+		uint32 length = filenames[i].length();
+		memcpy(&output[offset], &length, sizeof(uint32));
+		memcpy(&output[offset + sizeof(uint32)], filenames[i].c_str(), length);
+		offset = _AlignOffset(offset + sizeof(uint32) + length);
+	}
+
+	ofstream file(binary_filename.c_str(), ios::out | ios::binary | ios::trunc);
+	if (file.fail()) {
+		PRINT_ERROR << "failed to open binary particle file for writing: " << binary_filename << endl;
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(&output[0]), output.size());
+	file.close();
+	if (file.fail()) {
+		PRINT_ERROR << "failed to write binary particle file: " << binary_filename << endl;
+		return false;
+	}
+
+	return true;
+} // bool ParticleBinaryData::WriteBinary(const string& binary_filename) const
+
+
+
+void ParticleBinaryData::Clear() {
+	source_checksum = 0;
+	source_size = 0;
+	systems.clear();
+	keyframes.clear();
+	frames.clear();
+	filenames.clear();
+}
+
+
+
+bool ParticleBinaryData::_Validate() const {
+	if (systems.empty() == true)
+		return false;
+
+	for (uint32 i = 0; i < systems.size(); ++i) {
+		const ParticleBinarySystem& system = systems[i];
+		if (system.keyframe_count == 0 || system.frame_count == 0)
+			return false;
+		if (static_cast<uint64_t>(system.first_keyframe) + system.keyframe_count > keyframes.size())
+			return false;
+		if (static_cast<uint64_t>(system.first_frame) + system.frame_count > frames.size())
+			return false;
+	}
+
+	for (uint32 i = 0; i < frames.size(); ++i) {
+		if (frames[i].filename_index >= filenames.size())
+			return false;
+	}
+
+	return true;
+}
+
+// ****************************************************************************
+// ***** Binary particle functions
+// ****************************************************************************
+
+string MakeParticleBinaryFilename(const string& source_filename) {
+	size_t extension = source_filename.rfind(".lua");
+	if (extension == string::npos || extension != source_filename.length() - 4) {
+		return source_filename + PARTICLE_BINARY_EXTENSION;
+	}
+
+	return source_filename.substr(0, extension) + PARTICLE_BINARY_EXTENSION;
+}
+
+} // namespace private_video
+
+} // namespace hoa_video
@@ -0,0 +1,248 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    particle_binary.h
+*** \author  agent
+*** \brief   Header file for the compiled binary particle effect format
+***
+*** Particle definition files (lua/graphics/particles/\*.lua) describe every
+*** system of an effect with several dozen named values, which the particle
+*** manager would otherwise have to read one at a time from the Lua interpreter
+*** whenever an effect is loaded. This code reads a definition file into a set
+*** of flat records and stores those records in a compact binary file that can
+*** be read back without executing any Lua.
+***
+*** The binary file contains the following sections, each aligned to four bytes:
+***
+*** -# The header (ParticleBinaryHeader)
+*** -# The system records (ParticleBinarySystem)
+*** -# The keyframe records of all systems, sorted by time within each system (ParticleBinaryKeyframe)
+*** -# The animation frame records of all systems (ParticleBinaryFrame)
+*** -# The animation frame filenames, each stored as a uint32 length followed by the characters
+***
+*** Animation frames refer to their image by its index in the filename section,
+*** so an image used by several systems or frames is only stored once.
+***
+*** The header records a checksum and the size of the definition file that the
+*** binary was compiled from. A binary file whose checksum no longer matches
+*** its source file is considered stale and is rejected.
+***
+*** \note This file is also compiled into the allacrost-particlec tool and
+*** therefore must not depend on any engine other than the script engine.
+*** ***************************************************************************/
+
+#pragma once
+
+#include "utils.h"
+#include "defs.h"
+
+namespace hoa_video {
+
+namespace private_video {
+
+//! \brief The four characters that every binary particle file begins with
+const char PARTICLE_BINARY_MAGIC[4] = { 'H', 'O', 'A', 'P' };
+
+//! \brief The version of the binary particle format. This must be incremented whenever the layout of the format changes
+const uint32 PARTICLE_BINARY_VERSION = 1;
+
+//! \brief Written to every header in native byte order so that files compiled on a machine of different endianness are rejected
+const uint32 PARTICLE_BINARY_BYTE_ORDER = 0x01020304;
+
+//! \brief The filename extension given to binary particle files
+const std::string PARTICLE_BINARY_EXTENSION = ".pfxc";
+
+/** ****************************************************************************
+*** \brief The header found at the beginning of every binary particle file
+***
+*** All offsets are measured in bytes from the beginning of the file.
+*** ***************************************************************************/
+class ParticleBinaryHeader {
+public:
+	char magic[4];
+	uint32 version;
+	uint32 byte_order;
+
+	//! \brief The checksum and size of the particle definition file that the binary was compiled from
+	uint32 source_checksum, source_size;
+
+	uint32 system_count;
+	uint32 keyframe_count;
+	uint32 frame_count;
+	uint32 filename_count;
+
+	//! \brief The offsets to the beginning of each section of the file
+	uint32 system_offset, keyframe_offset, frame_offset, filename_offset;
+
+	//! \brief The total size of the file, used to detect truncated files
+	uint32 file_size;
+}; // class ParticleBinaryHeader
+
+
+/** ****************************************************************************
+*** \brief The properties of a single particle system
+***
+*** The members hold the values of the entries of the same name in the system
+*** table of the definition file. Boolean values are stored as zero or one and
+*** enumerated values as the value of their enum, so that every member is four
+*** bytes in size and the record contains no padding.
+*** ***************************************************************************/
+class ParticleBinarySystem {
+public:
+	//! \name Emitter Properties
+	//@{
+	float x, y, x2, y2;
+	float center_x, center_y;
+	float x_variation, y_variation;
+	float radius;
+	//! \brief An EMITTER_SHAPE value
+	int32 shape;
+	uint32 omnidirectional;
+	float orientation;
+	float outer_cone, inner_cone;
+	float initial_speed, initial_speed_variation;
+	float emission_rate;
+	float start_time;
+	//! \brief An EMITTER_MODE value
+	int32 emitter_mode;
+	//! \brief An EMITTER_SPIN value
+	int32 spin;
+	//@}
+
+	//! \name System Properties
+	//@{
+	uint32 enabled;
+	int32 blend_mode;
+	float system_lifetime;
+	float particle_lifetime, particle_lifetime_variation;
+	int32 max_particles;
+	float damping, damping_variation;
+	float acceleration_x, acceleration_y;
+	float acceleration_variation_x, acceleration_variation_y;
+	float wind_velocity_x, wind_velocity_y;
+	float wind_velocity_variation_x, wind_velocity_variation_y;
+	uint32 wave_motion_used;
+	float wave_length, wave_length_variation;
+	float wave_amplitude, wave_amplitude_variation;
+	float tangential_acceleration, tangential_acceleration_variation;
+	float radial_acceleration, radial_acceleration_variation;
+	uint32 user_defined_attractor;
+	float attractor_falloff;
+	uint32 rotation_used;
+	uint32 rotate_to_velocity;
+	uint32 speed_scale_used;
+	float speed_scale, min_speed_scale, max_speed_scale;
+	uint32 smooth_animation;
+	uint32 modify_stencil;
+	//! \brief A VIDEO_STENCIL_OP value, or -1 if the definition file named an unknown operation
+	int32 stencil_op;
+	uint32 use_stencil;
+	uint32 random_initial_angle;
+	//@}
+
+	//! \brief The index of the first keyframe record of the system and the number of keyframes it has
+	uint32 first_keyframe, keyframe_count;
+
+	//! \brief The index of the first animation frame record of the system and the number of frames it has
+	uint32 first_frame, frame_count;
+}; // class ParticleBinarySystem
+
+
+//! \brief A single keyframe of a particle system
+class ParticleBinaryKeyframe {
+public:
+	float size_x, size_y;
+	float size_variation_x, size_variation_y;
+	float rotation_speed, rotation_speed_variation;
+	float color[4];
+	float color_variation[4];
+	float time;
+}; // class ParticleBinaryKeyframe
+
+
+//! \brief A single animation frame of a particle system
+class ParticleBinaryFrame {
+public:
+	//! \brief The index of the image filename of the frame
+	uint32 filename_index;
+
+	//! \brief The number of milliseconds that the frame is displayed for
+	int32 frame_time;
+}; // class ParticleBinaryFrame
+
+
+/** ****************************************************************************
+*** \brief The contents of a particle effect definition in the form of flat records
+***
+*** This is read from either a particle definition file or a binary particle
+*** file, and can be written to a binary particle file. The particle manager
+*** builds effect definitions from it regardless of where it was read from.
+*** ***************************************************************************/
+class ParticleBinaryData {
+public:
+	ParticleBinaryData()
+		{ Clear(); }
+
+	/** \brief Reads and validates a particle definition file
+	*** \param source_filename The name of the particle definition file
+	*** \return True if the file was read successfully and defines at least one valid system
+	***
+	*** \note The script engine must be initialized prior to calling this function.
+	**/
+	bool ReadScript(const std::string& source_filename);
+
+	/** \brief Reads and validates a binary particle file
+	*** \param binary_filename The name of the binary file to read
+	*** \param source_filename The name of the particle definition file that the binary file should have been compiled from
+	*** \return True if the file was read and is valid, false if it is missing, malformed, or stale
+	**/
+	bool ReadBinary(const std::string& binary_filename, const std::string& source_filename);
+
+	/** \brief Writes the data to a binary particle file
+	*** \param binary_filename The name of the binary file to write
+	*** \return True if the file was written successfully
+	**/
+	bool WriteBinary(const std::string& binary_filename) const;
+
+	//! \brief Removes all of the data
+	void Clear();
+
+	//! \brief The checksum and size of the particle definition file that the data was read from
+	uint32 source_checksum, source_size;
+
+	//! \brief The records of every system in the effect, in the order that they were defined
+	std::vector<ParticleBinarySystem> systems;
+
+	//! \brief The keyframe records of all systems
+	std::vector<ParticleBinaryKeyframe> keyframes;
+
+	//! \brief The animation frame records of all systems
+	std::vector<ParticleBinaryFrame> frames;
+
+	//! \brief The image filenames that the animation frames refer to, without duplicates
+	std::vector<std::string> filenames;
+
+private:
+	/** \brief Checks that the record indices of every system and frame are within range
+	*** \return True if the data is consistent
+	**/
+	bool _Validate() const;
+}; // class ParticleBinaryData
+
+
+/** \brief Returns the name of the binary particle file that corresponds to a particle definition file
+*** \param source_filename The name of the particle definition file, such as "lua/graphics/particles/snow.lua"
+*** \return The binary filename, such as "lua/graphics/particles/snow.pfxc"
+**/
+std::string MakeParticleBinaryFilename(const std::string& source_filename);
+
+} // namespace private_video
+
+} // namespace hoa_video
@@ -10,6 +10,8 @@
 #include "video.h"
 #include "script.h"
 
+#include "particle_manager.h"
+#include "particle_pool.h"
 #include "particle_effect.h"
 #include "particle_system.h"
 
@@ -21,12 +23,36 @@ namespace hoa_video
 {
 
 
+//-----------------------------------------------------------------------------
+// ParticleEffectDef
+//-----------------------------------------------------------------------------
+
+ParticleEffectDef::~ParticleEffectDef() {
+	for (list<ParticleSystemDef *>::iterator iSystem = _systems.begin(); iSystem != _systems.end(); ++iSystem)
+		delete *iSystem;
+}
+
+
 //-----------------------------------------------------------------------------
 // ParticleEffect
 //-----------------------------------------------------------------------------
 
 ParticleEffect::ParticleEffect() {
+	_Reset();
+}
+
+
+//-----------------------------------------------------------------------------
+// _Reset: returns the effect to the state of a newly constructed effect, other
+//         than keeping the memory of its system list. Called by ParticlePool
+//         when the effect is recycled.
+//-----------------------------------------------------------------------------
+
+void ParticleEffect::_Reset() {
+	_systems.clear();
 	_alive = false;
+	_stop_requested = false;
+	_num_particles = 0;
 	_x = _y = 0.0f;
 	_attractor_x = _attractor_y = 0.0f;
 	_age = 0.0f;
@@ -45,7 +71,7 @@ bool ParticleEffect::_Draw() {
 	// move to the effect's location
 	VideoManager->Move(_x, _y);
 
-	list<ParticleSystem *>::iterator iSystem = _systems.begin();
+	vector<ParticleSystem *>::iterator iSystem = _systems.begin();
 
 	while (iSystem != _systems.end()) {
 		VideoManager->PushMatrix();
@@ -60,9 +86,11 @@ bool ParticleEffect::_Draw() {
 		++iSystem;
 	}
 
-	glDisable(GL_STENCIL_TEST);
-	glDisable(GL_ALPHA_TEST);
-	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	// the systems may have left stencil testing enabled, which no other drawing expects
+	RenderState &state = VideoManager->_render_state;
+	state.Disable(GL_STENCIL_TEST);
+	state.Disable(GL_ALPHA_TEST);
+	state.SetColorMask(true);
 
 
 	return success;
@@ -70,17 +98,15 @@ bool ParticleEffect::_Draw() {
 
 
 //-----------------------------------------------------------------------------
-// Update: updates particle effect. Called by ParticleManager, not by user.
+// _PrepareUpdate: returns dead systems to the pool and adds a job to update each
+//                 of the others. Called by ParticleManager, not by user.
 //-----------------------------------------------------------------------------
 
-bool ParticleEffect::_Update(float frame_time) {
+void ParticleEffect::_PrepareUpdate(float frame_time, vector<ParticleUpdateJob> &jobs, ParticlePool &pool) {
 	_age += frame_time;
-	_num_particles = 0;
 
 	if (!_alive)
-		return true;
-
-	bool success = true;
+		return;
 
 	private_video::EffectParameters effect_parameters;
 	effect_parameters.orientation = _orientation;
@@ -90,42 +116,49 @@ bool ParticleEffect::_Update(float frame_time) {
 	effect_parameters.attractor_x = _attractor_x - _x;
 	effect_parameters.attractor_y = _attractor_y - _y;
 
-	list<ParticleSystem *>::iterator iSystem = _systems.begin();
+	vector<ParticleSystem *>::iterator iSystem = _systems.begin();
 
 	while (iSystem != _systems.end()) {
 		if (!(*iSystem)->IsAlive()) {
-			(*iSystem)->Destroy();
+			pool.ReleaseSystem(*iSystem);
 			iSystem = _systems.erase(iSystem);
 
 			if(_systems.empty())
 				_alive = false;
 		}
 		else {
-			if (!(*iSystem)->Update(frame_time, effect_parameters)) {
-				success = false;
-				if(VIDEO_DEBUG)
-					cerr << "VIDEO ERROR: failed to update system in ParticleEffect::_Update()" << endl;
-			}
-
-			_num_particles += (*iSystem)->GetNumParticles();
+			if (_stop_requested)
+				(*iSystem)->Stop();
+
+			ParticleUpdateJob job;
+			job.system = *iSystem;
+			job.parameters = effect_parameters;
+			job.frame_time = frame_time;
+			job.success = true;
+			jobs.push_back(job);
 			++iSystem;
 		}
 	}
 
-	return success;
+	_stop_requested = false;
 }
 
 
 //-----------------------------------------------------------------------------
-// Destroy: destroys the effect. Called by ParticleManager during _Update(), if
-//          this effect is not alive (i.e. IsAlive() returns false)
+// _CountParticles: recounts the particles of the effect after its systems have
+//                  been updated. Called by ParticleManager, not by user.
 //-----------------------------------------------------------------------------
 
-void ParticleEffect::_Destroy() {
-	list<ParticleSystem *>::iterator iSystem = _systems.begin();
+void ParticleEffect::_CountParticles() {
+	_num_particles = 0;
+
+	if (!_alive)
+		return;
+
+	vector<ParticleSystem *>::iterator iSystem = _systems.begin();
 
 	while (iSystem != _systems.end()) {
-		(*iSystem)->Destroy();
+		_num_particles += (*iSystem)->GetNumParticles();
 		++iSystem;
 	}
 }
@@ -198,14 +231,9 @@ void ParticleEffect::Stop(bool kill_immediate) {
 	}
 	else {
 		// if we're not killing immediately, then calling Stop() just means to stop emitting NEW
-		// particles, so go through each system and turn off its emitter
-
-		list<ParticleSystem *>::iterator iSystem = _systems.begin();
-
-		while (iSystem != _systems.end()) {
-			(*iSystem)->Stop();
-			++iSystem;
-		}
+		// particles. The systems may be updating on other threads right now, so their emitters
+		// are turned off by the next call to _PrepareUpdate()
+		_stop_requested = true;
 	}
 }
 
@@ -52,6 +52,9 @@ class ParticleEffectDef
 {
 public:
 
+	//! Deletes the system definitions
+	~ParticleEffectDef();
+
 	//! list of system definitions
 	std::list<ParticleSystemDef *> _systems;
 };
@@ -134,6 +137,9 @@ public:
 	 *                        it isn't true, then we stop the effect from emitting
 	 *                        new particles, and allow it to live until all the active
 	 *                        particles fizzle out.
+	 *
+	 *  \note the systems of the effect may be updating on worker threads when this is
+	 *        called, so they are told to stop at the beginning of the next update
 	 */
 	void Stop(bool kill_immediate = false);
 
@@ -171,19 +177,30 @@ private:
 
 
 	/*!
-	 *  \brief updates the effect. This is private so that only the ParticleManager class
-	 *         can update effects.
-	 * \param the new frame time
-	 * \return success/failure
+	 *  \brief begins an update of the effect. This is private so that only the ParticleManager
+	 *         class can update effects. Dead systems are returned to the pool, and a job to
+	 *         update each of the remaining systems is added to the list of jobs. The
+	 *         ParticleManager runs these jobs, possibly on other threads, and then calls
+	 *         _CountParticles()
+	 * \param frame_time the new frame time
+	 * \param jobs the list of jobs to add the updates of the systems to
+	 * \param pool the pool to return dead systems to
+	 */
+	void _PrepareUpdate(float frame_time, std::vector<private_video::ParticleUpdateJob> &jobs, private_video::ParticlePool &pool);
+
+
+	/*!
+	 *  \brief recounts the active particles of the effect once all of its systems have
+	 *         finished updating
 	 */
-	bool _Update(float frame_time);
+	void _CountParticles();
 
 
 	/*!
-	 *  \brief destroys the effect. This is private so that only the ParticleManager class
-	 *         can destroy effects.
+	 *  \brief resets every member to its initial value, keeping the capacity of the
+	 *         system list. This is used by the ParticlePool to recycle the effect.
 	 */
-	void _Destroy();
+	void _Reset();
 
 
 	//! pointer to the effect definition
@@ -191,7 +208,7 @@ private:
 
 	//! list of subsystems that make up the effect. (for example, a fire effect might consist
 	//! of a flame + smoke + embers)
-	std::list <ParticleSystem *> _systems;
+	std::vector <ParticleSystem *> _systems;
 
 	//! position of the effect
 	float _x, _y;
@@ -205,6 +222,9 @@ private:
 	//! is the effect is alive or not
 	bool  _alive;
 
+	//! set by Stop() so that the systems stop emitting particles at the beginning of the next update
+	bool  _stop_requested;
+
 	//! age of the effect (seconds since it was created)
 	float _age;
 
@@ -212,6 +232,7 @@ private:
 	int32 _num_particles;
 
 	friend class private_video::ParticleManager;
+	friend class private_video::ParticlePool;
 
 }; // class ParticleEffect
 
@@ -0,0 +1,522 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    particle_kernels.cpp
+*** \author  agent
+*** \brief   Source file for particle update kernels
+***
+*** SSE2 is available on every 64-bit x86 processor and NEON on every 64-bit ARM
+*** processor, so unlike the pixel kernels the instruction set is chosen when the
+*** game is compiled rather than when it is run. The vectorized loops are written
+*** against a handful of small inline functions that wrap the intrinsics of
+*** either instruction set, and perform exactly the same operations as the scalar
+*** code that handles the particles remaining after the last group of four.
+*** ***************************************************************************/
+
+#include <algorithm>
+#include <cfloat>
+
+#include "particle_kernels.h"
+#include "particle_keyframe.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define PARTICLE_KERNELS_SSE2
+	#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+	#define PARTICLE_KERNELS_NEON
+	#include <arm_neon.h>
+#endif
+
+using namespace std;
+using namespace hoa_utils;
+
+namespace hoa_video {
+
+namespace private_video {
+
+// Every float array of ParticleArrays, so that all of them can be resized or copied in the same way
+static vector<float> ParticleArrays::* const FLOAT_ARRAYS[] = {
+	&ParticleArrays::x, &ParticleArrays::y,
+	&ParticleArrays::size_x, &ParticleArrays::size_y,
+	&ParticleArrays::velocity_x, &ParticleArrays::velocity_y,
+	&ParticleArrays::combined_velocity_x, &ParticleArrays::combined_velocity_y,
+	&ParticleArrays::red, &ParticleArrays::green, &ParticleArrays::blue, &ParticleArrays::alpha,
+	&ParticleArrays::rotation_angle, &ParticleArrays::rotation_speed,
+	&ParticleArrays::time, &ParticleArrays::lifetime, &ParticleArrays::inverse_lifetime,
+	&ParticleArrays::wave_length_coefficient, &ParticleArrays::wave_half_amplitude,
+	&ParticleArrays::acceleration_x, &ParticleArrays::acceleration_y,
+	&ParticleArrays::tangential_acceleration, &ParticleArrays::radial_acceleration,
+	&ParticleArrays::wind_velocity_x, &ParticleArrays::wind_velocity_y,
+	&ParticleArrays::damping, &ParticleArrays::rotation_direction,
+	&ParticleArrays::keyframe_start, &ParticleArrays::keyframe_scale, &ParticleArrays::next_keyframe_time,
+	&ParticleArrays::start_size_x, &ParticleArrays::start_size_y, &ParticleArrays::start_rotation_speed,
+	&ParticleArrays::start_red, &ParticleArrays::start_green, &ParticleArrays::start_blue, &ParticleArrays::start_alpha,
+	&ParticleArrays::end_size_x, &ParticleArrays::end_size_y, &ParticleArrays::end_rotation_speed,
+	&ParticleArrays::end_red, &ParticleArrays::end_green, &ParticleArrays::end_blue, &ParticleArrays::end_alpha
+};
+
+// The scratch arrays are not copied when a particle is moved, since they only hold values during an update
+static vector<float> ParticleArrays::* const SCRATCH_ARRAYS[] = {
+	&ParticleArrays::wave_speed, &ParticleArrays::damping_factor
+};
+
+// -----------------------------------------------------------------------------
+// ---------- Vector Operations
+// -----------------------------------------------------------------------------
+
+#if defined(PARTICLE_KERNELS_SSE2)
+
+typedef __m128 Float4;
+
+static inline Float4 _Load(const float* source) { return _mm_loadu_ps(source); }
+static inline void _Store(float* destination, Float4 value) { _mm_storeu_ps(destination, value); }
+static inline Float4 _Set(float value) { return _mm_set1_ps(value); }
+static inline Float4 _Add(Float4 a, Float4 b) { return _mm_add_ps(a, b); }
+static inline Float4 _Subtract(Float4 a, Float4 b) { return _mm_sub_ps(a, b); }
+static inline Float4 _Multiply(Float4 a, Float4 b) { return _mm_mul_ps(a, b); }
+static inline Float4 _Divide(Float4 a, Float4 b) { return _mm_div_ps(a, b); }
+static inline Float4 _Negate(Float4 a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+static inline Float4 _SquareRoot(Float4 a) { return _mm_sqrt_ps(a); }
+static inline Float4 _Maximum(Float4 a, Float4 b) { return _mm_max_ps(a, b); }
+static inline Float4 _GreaterThan(Float4 a, Float4 b) { return _mm_cmpgt_ps(a, b); }
+static inline Float4 _NotEqual(Float4 a, Float4 b) { return _mm_cmpneq_ps(a, b); }
+// Returns the elements of a where the mask is set and the elements of b elsewhere
+static inline Float4 _Select(Float4 mask, Float4 a, Float4 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+#elif defined(PARTICLE_KERNELS_NEON)
+
+typedef float32x4_t Float4;
+
+static inline Float4 _Load(const float* source) { return vld1q_f32(source); }
+static inline void _Store(float* destination, Float4 value) { vst1q_f32(destination, value); }
+static inline Float4 _Set(float value) { return vdupq_n_f32(value); }
+static inline Float4 _Add(Float4 a, Float4 b) { return vaddq_f32(a, b); }
+static inline Float4 _Subtract(Float4 a, Float4 b) { return vsubq_f32(a, b); }
+static inline Float4 _Multiply(Float4 a, Float4 b) { return vmulq_f32(a, b); }
+static inline Float4 _Divide(Float4 a, Float4 b) { return vdivq_f32(a, b); }
+static inline Float4 _Negate(Float4 a) { return vnegq_f32(a); }
+static inline Float4 _SquareRoot(Float4 a) { return vsqrtq_f32(a); }
+// NEON's maximum propagates NaN where SSE2 returns the second operand, which only matters for particles that are already invalid
+static inline Float4 _Maximum(Float4 a, Float4 b) { return vmaxq_f32(a, b); }
+static inline Float4 _GreaterThan(Float4 a, Float4 b) { return vreinterpretq_f32_u32(vcgtq_f32(a, b)); }
+static inline Float4 _NotEqual(Float4 a, Float4 b) { return vreinterpretq_f32_u32(vmvnq_u32(vceqq_f32(a, b))); }
+static inline Float4 _Select(Float4 mask, Float4 a, Float4 b) { return vbslq_f32(vreinterpretq_u32_f32(mask), a, b); }
+
+#endif
+
+#if defined(PARTICLE_KERNELS_SSE2) || defined(PARTICLE_KERNELS_NEON)
+	#define PARTICLE_KERNELS_VECTOR
+#endif
+
+// -----------------------------------------------------------------------------
+// ---------- ParticleArrays, ParticleRandom and ParticleStep Class Methods
+// -----------------------------------------------------------------------------
+
+void ParticleArrays::Resize(uint32 count) {
+	for (uint32 i = 0; i < sizeof(FLOAT_ARRAYS) / sizeof(FLOAT_ARRAYS[0]); ++i)
+		(this->*FLOAT_ARRAYS[i]).resize(count);
+	for (uint32 i = 0; i < sizeof(SCRATCH_ARRAYS) / sizeof(SCRATCH_ARRAYS[0]); ++i)
+		(this->*SCRATCH_ARRAYS[i]).resize(count);
+	keyframe.resize(count);
+}
+
+
+
+void ParticleArrays::Move(uint32 src, uint32 dest) {
+	for (uint32 i = 0; i < sizeof(FLOAT_ARRAYS) / sizeof(FLOAT_ARRAYS[0]); ++i) {
+		vector<float>& property = this->*FLOAT_ARRAYS[i];
+		property[dest] = property[src];
+	}
+	keyframe[dest] = keyframe[src];
+}
+
+
+
+void ParticleRandom::Seed(uint32 seed) {
+	// Scramble the seed so that consecutive seeds begin very different sequences
+	seed ^= seed >> 16;
+	seed *= 0x7FEB352D;
+	seed ^= seed >> 15;
+	seed *= 0x846CA68B;
+	seed ^= seed >> 16;
+	_state = (seed != 0) ? seed : 0x9E3779B9;
+}
+
+
+
+uint32 ParticleRandom::NextInteger() {
+	// xorshift32
+	_state ^= _state << 13;
+	_state ^= _state >> 17;
+	_state ^= _state << 5;
+	return _state;
+}
+
+
+
+float ParticleRandom::NextFloat(float a, float b) {
+	if (a > b) {
+		float c = a;
+		a = b;
+		b = c;
+	}
+
+	float r = static_cast<float>(NextInteger() % 10001);
+	return a + (b - a) * r / 10000.0f;
+}
+
+
+
+ParticleStep::ParticleStep() :
+	time(0.0f),
+	wave_motion(false),
+	attractor_forces(false),
+	attractor_x(0.0f),
+	attractor_y(0.0f),
+	attractor_falloff(0.0f),
+	uniform_damping(true),
+	damping(1.0f)
+{}
+
+// -----------------------------------------------------------------------------
+// ---------- Keyframes
+// -----------------------------------------------------------------------------
+
+void SetParticleKeyframe(ParticleArrays& particles, uint32 i, uint32 keyframe, const vector<ParticleKeyframe*>& keyframes,
+	const vector<float>& keyframe_times, bool spawn, ParticleRandom& random)
+{
+	const ParticleKeyframe* current = keyframes[keyframe];
+	bool inherit = (spawn == false && keyframe == particles.keyframe[i] + 1);
+	particles.keyframe[i] = keyframe;
+
+	if (keyframe + 1 >= keyframes.size()) {
+		if (spawn == true) {
+			// A particle spawned on the only keyframe has its variations applied once and never changes
+			float rotation_speed_variation = random.NextFloat(-current->rotation_speed_variation, current->rotation_speed_variation);
+			float size_variation_x = random.NextFloat(-current->size_variation_x, current->size_variation_x);
+			float size_variation_y = random.NextFloat(-current->size_variation_y, current->size_variation_y);
+			float color_variation[4];
+			for (uint32 c = 0; c < 4; ++c)
+				color_variation[c] = random.NextFloat(-current->color_variation[c], current->color_variation[c]);
+
+			particles.start_red[i] = current->color[0] + random.NextFloat(-color_variation[0], color_variation[0]);
+			particles.start_green[i] = current->color[1] + random.NextFloat(-color_variation[1], color_variation[1]);
+			particles.start_blue[i] = current->color[2] + random.NextFloat(-color_variation[2], color_variation[2]);
+			particles.start_alpha[i] = current->color[3] + random.NextFloat(-color_variation[3], color_variation[3]);
+			particles.start_size_x[i] = current->size_x + random.NextFloat(-size_variation_x, size_variation_x);
+			particles.start_size_y[i] = current->size_y + random.NextFloat(-size_variation_y, size_variation_y);
+			particles.start_rotation_speed[i] = current->rotation_speed + random.NextFloat(-rotation_speed_variation, rotation_speed_variation);
+		}
+		else {
+			// Particles which reach the last keyframe take on its exact properties
+			particles.start_red[i] = current->color[0];
+			particles.start_green[i] = current->color[1];
+			particles.start_blue[i] = current->color[2];
+			particles.start_alpha[i] = current->color[3];
+			particles.start_size_x[i] = current->size_x;
+			particles.start_size_y[i] = current->size_y;
+			particles.start_rotation_speed[i] = current->rotation_speed;
+		}
+
+		particles.end_red[i] = particles.start_red[i];
+		particles.end_green[i] = particles.start_green[i];
+		particles.end_blue[i] = particles.start_blue[i];
+		particles.end_alpha[i] = particles.start_alpha[i];
+		particles.end_size_x[i] = particles.start_size_x[i];
+		particles.end_size_y[i] = particles.start_size_y[i];
+		particles.end_rotation_speed[i] = particles.start_rotation_speed[i];
+
+		particles.keyframe_start[i] = keyframe_times[keyframe];
+		particles.keyframe_scale[i] = 0.0f;
+		particles.next_keyframe_time[i] = FLT_MAX;
+
+		particles.red[i] = particles.start_red[i];
+		particles.green[i] = particles.start_green[i];
+		particles.blue[i] = particles.start_blue[i];
+		particles.alpha[i] = particles.start_alpha[i];
+		particles.size_x[i] = particles.start_size_x[i];
+		particles.size_y[i] = particles.start_size_y[i];
+		particles.rotation_speed[i] = particles.start_rotation_speed[i];
+		return;
+	}
+
+	// If the particle advanced to the keyframe that was its next one, it keeps the variations already chosen for it
+	if (inherit == true) {
+		particles.start_red[i] = particles.end_red[i];
+		particles.start_green[i] = particles.end_green[i];
+		particles.start_blue[i] = particles.end_blue[i];
+		particles.start_alpha[i] = particles.end_alpha[i];
+		particles.start_size_x[i] = particles.end_size_x[i];
+		particles.start_size_y[i] = particles.end_size_y[i];
+		particles.start_rotation_speed[i] = particles.end_rotation_speed[i];
+	}
+	else {
+		particles.start_red[i] = current->color[0] + random.NextFloat(-current->color_variation[0], current->color_variation[0]);
+		particles.start_green[i] = current->color[1] + random.NextFloat(-current->color_variation[1], current->color_variation[1]);
+		particles.start_blue[i] = current->color[2] + random.NextFloat(-current->color_variation[2], current->color_variation[2]);
+		particles.start_alpha[i] = current->color[3] + random.NextFloat(-current->color_variation[3], current->color_variation[3]);
+		particles.start_size_x[i] = current->size_x + random.NextFloat(-current->size_variation_x, current->size_variation_x);
+		particles.start_size_y[i] = current->size_y + random.NextFloat(-current->size_variation_y, current->size_variation_y);
+		particles.start_rotation_speed[i] = current->rotation_speed + random.NextFloat(-current->rotation_speed_variation, current->rotation_speed_variation);
+	}
+
+	const ParticleKeyframe* next = keyframes[keyframe + 1];
+	particles.end_red[i] = next->color[0] + random.NextFloat(-next->color_variation[0], next->color_variation[0]);
+	particles.end_green[i] = next->color[1] + random.NextFloat(-next->color_variation[1], next->color_variation[1]);
+	particles.end_blue[i] = next->color[2] + random.NextFloat(-next->color_variation[2], next->color_variation[2]);
+	particles.end_alpha[i] = next->color[3] + random.NextFloat(-next->color_variation[3], next->color_variation[3]);
+	particles.end_size_x[i] = next->size_x + random.NextFloat(-next->size_variation_x, next->size_variation_x);
+	particles.end_size_y[i] = next->size_y + random.NextFloat(-next->size_variation_y, next->size_variation_y);
+	particles.end_rotation_speed[i] = next->rotation_speed + random.NextFloat(-next->rotation_speed_variation, next->rotation_speed_variation);
+
+	float duration = keyframe_times[keyframe + 1] - keyframe_times[keyframe];
+	particles.keyframe_start[i] = keyframe_times[keyframe];
+	particles.keyframe_scale[i] = (duration > 0.0f) ? 1.0f / duration : 0.0f;
+	particles.next_keyframe_time[i] = keyframe_times[keyframe + 1];
+
+	// Newly spawned particles begin with the properties of the first keyframe, without any variation
+	if (spawn == true) {
+		particles.red[i] = current->color[0];
+		particles.green[i] = current->color[1];
+		particles.blue[i] = current->color[2];
+		particles.alpha[i] = current->color[3];
+		particles.size_x[i] = current->size_x;
+		particles.size_y[i] = current->size_y;
+		particles.rotation_speed[i] = current->rotation_speed;
+	}
+} // void SetParticleKeyframe(...)
+
+
+
+void AdvanceParticleKeyframes(ParticleArrays& particles, uint32 count, const vector<ParticleKeyframe*>& keyframes,
+	const vector<float>& keyframe_times, ParticleRandom& random)
+{
+	for (uint32 i = 0; i < count; ++i) {
+		float keyframe_time = particles.time[i] * particles.inverse_lifetime[i];
+		if (keyframe_time < particles.next_keyframe_time[i])
+			continue;
+
+		// The particle is on the last keyframe whose time is not greater than its own
+		uint32 keyframe = static_cast<uint32>(upper_bound(keyframe_times.begin(), keyframe_times.end(), keyframe_time) - keyframe_times.begin());
+		SetParticleKeyframe(particles, i, (keyframe > 0) ? keyframe - 1 : 0, keyframes, keyframe_times, false, random);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// ---------- Interpolation and Integration
+// -----------------------------------------------------------------------------
+
+static inline void _InterpolateParticle(ParticleArrays& p, uint32 i) {
+	float a = (p.time[i] * p.inverse_lifetime[i] - p.keyframe_start[i]) * p.keyframe_scale[i];
+
+	p.size_x[i] = p.start_size_x[i] + a * (p.end_size_x[i] - p.start_size_x[i]);
+	p.size_y[i] = p.start_size_y[i] + a * (p.end_size_y[i] - p.start_size_y[i]);
+	p.rotation_speed[i] = p.start_rotation_speed[i] + a * (p.end_rotation_speed[i] - p.start_rotation_speed[i]);
+	p.red[i] = p.start_red[i] + a * (p.end_red[i] - p.start_red[i]);
+	p.green[i] = p.start_green[i] + a * (p.end_green[i] - p.start_green[i]);
+	p.blue[i] = p.start_blue[i] + a * (p.end_blue[i] - p.start_blue[i]);
+	p.alpha[i] = p.start_alpha[i] + a * (p.end_alpha[i] - p.start_alpha[i]);
+}
+
+
+
+void InterpolateParticleProperties(ParticleArrays& p, uint32 count) {
+	uint32 i = 0;
+
+#ifdef PARTICLE_KERNELS_VECTOR
+	for (; i + 4 <= count; i += 4) {
+		Float4 a = _Multiply(_Subtract(_Multiply(_Load(&p.time[i]), _Load(&p.inverse_lifetime[i])), _Load(&p.keyframe_start[i])),
+			_Load(&p.keyframe_scale[i]));
+
+		Float4 start = _Load(&p.start_size_x[i]);
+		_Store(&p.size_x[i], _Add(start, _Multiply(a, _Subtract(_Load(&p.end_size_x[i]), start))));
+		start = _Load(&p.start_size_y[i]);
+		_Store(&p.size_y[i], _Add(start, _Multiply(a, _Subtract(_Load(&p.end_size_y[i]), start))));
+		start = _Load(&p.start_rotation_speed[i]);
+		_Store(&p.rotation_speed[i], _Add(start, _Multiply(a, _Subtract(_Load(&p.end_rotation_speed[i]), start))));
+		start = _Load(&p.start_red[i]);
+		_Store(&p.red[i], _Add(start, _Multiply(a, _Subtract(_Load(&p.end_red[i]), start))));
+		start = _Load(&p.start_green[i]);
+		_Store(&p.green[i], _Add(start, _Multiply(a, _Subtract(_Load(&p.end_green[i]), start))));
+		start = _Load(&p.start_blue[i]);
+		_Store(&p.blue[i], _Add(start, _Multiply(a, _Subtract(_Load(&p.end_blue[i]), start))));
+		start = _Load(&p.start_alpha[i]);
+		_Store(&p.alpha[i], _Add(start, _Multiply(a, _Subtract(_Load(&p.end_alpha[i]), start))));
+	}
+#endif
+
+	for (; i < count; ++i)
+		_InterpolateParticle(p, i);
+}
+
+
+
+static inline void _IntegrateParticle(ParticleArrays& p, uint32 i, const ParticleStep& step, float uniform_damping) {
+	float t = step.time;
+
+	p.rotation_angle[i] += p.rotation_speed[i] * p.rotation_direction[i] * t;
+
+	float velocity_x = p.velocity_x[i] + p.wind_velocity_x[i];
+	float velocity_y = p.velocity_y[i] + p.wind_velocity_y[i];
+
+	// The wave velocity is the wave speed times the unit vector tangential to the particle's velocity
+	if (step.wave_motion == true && p.wave_half_amplitude[i] > 0.0f) {
+		float speed = sqrtf(velocity_x * velocity_x + velocity_y * velocity_y);
+		float wave_velocity_x = (-velocity_y / speed) * p.wave_speed[i];
+		float wave_velocity_y = (velocity_x / speed) * p.wave_speed[i];
+		velocity_x += wave_velocity_x;
+		velocity_y += wave_velocity_y;
+	}
+
+	p.combined_velocity_x[i] = velocity_x;
+	p.combined_velocity_y[i] = velocity_y;
+	p.x[i] += velocity_x * t;
+	p.y[i] += velocity_y * t;
+
+	p.velocity_x[i] += p.acceleration_x[i] * t;
+	p.velocity_y[i] += p.acceleration_y[i] * t;
+
+	if (step.attractor_forces == true) {
+		// Unit vector from the attractor to the particle, which is left as a zero vector if the two are at the same point
+		float direction_x = p.x[i] - step.attractor_x;
+		float direction_y = p.y[i] - step.attractor_y;
+		float distance = sqrtf(direction_x * direction_x + direction_y * direction_y);
+		float divisor = (distance != 0.0f) ? distance : 1.0f;
+		direction_x = direction_x / divisor;
+		direction_y = direction_y / divisor;
+
+		float attraction = max(1.0f - step.attractor_falloff * distance, 0.0f);
+		float radial = p.radial_acceleration[i] * t * attraction;
+		float tangential = p.tangential_acceleration[i] * t;
+
+		// The tangent vector is perpendicular to the direction: (-direction_y, direction_x)
+		p.velocity_x[i] += direction_x * radial - direction_y * tangential;
+		p.velocity_y[i] += direction_y * radial + direction_x * tangential;
+	}
+
+	float damping = (step.uniform_damping == true) ? uniform_damping : p.damping_factor[i];
+	p.velocity_x[i] *= damping;
+	p.velocity_y[i] *= damping;
+
+	p.time[i] += t;
+} // static inline void _IntegrateParticle(...)
+
+
+
+void IntegrateParticles(ParticleArrays& p, uint32 count, const ParticleStep& step) {
+	float t = step.time;
+
+	// These are the only parts of the update that need transcendental functions, so they are computed ahead of the kernel
+	if (step.wave_motion == true) {
+		for (uint32 i = 0; i < count; ++i)
+			p.wave_speed[i] = (p.wave_half_amplitude[i] > 0.0f) ? p.wave_half_amplitude[i] * sinf(p.wave_length_coefficient[i] * p.time[i]) : 0.0f;
+	}
+
+	float uniform_damping = 1.0f;
+	if (step.uniform_damping == true) {
+		if (step.damping != 1.0f)
+			uniform_damping = powf(step.damping, t);
+	}
+	else {
+		for (uint32 i = 0; i < count; ++i)
+			p.damping_factor[i] = (p.damping[i] != 1.0f) ? powf(p.damping[i], t) : 1.0f;
+	}
+
+	uint32 i = 0;
+
+#ifdef PARTICLE_KERNELS_VECTOR
+	Float4 zero = _Set(0.0f);
+	Float4 one = _Set(1.0f);
+	Float4 time_step = _Set(t);
+	Float4 attractor_x = _Set(step.attractor_x);
+	Float4 attractor_y = _Set(step.attractor_y);
+	Float4 attractor_falloff = _Set(step.attractor_falloff);
+	Float4 damping = _Set(uniform_damping);
+
+	for (; i + 4 <= count; i += 4) {
+		_Store(&p.rotation_angle[i], _Add(_Load(&p.rotation_angle[i]),
+			_Multiply(_Multiply(_Load(&p.rotation_speed[i]), _Load(&p.rotation_direction[i])), time_step)));
+
+		Float4 velocity_x = _Add(_Load(&p.velocity_x[i]), _Load(&p.wind_velocity_x[i]));
+		Float4 velocity_y = _Add(_Load(&p.velocity_y[i]), _Load(&p.wind_velocity_y[i]));
+
+		if (step.wave_motion == true) {
+			Float4 wave = _GreaterThan(_Load(&p.wave_half_amplitude[i]), zero);
+			Float4 wave_speed = _Load(&p.wave_speed[i]);
+			Float4 speed = _SquareRoot(_Add(_Multiply(velocity_x, velocity_x), _Multiply(velocity_y, velocity_y)));
+			Float4 wave_velocity_x = _Multiply(_Divide(_Negate(velocity_y), speed), wave_speed);
+			Float4 wave_velocity_y = _Multiply(_Divide(velocity_x, speed), wave_speed);
+			velocity_x = _Select(wave, _Add(velocity_x, wave_velocity_x), velocity_x);
+			velocity_y = _Select(wave, _Add(velocity_y, wave_velocity_y), velocity_y);
+		}
+
+		_Store(&p.combined_velocity_x[i], velocity_x);
+		_Store(&p.combined_velocity_y[i], velocity_y);
+		Float4 x = _Add(_Load(&p.x[i]), _Multiply(velocity_x, time_step));
+		Float4 y = _Add(_Load(&p.y[i]), _Multiply(velocity_y, time_step));
+		_Store(&p.x[i], x);
+		_Store(&p.y[i], y);
+
+		velocity_x = _Add(_Load(&p.velocity_x[i]), _Multiply(_Load(&p.acceleration_x[i]), time_step));
+		velocity_y = _Add(_Load(&p.velocity_y[i]), _Multiply(_Load(&p.acceleration_y[i]), time_step));
+
+		if (step.attractor_forces == true) {
+			Float4 direction_x = _Subtract(x, attractor_x);
+			Float4 direction_y = _Subtract(y, attractor_y);
+			Float4 distance = _SquareRoot(_Add(_Multiply(direction_x, direction_x), _Multiply(direction_y, direction_y)));
+			Float4 divisor = _Select(_NotEqual(distance, zero), distance, one);
+			direction_x = _Divide(direction_x, divisor);
+			direction_y = _Divide(direction_y, divisor);
+
+			Float4 attraction = _Maximum(_Subtract(one, _Multiply(attractor_falloff, distance)), zero);
+			Float4 radial = _Multiply(_Multiply(_Load(&p.radial_acceleration[i]), time_step), attraction);
+			Float4 tangential = _Multiply(_Load(&p.tangential_acceleration[i]), time_step);
+
+			velocity_x = _Add(velocity_x, _Subtract(_Multiply(direction_x, radial), _Multiply(direction_y, tangential)));
+			velocity_y = _Add(velocity_y, _Add(_Multiply(direction_y, radial), _Multiply(direction_x, tangential)));
+		}
+
+		Float4 damping_factor = (step.uniform_damping == true) ? damping : _Load(&p.damping_factor[i]);
+		_Store(&p.velocity_x[i], _Multiply(velocity_x, damping_factor));
+		_Store(&p.velocity_y[i], _Multiply(velocity_y, damping_factor));
+
+		_Store(&p.time[i], _Add(_Load(&p.time[i]), time_step));
+	}
+#endif
+
+	for (; i < count; ++i)
+		_IntegrateParticle(p, i, step, uniform_damping);
+} // void IntegrateParticles(ParticleArrays& p, uint32 count, const ParticleStep& step)
+
+
+
+void UpdateParticles(ParticleArrays& particles, uint32 count, const vector<ParticleKeyframe*>& keyframes,
+	const vector<float>& keyframe_times, const ParticleStep& step, ParticleRandom& random)
+{
+	AdvanceParticleKeyframes(particles, count, keyframes, keyframe_times, random);
+	InterpolateParticleProperties(particles, count);
+	IntegrateParticles(particles, count, step);
+}
+
+
+
+const char* GetParticleKernelName() {
+#if defined(PARTICLE_KERNELS_SSE2)
+	return "SSE2";
+#elif defined(PARTICLE_KERNELS_NEON)
+	return "NEON";
+#else
+	return "scalar";
+#endif
+}
+
+} // namespace private_video
+
+} // namespace hoa_video
@@ -0,0 +1,162 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    particle_kernels.h
+*** \author  agent
+*** \brief   Header file for particle update kernels
+***
+*** Every particle system moves all of its particles every frame. The functions
+*** in this file perform that update on the arrays of a ParticleArrays object.
+*** The interpolation of keyframed properties and the integration of positions,
+*** velocities, accelerations and attractor forces process four particles at
+*** once using SSE2 on x86 processors or NEON on 64-bit ARM processors. Other
+*** processors use a scalar loop that performs the same computation.
+***
+*** The allacrost-particlebench tool measures the speed of these kernels.
+***
+*** \note This file is also compiled into the allacrost-particlebench tool and
+*** therefore must not depend on any engine.
+*** ***************************************************************************/
+
+#pragma once
+
+#include "utils.h"
+#include "defs.h"
+
+#include "particle.h"
+
+namespace hoa_video {
+
+namespace private_video {
+
+/** ****************************************************************************
+*** \brief A random number generator that belongs to a single particle system
+***
+*** Particle systems may be updated on any thread and in any order, so they can
+*** not share the random number generator of the C library. Each system draws its
+*** random numbers from one of these instead, which makes the particles of every
+*** system depend only on the seed that the system was given.
+*** ***************************************************************************/
+class ParticleRandom {
+public:
+	ParticleRandom()
+		{ Seed(0); }
+
+	//! \brief Restarts the sequence of random numbers from a seed. Any seed value, including zero, is valid.
+	void Seed(uint32 seed);
+
+	//! \brief Returns the next random integer in the sequence
+	uint32 NextInteger();
+
+	//! \brief Returns a random float value between a and b, the same as hoa_utils::RandomFloat(a, b)
+	float NextFloat(float a, float b);
+
+private:
+	//! \brief The state of the xorshift generator, which must never be zero
+	uint32 _state;
+}; // class ParticleRandom
+
+
+/** ****************************************************************************
+*** \brief The parameters shared by all particles of a system for a single update
+*** ***************************************************************************/
+class ParticleStep {
+public:
+	ParticleStep();
+
+	//! \brief The number of seconds to advance the particles by
+	float time;
+
+	//! \brief True if the particles of the system move in a wave
+	bool wave_motion;
+
+	//! \brief True if any particle of the system has a non-zero radial or tangential acceleration
+	bool attractor_forces;
+
+	//! \brief The point that radial and tangential accelerations are relative to
+	float attractor_x, attractor_y;
+
+	//! \brief How quickly the pull of the attractor falls off with distance, or zero for no falloff
+	float attractor_falloff;
+
+	//! \brief True if every particle of the system has the same damping
+	bool uniform_damping;
+
+	//! \brief The damping of every particle, when uniform_damping is true
+	float damping;
+}; // class ParticleStep
+
+
+/** \brief Sets the keyframe that a particle is on
+*** \param particles The particle arrays
+*** \param i The index of the particle
+*** \param keyframe The index of the keyframe to place the particle on
+*** \param keyframes The keyframes of the system, sorted by time
+*** \param keyframe_times The time of each keyframe, in the same order
+*** \param spawn True if the particle is being spawned, in which case its keyframed properties are also set
+*** \param random The random number generator of the particle system
+***
+*** Random variations are chosen for the new current and next keyframes. When the
+*** particle advances by exactly one keyframe, the variations that were chosen
+*** for its old next keyframe are kept instead. When the particle reaches the
+*** last keyframe, its properties are set to those of that keyframe.
+**/
+void SetParticleKeyframe(ParticleArrays& particles, uint32 i, uint32 keyframe, const std::vector<ParticleKeyframe*>& keyframes,
+	const std::vector<float>& keyframe_times, bool spawn, ParticleRandom& random);
+
+/** \brief Moves particles which have passed their next keyframe on to the keyframe they are now on
+*** \param particles The particle arrays
+*** \param count The number of active particles
+*** \param keyframes The keyframes of the system, sorted by time
+*** \param keyframe_times The time of each keyframe, in the same order
+*** \param random The random number generator of the particle system
+***
+*** The keyframe is found with a binary search of keyframe_times. Most particles
+*** do not pass a keyframe in any given update, so this only compares the time
+*** of each particle to the time of its next keyframe.
+**/
+void AdvanceParticleKeyframes(ParticleArrays& particles, uint32 count, const std::vector<ParticleKeyframe*>& keyframes,
+	const std::vector<float>& keyframe_times, ParticleRandom& random);
+
+/** \brief Interpolates the size, rotation speed and color of particles between their keyframes
+*** \param particles The particle arrays
+*** \param count The number of active particles
+**/
+void InterpolateParticleProperties(ParticleArrays& particles, uint32 count);
+
+/** \brief Advances the rotation, position and velocity of particles
+*** \param particles The particle arrays
+*** \param count The number of active particles
+*** \param step The parameters of the update
+***
+*** This also advances the time of each particle by step.time.
+**/
+void IntegrateParticles(ParticleArrays& particles, uint32 count, const ParticleStep& step);
+
+/** \brief Performs a complete update of particles
+*** \param particles The particle arrays
+*** \param count The number of active particles
+*** \param keyframes The keyframes of the system, sorted by time
+*** \param keyframe_times The time of each keyframe, in the same order
+*** \param step The parameters of the update
+*** \param random The random number generator of the particle system
+***
+*** This calls AdvanceParticleKeyframes, InterpolateParticleProperties and
+*** IntegrateParticles in that order.
+**/
+void UpdateParticles(ParticleArrays& particles, uint32 count, const std::vector<ParticleKeyframe*>& keyframes,
+	const std::vector<float>& keyframe_times, const ParticleStep& step, ParticleRandom& random);
+
+//! \brief Returns the name of the instruction set that the kernels were built with for use in log and benchmark output
+const char* GetParticleKernelName();
+
+} // namespace private_video
+
+} // namespace hoa_video
@@ -7,291 +7,120 @@
 // See http://www.gnu.org/copyleft/gpl.html for details.
 ///////////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
+
 #include "video.h"
-#include "script.h"
+#include "profiler.h"
 
 #include "particle_manager.h"
+#include "particle_binary.h"
 #include "particle_effect.h"
 #include "particle_system.h"
 #include "particle_keyframe.h"
 
 using namespace std;
 using namespace hoa_utils;
-using namespace hoa_script;
 
 namespace hoa_video {
 
 namespace private_video {
 
+//! \brief Combines a seed with a number, such as an effect ID, to produce a different seed for each number
+static uint32 _MixSeed(uint32 seed, uint32 number) {
+	return (seed ^ number) * 0x9E3779B1 + number;
+}
+
 // -----------------------------------------------------------------------------
 // ParticleManager class methods
 // -----------------------------------------------------------------------------
 
-ParticleEffectDef* ParticleManager::LoadEffect(const string& filename) {
-	ReadScriptDescriptor script;
+ParticleManager::ParticleManager() :
+	_current_id(0),
+	_num_particles(0),
+	_seed(0),
+	_seeded(false),
+	_update_pending(false),
+	_work_ready(nullptr),
+	_work_done(nullptr),
+	_stop_workers(false),
+	_shader_initialized(false)
+{
+	SDL_AtomicSet(&_next_job, 0);
+}
 
-	if (script.OpenFile(filename) == false) {
-		IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to open the particle definition file: "
-			<< filename << ", the particle effect was not loaded" << endl;
-		return nullptr;
-	}
 
-	if (script.DoesTableExist("systems") == false) {
-		IF_PRINT_WARNING(VIDEO_DEBUG) << "missing 'systems' table in particle definition file: "
-			<< filename << endl;
-		script.CloseFile();
-		return nullptr;
-	}
 
-	script.OpenTable("systems");
-	uint32 number_of_systems = script.GetTableSize();
-	if (number_of_systems == 0) {
-		IF_PRINT_WARNING(VIDEO_DEBUG) << "no particle systems were defined in the particle definition file: "
-			<< filename << endl;
-		script.CloseAllTables();
-		script.CloseFile();
-		return nullptr;
-	}
+const ParticleEffectDef* ParticleManager::GetEffectDefinition(const string& filename, bool reload) {
+	map<string, ParticleEffectDef*>::iterator existing = _definitions.find(filename);
+	if (existing != _definitions.end() && reload == false)
+		return existing->second;
 
-	ParticleEffectDef* effect_definition = new ParticleEffectDef;
+	ParticleEffectDef* definition = _LoadEffect(filename);
+	if (definition == nullptr)
+		return nullptr;
 
-	// Read each particle system table
-	for (uint32 system_number = 0; system_number < number_of_systems; ++system_number) {
-		if (script.DoesTableExist(system_number) == false) {
-			IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to read system table #" << system_number
-				<< " in particle defintion file: " << filename << endl;
-			delete effect_definition;
-			script.CloseAllTables();
-			script.CloseFile();
-			return nullptr;
+	if (existing != _definitions.end()) {
+		// The systems of active effects point to the old definition, so it can not be deleted until they finish
+		_FinishUpdate();
+		if (_IsDefinitionInUse(existing->second) == true) {
+			_replaced_definitions.push_back(existing->second);
 		}
-		script.OpenTable(system_number);
-
-		// Read the emitter table
-		if (script.DoesTableExist("emitter") == false) {
-			IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to read emitter table in system table #" << system_number
-				<< " in particle defintion file: " << filename << endl;
-			delete effect_definition;
-			script.CloseAllTables();
-			script.CloseFile();
-			return nullptr;
-		}
-		script.OpenTable("emitter");
-
-		ParticleSystemDef* system_definition = new ParticleSystemDef;
-		// By putting the new system definition in the effect object, the effect object now takes responsibility
-		// for delete the system object. Thus if we need to exit this function prematurely, we only need to delete
-		// the effect definition and we do not need to delete the system definition.
-		effect_definition->_systems.push_back(system_definition);
-
-		system_definition->emitter._x = script.ReadFloat("x");
-		system_definition->emitter._y = script.ReadFloat("y");
-		system_definition->emitter._x2 = script.ReadFloat("x2");
-		system_definition->emitter._y2 = script.ReadFloat("y2");
-		system_definition->emitter._center_x = script.ReadFloat("center_x");
-		system_definition->emitter._center_y = script.ReadFloat("center_y");
-		system_definition->emitter._x_variation = script.ReadFloat("x_variation");
-		system_definition->emitter._y_variation = script.ReadFloat("y_variation");
-		system_definition->emitter._radius = script.ReadFloat("radius");
-
-		string shape_string = script.ReadString("shape");
-		if (shape_string == "point")
-			system_definition->emitter._shape = EMITTER_SHAPE_POINT;
-		else if (shape_string == "line")
-			system_definition->emitter._shape = EMITTER_SHAPE_LINE;
-		else if (shape_string == "circle outline")
-			system_definition->emitter._shape = EMITTER_SHAPE_CIRCLE;
-		else if (shape_string == "circle")
-			system_definition->emitter._shape = EMITTER_SHAPE_FILLED_CIRCLE;
-		else if (shape_string == "rectangle")
-			system_definition->emitter._shape = EMITTER_SHAPE_FILLED_RECTANGLE;
 		else {
-			IF_PRINT_WARNING(VIDEO_DEBUG) << "unknown emitter shape: " << shape_string
-				<< ", when reading system table #" << system_number
-				<< " in particle defintion file: " << filename << endl;
+			_pool.ReleaseDefinition(existing->second);
+			delete existing->second;
 		}
+		existing->second = definition;
+	}
+	else {
+		_definitions[filename] = definition;
+	}
 
-		system_definition->emitter._omnidirectional = script.ReadBool("omnidirectional");
-		system_definition->emitter._orientation = script.ReadFloat("orientation");
-		system_definition->emitter._outer_cone = script.ReadFloat("outer_cone");
-		system_definition->emitter._inner_cone = script.ReadFloat("inner_cone");
-		system_definition->emitter._initial_speed = script.ReadFloat("initial_speed");
-		system_definition->emitter._initial_speed_variation = script.ReadFloat("initial_speed_variation");
-		system_definition->emitter._emission_rate = script.ReadFloat("emission_rate");
-		system_definition->emitter._start_time = script.ReadFloat("start_time");
-
-		string mode_string = script.ReadString("emitter_mode");
-		if (mode_string == "looping")
-			system_definition->emitter._emitter_mode = EMITTER_MODE_LOOPING;
-		else if (mode_string == "one shot")
-			system_definition->emitter._emitter_mode = EMITTER_MODE_ONE_SHOT;
-		else if (mode_string == "burst")
-			system_definition->emitter._emitter_mode = EMITTER_MODE_BURST;
-		else if (mode_string == "always")
-			system_definition->emitter._emitter_mode = EMITTER_MODE_ALWAYS;
-		else {
-			IF_PRINT_WARNING(VIDEO_DEBUG) << "unknown emitter mode: " << mode_string
-				<< ", when reading system table #" << system_number
-				<< " in particle defintion file: " << filename << endl;
-		}
+	return definition;
+}
 
-		string spin_string = script.ReadString("spin");
-		if (spin_string == "random")
-			system_definition->emitter._spin = EMITTER_SPIN_RANDOM;
-		else if (spin_string == "counterclockwise")
-			system_definition->emitter._spin = EMITTER_SPIN_COUNTERCLOCKWISE;
-		else if (spin_string == "clockwise")
-			system_definition->emitter._spin = EMITTER_SPIN_CLOCKWISE;
-		else {
-			IF_PRINT_WARNING(VIDEO_DEBUG) << "unknown emitter spin: " << spin_string
-				<< ", when reading system table #" << system_number
-				<< " in particle defintion file: " << filename << endl;
-		}
 
-		script.CloseTable(); // close the emitter table
 
-		// Read the keyframes table
-		if (script.DoesTableExist("keyframes") == false) {
-			IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to read keyframes table in system table #" << system_number
-				<< " in particle defintion file: " << filename << endl;
-			delete effect_definition;
-			script.CloseAllTables();
-			script.CloseFile();
-			return nullptr;
+bool ParticleManager::PreloadEffects(const vector<string>& filenames) {
+	bool success = true;
+
+	for (uint32 i = 0; i < filenames.size(); ++i) {
+		if (GetEffectDefinition(filenames[i]) == nullptr) {
+			IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to preload particle effect: " << filenames[i] << endl;
+			success = false;
 		}
-		script.OpenTable("keyframes");
+	}
 
-		uint32 number_of_keyframes = script.GetTableSize();
-		system_definition->keyframes.resize(number_of_keyframes);
+	return success;
+}
 
-		// Read each keyframe table
-		for (uint32 i = 0; i < number_of_keyframes; ++i) {
-			system_definition->keyframes[i] = new ParticleKeyframe;
 
-			// Keyframe tables are unnamed in the definition file. Unnammed Lua tables begin at index 1, not 0.
-			script.OpenTable(i + 1);
 
-			system_definition->keyframes[i]->size_x = script.ReadFloat("size_x");
-			system_definition->keyframes[i]->size_y = script.ReadFloat("size_y");
-			system_definition->keyframes[i]->color = _ReadColor(script, "color");
-			system_definition->keyframes[i]->rotation_speed = script.ReadFloat("rotation_speed");
-			system_definition->keyframes[i]->size_variation_x = script.ReadFloat("size_variation_x");
-			system_definition->keyframes[i]->size_variation_y = script.ReadFloat("size_variation_y");
-			system_definition->keyframes[i]->color_variation = _ReadColor(script, "color_variation");
-			system_definition->keyframes[i]->rotation_speed_variation = script.ReadFloat("rotation_speed_variation");
-			system_definition->keyframes[i]->time = script.ReadFloat("time");
+void ParticleManager::UnloadUnusedEffects() {
+	_FinishUpdate();
 
-			script.CloseTable();
-		}
-		script.CloseTable(); // close the keyframes table
-
-		// Read the animation frames and times
-		script.ReadStringVector("animation_frames", system_definition->animation_frame_filenames);
-		// At least one animation frame must be present
-		if (system_definition->animation_frame_filenames.empty() == true) {
-			IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to read animation frames in system table #" << system_number
-				<< " in particle defintion file: " << filename << endl;
-			delete effect_definition;
-			script.CloseAllTables();
-			script.CloseFile();
-			return nullptr;
+	for (map<string, ParticleEffectDef*>::iterator i = _definitions.begin(); i != _definitions.end();) {
+		if (_IsDefinitionInUse(i->second) == false) {
+			_pool.ReleaseDefinition(i->second);
+			delete i->second;
+			_definitions.erase(i++);
 		}
-
-		script.ReadIntVector("animation_frame_times", system_definition->animation_frame_times);
-		// Make sure that the frames and times tables are of equal size
-		if (system_definition->animation_frame_times.size() != system_definition->animation_frame_filenames.size()) {
-			IF_PRINT_WARNING(VIDEO_DEBUG) << "animation_frames and animation_frame_times tables were of unequal size"
-					<< " in system table #" << system_number << " in particle defintion file: " << filename << endl;
-			delete effect_definition;
-			script.CloseAllTables();
-			script.CloseFile();
-			return nullptr;
+		else {
+			++i;
 		}
+	}
 
-		// Test that each animation frame file exists
-		for (uint32 i = 0; i < system_definition->animation_frame_filenames.size(); i++) {
-			if (DoesFileExist(system_definition->animation_frame_filenames[i]) == false) {
-				IF_PRINT_WARNING(VIDEO_DEBUG) << "animation frame file did not exist: " << system_definition->animation_frame_filenames[i]
-					<< ", in system table #" << system_number << " in particle defintion file: " << filename << endl;
-				delete effect_definition;
-				script.CloseAllTables();
-				script.CloseFile();
-				return nullptr;
-			}
+	for (uint32 i = 0; i < _replaced_definitions.size();) {
+		if (_IsDefinitionInUse(_replaced_definitions[i]) == false) {
+			_pool.ReleaseDefinition(_replaced_definitions[i]);
+			delete _replaced_definitions[i];
+			_replaced_definitions[i] = _replaced_definitions.back();
+			_replaced_definitions.pop_back();
 		}
-
-		// Read the remaining particle system data
-		system_definition->enabled = script.ReadBool("enabled");
-		system_definition->blend_mode = script.ReadInt("blend_mode");
-		system_definition->system_lifetime = script.ReadFloat("system_lifetime");
-
-		system_definition->particle_lifetime = script.ReadFloat("particle_lifetime");
-		system_definition->particle_lifetime_variation = script.ReadFloat("particle_lifetime_variation");
-		system_definition->max_particles = script.ReadInt("max_particles");
-
-		system_definition->damping = script.ReadFloat("damping");
-		system_definition->damping_variation = script.ReadFloat("damping_variation");
-
-		system_definition->acceleration_x = script.ReadFloat("acceleration_x");
-		system_definition->acceleration_y = script.ReadFloat("acceleration_y");
-		system_definition->acceleration_variation_x = script.ReadFloat("acceleration_variation_x");
-		system_definition->acceleration_variation_y = script.ReadFloat("acceleration_variation_y");
-
-		system_definition->wind_velocity_x = script.ReadFloat("wind_velocity_x");
-		system_definition->wind_velocity_y = script.ReadFloat("wind_velocity_y");
-		system_definition->wind_velocity_variation_x = script.ReadFloat("wind_velocity_variation_x");
-		system_definition->wind_velocity_variation_y = script.ReadFloat("wind_velocity_variation_y");
-
-		system_definition->wave_motion_used = script.ReadBool("wave_motion_used");
-		system_definition->wave_length = script.ReadFloat("wave_length");
-		system_definition->wave_length_variation = script.ReadFloat("wave_length_variation");
-		system_definition->wave_amplitude = script.ReadFloat("wave_amplitude");
-		system_definition->wave_amplitude_variation = script.ReadFloat("wave_amplitude_variation");
-
-		system_definition->tangential_acceleration = script.ReadFloat("tangential_acceleration");
-		system_definition->tangential_acceleration_variation = script.ReadFloat("tangential_acceleration_variation");
-
-		system_definition->radial_acceleration = script.ReadFloat("radial_acceleration");
-		system_definition->radial_acceleration_variation = script.ReadFloat("radial_acceleration_variation");
-
-		system_definition->user_defined_attractor = script.ReadBool("user_defined_attractor");
-		system_definition->attractor_falloff = script.ReadFloat("attractor_falloff");
-
-		system_definition->rotation_used = script.ReadBool("rotation_used");
-		system_definition->rotate_to_velocity = script.ReadBool("rotate_to_velocity");
-
-		system_definition->speed_scale_used = script.ReadBool("speed_scale_used");
-		system_definition->speed_scale = script.ReadFloat("speed_scale");
-		system_definition->min_speed_scale = script.ReadFloat("min_speed_scale");
-		system_definition->max_speed_scale = script.ReadFloat("max_speed_scale");
-
-		system_definition->smooth_animation = script.ReadBool("smooth_animation");
-		system_definition->modify_stencil = script.ReadBool("modify_stencil");
-
-		string stencil_string = script.ReadString("stencil_op");
-		if (stencil_string == "incr")
-			system_definition->stencil_op = VIDEO_STENCIL_OP_INCREASE;
-		else if (stencil_string == "decr")
-			system_definition->stencil_op = VIDEO_STENCIL_OP_DECREASE;
-		else if (stencil_string == "zero")
-			system_definition->stencil_op = VIDEO_STENCIL_OP_ZERO;
-		else if (stencil_string == "one")
-			system_definition->stencil_op = VIDEO_STENCIL_OP_ONE;
 		else {
-			IF_PRINT_WARNING(VIDEO_DEBUG) << "unknown stencil_op: " << stencil_string
-				<< ", when reading system table #" << system_number
-				<< " in particle defintion file: " << filename << endl;
+			++i;
 		}
-
-		system_definition->use_stencil = script.ReadBool("use_stencil");
-		system_definition->random_initial_angle = script.ReadBool("random_initial_angle");
-
-		script.CloseTable(); // close the system_number table
-	} // for (uint32 system_number = 0; system_number < number_of_systems; ++system_number)
-	script.CloseFile(); // close the systems table
-
-	return effect_definition;
-} // ParticleEffectDef* ParticleManager::LoadEffect(const string& filename)
+	}
+}
 
 
 
@@ -306,6 +135,8 @@ ParticleEffectID ParticleManager::AddEffect(const ParticleEffectDef* definition,
 		return VIDEO_INVALID_EFFECT;
 	}
 
+	_FinishUpdate();
+
 	ParticleEffect* effect = _CreateEffect(definition);
 	if (effect == nullptr) {
 		IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to add effect because the effect failed to create from the particle definition" << endl;
@@ -324,33 +155,49 @@ ParticleEffectID ParticleManager::AddEffect(const ParticleEffectDef* definition,
 
 bool ParticleManager::Update(int32 frame_time) {
 	float frame_time_seconds = static_cast<float>(frame_time) / 1000.0f;
-	bool success = true;
-	_num_particles = 0;
+	bool success = _FinishUpdate();
 
+	_jobs.clear();
 	for (map<ParticleEffectID, ParticleEffect*>::iterator i = _effects.begin(); i != _effects.end();) {
-		// Remove any particle effects that have completed their life cycle
+		// Remove any particle effects that have completed their life cycle and recycle their objects
 		if ((i->second)->IsAlive() == false) {
 			map<ParticleEffectID, ParticleEffect*>::iterator finished_effect = i;
 			++i;
+			_pool.ReleaseEffect(finished_effect->second);
 			_effects.erase(finished_effect);
 		}
 		else {
-			if ((i->second)->_Update(frame_time_seconds) == false) {
-				success = false;
-				IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to update particle effect with ID #" << i->first << endl;
-			}
-
-			_num_particles += i->second->GetNumParticles();
+			(i->second)->_PrepareUpdate(frame_time_seconds, _jobs, _pool);
 			++i;
 		}
 	}
 
+	if (_jobs.empty() == true)
+		return success;
+
+	if (_workers.empty() == true)
+		_StartWorkers();
+
+	SDL_AtomicSet(&_next_job, 0);
+	_update_pending = true;
+
+	if (_workers.empty() == true) {
+		// There is nothing to overlap the update with, so finish it now
+		_RunJobs();
+	}
+	else {
+		for (uint32 i = 0; i < _workers.size(); ++i)
+			SDL_SemPost(_work_ready);
+	}
+
 	return success;
 }
 
 
 
 bool ParticleManager::Draw() {
+	_FinishUpdate();
+
 	VideoManager->PushState();
 	// NOTE: the particle manager is using inverted y coordinates compared to how most of the rest of the code aligns the y axis
 	VideoManager->SetCoordSys(CoordSys(0.0f, 1024.0f, 768.0f, 0.0f));
@@ -375,6 +222,8 @@ bool ParticleManager::Draw() {
 
 
 void ParticleManager::StopAll(bool kill_immediately) {
+	_FinishUpdate();
+
 	for (map<ParticleEffectID, ParticleEffect*>::iterator i = _effects.begin(); i != _effects.end(); ++i) {
 		(i->second)->Stop(kill_immediately);
 	}
@@ -383,6 +232,8 @@ void ParticleManager::StopAll(bool kill_immediately) {
 
 
 ParticleEffect* ParticleManager::GetEffect(ParticleEffectID id) {
+	_FinishUpdate();
+
 	map<ParticleEffectID, ParticleEffect*>::iterator i = _effects.find(id);
 	if (i == _effects.end())
 		return nullptr;
@@ -393,12 +244,194 @@ ParticleEffect* ParticleManager::GetEffect(ParticleEffectID id) {
 
 
 void ParticleManager::Destroy() {
+	_FinishUpdate();
+	_StopWorkers();
+
 	for (map<ParticleEffectID, ParticleEffect*>::iterator i = _effects.begin(); i != _effects.end(); ++i) {
-		(i->second)->_Destroy();
-		delete (i->second);
+		_pool.ReleaseEffect(i->second);
 	}
 
 	_effects.clear();
+	_jobs.clear();
+	_pool.Clear();
+
+	// The definitions hold references to the images of their animation frames, which must be released before the texture manager is destroyed
+	for (map<string, ParticleEffectDef*>::iterator i = _definitions.begin(); i != _definitions.end(); ++i) {
+		delete i->second;
+	}
+	_definitions.clear();
+
+	for (uint32 i = 0; i < _replaced_definitions.size(); ++i) {
+		delete _replaced_definitions[i];
+	}
+	_replaced_definitions.clear();
+
+	_shader.Destroy();
+	_shader_initialized = false;
+}
+
+
+
+void ParticleManager::UnloadShader() {
+	_FinishUpdate();
+	_shader.Destroy();
+}
+
+
+
+void ParticleManager::ReloadShader() {
+	if (_shader_initialized == false)
+		return;
+
+	if (_shader.Initialize() == false) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to recreate the particle shader, the current particle effects will not be drawn" << endl;
+	}
+}
+
+
+
+ParticleEffectDef* ParticleManager::_LoadEffect(const string& filename) {
+	ParticleBinaryData data;
+	string binary_filename = MakeParticleBinaryFilename(filename);
+
+	if (DoesFileExist(binary_filename) == true && data.ReadBinary(binary_filename, filename) == true) {
+		IF_PRINT_DEBUG(VIDEO_DEBUG) << "loaded particle effect from binary file: " << binary_filename << endl;
+	}
+	else if (data.ReadScript(filename) == false) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to read the particle definition file: " << filename
+			<< ", the particle effect was not loaded" << endl;
+		return nullptr;
+	}
+
+	// Load the image of every frame filename once, even when several systems or frames share it
+	vector<StillImage> frame_images(data.filenames.size());
+	for (uint32 i = 0; i < data.filenames.size(); ++i) {
+		if (frame_images[i].Load(data.filenames[i]) == false) {
+			IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to load animation frame image: " << data.filenames[i]
+				<< ", in particle definition file: " << filename << endl;
+			return nullptr;
+		}
+	}
+
+	ParticleEffectDef* effect_definition = new ParticleEffectDef;
+
+	for (uint32 system_number = 0; system_number < data.systems.size(); ++system_number) {
+		const ParticleBinarySystem& record = data.systems[system_number];
+		ParticleSystemDef* system_definition = new ParticleSystemDef;
+		effect_definition->_systems.push_back(system_definition);
+
+		system_definition->emitter._x = record.x;
+		system_definition->emitter._y = record.y;
+		system_definition->emitter._x2 = record.x2;
+		system_definition->emitter._y2 = record.y2;
+		system_definition->emitter._center_x = record.center_x;
+		system_definition->emitter._center_y = record.center_y;
+		system_definition->emitter._x_variation = record.x_variation;
+		system_definition->emitter._y_variation = record.y_variation;
+		system_definition->emitter._radius = record.radius;
+		system_definition->emitter._shape = static_cast<EMITTER_SHAPE>(record.shape);
+		system_definition->emitter._omnidirectional = (record.omnidirectional != 0);
+		system_definition->emitter._orientation = record.orientation;
+		system_definition->emitter._outer_cone = record.outer_cone;
+		system_definition->emitter._inner_cone = record.inner_cone;
+		system_definition->emitter._initial_speed = record.initial_speed;
+		system_definition->emitter._initial_speed_variation = record.initial_speed_variation;
+		system_definition->emitter._emission_rate = record.emission_rate;
+		system_definition->emitter._start_time = record.start_time;
+		system_definition->emitter._emitter_mode = static_cast<EMITTER_MODE>(record.emitter_mode);
+		system_definition->emitter._spin = static_cast<EMITTER_SPIN>(record.spin);
+
+		// The keyframes were sorted by time when the definition file was read
+		system_definition->keyframes.resize(record.keyframe_count);
+		system_definition->keyframe_times.resize(record.keyframe_count);
+		for (uint32 i = 0; i < record.keyframe_count; ++i) {
+			const ParticleBinaryKeyframe& keyframe_record = data.keyframes[record.first_keyframe + i];
+			ParticleKeyframe* keyframe = new ParticleKeyframe;
+			system_definition->keyframes[i] = keyframe;
+
+			keyframe->size_x = keyframe_record.size_x;
+			keyframe->size_y = keyframe_record.size_y;
+			keyframe->color = Color(keyframe_record.color[0], keyframe_record.color[1], keyframe_record.color[2], keyframe_record.color[3]);
+			keyframe->rotation_speed = keyframe_record.rotation_speed;
+			keyframe->size_variation_x = keyframe_record.size_variation_x;
+			keyframe->size_variation_y = keyframe_record.size_variation_y;
+			keyframe->color_variation = Color(keyframe_record.color_variation[0], keyframe_record.color_variation[1],
+				keyframe_record.color_variation[2], keyframe_record.color_variation[3]);
+			keyframe->rotation_speed_variation = keyframe_record.rotation_speed_variation;
+			keyframe->time = keyframe_record.time;
+			system_definition->keyframe_times[i] = keyframe_record.time;
+		}
+
+		for (uint32 i = 0; i < record.frame_count; ++i) {
+			const ParticleBinaryFrame& frame_record = data.frames[record.first_frame + i];
+			system_definition->animation_frame_filenames.push_back(data.filenames[frame_record.filename_index]);
+			system_definition->animation_frame_times.push_back(frame_record.frame_time);
+			system_definition->animation_frames.push_back(frame_images[frame_record.filename_index]);
+		}
+
+		system_definition->enabled = (record.enabled != 0);
+		system_definition->blend_mode = record.blend_mode;
+		system_definition->system_lifetime = record.system_lifetime;
+
+		system_definition->particle_lifetime = record.particle_lifetime;
+		system_definition->particle_lifetime_variation = record.particle_lifetime_variation;
+		system_definition->max_particles = record.max_particles;
+
+		system_definition->damping = record.damping;
+		system_definition->damping_variation = record.damping_variation;
+
+		system_definition->acceleration_x = record.acceleration_x;
+		system_definition->acceleration_y = record.acceleration_y;
+		system_definition->acceleration_variation_x = record.acceleration_variation_x;
+		system_definition->acceleration_variation_y = record.acceleration_variation_y;
+
+		system_definition->wind_velocity_x = record.wind_velocity_x;
+		system_definition->wind_velocity_y = record.wind_velocity_y;
+		system_definition->wind_velocity_variation_x = record.wind_velocity_variation_x;
+		system_definition->wind_velocity_variation_y = record.wind_velocity_variation_y;
+
+		system_definition->wave_motion_used = (record.wave_motion_used != 0);
+		system_definition->wave_length = record.wave_length;
+		system_definition->wave_length_variation = record.wave_length_variation;
+		system_definition->wave_amplitude = record.wave_amplitude;
+		system_definition->wave_amplitude_variation = record.wave_amplitude_variation;
+
+		system_definition->tangential_acceleration = record.tangential_acceleration;
+		system_definition->tangential_acceleration_variation = record.tangential_acceleration_variation;
+
+		system_definition->radial_acceleration = record.radial_acceleration;
+		system_definition->radial_acceleration_variation = record.radial_acceleration_variation;
+
+		system_definition->user_defined_attractor = (record.user_defined_attractor != 0);
+		system_definition->attractor_falloff = record.attractor_falloff;
+
+		system_definition->rotation_used = (record.rotation_used != 0);
+		system_definition->rotate_to_velocity = (record.rotate_to_velocity != 0);
+
+		system_definition->speed_scale_used = (record.speed_scale_used != 0);
+		system_definition->speed_scale = record.speed_scale;
+		system_definition->min_speed_scale = record.min_speed_scale;
+		system_definition->max_speed_scale = record.max_speed_scale;
+
+		system_definition->smooth_animation = (record.smooth_animation != 0);
+		system_definition->modify_stencil = (record.modify_stencil != 0);
+		system_definition->stencil_op = static_cast<VIDEO_STENCIL_OP>(record.stencil_op);
+		system_definition->use_stencil = (record.use_stencil != 0);
+		system_definition->random_initial_angle = (record.random_initial_angle != 0);
+	}
+
+	return effect_definition;
+} // ParticleEffectDef* ParticleManager::_LoadEffect(const string& filename)
+
+
+
+bool ParticleManager::_IsDefinitionInUse(const ParticleEffectDef* definition) const {
+	for (map<ParticleEffectID, ParticleEffect*>::const_iterator i = _effects.begin(); i != _effects.end(); ++i) {
+		if ((i->second)->_effect_def == definition)
+			return true;
+	}
+
+	return false;
 }
 
 
@@ -412,28 +445,35 @@ ParticleEffect *ParticleManager::_CreateEffect(const ParticleEffectDef *definiti
 		return nullptr;
 	}
 
-	ParticleEffect* effect = new ParticleEffect;
+	// The OpenGL context is certain to exist by the time the first effect is created
+	if (_shader_initialized == false) {
+		_shader_initialized = true;
+		if (_shader.Initialize() == true) {
+			IF_PRINT_DEBUG(VIDEO_DEBUG) << "particles will be drawn with the particle shader" << endl;
+		}
+		else {
+			IF_PRINT_DEBUG(VIDEO_DEBUG) << "particles will be drawn with the fixed function pipeline" << endl;
+		}
+	}
+
+	ParticleEffect* effect = _pool.AcquireEffect();
 	effect->_effect_def = definition;
 
+	// Each system gets its own seed so that systems made from the same definition do not move in unison
+	uint32 effect_seed = _seeded ? _MixSeed(_seed, static_cast<uint32>(_current_id)) : static_cast<uint32>(rand());
+	uint32 system_index = 0;
+
 	for (list<ParticleSystemDef*>::const_iterator i = definition->_systems.begin(); i != definition->_systems.end(); ++i) {
 		if ((*i)->enabled == false) {
 			continue;
 		}
 
-		ParticleSystem* system = new ParticleSystem;
-		// If any systems fail to create, delete all allocated resources and bail
-		if (system->Create(*i) == false) {
+		ParticleSystem* system = _pool.AcquireSystem(*i);
+		// If any systems fail to create, return the effect and all of its systems to the pool and bail
+		if (system->Create(*i, _MixSeed(effect_seed, system_index++), &_shader) == false) {
 			IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to create particle system for effect. The effect was not created." << endl;
-			system->Destroy();
-			delete system;
-
-			// Delete all previously loaded systems
-			for (list<ParticleSystem*>::const_iterator j = effect->_systems.begin(); j != effect->_systems.end(); ++j) {
-				(*j)->Destroy();
-				delete (*j);
-			}
-
-			delete effect;
+			_pool.ReleaseSystem(system);
+			_pool.ReleaseEffect(effect);
 			return nullptr;
 		}
 
@@ -447,17 +487,112 @@ ParticleEffect *ParticleManager::_CreateEffect(const ParticleEffectDef *definiti
 
 
 
-Color ParticleManager::_ReadColor(ReadScriptDescriptor& script, string parameter_name) {
-	vector<float> color_values;
+bool ParticleManager::_FinishUpdate() {
+	if (_update_pending == false)
+		return true;
+
+	// Help with any jobs that the workers have not reached yet, then wait for every worker to run out of jobs
+	_RunJobs();
+	for (uint32 i = 0; i < _workers.size(); ++i)
+		SDL_SemWait(_work_done);
+	_update_pending = false;
+
+	bool success = true;
+	for (uint32 i = 0; i < _jobs.size(); ++i) {
+		if (_jobs[i].success == false) {
+			success = false;
+			IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to update a particle system" << endl;
+		}
+	}
+
+	_num_particles = 0;
+	for (map<ParticleEffectID, ParticleEffect*>::iterator i = _effects.begin(); i != _effects.end(); ++i) {
+		(i->second)->_CountParticles();
+		_num_particles += (i->second)->GetNumParticles();
+	}
+
+	return success;
+} // bool ParticleManager::_FinishUpdate()
+
+
+
+void ParticleManager::_RunJobs() {
+	// SDL_AtomicAdd returns the value from before the addition, so every job is taken by exactly one thread
+	int32 job_count = static_cast<int32>(_jobs.size());
+	for (int32 i = SDL_AtomicAdd(&_next_job, 1); i < job_count; i = SDL_AtomicAdd(&_next_job, 1)) {
+		ParticleUpdateJob& job = _jobs[i];
+		job.success = job.system->Update(job.frame_time, job.parameters);
+	}
+}
+
+
 
-	script.ReadFloatVector(parameter_name, color_values);
-	if (color_values.size() < 4) {
-		IF_PRINT_WARNING(VIDEO_DEBUG) << "invalid read operation: failed to read parameter " << parameter_name
-			<< " from script file " << script.GetFilename() << parameter_name << endl;
-		return Color();
+void ParticleManager::_StartWorkers() {
+	// The semaphores remain from an earlier attempt that failed to create any threads
+	if (_work_ready != nullptr)
+		return;
+
+	int32 worker_count = min(SDL_GetCPUCount() - 1, static_cast<int32>(PARTICLE_MAX_WORKER_THREADS));
+	if (worker_count <= 0)
+		return;
+
+	_work_ready = SDL_CreateSemaphore(0);
+	_work_done = SDL_CreateSemaphore(0);
+	if (_work_ready == nullptr || _work_done == nullptr) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to create semaphores, particles will be updated on the main thread: " << SDL_GetError() << endl;
+		_StopWorkers();
+		return;
+	}
+
+	_stop_workers = false;
+	for (int32 i = 0; i < worker_count; ++i) {
+		SDL_Thread* worker = SDL_CreateThread(_WorkerThread, "particles", this);
+		if (worker == nullptr) {
+			IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to create a particle worker thread: " << SDL_GetError() << endl;
+			break;
+		}
+		_workers.push_back(worker);
+	}
+}
+
+
+
+void ParticleManager::_StopWorkers() {
+	_stop_workers = true;
+	for (uint32 i = 0; i < _workers.size(); ++i)
+		SDL_SemPost(_work_ready);
+	for (uint32 i = 0; i < _workers.size(); ++i)
+		SDL_WaitThread(_workers[i], nullptr);
+	_workers.clear();
+
+	if (_work_ready != nullptr) {
+		SDL_DestroySemaphore(_work_ready);
+		_work_ready = nullptr;
+	}
+	if (_work_done != nullptr) {
+		SDL_DestroySemaphore(_work_done);
+		_work_done = nullptr;
+	}
+}
+
+
+
+int ParticleManager::_WorkerThread(void* manager) {
+	ParticleManager* particle_manager = static_cast<ParticleManager*>(manager);
+
+	while (true) {
+		SDL_SemWait(particle_manager->_work_ready);
+		if (particle_manager->_stop_workers == true)
+			break;
+
+		{
+			PROFILE_ZONE("ParticleManager::_RunJobs");
+			particle_manager->_RunJobs();
+		}
+		SDL_SemPost(particle_manager->_work_done);
 	}
 
-	return Color(color_values[0], color_values[1], color_values[2], color_values[3]);
+	return 0;
 }
 
 } // namespace private_video
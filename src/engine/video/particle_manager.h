@@ -15,13 +15,33 @@
 *** The particle manager is very simple. Every time you want to draw an effect,
 *** you call AddEffect() with a pointer to the effect definition structure.
 *** Then every frame, call Update() and Draw() to draw all the effects.
+***
+*** Effect definitions are retrieved with GetEffectDefinition(), which loads each
+*** definition file only once and shares the definition, including the images of
+*** its animation frames, between every effect created from it. A definition is
+*** read from its compiled binary particle file when one is up to date (see
+*** particle_binary.h). Modes that know which effects they will use can load them
+*** all in advance with PreloadEffects() so that the first use of an effect does
+*** not stall the game while its definition and images are loaded.
+***
+*** The particle systems of all effects are updated in parallel on a small pool
+*** of worker threads. Update() only starts the work, which continues while the
+*** rest of the frame is updated, and Draw() waits for it to finish.
 *** ***************************************************************************/
 
 #pragma once
 
+#include <SDL2/SDL_thread.h>
+#include <SDL2/SDL_mutex.h>
+#include <SDL2/SDL_atomic.h>
+
 #include "defs.h"
 #include "utils.h"
 
+#include "particle.h"
+#include "particle_pool.h"
+#include "particle_shader.h"
+
 //! \brief A particle effet ID is an int
 typedef int32 ParticleEffectID;
 
@@ -32,19 +52,61 @@ namespace hoa_video {
 
 namespace private_video {
 
+//! \brief The largest number of worker threads that particle systems are updated on
+const uint32 PARTICLE_MAX_WORKER_THREADS = 3;
+
+/** ****************************************************************************
+***  \brief The update of a single particle system, which may be run on any thread
+*** ***************************************************************************/
+class ParticleUpdateJob {
+public:
+	//! \brief The system to update
+	ParticleSystem* system;
+
+	//! \brief The parameters of the effect that the system belongs to
+	EffectParameters parameters;
+
+	//! \brief The number of seconds to update the system by
+	float frame_time;
+
+	//! \brief Set to false if the update of the system failed
+	bool success;
+}; // class ParticleUpdateJob
+
+
 /** ****************************************************************************
 ***  \brief Used to store, update, and draw all particle effects.
+***
+*** Every method except Update() first waits for any update that is still in
+*** progress, so the effects and systems are never accessed while a worker
+*** thread is updating them.
 *** ***************************************************************************/
 class ParticleManager {
 public:
-	ParticleManager()
-		{ _current_id = 0; }
+	ParticleManager();
 
-	/** \brief Loads an effect definition from a particle file
-	*** \param filename The file to load the effect definition from
-	*** \return A pointer to the newly loaded effect definition
+	/** \brief Retrieves the effect definition of a particle file, loading it if necessary
+	*** \param filename The particle definition file of the effect
+	*** \param reload If true, the definition is loaded from the file again even if it has already been loaded
+	*** \return A pointer to the effect definition, or nullptr if it could not be loaded
+	***
+	*** A definition that is replaced by a reload while effects created from it are still active is kept
+	*** until UnloadUnusedEffects() is called after those effects have finished.
+	**/
+	const ParticleEffectDef* GetEffectDefinition(const std::string &filename, bool reload = false);
+
+	/** \brief Loads the effect definitions of several particle files that have not already been loaded
+	*** \param filenames The particle definition files to load
+	*** \return True if every definition was loaded successfully
+	**/
+	bool PreloadEffects(const std::vector<std::string>& filenames);
+
+	/** \brief Deletes every loaded effect definition that no active effect was created from
+	***
+	*** This releases the images of the definitions as well. It should be called when leaving a mode that
+	*** preloaded effects which are not needed elsewhere.
 	**/
-	ParticleEffectDef* LoadEffect(const std::string &filename);
+	void UnloadUnusedEffects();
 
 	/** \brief Creates a new instance of an effect at (x,y)
 	*** \param definition A pointer to the new effect to add
@@ -54,9 +116,12 @@ public:
 	**/
 	ParticleEffectID AddEffect(const ParticleEffectDef* definition, float x, float y);
 
-	/** \brief Updates all active particle effects
+	/** \brief Starts updating all active particle effects
 	*** \param frame_time The number of milliseconds to update the effects by
-	*** \return True if all effects were updated successfully
+	*** \return True if all effects were successfully updated by the previous call to this method
+	***
+	*** The systems are updated on the worker threads while this method returns. If there are no
+	*** worker threads because the processor has only one core, they are updated before it returns.
 	**/
 	bool Update(int32 frame_time);
 
@@ -65,6 +130,17 @@ public:
 	**/
 	bool Draw();
 
+	/** \brief Sets the seed that the random number generators of all effects added after this call are derived from
+	*** \param seed The seed to use
+	***
+	*** Each particle system draws random numbers from its own generator, which is seeded from this
+	*** seed and the ID of its effect. Effects therefore look exactly the same every time that the
+	*** same effects are added in the same order after setting the same seed, regardless of how many
+	*** threads they are updated on. Until a seed is set, effects are seeded with rand().
+	**/
+	void SetSeed(uint32 seed)
+		{ _seed = seed; _seeded = true; }
+
 	/** \brief Stops all active particle effects from emitting more particles
 	*** \param kill_immediately If true, the effects are all killed as well (default value = false).
 	***
@@ -75,7 +151,11 @@ public:
 
 	//! \brief Returns the total number of particles among all active effects
 	int32 GetNumParticles()
-		{ return _num_particles; }
+		{ _FinishUpdate(); return _num_particles; }
+
+	//! \brief Returns the counts of effects and systems that were allocated and recycled
+	const ParticlePoolStatistics& GetPoolStatistics() const
+		{ return _pool.GetStatistics(); }
 
 	/** \brief Retrieves the particle effect object that corresponds to an effect ID
 	*** \param id The ID of the effect to retrieve
@@ -91,6 +171,17 @@ public:
 	//! \brief Destroys the particle manager and all effects that it manages
 	void Destroy();
 
+	/** \brief Deletes the OpenGL objects of the particle shader before the OpenGL context is lost
+	*** \note ReloadShader() must be called once the new context has been created
+	**/
+	void UnloadShader();
+
+	/** \brief Recreates the particle shader in a new OpenGL context if it was in use before UnloadShader()
+	***
+	*** If the shader can not be recreated, the systems that were created to draw with it are not drawn.
+	**/
+	void ReloadShader();
+
 private:
 	//! The next time we create an effect, its id will be _current_id
 	int32 _current_id;
@@ -104,22 +195,87 @@ private:
 	//! we can convert easily between an id and a pointer
 	std::map<ParticleEffectID, ParticleEffect*> _effects;
 
+	//! The seed set by SetSeed(), and whether one has been set at all
+	uint32 _seed;
+	bool _seeded;
+
+	//! The update of every alive particle system for the update in progress
+	std::vector<ParticleUpdateJob> _jobs;
+
+	//! The index of the next job in _jobs that has not yet been taken by a thread
+	SDL_atomic_t _next_job;
+
+	//! True while the jobs of an update are being run, until _FinishUpdate() is called
+	bool _update_pending;
+
+	//! The worker threads. This is empty until the first update, and stays empty on single core processors
+	std::vector<SDL_Thread*> _workers;
+
+	//! Posted once for each worker thread when there are jobs to run
+	SDL_sem* _work_ready;
+
+	//! Posted by each worker thread after it has found no more jobs to run
+	SDL_sem* _work_done;
+
+	//! Tells the worker threads to exit instead of running jobs when _work_ready is posted
+	bool _stop_workers;
+
+	//! Every loaded effect definition, indexed by the name of its particle definition file
+	std::map<std::string, ParticleEffectDef*> _definitions;
+
+	//! Definitions that were replaced by a reload while active effects were still using them
+	std::vector<ParticleEffectDef*> _replaced_definitions;
+
+	//! Holds the effects and systems of finished effects so that new effects can reuse them
+	ParticlePool _pool;
+
+	//! The shader that systems are drawn with when the OpenGL context supports it
+	ParticleShader _shader;
+
+	//! True once the shader has been initialized, which is done when the first effect is created
+	bool _shader_initialized;
+
+	/** \brief Loads an effect definition from a particle file
+	*** \param filename The file to load the effect definition from
+	*** \return A pointer to the newly loaded effect definition, or nullptr if it could not be loaded
+	***
+	*** The compiled binary particle file is used if it is up to date with the definition file.
+	*** Otherwise the definition file itself is read.
+	**/
+	ParticleEffectDef* _LoadEffect(const std::string &filename);
+
+	/** \brief Returns true if any active effect was created from a definition
+	*** \param definition The definition to look for
+	**/
+	bool _IsDefinitionInUse(const ParticleEffectDef* definition) const;
+
 	/** \brief Creates a new particle effect from a provided effect definition
 	*** \param definition A pointer to the definition data of the effect
 	*** \return A pointer to the created ParticleEffect object
 	**/
 	ParticleEffect* _CreateEffect(const ParticleEffectDef *definition);
 
-	/** \brief A helper function that is used to read a table of color data (four floats)
-	*** \param script A reference to the script to read the data from
-	*** \param parameter_name The name of the parameter containing the float data to read
-	*** \return The Color object created by reading the color data
+	/** \brief Waits for the update in progress, if any, to finish and then recounts the particles
+	*** \return True if all the systems of the update were updated successfully
 	***
-	*** \note The function will check that the parameter referred to a table of four floating point
-	*** values (holding the color data). If the parameter refers to any other data type, a warning
-	*** is issued and the function returns an uninitialized Color.
+	*** The calling thread runs any jobs which no worker thread has started yet.
+	**/
+	bool _FinishUpdate();
+
+	//! \brief Runs jobs from _jobs until there are none left to take
+	void _RunJobs();
+
+	//! \brief Creates the worker threads if the processor has more than one core
+	void _StartWorkers();
+
+	//! \brief Tells the worker threads to exit and waits for them to do so
+	void _StopWorkers();
+
+	/** \brief The function that each worker thread runs
+	*** \param manager A pointer to the particle manager that owns the thread
+	*** \return Always zero
 	**/
-	Color _ReadColor(hoa_script::ReadScriptDescriptor& script, std::string parameter_name);
+	static int _WorkerThread(void* manager);
 }; // class ParticleManager
 
 } // namespace private_video
@@ -0,0 +1,138 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    particle_pool.cpp
+*** \author  agent
+*** \brief   Source file for recycling particle effects and systems
+*** ***************************************************************************/
+
+#include "particle_pool.h"
+#include "particle_effect.h"
+#include "particle_system.h"
+
+using namespace std;
+
+namespace hoa_video {
+
+namespace private_video {
+
+ParticleEffect* ParticlePool::AcquireEffect() {
+	if (_effects.empty() == true) {
+		++_statistics.effects_allocated;
+		return new ParticleEffect;
+	}
+
+	ParticleEffect* effect = _effects.back();
+	_effects.pop_back();
+	++_statistics.effects_reused;
+	return effect;
+}
+
+
+
+void ParticlePool::ReleaseEffect(ParticleEffect* effect) {
+	if (effect == nullptr)
+		return;
+
+	for (uint32 i = 0; i < effect->_systems.size(); ++i) {
+		ReleaseSystem(effect->_systems[i]);
+	}
+
+	// This keeps the capacity of the system list, so the next effect does not need to allocate it again
+	effect->_Reset();
+
+	if (_effects.size() >= PARTICLE_POOL_MAX_EFFECTS) {
+		delete effect;
+		return;
+	}
+	_effects.push_back(effect);
+}
+
+
+
+ParticleSystem* ParticlePool::AcquireSystem(const ParticleSystemDef* definition) {
+	map<const ParticleSystemDef*, vector<ParticleSystem*> >::iterator pooled = _systems.find(definition);
+	if (pooled == _systems.end() || pooled->second.empty() == true) {
+		++_statistics.systems_allocated;
+		return new ParticleSystem;
+	}
+
+	ParticleSystem* system = pooled->second.back();
+	pooled->second.pop_back();
+	--_statistics.systems_pooled;
+	++_statistics.systems_reused;
+	return system;
+}
+
+
+
+void ParticlePool::ReleaseSystem(ParticleSystem* system) {
+	if (system == nullptr)
+		return;
+
+	// A system that was never successfully created has no definition to be reused for
+	if (system->GetDefinition() == nullptr) {
+		system->Destroy();
+		delete system;
+		return;
+	}
+
+	vector<ParticleSystem*>& pooled = _systems[system->GetDefinition()];
+	if (pooled.size() >= PARTICLE_POOL_SYSTEMS_PER_DEFINITION) {
+		system->Destroy();
+		delete system;
+		return;
+	}
+
+	pooled.push_back(system);
+	++_statistics.systems_pooled;
+}
+
+
+
+void ParticlePool::ReleaseDefinition(const ParticleEffectDef* definition) {
+	if (definition == nullptr)
+		return;
+
+	for (list<ParticleSystemDef*>::const_iterator i = definition->_systems.begin(); i != definition->_systems.end(); ++i) {
+		map<const ParticleSystemDef*, vector<ParticleSystem*> >::iterator pooled = _systems.find(*i);
+		if (pooled == _systems.end())
+			continue;
+
+		for (uint32 j = 0; j < pooled->second.size(); ++j) {
+			pooled->second[j]->Destroy();
+			delete pooled->second[j];
+		}
+		_statistics.systems_pooled -= pooled->second.size();
+		_systems.erase(pooled);
+	}
+}
+
+
+
+void ParticlePool::Clear() {
+	for (uint32 i = 0; i < _effects.size(); ++i) {
+		delete _effects[i];
+	}
+	_effects.clear();
+
+	for (map<const ParticleSystemDef*, vector<ParticleSystem*> >::iterator i = _systems.begin(); i != _systems.end(); ++i) {
+		for (uint32 j = 0; j < i->second.size(); ++j) {
+			i->second[j]->Destroy();
+			delete i->second[j];
+		}
+	}
+	_systems.clear();
+	_statistics.systems_pooled = 0;
+}
+
+} // namespace private_video
+
+} // namespace hoa_video
@@ -0,0 +1,136 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    particle_pool.h
+*** \author  agent
+*** \brief   Header file for recycling particle effects and systems
+***
+*** Every particle system allocates one array per particle property, plus the
+*** vertex or instance arrays that it is drawn from, all sized for the largest
+*** number of particles that its definition allows. Battles add and remove
+*** many short lived effects, so instead of freeing these objects when their
+*** effect finishes the ParticleManager returns them to a ParticlePool. A
+*** system that is later created from the same system definition takes over
+*** the object along with all of its arrays, which are already the right size.
+*** ***************************************************************************/
+
+#pragma once
+
+#include "defs.h"
+#include "utils.h"
+
+namespace hoa_video {
+
+namespace private_video {
+
+//! \brief The largest number of unused systems that are kept for any one system definition
+const uint32 PARTICLE_POOL_SYSTEMS_PER_DEFINITION = 4;
+
+//! \brief The largest number of unused effect objects that are kept
+const uint32 PARTICLE_POOL_MAX_EFFECTS = 32;
+
+/** ****************************************************************************
+*** \brief Counts the objects that a ParticlePool has handed out
+***
+*** These are shown by the advanced video statistics display. The allocation
+*** counts only grow, so a pool that is working well shows a reuse count that
+*** keeps rising while the allocation counts stay the same.
+*** ***************************************************************************/
+class ParticlePoolStatistics {
+public:
+	ParticlePoolStatistics() :
+		effects_allocated(0), effects_reused(0), systems_allocated(0), systems_reused(0), systems_pooled(0) {}
+
+	//! \brief The number of effect objects that were allocated because none were available for reuse
+	uint32 effects_allocated;
+
+	//! \brief The number of effect objects that were taken from the pool
+	uint32 effects_reused;
+
+	//! \brief The number of systems that were allocated because none were available for their definition
+	uint32 systems_allocated;
+
+	//! \brief The number of systems that were taken from the pool
+	uint32 systems_reused;
+
+	//! \brief The number of unused systems currently held by the pool
+	uint32 systems_pooled;
+}; // class ParticlePoolStatistics
+
+
+/** ****************************************************************************
+*** \brief Holds finished particle effects and systems for reuse
+***
+*** Unused systems are kept in a separate list for each system definition, since
+*** a system can only reuse the arrays of another system with the same number of
+*** particles and the same animation frames. The pool must be told when a
+*** definition is about to be deleted so that it can delete the systems that
+*** were created from it.
+***
+*** \note The pool is only used by the ParticleManager on the main thread, never
+*** by the threads that update the particle systems.
+*** ***************************************************************************/
+class ParticlePool {
+public:
+	ParticlePool()
+		{}
+
+	~ParticlePool()
+		{ Clear(); }
+
+	/** \brief Retrieves an effect object with no systems that is ready to be set up
+	*** \return An unused effect object, which the caller must return with ReleaseEffect()
+	**/
+	ParticleEffect* AcquireEffect();
+
+	/** \brief Returns an effect to the pool, along with any systems that it still has
+	*** \param effect The effect to return, which must not be used by the caller afterwards
+	**/
+	void ReleaseEffect(ParticleEffect* effect);
+
+	/** \brief Retrieves a system that was previously created from a definition, or a new system if there is none
+	*** \param definition The definition that the system is going to be created from
+	*** \return A system object on which ParticleSystem::Create() must be called before it is used
+	**/
+	ParticleSystem* AcquireSystem(const ParticleSystemDef* definition);
+
+	/** \brief Returns a system to the pool
+	*** \param system The system to return, which must not be used by the caller afterwards
+	***
+	*** If the pool already holds PARTICLE_POOL_SYSTEMS_PER_DEFINITION systems for the definition of this
+	*** system, the system is deleted instead.
+	**/
+	void ReleaseSystem(ParticleSystem* system);
+
+	/** \brief Deletes every pooled system that was created from any system of an effect definition
+	*** \param definition The effect definition that is about to be deleted
+	**/
+	void ReleaseDefinition(const ParticleEffectDef* definition);
+
+	//! \brief Deletes every object held by the pool
+	void Clear();
+
+	const ParticlePoolStatistics& GetStatistics() const
+		{ return _statistics; }
+
+private:
+	//! \brief Unused effect objects
+	std::vector<ParticleEffect*> _effects;
+
+	//! \brief Unused systems, grouped by the system definition that they were last created from
+	std::map<const ParticleSystemDef*, std::vector<ParticleSystem*> > _systems;
+
+	//! \brief The counts of objects handed out by the pool
+	ParticlePoolStatistics _statistics;
+}; // class ParticlePool
+
+} // namespace private_video
+
+} // namespace hoa_video
@@ -0,0 +1,330 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    particle_shader.cpp
+*** \author  agent
+*** \brief   Source file for drawing particles with an instanced vertex shader
+*** ***************************************************************************/
+
+#include <cstdio>
+
+#include "particle_shader.h"
+#include "video.h"
+
+using namespace std;
+using namespace hoa_utils;
+
+namespace hoa_video {
+
+namespace private_video {
+
+// The OpenGL 1.1 headers of some platforms do not define these
+static const GLenum PARTICLE_GL_ARRAY_BUFFER = 0x8892;
+static const GLenum PARTICLE_GL_STREAM_DRAW = 0x88E0;
+static const GLenum PARTICLE_GL_STATIC_DRAW = 0x88E4;
+static const GLenum PARTICLE_GL_FRAGMENT_SHADER = 0x8B30;
+static const GLenum PARTICLE_GL_VERTEX_SHADER = 0x8B31;
+static const GLenum PARTICLE_GL_COMPILE_STATUS = 0x8B81;
+static const GLenum PARTICLE_GL_LINK_STATUS = 0x8B82;
+static const GLenum PARTICLE_GL_INFO_LOG_LENGTH = 0x8B84;
+
+// The attribute locations of the program. The corner must be attribute zero, since the compatibility
+// profile only draws when either attribute zero or the fixed function vertex array is enabled.
+static const GLuint CORNER_ATTRIBUTE = 0;
+static const GLuint CENTER_SIZE_ATTRIBUTE = 1;
+static const GLuint ANGLE_ATTRIBUTE = 2;
+static const GLuint COLOR_ATTRIBUTE = 3;
+
+// Each instance is expanded into a quad with these corners, in the same order as the vertices of the fixed function path
+static const float QUAD_CORNERS[] = {
+	-1.0f, -1.0f,
+	1.0f, -1.0f,
+	1.0f, 1.0f,
+	-1.0f, 1.0f
+};
+
+static const char* VERTEX_SHADER_SOURCE =
+	"#version 120\n"
+	"attribute vec2 corner;\n"
+	"attribute vec4 center_size;\n"
+	"attribute float angle;\n"
+	"attribute vec4 color;\n"
+	"uniform vec4 frame;\n"
+	"uniform float color_scale;\n"
+	"void main() {\n"
+	"	vec2 offset = corner * center_size.zw;\n"
+	"	float sin_angle = sin(angle);\n"
+	"	float cos_angle = cos(angle);\n"
+	"	vec2 position = center_size.xy + vec2(offset.x * cos_angle - offset.y * sin_angle, offset.y * cos_angle + offset.x * sin_angle);\n"
+	"	gl_Position = gl_ModelViewProjectionMatrix * vec4(position, 0.0, 1.0);\n"
+	"	gl_TexCoord[0] = vec4(mix(frame.xy, frame.zw, corner * 0.5 + 0.5), 0.0, 1.0);\n"
+	"	gl_FrontColor = vec4(color.rgb * color_scale, color.a);\n"
+	"}\n";
+
+// This is the same as the GL_MODULATE texture environment that the fixed function path draws with
+static const char* FRAGMENT_SHADER_SOURCE =
+	"#version 120\n"
+	"uniform sampler2D particle_texture;\n"
+	"void main() {\n"
+	"	gl_FragColor = texture2D(particle_texture, gl_TexCoord[0].st) * gl_Color;\n"
+	"}\n";
+
+ParticleShader::ParticleShader() :
+	_GenBuffers(nullptr),
+	_DeleteBuffers(nullptr),
+	_BindBuffer(nullptr),
+	_BufferData(nullptr),
+	_CreateShader(nullptr),
+	_DeleteShader(nullptr),
+	_ShaderSource(nullptr),
+	_CompileShader(nullptr),
+	_GetShaderiv(nullptr),
+	_GetShaderInfoLog(nullptr),
+	_CreateProgram(nullptr),
+	_DeleteProgram(nullptr),
+	_AttachShader(nullptr),
+	_BindAttribLocation(nullptr),
+	_LinkProgram(nullptr),
+	_GetProgramiv(nullptr),
+	_GetProgramInfoLog(nullptr),
+	_UseProgram(nullptr),
+	_GetUniformLocation(nullptr),
+	_Uniform1f(nullptr),
+	_Uniform1i(nullptr),
+	_Uniform4f(nullptr),
+	_EnableVertexAttribArray(nullptr),
+	_DisableVertexAttribArray(nullptr),
+	_VertexAttribPointer(nullptr),
+	_VertexAttribDivisor(nullptr),
+	_DrawArraysInstanced(nullptr),
+	_program(0),
+	_corner_buffer(0),
+	_instance_buffer(0),
+	_frame_location(-1),
+	_color_scale_location(-1)
+{}
+
+
+
+bool ParticleShader::Initialize() {
+	Destroy();
+
+	if (_LoadFunctions() == false)
+		return false;
+
+	GLuint vertex_shader = _CompileStage(PARTICLE_GL_VERTEX_SHADER, VERTEX_SHADER_SOURCE);
+	GLuint fragment_shader = _CompileStage(PARTICLE_GL_FRAGMENT_SHADER, FRAGMENT_SHADER_SOURCE);
+	if (vertex_shader == 0 || fragment_shader == 0) {
+		if (vertex_shader != 0)
+			_DeleteShader(vertex_shader);
+		if (fragment_shader != 0)
+			_DeleteShader(fragment_shader);
+		return false;
+	}
+
+	GLuint program = _CreateProgram();
+	_AttachShader(program, vertex_shader);
+	_AttachShader(program, fragment_shader);
+	_BindAttribLocation(program, CORNER_ATTRIBUTE, "corner");
+	_BindAttribLocation(program, CENTER_SIZE_ATTRIBUTE, "center_size");
+	_BindAttribLocation(program, ANGLE_ATTRIBUTE, "angle");
+	_BindAttribLocation(program, COLOR_ATTRIBUTE, "color");
+	_LinkProgram(program);
+
+	// The shaders are deleted when the program that they are attached to is
+	_DeleteShader(vertex_shader);
+	_DeleteShader(fragment_shader);
+
+	GLint status = 0;
+	_GetProgramiv(program, PARTICLE_GL_LINK_STATUS, &status);
+	if (status == 0) {
+		if (VIDEO_DEBUG) {
+			GLint length = 0;
+			_GetProgramiv(program, PARTICLE_GL_INFO_LOG_LENGTH, &length);
+			vector<char> log(max(length, 1), '\0');
+			_GetProgramInfoLog(program, static_cast<GLsizei>(log.size()), nullptr, &log[0]);
+			PRINT_WARNING << "failed to link the particle shader: " << &log[0] << endl;
+		}
+		_DeleteProgram(program);
+		return false;
+	}
+
+	_frame_location = _GetUniformLocation(program, "frame");
+	_color_scale_location = _GetUniformLocation(program, "color_scale");
+	_UseProgram(program);
+	_Uniform1i(_GetUniformLocation(program, "particle_texture"), 0);
+	_UseProgram(0);
+
+	GLuint buffers[2];
+	_GenBuffers(2, buffers);
+	_corner_buffer = buffers[0];
+	_instance_buffer = buffers[1];
+	_BindBuffer(PARTICLE_GL_ARRAY_BUFFER, _corner_buffer);
+	_BufferData(PARTICLE_GL_ARRAY_BUFFER, sizeof(QUAD_CORNERS), QUAD_CORNERS, PARTICLE_GL_STATIC_DRAW);
+	_BindBuffer(PARTICLE_GL_ARRAY_BUFFER, 0);
+
+	_program = program;
+	return true;
+} // bool ParticleShader::Initialize()
+
+
+
+void ParticleShader::Destroy() {
+	if (_program != 0) {
+		_DeleteProgram(_program);
+		_program = 0;
+	}
+
+	if (_corner_buffer != 0) {
+		GLuint buffers[2] = { _corner_buffer, _instance_buffer };
+		_DeleteBuffers(2, buffers);
+		_corner_buffer = 0;
+		_instance_buffer = 0;
+	}
+}
+
+
+
+void ParticleShader::Begin(const ParticleInstance* instances, uint32 count) {
+	_UseProgram(_program);
+
+	_BindBuffer(PARTICLE_GL_ARRAY_BUFFER, _corner_buffer);
+	_VertexAttribPointer(CORNER_ATTRIBUTE, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+	_EnableVertexAttribArray(CORNER_ATTRIBUTE);
+
+	// Specifying the data again each frame lets the driver hand out new storage instead of waiting for the last draw
+	GLsizei stride = sizeof(ParticleInstance);
+	_BindBuffer(PARTICLE_GL_ARRAY_BUFFER, _instance_buffer);
+	_BufferData(PARTICLE_GL_ARRAY_BUFFER, count * stride, instances, PARTICLE_GL_STREAM_DRAW);
+	_VertexAttribPointer(CENTER_SIZE_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offsetof(ParticleInstance, _x)));
+	_VertexAttribPointer(ANGLE_ATTRIBUTE, 1, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offsetof(ParticleInstance, _angle)));
+	_VertexAttribPointer(COLOR_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offsetof(ParticleInstance, _color)));
+	for (GLuint i = CENTER_SIZE_ATTRIBUTE; i <= COLOR_ATTRIBUTE; ++i) {
+		_VertexAttribDivisor(i, 1);
+		_EnableVertexAttribArray(i);
+	}
+}
+
+
+
+void ParticleShader::Draw(uint32 count, float u1, float v1, float u2, float v2, float color_scale) {
+	_Uniform4f(_frame_location, u1, v1, u2, v2);
+	_Uniform1f(_color_scale_location, color_scale);
+	_DrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, static_cast<GLsizei>(count));
+}
+
+
+
+void ParticleShader::End() {
+	for (GLuint i = CORNER_ATTRIBUTE; i <= COLOR_ATTRIBUTE; ++i) {
+		_DisableVertexAttribArray(i);
+		_VertexAttribDivisor(i, 0);
+	}
+
+	// The rest of the engine draws from client side arrays, which do not work while a buffer is bound
+	_BindBuffer(PARTICLE_GL_ARRAY_BUFFER, 0);
+	_UseProgram(0);
+}
+
+
+
+bool ParticleShader::_LoadFunctions() {
+	const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+	int32 major = 0;
+	int32 minor = 0;
+	if (version == nullptr || sscanf(version, "%d.%d", &major, &minor) != 2) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "could not determine the OpenGL version" << endl;
+		return false;
+	}
+
+	if (major < 2) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "OpenGL " << version << " does not support shaders" << endl;
+		return false;
+	}
+
+	// Instanced arrays became core functionality in OpenGL 3.3
+	bool instanced_core = (major > 3 || (major == 3 && minor >= 3));
+	if (instanced_core == false && (VideoManager->IsGLExtensionSupported("GL_ARB_instanced_arrays") == false ||
+		VideoManager->IsGLExtensionSupported("GL_ARB_draw_instanced") == false))
+	{
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "OpenGL " << version << " does not support instanced arrays" << endl;
+		return false;
+	}
+
+	_GenBuffers = reinterpret_cast<GenBuffersFunction>(VideoManager->GetGLFunction("glGenBuffers"));
+	_DeleteBuffers = reinterpret_cast<DeleteBuffersFunction>(VideoManager->GetGLFunction("glDeleteBuffers"));
+	_BindBuffer = reinterpret_cast<BindBufferFunction>(VideoManager->GetGLFunction("glBindBuffer"));
+	_BufferData = reinterpret_cast<BufferDataFunction>(VideoManager->GetGLFunction("glBufferData"));
+	_CreateShader = reinterpret_cast<CreateShaderFunction>(VideoManager->GetGLFunction("glCreateShader"));
+	_DeleteShader = reinterpret_cast<DeleteShaderFunction>(VideoManager->GetGLFunction("glDeleteShader"));
+	_ShaderSource = reinterpret_cast<ShaderSourceFunction>(VideoManager->GetGLFunction("glShaderSource"));
+	_CompileShader = reinterpret_cast<CompileShaderFunction>(VideoManager->GetGLFunction("glCompileShader"));
+	_GetShaderiv = reinterpret_cast<GetShaderivFunction>(VideoManager->GetGLFunction("glGetShaderiv"));
+	_GetShaderInfoLog = reinterpret_cast<GetShaderInfoLogFunction>(VideoManager->GetGLFunction("glGetShaderInfoLog"));
+	_CreateProgram = reinterpret_cast<CreateProgramFunction>(VideoManager->GetGLFunction("glCreateProgram"));
+	_DeleteProgram = reinterpret_cast<DeleteProgramFunction>(VideoManager->GetGLFunction("glDeleteProgram"));
+	_AttachShader = reinterpret_cast<AttachShaderFunction>(VideoManager->GetGLFunction("glAttachShader"));
+	_BindAttribLocation = reinterpret_cast<BindAttribLocationFunction>(VideoManager->GetGLFunction("glBindAttribLocation"));
+	_LinkProgram = reinterpret_cast<LinkProgramFunction>(VideoManager->GetGLFunction("glLinkProgram"));
+	_GetProgramiv = reinterpret_cast<GetProgramivFunction>(VideoManager->GetGLFunction("glGetProgramiv"));
+	_GetProgramInfoLog = reinterpret_cast<GetProgramInfoLogFunction>(VideoManager->GetGLFunction("glGetProgramInfoLog"));
+	_UseProgram = reinterpret_cast<UseProgramFunction>(VideoManager->GetGLFunction("glUseProgram"));
+	_GetUniformLocation = reinterpret_cast<GetUniformLocationFunction>(VideoManager->GetGLFunction("glGetUniformLocation"));
+	_Uniform1f = reinterpret_cast<Uniform1fFunction>(VideoManager->GetGLFunction("glUniform1f"));
+	_Uniform1i = reinterpret_cast<Uniform1iFunction>(VideoManager->GetGLFunction("glUniform1i"));
+	_Uniform4f = reinterpret_cast<Uniform4fFunction>(VideoManager->GetGLFunction("glUniform4f"));
+	_EnableVertexAttribArray = reinterpret_cast<EnableVertexAttribArrayFunction>(VideoManager->GetGLFunction("glEnableVertexAttribArray"));
+	_DisableVertexAttribArray = reinterpret_cast<DisableVertexAttribArrayFunction>(VideoManager->GetGLFunction("glDisableVertexAttribArray"));
+	_VertexAttribPointer = reinterpret_cast<VertexAttribPointerFunction>(VideoManager->GetGLFunction("glVertexAttribPointer"));
+	_VertexAttribDivisor = reinterpret_cast<VertexAttribDivisorFunction>(VideoManager->GetGLFunction(instanced_core ? "glVertexAttribDivisor" : "glVertexAttribDivisorARB"));
+	_DrawArraysInstanced = reinterpret_cast<DrawArraysInstancedFunction>(VideoManager->GetGLFunction(instanced_core ? "glDrawArraysInstanced" : "glDrawArraysInstancedARB"));
+
+	if (_GenBuffers == nullptr || _DeleteBuffers == nullptr || _BindBuffer == nullptr || _BufferData == nullptr ||
+		_CreateShader == nullptr || _DeleteShader == nullptr || _ShaderSource == nullptr || _CompileShader == nullptr ||
+		_GetShaderiv == nullptr || _GetShaderInfoLog == nullptr || _CreateProgram == nullptr || _DeleteProgram == nullptr ||
+		_AttachShader == nullptr || _BindAttribLocation == nullptr || _LinkProgram == nullptr || _GetProgramiv == nullptr ||
+		_GetProgramInfoLog == nullptr || _UseProgram == nullptr || _GetUniformLocation == nullptr || _Uniform1f == nullptr ||
+		_Uniform1i == nullptr || _Uniform4f == nullptr || _EnableVertexAttribArray == nullptr || _DisableVertexAttribArray == nullptr ||
+		_VertexAttribPointer == nullptr || _VertexAttribDivisor == nullptr || _DrawArraysInstanced == nullptr)
+	{
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to retrieve the OpenGL functions that the particle shader requires" << endl;
+		return false;
+	}
+
+	return true;
+} // bool ParticleShader::_LoadFunctions()
+
+
+
+GLuint ParticleShader::_CompileStage(GLenum type, const char* source) {
+	GLuint shader = _CreateShader(type);
+	_ShaderSource(shader, 1, &source, nullptr);
+	_CompileShader(shader);
+
+	GLint status = 0;
+	_GetShaderiv(shader, PARTICLE_GL_COMPILE_STATUS, &status);
+	if (status == 0) {
+		if (VIDEO_DEBUG) {
+			GLint length = 0;
+			_GetShaderiv(shader, PARTICLE_GL_INFO_LOG_LENGTH, &length);
+			vector<char> log(max(length, 1), '\0');
+			_GetShaderInfoLog(shader, static_cast<GLsizei>(log.size()), nullptr, &log[0]);
+			PRINT_WARNING << "failed to compile a particle shader stage: " << &log[0] << endl;
+		}
+		_DeleteShader(shader);
+		return 0;
+	}
+
+	return shader;
+}
+
+} // namespace private_video
+
+} // namespace hoa_video
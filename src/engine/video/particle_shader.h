@@ -0,0 +1,203 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    particle_shader.h
+*** \author  agent
+*** \brief   Header file for drawing particles with an instanced vertex shader
+***
+*** The fixed function path of ParticleSystem::Draw() needs four vertices, four
+*** colors and four texture coordinates for every particle, and rotating the
+*** vertices on the processor costs a sine and cosine for each of them. The
+*** ParticleShader instead draws a single ParticleInstance record per particle
+*** and expands it into a quad in a vertex shader.
+***
+*** The shader requires OpenGL 2.0 and instanced arrays, which are part of
+*** OpenGL 3.3 and otherwise available through the ARB_instanced_arrays and
+*** ARB_draw_instanced extensions. Mesa's software rasterizers (llvmpipe and
+*** softpipe) support both. The engine does not link against any extension
+*** loader, so the entry points are retrieved with VideoEngine::GetGLFunction().
+*** When anything is missing, particles are drawn with the fixed function path.
+*** ***************************************************************************/
+
+#pragma once
+
+#ifdef _VS
+	#include <GL/glew.h>
+#endif
+
+// OpenGL includes
+#ifdef __APPLE__
+	#include <OpenGL/gl.h>
+#else
+	#include <GL/gl.h>
+#endif
+
+#include <cstddef>
+
+#include "defs.h"
+#include "utils.h"
+
+#include "particle.h"
+
+#ifndef APIENTRY
+	#define APIENTRY
+#endif
+
+namespace hoa_video {
+
+namespace private_video {
+
+/** ****************************************************************************
+*** \brief Draws the particles of a system from one instance record per particle
+***
+*** The ParticleManager owns the only object of this class. It is initialized
+*** when the first effect is created, since an OpenGL context must exist by
+*** then, and systems are told whether to generate instance records or the
+*** vertices of the fixed function path when they are created.
+***
+*** A draw consists of a call to Begin(), one or more calls to Draw() (smooth
+*** animation draws the same instances twice with a different frame) and a
+*** call to End(). The instance records are uploaded to a buffer object that is
+*** reused by every system.
+*** ***************************************************************************/
+class ParticleShader {
+public:
+	ParticleShader();
+
+	~ParticleShader()
+		{}
+
+	/** \brief Compiles the shader and creates the buffers that it draws from
+	*** \return True if the shader is available for drawing
+	***
+	*** This must be called with the OpenGL context current. When the context lacks
+	*** any of the required functionality, the reason is printed when VIDEO_DEBUG is
+	*** enabled and the function returns false.
+	**/
+	bool Initialize();
+
+	//! \brief Deletes the program and buffers. Initialize() may be called again afterwards.
+	void Destroy();
+
+	//! \brief Returns true if Initialize() succeeded
+	bool IsAvailable() const
+		{ return _program != 0; }
+
+	/** \brief Uploads the instance records of a system and prepares OpenGL to draw them
+	*** \param instances A pointer to the first instance record
+	*** \param count The number of instance records
+	**/
+	void Begin(const ParticleInstance* instances, uint32 count);
+
+	/** \brief Draws the instances uploaded by the last call to Begin()
+	*** \param count The number of instances to draw
+	*** \param u1 The left texture coordinate of the animation frame
+	*** \param v1 The top texture coordinate of the animation frame
+	*** \param u2 The right texture coordinate of the animation frame
+	*** \param v2 The bottom texture coordinate of the animation frame
+	*** \param color_scale The number that the red, green and blue components of every particle are multiplied by
+	***
+	*** The texture of the frame must already be bound.
+	**/
+	void Draw(uint32 count, float u1, float v1, float u2, float v2, float color_scale);
+
+	//! \brief Restores the OpenGL state that Begin() changed
+	void End();
+
+private:
+	// ---------- OpenGL 1.5, 2.0 and 3.3 functions that are not part of the OpenGL 1.1 headers of every platform
+
+	typedef void (APIENTRY *GenBuffersFunction)(GLsizei, GLuint*);
+	typedef void (APIENTRY *DeleteBuffersFunction)(GLsizei, const GLuint*);
+	typedef void (APIENTRY *BindBufferFunction)(GLenum, GLuint);
+	typedef void (APIENTRY *BufferDataFunction)(GLenum, std::ptrdiff_t, const void*, GLenum);
+	typedef GLuint (APIENTRY *CreateShaderFunction)(GLenum);
+	typedef void (APIENTRY *DeleteShaderFunction)(GLuint);
+	typedef void (APIENTRY *ShaderSourceFunction)(GLuint, GLsizei, const char* const*, const GLint*);
+	typedef void (APIENTRY *CompileShaderFunction)(GLuint);
+	typedef void (APIENTRY *GetShaderivFunction)(GLuint, GLenum, GLint*);
+	typedef void (APIENTRY *GetShaderInfoLogFunction)(GLuint, GLsizei, GLsizei*, char*);
+	typedef GLuint (APIENTRY *CreateProgramFunction)();
+	typedef void (APIENTRY *DeleteProgramFunction)(GLuint);
+	typedef void (APIENTRY *AttachShaderFunction)(GLuint, GLuint);
+	typedef void (APIENTRY *BindAttribLocationFunction)(GLuint, GLuint, const char*);
+	typedef void (APIENTRY *LinkProgramFunction)(GLuint);
+	typedef void (APIENTRY *GetProgramivFunction)(GLuint, GLenum, GLint*);
+	typedef void (APIENTRY *GetProgramInfoLogFunction)(GLuint, GLsizei, GLsizei*, char*);
+	typedef void (APIENTRY *UseProgramFunction)(GLuint);
+	typedef GLint (APIENTRY *GetUniformLocationFunction)(GLuint, const char*);
+	typedef void (APIENTRY *Uniform1fFunction)(GLint, GLfloat);
+	typedef void (APIENTRY *Uniform1iFunction)(GLint, GLint);
+	typedef void (APIENTRY *Uniform4fFunction)(GLint, GLfloat, GLfloat, GLfloat, GLfloat);
+	typedef void (APIENTRY *EnableVertexAttribArrayFunction)(GLuint);
+	typedef void (APIENTRY *DisableVertexAttribArrayFunction)(GLuint);
+	typedef void (APIENTRY *VertexAttribPointerFunction)(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*);
+	typedef void (APIENTRY *VertexAttribDivisorFunction)(GLuint, GLuint);
+	typedef void (APIENTRY *DrawArraysInstancedFunction)(GLenum, GLint, GLsizei, GLsizei);
+
+	GenBuffersFunction _GenBuffers;
+	DeleteBuffersFunction _DeleteBuffers;
+	BindBufferFunction _BindBuffer;
+	BufferDataFunction _BufferData;
+	CreateShaderFunction _CreateShader;
+	DeleteShaderFunction _DeleteShader;
+	ShaderSourceFunction _ShaderSource;
+	CompileShaderFunction _CompileShader;
+	GetShaderivFunction _GetShaderiv;
+	GetShaderInfoLogFunction _GetShaderInfoLog;
+	CreateProgramFunction _CreateProgram;
+	DeleteProgramFunction _DeleteProgram;
+	AttachShaderFunction _AttachShader;
+	BindAttribLocationFunction _BindAttribLocation;
+	LinkProgramFunction _LinkProgram;
+	GetProgramivFunction _GetProgramiv;
+	GetProgramInfoLogFunction _GetProgramInfoLog;
+	UseProgramFunction _UseProgram;
+	GetUniformLocationFunction _GetUniformLocation;
+	Uniform1fFunction _Uniform1f;
+	Uniform1iFunction _Uniform1i;
+	Uniform4fFunction _Uniform4f;
+	EnableVertexAttribArrayFunction _EnableVertexAttribArray;
+	DisableVertexAttribArrayFunction _DisableVertexAttribArray;
+	VertexAttribPointerFunction _VertexAttribPointer;
+	VertexAttribDivisorFunction _VertexAttribDivisor;
+	DrawArraysInstancedFunction _DrawArraysInstanced;
+
+	//! \brief The linked shader program, or zero if the shader is not available
+	GLuint _program;
+
+	//! \brief The buffer holding the four corners of the quad that every instance is expanded into
+	GLuint _corner_buffer;
+
+	//! \brief The buffer that the instance records are uploaded to
+	GLuint _instance_buffer;
+
+	//! \brief The locations of the uniform variables of the program
+	GLint _frame_location;
+	GLint _color_scale_location;
+
+	// ---------- Private methods
+
+	/** \brief Retrieves the address of every OpenGL function that the shader uses
+	*** \return True if every function was found
+	**/
+	bool _LoadFunctions();
+
+	/** \brief Compiles a single shader stage
+	*** \param type Either GL_VERTEX_SHADER or GL_FRAGMENT_SHADER
+	*** \param source The GLSL source code of the stage
+	*** \return The shader object, or zero if it failed to compile
+	**/
+	GLuint _CompileStage(GLenum type, const char* source);
+}; // class ParticleShader
+
+} // namespace private_video
+
+} // namespace hoa_video
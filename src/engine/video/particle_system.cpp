@@ -22,6 +22,17 @@ namespace private_video
 {
 
 
+//-----------------------------------------------------------------------------
+// ParticleSystemDef
+//-----------------------------------------------------------------------------
+
+ParticleSystemDef::~ParticleSystemDef()
+{
+	for(size_t j = 0; j < keyframes.size(); ++j)
+		delete keyframes[j];
+}
+
+
 //-----------------------------------------------------------------------------
 // ParticleSystem
 //-----------------------------------------------------------------------------
@@ -29,6 +40,7 @@ namespace private_video
 ParticleSystem::ParticleSystem()
 {
 	_system_def = nullptr;
+	_shader = nullptr;
 	_max_particles = 0;
 	_num_particles = 0;
 	_age = 0.0f;
@@ -43,23 +55,51 @@ ParticleSystem::ParticleSystem()
 // Create: initializes the particle system from the definition
 //-----------------------------------------------------------------------------
 
-bool ParticleSystem::Create(const ParticleSystemDef *sys_def)
+bool ParticleSystem::Create(const ParticleSystemDef *sys_def, uint32 seed, ParticleShader *shader)
 {
+	// a system recycled by the ParticlePool keeps its arrays, so the resizes below do not allocate
+	// anything when it was last created from the same definition
+	const ParticleSystemDef *previous_def = _system_def;
+
 	_system_def = sys_def;
 	_max_particles = sys_def->max_particles;
 	_num_particles = 0;
+	_random.Seed(seed);
+	_shader = (shader != nullptr && shader->IsAvailable()) ? shader : nullptr;
+
+	_particles.Resize(_max_particles);
 
-	_particles.resize(_max_particles);
-	_particle_vertices.resize(_max_particles * 4);
-	_particle_texcoords.resize(_max_particles * 4);
-	_particle_colors.resize(_max_particles * 4);
+	// only the arrays of the path that the system is drawn with are needed
+	if(_shader != nullptr)
+	{
+		_particle_instances.resize(_max_particles);
+	}
+	else
+	{
+		_particle_vertices.resize(_max_particles * 4);
+		_particle_texcoords.resize(_max_particles * 4);
+		_particle_colors.resize(_max_particles * 4);
+		if(sys_def->smooth_animation)
+		{
+			_next_frame_texcoords.resize(_max_particles * 4);
+			_next_frame_colors.resize(_max_particles * 4);
+		}
+	}
 
 	_alive = true;
 	_stopped = false;
 	_age = 0.0f;
+	_last_update_time = 0.0f;
 
-	size_t num_frames = sys_def->animation_frame_filenames.size();
+	size_t num_frames = sys_def->animation_frames.size();
 
+	if(previous_def == sys_def && _animation.GetNumberOfFrames() == num_frames)
+	{
+		_animation.ResetAnimation();
+		return true;
+	}
+
+	_animation.Clear();
 	for(size_t j = 0; j < num_frames; ++j)
 	{
 		int32 frame_time;
@@ -70,10 +110,10 @@ bool ParticleSystem::Create(const ParticleSystemDef *sys_def)
 		else
 			frame_time = sys_def->animation_frame_times.back();
 
-		_animation.AddFrame(sys_def->animation_frame_filenames[j], frame_time);
+		// the frame images were loaded along with the definition, so this only adds a reference to their textures
+		_animation.AddFrame(sys_def->animation_frames[j], frame_time);
 	}
 
-// 	VideoManager->LoadImage(_animation);
 	return true;
 }
 
@@ -88,289 +128,130 @@ bool ParticleSystem::Draw()
 	if(!_system_def->enabled || _age < _system_def->emitter._start_time)
 		return true;
 
+	// Draw any pending sprites before the particle system changes the GL state
+	VideoManager->_sprite_batch.Flush();
+
+	RenderState &state = VideoManager->_render_state;
+
 	// set blending parameters
 	if(_system_def->blend_mode == VIDEO_NO_BLEND)
 	{
-		glDisable(GL_BLEND);
+		state.Disable(GL_BLEND);
 	}
 	else
 	{
-		glEnable(GL_BLEND);
+		state.Enable(GL_BLEND);
 
 		if(_system_def->blend_mode == VIDEO_BLEND)
-			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			state.SetBlendFunction(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 		else
-			glBlendFunc(GL_SRC_ALPHA, GL_ONE); // additive
+			state.SetBlendFunction(GL_SRC_ALPHA, GL_ONE); // additive
 	}
 
 
 	if(_system_def->use_stencil)
 	{
-		glEnable(GL_STENCIL_TEST);
-		glStencilFunc(GL_EQUAL, 1, 0xFFFFFFFF);
-		glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
-		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		state.Enable(GL_STENCIL_TEST);
+		state.SetStencilFunction(GL_EQUAL, 1, 0xFFFFFFFF);
+		state.SetStencilOperation(GL_KEEP, GL_KEEP, GL_KEEP);
+		state.Disable(GL_ALPHA_TEST);
+		state.SetColorMask(true);
 	}
 	else if(_system_def->modify_stencil)
 	{
-		glEnable(GL_STENCIL_TEST);
+		state.Enable(GL_STENCIL_TEST);
 
 		if(_system_def->stencil_op == VIDEO_STENCIL_OP_INCREASE)
-			glStencilOp(GL_INCR, GL_KEEP, GL_KEEP);
+			state.SetStencilOperation(GL_INCR, GL_KEEP, GL_KEEP);
 		else if(_system_def->stencil_op == VIDEO_STENCIL_OP_DECREASE)
-			glStencilOp(GL_DECR, GL_KEEP, GL_KEEP);
+			state.SetStencilOperation(GL_DECR, GL_KEEP, GL_KEEP);
 		else if(_system_def->stencil_op == VIDEO_STENCIL_OP_ZERO)
-			glStencilOp(GL_ZERO, GL_KEEP, GL_KEEP);
+			state.SetStencilOperation(GL_ZERO, GL_KEEP, GL_KEEP);
 		else
-			glStencilOp(GL_REPLACE, GL_KEEP, GL_KEEP);
+			state.SetStencilOperation(GL_REPLACE, GL_KEEP, GL_KEEP);
 
-		glStencilFunc(GL_NEVER, 1, 0xFFFFFFFF);
-		glEnable(GL_ALPHA_TEST);
-		glAlphaFunc(GL_GREATER, 0.00f);
-		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		state.SetStencilFunction(GL_NEVER, 1, 0xFFFFFFFF);
+		state.Enable(GL_ALPHA_TEST);
+		state.SetAlphaFunction(GL_GREATER, 0.00f);
+		state.SetColorMask(false);
 
 	}
 	else
 	{
-		glDisable(GL_STENCIL_TEST);
-		glDisable(GL_ALPHA_TEST);
-		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		state.Disable(GL_STENCIL_TEST);
+		state.Disable(GL_ALPHA_TEST);
+		state.SetColorMask(true);
 	}
 
-	glEnable(GL_TEXTURE_2D);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	state.Enable(GL_TEXTURE_2D);
 
+	// the vertices were generated by the last update, so only the buffers need to be submitted here.
+	// Particles are always drawn smoothed, which only changes the filter of the texture sheet when it is not already smoothed
 	StillImage *id = _animation.GetFrame(_animation.GetCurrentFrameIndex());
-	ImageTexture *img = id->_image_texture;
-	TextureManager->_BindTexture(img->texture_sheet->tex_id);
-
-
-	float frame_progress = _animation.GetPercentProgress();
-
-	float u1 = img->u1;
-	float u2 = img->u2;
-	float v1 = img->v1;
-	float v2 = img->v2;
-
-	float img_width  = static_cast<float>(img->width);
-	float img_height = static_cast<float>(img->height);
-
-	float img_width_half = img_width * 0.5f;
-	float img_height_half = img_height * 0.5f;
-
-	// fill the vertex array
-	if (_system_def->rotation_used) {
-		int32 v = 0;
-
-		for (int32 j = 0; j < _num_particles; ++j) {
-			float scaled_width_half  = img_width_half * _particles[j].size_x;
-			float scaled_height_half = img_height_half * _particles[j].size_y;
-
-			float rotation_angle = _particles[j].rotation_angle;
-
-			if (_system_def->rotate_to_velocity) {
-				// calculate the angle based on the velocity
-				rotation_angle += UTILS_HALF_PI + atan2f(_particles[j].combined_velocity_y, _particles[j].combined_velocity_x);
-
-				// calculate the scaling due to speed
-				if (_system_def->speed_scale_used) {
-					// speed is magnitude of velocity
-					float speed = sqrtf(_particles[j].combined_velocity_x * _particles[j].combined_velocity_x + _particles[j].combined_velocity_y * _particles[j].combined_velocity_y);
-					float scale_factor = _system_def->speed_scale * speed;
-
-					if(scale_factor < _system_def->min_speed_scale)
-						scale_factor = _system_def->min_speed_scale;
-					if(scale_factor > _system_def->max_speed_scale)
-						scale_factor = _system_def->max_speed_scale;
-
-					scaled_height_half *= scale_factor;
-				}
-			}
-
-			// upper-left vertex
-			_particle_vertices[v]._x = -scaled_width_half;
-			_particle_vertices[v]._y = -scaled_height_half;
-			RotatePoint(_particle_vertices[v]._x, _particle_vertices[v]._y, rotation_angle);
-			_particle_vertices[v]._x += _particles[j].x;
-			_particle_vertices[v]._y += _particles[j].y;
-			++v;
-
-			// upper-right vertex
-			_particle_vertices[v]._x = scaled_width_half;
-			_particle_vertices[v]._y = -scaled_height_half;
-			RotatePoint(_particle_vertices[v]._x, _particle_vertices[v]._y, rotation_angle);
-			_particle_vertices[v]._x += _particles[j].x;
-			_particle_vertices[v]._y += _particles[j].y;
-			++v;
-
-			// lower-right vertex
-			_particle_vertices[v]._x = scaled_width_half;
-			_particle_vertices[v]._y = scaled_height_half;
-			RotatePoint(_particle_vertices[v]._x, _particle_vertices[v]._y, rotation_angle);
-			_particle_vertices[v]._x += _particles[j].x;
-			_particle_vertices[v]._y += _particles[j].y;
-			++v;
-
-			// lower-left vertex
-			_particle_vertices[v]._x = -scaled_width_half;
-			_particle_vertices[v]._y = scaled_height_half;
-			RotatePoint(_particle_vertices[v]._x, _particle_vertices[v]._y, rotation_angle);
-			_particle_vertices[v]._x += _particles[j].x;
-			_particle_vertices[v]._y += _particles[j].y;
-			++v;
-		}
-	}
-	else {
-		int32 v = 0;
-
-		for (int32 j = 0; j < _num_particles; ++j) {
-			float scaled_width_half  = img_width_half * _particles[j].size_x;
-			float scaled_height_half = img_height_half * _particles[j].size_y;
-
-			// upper-left vertex
-			_particle_vertices[v]._x = _particles[j].x - scaled_width_half;
-			_particle_vertices[v]._y = _particles[j].y - scaled_height_half;
-			++v;
-
-			// upper-right vertex
-			_particle_vertices[v]._x = _particles[j].x + scaled_width_half;
-			_particle_vertices[v]._y = _particles[j].y - scaled_height_half;
-			++v;
-
-			// lower-right vertex
-			_particle_vertices[v]._x = _particles[j].x + scaled_width_half;
-			_particle_vertices[v]._y = _particles[j].y + scaled_height_half;
-			++v;
-
-			// lower-left vertex
-			_particle_vertices[v]._x = _particles[j].x - scaled_width_half;
-			_particle_vertices[v]._y = _particles[j].y + scaled_height_half;
-			++v;
-		}
-	}
-
-	// fill the color array
-	int32 c = 0;
-	for (int32 j = 0; j < _num_particles; ++j) {
-		Color color = _particles[j].color;
+	id->_image_texture->texture_sheet->Smooth(true);
+	TextureManager->_BindTexture(id->_image_texture->texture_sheet->tex_id);
 
+	if(_shader != nullptr)
+	{
+		// the shader can only be missing if it failed to be recreated after the OpenGL context changed
+		if(!_shader->IsAvailable())
+			return false;
+		if(_num_particles == 0)
+			return true;
+
+		ImageTexture *img = id->_image_texture;
+		float color_scale = 1.0f;
 		if(_system_def->smooth_animation)
-			color = color * (1.0f - frame_progress);
+			color_scale = 1.0f - _animation.GetPercentProgress();
 
-		_particle_colors[c] = color;
-		++c;
-		_particle_colors[c] = color;
-		++c;
-		_particle_colors[c] = color;
-		++c;
-		_particle_colors[c] = color;
-		++c;
-	}
+		// the shader reads generic vertex attributes only, which may alias the fixed function arrays
+		state.DisableClientState(GL_VERTEX_ARRAY);
+		state.DisableClientState(GL_COLOR_ARRAY);
+		state.DisableClientState(GL_TEXTURE_COORD_ARRAY);
 
-	// fill the texcoord array
+		_shader->Begin(&_particle_instances[0], _num_particles);
+		_shader->Draw(_num_particles, img->u1, img->v1, img->u2, img->v2, color_scale);
+		VideoManager->_num_draw_calls++;
 
-	int32 t = 0;
-	for (int32 j = 0; j < _num_particles; ++j) {
-		// upper-left
-		_particle_texcoords[t]._t0 = u1;
-		_particle_texcoords[t]._t1 = v1;
-		++t;
-
-		// upper-right
-		_particle_texcoords[t]._t0 = u2;
-		_particle_texcoords[t]._t1 = v1;
-		++t;
+		if(_system_def->smooth_animation)
+		{
+			int findex = (_animation.GetCurrentFrameIndex() + 1) % _animation.GetNumberOfFrames();
+			ImageTexture *img2 = _animation.GetFrame(findex)->_image_texture;
+			img2->texture_sheet->Smooth(true);
+			TextureManager->_BindTexture(img2->texture_sheet->tex_id);
 
-		// lower-right
-		_particle_texcoords[t]._t0 = u2;
-		_particle_texcoords[t]._t1 = v2;
-		++t;
+			_shader->Draw(_num_particles, img2->u1, img2->v1, img2->u2, img2->v2, _animation.GetPercentProgress());
+			VideoManager->_num_draw_calls++;
+		}
 
-		// lower-left
-		_particle_texcoords[t]._t0 = u1;
-		_particle_texcoords[t]._t1 = v2;
-		++t;
+		_shader->End();
+		return true;
 	}
 
-	glEnableClientState(GL_VERTEX_ARRAY);
-	glEnableClientState(GL_COLOR_ARRAY);
-	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	state.EnableClientState(GL_VERTEX_ARRAY);
+	state.EnableClientState(GL_COLOR_ARRAY);
+	state.EnableClientState(GL_TEXTURE_COORD_ARRAY);
 	glVertexPointer   (2, GL_FLOAT, 0, &_particle_vertices[0]);
 	glColorPointer    (4, GL_FLOAT, 0, &_particle_colors[0]);
 	glTexCoordPointer (2, GL_FLOAT, 0, &_particle_texcoords[0]);
 
 	glDrawArrays(GL_QUADS, 0, _num_particles * 4);
-
-	glDisableClientState(GL_VERTEX_ARRAY);
+	VideoManager->_num_draw_calls++;
 
 	if(_system_def->smooth_animation) {
-		glEnableClientState(GL_VERTEX_ARRAY);
-
 		int findex = _animation.GetCurrentFrameIndex();
 		findex = (findex + 1) % _animation.GetNumberOfFrames();
 
 		StillImage *id2 = _animation.GetFrame(findex);
-		ImageTexture *img2 = id2->_image_texture;
-		TextureManager->_BindTexture(img2->texture_sheet->tex_id);
-
-
-		u1 = img2->u1;
-		u2 = img2->u2;
-		v1 = img2->v1;
-		v2 = img2->v2;
-
-
-		t = 0;
-		for(int32 j = 0; j < _num_particles; ++j) {
-			// upper-left
-			_particle_texcoords[t]._t0 = u1;
-			_particle_texcoords[t]._t1 = v1;
-			++t;
-
-			// upper-right
-			_particle_texcoords[t]._t0 = u2;
-			_particle_texcoords[t]._t1 = v1;
-			++t;
-
-			// lower-right
-			_particle_texcoords[t]._t0 = u2;
-			_particle_texcoords[t]._t1 = v2;
-			++t;
-
-			// lower-left
-			_particle_texcoords[t]._t0 = u1;
-			_particle_texcoords[t]._t1 = v2;
-			++t;
-		}
-
-
-
-		c = 0;
-		for(int32 j = 0; j < _num_particles; ++j) {
-			Color color = _particles[j].color;
-			color = color * frame_progress;
-
-			_particle_colors[c] = color;
-			++c;
-			_particle_colors[c] = color;
-			++c;
-			_particle_colors[c] = color;
-			++c;
-			_particle_colors[c] = color;
-			++c;
-		}
+		id2->_image_texture->texture_sheet->Smooth(true);
+		TextureManager->_BindTexture(id2->_image_texture->texture_sheet->tex_id);
 
 		glVertexPointer   (2, GL_FLOAT, 0, &_particle_vertices[0]);
-		glColorPointer    (4, GL_FLOAT, 0, &_particle_colors[0]);
-		glTexCoordPointer (2, GL_FLOAT, 0, &_particle_texcoords[0]);
+		glColorPointer    (4, GL_FLOAT, 0, &_next_frame_colors[0]);
+		glTexCoordPointer (2, GL_FLOAT, 0, &_next_frame_texcoords[0]);
 
 		glDrawArrays(GL_QUADS, 0, _num_particles * 4);
-
-		glDisableClientState(GL_VERTEX_ARRAY);
-		glDisableClientState(GL_COLOR_ARRAY);
-		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+		VideoManager->_num_draw_calls++;
 	}
 
 	return true;
@@ -415,7 +296,8 @@ bool ParticleSystem::Update(float frame_time, const EffectParameters &params)
 		return true;
 	}
 
-	_animation.Update();
+	// the update time of the system manager is not read here, since it may change while this runs on a worker thread
+	_animation.Update(static_cast<uint32>(frame_time * 1000.0f + 0.5f));
 
 	// update properties of existing particles
 	_UpdateParticles(frame_time, params);
@@ -472,6 +354,11 @@ bool ParticleSystem::Update(float frame_time, const EffectParameters &params)
 		_alive = false;
 	}
 
+	if(_shader != nullptr)
+		_GenerateInstances();
+	else
+		_GenerateVertices();
+
 	_last_update_time = _age;
 	return true;
 }
@@ -493,8 +380,9 @@ int32 ParticleSystem::GetNumParticles() const
 
 void ParticleSystem::Destroy()
 {
-	_particles.clear();
+	_particles.Resize(0);
 	_particle_vertices.clear();
+	_particle_instances.clear();
 }
 
 
@@ -514,209 +402,31 @@ void ParticleSystem::Stop()
 
 void ParticleSystem::_UpdateParticles(float t, const EffectParameters &params)
 {
-	for(int j = 0; j < _num_particles; ++j)
+	ParticleStep step;
+	step.time = t;
+	step.wave_motion = _system_def->wave_motion_used;
+
+	// radial and tangential acceleration are relative to the attractor, which is the emitter center
+	// unless the effect has a user defined attractor
+	step.attractor_forces = (_system_def->radial_acceleration != 0.0f || _system_def->radial_acceleration_variation != 0.0f ||
+		_system_def->tangential_acceleration != 0.0f || _system_def->tangential_acceleration_variation != 0.0f);
+	if(_system_def->user_defined_attractor)
 	{
-		// calculate a time for the particle from 0 to 1 since this is what
-		// the keyframes are based on
-		float scaled_time = _particles[j].time / _particles[j].lifetime;
-
-		// figure out which keyframe we're on
-		if(_particles[j].next_keyframe)
-		{
-			ParticleKeyframe *old_next = _particles[j].next_keyframe;
-
-			// check if we need to advance the keyframe
-			if(scaled_time >= _particles[j].next_keyframe->time)
-			{
-				// figure out what keyframe we're on
-				size_t num_keyframes = _system_def->keyframes.size();
-
-				size_t k;
-				for(k = 0; k < num_keyframes; ++k)
-				{
-					if(_system_def->keyframes[k]->time > scaled_time)
-					{
-						_particles[j].current_keyframe = _system_def->keyframes[k - 1];
-						_particles[j].next_keyframe    = _system_def->keyframes[k];
-						break;
-					}
-				}
-
-				// if we didn't find any keyframe whose time is larger than this
-				// particle's time, then we are on the last one
-				if(k == num_keyframes)
-				{
-					_particles[j].current_keyframe = _system_def->keyframes[k - 1];
-					_particles[j].next_keyframe = nullptr;
-
-					// set all of the keyframed properties to the value stored in the last
-					// keyframe
-					_particles[j].color          = _particles[j].current_keyframe->color;
-					_particles[j].rotation_speed = _particles[j].current_keyframe->rotation_speed;
-					_particles[j].size_x         = _particles[j].current_keyframe->size_x;
-					_particles[j].size_y         = _particles[j].current_keyframe->size_y;
-				}
-
-				// if we skipped ahead only 1 keyframe, then inherit the current variations
-				// from the next ones
-				if(_particles[j].current_keyframe == old_next)
-				{
-					_particles[j].current_color_variation = _particles[j].next_color_variation;
-					_particles[j].current_rotation_speed_variation = _particles[j].current_rotation_speed_variation;
-					_particles[j].current_size_variation_x = _particles[j].next_size_variation_x;
-					_particles[j].current_size_variation_y = _particles[j].next_size_variation_y;
-				}
-				else
-				{
-					_particles[j].current_rotation_speed_variation = RandomFloat(-_particles[j].current_keyframe->rotation_speed_variation, _particles[j].current_keyframe->rotation_speed_variation);
-					for(int32 c = 0; c < 4; ++c)
-						_particles[j].current_color_variation[c] = RandomFloat(-_particles[j].current_keyframe->color_variation[c], _particles[j].current_keyframe->color_variation[c]);
-					_particles[j].current_size_variation_x = RandomFloat(-_particles[j].current_keyframe->size_variation_x, _particles[j].current_keyframe->size_variation_x);
-					_particles[j].current_size_variation_y = RandomFloat(-_particles[j].current_keyframe->size_variation_y, _particles[j].current_keyframe->size_variation_y);
-				}
-
-				// if there is a next keyframe, generate variations for it
-				if(_particles[j].next_keyframe)
-				{
-					_particles[j].next_rotation_speed_variation = RandomFloat(-_particles[j].next_keyframe->rotation_speed_variation, _particles[j].next_keyframe->rotation_speed_variation);
-					for(int32 c = 0; c < 4; ++c)
-						_particles[j].next_color_variation[c] = RandomFloat(-_particles[j].next_keyframe->color_variation[c], _particles[j].next_keyframe->color_variation[c]);
-					_particles[j].next_size_variation_x = RandomFloat(-_particles[j].next_keyframe->size_variation_x, _particles[j].next_keyframe->size_variation_x);
-					_particles[j].next_size_variation_y = RandomFloat(-_particles[j].next_keyframe->size_variation_y, _particles[j].next_keyframe->size_variation_y);
-				}
-			}
-		}
-
-
-		// if we aren't already at the last keyframe, interpolate to figure out the
-		// current keyframed properties
-		if(_particles[j].next_keyframe)
-		{
-			// figure out how far we are from the current to the next (0.0 to 1.0)
-			float a = (scaled_time - _particles[j].current_keyframe->time) / (_particles[j].next_keyframe->time - _particles[j].current_keyframe->time);
-
-			_particles[j].rotation_speed = Lerp(a, _particles[j].current_keyframe->rotation_speed + _particles[j].current_rotation_speed_variation, _particles[j].next_keyframe->rotation_speed + _particles[j].next_rotation_speed_variation);
-			_particles[j].size_x         = Lerp(a, _particles[j].current_keyframe->size_x + _particles[j].current_size_variation_x, _particles[j].next_keyframe->size_x + _particles[j].next_size_variation_x);
-			_particles[j].size_y         = Lerp(a, _particles[j].current_keyframe->size_y + _particles[j].current_size_variation_y, _particles[j].next_keyframe->size_y + _particles[j].next_size_variation_y);
-			_particles[j].color[0]       = Lerp(a, _particles[j].current_keyframe->color[0] + _particles[j].current_color_variation[0], _particles[j].next_keyframe->color[0] + _particles[j].next_color_variation[0]);
-			_particles[j].color[1]       = Lerp(a, _particles[j].current_keyframe->color[1] + _particles[j].current_color_variation[1], _particles[j].next_keyframe->color[1] + _particles[j].next_color_variation[1]);
-			_particles[j].color[2]       = Lerp(a, _particles[j].current_keyframe->color[2] + _particles[j].current_color_variation[2], _particles[j].next_keyframe->color[2] + _particles[j].next_color_variation[2]);
-			_particles[j].color[3]       = Lerp(a, _particles[j].current_keyframe->color[3] + _particles[j].current_color_variation[3], _particles[j].next_keyframe->color[3] + _particles[j].next_color_variation[3]);
-		}
-
-
-		_particles[j].rotation_angle += _particles[j].rotation_speed * _particles[j].rotation_direction * t;
-
-		float wind_velocity_x = _particles[j].wind_velocity_x;
-		float wind_velocity_y = _particles[j].wind_velocity_y;
-
-		_particles[j].combined_velocity_x = _particles[j].velocity_x + wind_velocity_x;
-		_particles[j].combined_velocity_y = _particles[j].velocity_y + wind_velocity_y;
-
-		if(_system_def->wave_motion_used && _particles[j].wave_half_amplitude > 0.0f)
-		{
-			// find the magnitude of the wave velocity
-// 			float half_amp = _particles[j].wave_half_amplitude; UNUSED VARIABLE
-// 			float wcoef = _particles[j].wave_length_coefficient; UNUSED VARIABLE
-			float wave_speed = _particles[j].wave_half_amplitude * sinf(_particles[j].wave_length_coefficient * _particles[j].time);
-
-			// now the wave velocity is just that wave speed times the particle's tangential vector
-			float tangent_x = -_particles[j].combined_velocity_y;
-			float tangent_y = _particles[j].combined_velocity_x;
-			float speed = sqrtf(tangent_x * tangent_x + tangent_y * tangent_y);
-			tangent_x /= speed;
-			tangent_y /= speed;
-
-			float wave_velocity_x = tangent_x * wave_speed;
-			float wave_velocity_y = tangent_y * wave_speed;
-
-			_particles[j].combined_velocity_x += wave_velocity_x;
-			_particles[j].combined_velocity_y += wave_velocity_y;
-		}
-
-		_particles[j].x += (_particles[j].combined_velocity_x) * t;
-		_particles[j].y += (_particles[j].combined_velocity_y) * t;
-
-
-		// client-specified acceleration (dv = a * t)
-		_particles[j].velocity_x += _particles[j].acceleration_x * t;
-		_particles[j].velocity_y += _particles[j].acceleration_y * t;
-
-		// radial acceleration: calculate unit vector from emitter center to this particle,
-		// and scale by the radial acceleration, if there is any
-
-
-		bool use_radial     = (_particles[j].radial_acceleration != 0.0f);
-		bool use_tangential = (_particles[j].tangential_acceleration != 0.0f);
-
-
-		if(use_radial || use_tangential)
-		{
-			// unit vector from attractor to particle
-			float attractor_to_particle_x;
-			float attractor_to_particle_y;
-
-			if(_system_def->user_defined_attractor)
-			{
-				attractor_to_particle_x = _particles[j].x - params.attractor_x;
-				attractor_to_particle_y = _particles[j].y - params.attractor_y;
-			}
-			else
-			{
-				attractor_to_particle_x = _particles[j].x - _system_def->emitter._center_x;
-				attractor_to_particle_y = _particles[j].y - _system_def->emitter._center_y;
-			}
-
-			float distance = sqrtf(attractor_to_particle_x * attractor_to_particle_x + attractor_to_particle_y * attractor_to_particle_y);
-
-			if(distance != 0.0f)
-			{
-				attractor_to_particle_x /= distance;
-				attractor_to_particle_y /= distance;
-			}
-
-			// radial acceleration
-			if(use_radial)
-			{
-				if(_system_def->attractor_falloff != 0.0f)
-				{
-					float attraction = 1.0f - _system_def->attractor_falloff * distance;
-					if(attraction > 0.0f)
-					{
-						_particles[j].velocity_x += attractor_to_particle_x * _particles[j].radial_acceleration * t * attraction;
-						_particles[j].velocity_y += attractor_to_particle_y * _particles[j].radial_acceleration * t * attraction;
-					}
-				}
-				else
-				{
-					_particles[j].velocity_x += attractor_to_particle_x * _particles[j].radial_acceleration * t;
-					_particles[j].velocity_y += attractor_to_particle_y * _particles[j].radial_acceleration * t;
-				}
-			}
-
-			// tangential acceleration
-			if(use_tangential)
-			{
-				// tangent vector is simply perpendicular vector
-				float tangent_x = -attractor_to_particle_y;
-				float tangent_y = attractor_to_particle_x;
-
-				_particles[j].velocity_x += tangent_x * _particles[j].tangential_acceleration * t;
-				_particles[j].velocity_y += tangent_y * _particles[j].tangential_acceleration * t;
-			}
-		}
-
-
-		// damp the velocity
+		step.attractor_x = params.attractor_x;
+		step.attractor_y = params.attractor_y;
+	}
+	else
+	{
+		step.attractor_x = _system_def->emitter._center_x;
+		step.attractor_y = _system_def->emitter._center_y;
+	}
+	step.attractor_falloff = _system_def->attractor_falloff;
 
-		if(_particles[j].damping != 1.0f)
-		{
-			_particles[j].velocity_x *= pow(_particles[j].damping, t);
-			_particles[j].velocity_y *= pow(_particles[j].damping, t);
-		}
+	// when every particle has the same damping, the damping factor is only calculated once
+	step.uniform_damping = (_system_def->damping_variation == 0.0f);
+	step.damping = _system_def->damping;
 
-		_particles[j].time += t;
-	}
+	UpdateParticles(_particles, _num_particles, _system_def->keyframes, _system_def->keyframe_times, step, _random);
 }
 
 
@@ -732,7 +442,7 @@ void ParticleSystem::_KillParticles(int32 &num, const EffectParameters &params)
 	// check each active particle to see if it is expired
 	for(int j = 0; j < _num_particles; ++j)
 	{
-		if(_particles[j].time > _particles[j].lifetime)
+		if(_particles.time[j] > _particles.lifetime[j])
 		{
 			if(num > 0)
 			{
@@ -777,7 +487,7 @@ void ParticleSystem::_EmitParticles(int32 num, const EffectParameters &params)
 
 void ParticleSystem::_MoveParticle(int32 src, int32 dest)
 {
-	_particles[dest] = _particles[src];
+	_particles.Move(src, dest);
 }
 
 
@@ -794,21 +504,21 @@ void ParticleSystem::_RespawnParticle(int32 i, const EffectParameters &params)
 	{
 		case EMITTER_SHAPE_POINT:
 		{
-			_particles[i].x = emitter._x;
-			_particles[i].y = emitter._y;
+			_particles.x[i] = emitter._x;
+			_particles.y[i] = emitter._y;
 			break;
 		}
 		case EMITTER_SHAPE_LINE:
 		{
-			_particles[i].x = RandomFloat(emitter._x, emitter._x2);
-			_particles[i].y = RandomFloat(emitter._y, emitter._y2);
+			_particles.x[i] = _random.NextFloat(emitter._x, emitter._x2);
+			_particles.y[i] = _random.NextFloat(emitter._y, emitter._y2);
 			break;
 		}
 		case EMITTER_SHAPE_CIRCLE:
 		{
-			float angle = RandomFloat(0.0f, UTILS_2PI);
-			_particles[i].x = emitter._radius * cosf(angle);
-			_particles[i].y = emitter._radius * sinf(angle);
+			float angle = _random.NextFloat(0.0f, UTILS_2PI);
+			_particles.x[i] = emitter._radius * cosf(angle);
+			_particles.y[i] = emitter._radius * sinf(angle);
 			break;
 		}
 		case EMITTER_SHAPE_FILLED_CIRCLE:
@@ -821,18 +531,18 @@ void ParticleSystem::_RespawnParticle(int32 i, const EffectParameters &params)
 			do
 			{
 				float half_radius = emitter._radius * 0.5f;
-				_particles[i].x = RandomFloat(-half_radius, half_radius);
-				_particles[i].y = RandomFloat(-half_radius, half_radius);
-			} while(_particles[i].x * _particles[i].x +
-			        _particles[i].y * _particles[i].y > radius_squared);
+				_particles.x[i] = _random.NextFloat(-half_radius, half_radius);
+				_particles.y[i] = _random.NextFloat(-half_radius, half_radius);
+			} while(_particles.x[i] * _particles.x[i] +
+			        _particles.y[i] * _particles.y[i] > radius_squared);
 
 
 			break;
 		}
 		case EMITTER_SHAPE_FILLED_RECTANGLE:
 		{
-			_particles[i].x = RandomFloat(emitter._x, emitter._x2);
-			_particles[i].y = RandomFloat(emitter._y, emitter._y2);
+			_particles.x[i] = _random.NextFloat(emitter._x, emitter._x2);
+			_particles.y[i] = _random.NextFloat(emitter._y, emitter._y2);
 			break;
 		}
 		default:
@@ -840,46 +550,37 @@ void ParticleSystem::_RespawnParticle(int32 i, const EffectParameters &params)
 	};
 
 
-	_particles[i].x += RandomFloat(-emitter._x_variation, emitter._x_variation);
-	_particles[i].y += RandomFloat(-emitter._y_variation, emitter._y_variation);
+	_particles.x[i] += _random.NextFloat(-emitter._x_variation, emitter._x_variation);
+	_particles.y[i] += _random.NextFloat(-emitter._y_variation, emitter._y_variation);
 
 	if(params.orientation != 0.0f)
-		RotatePoint(_particles[i].x, _particles[i].y, params.orientation);
-
-	_particles[i].color = _system_def->keyframes[0]->color;
+		RotatePoint(_particles.x[i], _particles.y[i], params.orientation);
 
-	_particles[i].rotation_speed  = _system_def->keyframes[0]->rotation_speed;
-	_particles[i].time            = 0.0f;
-	_particles[i].size_x            = _system_def->keyframes[0]->size_x;
-	_particles[i].size_y            = _system_def->keyframes[0]->size_y;
+	_particles.time[i] = 0.0f;
 
 	if(_system_def->random_initial_angle)
-		_particles[i].rotation_angle = RandomFloat(0.0f, UTILS_2PI);
+		_particles.rotation_angle[i] = _random.NextFloat(0.0f, UTILS_2PI);
 	else
-		_particles[i].rotation_angle = 0.0f;
-
-	_particles[i].current_keyframe = _system_def->keyframes[0];
+		_particles.rotation_angle[i] = 0.0f;
 
-	if(_system_def->keyframes.size() > 1)
-		_particles[i].next_keyframe = _system_def->keyframes[1];
-	else
-		_particles[i].next_keyframe = nullptr;
+	// set the keyframed properties and choose the variations for the first two keyframes
+	SetParticleKeyframe(_particles, i, 0, _system_def->keyframes, _system_def->keyframe_times, true, _random);
 
 	float speed = _system_def->emitter._initial_speed;
-	speed += RandomFloat(-emitter._initial_speed_variation, emitter._initial_speed_variation);
+	speed += _random.NextFloat(-emitter._initial_speed_variation, emitter._initial_speed_variation);
 
 
 	if(_system_def->emitter._spin == EMITTER_SPIN_CLOCKWISE)
 	{
-		_particles[i].rotation_direction = 1.0f;
+		_particles.rotation_direction[i] = 1.0f;
 	}
 	else if(_system_def->emitter._spin == EMITTER_SPIN_COUNTERCLOCKWISE)
 	{
-		_particles[i].rotation_direction = -1.0f;
+		_particles.rotation_direction[i] = -1.0f;
 	}
 	else
 	{
-		_particles[i].rotation_direction = static_cast<float>(2 * (rand()%2)) - 1.0f;
+		_particles.rotation_direction[i] = static_cast<float>(2 * (_random.NextInteger() % 2)) - 1.0f;
 	}
 
 	// figure out the orientation
@@ -888,92 +589,313 @@ void ParticleSystem::_RespawnParticle(int32 i, const EffectParameters &params)
 
 	if(emitter._omnidirectional)
 	{
-		angle = RandomFloat(0.0f, UTILS_2PI);
+		angle = _random.NextFloat(0.0f, UTILS_2PI);
 	}
 	else if(emitter._inner_cone == 0.0f && emitter._outer_cone == 0.0f)
 	{
 		angle = emitter._orientation + params.orientation;
 	}
 
-	_particles[i].velocity_x = speed * cosf(angle);
-	_particles[i].velocity_y = speed * sinf(angle);
+	_particles.velocity_x[i] = speed * cosf(angle);
+	_particles.velocity_y[i] = speed * sinf(angle);
 
-	// figure out property variations
+	_particles.tangential_acceleration[i] = _system_def->tangential_acceleration;
+	if(_system_def->tangential_acceleration_variation != 0.0f)
+		_particles.tangential_acceleration[i] += _random.NextFloat(-_system_def->tangential_acceleration_variation, _system_def->tangential_acceleration_variation);
 
-	_particles[i].current_size_variation_x  = RandomFloat(-_system_def->keyframes[0]->size_variation_x, _system_def->keyframes[0]->size_variation_x);
-	_particles[i].current_size_variation_y  = RandomFloat(-_system_def->keyframes[0]->size_variation_y, _system_def->keyframes[0]->size_variation_y);
+	_particles.radial_acceleration[i] = _system_def->radial_acceleration;
+	if(_system_def->radial_acceleration_variation != 0.0f)
+		_particles.radial_acceleration[i] += _random.NextFloat(-_system_def->radial_acceleration_variation, _system_def->radial_acceleration_variation);
 
-	for(int32 j = 0; j < 4; ++j)
-		_particles[i].current_color_variation[j] = RandomFloat(-_system_def->keyframes[0]->color_variation[j], _system_def->keyframes[0]->color_variation[j]);
+	_particles.acceleration_x[i] = _system_def->acceleration_x;
+	if(_system_def->acceleration_variation_x != 0.0f)
+		_particles.acceleration_x[i] += _random.NextFloat(-_system_def->acceleration_variation_x, _system_def->acceleration_variation_x);
 
-	_particles[i].current_rotation_speed_variation = RandomFloat(-_system_def->keyframes[0]->rotation_speed_variation, _system_def->keyframes[0]->rotation_speed_variation);
+	_particles.acceleration_y[i] = _system_def->acceleration_y;
+	if(_system_def->acceleration_variation_y != 0.0f)
+		_particles.acceleration_y[i] += _random.NextFloat(-_system_def->acceleration_variation_y, _system_def->acceleration_variation_y);
+
+	_particles.wind_velocity_x[i] = _system_def->wind_velocity_x;
+	if(_system_def->wind_velocity_variation_x != 0.0f)
+		_particles.wind_velocity_x[i] += _random.NextFloat(-_system_def->wind_velocity_variation_x, _system_def->wind_velocity_variation_x);
 
-	if(_system_def->keyframes.size() > 1)
+	_particles.wind_velocity_y[i] = _system_def->wind_velocity_y;
+	if(_system_def->wind_velocity_variation_y != 0.0f)
+		_particles.wind_velocity_y[i] += _random.NextFloat(-_system_def->wind_velocity_variation_y, _system_def->wind_velocity_variation_y);
+
+	_particles.damping[i] = _system_def->damping;
+	if(_system_def->damping_variation != 0.0f)
+		_particles.damping[i] += _random.NextFloat(-_system_def->damping_variation, _system_def->damping_variation);
+
+	if(_system_def->wave_motion_used)
 	{
-		// figure out the next keyframe's variations
-		_particles[i].next_size_variation_x  = RandomFloat(-_system_def->keyframes[1]->size_variation_x, _system_def->keyframes[1]->size_variation_x);
-		_particles[i].next_size_variation_y  = RandomFloat(-_system_def->keyframes[1]->size_variation_y, _system_def->keyframes[1]->size_variation_y);
+		_particles.wave_length_coefficient[i] = _system_def->wave_length;
+		if(_system_def->wave_length_variation != 0.0f)
+			_particles.wave_length_coefficient[i] += _random.NextFloat(-_system_def->wave_length_variation, _system_def->wave_length_variation);
 
-		for(int32 j = 0; j < 4; ++j)
-			_particles[i].next_color_variation[j] = RandomFloat(-_system_def->keyframes[1]->color_variation[j], _system_def->keyframes[1]->color_variation[j]);
+		_particles.wave_length_coefficient[i] = UTILS_2PI / _particles.wave_length_coefficient[i];
 
-		_particles[i].next_rotation_speed_variation = RandomFloat(-_system_def->keyframes[1]->rotation_speed_variation, _system_def->keyframes[1]->rotation_speed_variation);
+		_particles.wave_half_amplitude[i] = _system_def->wave_amplitude;
+		if(_system_def->wave_amplitude != 0.0f)
+			_particles.wave_half_amplitude[i] += _random.NextFloat(-_system_def->wave_amplitude_variation, _system_def->wave_amplitude_variation);
+		_particles.wave_half_amplitude[i] *= 0.5f;
 	}
-	else
-	{
-		// if there's only 1 keyframe, then apply the variations now
-		for(int32 j = 0; j < 4; ++j)
-			_particles[i].color[j] += RandomFloat(-_particles[i].current_color_variation[j], _particles[i].current_color_variation[j]);
 
-		_particles[i].size_x += RandomFloat(-_particles[i].current_size_variation_x, _particles[i].current_size_variation_x);
-		_particles[i].size_y += RandomFloat(-_particles[i].current_size_variation_y, _particles[i].current_size_variation_y);
+	_particles.lifetime[i] = _system_def->particle_lifetime + _random.NextFloat(-_system_def->particle_lifetime_variation, _system_def->particle_lifetime_variation);
+	_particles.inverse_lifetime[i] = 1.0f / _particles.lifetime[i];
+}
+
+
+//-----------------------------------------------------------------------------
+// _GenerateVertices: helper function to Update(), fills the arrays that Draw()
+//                    submits to OpenGL
+//-----------------------------------------------------------------------------
+
+void ParticleSystem::_GenerateVertices()
+{
+	StillImage *id = _animation.GetFrame(_animation.GetCurrentFrameIndex());
+	ImageTexture *img = id->_image_texture;
+
+	float frame_progress = _animation.GetPercentProgress();
 
-		_particles[i].rotation_speed += RandomFloat(-_particles[i].current_rotation_speed_variation, _particles[i].current_rotation_speed_variation);
+	float u1 = img->u1;
+	float u2 = img->u2;
+	float v1 = img->v1;
+	float v2 = img->v2;
+
+	float img_width  = static_cast<float>(img->width);
+	float img_height = static_cast<float>(img->height);
+
+	float img_width_half = img_width * 0.5f;
+	float img_height_half = img_height * 0.5f;
+
+	// fill the vertex array
+	if (_system_def->rotation_used) {
+		int32 v = 0;
+
+		for (int32 j = 0; j < _num_particles; ++j) {
+			float scaled_width_half  = img_width_half * _particles.size_x[j];
+			float scaled_height_half = img_height_half * _particles.size_y[j];
+
+			float rotation_angle;
+			_ComputeRotation(j, rotation_angle, scaled_height_half);
+
+			// the four corners share the same rotation, so the sine and cosine are only computed once
+			float cos_angle = cosf(rotation_angle);
+			float sin_angle = sinf(rotation_angle);
+			float right_x = scaled_width_half * cos_angle;
+			float right_y = scaled_width_half * sin_angle;
+			float down_x = -scaled_height_half * sin_angle;
+			float down_y = scaled_height_half * cos_angle;
+
+			// upper-left vertex
+			_particle_vertices[v]._x = _particles.x[j] - right_x - down_x;
+			_particle_vertices[v]._y = _particles.y[j] - right_y - down_y;
+			++v;
+
+			// upper-right vertex
+			_particle_vertices[v]._x = _particles.x[j] + right_x - down_x;
+			_particle_vertices[v]._y = _particles.y[j] + right_y - down_y;
+			++v;
+
+			// lower-right vertex
+			_particle_vertices[v]._x = _particles.x[j] + right_x + down_x;
+			_particle_vertices[v]._y = _particles.y[j] + right_y + down_y;
+			++v;
+
+			// lower-left vertex
+			_particle_vertices[v]._x = _particles.x[j] - right_x + down_x;
+			_particle_vertices[v]._y = _particles.y[j] - right_y + down_y;
+			++v;
+		}
 	}
+	else {
+		int32 v = 0;
 
-	_particles[i].tangential_acceleration = _system_def->tangential_acceleration;
-	if(_system_def->tangential_acceleration_variation != 0.0f)
-		_particles[i].tangential_acceleration += RandomFloat(-_system_def->tangential_acceleration_variation, _system_def->tangential_acceleration_variation);
+		for (int32 j = 0; j < _num_particles; ++j) {
+			float scaled_width_half  = img_width_half * _particles.size_x[j];
+			float scaled_height_half = img_height_half * _particles.size_y[j];
 
-	_particles[i].radial_acceleration = _system_def->radial_acceleration;
-	if(_system_def->radial_acceleration_variation != 0.0f)
-		_particles[i].radial_acceleration += RandomFloat(-_system_def->radial_acceleration_variation, _system_def->radial_acceleration_variation);
+			// upper-left vertex
+			_particle_vertices[v]._x = _particles.x[j] - scaled_width_half;
+			_particle_vertices[v]._y = _particles.y[j] - scaled_height_half;
+			++v;
 
-	_particles[i].acceleration_x = _system_def->acceleration_x;
-	if(_system_def->acceleration_variation_x != 0.0f)
-		_particles[i].acceleration_x += RandomFloat(-_system_def->acceleration_variation_x, _system_def->acceleration_variation_x);
+			// upper-right vertex
+			_particle_vertices[v]._x = _particles.x[j] + scaled_width_half;
+			_particle_vertices[v]._y = _particles.y[j] - scaled_height_half;
+			++v;
 
-	_particles[i].acceleration_y = _system_def->acceleration_y;
-	if(_system_def->acceleration_variation_y != 0.0f)
-		_particles[i].acceleration_y += RandomFloat(-_system_def->acceleration_variation_y, _system_def->acceleration_variation_y);
+			// lower-right vertex
+			_particle_vertices[v]._x = _particles.x[j] + scaled_width_half;
+			_particle_vertices[v]._y = _particles.y[j] + scaled_height_half;
+			++v;
 
-	_particles[i].wind_velocity_x = _system_def->wind_velocity_x;
-	if(_system_def->wind_velocity_variation_x != 0.0f)
-		_particles[i].wind_velocity_x += RandomFloat(-_system_def->wind_velocity_variation_x, _system_def->wind_velocity_variation_x);
+			// lower-left vertex
+			_particle_vertices[v]._x = _particles.x[j] - scaled_width_half;
+			_particle_vertices[v]._y = _particles.y[j] + scaled_height_half;
+			++v;
+		}
+	}
 
-	_particles[i].wind_velocity_y = _system_def->wind_velocity_y;
-	if(_system_def->wind_velocity_variation_y != 0.0f)
-		_particles[i].wind_velocity_y += RandomFloat(-_system_def->wind_velocity_variation_y, _system_def->wind_velocity_variation_y);
+	// fill the color array
+	int32 c = 0;
+	for (int32 j = 0; j < _num_particles; ++j) {
+		Color color = _particles.GetColor(j);
 
-	_particles[i].damping = _system_def->damping;
-	if(_system_def->damping_variation != 0.0f)
-		_particles[i].damping += RandomFloat(-_system_def->damping_variation, _system_def->damping_variation);
+		if(_system_def->smooth_animation)
+			color = color * (1.0f - frame_progress);
 
-	if(_system_def->wave_motion_used)
-	{
-		_particles[i].wave_length_coefficient = _system_def->wave_length;
-		if(_system_def->wave_length_variation != 0.0f)
-			_particles[i].wave_length_coefficient += RandomFloat(-_system_def->wave_length_variation, _system_def->wave_length_variation);
+		_particle_colors[c] = color;
+		++c;
+		_particle_colors[c] = color;
+		++c;
+		_particle_colors[c] = color;
+		++c;
+		_particle_colors[c] = color;
+		++c;
+	}
 
-		_particles[i].wave_length_coefficient = UTILS_2PI / _particles[i].wave_length_coefficient;
+	// fill the texcoord array
 
-		_particles[i].wave_half_amplitude = _system_def->wave_amplitude;
-		if(_system_def->wave_amplitude != 0.0f)
-			_particles[i].wave_half_amplitude += RandomFloat(-_system_def->wave_amplitude_variation, _system_def->wave_amplitude_variation);
-		_particles[i].wave_half_amplitude *= 0.5f;
+	int32 t = 0;
+	for (int32 j = 0; j < _num_particles; ++j) {
+		// upper-left
+		_particle_texcoords[t]._t0 = u1;
+		_particle_texcoords[t]._t1 = v1;
+		++t;
+
+		// upper-right
+		_particle_texcoords[t]._t0 = u2;
+		_particle_texcoords[t]._t1 = v1;
+		++t;
+
+		// lower-right
+		_particle_texcoords[t]._t0 = u2;
+		_particle_texcoords[t]._t1 = v2;
+		++t;
+
+		// lower-left
+		_particle_texcoords[t]._t0 = u1;
+		_particle_texcoords[t]._t1 = v2;
+		++t;
+	}
+
+	if(_system_def->smooth_animation) {
+		// the next frame of the animation is drawn over the current one with the remaining part of the color
+		int findex = _animation.GetCurrentFrameIndex();
+		findex = (findex + 1) % _animation.GetNumberOfFrames();
+
+		StillImage *id2 = _animation.GetFrame(findex);
+		ImageTexture *img2 = id2->_image_texture;
+
+		u1 = img2->u1;
+		u2 = img2->u2;
+		v1 = img2->v1;
+		v2 = img2->v2;
+
+		t = 0;
+		for(int32 j = 0; j < _num_particles; ++j) {
+			// upper-left
+			_next_frame_texcoords[t]._t0 = u1;
+			_next_frame_texcoords[t]._t1 = v1;
+			++t;
+
+			// upper-right
+			_next_frame_texcoords[t]._t0 = u2;
+			_next_frame_texcoords[t]._t1 = v1;
+			++t;
+
+			// lower-right
+			_next_frame_texcoords[t]._t0 = u2;
+			_next_frame_texcoords[t]._t1 = v2;
+			++t;
+
+			// lower-left
+			_next_frame_texcoords[t]._t0 = u1;
+			_next_frame_texcoords[t]._t1 = v2;
+			++t;
+		}
+
+		c = 0;
+		for(int32 j = 0; j < _num_particles; ++j) {
+			Color color = _particles.GetColor(j);
+			color = color * frame_progress;
+
+			_next_frame_colors[c] = color;
+			++c;
+			_next_frame_colors[c] = color;
+			++c;
+			_next_frame_colors[c] = color;
+			++c;
+			_next_frame_colors[c] = color;
+			++c;
+		}
 	}
+}
+
+
+//-----------------------------------------------------------------------------
+// _GenerateInstances: helper function to Update(), fills the instance array that
+//                     Draw() submits to the particle shader
+//-----------------------------------------------------------------------------
 
-	_particles[i].lifetime = _system_def->particle_lifetime + RandomFloat(-_system_def->particle_lifetime_variation, _system_def->particle_lifetime_variation);
+void ParticleSystem::_GenerateInstances()
+{
+	StillImage *id = _animation.GetFrame(_animation.GetCurrentFrameIndex());
+	ImageTexture *img = id->_image_texture;
+
+	float img_width_half = static_cast<float>(img->width) * 0.5f;
+	float img_height_half = static_cast<float>(img->height) * 0.5f;
+
+	for (int32 j = 0; j < _num_particles; ++j) {
+		ParticleInstance &instance = _particle_instances[j];
+
+		instance._x = _particles.x[j];
+		instance._y = _particles.y[j];
+		instance._half_width = img_width_half * _particles.size_x[j];
+		instance._half_height = img_height_half * _particles.size_y[j];
+
+		if (_system_def->rotation_used)
+			_ComputeRotation(j, instance._angle, instance._half_height);
+		else
+			instance._angle = 0.0f;
+
+		instance._color[0] = _particles.red[j];
+		instance._color[1] = _particles.green[j];
+		instance._color[2] = _particles.blue[j];
+		instance._color[3] = _particles.alpha[j];
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// _ComputeRotation: helper function to find the angle and the speed scaled
+//                   height of a particle's quad
+//-----------------------------------------------------------------------------
+
+void ParticleSystem::_ComputeRotation(int32 j, float &angle, float &half_height) const
+{
+	angle = _particles.rotation_angle[j];
+
+	if (_system_def->rotate_to_velocity) {
+		// calculate the angle based on the velocity
+		angle += UTILS_HALF_PI + atan2f(_particles.combined_velocity_y[j], _particles.combined_velocity_x[j]);
+
+		// calculate the scaling due to speed
+		if (_system_def->speed_scale_used) {
+			// speed is magnitude of velocity
+			float speed = sqrtf(_particles.combined_velocity_x[j] * _particles.combined_velocity_x[j] + _particles.combined_velocity_y[j] * _particles.combined_velocity_y[j]);
+			float scale_factor = _system_def->speed_scale * speed;
+
+			if(scale_factor < _system_def->min_speed_scale)
+				scale_factor = _system_def->min_speed_scale;
+			if(scale_factor > _system_def->max_speed_scale)
+				scale_factor = _system_def->max_speed_scale;
+
+			half_height *= scale_factor;
+		}
+	}
 }
 
 
@@ -987,6 +909,16 @@ float ParticleSystem::GetAge() const
 }
 
 
+//-----------------------------------------------------------------------------
+// GetDefinition: returns the definition that the system was last created from
+//-----------------------------------------------------------------------------
+
+const ParticleSystemDef *ParticleSystem::GetDefinition() const
+{
+	return _system_def;
+}
+
+
 
 }  // namespace private_video
 }  // namespace hoa_video
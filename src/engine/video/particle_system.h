@@ -30,7 +30,9 @@
 #include "defs.h"
 #include "utils.h"
 #include "particle.h"
+#include "particle_kernels.h"
 #include "particle_emitter.h"
+#include "particle_shader.h"
 #include "video.h"
 
 namespace hoa_video
@@ -40,28 +42,13 @@ namespace private_video
 {
 
 
-/*!***************************************************************************
- *  \brief when we change a property of an effect, it affects all of the
- *         systems contained within that effect. So, this structure contains
- *         any relevant parameters that particle systems need to know about.
- *****************************************************************************/
-
-class EffectParameters
-{
-public:
-
-	//! orientation of the effect, called with ParticleEffect::SetOrientation()
-	float orientation;
-
-	//! attraction point, particles gravitate towards this
-	float attractor_x, attractor_y;
-};
-
-
 class ParticleSystemDef
 {
 public:
 
+	//! Deletes the keyframes of the system
+	~ParticleSystemDef();
+
 
 	//! Is this system supposed to be displayed
 	bool enabled;
@@ -72,8 +59,13 @@ public:
 
 	//! Array of keyframes, which specify how particle properties vary over time. This array must
 	//! contain at least 1 keyframe (in that case, the properties are all held constant)
+	//! The keyframes are sorted by time when the definition is loaded
 	std::vector <ParticleKeyframe *> keyframes;
 
+	//! The time of each keyframe, in the same order as the keyframes array. Particles find the
+	//! keyframe they are on with a binary search of these breakpoints
+	std::vector <float> keyframe_times;
+
 	//! How to blend the particles: VIDEO_NO_BLEND, VIDEO_BLEND, or VIDEO_BLEND_ADD
 	//! For most effects, we want VIDEO_BLEND_ADD
 	int32 blend_mode;
@@ -228,6 +220,11 @@ public:
 	//! Array of filenames for each frame of animation
 	std::vector <std::string> animation_frame_filenames;
 
+
+	//! The image of each frame of animation, loaded once when the definition is loaded and
+	//! shared by every system created from it
+	std::vector <StillImage>  animation_frames;
+
 }; // class ParticleSystemDef
 
 
@@ -246,23 +243,31 @@ public:
 	 *  \brief initializes this particle system as an instance of the
 	 *         type of particle system specified by the ParticleSystemDef
 	 * \param sys_def particle definition to base the system off of
+	 * \param seed the seed for the random number generator of the system. Two systems
+	 *        created from the same definition and seed behave identically
+	 * \param shader the shader to draw the system with, or nullptr to draw it with the fixed
+	 *        function pipeline
 	 * \return success/failure
 	 */
-	bool Create(const ParticleSystemDef *sys_def);
+	bool Create(const ParticleSystemDef *sys_def, uint32 seed, ParticleShader *shader);
 
 
 	/*!
-	 *  \brief draws the system
+	 *  \brief draws the system with the vertices that were generated by the last update
 	 * \return success/failure
 	 */
 	bool Draw();
 
 
 	/*!
-	 *  \brief updates the system
+	 *  \brief updates the system and generates the vertices that Draw() submits
 	 * \param frame_time the current frame time
 	 * \param params the effect parameters to use for this update (orientation and attractor point)
 	 * \return success/failure
+	 *
+	 *  \note this does not make any OpenGL calls, so the ParticleManager may call it
+	 *        from a worker thread. Systems do not share any state that changes during
+	 *        an update, so any number of systems may be updated at the same time
 	 */
 	bool Update(float frame_time, const EffectParameters &params);
 
@@ -306,6 +311,13 @@ public:
 	 */
 	float GetAge() const;
 
+
+	/*!
+	 *  \brief returns the definition that the system was last created from
+	 * \return the system definition, or nullptr if Create() has not been called
+	 */
+	const ParticleSystemDef *GetDefinition() const;
+
 private:
 
 
@@ -359,6 +371,31 @@ private:
 	void _RespawnParticle(int32 i, const EffectParameters &params);
 
 
+	/*!
+	 *  \brief fills the vertex, color and texture coordinate arrays from the particles
+	 *         and the current frame of the animation
+	 */
+	void _GenerateVertices();
+
+
+	/*!
+	 *  \brief fills the instance array from the particles. This is used instead of
+	 *         _GenerateVertices() when the system is drawn with the particle shader
+	 */
+	void _GenerateInstances();
+
+
+	/*!
+	 *  \brief computes the angle and half height of a particle's quad, taking the
+	 *         rotation of the particle and the rotate-to-velocity and speed scale
+	 *         options of the system into account
+	 * \param j index of the particle
+	 * \param angle set to the angle to rotate the quad by
+	 * \param half_height the half height of the quad, which is scaled by the speed if necessary
+	 */
+	void _ComputeRotation(int32 j, float &angle, float &half_height) const;
+
+
 	//! The system definition, contains information like the emitter properties, lifetime of
 	//! particles, particle keyframes, etc. Basically everything which isn't instance-specific
 	const ParticleSystemDef *_system_def;
@@ -379,9 +416,25 @@ private:
 	std::vector <Color>            _particle_colors;
 	std::vector <ParticleTexCoord> _particle_texcoords;
 
-	//! This array holds everything except positions and colors. The reason we keep positions and
-	//! colors separate is so that they can be efficiently fed to OpenGL for rendering.
-	std::vector <Particle>     _particles;
+	//! One record per particle, which is used instead of the arrays above when the system
+	//! is drawn with the particle shader
+	std::vector <ParticleInstance> _particle_instances;
+
+	//! The shader that draws the system, or nullptr if it is drawn with the fixed function
+	//! pipeline
+	ParticleShader *_shader;
+
+	//! The colors and texture coordinates of the second pass that draws the next frame of
+	//! the animation. These are only used when the system has smooth animation
+	std::vector <Color>            _next_frame_colors;
+	std::vector <ParticleTexCoord> _next_frame_texcoords;
+
+	//! The properties of every particle, stored as one array per property so that they can be
+	//! updated with SIMD instructions
+	ParticleArrays _particles;
+
+	//! The random number generator for the properties of new particles
+	ParticleRandom _random;
 
 	//! if stopped is true, no new particles should be emitted
 	bool _stopped;
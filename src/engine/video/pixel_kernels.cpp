@@ -0,0 +1,456 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    pixel_kernels.cpp
+*** \author  agent
+*** \brief   Source file for pixel format conversion kernels
+***
+*** The vectorized kernels are compiled with function target attributes rather
+*** than compiler flags, so that the rest of the game does not require a
+*** processor that supports these instruction sets.
+*** ***************************************************************************/
+
+#include <algorithm>
+#include <SDL2/SDL_cpuinfo.h>
+
+#include "pixel_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+	#define PIXEL_KERNELS_X86
+	#include <immintrin.h>
+
+	#if defined(__GNUC__)
+		#define PIXEL_KERNELS_SSE2 __attribute__((target("sse2")))
+		#define PIXEL_KERNELS_AVX2 __attribute__((target("avx2")))
+	#else
+		#define PIXEL_KERNELS_SSE2
+		#define PIXEL_KERNELS_AVX2
+	#endif
+#endif
+
+using namespace std;
+
+namespace hoa_video {
+
+namespace private_video {
+
+// The grayscale value of a pixel is 0.30R + 0.59G + 0.11B. The vectorized kernels compute the weighted sum
+// with integers and divide it by 100 by multiplying with GRAYSCALE_DIVISOR / 2^(16 + GRAYSCALE_SHIFT), which
+// gives the same result as the scalar kernel for every possible sum (at most 25500).
+const uint32 GRAYSCALE_DIVISOR = 41944;
+const uint32 GRAYSCALE_SHIFT = 6;
+
+// -----------------------------------------------------------------------------
+// ---------- Scalar Kernels
+// -----------------------------------------------------------------------------
+
+static void _RGBToRGBAScalar(const uint8* source, uint8* destination, uint32 pixel_count) {
+	for (uint32 i = 0; i < pixel_count; ++i, source += 3, destination += 4) {
+		destination[0] = source[0];
+		destination[1] = source[1];
+		destination[2] = source[2];
+		destination[3] = 0xFF;
+	}
+}
+
+
+
+static void _RGBAToRGBScalar(const uint8* source, uint8* destination, uint32 pixel_count) {
+	for (uint32 i = 0; i < pixel_count; ++i, source += 4, destination += 3) {
+		destination[0] = source[0];
+		destination[1] = source[1];
+		destination[2] = source[2];
+	}
+}
+
+
+
+static void _GreyToRGBAScalar(const uint8* source, uint8* destination, uint32 pixel_count) {
+	for (uint32 i = 0; i < pixel_count; ++i, source += 1, destination += 4) {
+		destination[0] = source[0];
+		destination[1] = source[0];
+		destination[2] = source[0];
+		destination[3] = 0xFF;
+	}
+}
+
+
+
+static void _ClearTransparentRGBAScalar(const uint8* source, uint8* destination, uint32 pixel_count) {
+	for (uint32 i = 0; i < pixel_count; ++i, source += 4, destination += 4) {
+		if (source[3] == 0) {
+			destination[0] = 0;
+			destination[1] = 0;
+			destination[2] = 0;
+			destination[3] = 0;
+		}
+		else {
+			destination[0] = source[0];
+			destination[1] = source[1];
+			destination[2] = source[2];
+			destination[3] = source[3];
+		}
+	}
+}
+
+
+
+static void _GrayscaleScalar(uint8* pixels, uint32 pixel_count, uint32 format_bytes) {
+	uint8* end_position = pixels + pixel_count * format_bytes;
+
+	for (uint8* i = pixels; i < end_position; i += format_bytes) {
+		uint8 value = static_cast<uint8>((30 * *(i) + 59 * *(i + 1) + 11 * *(i + 2)) * 0.01f);
+		*i = value;
+		*(i + 1) = value;
+		*(i + 2) = value;
+	}
+}
+
+
+
+static void _GrayscaleRGBAScalar(uint8* pixels, uint32 pixel_count) {
+	_GrayscaleScalar(pixels, pixel_count, 4);
+}
+
+
+
+static void _GrayscaleRGBScalar(uint8* pixels, uint32 pixel_count) {
+	_GrayscaleScalar(pixels, pixel_count, 3);
+}
+
+
+
+static void _FlipVerticalScalar(uint8* pixels, uint32 row_size, uint32 row_count) {
+	if (row_count < 2)
+		return;
+
+	for (uint32 top = 0, bottom = row_count - 1; top < bottom; ++top, --bottom) {
+		swap_ranges(pixels + top * row_size, pixels + (top + 1) * row_size, pixels + bottom * row_size);
+	}
+}
+
+#ifdef PIXEL_KERNELS_X86
+
+// -----------------------------------------------------------------------------
+// ---------- SSE2 Kernels
+// -----------------------------------------------------------------------------
+
+PIXEL_KERNELS_SSE2 static void _GreyToRGBASSE2(const uint8* source, uint8* destination, uint32 pixel_count) {
+	const __m128i alpha = _mm_set1_epi8(static_cast<char>(0xFF));
+
+	uint32 i = 0;
+	for (; i + 16 <= pixel_count; i += 16) {
+		__m128i grey = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+		// Interleave grey with itself and with the alpha value, then interleave those results to form G G G A pixels
+		__m128i grey_grey_low = _mm_unpacklo_epi8(grey, grey);
+		__m128i grey_grey_high = _mm_unpackhi_epi8(grey, grey);
+		__m128i grey_alpha_low = _mm_unpacklo_epi8(grey, alpha);
+		__m128i grey_alpha_high = _mm_unpackhi_epi8(grey, alpha);
+
+		__m128i* output = reinterpret_cast<__m128i*>(destination + i * 4);
+		_mm_storeu_si128(output, _mm_unpacklo_epi16(grey_grey_low, grey_alpha_low));
+		_mm_storeu_si128(output + 1, _mm_unpackhi_epi16(grey_grey_low, grey_alpha_low));
+		_mm_storeu_si128(output + 2, _mm_unpacklo_epi16(grey_grey_high, grey_alpha_high));
+		_mm_storeu_si128(output + 3, _mm_unpackhi_epi16(grey_grey_high, grey_alpha_high));
+	}
+
+	_GreyToRGBAScalar(source + i, destination + i * 4, pixel_count - i);
+}
+
+
+
+PIXEL_KERNELS_SSE2 static void _ClearTransparentRGBASSE2(const uint8* source, uint8* destination, uint32 pixel_count) {
+	const __m128i alpha_mask = _mm_set1_epi32(static_cast<int32>(0xFF000000));
+	const __m128i zero = _mm_setzero_si128();
+
+	uint32 i = 0;
+	for (; i + 4 <= pixel_count; i += 4) {
+		__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+		// Every pixel with an alpha value of zero is cleared entirely
+		__m128i transparent = _mm_cmpeq_epi32(_mm_and_si128(pixels, alpha_mask), zero);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), _mm_andnot_si128(transparent, pixels));
+	}
+
+	_ClearTransparentRGBAScalar(source + i * 4, destination + i * 4, pixel_count - i);
+}
+
+
+
+PIXEL_KERNELS_SSE2 static void _GrayscaleRGBASSE2(uint8* pixels, uint32 pixel_count) {
+	const __m128i weights = _mm_setr_epi16(30, 59, 11, 0, 30, 59, 11, 0);
+	const __m128i divisor = _mm_set1_epi32(GRAYSCALE_DIVISOR);
+	const __m128i alpha_mask = _mm_set1_epi32(static_cast<int32>(0xFF000000));
+	const __m128i zero = _mm_setzero_si128();
+
+	uint32 i = 0;
+	for (; i + 4 <= pixel_count; i += 4) {
+		__m128i* position = reinterpret_cast<__m128i*>(pixels + i * 4);
+		__m128i color = _mm_loadu_si128(position);
+
+		// Each 32-bit result holds either 30R + 59G or 11B for one pixel
+		__m128i low = _mm_madd_epi16(_mm_unpacklo_epi8(color, zero), weights);
+		__m128i high = _mm_madd_epi16(_mm_unpackhi_epi8(color, zero), weights);
+		__m128 even = _mm_shuffle_ps(_mm_castsi128_ps(low), _mm_castsi128_ps(high), _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 odd = _mm_shuffle_ps(_mm_castsi128_ps(low), _mm_castsi128_ps(high), _MM_SHUFFLE(3, 1, 3, 1));
+		__m128i sum = _mm_add_epi32(_mm_castps_si128(even), _mm_castps_si128(odd));
+
+		__m128i value = _mm_srli_epi32(_mm_mulhi_epu16(sum, divisor), GRAYSCALE_SHIFT);
+		value = _mm_or_si128(value, _mm_or_si128(_mm_slli_epi32(value, 8), _mm_slli_epi32(value, 16)));
+		_mm_storeu_si128(position, _mm_or_si128(value, _mm_and_si128(color, alpha_mask)));
+	}
+
+	_GrayscaleRGBAScalar(pixels + i * 4, pixel_count - i);
+}
+
+
+
+PIXEL_KERNELS_SSE2 static void _FlipVerticalSSE2(uint8* pixels, uint32 row_size, uint32 row_count) {
+	if (row_count < 2)
+		return;
+
+	for (uint32 top = 0, bottom = row_count - 1; top < bottom; ++top, --bottom) {
+		uint8* top_row = pixels + top * row_size;
+		uint8* bottom_row = pixels + bottom * row_size;
+
+		uint32 i = 0;
+		for (; i + 16 <= row_size; i += 16) {
+			__m128i top_data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(top_row + i));
+			__m128i bottom_data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom_row + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(top_row + i), bottom_data);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(bottom_row + i), top_data);
+		}
+		swap_ranges(top_row + i, top_row + row_size, bottom_row + i);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// ---------- AVX2 Kernels
+// -----------------------------------------------------------------------------
+
+PIXEL_KERNELS_AVX2 static void _RGBToRGBAAVX2(const uint8* source, uint8* destination, uint32 pixel_count) {
+	// Moves the four RGB pixels held in the low 12 bytes of each 128-bit lane into RGBA positions
+	const __m256i expand = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+		0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	const __m256i split = _mm256_setr_epi32(0, 1, 2, 0, 3, 4, 5, 0);
+	const __m256i alpha = _mm256_set1_epi32(static_cast<int32>(0xFF000000));
+
+	// Each iteration converts eight pixels (24 bytes) but reads 32 bytes, so the loop stops before it would read past the source
+	uint32 i = 0;
+	for (; i + 11 <= pixel_count; i += 8) {
+		__m256i color = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i * 3));
+		color = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(color, split), expand);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i * 4), _mm256_or_si256(color, alpha));
+	}
+
+	_RGBToRGBAScalar(source + i * 3, destination + i * 4, pixel_count - i);
+}
+
+
+
+PIXEL_KERNELS_AVX2 static void _RGBAToRGBAVX2(const uint8* source, uint8* destination, uint32 pixel_count) {
+	// Packs the RGB values of the four pixels in each 128-bit lane into the low 12 bytes of the lane
+	const __m256i compact = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+		0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+	const __m256i join = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+
+	// Every iteration reads its source pixels before it writes, and writes no further than it has read, so the
+	// conversion may be done in place
+	uint32 i = 0;
+	for (; i + 8 <= pixel_count; i += 8) {
+		__m256i color = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i * 4));
+		color = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(color, compact), join);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 3), _mm256_castsi256_si128(color));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(destination + i * 3 + 16), _mm256_extracti128_si256(color, 1));
+	}
+
+	_RGBAToRGBScalar(source + i * 4, destination + i * 3, pixel_count - i);
+}
+
+
+
+PIXEL_KERNELS_AVX2 static void _GreyToRGBAAVX2(const uint8* source, uint8* destination, uint32 pixel_count) {
+	// Sixteen grey values are copied to both 128-bit lanes, and each shuffle expands four of them in each lane
+	const __m256i expand_low = _mm256_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1,
+		4, 4, 4, -1, 5, 5, 5, -1, 6, 6, 6, -1, 7, 7, 7, -1);
+	const __m256i expand_high = _mm256_setr_epi8(8, 8, 8, -1, 9, 9, 9, -1, 10, 10, 10, -1, 11, 11, 11, -1,
+		12, 12, 12, -1, 13, 13, 13, -1, 14, 14, 14, -1, 15, 15, 15, -1);
+	const __m256i alpha = _mm256_set1_epi32(static_cast<int32>(0xFF000000));
+
+	uint32 i = 0;
+	for (; i + 16 <= pixel_count; i += 16) {
+		__m256i grey = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i)));
+		__m256i* output = reinterpret_cast<__m256i*>(destination + i * 4);
+		_mm256_storeu_si256(output, _mm256_or_si256(_mm256_shuffle_epi8(grey, expand_low), alpha));
+		_mm256_storeu_si256(output + 1, _mm256_or_si256(_mm256_shuffle_epi8(grey, expand_high), alpha));
+	}
+
+	_GreyToRGBAScalar(source + i, destination + i * 4, pixel_count - i);
+}
+
+
+
+PIXEL_KERNELS_AVX2 static void _ClearTransparentRGBAAVX2(const uint8* source, uint8* destination, uint32 pixel_count) {
+	const __m256i alpha_mask = _mm256_set1_epi32(static_cast<int32>(0xFF000000));
+	const __m256i zero = _mm256_setzero_si256();
+
+	uint32 i = 0;
+	for (; i + 8 <= pixel_count; i += 8) {
+		__m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i * 4));
+		__m256i transparent = _mm256_cmpeq_epi32(_mm256_and_si256(pixels, alpha_mask), zero);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i * 4), _mm256_andnot_si256(transparent, pixels));
+	}
+
+	_ClearTransparentRGBAScalar(source + i * 4, destination + i * 4, pixel_count - i);
+}
+
+
+
+PIXEL_KERNELS_AVX2 static void _GrayscaleRGBAAVX2(uint8* pixels, uint32 pixel_count) {
+	const __m256i weights = _mm256_setr_epi16(30, 59, 11, 0, 30, 59, 11, 0, 30, 59, 11, 0, 30, 59, 11, 0);
+	const __m256i divisor = _mm256_set1_epi32(GRAYSCALE_DIVISOR);
+	const __m256i alpha_mask = _mm256_set1_epi32(static_cast<int32>(0xFF000000));
+	const __m256i zero = _mm256_setzero_si256();
+
+	// The unpack and shuffle instructions operate on each 128-bit lane separately, so the pixels remain in order within each lane
+	uint32 i = 0;
+	for (; i + 8 <= pixel_count; i += 8) {
+		__m256i* position = reinterpret_cast<__m256i*>(pixels + i * 4);
+		__m256i color = _mm256_loadu_si256(position);
+
+		__m256i low = _mm256_madd_epi16(_mm256_unpacklo_epi8(color, zero), weights);
+		__m256i high = _mm256_madd_epi16(_mm256_unpackhi_epi8(color, zero), weights);
+		__m256 even = _mm256_shuffle_ps(_mm256_castsi256_ps(low), _mm256_castsi256_ps(high), _MM_SHUFFLE(2, 0, 2, 0));
+		__m256 odd = _mm256_shuffle_ps(_mm256_castsi256_ps(low), _mm256_castsi256_ps(high), _MM_SHUFFLE(3, 1, 3, 1));
+		__m256i sum = _mm256_add_epi32(_mm256_castps_si256(even), _mm256_castps_si256(odd));
+
+		__m256i value = _mm256_srli_epi32(_mm256_mulhi_epu16(sum, divisor), GRAYSCALE_SHIFT);
+		value = _mm256_or_si256(value, _mm256_or_si256(_mm256_slli_epi32(value, 8), _mm256_slli_epi32(value, 16)));
+		_mm256_storeu_si256(position, _mm256_or_si256(value, _mm256_and_si256(color, alpha_mask)));
+	}
+
+	_GrayscaleRGBAScalar(pixels + i * 4, pixel_count - i);
+}
+
+
+
+PIXEL_KERNELS_AVX2 static void _FlipVerticalAVX2(uint8* pixels, uint32 row_size, uint32 row_count) {
+	if (row_count < 2)
+		return;
+
+	for (uint32 top = 0, bottom = row_count - 1; top < bottom; ++top, --bottom) {
+		uint8* top_row = pixels + top * row_size;
+		uint8* bottom_row = pixels + bottom * row_size;
+
+		uint32 i = 0;
+		for (; i + 32 <= row_size; i += 32) {
+			__m256i top_data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(top_row + i));
+			__m256i bottom_data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bottom_row + i));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(top_row + i), bottom_data);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(bottom_row + i), top_data);
+		}
+		swap_ranges(top_row + i, top_row + row_size, bottom_row + i);
+	}
+}
+
+#endif // PIXEL_KERNELS_X86
+
+// -----------------------------------------------------------------------------
+// ---------- PixelKernels Class Methods
+// -----------------------------------------------------------------------------
+
+PixelKernels::PixelKernels() :
+	level(PIXEL_KERNEL_SCALAR),
+	rgb_to_rgba(_RGBToRGBAScalar),
+	rgba_to_rgb(_RGBAToRGBScalar),
+	grey_to_rgba(_GreyToRGBAScalar),
+	clear_transparent_rgba(_ClearTransparentRGBAScalar),
+	grayscale_rgba(_GrayscaleRGBAScalar),
+	grayscale_rgb(_GrayscaleRGBScalar),
+	flip_vertical(_FlipVerticalScalar)
+{}
+
+// -----------------------------------------------------------------------------
+// ---------- Kernel Selection Functions
+// -----------------------------------------------------------------------------
+
+//! \brief Returns the fastest set of kernels that the processor supports
+static PixelKernels _SelectPixelKernels() {
+	PixelKernels kernels;
+	for (int32 level = PIXEL_KERNEL_TOTAL - 1; level > PIXEL_KERNEL_SCALAR; --level) {
+		if (GetPixelKernels(static_cast<PixelKernelLevel>(level), kernels) == true)
+			break;
+	}
+	return kernels;
+}
+
+
+
+const PixelKernels& GetPixelKernels() {
+	// Images are loaded by more than one thread, but a local static is only ever initialized once
+	static const PixelKernels kernels = _SelectPixelKernels();
+	return kernels;
+}
+
+
+
+bool GetPixelKernels(PixelKernelLevel level, PixelKernels& kernels) {
+	PixelKernels result;
+
+	switch (level) {
+		case PIXEL_KERNEL_SCALAR:
+			break;
+#ifdef PIXEL_KERNELS_X86
+		case PIXEL_KERNEL_AVX2:
+			if (SDL_HasAVX2() == SDL_FALSE)
+				return false;
+			result.rgb_to_rgba = _RGBToRGBAAVX2;
+			result.rgba_to_rgb = _RGBAToRGBAVX2;
+			result.grey_to_rgba = _GreyToRGBAAVX2;
+			result.clear_transparent_rgba = _ClearTransparentRGBAAVX2;
+			result.grayscale_rgba = _GrayscaleRGBAAVX2;
+			result.flip_vertical = _FlipVerticalAVX2;
+			break;
+		case PIXEL_KERNEL_SSE2:
+			// The RGB and RGBA conversions need byte shuffles, which SSE2 lacks, so those remain scalar
+			if (SDL_HasSSE2() == SDL_FALSE)
+				return false;
+			result.grey_to_rgba = _GreyToRGBASSE2;
+			result.clear_transparent_rgba = _ClearTransparentRGBASSE2;
+			result.grayscale_rgba = _GrayscaleRGBASSE2;
+			result.flip_vertical = _FlipVerticalSSE2;
+			break;
+#endif
+		default:
+			return false;
+	}
+
+	result.level = level;
+	kernels = result;
+	return true;
+} // bool GetPixelKernels(PixelKernelLevel level, PixelKernels& kernels)
+
+
+
+const char* GetPixelKernelLevelName(PixelKernelLevel level) {
+	switch (level) {
+		case PIXEL_KERNEL_SCALAR:
+			return "scalar";
+		case PIXEL_KERNEL_SSE2:
+			return "SSE2";
+		case PIXEL_KERNEL_AVX2:
+			return "AVX2";
+		default:
+			return "unknown";
+	}
+}
+
+} // namespace private_video
+
+} // namespace hoa_video
@@ -0,0 +1,112 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    pixel_kernels.h
+*** \author  agent
+*** \brief   Header file for pixel format conversion kernels
+***
+*** Every image that the video engine loads passes through one or more loops
+*** that convert its pixels from one format to another. These loops are
+*** gathered here so that each can be given vectorized implementations using
+*** the SSE2 and AVX2 instruction sets in addition to a plain scalar version.
+*** The fastest set of implementations that the processor supports is chosen
+*** the first time the kernels are requested.
+***
+*** Every vectorized kernel produces exactly the same output as its scalar
+*** version. The allacrost-pixelbench tool verifies this and measures the speed
+*** of each set of kernels.
+***
+*** \note This file is also compiled into the allacrost-pixelbench tool and
+*** therefore must not depend on any engine.
+*** ***************************************************************************/
+
+#pragma once
+
+#include "utils.h"
+#include "defs.h"
+
+namespace hoa_video {
+
+namespace private_video {
+
+//! \brief The instruction sets that pixel kernels may be implemented with, from slowest to fastest
+enum PixelKernelLevel {
+	PIXEL_KERNEL_SCALAR = 0,
+	PIXEL_KERNEL_SSE2 = 1,
+	PIXEL_KERNEL_AVX2 = 2,
+	PIXEL_KERNEL_TOTAL = 3
+};
+
+/** ****************************************************************************
+*** \brief A set of pixel conversion functions implemented with one instruction set
+***
+*** All pixel data is tightly packed with 8 bits per channel. Pixels in RGBA
+*** format are stored in R, G, B, A byte order. Unless noted otherwise the source
+*** and destination buffers must not overlap.
+***
+*** Not every kernel benefits from every instruction set. Where a level has no
+*** implementation of its own for a kernel, the implementation of the next lower
+*** level is used in its place.
+*** ***************************************************************************/
+class PixelKernels {
+public:
+	//! \brief Initializes every kernel to its scalar implementation
+	PixelKernels();
+
+	//! \brief The instruction set that this set of kernels was built for
+	PixelKernelLevel level;
+
+	//! \brief Converts RGB pixels to RGBA pixels with an alpha value of 255
+	void (*rgb_to_rgba)(const uint8* source, uint8* destination, uint32 pixel_count);
+
+	//! \brief Converts RGBA pixels to RGB pixels by discarding the alpha value. The source and destination may be the same buffer.
+	void (*rgba_to_rgb)(const uint8* source, uint8* destination, uint32 pixel_count);
+
+	//! \brief Converts 8-bit grey pixels to RGBA pixels with an alpha value of 255
+	void (*grey_to_rgba)(const uint8* source, uint8* destination, uint32 pixel_count);
+
+	/** \brief Copies RGBA pixels, setting the RGB values of every fully transparent pixel to zero
+	*** When texture smoothing is enabled, OpenGL blends neighboring pixels together. Transparent
+	*** pixels that are not black cause a visible outline around the opaque areas of an image.
+	*** The source and destination may be the same buffer.
+	**/
+	void (*clear_transparent_rgba)(const uint8* source, uint8* destination, uint32 pixel_count);
+
+	//! \brief Converts RGBA pixels to grayscale in place, leaving the alpha value unmodified
+	void (*grayscale_rgba)(uint8* pixels, uint32 pixel_count);
+
+	//! \brief Converts RGB pixels to grayscale in place
+	void (*grayscale_rgb)(uint8* pixels, uint32 pixel_count);
+
+	/** \brief Reverses the order of the rows of an image in place
+	*** \param pixels The image data
+	*** \param row_size The size of each row, in bytes
+	*** \param row_count The number of rows in the image
+	**/
+	void (*flip_vertical)(uint8* pixels, uint32 row_size, uint32 row_count);
+}; // class PixelKernels
+
+
+//! \brief Returns the fastest set of kernels that the processor supports
+const PixelKernels& GetPixelKernels();
+
+/** \brief Retrieves the kernels that were built for a specific instruction set
+*** \param level The instruction set of the kernels to retrieve
+*** \param kernels Set to the requested kernels
+*** \return False if the processor or the build does not support the instruction set, in which case the kernels are not modified
+**/
+bool GetPixelKernels(PixelKernelLevel level, PixelKernels& kernels);
+
+//! \brief Returns the name of an instruction set for use in log and benchmark output
+const char* GetPixelKernelLevelName(PixelKernelLevel level);
+
+} // namespace private_video
+
+} // namespace hoa_video
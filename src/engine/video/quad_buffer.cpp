@@ -0,0 +1,217 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    quad_buffer.cpp
+*** \author  agent
+*** \brief   Source file for the QuadBuffer class
+*** ***************************************************************************/
+
+#include "quad_buffer.h"
+#include "video.h"
+
+using namespace std;
+using namespace hoa_utils;
+using namespace hoa_video::private_video;
+
+namespace hoa_video {
+
+void QuadBuffer::Clear() {
+	_runs.clear();
+	_quad_locations.clear();
+}
+
+
+
+int32 QuadBuffer::AddQuad(const StillImage& image, float x, float y) {
+	if (image._image_texture == nullptr) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "image had no texture loaded: " << image.GetFilename() << endl;
+		return -1;
+	}
+
+	uint32 run_index = _GetRun(image);
+	QuadRun& run = _runs[run_index];
+
+	float w = image.GetWidth();
+	float h = image.GetHeight();
+	float vertices[] = {
+		x, y,
+		x + w, y,
+		x + w, y + h,
+		x, y + h
+	};
+	float tex_coords[8];
+	_WriteTexCoords(image, tex_coords);
+
+	uint32 quad_id = _quad_locations.size();
+	_quad_locations.push_back(make_pair(run_index, static_cast<uint32>(run.quad_ids.size())));
+	run.quad_ids.push_back(quad_id);
+	run.vertices.insert(run.vertices.end(), vertices, vertices + 8);
+	run.tex_coords.insert(run.tex_coords.end(), tex_coords, tex_coords + 8);
+
+	return static_cast<int32>(quad_id);
+}
+
+
+
+bool QuadBuffer::SetQuadImage(uint32 quad_id, const StillImage& image) {
+	if (quad_id >= _quad_locations.size()) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "invalid quad ID argument: " << quad_id << endl;
+		return false;
+	}
+	if (image._image_texture == nullptr) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "image had no texture loaded: " << image.GetFilename() << endl;
+		return false;
+	}
+
+	uint32 run_index = _quad_locations[quad_id].first;
+	uint32 slot = _quad_locations[quad_id].second;
+
+	// The common case: the new image resides in the same texture sheet, so only the texture coordinates change
+	if (_runs[run_index].sheet == image._image_texture->texture_sheet) {
+		_WriteTexCoords(image, &_runs[run_index].tex_coords[slot * 8]);
+		return true;
+	}
+
+	// Otherwise the quad must be moved to the run of the other texture sheet. The last quad of the old run is
+	// moved into the vacated slot so that the run remains contiguous.
+	uint32 new_run_index = _GetRun(image);
+	QuadRun& old_run = _runs[run_index];
+	QuadRun& new_run = _runs[new_run_index];
+
+	float tex_coords[8];
+	_WriteTexCoords(image, tex_coords);
+	_quad_locations[quad_id] = make_pair(new_run_index, static_cast<uint32>(new_run.quad_ids.size()));
+	new_run.quad_ids.push_back(quad_id);
+	new_run.vertices.insert(new_run.vertices.end(), old_run.vertices.begin() + slot * 8, old_run.vertices.begin() + slot * 8 + 8);
+	new_run.tex_coords.insert(new_run.tex_coords.end(), tex_coords, tex_coords + 8);
+
+	uint32 last_slot = old_run.quad_ids.size() - 1;
+	if (slot != last_slot) {
+		uint32 moved_id = old_run.quad_ids[last_slot];
+		old_run.quad_ids[slot] = moved_id;
+		copy(old_run.vertices.begin() + last_slot * 8, old_run.vertices.end(), old_run.vertices.begin() + slot * 8);
+		copy(old_run.tex_coords.begin() + last_slot * 8, old_run.tex_coords.end(), old_run.tex_coords.begin() + slot * 8);
+		_quad_locations[moved_id].second = slot;
+	}
+	old_run.quad_ids.pop_back();
+	old_run.vertices.resize(last_slot * 8);
+	old_run.tex_coords.resize(last_slot * 8);
+
+	return true;
+} // bool QuadBuffer::SetQuadImage(uint32 quad_id, const StillImage& image)
+
+
+
+void QuadBuffer::Draw() const {
+	if (_quad_locations.empty() == true)
+		return;
+
+	// Retain the draw order of any pending sprites
+	VideoManager->_sprite_batch.Flush();
+
+	Context& current_context = VideoManager->_current_context;
+	RenderState& state = VideoManager->_render_state;
+
+	// Set blending parameters
+	if (current_context.blend) {
+		state.Enable(GL_BLEND);
+		if (current_context.blend == 1)
+			state.SetBlendFunction(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); // Normal blending
+		else
+			state.SetBlendFunction(GL_SRC_ALPHA, GL_ONE); // Additive blending
+	}
+	else {
+		state.Disable(GL_BLEND);
+	}
+	state.Disable(GL_ALPHA_TEST);
+
+	glPushMatrix();
+
+	// Apply the same screen shaking offsets that are applied to all other images
+	if (VideoManager->_shake_forces.empty() == false) {
+		CoordSys& cs = current_context.coordinate_system;
+		float x_shake = VideoManager->_x_shake * (cs.GetRight() - cs.GetLeft()) / 1024.0f;
+		float y_shake = VideoManager->_y_shake * (cs.GetTop() - cs.GetBottom()) / 768.0f;
+		glTranslatef(x_shake * cs.GetHorizontalDirection(), y_shake * cs.GetVerticalDirection(), 0.0f);
+	}
+
+	float modulation = VideoManager->_screen_fader.GetFadeModulation();
+	glColor4f(modulation, modulation, modulation, 1.0f);
+
+	state.Enable(GL_TEXTURE_2D);
+	state.EnableClientState(GL_VERTEX_ARRAY);
+	state.EnableClientState(GL_TEXTURE_COORD_ARRAY);
+	state.DisableClientState(GL_COLOR_ARRAY);
+
+	for (uint32 i = 0; i < _runs.size(); i++) {
+		const QuadRun& run = _runs[i];
+		if (run.quad_ids.empty() == true)
+			continue;
+
+		run.sheet->Smooth(run.smooth);
+		TextureManager->_BindTexture(run.sheet->tex_id);
+		glVertexPointer(2, GL_FLOAT, 0, &run.vertices[0]);
+		glTexCoordPointer(2, GL_FLOAT, 0, &run.tex_coords[0]);
+		glDrawArrays(GL_QUADS, 0, run.quad_ids.size() * 4);
+		VideoManager->_num_draw_calls++;
+	}
+
+	glPopMatrix();
+
+	if (VideoManager->CheckGLError() == true) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "an OpenGL error occurred: " << VideoManager->CreateGLErrorString() << endl;
+	}
+} // void QuadBuffer::Draw() const
+
+
+
+size_t QuadBuffer::GetMemoryUsage() const {
+	size_t bytes = sizeof(QuadBuffer) + _quad_locations.capacity() * sizeof(pair<uint32, uint32>);
+	for (uint32 i = 0; i < _runs.size(); i++) {
+		bytes += sizeof(QuadRun);
+		bytes += (_runs[i].vertices.capacity() + _runs[i].tex_coords.capacity()) * sizeof(float);
+		bytes += _runs[i].quad_ids.capacity() * sizeof(uint32);
+	}
+	return bytes;
+}
+
+
+
+uint32 QuadBuffer::_GetRun(const StillImage& image) {
+	TexSheet* sheet = image._image_texture->texture_sheet;
+	for (uint32 i = 0; i < _runs.size(); i++) {
+		if (_runs[i].sheet == sheet)
+			return i;
+	}
+
+	QuadRun new_run;
+	new_run.sheet = sheet;
+	new_run.smooth = image._image_texture->smooth;
+	_runs.push_back(new_run);
+	return _runs.size() - 1;
+}
+
+
+
+void QuadBuffer::_WriteTexCoords(const StillImage& image, float* tex_coords) {
+	const ImageTexture* texture = image._image_texture;
+
+	float s0 = texture->u1 + (image._u1 * (texture->u2 - texture->u1));
+	float s1 = texture->u1 + (image._u2 * (texture->u2 - texture->u1));
+	float t0 = texture->v1 + (image._v1 * (texture->v2 - texture->v1));
+	float t1 = texture->v1 + (image._v2 * (texture->v2 - texture->v1));
+
+	tex_coords[0] = s0; tex_coords[1] = t0;
+	tex_coords[2] = s1; tex_coords[3] = t0;
+	tex_coords[4] = s1; tex_coords[5] = t1;
+	tex_coords[6] = s0; tex_coords[7] = t1;
+}
+
+} // namespace hoa_video
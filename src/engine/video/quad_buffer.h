@@ -0,0 +1,131 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    quad_buffer.h
+*** \author  agent
+*** \brief   Header file for the QuadBuffer class
+***
+*** A quad buffer holds a static set of image quads that are constructed once
+*** and then drawn many times, such as the tiles of a map.
+*** ***************************************************************************/
+
+#pragma once
+
+#include "defs.h"
+#include "utils.h"
+
+namespace hoa_video {
+
+/** ****************************************************************************
+*** \brief A static collection of textured quads that is drawn as a single unit
+***
+*** Drawing a large number of images that never move relative to one another
+*** (map tiles being the primary example) through the normal image draw calls
+*** requires a cursor movement and a draw call for every image, every frame. A
+*** QuadBuffer instead builds the vertex and texture coordinate arrays for all
+*** of its images once. When drawn, one OpenGL draw call is made for each
+*** texture sheet that the images of the buffer reside in.
+***
+*** The position of each quad is specified relative to the draw cursor, in the
+*** units of the coordinate system that the buffer will be drawn in. The upper-left
+*** corner of the image is placed at the (x, y) coordinates of the quad, and the
+*** image extends by its width and height in the positive x and y directions.
+*** For coordinate systems where the y axis increases downward (such as the one
+*** used by map mode), this means that (x, y) is the top-left corner of the quad.
+***
+*** \note The images added to the buffer must remain loaded for as long as the
+*** buffer is used, since the buffer references the texture sheets of the images.
+*** ***************************************************************************/
+class QuadBuffer {
+public:
+	QuadBuffer()
+		{}
+
+	~QuadBuffer()
+		{}
+
+	//! \brief Removes all quads from the buffer
+	void Clear();
+
+	/** \brief Adds a new quad that displays an image
+	*** \param image The image to display. It must have a texture loaded
+	*** \param x The x coordinate of the upper-left corner of the quad, relative to the draw cursor
+	*** \param y The y coordinate of the upper-left corner of the quad, relative to the draw cursor
+	*** \return An ID for the quad that can be used to change the image it displays, or -1 on failure
+	**/
+	int32 AddQuad(const StillImage& image, float x, float y);
+
+	/** \brief Changes the image that a quad displays, retaining the position of the quad
+	*** \param quad_id The ID of the quad, as returned by AddQuad()
+	*** \param image The image to display. It should have the same dimensions as the image it replaces
+	*** \return True if the quad was updated successfully
+	***
+	*** This is intended for animated images, so that only the texture coordinates of the quad need to be
+	*** updated whenever the animation changes its frame.
+	**/
+	bool SetQuadImage(uint32 quad_id, const StillImage& image);
+
+	/** \brief Draws all quads in the buffer relative to the current draw cursor position
+	*** The blending draw flag of the current context is respected, but alignment and flipping
+	*** flags are not.
+	**/
+	void Draw() const;
+
+	//! \brief Returns the number of quads held by the buffer
+	uint32 GetQuadCount() const
+		{ return _quad_locations.size(); }
+
+	//! \brief Returns the number of draw calls required to draw the buffer
+	uint32 GetRunCount() const
+		{ return _runs.size(); }
+
+	//! \brief Returns the approximate number of bytes of memory used by the buffer
+	size_t GetMemoryUsage() const;
+
+private:
+	//! \brief All the quads in the buffer that reside in a single texture sheet
+	class QuadRun {
+	public:
+		//! \brief The texture sheet that all quads of this run are drawn from
+		private_video::TexSheet* sheet;
+
+		//! \brief True if the textures of this run should be drawn smoothed
+		bool smooth;
+
+		//! \brief The vertex coordinates of the quads (8 floats per quad)
+		std::vector<float> vertices;
+
+		//! \brief The texture coordinates of the quads (8 floats per quad)
+		std::vector<float> tex_coords;
+
+		//! \brief The ID of the quad that is stored in each slot of this run
+		std::vector<uint32> quad_ids;
+	};
+
+	//! \brief One run for each texture sheet used by the images in the buffer
+	std::vector<QuadRun> _runs;
+
+	//! \brief The location of each quad, indexed by quad ID. The first value is the run index and the second is the slot within the run
+	std::vector<std::pair<uint32, uint32> > _quad_locations;
+
+	/** \brief Returns the run to use for an image, creating a new run if necessary
+	*** \param image The image to retrieve the run for
+	*** \return The index of the run in the _runs container
+	**/
+	uint32 _GetRun(const StillImage& image);
+
+	/** \brief Writes the texture coordinates of an image into an array
+	*** \param image The image whose texture coordinates should be written
+	*** \param tex_coords A pointer to an array with room for eight floats
+	**/
+	static void _WriteTexCoords(const StillImage& image, float* tex_coords);
+}; // class QuadBuffer
+
+} // namespace hoa_video
@@ -0,0 +1,216 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    render_state.cpp
+*** \author  agent
+*** \brief   Source file for the RenderState class
+*** ***************************************************************************/
+
+#include "render_state.h"
+
+using namespace std;
+using namespace hoa_utils;
+
+namespace hoa_video {
+
+namespace private_video {
+
+RenderState::RenderState() :
+	_num_changes(0),
+	_num_skipped_changes(0)
+{
+	Invalidate();
+}
+
+
+
+void RenderState::Invalidate() {
+	for (uint32 i = 0; i < CAPABILITY_TOTAL; i++)
+		_capabilities[i] = -1;
+	for (uint32 i = 0; i < CLIENT_STATE_TOTAL; i++)
+		_client_states[i] = -1;
+
+	_blend_function_valid = false;
+	_alpha_function_valid = false;
+	_stencil_function_valid = false;
+	_stencil_operation_valid = false;
+	_color_mask = -1;
+	_clear_color_valid = false;
+}
+
+
+
+void RenderState::SetBlendFunction(GLenum source_factor, GLenum destination_factor) {
+	if (_blend_function_valid == true && _blend_source == source_factor && _blend_destination == destination_factor) {
+		_num_skipped_changes++;
+		return;
+	}
+
+	_blend_function_valid = true;
+	_blend_source = source_factor;
+	_blend_destination = destination_factor;
+	glBlendFunc(source_factor, destination_factor);
+	_num_changes++;
+}
+
+
+
+void RenderState::SetAlphaFunction(GLenum function, GLclampf reference) {
+	if (_alpha_function_valid == true && _alpha_function == function && _alpha_reference == reference) {
+		_num_skipped_changes++;
+		return;
+	}
+
+	_alpha_function_valid = true;
+	_alpha_function = function;
+	_alpha_reference = reference;
+	glAlphaFunc(function, reference);
+	_num_changes++;
+}
+
+
+
+void RenderState::SetStencilFunction(GLenum function, GLint reference, GLuint mask) {
+	if (_stencil_function_valid == true && _stencil_function == function && _stencil_reference == reference && _stencil_mask == mask) {
+		_num_skipped_changes++;
+		return;
+	}
+
+	_stencil_function_valid = true;
+	_stencil_function = function;
+	_stencil_reference = reference;
+	_stencil_mask = mask;
+	glStencilFunc(function, reference, mask);
+	_num_changes++;
+}
+
+
+
+void RenderState::SetStencilOperation(GLenum stencil_fail, GLenum depth_fail, GLenum depth_pass) {
+	if (_stencil_operation_valid == true && _stencil_fail == stencil_fail && _stencil_depth_fail == depth_fail && _stencil_depth_pass == depth_pass) {
+		_num_skipped_changes++;
+		return;
+	}
+
+	_stencil_operation_valid = true;
+	_stencil_fail = stencil_fail;
+	_stencil_depth_fail = depth_fail;
+	_stencil_depth_pass = depth_pass;
+	glStencilOp(stencil_fail, depth_fail, depth_pass);
+	_num_changes++;
+}
+
+
+
+void RenderState::SetColorMask(bool write) {
+	if (_UpdateFlag(_color_mask, write) == false)
+		return;
+
+	GLboolean mask = write ? GL_TRUE : GL_FALSE;
+	glColorMask(mask, mask, mask, mask);
+}
+
+
+
+void RenderState::SetClearColor(const Color& color) {
+	if (_clear_color_valid == true && _clear_color == color) {
+		_num_skipped_changes++;
+		return;
+	}
+
+	_clear_color_valid = true;
+	_clear_color = color;
+	glClearColor(color[0], color[1], color[2], color[3]);
+	_num_changes++;
+}
+
+
+
+void RenderState::_SetCapability(GLenum capability, bool enable) {
+	int32 index;
+	switch (capability) {
+		case GL_BLEND:
+			index = BLEND_INDEX;
+			break;
+		case GL_TEXTURE_2D:
+			index = TEXTURE_2D_INDEX;
+			break;
+		case GL_ALPHA_TEST:
+			index = ALPHA_TEST_INDEX;
+			break;
+		case GL_STENCIL_TEST:
+			index = STENCIL_TEST_INDEX;
+			break;
+		case GL_SCISSOR_TEST:
+			index = SCISSOR_TEST_INDEX;
+			break;
+		default:
+			index = -1;
+			break;
+	}
+
+	if (index < 0)
+		_num_changes++;
+	else if (_UpdateFlag(_capabilities[index], enable) == false)
+		return;
+
+	if (enable == true)
+		glEnable(capability);
+	else
+		glDisable(capability);
+}
+
+
+
+void RenderState::_SetClientState(GLenum array, bool enable) {
+	int32 index;
+	switch (array) {
+		case GL_VERTEX_ARRAY:
+			index = VERTEX_ARRAY_INDEX;
+			break;
+		case GL_COLOR_ARRAY:
+			index = COLOR_ARRAY_INDEX;
+			break;
+		case GL_TEXTURE_COORD_ARRAY:
+			index = TEXTURE_COORD_ARRAY_INDEX;
+			break;
+		default:
+			index = -1;
+			break;
+	}
+
+	if (index < 0)
+		_num_changes++;
+	else if (_UpdateFlag(_client_states[index], enable) == false)
+		return;
+
+	if (enable == true)
+		glEnableClientState(array);
+	else
+		glDisableClientState(array);
+}
+
+
+
+bool RenderState::_UpdateFlag(int8& current, bool enable) {
+	int8 requested = enable ? 1 : 0;
+	if (current == requested) {
+		_num_skipped_changes++;
+		return false;
+	}
+
+	current = requested;
+	_num_changes++;
+	return true;
+}
+
+} // namespace private_video
+
+} // namespace hoa_video
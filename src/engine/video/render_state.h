@@ -0,0 +1,189 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    render_state.h
+*** \author  agent
+*** \brief   Header file for the RenderState class
+***
+*** The render state keeps a copy of the OpenGL state that the video engine
+*** draws with, so that a state change is only sent to OpenGL when the new value
+*** differs from the current one.
+*** ***************************************************************************/
+
+#pragma once
+
+// OpenGL includes
+#ifdef __APPLE__
+	#include <OpenGL/gl.h>
+#else
+	#include <GL/gl.h>
+#endif
+
+#include "defs.h"
+#include "utils.h"
+
+#include "color.h"
+
+namespace hoa_video {
+
+namespace private_video {
+
+/** ****************************************************************************
+*** \brief Eliminates redundant OpenGL state changes
+***
+*** Every draw path in the video engine sets all of the state that its draw
+*** calls depend on through this class instead of calling OpenGL directly. It
+*** does the same for capabilities, client arrays, and the blending, alpha test,
+*** stencil, and color mask functions that TextureController::_BindTexture()
+*** does for texture bindings. Because of this, draw paths no longer need to
+*** restore the state that they changed once they are finished drawing.
+***
+*** All state is unknown after construction and after Invalidate(), so the first
+*** change of each value is always sent to OpenGL.
+***
+*** \note Code that changes any of this state directly with OpenGL must call
+*** Invalidate() afterwards so that the copy held by this class is not stale.
+*** ***************************************************************************/
+class RenderState {
+public:
+	RenderState();
+
+	~RenderState()
+		{}
+
+	/** \brief Forgets all of the state, so that the next change of every value is sent to OpenGL
+	*** This must be called whenever a new OpenGL context is created.
+	**/
+	void Invalidate();
+
+	/** \brief Wrappers to glEnable() and glDisable()
+	*** \param capability One of GL_BLEND, GL_TEXTURE_2D, GL_ALPHA_TEST, GL_STENCIL_TEST, or GL_SCISSOR_TEST
+	***
+	*** Other capabilities are not tracked and are always sent to OpenGL.
+	**/
+	//@{
+	void Enable(GLenum capability)
+		{ _SetCapability(capability, true); }
+
+	void Disable(GLenum capability)
+		{ _SetCapability(capability, false); }
+	//@}
+
+	/** \brief Wrappers to glEnableClientState() and glDisableClientState()
+	*** \param array One of GL_VERTEX_ARRAY, GL_COLOR_ARRAY, or GL_TEXTURE_COORD_ARRAY
+	***
+	*** Other arrays are not tracked and are always sent to OpenGL.
+	**/
+	//@{
+	void EnableClientState(GLenum array)
+		{ _SetClientState(array, true); }
+
+	void DisableClientState(GLenum array)
+		{ _SetClientState(array, false); }
+	//@}
+
+	//! \brief A wrapper to glBlendFunc()
+	void SetBlendFunction(GLenum source_factor, GLenum destination_factor);
+
+	//! \brief A wrapper to glAlphaFunc()
+	void SetAlphaFunction(GLenum function, GLclampf reference);
+
+	//! \brief A wrapper to glStencilFunc()
+	void SetStencilFunction(GLenum function, GLint reference, GLuint mask);
+
+	//! \brief A wrapper to glStencilOp()
+	void SetStencilOperation(GLenum stencil_fail, GLenum depth_fail, GLenum depth_pass);
+
+	/** \brief A wrapper to glColorMask()
+	*** \param write If true all color channels are written, otherwise none are
+	**/
+	void SetColorMask(bool write);
+
+	//! \brief A wrapper to glClearColor()
+	void SetClearColor(const Color& color);
+
+	//! \brief Resets the state change counters to zero. This is called at the start of every frame
+	void ResetCounters()
+		{ _num_changes = 0; _num_skipped_changes = 0; }
+
+	//! \brief Returns the number of state changes that were sent to OpenGL since the counters were last reset
+	uint32 GetNumChanges() const
+		{ return _num_changes; }
+
+	//! \brief Returns the number of state changes that were not sent to OpenGL because they were redundant
+	uint32 GetNumSkippedChanges() const
+		{ return _num_skipped_changes; }
+
+private:
+	//! \brief The indices of the tracked capabilities and client arrays in _capabilities and _client_states
+	enum {
+		BLEND_INDEX = 0,
+		TEXTURE_2D_INDEX = 1,
+		ALPHA_TEST_INDEX = 2,
+		STENCIL_TEST_INDEX = 3,
+		SCISSOR_TEST_INDEX = 4,
+		CAPABILITY_TOTAL = 5
+	};
+
+	enum {
+		VERTEX_ARRAY_INDEX = 0,
+		COLOR_ARRAY_INDEX = 1,
+		TEXTURE_COORD_ARRAY_INDEX = 2,
+		CLIENT_STATE_TOTAL = 3
+	};
+
+	//! \brief The state of each tracked capability and client array: 1 if enabled, 0 if disabled, or -1 if unknown
+	int8 _capabilities[CAPABILITY_TOTAL];
+	int8 _client_states[CLIENT_STATE_TOTAL];
+
+	//! \brief The current arguments of each wrapped function, which are only valid when the corresponding flag is true
+	//@{
+	bool _blend_function_valid;
+	GLenum _blend_source, _blend_destination;
+
+	bool _alpha_function_valid;
+	GLenum _alpha_function;
+	GLclampf _alpha_reference;
+
+	bool _stencil_function_valid;
+	GLenum _stencil_function;
+	GLint _stencil_reference;
+	GLuint _stencil_mask;
+
+	bool _stencil_operation_valid;
+	GLenum _stencil_fail, _stencil_depth_fail, _stencil_depth_pass;
+
+	//! \brief 1 if the color mask writes all channels, 0 if it writes none, or -1 if unknown
+	int8 _color_mask;
+
+	bool _clear_color_valid;
+	Color _clear_color;
+	//@}
+
+	//! \brief The number of state changes that were and were not sent to OpenGL since the counters were last reset
+	uint32 _num_changes, _num_skipped_changes;
+
+	//! \brief Enables or disables a capability if it is not already in that state
+	void _SetCapability(GLenum capability, bool enable);
+
+	//! \brief Enables or disables a client array if it is not already in that state
+	void _SetClientState(GLenum array, bool enable);
+
+	/** \brief Updates a tracked enable flag and the counters
+	*** \param current The tracked state of the flag, which is updated if it differs from the requested state
+	*** \param enable The requested state
+	*** \return True if the state changed and must be sent to OpenGL
+	**/
+	bool _UpdateFlag(int8& current, bool enable);
+}; // class RenderState
+
+} // namespace private_video
+
+} // namespace hoa_video
@@ -0,0 +1,373 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    screenshot.cpp
+*** \author  agent
+*** \brief   Source file for saving screenshots without stalling the game
+*** ***************************************************************************/
+
+#include <cstdio>
+#include <cstring>
+
+#include "screenshot.h"
+#include "pixel_kernels.h"
+#include "video.h"
+#include "profiler.h"
+
+using namespace std;
+using namespace hoa_utils;
+
+namespace hoa_video {
+
+namespace private_video {
+
+// The OpenGL 1.1 headers of some platforms do not define these
+static const GLenum SCREENSHOT_GL_PIXEL_PACK_BUFFER = 0x88EB;
+static const GLenum SCREENSHOT_GL_STREAM_READ = 0x88E1;
+static const GLenum SCREENSHOT_GL_READ_ONLY = 0x88B8;
+
+ScreenshotWriter::ScreenshotWriter() :
+	_next_read_buffer(0),
+	_buffers_supported(-1),
+	_sequence_interval(0),
+	_sequence_frame(0),
+	_sequence_png(true),
+	_worker(nullptr),
+	_images_mutex(nullptr),
+	_images_ready(nullptr),
+	_free_images(nullptr),
+	_GenBuffers(nullptr),
+	_DeleteBuffers(nullptr),
+	_BindBuffer(nullptr),
+	_BufferData(nullptr),
+	_MapBuffer(nullptr),
+	_UnmapBuffer(nullptr)
+{
+	for (uint32 i = 0; i < SCREENSHOT_READ_BUFFERS; i++) {
+		_read_buffers[i].buffer = 0;
+		_read_buffers[i].size = 0;
+		_read_buffers[i].pending = false;
+		_read_buffers[i].width = 0;
+		_read_buffers[i].height = 0;
+		_read_buffers[i].png = false;
+	}
+}
+
+
+
+ScreenshotWriter::~ScreenshotWriter() {
+	if (_worker != nullptr) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "Finish() was not called before destruction, screenshots that were not saved yet are lost" << endl;
+	}
+}
+
+
+
+void ScreenshotWriter::Request(const string& filename) {
+	_requests.push_back(filename);
+}
+
+
+
+void ScreenshotWriter::StartSequence(const string& prefix, uint32 interval, bool png) {
+	if (interval == 0) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "the interval of a screenshot sequence must be at least one frame" << endl;
+		return;
+	}
+
+	_sequence_interval = interval;
+	_sequence_frame = 0;
+	_sequence_prefix = prefix;
+	_sequence_png = png;
+}
+
+
+
+void ScreenshotWriter::Update() {
+	// The screen reads of the previous frame have been completed by the graphics card by now, so mapping their buffers does not wait
+	for (uint32 i = 0; i < SCREENSHOT_READ_BUFFERS; i++) {
+		if (_read_buffers[i].pending == true)
+			_FinishRead(_read_buffers[i]);
+	}
+
+	if (_requests.empty() == false) {
+		const string& filename = _requests.front();
+		bool png = (filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".png") == 0);
+		_StartRead(filename, png);
+		_requests.pop_front();
+	}
+
+	if (_sequence_interval != 0) {
+		if (_sequence_frame % _sequence_interval == 0) {
+			char number[16];
+			sprintf(number, "%06u", _sequence_frame);
+			_StartRead(_sequence_prefix + number + (_sequence_png ? ".png" : ".jpg"), _sequence_png);
+		}
+		_sequence_frame++;
+	}
+}
+
+
+
+void ScreenshotWriter::ReleaseBuffers() {
+	for (uint32 i = 0; i < SCREENSHOT_READ_BUFFERS; i++) {
+		if (_read_buffers[i].pending == true)
+			_FinishRead(_read_buffers[i]);
+		if (_read_buffers[i].buffer != 0) {
+			_DeleteBuffers(1, &_read_buffers[i].buffer);
+			_read_buffers[i].buffer = 0;
+			_read_buffers[i].size = 0;
+		}
+	}
+
+	// The functions of a new context may differ, so they are retrieved again
+	_buffers_supported = -1;
+}
+
+
+
+void ScreenshotWriter::Finish() {
+	ReleaseBuffers();
+
+	if (_worker != nullptr) {
+		// The worker saves every screenshot that was added before this extra count, then finds the queue empty and stops
+		SDL_SemPost(_images_ready);
+		SDL_WaitThread(_worker, nullptr);
+		_worker = nullptr;
+	}
+
+	_DestroyWorkerObjects();
+}
+
+
+
+void ScreenshotWriter::_DestroyWorkerObjects() {
+	if (_images_mutex != nullptr) {
+		SDL_DestroyMutex(_images_mutex);
+		_images_mutex = nullptr;
+	}
+	if (_images_ready != nullptr) {
+		SDL_DestroySemaphore(_images_ready);
+		_images_ready = nullptr;
+	}
+	if (_free_images != nullptr) {
+		SDL_DestroySemaphore(_free_images);
+		_free_images = nullptr;
+	}
+}
+
+
+
+bool ScreenshotWriter::_LoadFunctions() {
+	_buffers_supported = 0;
+
+	const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+	int32 major = 0;
+	int32 minor = 0;
+	if (version == nullptr || sscanf(version, "%d.%d", &major, &minor) != 2) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "could not determine the OpenGL version" << endl;
+		return false;
+	}
+
+	// Pixel buffer objects became core functionality in OpenGL 2.1. The extension depends on the buffer objects of OpenGL 1.5.
+	bool buffers_core = (major > 2 || (major == 2 && minor >= 1));
+	bool buffers_extension = ((major > 1 || minor >= 5) && VideoManager->IsGLExtensionSupported("GL_ARB_pixel_buffer_object") == true);
+	if (buffers_core == false && buffers_extension == false) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "OpenGL " << version << " does not support pixel buffer objects, "
+			<< "screenshots will be read without them" << endl;
+		return false;
+	}
+
+	_GenBuffers = reinterpret_cast<GenBuffersFunction>(VideoManager->GetGLFunction("glGenBuffers"));
+	_DeleteBuffers = reinterpret_cast<DeleteBuffersFunction>(VideoManager->GetGLFunction("glDeleteBuffers"));
+	_BindBuffer = reinterpret_cast<BindBufferFunction>(VideoManager->GetGLFunction("glBindBuffer"));
+	_BufferData = reinterpret_cast<BufferDataFunction>(VideoManager->GetGLFunction("glBufferData"));
+	_MapBuffer = reinterpret_cast<MapBufferFunction>(VideoManager->GetGLFunction("glMapBuffer"));
+	_UnmapBuffer = reinterpret_cast<UnmapBufferFunction>(VideoManager->GetGLFunction("glUnmapBuffer"));
+
+	if (_GenBuffers == nullptr || _DeleteBuffers == nullptr || _BindBuffer == nullptr || _BufferData == nullptr ||
+		_MapBuffer == nullptr || _UnmapBuffer == nullptr)
+	{
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to retrieve the buffer object functions, screenshots will be read without them" << endl;
+		return false;
+	}
+
+	_buffers_supported = 1;
+	return true;
+} // bool ScreenshotWriter::_LoadFunctions()
+
+
+
+void ScreenshotWriter::_StartRead(const string& filename, bool png) {
+	if (_buffers_supported < 0)
+		_LoadFunctions();
+
+	GLint viewport[4]; // The x and y position and the width and height of the viewport
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	int32 width = viewport[2];
+	int32 height = viewport[3];
+	if (width <= 0 || height <= 0) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "the viewport is empty, no screenshot was taken for: " << filename << endl;
+		return;
+	}
+
+	// Rows of RGBA pixels are always a multiple of four bytes long, so the default pack alignment adds no padding
+	uint32 size = width * height * 4;
+
+	if (_buffers_supported == 0) {
+		ScreenshotImage* screenshot = new ScreenshotImage();
+		screenshot->image.width = width;
+		screenshot->image.height = height;
+		screenshot->image.rgb_format = false;
+		screenshot->image.pixels = malloc(size);
+		screenshot->filename = filename;
+		screenshot->png = png;
+		glReadPixels(viewport[0], viewport[1], width, height, GL_RGBA, GL_UNSIGNED_BYTE, screenshot->image.pixels);
+		_AddImage(screenshot);
+		return;
+	}
+
+	ReadBuffer& read_buffer = _read_buffers[_next_read_buffer];
+	_next_read_buffer = (_next_read_buffer + 1) % SCREENSHOT_READ_BUFFERS;
+	if (read_buffer.pending == true)
+		_FinishRead(read_buffer);
+
+	if (read_buffer.buffer == 0)
+		_GenBuffers(1, &read_buffer.buffer);
+	_BindBuffer(SCREENSHOT_GL_PIXEL_PACK_BUFFER, read_buffer.buffer);
+	if (read_buffer.size != size) {
+		_BufferData(SCREENSHOT_GL_PIXEL_PACK_BUFFER, size, nullptr, SCREENSHOT_GL_STREAM_READ);
+		read_buffer.size = size;
+	}
+
+	// With a pixel pack buffer bound, the last argument is an offset into the buffer and the call returns without waiting
+	glReadPixels(viewport[0], viewport[1], width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	_BindBuffer(SCREENSHOT_GL_PIXEL_PACK_BUFFER, 0);
+
+	read_buffer.pending = true;
+	read_buffer.width = width;
+	read_buffer.height = height;
+	read_buffer.filename = filename;
+	read_buffer.png = png;
+} // void ScreenshotWriter::_StartRead(const string& filename, bool png)
+
+
+
+void ScreenshotWriter::_FinishRead(ReadBuffer& read_buffer) {
+	read_buffer.pending = false;
+
+	_BindBuffer(SCREENSHOT_GL_PIXEL_PACK_BUFFER, read_buffer.buffer);
+	const void* data = _MapBuffer(SCREENSHOT_GL_PIXEL_PACK_BUFFER, SCREENSHOT_GL_READ_ONLY);
+	if (data == nullptr) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to map the pixel buffer, no screenshot was saved for: " << read_buffer.filename << endl;
+		_BindBuffer(SCREENSHOT_GL_PIXEL_PACK_BUFFER, 0);
+		return;
+	}
+
+	ScreenshotImage* screenshot = new ScreenshotImage();
+	screenshot->image.width = read_buffer.width;
+	screenshot->image.height = read_buffer.height;
+	screenshot->image.rgb_format = false;
+	screenshot->image.pixels = malloc(read_buffer.width * read_buffer.height * 4);
+	screenshot->filename = read_buffer.filename;
+	screenshot->png = read_buffer.png;
+	memcpy(screenshot->image.pixels, data, read_buffer.width * read_buffer.height * 4);
+
+	_UnmapBuffer(SCREENSHOT_GL_PIXEL_PACK_BUFFER);
+	_BindBuffer(SCREENSHOT_GL_PIXEL_PACK_BUFFER, 0);
+
+	_AddImage(screenshot);
+}
+
+
+
+void ScreenshotWriter::_AddImage(ScreenshotImage* screenshot) {
+	if (_worker == nullptr) {
+		_images_mutex = SDL_CreateMutex();
+		_images_ready = SDL_CreateSemaphore(0);
+		_free_images = SDL_CreateSemaphore(SCREENSHOT_MAX_QUEUED_IMAGES);
+		if (_images_mutex != nullptr && _images_ready != nullptr && _free_images != nullptr)
+			_worker = SDL_CreateThread(_WorkerThread, "screenshot", this);
+
+		// Without a worker the screenshot is saved immediately, the same as it would have been before
+		if (_worker == nullptr) {
+			IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to start the screenshot thread: " << SDL_GetError() << endl;
+			_DestroyWorkerObjects();
+			_SaveImage(screenshot);
+			return;
+		}
+	}
+
+	// When the worker is too far behind, wait for it rather than letting the queued images grow without bound
+	SDL_SemWait(_free_images);
+	SDL_LockMutex(_images_mutex);
+	_images.push_back(screenshot);
+	SDL_UnlockMutex(_images_mutex);
+	SDL_SemPost(_images_ready);
+}
+
+
+
+int ScreenshotWriter::_WorkerThread(void* writer) {
+	ScreenshotWriter* screenshot_writer = static_cast<ScreenshotWriter*>(writer);
+
+	while (true) {
+		SDL_SemWait(screenshot_writer->_images_ready);
+
+		SDL_LockMutex(screenshot_writer->_images_mutex);
+		ScreenshotImage* screenshot = nullptr;
+		if (screenshot_writer->_images.empty() == false) {
+			screenshot = screenshot_writer->_images.front();
+			screenshot_writer->_images.pop_front();
+		}
+		SDL_UnlockMutex(screenshot_writer->_images_mutex);
+
+		// Every screenshot is counted once, so an empty queue means that Finish() requested the thread to stop
+		if (screenshot == nullptr)
+			break;
+
+		_SaveImage(screenshot);
+		SDL_SemPost(screenshot_writer->_free_images);
+	}
+
+	return 0;
+}
+
+
+
+void ScreenshotWriter::_SaveImage(ScreenshotImage* screenshot) {
+	PROFILE_ZONE("ScreenshotWriter::_SaveImage");
+
+	ImageMemory& image = screenshot->image;
+
+	// OpenGL returns the rows from the bottom of the screen to the top, so the image must be vertically flipped
+	GetPixelKernels().flip_vertical(static_cast<uint8*>(image.pixels), image.width * 4, image.height);
+
+	// The alpha channel of the screen is not meant to be seen, so a PNG image is made fully opaque. A JPEG image
+	// has no alpha channel and is converted to RGB by SaveImage().
+	if (screenshot->png == true) {
+		uint8* pixels = static_cast<uint8*>(image.pixels);
+		uint32 pixel_count = image.width * image.height;
+		for (uint32 i = 0; i < pixel_count; i++)
+			pixels[i * 4 + 3] = 0xFF;
+	}
+
+	if (image.SaveImage(screenshot->filename, screenshot->png) == false) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to save the screenshot: " << screenshot->filename << endl;
+	}
+
+	free(image.pixels);
+	image.pixels = nullptr;
+	delete screenshot;
+}
+
+} // namespace private_video
+
+} // namespace hoa_video
@@ -0,0 +1,252 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    screenshot.h
+*** \author  agent
+*** \brief   Header file for saving screenshots without stalling the game
+***
+*** Reading the screen with glReadPixels() waits for the graphics card to finish
+*** drawing, and encoding the pixels as a JPEG or PNG image takes far longer
+*** than a frame. Both used to happen on the main thread, so every screenshot
+*** caused a visible hitch. The ScreenshotWriter instead reads the screen into a
+*** pixel buffer object, which returns immediately, maps the buffer one frame
+*** later when the graphics card has finished with it, and encodes the image on
+*** a worker thread.
+***
+*** Pixel buffer objects require OpenGL 2.1 or the ARB_pixel_buffer_object
+*** extension. Without them the screen is read directly, which still stalls,
+*** but the encoding is still done by the worker thread.
+*** ***************************************************************************/
+
+#pragma once
+
+#ifdef _VS
+	#include <GL/glew.h>
+#endif
+
+// OpenGL includes
+#ifdef __APPLE__
+	#include <OpenGL/gl.h>
+#else
+	#include <GL/gl.h>
+#endif
+
+#include <cstddef>
+#include <deque>
+
+#include <SDL2/SDL_thread.h>
+#include <SDL2/SDL_mutex.h>
+
+#include "defs.h"
+#include "utils.h"
+
+#include "image_base.h"
+
+#ifndef APIENTRY
+	#define APIENTRY
+#endif
+
+namespace hoa_video {
+
+namespace private_video {
+
+//! \brief The number of screen reads that may be in progress at once, which is the number of pixel buffer objects
+const uint32 SCREENSHOT_READ_BUFFERS = 2;
+
+/** \brief The number of screenshots that may wait to be encoded at once
+*** When the worker thread falls this far behind, the main thread waits for it before adding another screenshot,
+*** so that a sequence of screenshots can not consume an unbounded amount of memory.
+**/
+const uint32 SCREENSHOT_MAX_QUEUED_IMAGES = 8;
+
+/** ****************************************************************************
+*** \brief A screenshot that has been read from the screen and waits to be encoded
+*** ***************************************************************************/
+class ScreenshotImage {
+public:
+	//! \brief The pixels of the screenshot in RGBA format, with the bottom row first as OpenGL returns them
+	ImageMemory image;
+
+	//! \brief The name of the file to save the screenshot to
+	std::string filename;
+
+	//! \brief True if the screenshot is saved as a PNG image, or false if it is saved as a JPEG image
+	bool png;
+}; // class ScreenshotImage
+
+
+/** ****************************************************************************
+*** \brief Reads screenshots from the screen and saves them on a worker thread
+***
+*** The VideoEngine owns the only object of this class. Screenshots are taken
+*** by Update(), which the engine calls once the scene of a frame has been
+*** drawn and before the debugging information is drawn over it. A screenshot
+*** that is requested with Request() is therefore a screenshot of the next
+*** frame to be displayed.
+***
+*** A sequence takes a screenshot every Nth frame and numbers the files by the
+*** frame that they were taken on, which allows frame by frame comparisons of
+*** two runs of the game (for example in combination with the --headless and
+*** --frames options).
+***
+*** \note The pixel buffer objects belong to the OpenGL context, so
+*** ReleaseBuffers() must be called before the context is destroyed.
+*** ***************************************************************************/
+class ScreenshotWriter {
+public:
+	ScreenshotWriter();
+
+	~ScreenshotWriter();
+
+	/** \brief Requests a screenshot of the next frame
+	*** \param filename The name of the file to save the screenshot to. The image is saved as a PNG image
+	*** if the name ends with ".png" and as a JPEG image otherwise.
+	**/
+	void Request(const std::string& filename);
+
+	/** \brief Starts taking a screenshot every Nth frame
+	*** \param prefix The path and start of the name of every file. The frame number and extension are appended to it.
+	*** \param interval The number of frames between two screenshots, where 1 takes a screenshot of every frame
+	*** \param png If true the images are saved as PNG images, otherwise they are saved as JPEG images
+	**/
+	void StartSequence(const std::string& prefix, uint32 interval, bool png);
+
+	//! \brief Stops the sequence that is in progress, if any
+	void StopSequence()
+		{ _sequence_interval = 0; }
+
+	bool IsSequenceActive() const
+		{ return (_sequence_interval != 0); }
+
+	/** \brief Finishes the screen reads of the previous frame and starts those of this frame
+	*** This must be called once per frame while the scene is in the color buffer that is about to be displayed.
+	**/
+	void Update();
+
+	/** \brief Finishes any screen reads that are in progress and deletes the pixel buffer objects
+	*** This must be called before the OpenGL context is lost. The buffers are created again when they are needed.
+	**/
+	void ReleaseBuffers();
+
+	/** \brief Releases the buffers and waits for every screenshot to be saved
+	*** This is called when the video engine is destroyed, so that no screenshot of a sequence is lost when the
+	*** game exits.
+	**/
+	void Finish();
+
+private:
+	typedef void (APIENTRY *GenBuffersFunction)(GLsizei, GLuint*);
+	typedef void (APIENTRY *DeleteBuffersFunction)(GLsizei, const GLuint*);
+	typedef void (APIENTRY *BindBufferFunction)(GLenum, GLuint);
+	typedef void (APIENTRY *BufferDataFunction)(GLenum, std::ptrdiff_t, const void*, GLenum);
+	typedef void* (APIENTRY *MapBufferFunction)(GLenum, GLenum);
+	typedef GLboolean (APIENTRY *UnmapBufferFunction)(GLenum);
+
+	/** ************************************************************************
+	*** \brief A pixel buffer object and the screen read that is in progress with it
+	*** ************************************************************************/
+	class ReadBuffer {
+	public:
+		//! \brief The name of the buffer object, or zero if it has not been created
+		GLuint buffer;
+
+		//! \brief The number of bytes that the buffer object holds
+		uint32 size;
+
+		//! \brief True while the buffer object holds a screen read that has not been finished
+		bool pending;
+
+		//! \brief The size of the pending screen read, in pixels
+		int32 width, height;
+
+		//! \brief The file and format that the pending screen read is saved to
+		std::string filename;
+		bool png;
+	};
+
+	//! \brief The pixel buffer objects, which are used in turn
+	ReadBuffer _read_buffers[SCREENSHOT_READ_BUFFERS];
+
+	//! \brief The index of the next buffer to start a screen read with
+	uint32 _next_read_buffer;
+
+	//! \brief Whether pixel buffer objects are supported: 1 if they are, 0 if they are not, or -1 if this has not been determined
+	int8 _buffers_supported;
+
+	//! \brief The names of the files for which screenshots have been requested, in the order they were requested
+	std::deque<std::string> _requests;
+
+	//! \brief The number of frames between two screenshots of the sequence, or zero if no sequence is in progress
+	uint32 _sequence_interval;
+
+	//! \brief The number of frames that have been drawn since the sequence started
+	uint32 _sequence_frame;
+
+	//! \brief The start of the name of every file of the sequence and their format
+	std::string _sequence_prefix;
+	bool _sequence_png;
+
+	//! \brief The thread that encodes and saves the screenshots, or nullptr if it has not been started
+	SDL_Thread* _worker;
+
+	//! \brief The screenshots that wait to be saved, guarded by _images_mutex
+	std::deque<ScreenshotImage*> _images;
+	SDL_mutex* _images_mutex;
+
+	//! \brief Counts the screenshots that have been added for the worker, plus one more for each request to stop it
+	SDL_sem* _images_ready;
+
+	//! \brief Counts the screenshots that may still be added before the queue is full
+	SDL_sem* _free_images;
+
+	//! \brief The buffer object functions, which are retrieved when the buffers are first needed
+	//@{
+	GenBuffersFunction _GenBuffers;
+	DeleteBuffersFunction _DeleteBuffers;
+	BindBufferFunction _BindBuffer;
+	BufferDataFunction _BufferData;
+	MapBufferFunction _MapBuffer;
+	UnmapBufferFunction _UnmapBuffer;
+	//@}
+
+	/** \brief Determines if pixel buffer objects are supported and retrieves their functions
+	*** \return False if they are not supported, in which case the screen is read without them
+	**/
+	bool _LoadFunctions();
+
+	/** \brief Starts reading the screen into the next buffer, or reads it immediately without buffers
+	*** \param filename The file to save the screenshot to
+	*** \param png True to save the screenshot as a PNG image
+	**/
+	void _StartRead(const std::string& filename, bool png);
+
+	//! \brief Copies the pixels of a pending screen read out of its buffer and adds them for the worker
+	void _FinishRead(ReadBuffer& read_buffer);
+
+	/** \brief Adds a screenshot for the worker thread to save, starting the thread if needed
+	*** \param screenshot The screenshot to save, which the worker thread deletes when it is finished with it
+	**/
+	void _AddImage(ScreenshotImage* screenshot);
+
+	/** \brief The function that the worker thread runs
+	*** \param writer A pointer to the ScreenshotWriter that started the thread
+	**/
+	static int _WorkerThread(void* writer);
+
+	//! \brief Destroys the mutex and semaphores that are shared with the worker thread, which must not be running
+	void _DestroyWorkerObjects();
+
+	//! \brief Encodes and saves a screenshot, then deletes it
+	static void _SaveImage(ScreenshotImage* screenshot);
+}; // class ScreenshotWriter
+
+} // namespace private_video
+
+} // namespace hoa_video
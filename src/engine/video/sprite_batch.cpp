@@ -0,0 +1,200 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    sprite_batch.cpp
+*** \author  agent
+*** \brief   Source file for the SpriteBatch class
+*** ***************************************************************************/
+
+#include "sprite_batch.h"
+#include "video.h"
+
+using namespace std;
+using namespace hoa_utils;
+
+namespace hoa_video {
+
+namespace private_video {
+
+//-----------------------------------------------------------------------------
+// SpriteTransform class
+//-----------------------------------------------------------------------------
+
+void SpriteTransform::LoadIdentity() {
+	_m[0] = 1.0f;
+	_m[1] = 0.0f;
+	_m[2] = 0.0f;
+	_m[3] = 1.0f;
+	_m[4] = 0.0f;
+	_m[5] = 0.0f;
+}
+
+
+
+void SpriteTransform::LoadMatrix(const float matrix[16]) {
+	_m[0] = matrix[0];
+	_m[1] = matrix[1];
+	_m[2] = matrix[4];
+	_m[3] = matrix[5];
+	_m[4] = matrix[12];
+	_m[5] = matrix[13];
+}
+
+
+
+void SpriteTransform::Translate(float x, float y) {
+	_m[4] += _m[0] * x + _m[2] * y;
+	_m[5] += _m[1] * x + _m[3] * y;
+}
+
+
+
+void SpriteTransform::Rotate(float angle) {
+	// Like glRotatef(), the angle is in degrees
+	float radians = angle * UTILS_PI / 180.0f;
+	float cosine = cosf(radians);
+	float sine = sinf(radians);
+
+	float m0 = _m[0];
+	float m1 = _m[1];
+	_m[0] = m0 * cosine + _m[2] * sine;
+	_m[1] = m1 * cosine + _m[3] * sine;
+	_m[2] = _m[2] * cosine - m0 * sine;
+	_m[3] = _m[3] * cosine - m1 * sine;
+}
+
+
+
+void SpriteTransform::Scale(float x, float y) {
+	_m[0] *= x;
+	_m[1] *= x;
+	_m[2] *= y;
+	_m[3] *= y;
+}
+
+//-----------------------------------------------------------------------------
+// SpriteBatch class
+//-----------------------------------------------------------------------------
+
+SpriteBatch::SpriteBatch() :
+	_num_quads(0),
+	_tex_id(0),
+	_blend_mode(SPRITE_BLEND_NONE),
+	_alpha_test(false),
+	_vertices(SPRITE_BATCH_MAX_QUADS * 8, 0.0f),
+	_tex_coords(SPRITE_BATCH_MAX_QUADS * 8, 0.0f),
+	_colors(SPRITE_BATCH_MAX_QUADS * 4)
+{}
+
+
+
+void SpriteBatch::SetState(GLuint tex_id, SpriteBlendMode blend_mode, bool alpha_test) {
+	if (tex_id == _tex_id && blend_mode == _blend_mode && alpha_test == _alpha_test)
+		return;
+
+	Flush();
+	_tex_id = tex_id;
+	_blend_mode = blend_mode;
+	_alpha_test = alpha_test;
+}
+
+
+
+void SpriteBatch::AddQuads(const float* vertices, const float* tex_coords, const Color* colors, uint32 quad_count) {
+	// The quads are transformed here on the CPU so that the cursor may continue to move between quads without
+	// requiring a flush. The video engine's copy of the modelview matrix is used so that it is never read back from OpenGL.
+	const SpriteTransform& transform = VideoManager->_transform;
+
+	for (uint32 q = 0; q < quad_count; q++) {
+		if (_num_quads >= SPRITE_BATCH_MAX_QUADS)
+			Flush();
+
+		float* dest_vertices = &_vertices[_num_quads * 8];
+		for (uint32 i = 0; i < 4; i++) {
+			float x = vertices[q * 8 + i * 2];
+			float y = vertices[q * 8 + i * 2 + 1];
+			transform.Apply(x, y, dest_vertices[i * 2], dest_vertices[i * 2 + 1]);
+		}
+
+		if (_tex_id != 0)
+			memcpy(&_tex_coords[_num_quads * 8], tex_coords + q * 8, 8 * sizeof(float));
+
+		memcpy(&_colors[_num_quads * 4], colors + q * 4, 4 * sizeof(Color));
+
+		_num_quads++;
+	}
+}
+
+
+
+void SpriteBatch::Flush() {
+	if (_num_quads == 0)
+		return;
+
+	RenderState& state = VideoManager->_render_state;
+
+	// Set blending parameters
+	if (_blend_mode == SPRITE_BLEND_NONE) {
+		state.Disable(GL_BLEND);
+	}
+	else {
+		state.Enable(GL_BLEND);
+		if (_blend_mode == SPRITE_BLEND_NORMAL)
+			state.SetBlendFunction(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); // Normal blending
+		else if (_blend_mode == SPRITE_BLEND_ADDITIVE)
+			state.SetBlendFunction(GL_SRC_ALPHA, GL_ONE); // Additive blending
+		else if (_blend_mode == SPRITE_BLEND_LIGHT)
+			state.SetBlendFunction(GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+		else
+			state.SetBlendFunction(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	}
+
+	if (_alpha_test == true) {
+		state.Enable(GL_ALPHA_TEST);
+		state.SetAlphaFunction(GL_GREATER, 0.1f);
+	}
+	else {
+		state.Disable(GL_ALPHA_TEST);
+	}
+
+	state.EnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(2, GL_FLOAT, 0, &_vertices[0]);
+	state.EnableClientState(GL_COLOR_ARRAY);
+	glColorPointer(4, GL_FLOAT, 0, &_colors[0]);
+
+	if (_tex_id != 0) {
+		state.Enable(GL_TEXTURE_2D);
+		TextureManager->_BindTexture(_tex_id);
+		state.EnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glTexCoordPointer(2, GL_FLOAT, 0, &_tex_coords[0]);
+	}
+	else {
+		state.Disable(GL_TEXTURE_2D);
+		state.DisableClientState(GL_TEXTURE_COORD_ARRAY);
+	}
+
+	// The vertices have already been transformed, so they are drawn with an identity modelview matrix
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+	glDrawArrays(GL_QUADS, 0, _num_quads * 4);
+	glPopMatrix();
+
+	VideoManager->_num_draw_calls++;
+	_num_quads = 0;
+
+	if (VideoManager->CheckGLError() == true) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "an OpenGL error occurred: " << VideoManager->CreateGLErrorString() << endl;
+	}
+} // void SpriteBatch::Flush()
+
+} // namespace private_video
+
+} // namespace hoa_video
@@ -0,0 +1,175 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    sprite_batch.h
+*** \author  agent
+*** \brief   Header file for the SpriteBatch class
+***
+*** The sprite batch collects the textured quads of image and text draw calls
+*** and submits them to OpenGL with as few draw calls as possible.
+*** ***************************************************************************/
+
+#pragma once
+
+// OpenGL includes
+#ifdef __APPLE__
+	#include <OpenGL/gl.h>
+#else
+	#include <GL/gl.h>
+#endif
+
+#include "defs.h"
+#include "utils.h"
+
+#include "color.h"
+
+namespace hoa_video {
+
+namespace private_video {
+
+//! \brief The blending modes which a batch of sprites may be drawn with
+enum SpriteBlendMode {
+	SPRITE_BLEND_NONE = 0,
+	SPRITE_BLEND_NORMAL = 1,
+	SPRITE_BLEND_ADDITIVE = 2,
+	//! Multiplies the destination by one minus the source color, which removes light from the light map
+	SPRITE_BLEND_LIGHT = 3,
+	//! Normal blending for colors whose alpha has already been multiplied into them
+	SPRITE_BLEND_PREMULTIPLIED = 4
+};
+
+//! \brief The maximum number of quads that the batch holds before it is forced to flush
+const uint32 SPRITE_BATCH_MAX_QUADS = 2048;
+
+/** ****************************************************************************
+*** \brief A copy of the OpenGL modelview matrix that is kept on the CPU
+***
+*** The video engine applies every change that it makes to the modelview matrix
+*** to this object as well, so that the sprite batch can transform its quads
+*** without reading the matrix back from OpenGL. All of the video engine's
+*** transformations are in the plane of the screen, so only the six elements
+*** of the matrix that affect the x and y coordinates are kept.
+*** ***************************************************************************/
+class SpriteTransform {
+public:
+	SpriteTransform()
+		{ LoadIdentity(); }
+
+	//! \brief Resets the transform to the identity matrix, as glLoadIdentity() does
+	void LoadIdentity();
+
+	//! \brief Sets the transform from a column major 4x4 matrix, as glLoadMatrixf() does
+	void LoadMatrix(const float matrix[16]);
+
+	//! \brief Multiplies the transform by a translation, as glTranslatef(x, y, 0) does
+	void Translate(float x, float y);
+
+	//! \brief Multiplies the transform by a rotation about the z axis, as glRotatef(angle, 0, 0, 1) does
+	void Rotate(float angle);
+
+	//! \brief Multiplies the transform by a scale, as glScalef(x, y, 1) does
+	void Scale(float x, float y);
+
+	//! \brief Transforms the point (x, y) and stores the result in (out_x, out_y)
+	void Apply(float x, float y, float& out_x, float& out_y) const
+		{ out_x = _m[0] * x + _m[2] * y + _m[4]; out_y = _m[1] * x + _m[3] * y + _m[5]; }
+
+private:
+	//! \brief Elements 0, 1, 4, 5, 12, and 13 of the column major modelview matrix, in that order
+	float _m[6];
+}; // class SpriteTransform
+
+/** ****************************************************************************
+*** \brief Accumulates textured quads and draws them with a single OpenGL call
+***
+*** Every ImageDescriptor and text draw used to issue its own glDrawArrays()
+*** call along with a full set of state changes. Instead, those draw calls now
+*** add their quads to this batch. The quads are transformed by the video
+*** engine's copy of the modelview matrix when they are added, so the caller is
+*** free to continue moving the draw cursor between quads. The batch is flushed (drawn) when the
+*** texture, blending mode, or alpha test state changes, when it is full, or
+*** when the video engine is about to change some GL state that the pending quads
+*** depend on (the projection, viewport, scissor rectangle, and so on).
+***
+*** The vertex, texture coordinate, and color arrays are allocated once when the
+*** batch is constructed and are reused for every flush thereafter.
+***
+*** \note Any code which draws directly with OpenGL must call Flush() first so
+*** that the draw order of the pending quads is retained.
+*** ***************************************************************************/
+class SpriteBatch {
+public:
+	SpriteBatch();
+
+	~SpriteBatch()
+		{}
+
+	/** \brief Sets the draw state for the quads that will be added next
+	*** \param tex_id The OpenGL texture to draw with, or zero to draw untextured quads
+	*** \param blend_mode The SpriteBlendMode to draw with
+	*** \param alpha_test If true, fragments with an alpha value not greater than 0.1 are discarded
+	***
+	*** If any of the properties differ from the state of the quads that are already pending, the batch
+	*** will be flushed before the new state is retained.
+	**/
+	void SetState(GLuint tex_id, SpriteBlendMode blend_mode, bool alpha_test);
+
+	/** \brief Adds a single quad to the batch
+	*** \param vertices The four (x, y) vertex coordinates of the quad, prior to the modelview transformation
+	*** \param tex_coords The four (s, t) texture coordinates of the quad. Ignored for untextured quads
+	*** \param colors The four vertex colors of the quad
+	**/
+	void AddQuad(const float* vertices, const float* tex_coords, const Color* colors)
+		{ AddQuads(vertices, tex_coords, colors, 1); }
+
+	/** \brief Adds a run of quads that share the same draw state to the batch
+	*** \param vertices The (x, y) vertex coordinates of the quads, four per quad
+	*** \param tex_coords The (s, t) texture coordinates of the quads, four per quad. Ignored for untextured quads
+	*** \param colors The vertex colors of the quads, four per quad
+	*** \param quad_count The number of quads to add
+	***
+	*** \note The quads are transformed by VideoEngine's SpriteTransform, so code that changes the OpenGL modelview
+	*** matrix directly must not add quads until it has restored the matrix.
+	**/
+	void AddQuads(const float* vertices, const float* tex_coords, const Color* colors, uint32 quad_count);
+
+	//! \brief Draws all pending quads and empties the batch
+	void Flush();
+
+	//! \brief Returns true if there are no pending quads in the batch
+	bool IsEmpty() const
+		{ return (_num_quads == 0); }
+
+private:
+	//! \brief The number of quads which are currently pending in the batch
+	uint32 _num_quads;
+
+	//! \brief The texture that the pending quads will be drawn with. Zero indicates no texture
+	GLuint _tex_id;
+
+	//! \brief The blending mode that the pending quads will be drawn with
+	SpriteBlendMode _blend_mode;
+
+	//! \brief True if the pending quads will be drawn with alpha testing enabled
+	bool _alpha_test;
+
+	//! \brief The transformed vertex coordinates of the pending quads (8 floats per quad)
+	std::vector<float> _vertices;
+
+	//! \brief The texture coordinates of the pending quads (8 floats per quad)
+	std::vector<float> _tex_coords;
+
+	//! \brief The vertex colors of the pending quads (4 colors per quad)
+	std::vector<Color> _colors;
+}; // class SpriteBatch
+
+} // namespace private_video
+
+} // namespace hoa_video
@@ -20,8 +20,10 @@
 *** requests integer arguments.
 *** ***************************************************************************/
 
+#include <algorithm>
 #include <cassert>
 #include <cstdarg>
+#include <cstring>
 #include <math.h>
 
 #include "video.h"
@@ -36,6 +38,12 @@ namespace hoa_video {
 
 TextSupervisor* TextManager = nullptr;
 
+//! \brief Returns the cached glyph of a character, or nullptr if the glyph could not be cached
+static FontGlyph* _FindGlyph(const FontProperties* fp, uint16 character) {
+	map<uint16, FontGlyph*>::const_iterator i = fp->glyph_cache->find(character);
+	return (i != fp->glyph_cache->end()) ? i->second : nullptr;
+}
+
 // -----------------------------------------------------------------------------
 // TextStyle class
 // -----------------------------------------------------------------------------
@@ -168,7 +176,9 @@ TextTexture::~TextTexture() {
 bool TextTexture::Regenerate() {
 	if (texture_sheet) {
 		texture_sheet->RemoveTexture(this);
-		TextureManager->_RemoveSheet(texture_sheet);
+		// Only delete the sheet if it was created for this text alone, as shared sheets contain other textures
+		if (texture_sheet->shared == false)
+			TextureManager->_RemoveSheet(texture_sheet);
 		texture_sheet = nullptr;
 	}
 
@@ -263,7 +273,7 @@ void TextElement::Draw(const Color& draw_color) const {
 		return;
 	}
 
-	glPushMatrix();
+	VideoManager->PushMatrix();
 	_DrawOrientation();
 
 	float modulation = VideoManager->_screen_fader.GetFadeModulation();
@@ -284,7 +294,7 @@ void TextElement::Draw(const Color& draw_color) const {
 		_DrawTexture(modulated_colors);
 	}
 
-	glPopMatrix();
+	VideoManager->PopMatrix();
 } // void TextElement::Draw(const Color& draw_color) const
 
 
@@ -401,12 +411,12 @@ void TextImage::Clear() {
 
 
 void TextImage::Draw() const {
-	glPushMatrix();
+	VideoManager->PushMatrix();
 	for (uint32 i = 0; i < _text_sections.size(); ++i) {
 		_text_sections[i]->Draw();
 		VideoManager->MoveRelative(0.0f, TextManager->GetFontProperties(_style.font)->line_skip * -VideoManager->_current_context.coordinate_system.GetVerticalDirection());
 	}
-	glPopMatrix();
+	VideoManager->PopMatrix();
 }
 
 
@@ -417,12 +427,12 @@ void TextImage::Draw(const Color& draw_color) const {
 		return;
 	}
 
-	glPushMatrix();
+	VideoManager->PushMatrix();
 	for (uint32 i = 0; i < _text_sections.size(); ++i) {
 		_text_sections[i]->Draw(draw_color);
 		VideoManager->MoveRelative(0.0f, TextManager->GetFontProperties(_style.font)->line_skip * -VideoManager->_current_context.coordinate_system.GetVerticalDirection());
 	}
-	glPopMatrix();
+	VideoManager->PopMatrix();
 }
 
 
@@ -480,11 +490,8 @@ void TextImage::_Regenerate() {
 		// Otherwise, create a new TextTexture to be managed by the new element
 		else {
 // 			PRINT_DEBUG << **line_iter << endl;
-			TextTexture* texture = new TextTexture(*line_iter, _style);
-			if (texture->Regenerate() == false) {
-				IF_PRINT_WARNING(VIDEO_DEBUG) << "call to TextTexture::_Regenerate() failed" << endl;
-			}
-			TextureManager->_RegisterTextTexture(texture);
+			// Lines with the same text and style share a single texture
+			TextTexture* texture = TextureManager->_GetTextTexture(*line_iter, _style);
 
 			// Resize the TextImage width if this line is wider than the current width
 			if (texture->width > _width)
@@ -521,16 +528,21 @@ TextSupervisor::~TextSupervisor() {
 			TTF_CloseFont(fp->ttf_font);
 
 		if (fp->glyph_cache != nullptr) {
-			for (uint32 j = 0; j < fp->glyph_cache->size(); j++) {
-				if (fp->glyph_cache->at(j) != nullptr)
-					delete fp->glyph_cache->at(j);
-			}
+			_FreeGlyphs(fp);
 			delete fp->glyph_cache;
 		}
 
 		delete fp;
 	}
 
+	// Release the number characters. The texture controller deletes the textures once nothing else refers to them.
+	for (map<string, NumberStrip*>::iterator i = _number_strips.begin(); i != _number_strips.end(); i++) {
+		for (uint32 j = 0; j < i->second->textures.size(); j++) {
+			i->second->textures[j]->RemoveReference();
+		}
+		delete i->second;
+	}
+
 	TTF_Quit();
 }
 
@@ -582,7 +594,7 @@ bool TextSupervisor::LoadFont(const string& filename, const string& font_name, u
 	fp->descent = TTF_FontDescent(font);
 
 	// Create the glyph cache for the font and add it to the font map
-	fp->glyph_cache = new vector<FontGlyph*>;
+	fp->glyph_cache = new map<uint16, FontGlyph*>;
 	_font_map[font_name] = fp;
 	return true;
 } // bool TextSupervisor::LoadFont(...)
@@ -626,44 +638,23 @@ void TextSupervisor::Draw(const ustring& text, const TextStyle& style) {
 	VideoManager->PushState();
 
 	// Break the string into lines and render the shadow and text for each line
-	uint16 buffer[2048];
 	const uint16 NEWLINE = '\n';
 	size_t last_line = 0;
 	do {
-		// Find the next new line character in the string and save the line
+		// Find the next new line character in the string
 		size_t next_line;
 		for (next_line = last_line; next_line < text.length(); next_line++) {
 			if (text[next_line] == NEWLINE)
 				break;
-
-			buffer[next_line - last_line] = text[next_line];
 		}
-		buffer[next_line - last_line] = 0;
-		last_line = next_line + 1;
 
-		// If this line is empty, skip on to the next one
-		if (buffer[0] == 0) {
-			VideoManager->MoveRelative(0, -fp->line_skip * VideoManager->_current_context.coordinate_system.GetVerticalDirection());
-			continue;
+		// Draw the shadow and text of the line unless it is empty, then move the draw cursor one line down
+		if (next_line > last_line) {
+			const TextLayout& layout = _GetTextLayout(fp, text.c_str() + last_line, next_line - last_line);
+			_DrawTextHelper(layout, 0, layout.GetLength(), style);
 		}
-
-		// Save the draw cursor position before drawing this text
-		glPushMatrix();
-
-		// If text shadows are enabled, draw the shadow first
-		if (style.shadow_style != VIDEO_TEXT_SHADOW_NONE) {
-			glPushMatrix();
-			VideoManager->MoveRelative(VideoManager->_current_context.coordinate_system.GetHorizontalDirection() * style.shadow_offset_x, 0.0f);
-			VideoManager->MoveRelative(0.0f, VideoManager->_current_context.coordinate_system.GetVerticalDirection() * style.shadow_offset_y);
-			_DrawTextHelper(buffer, fp, _GetTextShadowColor(style));
-			glPopMatrix();
-		}
-
-		// Now draw the text itself, restore the position of the draw cursor, and move the draw cursor one line down
-		_DrawTextHelper(buffer, fp, style.color);
-		glPopMatrix();
 		VideoManager->MoveRelative(0, -fp->line_skip * VideoManager->_current_context.coordinate_system.GetVerticalDirection());
-
+		last_line = next_line + 1;
 	} while (last_line < text.length());
 
 	VideoManager->PopState();
@@ -677,30 +668,42 @@ int32 TextSupervisor::CalculateTextWidth(const string& font_name, const hoa_util
 		return -1;
 	}
 
-	int32 width;
-	if (TTF_SizeUNICODE(_font_map[font_name]->ttf_font, text.c_str(), &width, nullptr) == -1) {
-		IF_PRINT_WARNING(VIDEO_DEBUG) << "call to TTF_SizeUNICODE failed with TTF error: " << TTF_GetError() << endl;
-		return -1;
-	}
-
-	return width;
+	return _GetTextLayout(_font_map[font_name], text.c_str(), text.length()).GetWidth();
 }
 
 
 
 int32 TextSupervisor::CalculateTextWidth(const string& font_name, const string& text) {
+	return CalculateTextWidth(font_name, MakeUnicodeString(text));
+}
+
+
+
+const TextLayout* TextSupervisor::GetTextLayout(const string& font_name, const ustring& text) {
 	if (IsFontValid(font_name) == false) {
 		IF_PRINT_WARNING(VIDEO_DEBUG) << "font name argument was invalid: " << font_name << endl;
-		return -1;
+		return nullptr;
 	}
 
-	int32 width;
-	if (TTF_SizeText(_font_map[font_name]->ttf_font, text.c_str(), &width, nullptr) == -1) {
-		IF_PRINT_WARNING(VIDEO_DEBUG) << "call to TTF_SizeText failed with TTF error: " << TTF_GetError() << endl;
-		return -1;
+	return &_GetTextLayout(_font_map[font_name], text.c_str(), text.length());
+}
+
+
+
+void TextSupervisor::DrawLayout(const TextLayout& layout, uint32 first, uint32 count, const TextStyle& style) {
+	if (layout.font == nullptr) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "layout had no font" << endl;
+		return;
 	}
 
-	return width;
+	if (first >= layout.GetLength())
+		return;
+	if (count > layout.GetLength() - first)
+		count = layout.GetLength() - first;
+
+	VideoManager->PushState();
+	_DrawTextHelper(layout, first, count, style);
+	VideoManager->PopState();
 }
 
 
@@ -759,19 +762,6 @@ void TextSupervisor::_CacheGlyphs(const uint16* text, FontProperties* fp) {
 	TTF_Font* font = fp->ttf_font;
 	SDL_Surface* initial = nullptr;
 	SDL_Surface* intermediary = nullptr;
-	int32 w, h;
-	GLuint texture;
-
-	// First find the maximum character and make sure that the glyph cache is large enough to hold it
-	uint16 max_character = 0;
-	for (const uint16* character_ptr = text; *character_ptr != 0; ++character_ptr) {
-		if (*character_ptr > max_character)
-			max_character = *character_ptr;
-	}
-	// Now update the glyph cache size if it is not large enough to index all characters in the string
-	if (max_character >= fp->glyph_cache->size()) {
-		fp->glyph_cache->resize(max_character + 1, nullptr);
-	}
 
 	// Go through each character in the string and cache those glyphs that have not already been cached
 	for (const uint16* character_ptr = text; *character_ptr != 0; ++character_ptr) {
@@ -779,7 +769,7 @@ void TextSupervisor::_CacheGlyphs(const uint16* text, FontProperties* fp) {
 		const uint16& character = *character_ptr;
 
 		// Check if the glyph is already cached. If so, move on to the next character
-		if (fp->glyph_cache->at(character) != nullptr) {
+		if (fp->glyph_cache->find(character) != fp->glyph_cache->end()) {
 			continue;
 		}
 
@@ -794,17 +784,13 @@ void TextSupervisor::_CacheGlyphs(const uint16* text, FontProperties* fp) {
 			}
 		}
 
-		w = RoundUpPow2(initial->w);
-		h = RoundUpPow2(initial->h);
-
-		intermediary = SDL_CreateRGBSurface(0, w, h, 32, RMASK, GMASK, BMASK, AMASK);
+		intermediary = SDL_CreateRGBSurface(0, initial->w, initial->h, 32, RMASK, GMASK, BMASK, AMASK);
 		if (intermediary == nullptr) {
 			SDL_FreeSurface(initial);
 			IF_PRINT_WARNING(VIDEO_DEBUG) << "call to SDL_CreateRGBSurface() failed" << endl;
 			return;
 		}
 
-
 		if (SDL_BlitSurface(initial, 0, intermediary, 0) < 0) {
 			SDL_FreeSurface(initial);
 			SDL_FreeSurface(intermediary);
@@ -812,13 +798,18 @@ void TextSupervisor::_CacheGlyphs(const uint16* text, FontProperties* fp) {
 			return;
 		}
 
-		glGenTextures(1, &texture);
-		TextureManager->_BindTexture(texture);
-
+		int32 x, y;
+		GlyphPage* page = _AllocateGlyph(fp, intermediary->w, intermediary->h, x, y);
+		if (page == nullptr) {
+			SDL_FreeSurface(initial);
+			SDL_FreeSurface(intermediary);
+			IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to find space for the glyph in an atlas page" << endl;
+			return;
+		}
 
 		SDL_LockSurface(intermediary);
 
-		uint32 num_bytes = w * h * 4;
+		uint32 num_bytes = intermediary->w * intermediary->h * 4;
 		for (uint32 j = 0; j < num_bytes; j += 4) {
 			(static_cast<uint8*>(intermediary->pixels))[j+3] = (static_cast<uint8*>(intermediary->pixels))[j+2];
 			(static_cast<uint8*>(intermediary->pixels))[j+0] = 0xff;
@@ -826,10 +817,11 @@ void TextSupervisor::_CacheGlyphs(const uint16* text, FontProperties* fp) {
 			(static_cast<uint8*>(intermediary->pixels))[j+2] = 0xff;
 		}
 
-		glTexImage2D(GL_TEXTURE_2D, 0, 4, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, intermediary->pixels );
+		// The page may be referenced by glyph quads that are waiting to be drawn, which must not see the new glyph appear
+		VideoManager->_sprite_batch.Flush();
+		TextureManager->_BindTexture(page->texture);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, intermediary->w, intermediary->h, GL_RGBA, GL_UNSIGNED_BYTE, intermediary->pixels);
 		SDL_UnlockSurface(intermediary);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 		if (VideoManager->CheckGLError()) {
 			SDL_FreeSurface(initial);
@@ -849,16 +841,18 @@ void TextSupervisor::_CacheGlyphs(const uint16* text, FontProperties* fp) {
 		}
 
 		FontGlyph* glyph = new FontGlyph;
-		glyph->texture = texture;
+		glyph->texture = page->texture;
 		glyph->min_x = minx;
 		glyph->min_y = miny;
 		glyph->width = initial->w;
 		glyph->height = initial->h;
-		glyph->max_x = static_cast<float>(initial->w) / static_cast<float>(w);
-		glyph->max_y = static_cast<float>(initial->h) / static_cast<float>(h);
+		glyph->u1 = static_cast<float>(x) / static_cast<float>(page->size);
+		glyph->v1 = static_cast<float>(y) / static_cast<float>(page->size);
+		glyph->u2 = static_cast<float>(x + initial->w) / static_cast<float>(page->size);
+		glyph->v2 = static_cast<float>(y + initial->h) / static_cast<float>(page->size);
 		glyph->advance = advance;
 
-		fp->glyph_cache->at(character) = glyph;
+		(*fp->glyph_cache)[character] = glyph;
 
 		SDL_FreeSurface(initial);
 		SDL_FreeSurface(intermediary);
@@ -867,106 +861,291 @@ void TextSupervisor::_CacheGlyphs(const uint16* text, FontProperties* fp) {
 
 
 
-void TextSupervisor::_DrawTextHelper(const uint16* const text, FontProperties* fp, Color text_color) {
-	if (*text == 0) {
-		IF_PRINT_WARNING(VIDEO_DEBUG) << "invalid argument, empty string" << endl;
-		return;
+GlyphPage* TextSupervisor::_AllocateGlyph(FontProperties* fp, int32 width, int32 height, int32& x, int32& y) {
+	// Try to place the glyph in the current row of the last page, then in a new row below it
+	if (fp->glyph_pages.empty() == false) {
+		GlyphPage& page = fp->glyph_pages.back();
+
+		if (page.shelf_x + width + GLYPH_PADDING > page.size) {
+			page.shelf_x = GLYPH_PADDING;
+			page.shelf_y += page.shelf_height + GLYPH_PADDING;
+			page.shelf_height = 0;
+		}
+
+		if (page.shelf_x + width + GLYPH_PADDING <= page.size && page.shelf_y + height + GLYPH_PADDING <= page.size) {
+			x = page.shelf_x;
+			y = page.shelf_y;
+			page.shelf_x += width + GLYPH_PADDING;
+			if (height > page.shelf_height)
+				page.shelf_height = height;
+			return &page;
+		}
 	}
 
-	if (fp == nullptr) {
-		IF_PRINT_WARNING(VIDEO_DEBUG) << "invalid argument, nullptr font properties" << endl;
-		return;
+	// The glyph did not fit, so create a new page for it
+	GlyphPage page;
+	page.size = GLYPH_PAGE_SIZE;
+	int32 glyph_size = ((width > height) ? width : height) + GLYPH_PADDING * 2;
+	if (glyph_size > page.size)
+		page.size = RoundUpPow2(glyph_size);
+
+	// The page is cleared so that the padding around each glyph is fully transparent
+	vector<uint8> blank_pixels(page.size * page.size * 4, 0);
+	glGenTextures(1, &page.texture);
+	TextureManager->_BindTexture(page.texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, page.size, page.size, 0, GL_RGBA, GL_UNSIGNED_BYTE, &blank_pixels[0]);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	if (VideoManager->CheckGLError()) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "an OpenGL error was detected: " << VideoManager->CreateGLErrorString() << endl;
+		TextureManager->_DeleteTexture(page.texture);
+		return nullptr;
 	}
 
-	glBlendFunc(GL_ONE, GL_ONE);
-	glEnable(GL_BLEND);
+	x = GLYPH_PADDING;
+	y = GLYPH_PADDING;
+	page.shelf_x = x + width + GLYPH_PADDING;
+	page.shelf_y = y;
+	page.shelf_height = height;
+	fp->glyph_pages.push_back(page);
+	return &fp->glyph_pages.back();
+} // GlyphPage* TextSupervisor::_AllocateGlyph(FontProperties* fp, int32 width, int32 height, int32& x, int32& y)
 
-	CoordSys& cs = VideoManager->_current_context.coordinate_system;
 
-	_CacheGlyphs(text, fp);
 
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glEnable(GL_TEXTURE_2D);
-	glEnable(GL_ALPHA_TEST);
-	glAlphaFunc(GL_GREATER, 0.1f);
+void TextSupervisor::_FreeGlyphs(FontProperties* fp) {
+	for (map<uint16, FontGlyph*>::iterator i = fp->glyph_cache->begin(); i != fp->glyph_cache->end(); i++) {
+		delete i->second;
+	}
+	fp->glyph_cache->clear();
 
-	glPushMatrix();
+	for (uint32 i = 0; i < fp->glyph_pages.size(); i++) {
+		TextureManager->_DeleteTexture(fp->glyph_pages[i].texture);
+	}
+	fp->glyph_pages.clear();
+}
 
-	int font_width, font_height;
-	if (TTF_SizeUNICODE(fp->ttf_font, text, &font_width, &font_height) != 0) {
-		IF_PRINT_WARNING(VIDEO_DEBUG) << "call to TTF_SizeUNICODE() failed" << endl;
-		return;
+
+
+NumberStrip* TextSupervisor::_GetNumberStrip(const TextStyle& style) {
+	string key = TextureManager->_MakeTextTextureKey(ustring(), style);
+	map<string, NumberStrip*>::iterator i = _number_strips.find(key);
+	if (i != _number_strips.end())
+		return i->second;
+
+	if (IsFontValid(style.font) == false) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "font name argument was invalid: " << style.font << endl;
+		return nullptr;
 	}
 
-	float xoff = ((VideoManager->_current_context.x_align + 1) * font_width) * 0.5f * -cs.GetHorizontalDirection();
-	float yoff = ((VideoManager->_current_context.y_align + 1) * font_height) * 0.5f * -cs.GetVerticalDirection();
+	FontProperties* fp = _font_map[style.font];
+	NumberStrip* strip = new NumberStrip();
+	strip->height = fp->height;
 
-	VideoManager->MoveRelative(xoff, yoff);
+	for (uint32 j = 0; j < NUMBER_STRIP_CHARACTERS.length(); j++) {
+		uint16 character[2] = { static_cast<uint16>(NUMBER_STRIP_CHARACTERS[j]), 0 };
+		TextTexture* texture = TextureManager->_GetTextTexture(character, style);
+		texture->AddReference();
+		strip->textures.push_back(texture);
 
-	float modulation = VideoManager->_screen_fader.GetFadeModulation();
-	Color final_color = text_color * modulation;
+		int min_x, max_x, min_y, max_y, advance;
+		if (TTF_GlyphMetrics(fp->ttf_font, character[0], &min_x, &max_x, &min_y, &max_y, &advance) != 0) {
+			IF_PRINT_WARNING(VIDEO_DEBUG) << "call to TTF_GlyphMetrics() failed for character: " << NUMBER_STRIP_CHARACTERS[j] << endl;
+			advance = texture->width;
+		}
+		strip->advances.push_back(advance);
+	}
 
-	glEnableClientState(GL_VERTEX_ARRAY);
-	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	_number_strips[key] = strip;
+	return strip;
+} // NumberStrip* TextSupervisor::_GetNumberStrip(const TextStyle& style)
 
-	GLint vertices[8];
-	GLfloat tex_coords[8];
-	glVertexPointer(2, GL_INT, 0, vertices);
-	glTexCoordPointer(2, GL_FLOAT, 0, tex_coords);
 
-	// Iterate through each character in the string and render the character glyphs one at a time
-	int xpos = 0;
-	for (const uint16* glyph = text; *glyph != 0; ++glyph) {
-		FontGlyph* glyph_info = (*fp->glyph_cache)[*glyph];
 
-		int x_hi = glyph_info->width;
-		int y_hi = glyph_info->height;
-		if (cs.GetHorizontalDirection() < 0.0f)
-			x_hi = -x_hi;
-		if (cs.GetVerticalDirection() < 0.0f)
-			y_hi = -y_hi;
+const TextLayout& TextSupervisor::_GetTextLayout(FontProperties* fp, const uint16* text, uint32 length) {
+	// 32-bit FNV-1a hash of the characters
+	uint32 hash = 2166136261U;
+	for (uint32 i = 0; i < length; i++) {
+		hash ^= text[i];
+		hash *= 16777619U;
+	}
 
-		int min_x = xpos, min_y = 0;
+	pair<FontProperties*, uint32> key(fp, hash);
+	map<pair<FontProperties*, uint32>, list<TextLayout>::iterator>::iterator entry = _layout_lookup.find(key);
+	if (entry != _layout_lookup.end()) {
+		list<TextLayout>::iterator layout = entry->second;
+		_layouts.splice(_layouts.begin(), _layouts, layout);
 
-		float tx, ty;
-		tx = glyph_info->max_x;
-		ty = glyph_info->max_y;
+		if (layout->GetLength() == length && memcmp(layout->text.c_str(), text, length * sizeof(uint16)) == 0)
+			return *layout;
 
-		TextureManager->_BindTexture(glyph_info->texture);
-		if (VideoManager->CheckGLError()) {
-			IF_PRINT_WARNING(VIDEO_DEBUG) << "OpenGL error detected: " << VideoManager->CreateGLErrorString() << endl;
-			return;
+		// A different string with the same hash replaces the cached layout
+		layout->text = ustring();
+		for (uint32 i = 0; i < length; i++) {
+			layout->text += text[i];
+		}
+		_MeasureTextLayout(*layout);
+		return *layout;
+	}
+
+	if (_layouts.size() >= TEXT_LAYOUT_CACHE_SIZE) {
+		_layout_lookup.erase(make_pair(_layouts.back().font, _layouts.back().hash));
+		_layouts.pop_back();
+	}
+
+	_layouts.push_front(TextLayout());
+	TextLayout& layout = _layouts.front();
+	layout.font = fp;
+	layout.hash = hash;
+	for (uint32 i = 0; i < length; i++) {
+		layout.text += text[i];
+	}
+	_MeasureTextLayout(layout);
+	_layout_lookup[key] = _layouts.begin();
+	return layout;
+} // const TextLayout& TextSupervisor::_GetTextLayout(FontProperties* fp, const uint16* text, uint32 length)
+
+
+
+void TextSupervisor::_MeasureTextLayout(TextLayout& layout) {
+	uint32 length = layout.GetLength();
+	layout.positions.resize(length + 1);
+	layout.widths.resize(length + 1);
+	layout.widths[0] = 0;
+
+	// The width of each prefix is computed in the same manner as TTF_SizeUNICODE(): from the leftmost
+	// edge of any glyph to the rightmost edge or advance of any glyph
+	int x = 0;
+	int left = 0;
+	int right = 0;
+	for (uint32 i = 0; i < length; i++) {
+		uint16 character = layout.text[i];
+		int min_x, max_x, min_y, max_y, advance;
+		if (TTF_GlyphMetrics(layout.font->ttf_font, character, &min_x, &max_x, &min_y, &max_y, &advance) != 0) {
+			IF_PRINT_WARNING(VIDEO_DEBUG) << "call to TTF_GlyphMetrics() failed for character: " << character << endl;
+			min_x = max_x = advance = 0;
 		}
 
-		vertices[0] = min_x;
-		vertices[1] = min_y;
-		vertices[2] = min_x + x_hi;
-		vertices[3] = min_y;
-		vertices[4] = min_x + x_hi;
-		vertices[5] = min_y + y_hi;
-		vertices[6] = min_x;
-		vertices[7] = min_y + y_hi;
-		tex_coords[0] = 0.0f;
-		tex_coords[1] = ty;
-		tex_coords[2] = tx;
-		tex_coords[3] = ty;
-		tex_coords[4] = tx;
-		tex_coords[5] = 0.0f;
-		tex_coords[6] = 0.0f;
-		tex_coords[7] = 0.0f;
+#ifdef SDL_TTF_VERSION_ATLEAST
+	#if SDL_TTF_VERSION_ATLEAST(2, 0, 14)
+		if (i > 0)
+			x += TTF_GetFontKerningSizeGlyphs(layout.font->ttf_font, layout.text[i - 1], character);
+	#endif
+#endif
+
+		layout.positions[i] = x;
+		left = min(left, x + min_x);
+		right = max(right, x + max(max_x, advance));
+		layout.widths[i + 1] = right - left;
+		x += advance;
+	}
+	layout.positions[length] = x;
+} // void TextSupervisor::_MeasureTextLayout(TextLayout& layout)
 
-		glColor4fv((GLfloat*)&final_color);
-		glDrawArrays(GL_QUADS, 0, 4);
 
-		xpos += glyph_info->advance;
-	} // for (const uint16* glyph = text; *glyph != 0; glyph++)
 
-	glDisableClientState(GL_VERTEX_ARRAY);
-	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-	glPopMatrix();
+void TextSupervisor::_DrawTextHelper(const TextLayout& layout, uint32 first, uint32 count, const TextStyle& style) {
+	if (count == 0) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "invalid argument, empty string" << endl;
+		return;
+	}
+
+	FontProperties* fp = layout.font;
+	if (fp == nullptr) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "invalid argument, nullptr font properties" << endl;
+		return;
+	}
+
+	CoordSys& cs = VideoManager->_current_context.coordinate_system;
 
-	glDisable(GL_ALPHA_TEST);
-} // void TextSupervisor::_DrawTextHelper(const uint16* const text, FontProperties* fp, Color color)
+	_CacheGlyphs(layout.text.c_str(), fp);
+
+	VideoManager->PushMatrix();
+
+	float xoff = ((VideoManager->_current_context.x_align + 1) * layout.GetWidth()) * 0.5f * -cs.GetHorizontalDirection();
+	float yoff = ((VideoManager->_current_context.y_align + 1) * fp->height) * 0.5f * -cs.GetVerticalDirection();
+
+	VideoManager->MoveRelative(xoff, yoff);
+
+	float modulation = VideoManager->_screen_fader.GetFadeModulation();
+	SpriteBatch& batch = VideoManager->_sprite_batch;
+
+	// The shadow of the entire line is drawn first, offset from the text, followed by the text itself
+	uint32 first_pass = (style.shadow_style != VIDEO_TEXT_SHADOW_NONE) ? 0 : 1;
+	GLuint run_texture = 0;
+	uint32 run_quads = 0;
+	for (uint32 pass = first_pass; pass < 2; ++pass) {
+		Color final_color = ((pass == 0) ? _GetTextShadowColor(style) : style.color) * modulation;
+		float offset_x = (pass == 0) ? cs.GetHorizontalDirection() * style.shadow_offset_x : 0.0f;
+		float offset_y = (pass == 0) ? cs.GetVerticalDirection() * style.shadow_offset_y : 0.0f;
+
+		for (uint32 i = first; i < first + count; ++i) {
+			FontGlyph* glyph_info = _FindGlyph(fp, layout.text[i]);
+			if (glyph_info == nullptr)
+				continue;
+
+			// Quads are collected for as long as the glyphs reside in the same atlas page
+			if (glyph_info->texture != run_texture && run_quads > 0) {
+				batch.SetState(run_texture, SPRITE_BLEND_NORMAL, true);
+				batch.AddQuads(&_line_vertices[0], &_line_tex_coords[0], &_line_colors[0], run_quads);
+				run_quads = 0;
+			}
+			run_texture = glyph_info->texture;
+
+			if (_line_vertices.size() < (run_quads + 1) * 8) {
+				_line_vertices.resize((run_quads + 1) * 8);
+				_line_tex_coords.resize((run_quads + 1) * 8);
+				_line_colors.resize((run_quads + 1) * 4);
+			}
+
+			float x_hi = glyph_info->width;
+			float y_hi = glyph_info->height;
+			if (cs.GetHorizontalDirection() < 0.0f)
+				x_hi = -x_hi;
+			if (cs.GetVerticalDirection() < 0.0f)
+				y_hi = -y_hi;
+
+			float min_x = layout.positions[i] + offset_x;
+			float min_y = offset_y;
+
+			float* vertices = &_line_vertices[run_quads * 8];
+			vertices[0] = min_x;
+			vertices[1] = min_y;
+			vertices[2] = min_x + x_hi;
+			vertices[3] = min_y;
+			vertices[4] = min_x + x_hi;
+			vertices[5] = min_y + y_hi;
+			vertices[6] = min_x;
+			vertices[7] = min_y + y_hi;
+
+			float* tex_coords = &_line_tex_coords[run_quads * 8];
+			tex_coords[0] = glyph_info->u1;
+			tex_coords[1] = glyph_info->v2;
+			tex_coords[2] = glyph_info->u2;
+			tex_coords[3] = glyph_info->v2;
+			tex_coords[4] = glyph_info->u2;
+			tex_coords[5] = glyph_info->v1;
+			tex_coords[6] = glyph_info->u1;
+			tex_coords[7] = glyph_info->v1;
+
+			Color* colors = &_line_colors[run_quads * 4];
+			colors[0] = final_color;
+			colors[1] = final_color;
+			colors[2] = final_color;
+			colors[3] = final_color;
+
+			run_quads++;
+		} // for (uint32 i = first; i < first + count; ++i)
+	} // for (uint32 pass = first_pass; pass < 2; ++pass)
+
+	if (run_quads > 0) {
+		batch.SetState(run_texture, SPRITE_BLEND_NORMAL, true);
+		batch.AddQuads(&_line_vertices[0], &_line_tex_coords[0], &_line_colors[0], run_quads);
+	}
+
+	VideoManager->PopMatrix();
+} // void TextSupervisor::_DrawTextHelper(const TextLayout& layout, uint32 first, uint32 count, const TextStyle& style)
 
 
 
@@ -1003,15 +1182,16 @@ bool TextSupervisor::_RenderText(hoa_utils::ustring& string, TextStyle& style, I
 	// Calculate the width of the width and minimum y value of the text
 	const uint16* char_ptr;
 	for (char_ptr = string.c_str(); *char_ptr != '\0'; ++char_ptr) {
-		FontGlyph* glyphinfo = (*fp->glyph_cache)[*char_ptr];
-		calc_line_width += glyphinfo->advance;
+		FontGlyph* glyphinfo = _FindGlyph(fp, *char_ptr);
+		if (glyphinfo != nullptr)
+			calc_line_width += glyphinfo->advance;
 	}
 
 	// Check if the first character starts left of pixel 0, and set
 // 	char_ptr = string.c_str();
 	if (*char_ptr) {
-		FontGlyph* first_glyphinfo = (*fp->glyph_cache)[*char_ptr];
-		if (first_glyphinfo->min_x < 0)
+		FontGlyph* first_glyphinfo = _FindGlyph(fp, *char_ptr);
+		if (first_glyphinfo != nullptr && first_glyphinfo->min_x < 0)
 			line_start_x = first_glyphinfo->min_x;
 	}
 
@@ -1036,7 +1216,9 @@ bool TextSupervisor::_RenderText(hoa_utils::ustring& string, TextStyle& style, I
 	SDL_Rect surf_target = {0, 0, 0, 0};
 	int32 xpos = -line_start_x;
 	for (char_ptr = string.c_str(); *char_ptr != '\0'; ++char_ptr) {
-		FontGlyph* glyphinfo = (*fp->glyph_cache)[*char_ptr];
+		FontGlyph* glyphinfo = _FindGlyph(fp, *char_ptr);
+		if (glyphinfo == nullptr)
+			continue;
 
 		// Render the glyph
 		initial = TTF_RenderGlyph_Blended(font, *char_ptr, white_color);
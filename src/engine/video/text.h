@@ -50,12 +50,22 @@ enum TEXT_SHADOW_STYLE {
 };
 
 
+//! \brief The width and height of each glyph atlas page, in pixels. Glyphs larger than this are given a page of their own.
+const int32 GLYPH_PAGE_SIZE = 512;
+
+//! \brief The number of transparent pixels left around every glyph in an atlas page, so that filtering never blends neighboring glyphs
+const int32 GLYPH_PADDING = 1;
+
+//! \brief The maximum number of text layouts that the text supervisor retains before discarding the least recently used ones
+const uint32 TEXT_LAYOUT_CACHE_SIZE = 1024;
+
+
 /** ****************************************************************************
 *** \brief A structure to hold properties about a particular font glyph
 *** ***************************************************************************/
 class FontGlyph {
 public:
-	//! \brief The index of the GL texture for this glyph.
+	//! \brief The index of the GL texture of the atlas page that holds this glyph.
 	GLuint texture;
 
 	//! \brief The width and height of the glyph in pixels.
@@ -64,14 +74,39 @@ public:
 	//! \brief The mininum x and y pixel coordinates of the glyph in texture space (refer to TTF_GlyphMetrics).
 	int min_x, min_y;
 
-	//! \brief The maximum x and y pixel coordinates of the glyph in texture space (refer to TTF_GlyphMetrics).
-	float max_x, max_y;
+	//! \brief The texture coordinates of the upper left and lower right corners of the glyph in its atlas page.
+	float u1, v1, u2, v2;
 
 	//! \brief The amount of space between glyphs.
 	int32 advance;
 }; // class FontGlyph
 
 
+/** ****************************************************************************
+*** \brief A texture that the glyphs of a single font are packed into
+***
+*** Glyphs are placed from left to right in rows (shelves). When a glyph does not
+*** fit in the remainder of the current row, a new row is started below the
+*** tallest glyph of the current one. Since every glyph of a font is about the same
+*** height, very little space is wasted. Drawing a string of text whose glyphs
+*** all reside in the same page requires no texture changes.
+*** ***************************************************************************/
+class GlyphPage {
+public:
+	//! \brief The index of the GL texture for this page.
+	GLuint texture;
+
+	//! \brief The width and height of the page in pixels.
+	int32 size;
+
+	//! \brief The coordinates where the next glyph in the current row will be placed.
+	int32 shelf_x, shelf_y;
+
+	//! \brief The height of the tallest glyph in the current row.
+	int32 shelf_height;
+}; // class GlyphPage
+
+
 /** ****************************************************************************
 *** \brief A structure which holds properties about fonts
 *** ***************************************************************************/
@@ -89,11 +124,66 @@ public:
 	//! \brief A pointer to SDL_TTF's font structure.
 	TTF_Font* ttf_font;
 
-	//! \brief A pointer to a cache which holds all of the glyphs used in this font.
-	std::vector<FontGlyph*>* glyph_cache;
+	//! \brief A pointer to a cache which holds all of the glyphs used in this font, keyed by character.
+	std::map<uint16, FontGlyph*>* glyph_cache;
+
+	//! \brief The atlas pages that the cached glyphs are stored in. New glyphs are added to the last page.
+	std::vector<GlyphPage> glyph_pages;
 }; // class FontProperties
 
 
+/** ****************************************************************************
+*** \brief The measured positions and widths of the characters in a single line of text
+***
+*** Measuring a string with SDL_ttf looks up the metrics of every glyph in the
+*** string each time. A text layout performs this measurement once and keeps the
+*** results, so that a line of text can be drawn and measured every frame, or
+*** drawn a few characters at a time, without being measured again.
+***
+*** The kerning between each pair of characters is included in the character
+*** positions. Because the position of a character depends only on the characters
+*** that come before it, the layout of any prefix of the text is the same as the
+*** beginning of the layout of the whole text.
+***
+*** \note Layouts are created and cached by TextSupervisor::GetTextLayout().
+*** ***************************************************************************/
+class TextLayout {
+public:
+	//! \brief Constructs the layout of an empty string with no font
+	TextLayout() :
+		font(nullptr), hash(0), positions(1, 0), widths(1, 0) {}
+
+	//! \brief The font that the text was measured with
+	FontProperties* font;
+
+	//! \brief A hash of the text, used to find the layout in the text supervisor's cache
+	uint32 hash;
+
+	//! \brief The text that was measured. Any newline characters are measured as ordinary glyphs.
+	hoa_utils::ustring text;
+
+	/** \brief The horizontal position of each character relative to the start of the line, in pixels
+	*** This contains one more element than the text has characters. The last element is the position
+	*** where a character following the text would be placed.
+	**/
+	std::vector<int32> positions;
+
+	/** \brief The width of each prefix of the text as it would be rendered, in pixels
+	*** The element at index N is the width of the first N characters, so that the first element is
+	*** always zero and the last element is the width of the whole text.
+	**/
+	std::vector<int32> widths;
+
+	//! \brief Returns the width of the whole text as it would be rendered, in pixels
+	int32 GetWidth() const
+		{ return widths.back(); }
+
+	//! \brief Returns the number of characters in the text
+	uint32 GetLength() const
+		{ return static_cast<uint32>(text.length()); }
+}; // class TextLayout
+
+
 /** ****************************************************************************
 *** \brief A class encompassing all properties that define a text style
 ***
@@ -379,6 +469,7 @@ class TextSupervisor : public hoa_utils::Singleton<TextSupervisor> {
 	friend class TextureController;
 	friend class private_video::TextTexture;
 	friend class TextImage;
+	friend class NumberImage;
 
 public:
 	~TextSupervisor();
@@ -463,6 +554,30 @@ public:
 	*** \return The width of the text as it would be rendered, or -1 if there was an error
 	**/
 	int32 CalculateTextWidth(const std::string& font_name, const std::string& text);
+
+	/** \brief Retrieves the measured layout of a single line of text, creating it if necessary
+	*** \param font_name The reference name of the font to measure the text with
+	*** \param text The text string in unicode format. Any newline characters are measured as ordinary glyphs.
+	*** \return A pointer to the layout of the text, or nullptr if the font name was invalid
+	***
+	*** Layouts are cached, so requesting the layout of the same text and font again costs only a
+	*** lookup. The returned pointer remains valid only until the next layout is requested or the
+	*** text is drawn, since either may discard the layout from the cache. Callers that need the
+	*** layout for longer should keep a copy of it.
+	**/
+	const TextLayout* GetTextLayout(const std::string& font_name, const hoa_utils::ustring& text);
+
+	/** \brief Draws some of the characters of a measured line of text to the screen
+	*** \param layout The layout of the line of text to draw
+	*** \param first The index of the first character to draw
+	*** \param count The number of characters to draw
+	*** \param style The text style to draw the characters in. The font of the style is ignored in favor of the font of the layout.
+	***
+	*** Each character is drawn in the same place as it would be if the whole line was drawn from the current
+	*** draw position, so a line of text may be revealed a few characters at a time without being measured
+	*** again. The line is aligned according to the width of the whole line.
+	**/
+	void DrawLayout(const TextLayout& layout, uint32 first, uint32 count, const TextStyle& style);
 	//@}
 
 	//! \name Class member access methods
@@ -487,6 +602,20 @@ private:
 	**/
 	std::map<std::string, FontProperties*> _font_map;
 
+	//! \brief The cached text layouts, ordered from the most to the least recently used
+	std::list<TextLayout> _layouts;
+
+	//! \brief Used to find a cached text layout by its font and the hash of its text
+	std::map<std::pair<FontProperties*, uint32>, std::list<TextLayout>::iterator> _layout_lookup;
+
+	//! \brief The prerendered number characters for every text style used by a NumberImage, keyed by the text texture key of the style
+	std::map<std::string, private_video::NumberStrip*> _number_strips;
+
+	//! \brief Hold the vertex coordinates, texture coordinates, and vertex colors of the quads for a line of text as it is built
+	std::vector<float> _line_vertices;
+	std::vector<float> _line_tex_coords;
+	std::vector<Color> _line_colors;
+
 	// ---------- Private methods
 
 	/** \brief Retrieves the color for a shadow based on the current text color and a shadow style
@@ -501,15 +630,53 @@ private:
 	**/
 	void _CacheGlyphs(const uint16* text, FontProperties* fp);
 
-	/** \brief Draws text to the screen using OpenGL commands
-	*** \param text A pointer to a unicode string holding the text to draw
-	*** \param fp A pointer to the properties of the font to use in drawing the text
-	*** \param text_color The color to render the text in
+	/** \brief Finds space for a glyph in the atlas pages of a font, creating a new page if necessary
+	*** \param fp A pointer to the FontProperties of the font that the glyph belongs to
+	*** \param width The width of the glyph in pixels
+	*** \param height The height of the glyph in pixels
+	*** \param x Set to the x coordinate of the space found for the glyph
+	*** \param y Set to the y coordinate of the space found for the glyph
+	*** \return A pointer to the page that the glyph should be placed in, or nullptr if a new page could not be created
+	**/
+	GlyphPage* _AllocateGlyph(FontProperties* fp, int32 width, int32 height, int32& x, int32& y);
+
+	/** \brief Deletes all cached glyphs and atlas pages of a font
+	*** \param fp A pointer to the FontProperties of the font
+	***
+	*** The glyphs will be cached again the next time that they are drawn.
+	**/
+	void _FreeGlyphs(FontProperties* fp);
+
+	/** \brief Retrieves the prerendered number characters of a text style, rendering them if this is the first time the style is used
+	*** \param style The text style to retrieve the characters of
+	*** \return A pointer to the characters, or nullptr if the font of the style is invalid
+	**/
+	private_video::NumberStrip* _GetNumberStrip(const TextStyle& style);
+
+	/** \brief Finds the layout of a line of text in the cache, measuring the text and adding it to the cache if it is not found
+	*** \param fp A pointer to the properties of the font to measure the text with
+	*** \param text A pointer to the characters of the text, which need not be null-terminated
+	*** \param length The number of characters in the text
+	*** \return A reference to the cached layout, which is moved to the front of the cache
+	**/
+	const TextLayout& _GetTextLayout(FontProperties* fp, const uint16* text, uint32 length);
+
+	/** \brief Measures the position and width of every character in a line of text
+	*** \param layout The layout to store the measurements in. Its font and text members must already be set.
+	**/
+	void _MeasureTextLayout(TextLayout& layout);
+
+	/** \brief Draws some of the characters of a single line of text and their shadow to the screen
+	*** \param layout The layout of the line of text to draw
+	*** \param first The index of the first character to draw
+	*** \param count The number of characters to draw
+	*** \param style The text style to draw the text in
 	***
-	*** This class assists the public Draw methods. This method is intended for drawing only
-	*** a single line of text in a single color (it does not account for shadows).
+	*** This class assists the public Draw methods. The shadow and text quads of every glyph
+	*** are added to the sprite batch as a single run, so that a line whose glyphs all reside
+	*** in the same atlas page is drawn with one OpenGL draw call.
 	**/
-	void _DrawTextHelper(const uint16* const text, FontProperties* fp, Color text_color);
+	void _DrawTextHelper(const TextLayout& layout, uint32 first, uint32 count, const TextStyle& style);
 
 	/** \brief Renders a unicode string with a given TextStyle to a pixel array
 	*** \param string The unicdoe string to render
@@ -35,7 +35,9 @@ TexSheet::TexSheet(int32 sheet_width, int32 sheet_height, GLuint sheet_id, TexSh
 	type(sheet_type),
 	is_static(sheet_static),
 	smoothed(false),
-	loaded(true)
+	loaded(true),
+	shared(true),
+	_indexed_area(-1)
 {
 	Smooth();
 }
@@ -98,6 +100,8 @@ bool TexSheet::Reload() {
 
 
 bool TexSheet::CopyRect(int32 x, int32 y, ImageMemory& data) {
+	// Pending sprites may reference the region that is about to be overwritten
+	VideoManager->_sprite_batch.Flush();
 	TextureManager->_BindTexture(tex_id);
 
 	glTexSubImage2D(
@@ -123,6 +127,8 @@ bool TexSheet::CopyRect(int32 x, int32 y, ImageMemory& data) {
 
 
 bool TexSheet::CopyScreenRect(int32 x, int32 y, const ScreenRect& screen_rect) {
+	// All pending sprites must be drawn to the screen before it is copied
+	VideoManager->_sprite_batch.Flush();
 	TextureManager->_BindTexture(tex_id);
 
 	glCopyTexSubImage2D(
@@ -153,6 +159,7 @@ void TexSheet::Smooth(bool flag) {
 
 	// If setting has changed, set the appropriate filtering
 	if (smoothed != flag) {
+		VideoManager->_sprite_batch.Flush();
 		smoothed = flag;
 		GLenum filtering_type = smoothed ? GL_LINEAR : GL_NEAREST;
 
@@ -182,16 +189,20 @@ void TexSheet::DEBUG_Draw() const {
 	};
 
 	// Enable texturing and bind the texture
-	glDisable(GL_BLEND);
-	glEnable(GL_TEXTURE_2D);
+	VideoManager->_sprite_batch.Flush();
+	RenderState& state = VideoManager->_render_state;
+	state.Disable(GL_BLEND);
+	state.Disable(GL_ALPHA_TEST);
+	state.Enable(GL_TEXTURE_2D);
 	TextureManager->_BindTexture(tex_id);
 
 	// Enable and setup the texture coordinate array
-	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	state.EnableClientState(GL_TEXTURE_COORD_ARRAY);
 	glTexCoordPointer(2, GL_FLOAT, 0, texture_coords);
+	state.DisableClientState(GL_COLOR_ARRAY);
 
 	// Use a vertex array to draw all of the vertices
-	glEnableClientState(GL_VERTEX_ARRAY);
+	state.EnableClientState(GL_VERTEX_ARRAY);
 	glVertexPointer(2, GL_FLOAT, 0, vertex_coords);
 	glDrawArrays(GL_QUADS, 0, 4);
 
@@ -207,7 +218,8 @@ void TexSheet::DEBUG_Draw() const {
 FixedTexSheet::FixedTexSheet(int32 sheet_width, int32 sheet_height, GLuint sheet_id, TexSheetType sheet_type, bool sheet_static, int32 img_width, int32 img_height) :
 	TexSheet(sheet_width, sheet_height, sheet_id, sheet_type, sheet_static),
 	_texture_width(img_width),
-	_texture_height(img_height)
+	_texture_height(img_height),
+	_open_count(0)
 {
 	// Set all the dimensions
 	_block_width  = width / _texture_width;
@@ -230,6 +242,7 @@ FixedTexSheet::FixedTexSheet(int32 sheet_width, int32 sheet_height, GLuint sheet
 	_open_list_tail->image = nullptr;
 	_open_list_tail->next = nullptr;
 	_open_list_tail->block_index = num_blocks - 1;
+	_open_count = num_blocks;
 }
 
 
@@ -291,6 +304,7 @@ bool FixedTexSheet::InsertTexture(BaseTexture* img) {
 
 	img->texture_sheet = this;
 	node->image = img;
+	TextureManager->_UpdateTexSheetIndex(this);
 	return true;
 } // bool FixedTexSheet::InsertTexture(BaseTexture* img)
 
@@ -312,6 +326,7 @@ void FixedTexSheet::RemoveTexture(BaseTexture *img) {
 
 	_blocks[block_index].image = nullptr;
 	_AddOpenNode(&_blocks[block_index]);
+	TextureManager->_UpdateTexSheetIndex(this);
 }
 
 
@@ -332,6 +347,7 @@ void FixedTexSheet::FreeTexture(BaseTexture *img) {
 
 	// Unliked the RemoveTexture call, we do not set the block's image to nullptr here
 	_AddOpenNode(&_blocks[block_index]);
+	TextureManager->_UpdateTexSheetIndex(this);
 }
 
 
@@ -357,6 +373,7 @@ void FixedTexSheet::RestoreTexture(BaseTexture *img) {
 			}
 
 			_RemoveOpenNode();
+			TextureManager->_UpdateTexSheetIndex(this);
 			return;
 		}
 
@@ -383,6 +400,25 @@ uint32 FixedTexSheet::GetNumberTextures() {
 
 
 
+TexSheetStatistics FixedTexSheet::GetStatistics() const {
+	TexSheetStatistics stats;
+	int32 num_blocks = _block_width * _block_height;
+	uint32 block_area = static_cast<uint32>(_texture_width * _texture_height);
+
+	for (int32 i = 0; i < num_blocks; i++) {
+		if (_blocks[i].image != nullptr)
+			stats.texture_count++;
+	}
+
+	stats.used_area = (num_blocks - _open_count) * block_area;
+	stats.free_area = _open_count * block_area;
+	// Every open block can hold a texture, so the free space of a fixed sheet is never fragmented
+	stats.largest_free_area = stats.free_area;
+	return stats;
+}
+
+
+
 int32 FixedTexSheet::_CalculateBlockIndex(BaseTexture* img) {
 	int32 block_x = img->x / _texture_width;
 	int32 block_y = img->y / _texture_height;
@@ -403,6 +439,7 @@ void FixedTexSheet::_AddOpenNode(FixedTexNode* node) {
 		_open_list_tail = node;
 		_open_list_tail->next = nullptr;
 	}
+	_open_count++;
 }
 
 
@@ -414,6 +451,7 @@ FixedTexNode* FixedTexSheet::_RemoveOpenNode() {
 	FixedTexNode* node = _open_list_head;
 	_open_list_head = _open_list_head->next;
 	node->next = nullptr;
+	_open_count--;
 
 	// This condition means we just removed the last open block, so set the tail pointer to nullptr as well
 	if (_open_list_head == nullptr) {
@@ -428,11 +466,11 @@ FixedTexNode* FixedTexSheet::_RemoveOpenNode() {
 // -----------------------------------------------------------------------------
 
 VariableTexSheet::VariableTexSheet(int32 sheet_width, int32 sheet_height, GLuint sheet_id, TexSheetType sheet_type, bool sheet_static) :
-	TexSheet(sheet_width, sheet_height, sheet_id, sheet_type, sheet_static)
+	TexSheet(sheet_width, sheet_height, sheet_id, sheet_type, sheet_static),
+	_used_area(0),
+	_freed_area(0)
 {
-	_block_width = width / 16;
-	_block_height = height / 16;
-	_blocks = new VariableTexNode[_block_width * _block_height];
+	_free_rects.push_back(VariableTexRect(0, 0, width, height));
 }
 
 
@@ -440,8 +478,6 @@ VariableTexSheet::VariableTexSheet(int32 sheet_width, int32 sheet_height, GLuint
 VariableTexSheet::~VariableTexSheet() {
 	if (GetNumberTextures() != 0)
 		IF_PRINT_WARNING(VIDEO_DEBUG) << "texture sheet being deleted when it has a non-zero allocated texture count: " << GetNumberTextures() << endl;
-
-	delete[] _blocks;
 }
 
 
@@ -467,121 +503,305 @@ bool VariableTexSheet::InsertTexture(BaseTexture* img) {
 		return false;
 	}
 
-	// Don't allow insertions into a texture sheet containing a texture larger than 512x512.
-	// Texture sheets with this property may only be used by one texture at a time
-	if (_block_width > 32 || _block_height > 32) { // 32 blocks == 512 pixels
-		if (_blocks[0].free_image == false)
-			return false;
-	}
-
-	// Attempt to find an open region in the texture sheet to fit this texture
-	int32 block_x = -1, block_y = -1;
-	int32 w = (img->width + 15) / 16;
-	int32 h = (img->height + 15) / 16;
-
-	// This is a brute force algorithm to try and find space to allocate the texture.
-	// If this becomes a bottleneck, we may wish to use a more intellegent algorithm here.
-	bool continue_search = true;
-	for (int32 y = 0; y < _block_height - h + 1 && continue_search; y++) {
-		for (int32 x = 0; x < _block_width - w + 1; x++) {
-			int32 furthest_blocker = -1;
-
-			bool continue_neighbor_search = true;
-			for (int32 dy = 0; dy < h && continue_neighbor_search; dy++) {
-				for (int32 dx = 0; dx < w; dx++) {
-					if (_blocks[(x + dx) + ((y + dy) * _block_width)].free_image == false) {
-						furthest_blocker = x + dx;
-						continue_neighbor_search = false;
-						break;
-					}
-				}
-			}
+	// Unshared texture sheets may only be used by one texture at a time
+	if (shared == false && _textures.empty() == false)
+		return false;
 
-			if (furthest_blocker == -1) {
-				block_x = x;
-				block_y = y;
-				continue_search = false;
-				break;
-			}
-		}
+	if (img->width <= 0 || img->height <= 0 || img->width > width || img->height > height)
+		return false;
+
+	// Quickly reject textures that can not fit even if every free pixel were in one piece
+	if (static_cast<uint32>(img->width * img->height) > GetAvailableArea())
+		return false;
+
+	int32 index = _FindFreeRect(img->width, img->height);
+
+	// If there is no room for the texture, reclaim the space of any freed textures and try again
+	if (index < 0 && _freed_textures.empty() == false) {
+		_RemoveFreedTextures();
+		index = _FindFreeRect(img->width, img->height);
 	}
 
-	// If either of these conditions is true, it means we were unable to allocate enough space to insert this texture
-	if (block_x == -1 || block_y == -1)
+	if (index < 0)
 		return false;
 
-	// Go through each block that is to be occupied by the new texture and set its properties
-	for (int32 y = block_y; y < block_y + h; y++) {
-		for (int32 x = block_x; x < block_x + w; x++) {
-			int32 index = x + (y * _block_width);
+	_PlaceTexture(img, VariableTexRect(_free_rects[index].x, _free_rects[index].y, img->width, img->height));
+	return true;
+} // bool VariableTexSheet::InsertTexture(BaseTexture* img)
+
 
-			// If the texture pointer for the block is not nullptr, this means it contains a freed texture.
-			// Now we must remove that texture entirely since we are overwriting at least one of its blocks.
-			if (_blocks[index].image) {
-				RemoveTexture(_blocks[index].image);
-			}
 
-			_blocks[index].free_image = false;
-			_blocks[index].image = img;
+bool VariableTexSheet::InsertTextureAt(BaseTexture* img, int32 x, int32 y) {
+	if (img == nullptr) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "nullptr pointer was given as function argument" << endl;
+		return false;
+	}
+
+	if (_textures.find(img) != _textures.end()) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "texture was already contained within this texture sheet" << endl;
+		return false;
+	}
+
+	// Every free region of the sheet lies entirely within at least one free rectangle, so the requested region is only
+	// unoccupied if one of the free rectangles contains it
+	VariableTexRect used(x, y, img->width, img->height);
+	for (uint32 i = 0; i < _free_rects.size(); i++) {
+		if (_free_rects[i].Contains(used) == true) {
+			_PlaceTexture(img, used);
+			return true;
 		}
 	}
 
-	// Calculate the pixel and uv coordinates for the newly inserted texture
-	img->x = block_x * 16;
-	img->y = block_y * 16;
+	IF_PRINT_WARNING(VIDEO_DEBUG) << "requested region was already occupied or lies outside of the texture sheet" << endl;
+	return false;
+}
 
-	float sheet_width = static_cast<float>(width);
-	float sheet_height = static_cast<float>(height);
 
-	img->u1 = static_cast<float>(img->x + 0.5f) / sheet_width;
-	img->u2 = static_cast<float>(img->x + img->width - 0.5f) / sheet_width;
-	img->v1 = static_cast<float>(img->y + 0.5f) / sheet_height;
-	img->v2 = static_cast<float>(img->y + img->height - 0.5f) / sheet_height;
 
-	img->texture_sheet = this;
-	_textures.insert(img);
+void VariableTexSheet::RemoveTexture(BaseTexture* img) {
+	if (img == nullptr) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "nullptr pointer was given as function argument" << endl;
+		return;
+	}
 
-	return true;
-} // bool VariableTexSheet::InsertTexture(BaseTexture* img)
+	if (_textures.erase(img) == 0) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "texture pointer argument was not contained within this texture sheet" << endl;
+		return;
+	}
 
+	VariableTexRect freed(img->x, img->y, img->width, img->height);
+	if (_freed_textures.erase(img) != 0)
+		_freed_area -= freed.GetArea();
+	_used_area -= freed.GetArea();
 
+	// An empty sheet is reset to a single free rectangle, which undoes any fragmentation
+	if (_textures.empty() == true) {
+		_free_rects.clear();
+		_free_rects.push_back(VariableTexRect(0, 0, width, height));
+	}
+	else {
+		_ReleaseRect(freed);
+	}
 
-void VariableTexSheet::RemoveTexture(BaseTexture* img) {
-	_SetBlockProperties(img, nullptr, true);
-	_textures.erase(img);
+	TextureManager->_UpdateTexSheetIndex(this);
 }
 
 
 
-void VariableTexSheet::_SetBlockProperties(BaseTexture* tex, BaseTexture* new_tex, bool free) {
-	if (tex == nullptr) {
+void VariableTexSheet::FreeTexture(BaseTexture* img) {
+	if (img == nullptr) {
 		IF_PRINT_WARNING(VIDEO_DEBUG) << "nullptr pointer was given as function argument" << endl;
 		return;
 	}
 
-	if (_textures.find(tex) == _textures.end()) {
+	if (_textures.find(img) == _textures.end()) {
 		IF_PRINT_WARNING(VIDEO_DEBUG) << "texture pointer argument was not contained within this texture sheet" << endl;
+		return;
+	}
+
+	if (_freed_textures.insert(img).second == true) {
+		_freed_area += static_cast<uint32>(img->width * img->height);
+		TextureManager->_UpdateTexSheetIndex(this);
+	}
+}
+
+
+
+void VariableTexSheet::RestoreTexture(BaseTexture* img) {
+	if (img == nullptr) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "nullptr pointer was given as function argument" << endl;
+		return;
+	}
+
+	if (_freed_textures.erase(img) == 0) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to restore, texture was not freed in this texture sheet" << endl;
+		return;
+	}
+
+	_freed_area -= static_cast<uint32>(img->width * img->height);
+	TextureManager->_UpdateTexSheetIndex(this);
+}
+
+
+
+TexSheetStatistics VariableTexSheet::GetStatistics() const {
+	TexSheetStatistics stats;
+	stats.texture_count = _textures.size() - _freed_textures.size();
+	stats.used_area = _used_area - _freed_area;
+	stats.free_area = static_cast<uint32>(width * height) - stats.used_area;
+
+	for (uint32 i = 0; i < _free_rects.size(); i++) {
+		if (_free_rects[i].GetArea() > stats.largest_free_area)
+			stats.largest_free_area = _free_rects[i].GetArea();
+	}
+
+	return stats;
+}
+
+
+
+int32 VariableTexSheet::_FindFreeRect(int32 tex_width, int32 tex_height) const {
+	int32 best_index = -1;
+	int32 best_short_side = width + height;
+	int32 best_long_side = width + height;
+
+	for (uint32 i = 0; i < _free_rects.size(); i++) {
+		const VariableTexRect& rect = _free_rects[i];
+		if (rect.width < tex_width || rect.height < tex_height)
+			continue;
+
+		int32 leftover_x = rect.width - tex_width;
+		int32 leftover_y = rect.height - tex_height;
+		int32 short_side = (leftover_x < leftover_y) ? leftover_x : leftover_y;
+		int32 long_side = (leftover_x < leftover_y) ? leftover_y : leftover_x;
+
+		if (short_side < best_short_side || (short_side == best_short_side && long_side < best_long_side)) {
+			best_index = static_cast<int32>(i);
+			best_short_side = short_side;
+			best_long_side = long_side;
+		}
+	}
+
+	return best_index;
+}
+
+
+
+void VariableTexSheet::_AllocateRect(const VariableTexRect& used) {
+	vector<VariableTexRect> split_rects;
+
+	for (uint32 i = 0; i < _free_rects.size();) {
+		VariableTexRect rect = _free_rects[i];
+		if (rect.Intersects(used) == false) {
+			i++;
+			continue;
+		}
+
+		// Replace the free rectangle with the parts of it that lie on each side of the used region
+		_free_rects[i] = _free_rects.back();
+		_free_rects.pop_back();
+
+		if (used.x > rect.x)
+			split_rects.push_back(VariableTexRect(rect.x, rect.y, used.x - rect.x, rect.height));
+		if (used.x + used.width < rect.x + rect.width)
+			split_rects.push_back(VariableTexRect(used.x + used.width, rect.y, rect.x + rect.width - used.x - used.width, rect.height));
+		if (used.y > rect.y)
+			split_rects.push_back(VariableTexRect(rect.x, rect.y, rect.width, used.y - rect.y));
+		if (used.y + used.height < rect.y + rect.height)
+			split_rects.push_back(VariableTexRect(rect.x, used.y + used.height, rect.width, rect.y + rect.height - used.y - used.height));
+	}
+
+	// None of the remaining free rectangles is contained in another, and each split rectangle lies inside of a removed
+	// rectangle that contained none of them either. So only the split rectangles need to be checked for containment.
+	uint32 split_start = _free_rects.size();
+	for (uint32 i = 0; i < split_rects.size(); i++) {
+		bool contained = false;
+		for (uint32 j = 0; j < _free_rects.size() && contained == false; j++)
+			contained = _free_rects[j].Contains(split_rects[i]);
+		if (contained == true)
+			continue;
+
+		// Remove any split rectangle added before this one that this one contains
+		for (uint32 j = split_start; j < _free_rects.size();) {
+			if (split_rects[i].Contains(_free_rects[j]) == true) {
+				_free_rects[j] = _free_rects.back();
+				_free_rects.pop_back();
+			}
+			else {
+				j++;
+			}
+		}
+		_free_rects.push_back(split_rects[i]);
+	}
+}
+
+
+
+void VariableTexSheet::_ReleaseRect(const VariableTexRect& freed) {
+	// Grow the released region over every free rectangle that shares a full edge with it. Each pass over the free
+	// rectangles is repeated only if the region grew, since the larger region may now share an edge with other rectangles.
+	VariableTexRect merged = freed;
+	bool grown = true;
+	while (grown == true) {
+		grown = false;
+
+		for (uint32 i = 0; i < _free_rects.size(); i++) {
+			const VariableTexRect& rect = _free_rects[i];
+
+			// Join rectangles of equal width that are stacked vertically, or of equal height that are side by side
+			if (rect.x == merged.x && rect.width == merged.width && (rect.y + rect.height == merged.y || merged.y + merged.height == rect.y)) {
+				merged.y = (rect.y < merged.y) ? rect.y : merged.y;
+				merged.height += rect.height;
+				grown = true;
+			}
+			else if (rect.y == merged.y && rect.height == merged.height && (rect.x + rect.width == merged.x || merged.x + merged.width == rect.x)) {
+				merged.x = (rect.x < merged.x) ? rect.x : merged.x;
+				merged.width += rect.width;
+				grown = true;
+			}
+		}
 	}
 
-	// Calculate upper-left corner in blocks
-	int32 block_x = tex->x / 16;
-	int32 block_y = tex->y / 16;
+	_free_rects.push_back(merged);
+	_PruneFreeRects();
+}
+
 
-	// Calculate width and height in blocks
-	int32 w = (tex->width  + 15) / 16;
-	int32 h = (tex->height + 15) / 16;
 
-	for (int32 y = block_y; y < block_y + h; y++) {
-		for (int32 x = block_x; x < block_x + w; x++) {
-			int32 index = x + y * _block_width;
-			if (_blocks[index].image == tex) {
-				_blocks[index].free_image = free;
-				_blocks[index].image = new_tex;
+void VariableTexSheet::_PruneFreeRects() {
+	for (int32 i = 0; i < static_cast<int32>(_free_rects.size()); i++) {
+		for (int32 j = i + 1; j < static_cast<int32>(_free_rects.size());) {
+			if (_free_rects[i].Contains(_free_rects[j]) == true) {
+				_free_rects.erase(_free_rects.begin() + j);
+			}
+			else if (_free_rects[j].Contains(_free_rects[i]) == true) {
+				_free_rects.erase(_free_rects.begin() + i);
+				i--;
+				break;
+			}
+			else {
+				j++;
 			}
 		}
 	}
 }
 
+
+
+void VariableTexSheet::_PlaceTexture(BaseTexture* img, const VariableTexRect& used) {
+	_AllocateRect(used);
+	_used_area += used.GetArea();
+
+	// Calculate the pixel and uv coordinates for the newly inserted texture
+	img->x = used.x;
+	img->y = used.y;
+
+	float sheet_width = static_cast<float>(width);
+	float sheet_height = static_cast<float>(height);
+
+	img->u1 = static_cast<float>(img->x + 0.5f) / sheet_width;
+	img->u2 = static_cast<float>(img->x + img->width - 0.5f) / sheet_width;
+	img->v1 = static_cast<float>(img->y + 0.5f) / sheet_height;
+	img->v2 = static_cast<float>(img->y + img->height - 0.5f) / sheet_height;
+
+	img->texture_sheet = this;
+	_textures.insert(img);
+	TextureManager->_UpdateTexSheetIndex(this);
+}
+
+
+
+void VariableTexSheet::_RemoveFreedTextures() {
+	// RemoveTexture erases from _freed_textures, so copy the set before iterating over it
+	vector<BaseTexture*> freed(_freed_textures.begin(), _freed_textures.end());
+	for (uint32 i = 0; i < freed.size(); i++) {
+		// A freed texture has no remaining references, so once it is removed from the sheet it is deleted in the same way
+		// as ImageDescriptor::_RemoveTextureReference() does. Its destructor removes it from the TextureManager's containers.
+		RemoveTexture(freed[i]);
+		delete freed[i];
+	}
+}
+
 } // namespace private_video
 
 } // namespace hoa_video
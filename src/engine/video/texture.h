@@ -34,8 +34,10 @@
 *** This sheet allows textures of any size to be inserted, but has slower
 *** performance than the FixedTexSheet.
 ***
-*** - <b>VariableTexNode</b>: represents a texture node entry for the
+*** - <b>VariableTexRect</b>: represents a rectangular region of pixels in the
 *** VariableTexSheet class.
+***
+*** - <b>TexSheetStatistics</b>: reports how much of a texture sheet is in use.
 *** ***************************************************************************/
 
 #pragma once
@@ -63,6 +65,9 @@ namespace private_video {
 //! \brief Used to indicate an invalid texture ID
 const GLuint INVALID_TEXTURE_ID = 0xFFFFFFFF;
 
+//! \brief The default width and height, in pixels, of texture sheets that are shared between multiple images
+const int32 DEFAULT_TEXSHEET_SIZE = 512;
+
 //! \brief Represents the different image sizes that a texture sheet can hold
 enum TexSheetType {
 	VIDEO_TEXSHEET_INVALID = -1,
@@ -76,6 +81,41 @@ enum TexSheetType {
 };
 
 
+/** ****************************************************************************
+*** \brief Describes how much of a texture sheet's space is in use
+***
+*** All areas are measured in pixels.
+*** ***************************************************************************/
+class TexSheetStatistics {
+public:
+	TexSheetStatistics() :
+		texture_count(0), used_area(0), free_area(0), largest_free_area(0) {}
+
+	//! \brief The number of textures that occupy space in the sheet
+	uint32 texture_count;
+
+	//! \brief The area occupied by textures
+	uint32 used_area;
+
+	//! \brief The area that is not occupied by any texture
+	uint32 free_area;
+
+	//! \brief The area of the largest rectangular region that a new texture could be placed in
+	uint32 largest_free_area;
+
+	//! \brief Returns the fraction of the sheet that is occupied by textures, between 0.0f and 1.0f
+	float GetOccupancy() const
+		{ return (used_area + free_area == 0) ? 0.0f : static_cast<float>(used_area) / static_cast<float>(used_area + free_area); }
+
+	/** \brief Returns the fraction of the free area that lies outside of the largest free region, between 0.0f and 1.0f
+	*** A value of zero means that all free space is available in one piece, while values near one mean that the
+	*** free space is split up into many small pieces that larger textures can not use.
+	**/
+	float GetFragmentation() const
+		{ return (free_area == 0) ? 0.0f : 1.0f - static_cast<float>(largest_free_area) / static_cast<float>(free_area); }
+}; // class TexSheetStatistics
+
+
 /** ****************************************************************************
 *** \brief An OpenGL texture which can store multiple smaller textures in itself
 ***
@@ -90,6 +130,8 @@ enum TexSheetType {
 *** is rather a container for smaller textures.
 *** ***************************************************************************/
 class TexSheet {
+	friend class hoa_video::TextureController;
+
 public:
 	/** \brief Constructs a new texture sheet
 	*** \param sheet_width The width of the sheet
@@ -148,6 +190,14 @@ public:
 	//! \brief Returns the number of textures that are contained on this texture sheet
 	virtual uint32 GetNumberTextures() = 0;
 
+	//! \brief Returns the occupancy and fragmentation information of this texture sheet
+	virtual TexSheetStatistics GetStatistics() const = 0;
+
+	/** \brief Returns the area, in pixels, that is available for new textures
+	*** This includes the space of textures that have been freed, since that space is reclaimed when needed.
+	**/
+	virtual uint32 GetAvailableArea() const = 0;
+
 	/** \brief Unloads all texture memory used by OpenGL for this sheet
 	*** \return Success/failure
 	**/
@@ -217,9 +267,17 @@ public:
 	//! \brief Flag indicating if texture sheet is loaded or not
 	bool loaded;
 
+	/** \brief False if the sheet was created to hold a single texture
+	*** Unshared sheets are never given additional textures, and are deleted along with their texture.
+	**/
+	bool shared;
+
 protected:
 	//! \brief The width and height of the sheet in number of texture blocks
 	int32 _block_width, _block_height;
+
+	//! \brief The available area that the TextureController has indexed this sheet under, or -1 if the sheet is not indexed
+	int32 _indexed_area;
 }; // class TexSheet
 
 
@@ -298,12 +356,20 @@ public:
 	void RestoreTexture(BaseTexture* img);
 
 	uint32 GetNumberTextures();
+
+	TexSheetStatistics GetStatistics() const;
+
+	uint32 GetAvailableArea() const
+		{ return _open_count * _texture_width * _texture_height; }
 	//@}
 
 private:
 	//! \brief The width and height of each texture block, in number of pixels
 	int32 _texture_width, _texture_height;
 
+	//! \brief The number of blocks on the open list
+	int32 _open_count;
+
 	//! \brief Head of the list of open texture blocks
 	FixedTexNode* _open_list_head;
 
@@ -335,29 +401,49 @@ private:
 
 
 /** ****************************************************************************
-*** \brief Keeps track of which images are used/freed in the variable texture mem manager
+*** \brief A rectangular region of pixels within a variable texture sheet
 *** ***************************************************************************/
-class VariableTexNode {
+class VariableTexRect {
 public:
-	VariableTexNode() :
-		image(nullptr), free_image(true) {}
+	VariableTexRect() :
+		x(0), y(0), width(0), height(0) {}
 
-	//! \brief A pointer to the image
-	BaseTexture* image;
+	VariableTexRect(int32 rect_x, int32 rect_y, int32 rect_width, int32 rect_height) :
+		x(rect_x), y(rect_y), width(rect_width), height(rect_height) {}
+
+	//! \brief The pixel coordinates of the upper left corner of the region
+	int32 x, y;
 
-	//! \brief Set to true if the image is freed
-	bool free_image;
-}; // class VariableTexNode
+	//! \brief The dimensions of the region, in pixels
+	int32 width, height;
+
+	uint32 GetArea() const
+		{ return static_cast<uint32>(width * height); }
+
+	//! \brief Returns true if the other region lies entirely inside of this region
+	bool Contains(const VariableTexRect& other) const
+		{ return (other.x >= x && other.y >= y && other.x + other.width <= x + width && other.y + other.height <= y + height); }
+
+	//! \brief Returns true if the two regions share at least one pixel
+	bool Intersects(const VariableTexRect& other) const
+		{ return (other.x < x + width && other.x + other.width > x && other.y < y + height && other.y + other.height > y); }
+}; // class VariableTexRect
 
 
 /** ****************************************************************************
 *** \brief Used to manage texture sheets of variable image sizes
 ***
-*** This class divides a texture sheet up into 16x16 pixel blocks, and keeps
-*** track of which images have allocated which blocks. This is done to reduce
-*** the time complexity for doing texture insertion and removal operations, but
-*** the downside is that it may leave some space in the texture sheet occupied
-*** but unused for images that are not divisible by 16 in width or height.
+*** Space is allocated with the MaxRects algorithm. The sheet maintains a list of
+*** free rectangles, each as large as it can be, which may overlap one another.
+*** A new texture is placed in the free rectangle that leaves the shortest side
+*** of unused space (the "best short side fit" heuristic), after which every free
+*** rectangle that overlaps the texture is split into the free rectangles that
+*** surround it. This packs textures tightly regardless of their size.
+***
+*** When a texture is removed, its region is returned to the free list and merged
+*** with adjacent free rectangles where possible. Textures that are freed (instead
+*** of removed) keep their space until an insertion can not otherwise be satisfied,
+*** at which point all freed textures are removed from the sheet.
 *** ***************************************************************************/
 class VariableTexSheet : public TexSheet {
 public:
@@ -380,33 +466,81 @@ public:
 
 	void RemoveTexture(BaseTexture* img);
 
-	void FreeTexture(BaseTexture* img)
-		{ _SetBlockProperties(img, img, true); }
+	void FreeTexture(BaseTexture* img);
 
-	void RestoreTexture(BaseTexture* img)
-		{ _SetBlockProperties(img, img, false); }
+	void RestoreTexture(BaseTexture* img);
 
 	uint32 GetNumberTextures()
 		{ return _textures.size(); }
+
+	TexSheetStatistics GetStatistics() const;
+
+	uint32 GetAvailableArea() const
+		{ return static_cast<uint32>(width * height) - _used_area + _freed_area; }
 	//@}
 
-private:
-	/** \brief The list of 16x16 pixel blocks in the sheet.
-	*** The size of this structure is: (width / 16) * (height / 16)
+	/** \brief Inserts a new texture into the tex sheet at a specific location
+	*** \param img A pointer to the new image to insert
+	*** \param x The x coordinate of the upper left corner of the texture in the sheet
+	*** \param y The y coordinate of the upper left corner of the texture in the sheet
+	*** \return False if any part of the region is already occupied or lies outside of the sheet
+	***
+	*** This is used for sheets whose pixel data was prepared in advance, such as texture atlas pages, where the
+	*** location of each texture is already known. Like InsertTexture(), no pixel data is copied by this function.
+	*** Unlike InsertTexture(), this function may be used to add multiple textures to an unshared sheet.
 	**/
-	VariableTexNode* _blocks;
+	bool InsertTextureAt(BaseTexture* img, int32 x, int32 y);
+
+private:
+	//! \brief The free rectangles of the sheet. No free rectangle is contained within another.
+	std::vector<VariableTexRect> _free_rects;
 
 	/** \brief A set containing each texture that has been inserted into this class
 	*** This container is used to be able to quickly determine if a texture is loaded by an object of this class
 	**/
 	std::set<BaseTexture*> _textures;
 
-	/** \brief Updates the properties of all of the blocks associated with a given texture
-	*** \param tex The texture to update
-	*** \param new_tex The texture pointer to set the block to
-	*** \param new_image The boolean value to set the free status flag to
+	//! \brief The textures that have been freed but still occupy space in the sheet
+	std::set<BaseTexture*> _freed_textures;
+
+	//! \brief The total area of all textures in the sheet, including freed textures
+	uint32 _used_area;
+
+	//! \brief The total area of all freed textures in the sheet
+	uint32 _freed_area;
+
+	/** \brief Finds the free rectangle to place a texture in
+	*** \param tex_width The width of the texture
+	*** \param tex_height The height of the texture
+	*** \return The index of the free rectangle in _free_rects, or -1 if the texture does not fit in any free rectangle
 	**/
-	void _SetBlockProperties(BaseTexture* tex, BaseTexture* new_tex, bool free);
+	int32 _FindFreeRect(int32 tex_width, int32 tex_height) const;
+
+	/** \brief Removes a region from the free rectangles by splitting every free rectangle that it overlaps
+	*** \param used The region that is now occupied
+	***
+	*** Only the rectangles created by the split are checked for containment in the other free rectangles.
+	**/
+	void _AllocateRect(const VariableTexRect& used);
+
+	/** \brief Returns a region to the free rectangles
+	*** \param freed The region that is no longer occupied
+	***
+	*** The region is first joined with the free rectangles that share a full edge with it.
+	**/
+	void _ReleaseRect(const VariableTexRect& freed);
+
+	//! \brief Removes every free rectangle that is contained within another in a single pass over all pairs of rectangles
+	void _PruneFreeRects();
+
+	/** \brief Allocates a region of the sheet to a texture and computes the texture's coordinates
+	*** \param img The texture to place
+	*** \param used The region to give to the texture, which must lie within a free rectangle
+	**/
+	void _PlaceTexture(BaseTexture* img, const VariableTexRect& used);
+
+	//! \brief Removes every freed texture from the sheet so that its space may be reused
+	void _RemoveFreedTextures();
 }; // class VariableTexSheet : public TexSheet
 
 }  // namespace private_video
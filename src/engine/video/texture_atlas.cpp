@@ -0,0 +1,264 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    texture_atlas.cpp
+*** \author  agent
+*** \brief   Source file for prebuilt texture atlases
+*** ***************************************************************************/
+
+#include <cstring>
+
+#include "texture_atlas.h"
+
+using namespace std;
+using namespace hoa_utils;
+
+namespace hoa_video {
+
+namespace private_video {
+
+//! \brief Writes a string to a file as a uint32 length followed by the characters
+static void _WriteString(ofstream& file, const string& text) {
+	uint32 length = text.length();
+	file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+	file.write(text.data(), length);
+}
+
+
+
+/** \brief Returns the number of bytes between the current read position of a file and its end
+*** \param file The file to examine
+*** \param file_size The total size of the file, in bytes
+**/
+static uint64_t _RemainingBytes(ifstream& file, uint64_t file_size) {
+	streamoff position = file.tellg();
+	if (position < 0 || static_cast<uint64_t>(position) > file_size)
+		return 0;
+
+	return file_size - static_cast<uint64_t>(position);
+}
+
+
+
+/** \brief Reads a string that was written by _WriteString
+*** \param file The file to read from
+*** \param file_size The total size of the file, which the length of the string is checked against before any memory is allocated
+*** \param text Set to the string that was read
+*** \return False if the end of the file was reached before the string was read
+**/
+static bool _ReadString(ifstream& file, uint64_t file_size, string& text) {
+	uint32 length = 0;
+	if (file.read(reinterpret_cast<char*>(&length), sizeof(length)).good() == false)
+		return false;
+
+	if (length > _RemainingBytes(file, file_size))
+		return false;
+
+	text.resize(length);
+	if (length == 0)
+		return true;
+
+	return file.read(&text[0], length).good();
+}
+
+// -----------------------------------------------------------------------------
+// ---------- TextureAtlasSource Class Methods
+// -----------------------------------------------------------------------------
+
+bool TextureAtlasSource::IsCurrent() const {
+	uint64_t current_size = 0;
+	uint64_t current_time = 0;
+	if (GetFileStatus(filename, current_size, current_time) == false)
+		return false;
+
+	return (current_size == file_size && current_time == modify_time);
+}
+
+// -----------------------------------------------------------------------------
+// ---------- TextureAtlasIndex Class Methods
+// -----------------------------------------------------------------------------
+
+bool TextureAtlasIndex::Load(const string& filename) {
+	Clear();
+
+	ifstream file(filename.c_str(), ios::in | ios::binary);
+	if (file.is_open() == false)
+		return false;
+
+	file.seekg(0, ios::end);
+	uint64_t file_size = static_cast<uint64_t>(file.tellg());
+	file.seekg(0, ios::beg);
+
+	TextureAtlasHeader header;
+	if (file.read(reinterpret_cast<char*>(&header), sizeof(header)).good() == false
+		|| memcmp(header.magic, TEXTURE_ATLAS_MAGIC, sizeof(header.magic)) != 0
+		|| header.version != TEXTURE_ATLAS_VERSION || header.byte_order != TEXTURE_ATLAS_BYTE_ORDER)
+	{
+		PRINT_WARNING << "texture atlas index was malformed or of an unsupported version: " << filename << endl;
+		return false;
+	}
+
+	// The smallest number of bytes that each page, source, and entry occupies in the file. The counts in the header are
+	// checked against the remaining size of the file before anything is allocated, so that a corrupt index can not request
+	// more memory than the file itself could describe.
+	const uint64_t min_page_size = 3 * sizeof(uint32);
+	const uint64_t min_source_size = sizeof(uint32) + 2 * sizeof(uint64_t) + 5 * sizeof(uint32);
+
+	bool valid = (header.page_count * min_page_size <= _RemainingBytes(file, file_size));
+	if (valid == true)
+		_pages.resize(header.page_count);
+	for (uint32 i = 0; i < header.page_count && valid == true; ++i) {
+		file.read(reinterpret_cast<char*>(&_pages[i].width), sizeof(_pages[i].width));
+		file.read(reinterpret_cast<char*>(&_pages[i].height), sizeof(_pages[i].height));
+		valid = _ReadString(file, file_size, _pages[i].filename);
+	}
+
+	if (valid == true && header.source_count * min_source_size > _RemainingBytes(file, file_size))
+		valid = false;
+	if (valid == true)
+		_sources.resize(header.source_count);
+	for (uint32 i = 0; i < header.source_count && valid == true; ++i) {
+		TextureAtlasSource& source = _sources[i];
+		valid = _ReadString(file, file_size, source.filename);
+		file.read(reinterpret_cast<char*>(&source.file_size), sizeof(source.file_size));
+		file.read(reinterpret_cast<char*>(&source.modify_time), sizeof(source.modify_time));
+		file.read(reinterpret_cast<char*>(&source.rows), sizeof(source.rows));
+		file.read(reinterpret_cast<char*>(&source.cols), sizeof(source.cols));
+		file.read(reinterpret_cast<char*>(&source.element_width), sizeof(source.element_width));
+		file.read(reinterpret_cast<char*>(&source.element_height), sizeof(source.element_height));
+		file.read(reinterpret_cast<char*>(&source.first_entry), sizeof(source.first_entry));
+		valid = valid && file.good();
+
+		// Every element of the source must refer to an entry that exists
+		if (valid == true && static_cast<uint64_t>(source.first_entry) + static_cast<uint64_t>(source.rows) * static_cast<uint64_t>(source.cols) > header.entry_count)
+			valid = false;
+	}
+
+	if (valid == true && header.entry_count * static_cast<uint64_t>(sizeof(TextureAtlasEntry)) > _RemainingBytes(file, file_size))
+		valid = false;
+	if (valid == true && header.entry_count > 0) {
+		_entries.resize(header.entry_count);
+		valid = file.read(reinterpret_cast<char*>(&_entries[0]), header.entry_count * sizeof(TextureAtlasEntry)).good();
+	}
+
+	for (uint32 i = 0; i < _entries.size() && valid == true; ++i) {
+		if (_entries[i].page >= _pages.size())
+			valid = false;
+	}
+
+	if (valid == false) {
+		PRINT_WARNING << "texture atlas index was truncated or contained invalid data: " << filename << endl;
+		Clear();
+		return false;
+	}
+
+	for (uint32 i = 0; i < _sources.size(); ++i) {
+		_source_lookup[_MakeSourceKey(_sources[i].filename, _sources[i].rows, _sources[i].cols)] = i;
+	}
+
+	return true;
+} // bool TextureAtlasIndex::Load(const string& filename)
+
+
+
+bool TextureAtlasIndex::Save(const string& filename) const {
+	ofstream file(filename.c_str(), ios::out | ios::binary | ios::trunc);
+	if (file.is_open() == false) {
+		PRINT_ERROR << "failed to open texture atlas index for writing: " << filename << endl;
+		return false;
+	}
+
+	TextureAtlasHeader header;
+	memcpy(header.magic, TEXTURE_ATLAS_MAGIC, sizeof(header.magic));
+	header.version = TEXTURE_ATLAS_VERSION;
+	header.byte_order = TEXTURE_ATLAS_BYTE_ORDER;
+	header.page_count = _pages.size();
+	header.source_count = _sources.size();
+	header.entry_count = _entries.size();
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	for (uint32 i = 0; i < _pages.size(); ++i) {
+		file.write(reinterpret_cast<const char*>(&_pages[i].width), sizeof(_pages[i].width));
+		file.write(reinterpret_cast<const char*>(&_pages[i].height), sizeof(_pages[i].height));
+		_WriteString(file, _pages[i].filename);
+	}
+
+	for (uint32 i = 0; i < _sources.size(); ++i) {
+		const TextureAtlasSource& source = _sources[i];
+		_WriteString(file, source.filename);
+		file.write(reinterpret_cast<const char*>(&source.file_size), sizeof(source.file_size));
+		file.write(reinterpret_cast<const char*>(&source.modify_time), sizeof(source.modify_time));
+		file.write(reinterpret_cast<const char*>(&source.rows), sizeof(source.rows));
+		file.write(reinterpret_cast<const char*>(&source.cols), sizeof(source.cols));
+		file.write(reinterpret_cast<const char*>(&source.element_width), sizeof(source.element_width));
+		file.write(reinterpret_cast<const char*>(&source.element_height), sizeof(source.element_height));
+		file.write(reinterpret_cast<const char*>(&source.first_entry), sizeof(source.first_entry));
+	}
+
+	if (_entries.empty() == false)
+		file.write(reinterpret_cast<const char*>(&_entries[0]), _entries.size() * sizeof(TextureAtlasEntry));
+
+	if (file.good() == false) {
+		PRINT_ERROR << "failed to write texture atlas index: " << filename << endl;
+		return false;
+	}
+
+	return true;
+} // bool TextureAtlasIndex::Save(const string& filename) const
+
+
+
+void TextureAtlasIndex::Clear() {
+	_pages.clear();
+	_sources.clear();
+	_entries.clear();
+	_source_lookup.clear();
+}
+
+
+
+uint16 TextureAtlasIndex::AddPage(const TextureAtlasPage& page) {
+	_pages.push_back(page);
+	return static_cast<uint16>(_pages.size() - 1);
+}
+
+
+
+void TextureAtlasIndex::AddSource(const TextureAtlasSource& source, const vector<TextureAtlasEntry>& entries) {
+	if (entries.size() != source.rows * source.cols) {
+		PRINT_WARNING << "number of entries did not match the grid size of the source: " << source.filename << endl;
+		return;
+	}
+
+	_source_lookup[_MakeSourceKey(source.filename, source.rows, source.cols)] = _sources.size();
+	_sources.push_back(source);
+	_sources.back().first_entry = _entries.size();
+	_entries.insert(_entries.end(), entries.begin(), entries.end());
+}
+
+
+
+const TextureAtlasSource* TextureAtlasIndex::FindSource(const string& filename, uint32 rows, uint32 cols) const {
+	map<string, uint32>::const_iterator i = _source_lookup.find(_MakeSourceKey(filename, rows, cols));
+	if (i == _source_lookup.end())
+		return nullptr;
+
+	return &_sources[i->second];
+}
+
+
+
+string TextureAtlasIndex::_MakeSourceKey(const string& filename, uint32 rows, uint32 cols) {
+	return filename + "<" + NumberToString(rows) + "x" + NumberToString(cols) + ">";
+}
+
+} // namespace private_video
+
+} // namespace hoa_video
@@ -0,0 +1,215 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    texture_atlas.h
+*** \author  agent
+*** \brief   Header file for prebuilt texture atlases
+***
+*** Tilesets and sprite sheets are multi images: a single image file that is
+*** divided into a grid of equally sized elements. Loading one normally requires
+*** decoding the entire file and copying each element into a texture sheet one
+*** at a time. The allacrost-atlas tool performs this work ahead of time by
+*** packing every tileset and sprite sheet into a small number of atlas pages,
+*** which are ordinary PNG images, and writing an index that records where each
+*** element of each multi image was placed.
+***
+*** The index file is made up of the following sections:
+***
+*** -# The header (TextureAtlasHeader)
+*** -# The pages, each stored as the page width and height followed by the page filename
+*** -# The sources, each stored as the source filename followed by the remaining TextureAtlasSource members
+*** -# The entries (TextureAtlasEntry), in the order of the elements of each source
+***
+*** Strings are stored as a uint32 length followed by the characters. All values
+*** are stored in native byte order.
+***
+*** \note This file is also compiled into the allacrost-atlas tool and therefore
+*** must not depend on any engine.
+*** ***************************************************************************/
+
+#pragma once
+
+#include "utils.h"
+#include "defs.h"
+
+namespace hoa_video {
+
+namespace private_video {
+
+//! \brief The four characters that every texture atlas index file begins with
+const char TEXTURE_ATLAS_MAGIC[4] = { 'H', 'O', 'A', 'A' };
+
+//! \brief The version of the index format. This must be incremented whenever the layout of the format changes
+const uint32 TEXTURE_ATLAS_VERSION = 1;
+
+//! \brief Written to every header in native byte order so that files built on a machine of different endianness are rejected
+const uint32 TEXTURE_ATLAS_BYTE_ORDER = 0x01020304;
+
+//! \brief The directory that the atlas pages and index are written to
+const std::string TEXTURE_ATLAS_DIRECTORY = "img/atlas/";
+
+//! \brief The name of the texture atlas index file that the game loads
+const std::string TEXTURE_ATLAS_INDEX_FILENAME = TEXTURE_ATLAS_DIRECTORY + "atlas.idx";
+
+//! \brief The header found at the beginning of every texture atlas index file
+class TextureAtlasHeader {
+public:
+	char magic[4];
+	uint32 version;
+	uint32 byte_order;
+
+	uint32 page_count;
+	uint32 source_count;
+	uint32 entry_count;
+}; // class TextureAtlasHeader
+
+
+//! \brief A single image that holds the elements of one or more multi images
+class TextureAtlasPage {
+public:
+	TextureAtlasPage() :
+		width(0), height(0) {}
+
+	//! \brief The filename of the page image
+	std::string filename;
+
+	//! \brief The dimensions of the page image, in pixels. Both are powers of two.
+	uint32 width, height;
+}; // class TextureAtlasPage
+
+
+/** ****************************************************************************
+*** \brief Describes a multi image that was packed into the atlas
+***
+*** The size and modification time of the source file are recorded when the
+*** atlas is built. A source whose file has since changed is stale, and the
+*** game loads the original file instead.
+*** ***************************************************************************/
+class TextureAtlasSource {
+public:
+	TextureAtlasSource() :
+		file_size(0), modify_time(0), rows(0), cols(0), element_width(0), element_height(0), first_entry(0) {}
+
+	//! \brief The filename of the multi image
+	std::string filename;
+
+	//! \brief The size and last modification time of the multi image file when the atlas was built
+	uint64_t file_size, modify_time;
+
+	//! \brief The number of rows and columns of elements that the multi image is divided into
+	uint32 rows, cols;
+
+	//! \brief The dimensions of each element, in pixels
+	uint32 element_width, element_height;
+
+	//! \brief The index of the entry of the first element. The entries of the other elements follow it in row-major order.
+	uint32 first_entry;
+
+	//! \brief Returns true if the multi image file has not changed since the atlas was built
+	bool IsCurrent() const;
+}; // class TextureAtlasSource
+
+
+//! \brief The location of a single element of a multi image in the atlas
+class TextureAtlasEntry {
+public:
+	TextureAtlasEntry() :
+		page(0), x(0), y(0) {}
+
+	TextureAtlasEntry(uint16 entry_page, uint16 entry_x, uint16 entry_y) :
+		page(entry_page), x(entry_x), y(entry_y) {}
+
+	//! \brief The index of the page that holds the element
+	uint16 page;
+
+	//! \brief The pixel coordinates of the upper left corner of the element in the page
+	uint16 x, y;
+}; // class TextureAtlasEntry
+
+
+/** ****************************************************************************
+*** \brief The contents of a texture atlas index file
+***
+*** The atlas builder adds pages and sources to an index and saves it, while the
+*** TextureController loads the index and looks up the location of each multi
+*** image as it is requested.
+*** ***************************************************************************/
+class TextureAtlasIndex {
+public:
+	TextureAtlasIndex()
+		{}
+
+	/** \brief Loads and validates an index file, replacing the current contents of the index
+	*** \param filename The name of the index file to load
+	*** \return False if the file is missing or malformed, in which case the index is left empty
+	**/
+	bool Load(const std::string& filename);
+
+	/** \brief Writes the contents of the index to a file
+	*** \param filename The name of the index file to write
+	*** \return False if the file could not be written
+	**/
+	bool Save(const std::string& filename) const;
+
+	//! \brief Removes all pages, sources, and entries from the index
+	void Clear();
+
+	bool IsEmpty() const
+		{ return _sources.empty(); }
+
+	/** \brief Adds a page to the index
+	*** \param page The page to add
+	*** \return The index of the page, to be used in the entries that refer to it
+	**/
+	uint16 AddPage(const TextureAtlasPage& page);
+
+	/** \brief Adds a multi image and the locations of all of its elements to the index
+	*** \param source The multi image to add. Its first_entry member is set by this function.
+	*** \param entries The location of each element, in row-major order. Must contain rows * cols elements.
+	**/
+	void AddSource(const TextureAtlasSource& source, const std::vector<TextureAtlasEntry>& entries);
+
+	/** \brief Finds a multi image in the index
+	*** \param filename The filename of the multi image
+	*** \param rows The number of rows of elements that the multi image is divided into
+	*** \param cols The number of columns of elements that the multi image is divided into
+	*** \return A pointer to the source, or nullptr if the multi image was not packed with that grid size
+	**/
+	const TextureAtlasSource* FindSource(const std::string& filename, uint32 rows, uint32 cols) const;
+
+	//! \name Class Member Accessor Methods
+	//@{
+	const std::vector<TextureAtlasPage>& GetPages() const
+		{ return _pages; }
+
+	const std::vector<TextureAtlasSource>& GetSources() const
+		{ return _sources; }
+
+	const std::vector<TextureAtlasEntry>& GetEntries() const
+		{ return _entries; }
+	//@}
+
+private:
+	std::vector<TextureAtlasPage> _pages;
+
+	std::vector<TextureAtlasSource> _sources;
+
+	std::vector<TextureAtlasEntry> _entries;
+
+	//! \brief Maps the lookup key of each source to its index in _sources
+	std::map<std::string, uint32> _source_lookup;
+
+	//! \brief Returns the key that a multi image with the given filename and grid size is found under in _source_lookup
+	static std::string _MakeSourceKey(const std::string& filename, uint32 rows, uint32 cols);
+}; // class TextureAtlasIndex
+
+} // namespace private_video
+
+} // namespace hoa_video
@@ -32,6 +32,10 @@ TextureController* TextureManager = nullptr;
 TextureController::TextureController() :
 	debug_current_sheet(-1),
 	_last_tex_id(INVALID_TEXTURE_ID),
+	_tex_sheet_size(DEFAULT_TEXSHEET_SIZE),
+	_tex_sheet_index(VIDEO_TEXSHEET_TOTAL * 2),
+	_text_texture_hits(0),
+	_text_texture_misses(0),
 	_debug_num_tex_switches(0)
 {}
 
@@ -48,6 +52,18 @@ TextureController::~TextureController() {
 		delete img;
 	}
 
+	IF_PRINT_DEBUG(VIDEO_DEBUG) << "text texture cache hits: " << _text_texture_hits << ", misses: " << _text_texture_misses << endl;
+
+	// Release the reference held by the cache to every text texture, deleting those that no image refers to
+	_text_texture_cache.clear();
+	for (list<TextTexture*>::iterator i = _text_texture_lru.begin(); i != _text_texture_lru.end(); i++) {
+		if ((*i)->ref_count > 1)
+			(*i)->RemoveReference();
+		else
+			_DeleteTextTexture(*i);
+	}
+	_text_texture_lru.clear();
+
 	IF_PRINT_DEBUG(VIDEO_DEBUG) << "Deleting all remaining texture sheets, a total of: " << _tex_sheets.size() << endl;
 	for (vector<TexSheet*>::iterator i = _tex_sheets.begin(); i != _tex_sheets.end(); i++) {
 		delete *i;
@@ -57,28 +73,60 @@ TextureController::~TextureController() {
 
 
 bool TextureController::SingletonInitialize() {
+	_image_cache.Initialize(GetUserDataPath() + "image_cache/", VideoManager->_image_cache_size);
+
+	// Determine the size of shared texture sheets. The size must be a power of two large enough to hold the largest
+	// fixed size images, and may not exceed the largest texture that the OpenGL implementation supports.
+	GLint max_texture_size = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+
+	_tex_sheet_size = VideoManager->_tex_sheet_size;
+	if (IsPowerOfTwo(_tex_sheet_size) == false || _tex_sheet_size < 64) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "invalid texture sheet size requested: " << _tex_sheet_size << ", using default size" << endl;
+		_tex_sheet_size = DEFAULT_TEXSHEET_SIZE;
+	}
+	if (max_texture_size > 0 && _tex_sheet_size > max_texture_size) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "texture sheet size " << _tex_sheet_size << " exceeds GL_MAX_TEXTURE_SIZE, using size: " << max_texture_size << endl;
+		_tex_sheet_size = max_texture_size;
+	}
+
 	// Create a default set of texture sheets
-	if (_CreateTexSheet(512, 512, VIDEO_TEXSHEET_32x32, false) == nullptr) {
+	if (_CreateTexSheet(_tex_sheet_size, _tex_sheet_size, VIDEO_TEXSHEET_32x32, false) == nullptr) {
 		PRINT_ERROR << "could not create default 32x32 texture sheet" << endl;
 		return false;
 	}
-	if (_CreateTexSheet(512, 512, VIDEO_TEXSHEET_32x64, false) == nullptr) {
+	if (_CreateTexSheet(_tex_sheet_size, _tex_sheet_size, VIDEO_TEXSHEET_32x64, false) == nullptr) {
 		PRINT_ERROR << "could not create default 32x64 texture sheet" << endl;
 		return false;
 	}
-	if (_CreateTexSheet(512, 512, VIDEO_TEXSHEET_64x64, false) == nullptr) {
+	if (_CreateTexSheet(_tex_sheet_size, _tex_sheet_size, VIDEO_TEXSHEET_64x64, false) == nullptr) {
 		PRINT_ERROR << "could not create default 64x64 texture sheet" << endl;
 		return false;
 	}
-	if (_CreateTexSheet(512, 512, VIDEO_TEXSHEET_ANY, true) == nullptr) {
+	if (_CreateTexSheet(_tex_sheet_size, _tex_sheet_size, VIDEO_TEXSHEET_ANY, true) == nullptr) {
 		PRINT_ERROR << "could not create default static variable sized texture sheet" << endl;
 		return false;
 	}
-	if (_CreateTexSheet(512, 512, VIDEO_TEXSHEET_ANY, false) == nullptr) {
+	if (_CreateTexSheet(_tex_sheet_size, _tex_sheet_size, VIDEO_TEXSHEET_ANY, false) == nullptr) {
 		PRINT_ERROR << "could not create default variable sized tex sheet" << endl;
 		return false;
 	}
 
+	// The texture atlas is optional. When it is absent, or any page is too large for this OpenGL implementation, all multi
+	// images are loaded from their own files.
+	if (DoesFileExist(TEXTURE_ATLAS_INDEX_FILENAME) == true && _atlas.Load(TEXTURE_ATLAS_INDEX_FILENAME) == true) {
+		const vector<TextureAtlasPage>& pages = _atlas.GetPages();
+		for (uint32 i = 0; i < pages.size(); i++) {
+			if (max_texture_size > 0 && (pages[i].width > static_cast<uint32>(max_texture_size) || pages[i].height > static_cast<uint32>(max_texture_size))) {
+				IF_PRINT_WARNING(VIDEO_DEBUG) << "texture atlas page exceeds GL_MAX_TEXTURE_SIZE, the atlas will not be used: " << pages[i].filename << endl;
+				_atlas.Clear();
+				break;
+			}
+		}
+		_atlas_sheets.assign(_atlas.GetPages().size(), nullptr);
+		IF_PRINT_DEBUG(VIDEO_DEBUG) << "loaded texture atlas with " << _atlas.GetSources().size() << " images on " << _atlas.GetPages().size() << " pages" << endl;
+	}
+
 	return true;
 }
 
@@ -117,16 +165,8 @@ bool TextureController::UnloadTextures() {
 	while (j != TextManager->_font_map.end()) {
 		FontProperties *fp = j->second;
 
-		if (fp->glyph_cache != nullptr) {
-			for (uint32 k = 0; k < fp->glyph_cache->size(); ++k) {
-				if (fp->glyph_cache->at(k) != nullptr) {
-					_DeleteTexture(fp->glyph_cache->at(k)->texture);
-					delete fp->glyph_cache->at(k);
-				}
-			}
-
-			fp->glyph_cache->clear();
-		}
+		if (fp->glyph_cache != nullptr)
+			TextManager->_FreeGlyphs(fp);
 
 		j++;
 	}
@@ -162,6 +202,30 @@ bool TextureController::ReloadTextures() {
 
 
 
+bool TextureController::IsImageInAtlas(const string& filename, uint32 rows, uint32 cols) const {
+	const TextureAtlasSource* source = _atlas.FindSource(filename, rows, cols);
+	return (source != nullptr && source->IsCurrent() == true);
+}
+
+
+
+void TextureController::GetTextTextureStatistics(uint32& hit_count, uint32& miss_count, uint32& texture_count) const {
+	hit_count = _text_texture_hits;
+	miss_count = _text_texture_misses;
+	texture_count = _text_texture_lru.size();
+}
+
+
+
+void TextureController::GetTexSheetStatistics(vector<TexSheetStatistics>& statistics) const {
+	statistics.clear();
+	for (uint32 i = 0; i < _tex_sheets.size(); i++) {
+		statistics.push_back(_tex_sheets[i]->GetStatistics());
+	}
+}
+
+
+
 void TextureController::DEBUG_NextTexSheet() {
 	debug_current_sheet++;
 
@@ -210,13 +274,18 @@ void TextureController::DEBUG_ShowTexSheet() {
 	VideoManager->SetDrawFlags(VIDEO_NO_BLEND, VIDEO_X_LEFT, VIDEO_Y_BOTTOM, 0);
 	VideoManager->SetCoordSys(0.0f, 1024.0f, 0.0f, 768.0f);
 
-	glPushMatrix();
+	// Sheets are drawn at half size, or smaller if that would not fit on the screen
+	float draw_scale = 0.5f;
+	if (sheet->width > 1024 || sheet->height > 1024)
+		draw_scale = 512.0f / static_cast<float>(max(sheet->width, sheet->height));
+
+	VideoManager->PushMatrix();
 	VideoManager->Move(0.0f,0.0f);
-	glScalef(sheet->width / 2.0f, sheet->height / 2.0f, 1.0f);
+	VideoManager->Scale(sheet->width * draw_scale, sheet->height * draw_scale);
 
 	sheet->DEBUG_Draw();
 
-	glPopMatrix();
+	VideoManager->PopMatrix();
 
 	char buf[200];
 
@@ -253,6 +322,32 @@ void TextureController::DEBUG_ShowTexSheet() {
 	VideoManager->MoveRelative(0, -20);
 	TextManager->Draw(buf);
 
+	TexSheetStatistics stats = sheet->GetStatistics();
+	sprintf(buf, "  Textures: %u", stats.texture_count);
+	VideoManager->MoveRelative(0, -20);
+	TextManager->Draw(buf);
+
+	sprintf(buf, "  Occupancy: %.1f%%", stats.GetOccupancy() * 100.0f);
+	VideoManager->MoveRelative(0, -20);
+	TextManager->Draw(buf);
+
+	sprintf(buf, "  Fragmentation: %.1f%%", stats.GetFragmentation() * 100.0f);
+	VideoManager->MoveRelative(0, -20);
+	TextManager->Draw(buf);
+
+	// Summarize the occupancy of all texture sheets together
+	uint32 total_used = 0;
+	uint32 total_area = 0;
+	for (uint32 i = 0; i < _tex_sheets.size(); i++) {
+		TexSheetStatistics sheet_stats = _tex_sheets[i]->GetStatistics();
+		total_used += sheet_stats.used_area;
+		total_area += sheet_stats.used_area + sheet_stats.free_area;
+	}
+
+	VideoManager->MoveRelative(0, -40);
+	sprintf(buf, "All %d sheets: %.1f%% occupied", num_sheets, (total_area == 0) ? 0.0f : total_used * 100.0f / total_area);
+	TextManager->Draw(buf);
+
 	VideoManager->PopState();
 } // void TextureController::DEBUG_ShowTexSheet()
 
@@ -311,6 +406,8 @@ void TextureController::_BindTexture(GLuint tex_id) {
 
 
 void TextureController::_DeleteTexture(GLuint tex_id) {
+	// The texture may still be referenced by sprites waiting to be drawn
+	VideoManager->_sprite_batch.Flush();
 	glDeleteTextures(1, &tex_id);
 
 	if (_last_tex_id == tex_id)
@@ -346,7 +443,7 @@ bool TextureController::_SaveTempTextures() {
 
 
 
-TexSheet* TextureController::_CreateTexSheet(int32 width, int32 height, TexSheetType type, bool is_static) {
+TexSheet* TextureController::_CreateTexSheet(int32 width, int32 height, TexSheetType type, bool is_static, bool shared) {
 	// Validate that the function arguments are appropriate values
 	if (!IsPowerOfTwo(width) || !IsPowerOfTwo(height)) {
 		IF_PRINT_WARNING(VIDEO_DEBUG) << "non power-of-two width and/or height argument" << endl;
@@ -375,7 +472,9 @@ TexSheet* TextureController::_CreateTexSheet(int32 width, int32 height, TexSheet
 	else
 		sheet = new VariableTexSheet(width, height, tex_id, type, is_static);
 
+	sheet->shared = shared;
 	_tex_sheets.push_back(sheet);
+	_UpdateTexSheetIndex(sheet);
 	return sheet;
 }
 
@@ -394,8 +493,14 @@ void TextureController::_RemoveSheet(TexSheet* sheet) {
 
 	vector<TexSheet*>::iterator i = _tex_sheets.begin();
 
+	for (uint32 j = 0; j < _atlas_sheets.size(); j++) {
+		if (_atlas_sheets[j] == sheet)
+			_atlas_sheets[j] = nullptr;
+	}
+
 	while(i != _tex_sheets.end()) {
 		if (*i == sheet) {
+			_RemoveTexSheetFromIndex(sheet);
 			delete sheet;
 			_tex_sheets.erase(i);
 			return;
@@ -409,11 +514,11 @@ void TextureController::_RemoveSheet(TexSheet* sheet) {
 
 
 TexSheet* TextureController::_InsertImageInTexSheet(BaseTexture *image, ImageMemory& load_info, bool is_static) {
-	// Image sizes larger than 512 in either dimension require their own texture sheet
-	if (load_info.width > 512 || load_info.height > 512) {
+	// Images larger than the shared texture sheet size in either dimension require their own texture sheet
+	if (load_info.width > _tex_sheet_size || load_info.height > _tex_sheet_size) {
 		int32 round_width = RoundUpPow2(load_info.width);
 		int32 round_height = RoundUpPow2(load_info.height);
-		TexSheet* sheet = _CreateTexSheet(round_width, round_height, VIDEO_TEXSHEET_ANY, false);
+		TexSheet* sheet = _CreateTexSheet(round_width, round_height, VIDEO_TEXSHEET_ANY, false, false);
 
 		// Ran out of memory!
 		if (sheet == nullptr) {
@@ -441,24 +546,24 @@ TexSheet* TextureController::_InsertImageInTexSheet(BaseTexture *image, ImageMem
 	else
 		type = VIDEO_TEXSHEET_ANY;
 
-	// Look through all existing texture sheets and see if the image will fit in any of the ones which
-	// match the type and static status that we are looking for
-	for (uint32 i = 0; i < _tex_sheets.size(); i++) {
-		TexSheet* sheet = _tex_sheets[i];
-		if (sheet == nullptr) {
-			IF_PRINT_WARNING(VIDEO_DEBUG) << "found a nullptr texture sheet in the _tex_sheets container" << endl;
-			continue;
-		}
+	// Try only the sheets of the matching type and static status that have enough available area for the image, beginning
+	// with the sheet that has the least area available. The candidates are copied out first because inserting a texture
+	// into a sheet changes its position in the index.
+	const multimap<uint32, TexSheet*>& index = _tex_sheet_index[_TexSheetIndexKey(type, is_static)];
+	uint32 image_area = static_cast<uint32>(load_info.width * load_info.height);
+	vector<TexSheet*> candidates;
+	for (multimap<uint32, TexSheet*>::const_iterator i = index.lower_bound(image_area); i != index.end(); i++) {
+		candidates.push_back(i->second);
+	}
 
-		if (sheet->type == type && sheet->is_static == is_static) {
-			if (sheet->AddTexture(image, load_info) == true) {
-				return sheet;
-			}
+	for (uint32 i = 0; i < candidates.size(); i++) {
+		if (candidates[i]->AddTexture(image, load_info) == true) {
+			return candidates[i];
 		}
 	}
 
 	// We couldn't add it to any existing sheets, so we must create a new one for it
-	TexSheet *sheet = _CreateTexSheet(512, 512, type, is_static);
+	TexSheet *sheet = _CreateTexSheet(_tex_sheet_size, _tex_sheet_size, type, is_static);
 	if (sheet == nullptr) {
 		IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to create a new texture sheet for image" << endl;
 		return nullptr;
@@ -476,7 +581,46 @@ TexSheet* TextureController::_InsertImageInTexSheet(BaseTexture *image, ImageMem
 
 
 
+void TextureController::_UpdateTexSheetIndex(TexSheet* sheet) {
+	if (sheet->shared == false)
+		return;
+
+	int32 available_area = static_cast<int32>(sheet->GetAvailableArea());
+	if (available_area == sheet->_indexed_area)
+		return;
+
+	_RemoveTexSheetFromIndex(sheet);
+	_tex_sheet_index[_TexSheetIndexKey(sheet->type, sheet->is_static)].insert(make_pair(static_cast<uint32>(available_area), sheet));
+	sheet->_indexed_area = available_area;
+}
+
+
+
+void TextureController::_RemoveTexSheetFromIndex(TexSheet* sheet) {
+	if (sheet->_indexed_area < 0)
+		return;
+
+	multimap<uint32, TexSheet*>& index = _tex_sheet_index[_TexSheetIndexKey(sheet->type, sheet->is_static)];
+	pair<multimap<uint32, TexSheet*>::iterator, multimap<uint32, TexSheet*>::iterator> range = index.equal_range(static_cast<uint32>(sheet->_indexed_area));
+	for (multimap<uint32, TexSheet*>::iterator i = range.first; i != range.second; i++) {
+		if (i->second == sheet) {
+			index.erase(i);
+			break;
+		}
+	}
+
+	sheet->_indexed_area = -1;
+}
+
+
+
 bool TextureController::_ReloadImagesToSheet(TexSheet* sheet) {
+	// Atlas pages hold nothing but atlas images, so the whole page can be restored from its image in one upload
+	for (uint32 i = 0; i < _atlas_sheets.size(); i++) {
+		if (_atlas_sheets[i] == sheet)
+			return _UploadAtlasPage(i, sheet);
+	}
+
 	// Delete images
 	std::map<string, pair<ImageMemory, ImageMemory> > multi_image_info;
 
@@ -605,6 +749,92 @@ bool TextureController::_ReloadImagesToSheet(TexSheet* sheet) {
 
 
 
+bool TextureController::_LoadImagesFromAtlas(const string& filename, uint32 rows, uint32 cols, const vector<string>& tags) {
+	const TextureAtlasSource* source = _atlas.FindSource(filename, rows, cols);
+	if (source == nullptr)
+		return false;
+
+	if (source->IsCurrent() == false) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "image has changed since the texture atlas was built and will be loaded from its file: " << filename << endl;
+		return false;
+	}
+
+	if (tags.size() != rows * cols) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "number of tags did not match the number of image elements for: " << filename << endl;
+		return false;
+	}
+
+	const vector<TextureAtlasEntry>& entries = _atlas.GetEntries();
+	for (uint32 i = 0; i < tags.size(); i++) {
+		if (_IsImageTextureRegistered(filename + tags[i]) == true)
+			continue;
+
+		const TextureAtlasEntry& entry = entries[source->first_entry + i];
+		VariableTexSheet* sheet = dynamic_cast<VariableTexSheet*>(_GetAtlasSheet(entry.page));
+		if (sheet == nullptr)
+			return false;
+
+		ImageTexture* img = new ImageTexture(filename, tags[i], source->element_width, source->element_height);
+		if (sheet->InsertTextureAt(img, entry.x, entry.y) == false) {
+			IF_PRINT_WARNING(VIDEO_DEBUG) << "texture atlas entry could not be placed in its page for: " << filename << tags[i] << endl;
+			delete img;
+			return false;
+		}
+	}
+
+	return true;
+} // bool TextureController::_LoadImagesFromAtlas(...)
+
+
+
+TexSheet* TextureController::_GetAtlasSheet(uint32 page) {
+	if (page >= _atlas_sheets.size()) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "invalid atlas page index: " << page << endl;
+		return nullptr;
+	}
+
+	if (_atlas_sheets[page] != nullptr)
+		return _atlas_sheets[page];
+
+	// Atlas pages are unshared so that no other images are ever placed in them, and static since the tilesets and sprites
+	// that they hold are long lived
+	const TextureAtlasPage& atlas_page = _atlas.GetPages()[page];
+	TexSheet* sheet = _CreateTexSheet(atlas_page.width, atlas_page.height, VIDEO_TEXSHEET_ANY, true, false);
+	if (sheet == nullptr) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to create a texture sheet for atlas page: " << atlas_page.filename << endl;
+		return nullptr;
+	}
+
+	if (_UploadAtlasPage(page, sheet) == false) {
+		_RemoveSheet(sheet);
+		return nullptr;
+	}
+
+	_atlas_sheets[page] = sheet;
+	return sheet;
+}
+
+
+
+bool TextureController::_UploadAtlasPage(uint32 page, TexSheet* sheet) {
+	const TextureAtlasPage& atlas_page = _atlas.GetPages()[page];
+	ImageMemory page_image;
+	if (page_image.LoadImage(atlas_page.filename) == false) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to load texture atlas page: " << atlas_page.filename << endl;
+		return false;
+	}
+
+	bool success = sheet->CopyRect(0, 0, page_image);
+	if (success == false)
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "call to TexSheet::CopyRect() failed for atlas page: " << atlas_page.filename << endl;
+
+	free(page_image.pixels);
+	page_image.pixels = nullptr;
+	return success;
+}
+
+
+
 void TextureController::_RegisterImageTexture(ImageTexture* img) {
 	if (img == nullptr) {
 		IF_PRINT_WARNING(VIDEO_DEBUG) << "nullptr argument passed to function" << endl;
@@ -667,6 +897,87 @@ void TextureController::_UnregisterTextTexture(TextTexture* tex) {
 		return;
 	}
 	_text_images.erase(tex_iter);
+
+	map<string, list<TextTexture*>::iterator>::iterator cache_iter = _text_texture_cache.find(_MakeTextTextureKey(tex->string, tex->style));
+	if (cache_iter != _text_texture_cache.end() && *(cache_iter->second) == tex) {
+		_text_texture_lru.erase(cache_iter->second);
+		_text_texture_cache.erase(cache_iter);
+	}
+}
+
+
+
+TextTexture* TextureController::_GetTextTexture(const ustring& text, const TextStyle& style) {
+	string key = _MakeTextTextureKey(text, style);
+	map<string, list<TextTexture*>::iterator>::iterator cache_iter = _text_texture_cache.find(key);
+	if (cache_iter != _text_texture_cache.end()) {
+		_text_texture_hits++;
+		_text_texture_lru.splice(_text_texture_lru.begin(), _text_texture_lru, cache_iter->second);
+		return *(cache_iter->second);
+	}
+
+	_text_texture_misses++;
+	TextTexture* texture = new TextTexture(text, style);
+	_RegisterTextTexture(texture);
+	if (texture->Regenerate() == false) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "call to TextTexture::Regenerate() failed" << endl;
+		return texture;
+	}
+
+	texture->AddReference();
+	_text_texture_lru.push_front(texture);
+	_text_texture_cache[key] = _text_texture_lru.begin();
+	_EvictTextTextures();
+	return texture;
+} // TextTexture* TextureController::_GetTextTexture(const ustring& text, const TextStyle& style)
+
+
+
+string TextureController::_MakeTextTextureKey(const ustring& text, const TextStyle& style) const {
+	// The key is made up of the font name followed by the raw bytes of the rest of the style and of the text
+	string key = style.font;
+	key.push_back('\0');
+
+	float color[4] = { style.color[0], style.color[1], style.color[2], style.color[3] };
+	int32 shadow[3] = { style.shadow_style, style.shadow_offset_x, style.shadow_offset_y };
+	key.append(reinterpret_cast<const char*>(color), sizeof(color));
+	key.append(reinterpret_cast<const char*>(shadow), sizeof(shadow));
+	key.append(reinterpret_cast<const char*>(text.c_str()), text.length() * sizeof(uint16));
+	return key;
+}
+
+
+
+void TextureController::_EvictTextTextures() {
+	// The most recently requested texture at the front of the list is never considered, since it has just been
+	// created and the image that requested it has not yet added its reference
+	list<TextTexture*>::iterator i = _text_texture_lru.end();
+	while (_text_texture_lru.size() > TEXT_TEXTURE_CACHE_SIZE && i != _text_texture_lru.begin()) {
+		--i;
+		if ((*i)->ref_count > 1)
+			continue;
+
+		// Deleting the texture removes it from the list, so continue from the texture after it
+		list<TextTexture*>::iterator next = i;
+		++next;
+		_DeleteTextTexture(*i);
+		i = next;
+	}
+}
+
+
+
+void TextureController::_DeleteTextTexture(TextTexture* tex) {
+	tex->RemoveReference();
+
+	if (tex->texture_sheet != nullptr) {
+		tex->texture_sheet->RemoveTexture(tex);
+		if (tex->texture_sheet->shared == false && tex->texture_sheet->GetNumberTextures() == 0)
+			_RemoveSheet(tex->texture_sheet);
+	}
+
+	// The destructor of the texture removes it from the registry and the cache
+	delete tex;
 }
 
 
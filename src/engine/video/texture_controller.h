@@ -32,6 +32,8 @@
 #include "utils.h"
 
 #include "texture.h"
+#include "texture_atlas.h"
+#include "image_cache.h"
 #include "image_base.h"
 
 namespace hoa_video {
@@ -39,6 +41,9 @@ namespace hoa_video {
 //! \brief The singleton pointer for the instance of the texture controller
 extern TextureController* TextureManager;
 
+//! \brief The number of rendered text textures that may be cached before unreferenced ones begin to be deleted
+const uint32 TEXT_TEXTURE_CACHE_SIZE = 256;
+
 class TextureController : public hoa_utils::Singleton<TextureController> {
 	friend class hoa_utils::Singleton<TextureController>;
 	friend class VideoEngine;
@@ -49,10 +54,13 @@ class TextureController : public hoa_utils::Singleton<TextureController> {
 	friend class private_video::TextTexture;
 	friend class TextSupervisor;
 	friend class TextImage;
+	friend class QuadBuffer;
 	friend class private_video::TexSheet;
 	friend class private_video::FixedTexSheet;
 	friend class private_video::VariableTexSheet;
 	friend class private_video::ParticleSystem;
+	friend class private_video::SpriteBatch;
+	friend class private_video::LightCompositor;
 
 public:
 	TextureController();
@@ -76,6 +84,30 @@ public:
 	**/
 	bool ReloadTextures();
 
+	//! \brief Returns the width and height, in pixels, of the texture sheets that are shared between multiple images
+	int32 GetTexSheetSize() const
+		{ return _tex_sheet_size; }
+
+	/** \brief Retrieves the occupancy and fragmentation information of every texture sheet
+	*** \param statistics A reference to the vector to store the statistics in, in the same order that the sheets are shown in debug mode
+	**/
+	void GetTexSheetStatistics(std::vector<private_video::TexSheetStatistics>& statistics) const;
+
+	/** \brief Returns true if a multi image can be loaded from the texture atlas
+	*** \param filename The filename of the multi image
+	*** \param rows The number of rows of elements that the multi image is divided into
+	*** \param cols The number of columns of elements that the multi image is divided into
+	*** \return False if the image is not in the atlas or the image file has changed since the atlas was built
+	**/
+	bool IsImageInAtlas(const std::string& filename, uint32 rows, uint32 cols) const;
+
+	/** \brief Retrieves the usage statistics of the cache of rendered text textures
+	*** \param hit_count Set to the number of lines of text whose texture was found in the cache
+	*** \param miss_count Set to the number of lines of text that had to be rendered
+	*** \param texture_count Set to the number of textures currently held by the cache
+	**/
+	void GetTextTextureStatistics(uint32& hit_count, uint32& miss_count, uint32& texture_count) const;
+
 	//! \brief Cycles forward to show the next texture sheet
 	void DEBUG_NextTexSheet();
 
@@ -100,12 +132,47 @@ private:
 	//! \brief A vector containing all of the texture sheets currently being managed by this class
 	std::vector<private_video::TexSheet*> _tex_sheets;
 
+	//! \brief The width and height of shared texture sheets. Images larger than this in either dimension are given their own sheet.
+	int32 _tex_sheet_size;
+
+	/** \brief An index of all shared texture sheets, ordered by the area available in each sheet
+	*** There is one index for each combination of texture sheet type and static status, at the position returned by
+	*** _TexSheetIndexKey(). Each index maps the available area of a sheet (TexSheet::GetAvailableArea()) to the sheet.
+	*** This allows an image to be inserted by trying only those sheets that have room for it, starting with the fullest.
+	**/
+	std::vector<std::multimap<uint32, private_video::TexSheet*> > _tex_sheet_index;
+
 	//! \brief A STL map containing all of the images currently being managed by this class
 	std::map<std::string, private_video::ImageTexture*> _images;
 
+	//! \brief Holds the pixel data of previously decoded images so that ImageMemory does not need to decode them again
+	private_video::ImageCache _image_cache;
+
+	//! \brief The index of the prebuilt texture atlas. Empty if no atlas was found when the controller was initialized.
+	private_video::TextureAtlasIndex _atlas;
+
+	/** \brief The texture sheet that holds each page of the texture atlas, with the same size and order as the atlas pages
+	*** A page is only loaded once one of its images is needed, and is deleted when its last image is removed. Pages that
+	*** are not loaded are nullptr.
+	**/
+	std::vector<private_video::TexSheet*> _atlas_sheets;
+
 	//! \brief A STL set containing all of the text images currently being managed by this class
 	std::set<private_video::TextTexture*> _text_images;
 
+	/** \brief The cached text textures, ordered from the most to the least recently requested
+	*** The cache holds a reference to each of these textures, so that a texture remains available for reuse after
+	*** every image that displayed it has been destroyed. Once the cache holds more than TEXT_TEXTURE_CACHE_SIZE textures,
+	*** the least recently requested textures that are no longer referenced by any image are deleted.
+	**/
+	std::list<private_video::TextTexture*> _text_texture_lru;
+
+	//! \brief Used to find a cached text texture by the key returned from _MakeTextTextureKey()
+	std::map<std::string, std::list<private_video::TextTexture*>::iterator> _text_texture_cache;
+
+	//! \brief The number of lines of text that were and were not found in the text texture cache
+	uint32 _text_texture_hits, _text_texture_misses;
+
 	//! \brief Keeps track of the number of texture switches per frame
 	uint32 _debug_num_tex_switches;
 
@@ -154,9 +221,10 @@ private:
 	*** \param height The height of the sheet, in pixels
 	*** \param type Specifies what type of images this texture sheet manages (e.g. 32x32 images, 64x64 images, variable size, etc)
 	*** \param is_static If true, this texture sheet is meant to manage images which are not expected to be loaded and unloaded very often
+	*** \param shared If false, the sheet is created for a single image and no other images will be inserted into it
 	*** \return A pointer to the newly created TexSheet, or nullptr if a new should could not be created
 	**/
-	private_video::TexSheet* _CreateTexSheet(int32 width, int32 height, private_video::TexSheetType type, bool is_static);
+	private_video::TexSheet* _CreateTexSheet(int32 width, int32 height, private_video::TexSheetType type, bool is_static, bool shared = true);
 
 	/** \brief Removes references to a texture sheet and deletes it from memory
 	*** \param sheet A pointer to the sheet we wish to remove
@@ -170,11 +238,24 @@ private:
 	*** \return A new texsheet with the image contained within it, or nullptr if an error occured and the image could not be added to any sheet
 	***
 	*** A new texture sheet will be created by this function in one of two cases. First, if there was no room for the image in any existing
-	*** compatible texture sheets. Second, if the image is very large (either height or width of the image exceeds 512 pixels), it will
-	*** merit having its own un-shared texture sheet.
+	*** compatible texture sheets. Second, if the image is very large (either height or width of the image exceeds the shared texture sheet
+	*** size), it will merit having its own un-shared texture sheet.
 	**/
 	private_video::TexSheet* _InsertImageInTexSheet(private_video::BaseTexture* image, private_video::ImageMemory& load_info, bool is_static);
 
+	/** \brief Updates the position of a texture sheet in the index after the space available in it has changed
+	*** \param sheet A pointer to the sheet to update
+	*** Texture sheets call this function whenever a texture is inserted, removed, freed, or restored. Unshared sheets are never indexed.
+	**/
+	void _UpdateTexSheetIndex(private_video::TexSheet* sheet);
+
+	//! \brief Removes a texture sheet from the index
+	void _RemoveTexSheetFromIndex(private_video::TexSheet* sheet);
+
+	//! \brief Returns the position in _tex_sheet_index of the index for a type and static status of texture sheet
+	uint32 _TexSheetIndexKey(private_video::TexSheetType type, bool is_static) const
+		{ return static_cast<uint32>(type) * 2 + (is_static ? 1 : 0); }
+
 	/** \brief Iterate through all currently loaded images and if they belong to the specified TexSheet, reload them into it
 	*** \param sheet A pointer to the TexSheet whose images we wish to reload
 	*** \return True only if every single image owned by the TexSheet was successfully reloaded back into it
@@ -182,6 +263,34 @@ private:
 	bool _ReloadImagesToSheet(private_video::TexSheet* sheet);
 	//@}
 
+	//! \name Texture Atlas Operations
+	//@{
+	/** \brief Creates the image textures of every element of a multi image from the texture atlas
+	*** \param filename The filename of the multi image
+	*** \param rows The number of rows of elements that the multi image is divided into
+	*** \param cols The number of columns of elements that the multi image is divided into
+	*** \param tags The tags of each element, in row-major order
+	*** \return True if every element is now registered, or false if the multi image must be loaded from its file
+	***
+	*** Elements that are already registered are left untouched. The atlas page holding the elements is uploaded to
+	*** texture memory if it is not already loaded, after which the elements are registered without copying any pixels.
+	**/
+	bool _LoadImagesFromAtlas(const std::string& filename, uint32 rows, uint32 cols, const std::vector<std::string>& tags);
+
+	/** \brief Retrieves the texture sheet that holds a page of the texture atlas, loading the page if needed
+	*** \param page The index of the atlas page
+	*** \return A pointer to the sheet, or nullptr if the page could not be loaded
+	**/
+	private_video::TexSheet* _GetAtlasSheet(uint32 page);
+
+	/** \brief Copies the image of an atlas page into its texture sheet with a single upload
+	*** \param page The index of the atlas page
+	*** \param sheet The sheet to copy the page into, which must be at least as large as the page
+	*** \return False if the page image could not be loaded
+	**/
+	bool _UploadAtlasPage(uint32 page, private_video::TexSheet* sheet);
+	//@}
+
 	//! \name Image Texture Operations
 	//@{
 	/** \brief Adds an image texture to the map registery
@@ -226,6 +335,27 @@ private:
 	**/
 	bool _IsTextTextureRegistered(private_video::TextTexture* tex) const
 		{ return (_text_images.find(tex) != _text_images.end()); }
+
+	/** \brief Retrieves the texture of a rendered line of text, rendering the text only if an identical texture is not cached
+	*** \param text The line of text, which should not contain any newline characters
+	*** \param style The style to render the text in
+	*** \return A pointer to the registered texture. The caller must add its own reference to the texture.
+	***
+	*** Lines of text with the same characters and style share a single texture. If the text can not be rendered, the
+	*** texture is still returned but is not cached.
+	**/
+	private_video::TextTexture* _GetTextTexture(const hoa_utils::ustring& text, const TextStyle& style);
+
+	//! \brief Returns the key that identifies a line of text with a certain style in the text texture cache
+	std::string _MakeTextTextureKey(const hoa_utils::ustring& text, const TextStyle& style) const;
+
+	//! \brief Deletes the least recently requested unreferenced text textures until the cache is within its size limit
+	void _EvictTextTextures();
+
+	/** \brief Releases the reference that the cache holds to a text texture and deletes the texture
+	*** \param tex A pointer to the text texture to delete, which no image may refer to
+	**/
+	void _DeleteTextTexture(private_video::TextTexture* tex);
 	//@}
 }; // class TextureController : public hoa_utils::Singleton<TextureController>
 
@@ -15,6 +15,7 @@
 
 #include "video.h"
 #include "audio.h"
+#include "profiler.h"
 #include "script.h"
 #include "system.h"
 
@@ -85,7 +86,10 @@ VideoEngine::VideoEngine() :
 	_temp_height = 0;
 	_temp_fullscreen = false;
 	_smooth_textures = true;
+	_tex_sheet_size = DEFAULT_TEXSHEET_SIZE;
+	_image_cache_size = DEFAULT_IMAGE_CACHE_SIZE;
 	_advanced_display = false;
+	_num_draw_calls = 0;
 	_x_shake = 0;
 	_y_shake = 0;
 	_gamma_value = 1.0f;
@@ -130,6 +134,7 @@ VideoEngine::VideoEngine() :
 
 
 VideoEngine::~VideoEngine() {
+	_screenshot_writer.Finish();
 	_particle_manager.Destroy();
 	TextManager->SingletonDestroy();
 
@@ -139,8 +144,11 @@ VideoEngine::~VideoEngine() {
 	_rectangle_image.Clear();
 	_light_overlay_image.Clear();
 	_ambient_overlay_image.Clear();
+	_screen_captures.clear();
+	_light_compositor.Release();
 
 	TextureManager->SingletonDestroy();
+	_headless_context.Destroy();
 }
 
 
@@ -213,6 +221,10 @@ bool VideoEngine::SingletonInitialize() {
     // initialize window pointer
 	window = nullptr;
 
+	// SDL is still used for input and timing by the headless target, which may run without any display at all
+	if (_target == VIDEO_TARGET_HEADLESS)
+		SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+
 	if (SDL_InitSubSystem(SDL_INIT_VIDEO) < 0) {
 		PRINT_ERROR << "SDL video initialization failed" << endl;
 		return false;
@@ -349,7 +361,6 @@ void VideoEngine::SetDrawFlags(int32 first_flag, ...) {
 
 
 void VideoEngine::Clear() {
-	//! \todo glClearColor is a state change operation. It should only be called when the clear color changes
 	Clear(Color::black);
 }
 
@@ -357,10 +368,12 @@ void VideoEngine::Clear() {
 
 void VideoEngine::Clear(const Color &c) {
 	SetViewport(0.0f, 100.0f, 0.0f, 100.0f);
-	glClearColor(c[0], c[1], c[2], c[3]);
+	_render_state.SetClearColor(c);
 	glClear(GL_COLOR_BUFFER_BIT);
 
 	TextureManager->_debug_num_tex_switches = 0;
+	_render_state.ResetCounters();
+	_num_draw_calls = 0;
 
 	if (CheckGLError() == true) {
 		IF_PRINT_WARNING(VIDEO_DEBUG) << "an OpenGL error occured: " << CreateGLErrorString() << endl;
@@ -379,6 +392,12 @@ void VideoEngine::Display(uint32 frame_time) {
 	// Update all particle effects
 	_particle_manager.Update(frame_time);
 
+	// Draw any sprites that remain in the batch so that they are included in the debugging statistics
+	_sprite_batch.Flush();
+
+	// Screenshots are taken now, when the scene is complete and before any debugging information is drawn over it
+	_screenshot_writer.Update();
+
 	// Update shaking effect
 	PushState();
 	SetStandardCoordSys();
@@ -390,6 +409,10 @@ void VideoEngine::Display(uint32 frame_time) {
 	if (_advanced_display)
 		_DEBUG_ShowAdvancedStats();
 
+	// The profiler does not exist in programs other than the game, such as the editor
+	if (ProfileManager != nullptr && ProfileManager->IsOverlayEnabled() == true)
+		ProfileManager->DrawOverlay();
+
 	if (TextureManager->debug_current_sheet >= 0)
 		TextureManager->DEBUG_ShowTexSheet();
 
@@ -397,7 +420,11 @@ void VideoEngine::Display(uint32 frame_time) {
 
 	PopState();
 
-	SDL_GL_SwapWindow(window);
+	_sprite_batch.Flush();
+	if (_target == VIDEO_TARGET_HEADLESS)
+		_headless_context.Present();
+	else
+		SDL_GL_SwapWindow(window);
 
 } // void VideoEngine::Display(uint32 frame_time)
 
@@ -412,6 +439,22 @@ const std::string VideoEngine::CreateGLErrorString() {
 		return (char*)error_string;
 }
 
+
+
+void* VideoEngine::GetGLFunction(const char* name) {
+	if (_target == VIDEO_TARGET_HEADLESS)
+		return _headless_context.GetFunction(name);
+	return SDL_GL_GetProcAddress(name);
+}
+
+
+
+bool VideoEngine::IsGLExtensionSupported(const char* name) {
+	if (_target == VIDEO_TARGET_HEADLESS)
+		return _headless_context.IsExtensionSupported(name);
+	return (SDL_GL_ExtensionSupported(name) == SDL_TRUE);
+}
+
 //-----------------------------------------------------------------------------
 // VideoEngine class - Screen size and resolution methods
 //-----------------------------------------------------------------------------
@@ -425,10 +468,15 @@ void VideoEngine::GetPixelSize(float& x, float& y) {
 
 bool VideoEngine::ApplySettings() {
 	if (_target == VIDEO_TARGET_SDL_WINDOW) {
-		// Losing GL context, so unload images first
+		// Losing GL context, so draw any pending sprites and unload images first
+		_sprite_batch.Flush();
 		if (TextureManager && TextureManager->UnloadTextures() == false) {
 			IF_PRINT_WARNING(VIDEO_DEBUG) << "failed to delete OpenGL textures during a context change" << endl;
 		}
+		_particle_manager.UnloadShader();
+		_screenshot_writer.ReleaseBuffers();
+		_capture_framebuffer.Release();
+		_light_compositor.Release();
 
 		Uint32 flags = SDL_WINDOW_OPENGL;
 
@@ -481,24 +529,14 @@ bool VideoEngine::ApplySettings() {
 				if (TextureManager && _screen_width > 0) { // Test to see if we already had a valid video mode
 					TextureManager->ReloadTextures();
 				}
+				_particle_manager.ReloadShader();
 				return false;
 			}
 		}
 
 		// Only now that SDL_SetVideoMode(...) has been called can we make OpenGL calls
 		glcontext = SDL_GL_CreateContext(window);
-		glDisable(GL_BLEND);
-		glDisable(GL_TEXTURE_2D);
-		glDisable(GL_ALPHA_TEST);
-		glDisable(GL_STENCIL_TEST);
-		_current_context.scissoring_enabled = false;
-		glDisable(GL_SCISSOR_TEST);
-		glDisableClientState(GL_VERTEX_ARRAY);
-		glDisableClientState(GL_COLOR_ARRAY);
-		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-
-		// Turn off writing to the depth buffer
-		glDepthMask(GL_FALSE);
+		_InitializeGLState();
 
 		_screen_width = _temp_width;
 		_screen_height = _temp_height;
@@ -506,6 +544,7 @@ bool VideoEngine::ApplySettings() {
 
 		if (TextureManager)
 			TextureManager->ReloadTextures();
+		_particle_manager.ReloadShader();
 
 		return true;
 	} // if (_target == VIDEO_TARGET_SDL_WINDOW)
@@ -519,6 +558,30 @@ bool VideoEngine::ApplySettings() {
 		return true;
 	}
 
+	// The headless context is kept when the resolution changes, so unlike a window its textures remain valid
+	else if (_target == VIDEO_TARGET_HEADLESS) {
+		_sprite_batch.Flush();
+		bool new_context = (_headless_context.IsCreated() == false);
+
+		if (_headless_context.Create(_temp_width, _temp_height) == false) {
+			_temp_fullscreen = _fullscreen;
+			_temp_width = _screen_width;
+			_temp_height = _screen_height;
+			return false;
+		}
+
+		if (new_context == true) {
+			_InitializeGLState();
+			_particle_manager.ReloadShader();
+		}
+
+		_screen_width = _temp_width;
+		_screen_height = _temp_height;
+		_fullscreen = _temp_fullscreen;
+
+		return true;
+	}
+
 	return false;
 } // bool VideoEngine::ApplySettings()
 
@@ -550,6 +613,7 @@ void VideoEngine::SetViewport(float left, float right, float bottom, float top)
 	if (t > _screen_height)
 		t = _screen_height;
 
+	_sprite_batch.Flush();
 	_current_context.viewport = ScreenRect(l, b, r - l, t - b);
 	glViewport(l, b, r - l, t - b);
 }
@@ -557,6 +621,8 @@ void VideoEngine::SetViewport(float left, float right, float bottom, float top)
 
 
 void VideoEngine::SetCoordSys(const CoordSys& coordinate_system) {
+	// Pending sprites must be drawn with the projection they were added under
+	_sprite_batch.Flush();
 	_current_context.coordinate_system = coordinate_system;
 
 	glMatrixMode(GL_PROJECTION);
@@ -569,25 +635,30 @@ void VideoEngine::SetCoordSys(const CoordSys& coordinate_system) {
 	// This small translation is supposed to help with pixel-perfect 2D rendering in OpenGL.
 	// Reference: http://www.opengl.org/resources/faq/technical/transformations.htm#tran0030
 	glTranslatef(0.375, 0.375, 0);
+	_transform.LoadIdentity();
+	_transform.Translate(0.375f, 0.375f);
 }
 
 
 
 void VideoEngine::EnableScissoring() {
+	_sprite_batch.Flush();
 	_current_context.scissoring_enabled = true;
-	glEnable(GL_SCISSOR_TEST);
+	_render_state.Enable(GL_SCISSOR_TEST);
 }
 
 
 
 void VideoEngine::DisableScissoring() {
+	_sprite_batch.Flush();
 	_current_context.scissoring_enabled = false;
-	glDisable(GL_SCISSOR_TEST);
+	_render_state.Disable(GL_SCISSOR_TEST);
 }
 
 
 
 void VideoEngine::SetScissorRect(float left, float right, float bottom, float top) {
+	_sprite_batch.Flush();
 	_current_context.scissor_rectangle = CalculateScreenRect(left, right, bottom, top);
 
 	glScissor(static_cast<GLint>((_current_context.scissor_rectangle.left / static_cast<float>(VIDEO_STANDARD_RESOLUTION_WIDTH)) * _current_context.viewport.width),
@@ -600,6 +671,7 @@ void VideoEngine::SetScissorRect(float left, float right, float bottom, float to
 
 
 void VideoEngine::SetScissorRect(const ScreenRect& rect) {
+	_sprite_batch.Flush();
 	_current_context.scissor_rectangle = rect;
 
 	glScissor(static_cast<GLint>((_current_context.scissor_rectangle.left / static_cast<float>(VIDEO_STANDARD_RESOLUTION_WIDTH)) * _current_context.viewport.width),
@@ -647,6 +719,8 @@ ScreenRect VideoEngine::CalculateScreenRect(float left, float right, float botto
 void VideoEngine::Move(float x, float y) {
 	glLoadIdentity();
 	glTranslatef(x, y, 0);
+	_transform.LoadIdentity();
+	_transform.Translate(x, y);
 	_x_cursor = x;
 	_y_cursor = y;
 }
@@ -655,17 +729,37 @@ void VideoEngine::Move(float x, float y) {
 
 void VideoEngine::MoveRelative(float x, float y) {
 	glTranslatef(x, y, 0);
+	_transform.Translate(x, y);
 	_x_cursor += x;
 	_y_cursor += y;
 }
 
 
 
+void VideoEngine::PushMatrix() {
+	glPushMatrix();
+	_transform_stack.push_back(_transform);
+}
+
+
+
+void VideoEngine::PopMatrix() {
+	glPopMatrix();
+	if (_transform_stack.empty()) {
+		IF_PRINT_WARNING(VIDEO_DEBUG) << "no modelview transformations were saved on the stack" << endl;
+		return;
+	}
+
+	_transform = _transform_stack.back();
+	_transform_stack.pop_back();
+}
+
 
 void VideoEngine::PushState() {
 	// Push current modelview transformation
 	glMatrixMode(GL_MODELVIEW);
 	glPushMatrix();
+	_transform_stack.push_back(_transform);
 
 	_context_stack.push(_current_context);
 }
@@ -691,10 +785,14 @@ void VideoEngine::PopState() {
 	// Restore the modelview transformation
 	glMatrixMode(GL_MODELVIEW);
 	glPopMatrix();
+	if (_transform_stack.empty() == false) {
+		_transform = _transform_stack.back();
+		_transform_stack.pop_back();
+	}
 	glViewport(_current_context.viewport.left, _current_context.viewport.top, _current_context.viewport.width, _current_context.viewport.height);
 
 	if (_current_context.scissoring_enabled) {
-		glEnable(GL_SCISSOR_TEST);
+		_render_state.Enable(GL_SCISSOR_TEST);
 		glScissor(static_cast<GLint>((_current_context.scissor_rectangle.left / static_cast<float>(VIDEO_STANDARD_RESOLUTION_WIDTH)) * _current_context.viewport.width),
 			static_cast<GLint>((_current_context.scissor_rectangle.top / static_cast<float>(VIDEO_STANDARD_RESOLUTION_HEIGHT)) * _current_context.viewport.height),
 			static_cast<GLsizei>((_current_context.scissor_rectangle.width / static_cast<float>(VIDEO_STANDARD_RESOLUTION_WIDTH)) * _current_context.viewport.width),
@@ -702,16 +800,17 @@ void VideoEngine::PopState() {
 		);
 	}
 	else {
-		glDisable(GL_SCISSOR_TEST);
+		_render_state.Disable(GL_SCISSOR_TEST);
 	}
 }
 
 
 
-void VideoEngine::SetTransform(float matrix[16]) {
+void VideoEngine::SetTransform(const float matrix[16]) {
 	glMatrixMode(GL_MODELVIEW);
 	glLoadIdentity();
 	glLoadMatrixf(matrix);
+	_transform.LoadMatrix(matrix);
 }
 
 
@@ -891,11 +990,14 @@ void VideoEngine::DrawOverlays() {
 
 	SetCoordSys(0.0f, 1.0f, 0.0f, 1.0f);
 
-	// Draw the light overlay
+	// Draw the light overlay, with the lights of this frame removed from it
 	if (_light_overlay_enabled == true) {
-		Move(0.0f, 0.0f);
-		_light_overlay_image.Draw();
+		if (_light_compositor.IsEmpty() == true || _light_compositor.Composite(_light_overlay_color) == false) {
+			Move(0.0f, 0.0f);
+			_light_overlay_image.Draw();
+		}
 	}
+	_light_compositor.ClearLights();
 
 	// Draw the lightning overlay
 	if (_lightning_active) {
@@ -912,67 +1014,62 @@ void VideoEngine::DrawOverlays() {
 
 
 
-StillImage VideoEngine::CaptureScreen() throw(Exception) {
-	// Static variable used to make sure the capture has a unique name in the texture image map
-	static uint32 capture_id = 0;
-
-	StillImage screen_image;
-
-	// TEMP: temporary resolution until capture screen bug is fixed
-// 	return screen_image;
-
-	// Retrieve width/height of the viewport. viewport_dimensions[2] is the width, [3] is the height
+StillImage VideoEngine::CaptureScreen(float scale) throw(Exception) {
+	// Retrieve the position and size of the viewport. viewport_dimensions[2] is the width, [3] is the height
 	GLint viewport_dimensions[4];
 	glGetIntegerv(GL_VIEWPORT, viewport_dimensions);
-	screen_image.SetDimensions((float)viewport_dimensions[2], (float)viewport_dimensions[3]);
+	int32 screen_width = viewport_dimensions[2];
+	int32 screen_height = viewport_dimensions[3];
 
 	// Set up the screen rectangle to copy
-	ScreenRect screen_rect(0, viewport_dimensions[3], viewport_dimensions[2], viewport_dimensions[3]);
-
-	// Create a new ImageTexture with a unique filename for this newly captured screen
-	ImageTexture* new_image = new ImageTexture("capture_screen" + NumberToString(capture_id), "<T>", viewport_dimensions[2], viewport_dimensions[3]);
-	new_image->AddReference();
+	ScreenRect screen_rect(viewport_dimensions[0], viewport_dimensions[1] + screen_height, screen_width, screen_height);
+
+	// A capture is only made at a lower resolution when it can be scaled down by the graphics card
+	int32 width = screen_width;
+	int32 height = screen_height;
+	if (scale < 1.0f && _capture_framebuffer.IsAvailable() == true) {
+		width = max(1, static_cast<int32>(screen_width * scale));
+		height = max(1, static_cast<int32>(screen_height * scale));
+	}
+	bool scaled = (width != screen_width || height != screen_height);
 
-	// Create a texture sheet of an appropriate size that can retain the capture
-	TexSheet* temp_sheet = TextureManager->_CreateTexSheet(RoundUpPow2(viewport_dimensions[2]), RoundUpPow2(viewport_dimensions[3]), VIDEO_TEXSHEET_ANY, false);
-	VariableTexSheet* sheet = dynamic_cast<VariableTexSheet*>(temp_sheet);
+	StillImage screen_image = _GetScreenCapture(width, height, screen_width, screen_height);
+	ImageTexture* capture = screen_image._image_texture;
 
-	// Ensure that texture sheet creation succeeded, insert the texture image into the sheet, and copy the screen into the sheet
-	if (sheet == nullptr) {
-		delete new_image;
-		throw Exception("could not create texture sheet to store captured screen", __FILE__, __LINE__, __FUNCTION__);
-		screen_image.Clear();
-		return screen_image;
-	}
-	if (sheet->InsertTexture(new_image) == false) {
-		TextureManager->_RemoveSheet(sheet);
-		delete new_image;
-		throw Exception("could not insert captured screen image into texture sheet", __FILE__, __LINE__, __FUNCTION__);
-		screen_image.Clear();
-		return screen_image;
-	}
-	if (sheet->CopyScreenRect(0, 0, screen_rect) == false) {
-		TextureManager->_RemoveSheet(sheet);
-		delete new_image;
-		throw Exception("call to TexSheet::CopyScreenRect() failed", __FILE__, __LINE__, __FUNCTION__);
-		screen_image.Clear();
-		return screen_image;
+	if (scaled == false) {
+		if (capture->texture_sheet->CopyScreenRect(capture->x, capture->y, screen_rect) == false) {
+			throw Exception("call to TexSheet::CopyScreenRect() failed", __FILE__, __LINE__, __FUNCTION__);
+		}
 	}
+	else {
+		// The screen is copied at its full size first, since a multisampled window can not be scaled by a blit
+		StillImage full_image = _GetScreenCapture(screen_width, screen_height, screen_width, screen_height);
+		ImageTexture* full_capture = full_image._image_texture;
+		if (full_capture->texture_sheet->CopyScreenRect(full_capture->x, full_capture->y, screen_rect) == false) {
+			throw Exception("call to TexSheet::CopyScreenRect() failed", __FILE__, __LINE__, __FUNCTION__);
+		}
 
-	// Store the image element to the saved image (with a flipped y axis)
-	screen_image._image_texture = new_image;
-	screen_image._texture = new_image;
+		// Blits are clipped by the scissor test
+		if (_current_context.scissoring_enabled == true)
+			_render_state.Disable(GL_SCISSOR_TEST);
+		bool success = _capture_framebuffer.Blit(full_capture->texture_sheet->tex_id, full_capture->x, full_capture->y, screen_width, screen_height,
+			capture->texture_sheet->tex_id, capture->x, capture->y, width, height);
+		if (_current_context.scissoring_enabled == true)
+			_render_state.Enable(GL_SCISSOR_TEST);
 
-	// Vertically flip the texture image by swapping the v coordinates, since OpenGL returns the image upside down in the CopyScreenRect call
-	float temp = new_image->v1;
-	new_image->v1 = new_image->v2;
-	new_image->v2 = temp;
+		if (success == false) {
+			throw Exception("failed to scale the captured screen", __FILE__, __LINE__, __FUNCTION__);
+		}
+	}
+
+	// A scaled capture is drawn larger than its texture, which linear filtering blurs
+	capture->texture_sheet->Smooth(scaled);
+	screen_image.SetDimensions(static_cast<float>(screen_width), static_cast<float>(screen_height));
 
 	if (CheckGLError() == true) {
 		IF_PRINT_WARNING(VIDEO_DEBUG) << "an OpenGL error occurred: " << CreateGLErrorString() << endl;
 	}
 
-	capture_id++;
 	return screen_image;
 }
 
@@ -997,45 +1094,60 @@ void VideoEngine::SetGamma(float value) {
 
 
 
-void VideoEngine::MakeScreenshot(const std::string& filename) {
-	private_video::ImageMemory buffer;
+StillImage VideoEngine::_GetScreenCapture(int32 width, int32 height, int32 screen_width, int32 screen_height) throw(Exception) {
+	// Static variable used to make sure the capture has a unique name in the texture image map
+	static uint32 capture_id = 0;
 
-	// Retrieve the width and height of the viewport.
-	GLint viewport_dimensions[4]; // viewport_dimensions[2] is the width, [3] is the height
-	glGetIntegerv(GL_VIEWPORT, viewport_dimensions);
+	for (uint32 i = 0; i < _screen_captures.size(); i++) {
+		ImageTexture* capture = _screen_captures[i]._image_texture;
+		if (capture->ref_count == 1 && capture->width == width && capture->height == height)
+			return _screen_captures[i];
+	}
 
-	// Buffer to store the image before it is flipped
-	buffer.width = viewport_dimensions[2];
-	buffer.height = viewport_dimensions[3];
-	buffer.pixels = malloc(buffer.width * buffer.height * 3);
-	buffer.rgb_format = true;
+	for (vector<StillImage>::iterator i = _screen_captures.begin(); i != _screen_captures.end();) {
+		ImageTexture* capture = i->_image_texture;
+		bool keep = (capture->width == width && capture->height == height) ||
+			(capture->width == screen_width && capture->height == screen_height);
+		if (capture->ref_count == 1 && keep == false)
+			i = _screen_captures.erase(i);
+		else
+			++i;
+	}
 
-	// Read pixel data
-	glReadPixels(0, 0, buffer.width, buffer.height, GL_RGB, GL_UNSIGNED_BYTE, buffer.pixels);
+	// Create a new ImageTexture with a unique filename for this newly captured screen
+	ImageTexture* new_image = new ImageTexture("capture_screen" + NumberToString(capture_id), "<T>", width, height);
+	new_image->AddReference();
 
-	if (CheckGLError() == true) {
-		IF_PRINT_WARNING(VIDEO_DEBUG) << "an OpenGL error occured: " << CreateGLErrorString() << endl;
+	// Create a texture sheet of an appropriate size that can retain the capture
+	TexSheet* temp_sheet = TextureManager->_CreateTexSheet(RoundUpPow2(width), RoundUpPow2(height), VIDEO_TEXSHEET_ANY, false, false);
+	VariableTexSheet* sheet = dynamic_cast<VariableTexSheet*>(temp_sheet);
 
-		free(buffer.pixels);
-		buffer.pixels = nullptr;
-		return;
+	// Ensure that texture sheet creation succeeded and insert the texture image into the sheet
+	if (sheet == nullptr) {
+		delete new_image;
+		throw Exception("could not create texture sheet to store captured screen", __FILE__, __LINE__, __FUNCTION__);
 	}
-
-	// Vertically flip the image, then swap the flipped and original images
-	void* buffer_temp = malloc(buffer.width * buffer.height * 3);
-	for (int32 i=0; i < buffer.height; ++i) {
-		memcpy((uint8*)buffer_temp + i * buffer.width * 3, (uint8*)buffer.pixels + (buffer.height - i - 1) * buffer.width * 3, buffer.width * 3);
+	if (sheet->InsertTexture(new_image) == false) {
+		TextureManager->_RemoveSheet(sheet);
+		delete new_image;
+		throw Exception("could not insert captured screen image into texture sheet", __FILE__, __LINE__, __FUNCTION__);
 	}
-	void* temp = buffer.pixels;
-	buffer.pixels = buffer_temp;
-	buffer_temp = temp;
 
-	buffer.SaveImage(filename, false);
+	// Vertically flip the texture image by swapping the v coordinates, since OpenGL copies the screen upside down
+	float temp = new_image->v1;
+	new_image->v1 = new_image->v2;
+	new_image->v2 = temp;
 
-	free(buffer_temp);
-	free(buffer.pixels);
-	buffer.pixels = nullptr;
-}
+	// The image takes over the reference that was added above, and the copy kept by the engine adds another
+	StillImage screen_image;
+	screen_image._image_texture = new_image;
+	screen_image._texture = new_image;
+	screen_image.SetDimensions(static_cast<float>(width), static_cast<float>(height));
+	_screen_captures.push_back(screen_image);
+
+	capture_id++;
+	return screen_image;
+} // StillImage VideoEngine::_GetScreenCapture(int32 width, int32 height, int32 screen_width, int32 screen_height)
 
 //-----------------------------------------------------------------------------
 // _CreateTempFilename
@@ -1228,11 +1340,34 @@ void VideoEngine::_UpdateLightning(uint32 frame_time) {
 
 
 
-void VideoEngine::_DEBUG_ShowAdvancedStats() {
-	char text[50];
-	sprintf(text, "Switches: %d\nParticles: %d", TextureManager->_debug_num_tex_switches, _particle_manager.GetNumParticles());
+void VideoEngine::_InitializeGLState() {
+	// Nothing is known about the state of the new context, so every value below is sent to OpenGL
+	_render_state.Invalidate();
+	_render_state.Disable(GL_BLEND);
+	_render_state.Disable(GL_TEXTURE_2D);
+	_render_state.Disable(GL_ALPHA_TEST);
+	_render_state.Disable(GL_STENCIL_TEST);
+	_current_context.scissoring_enabled = false;
+	_render_state.Disable(GL_SCISSOR_TEST);
+	_render_state.DisableClientState(GL_VERTEX_ARRAY);
+	_render_state.DisableClientState(GL_COLOR_ARRAY);
+	_render_state.DisableClientState(GL_TEXTURE_COORD_ARRAY);
 
-	Move(896.0f, 690.0f);
+	// Turn off writing to the depth buffer
+	glDepthMask(GL_FALSE);
+}
+
+
+
+void VideoEngine::_DEBUG_ShowAdvancedStats() {
+	const ParticlePoolStatistics& pool = _particle_manager.GetPoolStatistics();
+	char text[320];
+	sprintf(text, "Switches: %d\nState changes: %u (%u skipped)\nDraw calls: %d\nParticles: %d\nSystems new/reused: %u/%u\nEffects new/reused: %u/%u\nPooled systems: %u\nLights: %u",
+		TextureManager->_debug_num_tex_switches, _render_state.GetNumChanges(), _render_state.GetNumSkippedChanges(),
+		_num_draw_calls, _particle_manager.GetNumParticles(),
+		pool.systems_allocated, pool.systems_reused, pool.effects_allocated, pool.effects_reused, pool.systems_pooled, _light_compositor.GetNumCompositedLights());
+
+	Move(800.0f, 690.0f);
 	TextManager->Draw(text);
 }
 
@@ -1244,22 +1379,24 @@ void VideoEngine::DrawLine(float x1, float y1, float x2, float y2, float width,
 		x1, y1,
 		x2, y2
 	};
-	glEnable(GL_BLEND);
-	glDisable(GL_TEXTURE_2D);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); // Normal blending
+	_sprite_batch.Flush();
+	_render_state.Enable(GL_BLEND);
+	_render_state.Disable(GL_TEXTURE_2D);
+	_render_state.Disable(GL_ALPHA_TEST);
+	_render_state.SetBlendFunction(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); // Normal blending
 	glPushAttrib(GL_LINE_WIDTH);
 
 	float pixel_width, pixel_height;
 	GetPixelSize(pixel_width, pixel_height);
 	glLineWidth(width * pixel_height);
-	glEnableClientState(GL_VERTEX_ARRAY);
-	glDisableClientState(GL_COLOR_ARRAY);
-	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	_render_state.EnableClientState(GL_VERTEX_ARRAY);
+	_render_state.DisableClientState(GL_COLOR_ARRAY);
+	_render_state.DisableClientState(GL_TEXTURE_COORD_ARRAY);
 	glColor4fv((GLfloat*)color.GetColors());
 	glVertexPointer(2, GL_FLOAT, 0, vert_coords);
 	glDrawArrays(GL_LINES, 0, 2);
-	glDisableClientState(GL_VERTEX_ARRAY);
 	glPopAttrib();
+	_num_draw_calls++;
 }
 
 
@@ -1288,12 +1425,17 @@ void VideoEngine::DrawGrid(float x, float y, float x_step, float y_step, const C
 		vertices.push_back(y);
 		num_vertices += 2;
 	}
+	_sprite_batch.Flush();
 	glColor4fv(&c[0]);
-	glDisable(GL_TEXTURE_2D);
-	glEnableClientState(GL_VERTEX_ARRAY);
+	_render_state.Disable(GL_BLEND);
+	_render_state.Disable(GL_TEXTURE_2D);
+	_render_state.Disable(GL_ALPHA_TEST);
+	_render_state.EnableClientState(GL_VERTEX_ARRAY);
+	_render_state.DisableClientState(GL_COLOR_ARRAY);
+	_render_state.DisableClientState(GL_TEXTURE_COORD_ARRAY);
 	glVertexPointer(2, GL_FLOAT, 0, &(vertices[0]));
 	glDrawArrays(GL_LINES, 0, num_vertices);
-	glDisableClientState(GL_VERTEX_ARRAY);
+	_num_draw_calls++;
 
 	PopState();
 }
@@ -1333,10 +1475,17 @@ void VideoEngine::DrawHalo(const ImageDescriptor& image, float x, float y, const
 
 
 void VideoEngine::DrawLight(float radius, float x, float y, const Color &color) {
-	// This function has been left unimplemented as the old implementation was broken
-	// FBOs have been removed and the old implementation was no longer valid
-	// TODO: Re-implement this method
-	IF_PRINT_WARNING(VIDEO_DEBUG) << "Called unimplement method with params: " << radius << ", " << x << ", " << y << ", " << color.GetAlpha() << endl;
+	// The light compositor places lights relative to the screen, since the coordinate system may change before they are drawn
+	const CoordSys& coordinate_system = _current_context.coordinate_system;
+	float width = coordinate_system.GetRight() - coordinate_system.GetLeft();
+	float height = coordinate_system.GetTop() - coordinate_system.GetBottom();
+
+	// The vertical radius is derived from the horizontal one so that the light is round on the screen
+	float x_radius = radius / coordinate_system.GetWidth();
+	float y_radius = x_radius * _current_context.viewport.width / max(1, _current_context.viewport.height);
+
+	_light_compositor.AddLight((x - coordinate_system.GetLeft()) / width, (y - coordinate_system.GetBottom()) / height,
+		x_radius, y_radius, color);
 }
 
 
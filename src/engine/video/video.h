@@ -60,6 +60,7 @@ extern "C" {
 #include "defs.h"
 #include "utils.h"
 
+#include "capture_framebuffer.h"
 #include "context.h"
 #include "color.h"
 #include "coord_sys.h"
@@ -68,8 +69,15 @@ extern "C" {
 #include "interpolator.h"
 #include "shake.h"
 #include "screen_rect.h"
+#include "headless_context.h"
+#include "light_compositor.h"
+#include "render_state.h"
+#include "screenshot.h"
+#include "sprite_batch.h"
+#include "quad_buffer.h"
 #include "texture_controller.h"
 #include "text.h"
+#include "number_image.h"
 #include "particle_manager.h"
 #include "particle_effect.h"
 
@@ -146,7 +154,10 @@ enum VIDEO_TARGET {
 	//! Represents a QT widget
 	VIDEO_TARGET_QT_WIDGET  = 1,
 
-	VIDEO_TARGET_TOTAL = 2
+	//! Represents an offscreen framebuffer, which requires no display or graphics card (see headless_context.h)
+	VIDEO_TARGET_HEADLESS   = 2,
+
+	VIDEO_TARGET_TOTAL = 3
 };
 
 
@@ -217,12 +228,17 @@ class VideoEngine : public hoa_utils::Singleton<VideoEngine> {
 	friend class private_video::FixedTexSheet;
 	friend class private_video::VariableTexSheet;
 	friend class private_video::ParticleSystem;
+	friend class private_video::SpriteBatch;
+	friend class private_video::LightCompositor;
 
 	friend class ImageDescriptor;
 	friend class StillImage;
 	friend class CompositeImage;
+	friend class QuadBuffer;
+	friend class ParticleEffect;
 	friend class private_video::TextElement;
 	friend class TextImage;
+	friend class NumberImage;
 
 public:
 	~VideoEngine();
@@ -235,13 +251,28 @@ public:
 	//! \brief Delayed setup calls, that require data from the settings file.
 	//@{
 	void SetInitialResolution(int32 width, int32 height);
+
+	/** \brief Sets the width and height of the texture sheets that are shared between multiple images
+	*** \param size The size in pixels, which must be a power of two of at least 64. Sizes larger than GL_MAX_TEXTURE_SIZE are reduced to it.
+	*** \note This must be called before FinalizeInitialization() in order to take effect
+	**/
+	void SetTexSheetSize(int32 size)
+		{ _tex_sheet_size = size; }
+
+	/** \brief Sets the maximum size of the cache of decoded images stored in the user data directory
+	*** \param size The size in bytes. Zero disables the image cache.
+	*** \note This must be called before FinalizeInitialization() in order to take effect
+	**/
+	void SetImageCacheSize(uint64_t size)
+		{ _image_cache_size = size; }
+
 	bool FinalizeInitialization();
 	//@}
 
 	// ---------- General methods
 
 	/** \brief Sets the target window environment where the video engine will be used
-	*** \param target The window target, which can be VIDEO_TARGET_SDL_WINDOW or VIDEO_TARGET_QT_WIDGET
+	*** \param target The window target, which can be VIDEO_TARGET_SDL_WINDOW, VIDEO_TARGET_QT_WIDGET, or VIDEO_TARGET_HEADLESS
 	*** \note The video engien's default target is a SDL window, so if that's what you desire then this
 	*** function does not need to be called.
 	*** \note You must set the target before calling the SingletonInitialize() function. Any invocations
@@ -294,6 +325,18 @@ public:
 	///! \brief Returns a string representation of the most recently fetched OpenGL error code
 	const std::string CreateGLErrorString();
 
+	/** \brief Retrieves an OpenGL function that is not part of OpenGL 1.1 from the current context
+	*** \param name The name of the function, such as "glGenBuffers"
+	*** \return A pointer to the function, or nullptr if it is not available
+	*** \note This must be used instead of SDL_GL_GetProcAddress(), which does not work with the headless target
+	**/
+	void* GetGLFunction(const char* name);
+
+	/** \brief Determines if the current context supports an OpenGL extension
+	*** \param name The name of the extension, such as "GL_ARB_instanced_arrays"
+	**/
+	bool IsGLExtensionSupported(const char* name);
+
 	// ---------- Screen size and resolution methods
 
 	//! \brief Returns the width of the screen, in pixels
@@ -462,12 +505,10 @@ public:
 	*** What this means is that it save the combined result of all transformation
 	*** calls (Move/MoveRelative/Scale/Rotate)
 	**/
-	void PushMatrix()
-		{ glPushMatrix(); }
+	void PushMatrix();
 
 	//! \brief Pops the modelview transformation from the stack
-	void PopMatrix()
-		{ glPopMatrix(); }
+	void PopMatrix();
 
 	/** \brief Saves relevant state of the video engine on to an internal stack
 	*** The contents saved include the modelview transformation and the current
@@ -491,7 +532,7 @@ public:
 	*** prior to using this function.
 	**/
 	void Rotate(float angle)
-		{ glRotatef(angle, 0, 0, 1); }
+		{ _transform.Rotate(angle); glRotatef(angle, 0, 0, 1); }
 
 	/** \brief Scales all subsequent image drawing calls in the horizontal and vertical direction
 	*** \param x The amount of horizontal scaling to perform (0.5 for half, 1.0 for normal, 2.0 for double, etc)
@@ -500,26 +541,31 @@ public:
 	*** prior to using this function.
 	**/
 	void Scale(float x, float y)
-		{ glScalef(x, y, 1.0f); }
+		{ _transform.Scale(x, y); glScalef(x, y, 1.0f); }
 
 	/** \brief Sets the OpenGL transform to the contents of 4x4 matrix
 	*** \param matrix A pointer to an array of 16 float values that form a 4x4 transformation matrix
 	**/
-	void SetTransform(float matrix[16]);
+	void SetTransform(const float matrix[16]);
 
 	// ----------  Image operation methods
 
 	/** \brief Captures the contents of the screen and saves it as an image texture
+	*** \param scale The resolution of the capture relative to the screen, which may be less than 1.0f to make a
+	*** blurred capture for a backdrop. The capture is always drawn at the size of the screen.
 	*** \return An initialized StillImage object used to draw/manipulate the captured screen
 	*** \throw Exception If the new captured screen could not be created
 	***
 	*** When this function is called, it will generate an image using the contents that are
 	*** being displayed on the current screen. This means that you can have multiple screen
-	*** captures in memory at the same time. You should be careful not to have too many
-	*** screen captures existing at one time, because each image capture requires a relatively
-	*** large amount of texutre memory (roughly 3GB for a 1024x768 screen).
+	*** captures in memory at the same time.
+	***
+	*** The textures of captures are kept after the last image that refers to them is destroyed and are
+	*** reused by later captures of the same size, so that only the first capture allocates texture memory.
+	*** The screen is copied into the texture by the graphics card. A scaled capture requires framebuffer
+	*** blits, and is made at the full resolution of the screen when they are unavailable.
 	**/
-	StillImage CaptureScreen() throw(hoa_utils::Exception);
+	StillImage CaptureScreen(float scale = 1.0f) throw(hoa_utils::Exception);
 
 	/** \brief Returns a pointer to the GUIManager singleton object
 	*** This method allows the user to perform text operations. For example, to load a
@@ -549,9 +595,10 @@ public:
 
 	/** \brief Uses a color overlay for the screen
 	*** \param color The color to use for lighting
+	*** \note Lights that are drawn with DrawLight() remove the overlay around them
 	**/
 	void EnableLightOverlay(const Color& color)
-		{ _light_overlay_enabled = true; _light_overlay_image.SetColor(color); }
+		{ _light_overlay_enabled = true; _light_overlay_color = color; _light_overlay_image.SetColor(color); }
 
 	//! \brief Disables the active light overlay
 	void DisableLightOverlay()
@@ -594,20 +641,17 @@ public:
 	***/
 	void DrawHalo(const ImageDescriptor &id, float x, float y, const Color &color = Color::white);
 
-	/** \brief Draws a light at a specified location
-	*** \param radius The radius that the light extends to
+	/** \brief Adds a light at a specified location to the current frame
+	*** \param radius The radius that the light extends to, in the units of the x axis of the current coordinate system
 	*** \param x The x coordinate of light
 	*** \param y The y coordinate of light
-	*** \param color The color of the light to draw (default: white)
+	*** \param color The color of the light to draw (default: white). Its alpha is the strength of the light.
+	***
+	*** Lights are not drawn immediately. They are collected until DrawOverlays() is called, which removes them from
+	*** the light overlay. Lights therefore have no visible effect unless the light overlay is enabled.
 	**/
 	void DrawLight(float radius, float x, float y, const Color &color = Color::white);
 
-	/** \brief Applies lighting after all images have been drawn.
-	*** \note All GUI and text rendering should be done AFTER this call is made, so that they are not affected by
-	*** the lighting.
-	**/
-	void ApplyLightingOverlay();
-
 	/** \brief Loads a lightning effect
 	*** \param file The file which contains the lightning intensity data, stored as floats ranging from 0.0f to 1.0f
 	*** \param effect_number The effect ID number, used to load the correct effect data from the file
@@ -692,6 +736,20 @@ public:
 	**/
 	ParticleEffectID AddParticleEffect(const std::string &filename, float x, float y, bool reload = false);
 
+	/** \brief Loads the definitions of particle effects that will be added later
+	*** \param filenames The names of the files containing the particle effect definitions
+	*** \return True if every definition was loaded successfully
+	***
+	*** Loading a definition reads its file and the images of its animation frames, which is too slow to do in the
+	*** middle of a battle. Modes should call this while they are loading for every effect that they may add.
+	**/
+	bool PreloadParticleEffects(const std::vector<std::string> &filenames);
+
+	/** \brief Deletes the definitions of all particle effects which are not currently active
+	*** \note Call this when leaving a mode which preloaded effects that are not used elsewhere.
+	**/
+	void UnloadUnusedParticleEffects();
+
 	/** \brief draws all active particle effects
 	 * \return success/failure
 	 */
@@ -714,6 +772,14 @@ public:
 	 */
 	int32 GetNumParticles();
 
+	/** \brief Makes the particle effects added after this call look the same every time they are played
+	*** \param seed The seed that the random numbers of the effects are derived from
+	***
+	*** \note This is intended for testing and recording. See ParticleManager::SetSeed() for details.
+	**/
+	void SetParticleSeed(uint32 seed)
+		{ _particle_manager.SetSeed(seed); }
+
 	//-- Miscellaneous --------------------------------------------------------
 
 	/** \brief Sets a new gamma value using SDL_SetGamma()
@@ -776,10 +842,30 @@ public:
 	**/
 	void DrawRectangleOutline(float x1, float y1, float x2, float y2, float width, const Color& color);
 
-	/** \brief Takes a screenshot and saves the image to a file
+	/** \brief Takes a screenshot of the next frame and saves the image to a file
 	*** \param filename The name of the file, if any, to save the screenshot as. Default is "screenshot.jpg"
+	***
+	*** The image is saved as a PNG image if the filename ends with ".png" and as a JPEG image otherwise. The screen
+	*** is read without waiting for the graphics card and the image is saved by a worker thread, so the file is written
+	*** some time after this call returns. The screenshot does not include the debugging information drawn over the scene.
+	**/
+	void MakeScreenshot(const std::string& filename = "screenshot.jpg")
+		{ _screenshot_writer.Request(filename); }
+
+	/** \brief Starts saving a screenshot of every Nth frame to a numbered file
+	*** \param prefix The path and start of the name of every file, to which a six digit frame number and the extension are appended
+	*** \param interval The number of frames between two screenshots, where 1 saves every frame
+	*** \param png If true the images are saved as PNG images, otherwise they are saved as JPEG images
 	**/
-	void MakeScreenshot(const std::string& filename = "screenshot.jpg");
+	void StartScreenshotSequence(const std::string& prefix, uint32 interval, bool png = true)
+		{ _screenshot_writer.StartSequence(prefix, interval, png); }
+
+	//! \brief Stops saving the screenshots of a sequence started by StartScreenshotSequence()
+	void StopScreenshotSequence()
+		{ _screenshot_writer.StopSequence(); }
+
+	bool IsScreenshotSequenceActive() const
+		{ return _screenshot_writer.IsSequenceActive(); }
 
 	/** \brief toggles advanced information display for video engine, shows
 	 *         things like number of texture switches per frame, etc.
@@ -867,6 +953,12 @@ private:
 	//! \brief Enables or disables smoothing of textures
 	bool _smooth_textures;
 
+	//! \brief The requested size of shared texture sheets, which is validated by the TextureController when it is initialized
+	int32 _tex_sheet_size;
+
+	//! \brief The maximum size, in bytes, of the decoded image cache, which is created by the TextureController when it is initialized
+	uint64_t _image_cache_size;
+
 	//! \brief The x and y coordinates of the current draw cursor position
 	float _x_cursor, _y_cursor;
 
@@ -885,6 +977,20 @@ private:
 	//! keep track of number of draw calls per frame
 	int32 _num_draw_calls;
 
+	//! \brief Collects the quads of image and text draws so that they may be drawn with fewer draw calls
+	private_video::SpriteBatch _sprite_batch;
+
+	/** \brief A copy of the OpenGL modelview matrix that the sprite batch transforms its quads by
+	*** Every method of this class that changes the modelview matrix changes this copy as well.
+	**/
+	private_video::SpriteTransform _transform;
+
+	//! \brief The copies of the modelview matrices saved by PushMatrix() and PushState(), which share the OpenGL matrix stack
+	std::vector<private_video::SpriteTransform> _transform_stack;
+
+	//! \brief Holds the current OpenGL state so that redundant state changes are not sent to OpenGL
+	private_video::RenderState _render_state;
+
 	//! \brief Set to true when the lighting overlay is enabled
 	bool _light_overlay_enabled;
 
@@ -894,6 +1000,12 @@ private:
 	//! \brief The image used as the overlay for lighting
 	StillImage _light_overlay_image;
 
+	//! \brief The color of the overlay for lighting
+	Color _light_overlay_color;
+
+	//! \brief Collects the lights of the current frame and draws them into the light overlay
+	private_video::LightCompositor _light_compositor;
+
 	//! \brief The image used as the overlay for ambient effects
 	StillImage _ambient_overlay_image;
 
@@ -969,9 +1081,6 @@ private:
 	//! current scene lighting color (essentially just modulates vertex colors of all the images)
 	Color _light_color;
 
-	//! STL map containing all loaded particle effect definitions
-	std::map<std::string, ParticleEffectDef*> _particle_effect_defs;
-
 	//! stack containing context, i.e. draw flags plus coord sys. Context is pushed and popped by any VideoEngine functions that clobber these settings
 	std::stack<private_video::Context> _context_stack;
 
@@ -984,6 +1093,33 @@ private:
 	//! OpenGL context (SDL2)
 	SDL_GLContext glcontext;
 
+	//! \brief The OpenGL context and offscreen framebuffer that are used in place of a window by the headless target
+	private_video::HeadlessContext _headless_context;
+
+	//! \brief Reads and saves the screenshots requested by MakeScreenshot() and StartScreenshotSequence()
+	private_video::ScreenshotWriter _screenshot_writer;
+
+	/** \brief The textures of all screen captures, including those that are no longer in use
+	*** Each image holds one reference to its texture, so a capture is unused when its reference count is one.
+	**/
+	std::vector<StillImage> _screen_captures;
+
+	//! \brief Scales screen captures down on the graphics card
+	private_video::CaptureFramebuffer _capture_framebuffer;
+
+	/** \brief Retrieves an unused screen capture texture of a certain size, creating one if none exists
+	*** \param width The width of the capture, in pixels
+	*** \param height The height of the capture, in pixels
+	*** \param screen_width The width of the screen, in pixels
+	*** \param screen_height The height of the screen, in pixels
+	*** \return An image of the texture, whose contents are undefined
+	*** \throw Exception If a new texture could not be created
+	***
+	*** Before a new texture is created, unused textures are deleted unless they are of the requested size or of the
+	*** size of the screen, which every scaled capture is made from.
+	**/
+	StillImage _GetScreenCapture(int32 width, int32 height, int32 screen_width, int32 screen_height) throw(hoa_utils::Exception);
+
 	/** \brief converts VIDEO_DRAW_LEFT or VIDEO_DRAW_RIGHT flags to a numerical offset
 	* \param xalign the draw flag
 	* \return the numerical offset
@@ -1052,6 +1188,9 @@ private:
 	*** This includes, for instance, the number of texture switches made during a frame.
 	**/
 	void _DEBUG_ShowAdvancedStats();
+
+	//! \brief Sets the OpenGL state that the engine expects after a new context has been created
+	void _InitializeGLState();
 }; // class VideoEngine : public hoa_utils::Singleton<VideoEngine>
 
 }  // namespace hoa_video
@@ -42,6 +42,7 @@
 #include "input.h"
 #include "mode_manager.h"
 #include "notification.h"
+#include "profiler.h"
 #include "script.h"
 #include "system.h"
 #include "video.h"
@@ -50,6 +51,7 @@
 #include "gui.h"
 
 #include "boot.h"
+#include "map.h"
 #include "test.h"
 #include "main_options.h"
 
@@ -66,6 +68,7 @@ using namespace hoa_system;
 using namespace hoa_global;
 using namespace hoa_script;
 using namespace hoa_boot;
+using namespace hoa_map;
 using namespace hoa_test;
 
 
@@ -101,6 +104,9 @@ void QuitAllacrost() {
 	NotificationEngine::SingletonDestroy();
 	SystemEngine::SingletonDestroy();
 	VideoEngine::SingletonDestroy();
+
+	// Destroy the profiler last, since the other engine components may still contain profiled code
+	ProfileEngine::SingletonDestroy();
 } // void QuitAllacrost()
 
 
@@ -184,8 +190,18 @@ bool LoadSettings() {
 	int32 resy = settings.ReadInt("screen_resy");
 	VideoManager->SetInitialResolution(resx, resy);
 	VideoManager->SetFullscreen(fullscreen);
+	// This is a hidden setting for the size of the texture sheets that images are packed into
+	if (settings.DoesIntExist("texture_sheet_size"))
+		VideoManager->SetTexSheetSize(static_cast<int32>(settings.ReadInt("texture_sheet_size")));
+	// This is a hidden setting for the size (in megabytes) of the decoded image cache. Zero disables the cache.
+	if (settings.DoesIntExist("image_cache_size"))
+		VideoManager->SetImageCacheSize(static_cast<uint64_t>(settings.ReadInt("image_cache_size")) * 1024 * 1024);
 	settings.CloseTable();
 
+	// This is a hidden setting that limits the memory (in megabytes) used to load maps in the background
+	if (settings.DoesIntExist("map_preload_memory"))
+		MapMode::SetPreloadMemoryBudget(static_cast<size_t>(settings.ReadInt("map_preload_memory")) * 1024 * 1024);
+
 	if (settings.IsErrorDetected()) {
 		PRINT_ERROR << "failure while trying to retrieve video settings information from file: "
 			<< GetSettingsFilename() << endl;
@@ -234,6 +250,11 @@ void InitializeEngine() throw (Exception) {
 	NotificationManager = NotificationEngine::SingletonCreate();
 	GUIManager = GUISystem::SingletonCreate();
 	GlobalManager = GameGlobal::SingletonCreate();
+	ProfileManager = ProfileEngine::SingletonCreate();
+
+	// The target must be set before the video engine is initialized
+	if (hoa_main::start_headless == true)
+		VideoManager->SetTarget(VIDEO_TARGET_HEADLESS);
 
 	if (VideoManager->SingletonInitialize() == false) {
 		throw Exception("ERROR: unable to initialize VideoManager", __FILE__, __LINE__, __FUNCTION__);
@@ -255,6 +276,9 @@ void InitializeEngine() throw (Exception) {
 	if (SystemManager->SingletonInitialize() == false) {
 		throw Exception("ERROR: unable to initialize SystemManager", __FILE__, __LINE__, __FUNCTION__);
 	}
+	if (ProfileManager->SingletonInitialize() == false) {
+		throw Exception("ERROR: unable to initialize ProfileManager", __FILE__, __LINE__, __FUNCTION__);
+	}
 	if (InputManager->SingletonInitialize() == false) {
 		throw Exception("ERROR: unable to initialize InputManager", __FILE__, __LINE__, __FUNCTION__);
 	}
@@ -403,28 +427,65 @@ int main(int argc, char *argv[]) {
 	}
 
 	try {
+		// Counts the frames drawn when the game should exit after a fixed number of frames (the --frames option)
+		uint32 frame_count = 0;
+
+		// Screenshots of a sequence (the --screenshots option) are named by the frame that they were taken on
+		if (hoa_main::screenshot_interval != 0)
+			VideoManager->StartScreenshotSequence(GetUserDataPath(true) + "frame_", hoa_main::screenshot_interval);
+
+		// When a profile was requested (the --profile option), every frame from the first to the last is captured
+		if (hoa_main::profile_filename.empty() == false)
+			ProfileManager->StartCapture();
+
 		// This is the main loop for the game. The loop iterates once for every frame drawn to the screen.
 		while (SystemManager->NotDone()) {
+			ProfileManager->BeginFrame();
+
 			// 1) Render the scene
-			VideoManager->Clear();
-			ModeManager->Draw();
-			VideoManager->Display(SystemManager->GetUpdateTime());
+			{
+				PROFILE_ZONE("Draw");
+				VideoManager->Clear();
+				ModeManager->Draw();
+			}
+			{
+				PROFILE_ZONE("Display");
+				VideoManager->Display(SystemManager->GetUpdateTime());
+			}
+
+			if (hoa_main::max_frames != 0 && ++frame_count >= hoa_main::max_frames)
+				SystemManager->ExitGame();
 
 			// 2) Process all new input events
-			InputManager->EventHandler();
+			{
+				PROFILE_ZONE("InputManager::EventHandler");
+				InputManager->EventHandler();
+			}
 
 			// 3) Update any streaming audio sources
-			AudioManager->Update();
+			{
+				PROFILE_ZONE("AudioManager::Update");
+				AudioManager->Update();
+			}
 
 			// 4) Update timers for correct time-based movement operation
-			SystemManager->UpdateTimers();
+			{
+				PROFILE_ZONE("SystemManager::UpdateTimers");
+				SystemManager->UpdateTimers();
+			}
 
 			// 5) Update the game status
-			ModeManager->Update();
+			{
+				PROFILE_ZONE("ModeManager::Update");
+				ModeManager->Update();
+			}
 
 			// 6) Clear any notification events that were generated
 			NotificationManager->DeleteAllNotificationEvents();
 		} // while (SystemManager->NotDone())
+
+		if (hoa_main::profile_filename.empty() == false && ProfileManager->IsCapturing() == true)
+			ProfileManager->StopCapture(hoa_main::profile_filename);
 	}
 	catch (Exception& e) {
 		#ifdef WIN32
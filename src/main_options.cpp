@@ -20,6 +20,7 @@
 #include "input.h"
 #include "mode_manager.h"
 #include "notification.h"
+#include "profiler.h"
 #include "script.h"
 #include "system.h"
 #include "video.h"
@@ -35,6 +36,10 @@ namespace hoa_main {
 
 bool start_in_test_mode = false;
 uint32 test_number = 0;
+bool start_headless = false;
+uint32 max_frames = 0;
+string profile_filename;
+uint32 screenshot_interval = 0;
 
 
 
@@ -69,6 +74,27 @@ bool ParseProgramOptions(int32 &return_code, int32 argc, char **argv) {
 		else if (options[i] == "--disable-audio") {
 			hoa_audio::AUDIO_ENABLE = false;
 		}
+		else if (options[i] == "--frames") {
+			if ((i + 1) >= options.size() || IsStringNumeric(options[i + 1]) == false) {
+				cerr << "Option " << options[i] << " requires an unsigned integer argument." << endl;
+				PrintUsage();
+				return_code = 1;
+				return false;
+			}
+			int32 number = 0;
+			istringstream(options[i + 1]) >> number;
+			if (number <= 0) {
+				cerr << "Parameter \"" << options[i + 1] << "\" for argument \"" << options[i] <<
+					"\" must be greater than zero" << endl;
+				return_code = 1;
+				return false;
+			}
+			max_frames = static_cast<uint32>(number);
+			i++;
+		}
+		else if (options[i] == "--headless") {
+			start_headless = true;
+		}
 		else if (options[i] == "-h" || options[i] == "--help") {
 			PrintUsage();
 			return_code = 0;
@@ -83,6 +109,16 @@ bool ParseProgramOptions(int32 &return_code, int32 argc, char **argv) {
 			}
 			return false;
 		}
+		else if (options[i] == "--profile") {
+			if ((i + 1) >= options.size()) {
+				cerr << "Option " << options[i] << " requires an argument." << endl;
+				PrintUsage();
+				return_code = 1;
+				return false;
+			}
+			profile_filename = options[i + 1];
+			i++;
+		}
 		else if (options[i] == "-r" || options[i] == "--reset") {
 			if (ResetSettings() == true) {
 				return_code = 0;
@@ -93,6 +129,24 @@ bool ParseProgramOptions(int32 &return_code, int32 argc, char **argv) {
 			return_code = 0;
 			return false;
 		}
+		else if (options[i] == "--screenshots") {
+			if ((i + 1) >= options.size() || IsStringNumeric(options[i + 1]) == false) {
+				cerr << "Option " << options[i] << " requires an unsigned integer argument." << endl;
+				PrintUsage();
+				return_code = 1;
+				return false;
+			}
+			int32 number = 0;
+			istringstream(options[i + 1]) >> number;
+			if (number <= 0) {
+				cerr << "Parameter \"" << options[i + 1] << "\" for argument \"" << options[i] <<
+					"\" must be greater than zero" << endl;
+				return_code = 1;
+				return false;
+			}
+			screenshot_interval = static_cast<uint32>(number);
+			i++;
+		}
 		else if (options[i] == "-t" || options[i] == "--test") {
 			start_in_test_mode = true;
 			// Check for the optional argument that may follow the test option
@@ -170,9 +224,14 @@ void PrintUsage() {
 	cout << "                       map, mode_manager, pause, quit, scene, system" << endl;
 	cout << "                       test, utils, video" << endl;
 	cout << "  --disable-audio   :: disables loading and playing audio" << endl;
+	cout << "  --frames <n>      :: exits after <n> frames have been drawn" << endl;
+	cout << "  --headless        :: renders offscreen, without a window (requires a build with USE_EGL)" << endl;
 	cout << "  --help/-h         :: prints this help menu" << endl;
 	cout << "  --info/-i         :: prints information about the user's system" << endl;
+	cout << "  --profile <file>  :: profiles every frame and writes a Chrome trace to <file> on exit." << endl;
+	cout << "                       Only the last " << hoa_system::PROFILE_ZONES_PER_THREAD << " zones of each thread are kept" << endl;
 	cout << "  --reset/-r        :: resets game configuration to use default settings" << endl;
+	cout << "  --screenshots <n> :: saves every <n>th frame as a numbered PNG image in the user data directory" << endl;
 	cout << "  --test/-t <test>  :: start the application in test mode, optionally specifying a specific test to immediately execute" << endl;
 }
 
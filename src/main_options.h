@@ -27,6 +27,18 @@ extern bool start_in_test_mode;
 //! \brief The specific test number to begin immediate execution of. If zero, this value is ignored
 extern uint32 test_number;
 
+//! \brief Set to true when it is requested that the video engine render offscreen instead of to a window
+extern bool start_headless;
+
+//! \brief The number of frames to draw before the application exits. If zero, this value is ignored
+extern uint32 max_frames;
+
+//! \brief The name of the file to write a profiler capture of the entire run to. If empty, no capture is made
+extern std::string profile_filename;
+
+//! \brief The number of frames between two screenshots of a screenshot sequence. If zero, no sequence is saved
+extern uint32 screenshot_interval;
+
 /** \brief Parses command-line options and takes appropriate action on those options
 *** \param return_code A reference to the return code to exit the program with.
 *** \param argc The number of arguments given to the program
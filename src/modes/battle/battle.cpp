@@ -19,6 +19,7 @@
 #include "audio.h"
 #include "input.h"
 #include "mode_manager.h"
+#include "profiler.h"
 #include "script.h"
 #include "video.h"
 
@@ -296,6 +297,8 @@ BattleMode::BattleMode() :
 
 BattleMode::~BattleMode() {
 	_battle_script.CloseFile();
+	// Release the definitions of any particle effects that the battle script preloaded
+	VideoManager->UnloadUnusedParticleEffects();
 
 	delete _sequence_supervisor;
 	delete _command_supervisor;
@@ -357,6 +360,8 @@ void BattleMode::Reset() {
 
 
 void BattleMode::Update() {
+	PROFILE_ZONE("BattleMode::Update");
+
 	// Pause/quit requests take priority
 	if (InputManager->QuitPress()) {
 		ModeManager->Push(new PauseMode(hoa_pause::QUIT));
@@ -892,6 +897,15 @@ void BattleMode::_Initialize() {
 				_battle_script.CloseFile();
 			}
 			else {
+				// Load the particle effects that the script declares it will use now, instead of when each is first added
+				if (_battle_script.DoesTableExist("particle_effects") == true) {
+					vector<string> effect_filenames;
+					_battle_script.ReadStringVector("particle_effects", effect_filenames);
+					if (VideoManager->PreloadParticleEffects(effect_filenames) == false) {
+						IF_PRINT_WARNING(BATTLE_DEBUG) << "failed to preload one or more particle effects for battle script: " << _script_filename << endl;
+					}
+				}
+
 				_update_function = _battle_script.ReadFunctionPointer("Update");
 				_draw_function = _battle_script.ReadFunctionPointer("Draw");
 
@@ -241,6 +241,10 @@ public:
 	*** This function should only be called once before the BattleMode class object is initialized (before Reset()
 	*** is called for the first time). Calling it after the battle has been initialized will have no effect and
 	*** print out a warning.
+	***
+	*** The script may declare a table named "particle_effects" containing the filenames of every particle effect
+	*** that it adds. These effects are loaded when the battle is initialized so that adding them does not stall
+	*** the battle.
 	**/
 	void LoadBattleScript(const std::string& filename);
 
@@ -330,9 +330,9 @@ BattleCharacter::BattleCharacter(GlobalCharacter* character) :
 	_name_text.SetStyle(TextStyle("title24"));
 	_name_text.SetText(GetName());
 	_hit_points_text.SetStyle(TextStyle("text22", Color::white, VIDEO_TEXT_SHADOW_BLACK));
-	_hit_points_text.SetText(NumberToString(_last_rendered_hp));
+	_hit_points_text.SetNumber(_last_rendered_hp);
 	_skill_points_text.SetStyle(TextStyle("text22", Color::white, VIDEO_TEXT_SHADOW_BLACK));
-	_skill_points_text.SetText(NumberToString(_last_rendered_sp));
+	_skill_points_text.SetNumber(_last_rendered_sp);
 
 	_action_selection_text.SetStyle(TextStyle("text20"));
 	_action_selection_text.SetText("");
@@ -588,19 +588,16 @@ void BattleCharacter::DrawStatus(uint32 order, bool command_active) {
 		VideoManager->Move(SP_TEXT_XPOS, y_position + HPSP_TEXT_OFFSET_YPOS);
 		_skill_points_text.Draw();
 
-		// TODO: The SetText calls below should not be done here. They should be made whenever the character's HP/SP
-		// is modified. This re-renders the text every frame regardless of whether or not the HP/SP changed so its
-		// not efficient
-
-		// Update hit and skill points after drawing to reduce gpu stall
+		// Update hit and skill points after drawing. Number images are drawn from prerendered characters, so
+		// changing their value does not render any text.
 		if (_last_rendered_hp != GetHitPoints()) {
 			_last_rendered_hp = GetHitPoints();
-			_hit_points_text.SetText(NumberToString(_last_rendered_hp));
+			_hit_points_text.SetNumber(_last_rendered_hp);
 		}
 
 		if (_last_rendered_sp != GetSkillPoints()) {
 			_last_rendered_sp = GetSkillPoints();
-			_skill_points_text.SetText(NumberToString(_last_rendered_sp));
+			_skill_points_text.SetNumber(_last_rendered_sp);
 		}
 
 		float bar_size;
@@ -421,11 +421,11 @@ protected:
 	//! \brief Rendered text of the character's name
 	hoa_video::TextImage _name_text;
 
-	//! \brief Rendered text of the character's current hit points
-	hoa_video::TextImage _hit_points_text;
+	//! \brief Displays the character's current hit points
+	hoa_video::NumberImage _hit_points_text;
 
-	//! \brief Rendered text of the character's current skill points
-	hoa_video::TextImage _skill_points_text;
+	//! \brief Displays the character's current skill points
+	hoa_video::NumberImage _skill_points_text;
 
 	//! \brief Rendered text of the character's currently selected action
 	hoa_video::TextImage _action_selection_text;
@@ -143,6 +143,28 @@ void IndicatorText::Draw() {
 		_text_image.Draw();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// IndicatorNumber class
+////////////////////////////////////////////////////////////////////////////////
+
+IndicatorNumber::IndicatorNumber(BattleActor* actor, int32 number, const TextStyle& style) :
+	IndicatorElement(actor),
+	_number_image(style)
+{
+	_number_image.SetNumber(number);
+}
+
+
+
+void IndicatorNumber::Draw() {
+	_CalculateDrawPosition();
+
+	if (_CalculateDrawAlpha() == true)
+		_number_image.Draw(_alpha_color);
+	else
+		_number_image.Draw();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // IndicatorImage class
 ////////////////////////////////////////////////////////////////////////////////
@@ -301,7 +323,6 @@ void IndicatorSupervisor::AddDamageIndicator(uint32 amount) {
 		return;
 	}
 
-	string text = NumberToString(amount);
 	TextStyle style;
 
 	float damage_percent = static_cast<float>(amount) / static_cast<float>(_actor->GetMaxHitPoints());
@@ -326,7 +347,7 @@ void IndicatorSupervisor::AddDamageIndicator(uint32 amount) {
 		style.shadow_style = VIDEO_TEXT_SHADOW_BLACK;
 	}
 
-	_wait_queue.push_back(new IndicatorText(_actor, text, style));
+	_wait_queue.push_back(new IndicatorNumber(_actor, static_cast<int32>(amount), style));
 }
 
 
@@ -342,7 +363,6 @@ void IndicatorSupervisor::AddHealingIndicator(uint32 amount) {
 		return;
 	}
 
-	string text = NumberToString(amount);
 	TextStyle style;
 
 	// TODO: use different colors/shades of green for different degrees of damage. There's a
@@ -369,7 +389,7 @@ void IndicatorSupervisor::AddHealingIndicator(uint32 amount) {
 		style.shadow_style = VIDEO_TEXT_SHADOW_BLACK;
 	}
 
-	_wait_queue.push_back(new IndicatorText(_actor, text, style));
+	_wait_queue.push_back(new IndicatorNumber(_actor, static_cast<int32>(amount), style));
 }
 
 
@@ -172,6 +172,38 @@ protected:
 }; // class IndicatorText  : public IndicatorElement
 
 
+/** ****************************************************************************
+*** \brief Displays a number next to an actor
+***
+*** Number indicators display the amount of damage dealt to or healing performed on
+*** the actor. They look the same as a text indicator of the same number would, but
+*** are drawn from prerendered characters so that no text needs to be rendered when
+*** the indicator is created.
+*** ***************************************************************************/
+class IndicatorNumber : public IndicatorElement {
+public:
+	/** \param actor A valid pointer to the actor object
+	*** \param number The number to display
+	*** \param style The style to draw the number in
+	**/
+	IndicatorNumber(BattleActor* actor, int32 number, const hoa_video::TextStyle& style);
+
+	~IndicatorNumber()
+		{}
+
+	//! \brief Returns the height of the number image
+	float ElementHeight() const
+		{ return _number_image.GetHeight(); }
+
+	//! \brief Draws the number image
+	void Draw();
+
+protected:
+	//! \brief The image of the number to display
+	hoa_video::NumberImage _number_image;
+}; // class IndicatorNumber : public IndicatorElement
+
+
 
 /** ****************************************************************************
 *** \brief Displays an image next to an actor
@@ -17,6 +17,7 @@
 #include "audio.h"
 #include "script.h"
 #include "input.h"
+#include "profiler.h"
 #include "system.h"
 
 // Allacrost globals
@@ -29,8 +30,10 @@
 
 // Local map mode headers
 #include "map.h"
+#include "map_binary.h"
 #include "map_dialogue.h"
 #include "map_events.h"
+#include "map_loader.h"
 #include "map_objects.h"
 #include "map_sprites.h"
 #include "map_tiles.h"
@@ -57,6 +60,9 @@ namespace hoa_map {
 
 // Initialize static class variables
 MapMode* MapMode::_current_instance = nullptr;
+MapLoaderCache* MapMode::_loader_cache = nullptr;
+uint32 MapMode::_instance_count = 0;
+size_t MapMode::_preload_memory_budget = MAP_PRELOAD_MEMORY_BUDGET;
 
 // The maximum value of the run stamina bar
 const uint32 RUN_STAMINA_MAX = 10000;
@@ -65,7 +71,7 @@ const uint32 RUN_STAMINA_MAX = 10000;
 // ********** MapMode Public Class Methods
 // ****************************************************************************
 
-MapMode::MapMode(string script_filename, int32 load_point) :
+MapMode::MapMode(string script_filename, int32 load_point, MapLoader* loader) :
 	GameMode(MAP_MODE),
 	_data_filename(""),
 	_script_filename(script_filename),
@@ -77,6 +83,7 @@ MapMode::MapMode(string script_filename, int32 load_point) :
 	_event_supervisor(new EventSupervisor()),
 	_object_supervisor(new ObjectSupervisor()),
 	_tile_supervisor(new TileSupervisor()),
+	_loader(loader),
 	_transition_supervisor(new TransitionSupervisor()),
 	_treasure_supervisor(new TreasureSupervisor()),
 	_camera(nullptr),
@@ -95,6 +102,12 @@ MapMode::MapMode(string script_filename, int32 load_point) :
 	_current_instance = this;
 	SetCommandDescriptions();
 
+	if (_loader_cache == nullptr) {
+		_loader_cache = new MapLoaderCache();
+		_loader_cache->SetMemoryBudget(_preload_memory_budget);
+	}
+	_instance_count++;
+
 	// Disable any active visual effects
 	VideoManager->DisableLightOverlay();
 	VideoManager->DisableAmbientOverlay();
@@ -126,7 +139,6 @@ MapMode::MapMode(string script_filename, int32 load_point) :
 	_camera = _virtual_focus;
 	_camera_timer.Initialize(0, 1);
 
-	// TODO: Load the map files in a seperate thread
 	_LoadMapFiles();
 
 	// Load miscellaneous map graphics
@@ -164,7 +176,19 @@ MapMode::~MapMode() {
 	delete _transition_supervisor;
 	delete _treasure_supervisor;
 
+	if (_loader != nullptr) {
+		delete _loader;
+		_loader = nullptr;
+	}
+
 	_map_script.CloseFile();
+
+	// The loader cache is destroyed along with the last map so that its memory is not held while outside of map mode
+	_instance_count--;
+	if (_instance_count == 0) {
+		delete _loader_cache;
+		_loader_cache = nullptr;
+	}
 }
 
 
@@ -181,6 +205,14 @@ void MapMode::SetCommandDescriptions() {
 
 
 
+void MapMode::SetPreloadMemoryBudget(size_t budget) {
+	_preload_memory_budget = budget;
+	if (_loader_cache != nullptr)
+		_loader_cache->SetMemoryBudget(budget);
+}
+
+
+
 void MapMode::Reset() {
 	// Reset video engine context properties
 	VideoManager->SetCoordSys(0.0f, SCREEN_COLS, SCREEN_ROWS, 0.0f);
@@ -208,6 +240,7 @@ void MapMode::Update() {
 	if (_current_instance != this)
 		_current_instance = this;
 
+	_loader_cache->Update();
 	_dialogue_icon.Update();
 
 	// Process quit/pause/help events so long as we are not in the middle of a transition
@@ -452,19 +485,40 @@ void MapMode::_LoadMapFiles() {
 	_map_script.OpenTable(_script_tablespace);
 	_data_filename = _map_script.ReadString("data_file");
 
-	// ---------- (2) Open the map data file and load its contents into the appropriate supervisor classes
-	ReadScriptDescriptor map_data;
-	if (map_data.OpenFile(_data_filename) == false) {
-		PRINT_ERROR << "failed to open map data file: " << _data_filename << endl;
-		return;
+	// ---------- (2) Load the map data into the appropriate supervisor classes
+	// A compiled binary map file is used when one exists and is up to date with the map data file, since it loads
+	// much faster than executing the map data file. Otherwise the map data file is read directly. If the map was given a
+	// loader, the binary file has already been opened and its tileset images decoded on the loader's worker thread.
+	MapBinaryFile binary_data;
+	const MapBinaryFile* binary_file = nullptr;
+	string binary_filename = MakeMapBinaryFilename(_data_filename);
+	if (_loader != nullptr) {
+		_loader->Finish();
+		binary_file = _loader->GetBinaryFile();
+	}
+	else if (DoesFileExist(binary_filename) == true && binary_data.Open(binary_filename, _data_filename) == true) {
+		binary_file = &binary_data;
+	}
+
+	if (binary_file != nullptr && _tile_supervisor->Load(*binary_file, _loader) == true) {
+		IF_PRINT_DEBUG(MAP_DEBUG) << "loaded map data from binary file: " << binary_filename << endl;
+		_num_map_contexts = binary_file->GetHeader().context_count;
+		_object_supervisor->Load(*binary_file);
 	}
+	else {
+		ReadScriptDescriptor map_data;
+		if (map_data.OpenFile(_data_filename) == false) {
+			PRINT_ERROR << "failed to open map data file: " << _data_filename << endl;
+			return;
+		}
 
-	map_data.OpenTable(DetermineLuaFileTablespaceName(_data_filename));
-	_num_map_contexts = map_data.ReadUInt("number_map_contexts");
-	_tile_supervisor->Load(map_data);
-	_object_supervisor->Load(map_data);
-	map_data.CloseAllTables();
-	map_data.CloseFile();
+		map_data.OpenTable(DetermineLuaFileTablespaceName(_data_filename));
+		_num_map_contexts = map_data.ReadUInt("number_map_contexts");
+		_tile_supervisor->Load(map_data);
+		_object_supervisor->Load(map_data);
+		map_data.CloseAllTables();
+		map_data.CloseFile();
+	}
 
 	// ---------- (3) Load all necessary content from the map script file
 	// Read the map's location graphic and name
@@ -479,7 +533,10 @@ void MapMode::_LoadMapFiles() {
 
 	for (uint32 i = 0; i < sound_filenames.size(); i++) {
 		_sounds.push_back(SoundDescriptor());
-		if (_sounds.back().LoadAudio(sound_filenames[i]) == false) {
+		// Sounds that the loader decoded on its worker thread only need to have their OpenAL buffers filled
+		const private_audio::AudioMemory* decoded_sound = (_loader != nullptr) ? _loader->GetSound(sound_filenames[i]) : nullptr;
+		bool loaded = (decoded_sound != nullptr) ? _sounds.back().LoadDecodedAudio(*decoded_sound) : _sounds.back().LoadAudio(sound_filenames[i]);
+		if (loaded == false) {
 			PRINT_ERROR << "failed to load map sound: " << sound_filenames[i] << endl;
 		}
 	}
@@ -493,6 +550,12 @@ void MapMode::_LoadMapFiles() {
 		}
 	}
 
+	// Keep the loader in the cache so that returning to this map later does not need to load its resources again
+	if (_loader != nullptr) {
+		_loader_cache->Store(_loader);
+		_loader = nullptr;
+	}
+
 	// Create all of the GlobalEnemy objects for any enemy that may appear on this map
 	if (_map_script.DoesTableExist("enemy_ids") == true) {
 		vector<int32> enemy_ids;
@@ -532,11 +595,18 @@ void MapMode::_LoadMapFiles() {
 	}
 
 	_map_script.CloseAllTables();
+
+	// ---------- (6) Begin loading every map that this map can transition to in the background
+	vector<string> adjacent_maps;
+	_event_supervisor->GetTransitionMapFilenames(adjacent_maps);
+	_loader_cache->Preload(adjacent_maps);
 }
 
 
 
 void MapMode::_UpdateExplore() {
+	PROFILE_ZONE("MapMode::_UpdateExplore");
+
 	// First go to menu mode if the user requested it
 	if (InputManager->MenuPress()) {
 		MenuMode *MM = new MenuMode();
@@ -800,6 +870,17 @@ void MapMode::_DrawMapLayers() {
 
 
 
+void MapMode::DrawLight(float x, float y, float radius, const Color& color) {
+	const MapRectangle& edges = _map_frame.screen_edges;
+	if (x + radius < edges.left || x - radius > edges.right || y + radius < edges.top || y - radius > edges.bottom)
+		return;
+
+	// Lights are placed in the coordinate system of the map layers, which has its origin at the top left of the screen
+	VideoManager->DrawLight(radius, x - edges.left, y - edges.top, color);
+}
+
+
+
 void MapMode::_DrawGUI() {
 	// TODO: figure out what this color represents and create an approximate name for it
 	const Color unknown(0.0196f, 0.207f, 0.0196f, 1.0f);
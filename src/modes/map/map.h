@@ -107,8 +107,10 @@ public:
 
 	/** \param script_filename The name of the Lua file that contains all of the map scripting code
 	*** \param load_point Integer that indicates where the player is entering the map from
+	*** \param loader An optional loader that has already begun preparing the map's resources in the background.
+	*** The map takes ownership of the loader and waits for it to finish before loading the map files.
 	**/
-	MapMode(std::string script_filename, int32 load_point);
+	MapMode(std::string script_filename, int32 load_point, private_map::MapLoader* loader = nullptr);
 
 	~MapMode();
 
@@ -169,6 +171,18 @@ public:
 
     void MoveVirtualFocus(uint16 x, uint16 y, uint32 duration);
 
+	/** \brief Adds a light at a position on the map to the current frame
+	*** \param x The x coordinate of the center of the light, in map grid units
+	*** \param y The y coordinate of the center of the light, in map grid units
+	*** \param radius The radius of the light, in map grid columns
+	*** \param color The color of the light. Its alpha is the strength of the light
+	***
+	*** This must be called after the map layers have been drawn, usually from the Draw() function of the map script,
+	*** so that the coordinate system of the map layers is active. The light only has a visible effect when the light
+	*** overlay is enabled.
+	**/
+	void DrawLight(float x, float y, float radius, const hoa_video::Color& color);
+
 	//! \brief Returns true if the player may enter a battle upon colliding with an enemy sprite
     bool AttackAllowed()
 		{ return (CurrentState() != private_map::STATE_DIALOGUE && CurrentState() != private_map::STATE_TREASURE && !IsCameraOnVirtualFocus()); }
@@ -178,6 +192,15 @@ public:
 	static MapMode* CurrentInstance()
 		{ return _current_instance; }
 
+	//! \brief Returns the cache of maps loaded in the background, or nullptr if no map currently exists
+	static private_map::MapLoaderCache* GetLoaderCache()
+		{ return _loader_cache; }
+
+	/** \brief Sets the maximum amount of memory that maps preloaded in the background may occupy
+	*** \param budget The memory budget in bytes. A value of zero disables preloading.
+	**/
+	static void SetPreloadMemoryBudget(size_t budget);
+
 	const hoa_utils::ustring& GetMapName() const
 		{ return _map_name; }
 
@@ -306,6 +329,17 @@ private:
 	**/
 	static MapMode* _current_instance;
 
+	/** \brief Holds the resources of maps adjacent to the current map, loaded in the background
+	*** The cache is shared by all map instances. It is created along with the first map and destroyed along with the last.
+	**/
+	static private_map::MapLoaderCache* _loader_cache;
+
+	//! \brief The number of MapMode objects that currently exist
+	static uint32 _instance_count;
+
+	//! \brief The memory budget to give the loader cache when it is created
+	static size_t _preload_memory_budget;
+
 	//! \brief The name of the Lua file that holds the map data
 	std::string _data_filename;
 
@@ -349,6 +383,9 @@ private:
 	//! \brief Instance of helper class to map mode. Responsible for tile related operations.
 	private_map::TileSupervisor* _tile_supervisor;
 
+	//! \brief The background loader for the map's resources, if one was given. Returned to the loader cache once the map files are loaded.
+	private_map::MapLoader* _loader;
+
 	//! \brief Assistant that helps manage transitions between map contexts and to different game modes
 	private_map::TransitionSupervisor* _transition_supervisor;
 
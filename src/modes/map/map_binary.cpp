@@ -0,0 +1,568 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    map_binary.cpp
+*** \author  agent
+*** \brief   Source file for the compiled binary map data format
+*** ***************************************************************************/
+
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+// Allacrost engines
+#include "script.h"
+
+// Local map mode headers
+#include "map_binary.h"
+
+using namespace std;
+using namespace hoa_utils;
+using namespace hoa_script;
+
+namespace hoa_map {
+
+namespace private_map {
+
+//! \brief Returns the given offset rounded up to the next multiple of four bytes
+static uint32 _AlignOffset(uint32 offset) {
+	return (offset + 3) & ~static_cast<uint32>(3);
+}
+
+
+
+//! \brief Replaces the ".lua" extension of a filename, or appends the new extension if the filename has no such extension
+static string _ReplaceLuaExtension(const string& filename, const string& extension) {
+	size_t position = filename.rfind(".lua");
+	if (position == string::npos || position != filename.length() - 4) {
+		return filename + extension;
+	}
+
+	return filename.substr(0, position) + extension;
+}
+
+
+
+/** \brief Reads a length prefixed string that was written by _WriteString()
+*** \param data The file data
+*** \param end The offset to the end of the section that the string must lie within
+*** \param offset The offset of the string, which is advanced past the string and its padding
+*** \param text Set to the string that was read
+*** \return False if the string extends beyond the end of its section
+**/
+static bool _ReadString(const uint8* data, uint32 end, uint32& offset, string& text) {
+	if (static_cast<uint64_t>(offset) + sizeof(uint32) > end)
+		return false;
+
+	uint32 length = *reinterpret_cast<const uint32*>(data + offset);
+	offset += sizeof(uint32);
+	if (static_cast<uint64_t>(offset) + length > end)
+		return false;
+
+	text.assign(reinterpret_cast<const char*>(data + offset), length);
+	offset = _AlignOffset(offset + length);
+	return true;
+}
+
+
+
+//! \brief Appends a string to the output as a uint32 length followed by the characters, padded to four bytes
+static void _WriteString(vector<uint8>& output, const string& text) {
+	uint32 length = text.length();
+	size_t offset = output.size();
+	output.resize(_AlignOffset(offset + sizeof(uint32) + length), 0);
+	memcpy(&output[offset], &length, sizeof(uint32));
+	memcpy(&output[offset + sizeof(uint32)], text.c_str(), length);
+}
+
+// ****************************************************************************
+// ***** MapBinaryFile class methods
+// ****************************************************************************
+
+MapBinaryFile::MapBinaryFile() :
+	_data(nullptr),
+	_size(0),
+	_mapped(false)
+{}
+
+
+
+MapBinaryFile::~MapBinaryFile() {
+	Close();
+}
+
+
+
+bool MapBinaryFile::Open(const string& binary_filename, const string& source_filename) {
+	Close();
+
+	uint32 source_checksum = 0;
+	uint32 source_size = 0;
+	if (ComputeFileChecksum(source_filename, source_checksum, source_size) == false) {
+		PRINT_WARNING << "could not read the map data file that the binary file is compiled from: " << source_filename << endl;
+		return false;
+	}
+
+#ifndef _WIN32
+	int file_descriptor = open(binary_filename.c_str(), O_RDONLY);
+	if (file_descriptor < 0) {
+		return false;
+	}
+
+	struct stat file_status;
+	if (fstat(file_descriptor, &file_status) != 0 || file_status.st_size < static_cast<off_t>(sizeof(MapBinaryHeader))) {
+		close(file_descriptor);
+		PRINT_WARNING << "binary map file was too small to be valid: " << binary_filename << endl;
+		return false;
+	}
+
+	_size = static_cast<size_t>(file_status.st_size);
+	void* mapping = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+	close(file_descriptor);
+	if (mapping == MAP_FAILED) {
+		PRINT_WARNING << "failed to memory map binary map file: " << binary_filename << endl;
+		_size = 0;
+		return false;
+	}
+	_data = static_cast<const uint8*>(mapping);
+	_mapped = true;
+#else
+	ifstream file(binary_filename.c_str(), ios::in | ios::binary);
+	if (file.fail()) {
+		return false;
+	}
+
+	file.seekg(0, ios::end);
+	_size = static_cast<size_t>(file.tellg());
+	file.seekg(0, ios::beg);
+	if (_size < sizeof(MapBinaryHeader)) {
+		PRINT_WARNING << "binary map file was too small to be valid: " << binary_filename << endl;
+		_size = 0;
+		return false;
+	}
+
+	_buffer.resize(_size);
+	file.read(reinterpret_cast<char*>(&_buffer[0]), _size);
+	if (file.fail()) {
+		PRINT_WARNING << "failed to read binary map file: " << binary_filename << endl;
+		_buffer.clear();
+		_size = 0;
+		return false;
+	}
+	_data = &_buffer[0];
+	_mapped = false;
+#endif
+
+	if (_Validate() == false) {
+		PRINT_WARNING << "binary map file was malformed or of an unsupported version: " << binary_filename << endl;
+		Close();
+		return false;
+	}
+
+	const MapBinaryHeader& header = GetHeader();
+	if (header.source_checksum != source_checksum || header.source_size != source_size) {
+		PRINT_WARNING << "binary map file is out of date with its map data file and will not be used: " << binary_filename << endl;
+		Close();
+		return false;
+	}
+
+	return true;
+} // bool MapBinaryFile::Open(const string& binary_filename, const string& source_filename)
+
+
+
+void MapBinaryFile::Close() {
+	if (_data != nullptr && _mapped == true) {
+#ifndef _WIN32
+		munmap(const_cast<uint8*>(_data), _size);
+#endif
+	}
+
+	_data = nullptr;
+	_size = 0;
+	_mapped = false;
+	_buffer.clear();
+	_tileset_filenames.clear();
+}
+
+
+
+bool MapBinaryFile::_Validate() {
+	const MapBinaryHeader& header = GetHeader();
+
+	if (memcmp(header.magic, MAP_BINARY_MAGIC, sizeof(MAP_BINARY_MAGIC)) != 0 || header.version != MAP_BINARY_VERSION ||
+		header.byte_order != MAP_BINARY_BYTE_ORDER || header.file_size != _size)
+	{
+		return false;
+	}
+
+	// Each context is a single bit of a MAP_CONTEXT value, so a map has between 1 and 32 contexts
+	if (header.context_count == 0 || header.context_count > 32)
+		return false;
+
+	// Every section must lie within the file and be large enough to hold the data that the header declares
+	uint64_t tile_count = static_cast<uint64_t>(header.context_count) * header.tile_layer_count * header.row_count * header.column_count;
+	uint64_t collision_count = static_cast<uint64_t>(header.collision_row_count) * header.collision_column_count;
+	if (header.inheritance_offset + static_cast<uint64_t>(header.context_count) * sizeof(int32) > _size ||
+		header.tile_offset + tile_count * sizeof(int16) > _size ||
+		header.collision_offset + collision_count * sizeof(uint32) > _size)
+	{
+		return false;
+	}
+
+	if (header.tileset_offset < sizeof(MapBinaryHeader) || header.tileset_offset > header.inheritance_offset)
+		return false;
+
+	if (header.inheritance_offset % 4 != 0 || header.tile_offset % 4 != 0 || header.collision_offset % 4 != 0)
+		return false;
+
+	// Contexts inherit from a context numbered 1..context_count, or from no context when the value is zero
+	const int32* inheritance = GetContextInheritance();
+	for (uint32 i = 0; i < header.context_count; ++i) {
+		if (inheritance[i] < 0 || inheritance[i] > static_cast<int32>(header.context_count))
+			return false;
+	}
+
+	// Read in the tileset filenames, making sure that none of them extend beyond the end of their section
+	uint32 offset = header.tileset_offset;
+	string filename;
+	for (uint32 i = 0; i < header.tileset_count; ++i) {
+		if (_ReadString(_data, header.inheritance_offset, offset, filename) == false)
+			return false;
+		_tileset_filenames.push_back(filename);
+	}
+
+	return true;
+} // bool MapBinaryFile::_Validate()
+
+// ****************************************************************************
+// ***** MapPreloadFile class methods
+// ****************************************************************************
+
+bool MapPreloadFile::Open(const string& preload_filename, const string& source_filename) {
+	_data_filename.clear();
+	_sound_filenames.clear();
+	_music_filenames.clear();
+	_image_filenames.clear();
+
+	ifstream file(preload_filename.c_str(), ios::in | ios::binary);
+	if (file.fail()) {
+		return false;
+	}
+
+	file.seekg(0, ios::end);
+	size_t size = static_cast<size_t>(file.tellg());
+	file.seekg(0, ios::beg);
+	if (size < sizeof(MapPreloadHeader)) {
+		PRINT_WARNING << "map preload file was too small to be valid: " << preload_filename << endl;
+		return false;
+	}
+
+	vector<uint8> data(size);
+	file.read(reinterpret_cast<char*>(&data[0]), size);
+	if (file.fail()) {
+		PRINT_WARNING << "failed to read map preload file: " << preload_filename << endl;
+		return false;
+	}
+
+	MapPreloadHeader header;
+	memcpy(&header, &data[0], sizeof(header));
+	if (memcmp(header.magic, MAP_PRELOAD_MAGIC, sizeof(MAP_PRELOAD_MAGIC)) != 0 || header.version != MAP_PRELOAD_VERSION ||
+		header.byte_order != MAP_BINARY_BYTE_ORDER || header.file_size != size)
+	{
+		PRINT_WARNING << "map preload file was malformed or of an unsupported version: " << preload_filename << endl;
+		return false;
+	}
+
+	uint32 source_checksum = 0;
+	uint32 source_size = 0;
+	if (ComputeFileChecksum(source_filename, source_checksum, source_size) == false ||
+		header.source_checksum != source_checksum || header.source_size != source_size)
+	{
+		PRINT_WARNING << "map preload file is out of date with its map script and will not be used: " << preload_filename << endl;
+		return false;
+	}
+
+	// Every string holds at least its length, which bounds the counts before any memory is reserved for them
+	uint32 end = header.file_size;
+	if ((static_cast<uint64_t>(header.sound_count) + header.music_count + header.image_count + 1) * sizeof(uint32) > end) {
+		PRINT_WARNING << "map preload file was malformed: " << preload_filename << endl;
+		return false;
+	}
+
+	uint32 offset = _AlignOffset(sizeof(MapPreloadHeader));
+	bool valid = _ReadString(&data[0], end, offset, _data_filename);
+	_sound_filenames.resize(header.sound_count);
+	for (uint32 i = 0; i < header.sound_count && valid == true; ++i)
+		valid = _ReadString(&data[0], end, offset, _sound_filenames[i]);
+	_music_filenames.resize(header.music_count);
+	for (uint32 i = 0; i < header.music_count && valid == true; ++i)
+		valid = _ReadString(&data[0], end, offset, _music_filenames[i]);
+	_image_filenames.resize(header.image_count);
+	for (uint32 i = 0; i < header.image_count && valid == true; ++i)
+		valid = _ReadString(&data[0], end, offset, _image_filenames[i]);
+
+	if (valid == false) {
+		PRINT_WARNING << "map preload file was malformed: " << preload_filename << endl;
+		_data_filename.clear();
+		_sound_filenames.clear();
+		_music_filenames.clear();
+		_image_filenames.clear();
+		return false;
+	}
+
+	return true;
+} // bool MapPreloadFile::Open(const string& preload_filename, const string& source_filename)
+
+// ****************************************************************************
+// ***** Binary map functions
+// ****************************************************************************
+
+string MakeMapBinaryFilename(const string& source_filename) {
+	return _ReplaceLuaExtension(source_filename, MAP_BINARY_EXTENSION);
+}
+
+
+
+bool CompileMapBinaryFile(const string& source_filename, const string& binary_filename) {
+	MapBinaryHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MAP_BINARY_MAGIC, sizeof(MAP_BINARY_MAGIC));
+	header.version = MAP_BINARY_VERSION;
+	header.byte_order = MAP_BINARY_BYTE_ORDER;
+
+	if (ComputeFileChecksum(source_filename, header.source_checksum, header.source_size) == false) {
+		PRINT_ERROR << "failed to read map data file: " << source_filename << endl;
+		return false;
+	}
+
+	// ---------- (1) Read all of the data from the map data file
+	ReadScriptDescriptor map_file;
+	if (map_file.OpenFile(source_filename) == false) {
+		PRINT_ERROR << "failed to open map data file: " << source_filename << endl;
+		return false;
+	}
+	map_file.OpenTable(DetermineLuaFileTablespaceName(source_filename));
+
+	header.row_count = map_file.ReadUInt("map_height");
+	header.column_count = map_file.ReadUInt("map_length");
+	header.tileset_count = map_file.ReadUInt("number_tilesets");
+	header.tile_layer_count = map_file.ReadUInt("number_tile_layers");
+	header.context_count = map_file.ReadUInt("number_map_contexts");
+
+	vector<string> tileset_filenames;
+	map_file.ReadStringVector("tileset_filenames", tileset_filenames);
+	vector<int32> context_inheritance;
+	map_file.ReadIntVector("map_context_inheritance", context_inheritance);
+
+	if (tileset_filenames.size() != header.tileset_count || context_inheritance.size() != header.context_count) {
+		PRINT_ERROR << "the tileset or context count declared does not match the contents of the map data file: " << source_filename << endl;
+		map_file.CloseFile();
+		return false;
+	}
+
+	if (map_file.GetTableSize("map_tiles") != header.row_count) {
+		PRINT_ERROR << "the map_tiles table size was not equal to the number of tile rows specified by the map: " << source_filename << endl;
+		map_file.CloseFile();
+		return false;
+	}
+
+	// The tile data is stored in the map file by [row][col][context][layer] and is rearranged into [context][layer][row][col]
+	uint32 layer_size = header.row_count * header.column_count;
+	uint32 tiles_per_location = header.context_count * header.tile_layer_count;
+	vector<int16> tile_data(tiles_per_location * layer_size, -1);
+	vector<int32> tile_values;
+	map_file.OpenTable("map_tiles");
+	for (uint32 r = 0; r < header.row_count; ++r) {
+		map_file.OpenTable(r);
+		for (uint32 c = 0; c < header.column_count; ++c) {
+			tile_values.clear();
+			map_file.ReadIntVector(c, tile_values);
+			if (tile_values.size() != tiles_per_location) {
+				PRINT_ERROR << "incorrect number of tile values at row " << r << ", column " << c << " of map data file: " << source_filename << endl;
+				map_file.CloseFile();
+				return false;
+			}
+
+			for (uint32 i = 0; i < tiles_per_location; ++i) {
+				tile_data[i * layer_size + r * header.column_count + c] = static_cast<int16>(tile_values[i]);
+			}
+		}
+		map_file.CloseTable();
+	}
+	map_file.CloseTable();
+
+	vector<uint32> collision_data;
+	vector<uint32> collision_row;
+	header.collision_row_count = map_file.GetTableSize("collision_grid");
+	map_file.OpenTable("collision_grid");
+	for (uint32 r = 0; r < header.collision_row_count; ++r) {
+		collision_row.clear();
+		map_file.ReadUIntVector(r, collision_row);
+		if (r == 0) {
+			header.collision_column_count = collision_row.size();
+		}
+		else if (collision_row.size() != header.collision_column_count) {
+			PRINT_ERROR << "collision grid rows were not of equal length in map data file: " << source_filename << endl;
+			map_file.CloseFile();
+			return false;
+		}
+		collision_data.insert(collision_data.end(), collision_row.begin(), collision_row.end());
+	}
+	map_file.CloseTable();
+
+	if (map_file.IsErrorDetected()) {
+		PRINT_ERROR << "errors occurred while reading map data file: " << source_filename << endl << map_file.GetErrorMessages() << endl;
+		map_file.CloseFile();
+		return false;
+	}
+	map_file.CloseFile();
+
+	// ---------- (2) Determine the layout of the binary file
+	header.tileset_offset = _AlignOffset(sizeof(MapBinaryHeader));
+	uint32 offset = header.tileset_offset;
+	for (uint32 i = 0; i < tileset_filenames.size(); ++i) {
+		offset = _AlignOffset(offset + sizeof(uint32) + tileset_filenames[i].length());
+	}
+	header.inheritance_offset = offset;
+	header.tile_offset = _AlignOffset(header.inheritance_offset + context_inheritance.size() * sizeof(int32));
+	header.collision_offset = _AlignOffset(header.tile_offset + tile_data.size() * sizeof(int16));
+	header.file_size = header.collision_offset + collision_data.size() * sizeof(uint32);
+
+	// ---------- (3) Write each section of the file
+	vector<uint8> output(header.file_size, 0);
+	memcpy(&output[0], &header, sizeof(header));
+	offset = header.tileset_offset;
+	for (uint32 i = 0; i < tileset_filenames.size(); ++i) {
+		uint32 length = tileset_filenames[i].length();
+		memcpy(&output[offset], &length, sizeof(uint32));
+		memcpy(&output[offset + sizeof(uint32)], tileset_filenames[i].c_str(), length);
+		offset = _AlignOffset(offset + sizeof(uint32) + length);
+	}
+	if (context_inheritance.empty() == false)
+		memcpy(&output[header.inheritance_offset], &context_inheritance[0], context_inheritance.size() * sizeof(int32));
+	if (tile_data.empty() == false)
+		memcpy(&output[header.tile_offset], &tile_data[0], tile_data.size() * sizeof(int16));
+	if (collision_data.empty() == false)
+		memcpy(&output[header.collision_offset], &collision_data[0], collision_data.size() * sizeof(uint32));
+
+	ofstream file(binary_filename.c_str(), ios::out | ios::binary | ios::trunc);
+	if (file.fail()) {
+		PRINT_ERROR << "failed to open binary map file for writing: " << binary_filename << endl;
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(&output[0]), output.size());
+	file.close();
+	if (file.fail()) {
+		PRINT_ERROR << "failed to write binary map file: " << binary_filename << endl;
+		return false;
+	}
+
+	return true;
+} // bool CompileMapBinaryFile(const string& source_filename, const string& binary_filename)
+
+
+
+string MakeMapPreloadFilename(const string& script_filename) {
+	return _ReplaceLuaExtension(script_filename, MAP_PRELOAD_EXTENSION);
+}
+
+
+
+bool CompileMapPreloadFile(const string& script_filename, const string& preload_filename) {
+	MapPreloadHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MAP_PRELOAD_MAGIC, sizeof(MAP_PRELOAD_MAGIC));
+	header.version = MAP_PRELOAD_VERSION;
+	header.byte_order = MAP_BINARY_BYTE_ORDER;
+
+	if (ComputeFileChecksum(script_filename, header.source_checksum, header.source_size) == false) {
+		PRINT_ERROR << "failed to read map script: " << script_filename << endl;
+		return false;
+	}
+
+	// ---------- (1) Read the names of the map data file and audio files from the map script
+	ReadScriptDescriptor map_script;
+	if (map_script.OpenFile(script_filename) == false) {
+		PRINT_ERROR << "failed to open map script: " << script_filename << endl;
+		return false;
+	}
+	map_script.OpenTable(DetermineLuaFileTablespaceName(script_filename));
+	string data_filename = map_script.ReadString("data_file");
+	vector<string> sound_filenames;
+	map_script.ReadStringVector("sound_filenames", sound_filenames);
+	vector<string> music_filenames;
+	map_script.ReadStringVector("music_filenames", music_filenames);
+	bool script_error = map_script.IsErrorDetected();
+	map_script.CloseFile();
+	if (script_error == true || data_filename.empty() == true) {
+		PRINT_ERROR << "failed to read the data and audio filenames from map script: " << script_filename << endl;
+		return false;
+	}
+
+	// ---------- (2) Read the image filename of every tileset from the tileset definition files of the map data file
+	ReadScriptDescriptor map_file;
+	if (map_file.OpenFile(data_filename) == false) {
+		PRINT_ERROR << "failed to open map data file: " << data_filename << endl;
+		return false;
+	}
+	map_file.OpenTable(DetermineLuaFileTablespaceName(data_filename));
+	vector<string> tileset_filenames;
+	map_file.ReadStringVector("tileset_filenames", tileset_filenames);
+	map_file.CloseFile();
+
+	vector<string> image_filenames;
+	for (uint32 i = 0; i < tileset_filenames.size(); ++i) {
+		ReadScriptDescriptor definition_file;
+		if (definition_file.OpenFile(tileset_filenames[i]) == false) {
+			PRINT_ERROR << "failed to open tileset definition file: " << tileset_filenames[i] << endl;
+			return false;
+		}
+		definition_file.OpenTable(DetermineLuaFileTablespaceName(tileset_filenames[i]));
+		image_filenames.push_back(definition_file.ReadString("image"));
+		definition_file.CloseFile();
+	}
+
+	// ---------- (3) Write the header followed by every filename
+	header.sound_count = sound_filenames.size();
+	header.music_count = music_filenames.size();
+	header.image_count = image_filenames.size();
+
+	vector<uint8> output(_AlignOffset(sizeof(MapPreloadHeader)), 0);
+	_WriteString(output, data_filename);
+	for (uint32 i = 0; i < sound_filenames.size(); ++i)
+		_WriteString(output, sound_filenames[i]);
+	for (uint32 i = 0; i < music_filenames.size(); ++i)
+		_WriteString(output, music_filenames[i]);
+	for (uint32 i = 0; i < image_filenames.size(); ++i)
+		_WriteString(output, image_filenames[i]);
+	header.file_size = output.size();
+	memcpy(&output[0], &header, sizeof(header));
+
+	ofstream file(preload_filename.c_str(), ios::out | ios::binary | ios::trunc);
+	if (file.fail()) {
+		PRINT_ERROR << "failed to open map preload file for writing: " << preload_filename << endl;
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(&output[0]), output.size());
+	file.close();
+	if (file.fail()) {
+		PRINT_ERROR << "failed to write map preload file: " << preload_filename << endl;
+		return false;
+	}
+
+	return true;
+} // bool CompileMapPreloadFile(const string& script_filename, const string& preload_filename)
+
+} // namespace private_map
+
+} // namespace hoa_map
@@ -0,0 +1,288 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    map_binary.h
+*** \author  agent
+*** \brief   Header file for the compiled binary map data format
+***
+*** Map data files (lua/data/maps/\*.lua) are the source of truth for the tile
+*** and collision data of every map, but they are large and executing them in
+*** the Lua interpreter makes up most of the time spent loading a map. This code
+*** compiles the contents of a map data file into a binary container that can be
+*** memory mapped and read directly by the map mode supervisors.
+***
+*** The binary file contains the following sections, each aligned to four bytes:
+***
+*** -# The header (MapBinaryHeader)
+*** -# The tileset definition filenames, each stored as a uint32 length followed by the characters
+*** -# The context inheritance table (int32 per context, with the same values as the map data file)
+*** -# The packed tile layers (int16 per tile, indexed by [context][layer][row][col])
+*** -# The collision grid (uint32 per grid element, indexed by [row][col])
+***
+*** The header records a checksum and the size of the map data file that the
+*** binary was compiled from. A binary file whose checksum no longer matches
+*** its source file is considered stale and is rejected.
+***
+*** Map scripts (lua/scripts/maps/\*.lua) are compiled into a second, much
+*** smaller file: the preload file. It lists the map data file, the sound and
+*** music files, and the tileset images that the map uses, so that a map can
+*** be loaded in the background without executing any Lua code. It consists of
+*** a header (MapPreloadHeader) followed by those filenames, stored in the same
+*** way as the tileset filenames of the binary map file.
+***
+*** \note This file is also compiled into the allacrost-mapc tool and therefore
+*** must not depend on any engine other than the script engine.
+*** ***************************************************************************/
+
+#pragma once
+
+#include "utils.h"
+#include "defs.h"
+
+namespace hoa_map {
+
+namespace private_map {
+
+//! \brief The four characters that every binary map file begins with
+const char MAP_BINARY_MAGIC[4] = { 'H', 'O', 'A', 'M' };
+
+//! \brief The version of the binary map format. This must be incremented whenever the layout of the format changes
+const uint32 MAP_BINARY_VERSION = 1;
+
+//! \brief Written to every header in native byte order so that files compiled on a machine of different endianness are rejected
+const uint32 MAP_BINARY_BYTE_ORDER = 0x01020304;
+
+//! \brief The filename extension given to binary map files
+const std::string MAP_BINARY_EXTENSION = ".mapc";
+
+//! \brief The four characters that every map preload file begins with
+const char MAP_PRELOAD_MAGIC[4] = { 'H', 'O', 'A', 'P' };
+
+//! \brief The version of the map preload format. This must be incremented whenever the layout of the format changes
+const uint32 MAP_PRELOAD_VERSION = 2;
+
+//! \brief The filename extension given to map preload files
+const std::string MAP_PRELOAD_EXTENSION = ".mapp";
+
+/** ****************************************************************************
+*** \brief The header found at the beginning of every binary map file
+***
+*** All offsets are measured in bytes from the beginning of the file.
+*** ***************************************************************************/
+class MapBinaryHeader {
+public:
+	char magic[4];
+	uint32 version;
+	uint32 byte_order;
+
+	//! \brief The checksum and size of the map data file that the binary was compiled from
+	uint32 source_checksum, source_size;
+
+	//! \brief The number of rows and columns of tiles in the map
+	uint32 row_count, column_count;
+
+	uint32 tileset_count;
+	uint32 tile_layer_count;
+	uint32 context_count;
+
+	//! \brief The number of rows and columns in the collision grid (twice the number of tile rows and columns)
+	uint32 collision_row_count, collision_column_count;
+
+	//! \brief The offsets to the beginning of each section of the file
+	uint32 tileset_offset, inheritance_offset, tile_offset, collision_offset;
+
+	//! \brief The total size of the file, used to detect truncated files
+	uint32 file_size;
+}; // class MapBinaryHeader
+
+
+/** ****************************************************************************
+*** \brief A read-only view of a binary map file
+***
+*** On platforms that support it the file is memory mapped, so opening the file
+*** costs little more than validating the header. The pointers returned by the
+*** accessor methods refer directly to the mapped data and remain valid until
+*** the object is closed or destroyed.
+*** ***************************************************************************/
+class MapBinaryFile {
+public:
+	MapBinaryFile();
+
+	~MapBinaryFile();
+
+	/** \brief Opens a binary map file and validates its contents
+	*** \param binary_filename The name of the binary file to open
+	*** \param source_filename The name of the map data file that the binary file should have been compiled from
+	*** \return True if the file was opened and is valid, false if it is missing, malformed, or stale
+	**/
+	bool Open(const std::string& binary_filename, const std::string& source_filename);
+
+	//! \brief Releases the file data. Called automatically by the destructor
+	void Close();
+
+	bool IsOpen() const
+		{ return _data != nullptr; }
+
+	//! \name Class Member Accessor Methods
+	//@{
+	const MapBinaryHeader& GetHeader() const
+		{ return *reinterpret_cast<const MapBinaryHeader*>(_data); }
+
+	const std::vector<std::string>& GetTilesetFilenames() const
+		{ return _tileset_filenames; }
+
+	//! \brief Returns the context inheritance table, containing GetHeader().context_count elements
+	const int32* GetContextInheritance() const
+		{ return reinterpret_cast<const int32*>(_data + GetHeader().inheritance_offset); }
+
+	//! \brief Returns the packed tile layers of all contexts
+	const int16* GetTileData() const
+		{ return reinterpret_cast<const int16*>(_data + GetHeader().tile_offset); }
+
+	//! \brief Returns the collision grid, stored one row after the other
+	const uint32* GetCollisionData() const
+		{ return reinterpret_cast<const uint32*>(_data + GetHeader().collision_offset); }
+	//@}
+
+private:
+	//! \brief A pointer to the beginning of the file data
+	const uint8* _data;
+
+	//! \brief The size of the file data, in bytes
+	size_t _size;
+
+	//! \brief True if _data points to mapped memory, false if it points into _buffer
+	bool _mapped;
+
+	//! \brief Holds the file data on platforms where the file can not be memory mapped
+	std::vector<uint8> _buffer;
+
+	//! \brief The tileset definition filenames read from the file
+	std::vector<std::string> _tileset_filenames;
+
+	/** \brief Checks that the header and all sections of the file are consistent with one another
+	*** \return True if the file data is valid
+	***
+	*** The context count and the context inheritance table are also checked, since both are used as shift amounts
+	*** when the contexts of the map are created.
+	**/
+	bool _Validate();
+}; // class MapBinaryFile
+
+
+/** ****************************************************************************
+*** \brief The header found at the beginning of every map preload file
+***
+*** The header is followed by the name of the map data file, then sound_count
+*** sound filenames, then music_count music filenames, then image_count tileset
+*** image filenames.
+*** ***************************************************************************/
+class MapPreloadHeader {
+public:
+	char magic[4];
+	uint32 version;
+	uint32 byte_order;
+
+	//! \brief The checksum and size of the map script that the preload file was compiled from
+	uint32 source_checksum, source_size;
+
+	//! \brief The number of sound, music, and tileset image filenames in the file
+	uint32 sound_count, music_count, image_count;
+
+	//! \brief The total size of the file, used to detect truncated files
+	uint32 file_size;
+}; // class MapPreloadHeader
+
+
+/** ****************************************************************************
+*** \brief Reads the names of the files that a map uses from a map preload file
+***
+*** Unlike MapBinaryFile, the file is small and is read in full when it is opened.
+*** This class does not use the script engine, so it may be used by any thread.
+*** ***************************************************************************/
+class MapPreloadFile {
+public:
+	MapPreloadFile()
+		{}
+
+	~MapPreloadFile()
+		{}
+
+	/** \brief Reads a map preload file and validates its contents
+	*** \param preload_filename The name of the preload file to read
+	*** \param source_filename The name of the map script that the preload file should have been compiled from
+	*** \return True if the file was read and is valid, false if it is missing, malformed, or stale
+	**/
+	bool Open(const std::string& preload_filename, const std::string& source_filename);
+
+	//! \name Class Member Accessor Methods
+	//@{
+	const std::string& GetDataFilename() const
+		{ return _data_filename; }
+
+	const std::vector<std::string>& GetSoundFilenames() const
+		{ return _sound_filenames; }
+
+	const std::vector<std::string>& GetMusicFilenames() const
+		{ return _music_filenames; }
+
+	const std::vector<std::string>& GetImageFilenames() const
+		{ return _image_filenames; }
+	//@}
+
+private:
+	//! \brief The name of the map data file
+	std::string _data_filename;
+
+	//! \brief The filenames of all sound files used by the map
+	std::vector<std::string> _sound_filenames;
+
+	//! \brief The filenames of all music files used by the map
+	std::vector<std::string> _music_filenames;
+
+	//! \brief The filenames of the images of every tileset used by the map
+	std::vector<std::string> _image_filenames;
+}; // class MapPreloadFile
+
+
+/** \brief Returns the name of the binary map file that corresponds to a map data file
+*** \param source_filename The name of the map data file, such as "lua/data/maps/harrvah_capital.lua"
+*** \return The binary filename, such as "lua/data/maps/harrvah_capital.mapc"
+**/
+std::string MakeMapBinaryFilename(const std::string& source_filename);
+
+/** \brief Compiles a map data file into a binary map file
+*** \param source_filename The name of the map data file to compile
+*** \param binary_filename The name of the binary file to write
+*** \return True if the binary file was written successfully
+***
+*** \note The script engine must be initialized prior to calling this function.
+**/
+bool CompileMapBinaryFile(const std::string& source_filename, const std::string& binary_filename);
+
+/** \brief Returns the name of the map preload file that corresponds to a map script
+*** \param script_filename The name of the map script, such as "lua/scripts/maps/harrvah_capital.lua"
+*** \return The preload filename, such as "lua/scripts/maps/harrvah_capital.mapp"
+**/
+std::string MakeMapPreloadFilename(const std::string& script_filename);
+
+/** \brief Compiles a map script into a map preload file
+*** \param script_filename The name of the map script to compile
+*** \param preload_filename The name of the preload file to write
+*** \return True if the preload file was written successfully
+***
+*** \note The script engine must be initialized prior to calling this function. The map data file and tileset
+*** definition files that the map script refers to are also read.
+**/
+bool CompileMapPreloadFile(const std::string& script_filename, const std::string& preload_filename);
+
+} // namespace private_map
+
+} // namespace hoa_map
@@ -16,6 +16,7 @@
 // Allacrost engines
 #include "audio.h"
 #include "mode_manager.h"
+#include "profiler.h"
 #include "script.h"
 #include "system.h"
 #include "video.h"
@@ -23,6 +24,7 @@
 // Local map mode headers
 #include "map.h"
 #include "map_events.h"
+#include "map_loader.h"
 #include "map_objects.h"
 #include "map_sprites.h"
 #include "map_transition.h"
@@ -285,13 +287,23 @@ bool SoundEvent::_Update() {
 MapTransitionEvent::MapTransitionEvent(uint32 event_id, string filename, int32 load_point) :
 	MapEvent(event_id, MAP_TRANSITION_EVENT),
 	_transition_map_filename(filename),
-	_transition_map_load_point(load_point)
+	_transition_map_load_point(load_point),
+	_loader(nullptr)
 {
 	_fade_timer.Initialize(MAP_FADE_OUT_TIME, SYSTEM_TIMER_NO_LOOPS);
 }
 
 
 
+MapTransitionEvent::~MapTransitionEvent() {
+	if (_loader != nullptr) {
+		delete _loader;
+		_loader = nullptr;
+	}
+}
+
+
+
 MapTransitionEvent* MapTransitionEvent::Create(uint32 event_id, string filename, int32 load_point) {
 	MapTransitionEvent* event = new MapTransitionEvent(event_id, filename, load_point);
 	MapMode::CurrentInstance()->GetEventSupervisor()->RegisterEvent(event);
@@ -325,6 +337,19 @@ void MapTransitionEvent::_Start() {
 	VideoManager->FadeScreen(Color::black, _fade_timer.GetDuration());
 
 	// TODO: fade out the map music
+
+	// Use the loader from the cache if the map was preloaded. Otherwise begin preparing the new map while the screen fades out.
+	// If the loader can not be started, the new map loads everything itself.
+	if (_loader != nullptr)
+		delete _loader;
+	_loader = MapMode::GetLoaderCache()->Retrieve(_transition_map_filename);
+	if (_loader == nullptr) {
+		_loader = new MapLoader(_transition_map_filename);
+		if (_loader->Start() == false) {
+			delete _loader;
+			_loader = nullptr;
+		}
+	}
 }
 
 
@@ -333,9 +358,16 @@ bool MapTransitionEvent::_Update() {
 	_fade_timer.Update();
 
 	if (_fade_timer.IsFinished() == true) {
+		// Keep the screen faded out until the loader has finished its work
+		if (_loader != nullptr && _loader->IsFinished() == false)
+			return false;
+
 		ModeManager->Pop();
 		try {
-			MapMode *MM = new MapMode(_transition_map_filename, _transition_map_load_point);
+			// The new map takes ownership of the loader
+			MapLoader* loader = _loader;
+			_loader = nullptr;
+			MapMode *MM = new MapMode(_transition_map_filename, _transition_map_load_point, loader);
 			ModeManager->Push(MM);
 		} catch (luabind::error e) {
 			PRINT_ERROR << "Error loading map: " << _transition_map_filename << endl;
@@ -669,6 +701,8 @@ void EventSupervisor::TerminateEvent(uint32 event_id) {
 
 
 void EventSupervisor::Update() {
+	PROFILE_ZONE("EventSupervisor::Update");
+
 	// Update all launch event timers and start all events whose timers have finished
 	for (list<pair<int32, MapEvent*> >::iterator i = _launch_events.begin(); i != _launch_events.end();) {
 		i->first -= SystemManager->GetUpdateTime();
@@ -732,6 +766,19 @@ MapEvent* EventSupervisor::GetEvent(uint32 event_id) const {
 
 
 
+void EventSupervisor::GetTransitionMapFilenames(vector<string>& filenames) const {
+	for (map<uint32, MapEvent*>::const_iterator i = _all_events.begin(); i != _all_events.end(); i++) {
+		if (i->second->GetEventType() != MAP_TRANSITION_EVENT)
+			continue;
+
+		const string& filename = dynamic_cast<MapTransitionEvent*>(i->second)->GetTransitionMapFilename();
+		if (find(filenames.begin(), filenames.end(), filename) == filenames.end())
+			filenames.push_back(filename);
+	}
+}
+
+
+
 void EventSupervisor::_ExamineEventLinks(MapEvent* parent_event, bool event_start) {
 	for (uint32 i = 0; i < parent_event->_event_links.size(); i++) {
 		EventLink& link = parent_event->_event_links[i];
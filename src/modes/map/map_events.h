@@ -492,10 +492,11 @@ protected:
 *** \brief Transitions the game to a new map by fading the screen to black
 ***
 *** When this event starts, it places the map in the state STATE_TRANSITION and
-*** begins fading the screen to black. Once the screen fade is complete, it will
-*** pop the current MapMode from the game stack, constructand push the new map,
-*** and fade the screen back for the same amount of time. This means the new map
-*** will begin when the screen is still fading back in.
+*** begins fading the screen to black. While the screen fades, a MapLoader prepares
+*** the resources of the new map on a background thread. Once both the screen fade
+*** and the loader are complete, it will pop the current MapMode from the game stack,
+*** construct and push the new map, and fade the screen back for the same amount of
+*** time. This means the new map will begin when the screen is still fading back in.
 ***
 *** By default the fade time used is MAP_FADE_OUT_TIME for both fading out and fading
 *** in, and the default load point (0) will be used. These settings can both be changed
@@ -526,11 +527,13 @@ public:
 	**/
 	void SetFadeTime(uint32 fade_time);
 
+	const std::string& GetTransitionMapFilename() const
+		{ return _transition_map_filename; }
+
 protected:
 	MapTransitionEvent(uint32 event_id, std::string filneame, int32 load_point);
 
-	~MapTransitionEvent()
-		{}
+	~MapTransitionEvent();
 
 	//! \brief The filename of the map to transition to
 	std::string _transition_map_filename;
@@ -541,10 +544,13 @@ protected:
 	//! \brief A timer used for fading out the current map
 	hoa_system::SystemTimer _fade_timer;
 
-	//! \brief Begins the transition process by fading out the screen and music
+	//! \brief Loads the resources of the new map in the background while the screen fades. Ownership is passed to the new map.
+	private_map::MapLoader* _loader;
+
+	//! \brief Begins the transition process by fading out the screen and music, and starts loading the new map
 	void _Start();
 
-	//! \brief Once the fading process completes, creates the new map mode to transition to
+	//! \brief Once the fading process and loader complete, creates the new map mode to transition to
 	bool _Update();
 }; // class MapTransitionEvent : public MapEvent
 
@@ -769,6 +775,11 @@ public:
 	**/
 	MapEvent* GetEvent(uint32 event_id) const;
 
+	/** \brief Retrieves the names of all maps that the registered map transition events lead to
+	*** \param filenames A reference to a vector to store the map script filenames in. Each filename is added only once.
+	**/
+	void GetTransitionMapFilenames(std::vector<std::string>& filenames) const;
+
 private:
 	//! \brief A container for all map events, where the event's ID serves as the key to the std::map
 	std::map<uint32, MapEvent*> _all_events;
@@ -0,0 +1,385 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    map_loader.cpp
+*** \author  agent
+*** \brief   Source file for loading map resources in the background
+*** ***************************************************************************/
+
+// Allacrost engines
+#include "audio.h"
+#include "video.h"
+
+// Local map mode headers
+#include "map_loader.h"
+#include "map_utils.h"
+
+using namespace std;
+using namespace hoa_utils;
+using namespace hoa_audio;
+using namespace hoa_audio::private_audio;
+using namespace hoa_system;
+using namespace hoa_video::private_video;
+
+namespace hoa_map {
+
+namespace private_map {
+
+MapLoader::MapLoader(const string& script_filename) :
+	_script_filename(script_filename),
+	_thread(nullptr),
+	_finished_lock(nullptr),
+	_finished(false)
+{}
+
+
+
+MapLoader::~MapLoader() {
+	Finish();
+
+	if (_finished_lock != nullptr) {
+		SystemManager->DestroySemaphore(_finished_lock);
+		_finished_lock = nullptr;
+	}
+
+	for (uint32 i = 0; i < _images.size(); ++i) {
+		if (_images[i]->pixels != nullptr) {
+			free(_images[i]->pixels);
+			_images[i]->pixels = nullptr;
+		}
+		delete _images[i];
+	}
+	_images.clear();
+
+	for (uint32 i = 0; i < _sounds.size(); ++i) {
+		delete _sounds[i];
+	}
+	_sounds.clear();
+}
+
+
+
+bool MapLoader::Start() {
+	if (_thread != nullptr || _finished_lock != nullptr) {
+		IF_PRINT_WARNING(MAP_DEBUG) << "loader was already started for map: " << _script_filename << endl;
+		return false;
+	}
+
+	// Without a preload file, the names of the files that the map uses are only known by executing its Lua files. That may
+	// only be done on the main thread, so maps without a preload file are not loaded in the background at all.
+	if (DoesFileExist(MakeMapPreloadFilename(_script_filename)) == false) {
+		IF_PRINT_DEBUG(MAP_DEBUG) << "map has no preload file and will not be loaded in the background: " << _script_filename << endl;
+		return false;
+	}
+
+	_finished_lock = SystemManager->CreateSemaphore(1);
+	_thread = SDL_CreateThread(_LoadThread, "map_loader", this);
+	if (_thread == nullptr) {
+		IF_PRINT_WARNING(MAP_DEBUG) << "failed to create loader thread: " << SDL_GetError() << endl;
+		// Without a thread, do all of the work now so that the loader remains usable
+		_LoadResources();
+	}
+
+	return true;
+} // bool MapLoader::Start()
+
+
+
+bool MapLoader::IsFinished() {
+	if (_finished_lock == nullptr)
+		return true;
+
+	SystemManager->LockThread(_finished_lock);
+	bool finished = _finished;
+	SystemManager->UnlockThread(_finished_lock);
+	return finished;
+}
+
+
+
+void MapLoader::Finish() {
+	if (_thread != nullptr) {
+		SDL_WaitThread(_thread, nullptr);
+		_thread = nullptr;
+	}
+}
+
+
+
+size_t MapLoader::GetMemoryUsage() const {
+	size_t usage = sizeof(MapLoader);
+	if (_binary_file.IsOpen() == true)
+		usage += _binary_file.GetHeader().file_size;
+
+	for (uint32 i = 0; i < _images.size(); ++i) {
+		if (_images[i]->pixels != nullptr)
+			usage += _images[i]->width * _images[i]->height * (_images[i]->rgb_format ? 3 : 4);
+	}
+
+	for (uint32 i = 0; i < _sounds.size(); ++i) {
+		if (_sounds[i] != nullptr)
+			usage += _sounds[i]->GetDataSize();
+	}
+
+	return usage;
+}
+
+
+
+ImageMemory* MapLoader::GetTilesetImage(const string& filename) const {
+	for (uint32 i = 0; i < _image_filenames.size(); ++i) {
+		if (_image_filenames[i] == filename)
+			return (_images[i]->pixels != nullptr) ? _images[i] : nullptr;
+	}
+
+	return nullptr;
+}
+
+
+
+const AudioMemory* MapLoader::GetSound(const string& filename) const {
+	for (uint32 i = 0; i < _sound_filenames.size(); ++i) {
+		if (_sound_filenames[i] == filename)
+			return _sounds[i];
+	}
+
+	return nullptr;
+}
+
+
+
+void MapLoader::_LoadResources() {
+	// ---------- (1) Read the names of every file to load from the preload file and open the binary map file
+	MapPreloadFile preload_file;
+	if (preload_file.Open(MakeMapPreloadFilename(_script_filename), _script_filename) == true) {
+		_music_filenames = preload_file.GetMusicFilenames();
+		// Sounds are only decoded when they can be played, as the decoded data would otherwise never be used
+		if (AUDIO_ENABLE == true)
+			_sound_filenames = preload_file.GetSoundFilenames();
+
+		// Tileset images can only be used by a map that is loaded from a binary map file
+		const string& data_filename = preload_file.GetDataFilename();
+		string binary_filename = MakeMapBinaryFilename(data_filename);
+		if (DoesFileExist(binary_filename) == true && _binary_file.Open(binary_filename, data_filename) == true) {
+			const vector<string>& image_filenames = preload_file.GetImageFilenames();
+			for (uint32 i = 0; i < image_filenames.size(); ++i) {
+				// Tilesets in the texture atlas are loaded directly from the atlas pages, so there is nothing to decode for them
+				if (hoa_video::TextureManager->IsImageInAtlas(image_filenames[i], 16, 16) == false) {
+					_image_filenames.push_back(image_filenames[i]);
+					_images.push_back(new ImageMemory());
+				}
+			}
+		}
+	}
+
+	// ---------- (2) Decode every tileset image
+	// This is the most expensive part of loading a map that does not need to run on the main thread.
+	for (uint32 i = 0; i < _image_filenames.size(); ++i) {
+		if (_images[i]->LoadImage(_image_filenames[i]) == false) {
+			IF_PRINT_WARNING(MAP_DEBUG) << "failed to decode tileset image: " << _image_filenames[i] << endl;
+		}
+	}
+
+	// ---------- (3) Decode every sound
+	// Only the creation of the OpenAL buffers, which is done by MapMode when it loads its sounds, must run on the main thread
+	for (uint32 i = 0; i < _sound_filenames.size(); ++i) {
+		AudioInput* input = CreateAudioInput(_sound_filenames[i]);
+		if (input == nullptr) {
+			IF_PRINT_WARNING(MAP_DEBUG) << "failed to decode sound: " << _sound_filenames[i] << endl;
+			_sounds.push_back(nullptr);
+			continue;
+		}
+
+		_sounds.push_back(new AudioMemory(input));
+		delete input;
+	}
+
+	// ---------- (4) Read every music file
+	// Music is streamed and decoded a little at a time while it plays, and decoding an entire piece of music would take
+	// far more memory than it saves time. The music files are read here only to bring them into the file cache.
+	char buffer[65536];
+	for (uint32 i = 0; i < _music_filenames.size(); ++i) {
+		ifstream file(_music_filenames[i].c_str(), ios::in | ios::binary);
+		while (file.good()) {
+			file.read(buffer, sizeof(buffer));
+		}
+	}
+
+	SystemManager->LockThread(_finished_lock);
+	_finished = true;
+	SystemManager->UnlockThread(_finished_lock);
+} // void MapLoader::_LoadResources()
+
+
+
+int MapLoader::_LoadThread(void* loader) {
+	static_cast<MapLoader*>(loader)->_LoadResources();
+	return 0;
+}
+
+// -----------------------------------------------------------------------------
+// ---------- MapLoaderCache Class Methods
+// -----------------------------------------------------------------------------
+
+MapLoaderCache::MapLoaderCache() :
+	_active_loader(nullptr),
+	_memory_budget(MAP_PRELOAD_MEMORY_BUDGET),
+	_hit_count(0),
+	_miss_count(0)
+{}
+
+
+
+MapLoaderCache::~MapLoaderCache() {
+	IF_PRINT_DEBUG(MAP_DEBUG) << "map preload cache hits: " << _hit_count << ", misses: " << _miss_count << endl;
+	Clear();
+}
+
+
+
+void MapLoaderCache::Preload(const vector<string>& script_filenames) {
+	_pending_filenames.clear();
+	if (_memory_budget == 0)
+		return;
+
+	for (uint32 i = 0; i < script_filenames.size(); ++i) {
+		if (_FindLoader(script_filenames[i]) == _loaders.end())
+			_pending_filenames.push_back(script_filenames[i]);
+	}
+}
+
+
+
+MapLoader* MapLoaderCache::Retrieve(const string& script_filename) {
+	list<MapLoader*>::iterator entry = _FindLoader(script_filename);
+	if (entry == _loaders.end()) {
+		++_miss_count;
+		IF_PRINT_DEBUG(MAP_DEBUG) << "map preload cache miss: " << script_filename << " (hits: " << _hit_count
+			<< ", misses: " << _miss_count << ")" << endl;
+		return nullptr;
+	}
+
+	MapLoader* loader = *entry;
+	_loaders.erase(entry);
+	if (loader == _active_loader)
+		_active_loader = nullptr;
+
+	++_hit_count;
+	IF_PRINT_DEBUG(MAP_DEBUG) << "map preload cache hit: " << script_filename << " (hits: " << _hit_count
+		<< ", misses: " << _miss_count << ")" << endl;
+	return loader;
+}
+
+
+
+void MapLoaderCache::Store(MapLoader* loader) {
+	if (loader == nullptr) {
+		IF_PRINT_WARNING(MAP_DEBUG) << "function received nullptr argument" << endl;
+		return;
+	}
+
+	list<MapLoader*>::iterator entry = _FindLoader(loader->GetScriptFilename());
+	if (entry != _loaders.end()) {
+		if (*entry == _active_loader)
+			_active_loader = nullptr;
+		delete *entry;
+		_loaders.erase(entry);
+	}
+
+	_loaders.push_front(loader);
+	_EnforceMemoryBudget();
+}
+
+
+
+void MapLoaderCache::Update() {
+	if (_active_loader != nullptr) {
+		if (_active_loader->IsFinished() == false)
+			return;
+
+		_active_loader = nullptr;
+		_EnforceMemoryBudget();
+	}
+
+	// Start loading the next map that is not already cached. Only one map is loaded at a time.
+	while (_pending_filenames.empty() == false) {
+		string filename = _pending_filenames.front();
+		_pending_filenames.pop_front();
+		if (_FindLoader(filename) != _loaders.end())
+			continue;
+
+		MapLoader* loader = new MapLoader(filename);
+		if (loader->Start() == false) {
+			delete loader;
+			continue;
+		}
+
+		// Preloaded maps are placed at the back so that they are evicted before any map that has actually been visited
+		_loaders.push_back(loader);
+		_active_loader = loader;
+		break;
+	}
+}
+
+
+
+void MapLoaderCache::Clear() {
+	_pending_filenames.clear();
+	_active_loader = nullptr;
+
+	for (list<MapLoader*>::iterator i = _loaders.begin(); i != _loaders.end(); ++i)
+		delete *i;
+	_loaders.clear();
+}
+
+
+
+size_t MapLoaderCache::GetMemoryUsage() const {
+	size_t usage = 0;
+	for (list<MapLoader*>::const_iterator i = _loaders.begin(); i != _loaders.end(); ++i) {
+		if (*i != _active_loader)
+			usage += (*i)->GetMemoryUsage();
+	}
+
+	return usage;
+}
+
+
+
+list<MapLoader*>::iterator MapLoaderCache::_FindLoader(const string& script_filename) {
+	for (list<MapLoader*>::iterator i = _loaders.begin(); i != _loaders.end(); ++i) {
+		if ((*i)->GetScriptFilename() == script_filename)
+			return i;
+	}
+
+	return _loaders.end();
+}
+
+
+
+void MapLoaderCache::_EnforceMemoryBudget() {
+	size_t usage = GetMemoryUsage();
+	list<MapLoader*>::iterator i = _loaders.end();
+	while (usage > _memory_budget && i != _loaders.begin()) {
+		--i;
+		// The active loader is still being written to by its worker thread, and destroying it would block until it finishes
+		if (*i == _active_loader)
+			continue;
+
+		usage -= (*i)->GetMemoryUsage();
+		IF_PRINT_DEBUG(MAP_DEBUG) << "evicted map from preload cache: " << (*i)->GetScriptFilename() << endl;
+		delete *i;
+		i = _loaders.erase(i);
+	}
+}
+
+} // namespace private_map
+
+} // namespace hoa_map
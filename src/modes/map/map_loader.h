@@ -0,0 +1,251 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    map_loader.h
+*** \author  agent
+*** \brief   Header file for loading map resources in the background
+***
+*** Constructing a MapMode object loads all of the map's data, tileset images,
+*** and audio before the map can be shown. This code performs the parts of that
+*** work that do not require the Lua state, OpenGL, or OpenAL on a separate
+*** thread, so that the current map can continue updating and drawing while the
+*** next map is prepared.
+*** ***************************************************************************/
+
+#pragma once
+
+// Allacrost utilities
+#include "utils.h"
+#include "defs.h"
+
+// Allacrost engines
+#include "system.h"
+
+// Local map mode headers
+#include "map_binary.h"
+
+namespace hoa_map {
+
+namespace private_map {
+
+/** ****************************************************************************
+*** \brief Prepares the resources of a map on a background thread
+***
+*** Loading is split between the main thread and a worker thread:
+***
+*** -# Start() runs on the main thread. It only checks that the map has a preload
+***    file and starts the worker thread. No Lua code is executed by the loader.
+*** -# The worker thread reads the names of the map data file, audio files, and
+***    tileset images from the preload file and opens the binary map file. It then
+***    decodes every tileset image and every sound into system memory. Music is
+***    streamed while it plays rather than decoded in full, so the music files are
+***    only read so that they are resident in the file cache.
+*** -# Once IsFinished() returns true, the loader is passed to the MapMode constructor,
+***    which uploads the decoded images to texture memory, fills the OpenAL buffers
+***    of its sounds from the decoded sounds, and creates all Lua objects.
+***
+*** Preload files and binary map files are generated by the map compiler (allacrost-mapc),
+*** which the map-data build target runs. A map without an up to date preload
+*** file is not loaded in the background, and tileset images are only decoded ahead of time
+*** when an up to date binary map file also exists. In either case MapMode loads the
+*** remaining resources itself as it normally would.
+***
+*** \note Only the main thread may call the methods of this class.
+*** ***************************************************************************/
+class MapLoader {
+public:
+	/** \param script_filename The name of the map script file of the map to load
+	**/
+	MapLoader(const std::string& script_filename);
+
+	//! \note The destructor blocks until the worker thread has finished
+	~MapLoader();
+
+	/** \brief Starts the worker thread
+	*** \return False if the map has no preload file or the loader was already started. The map can still be loaded without the loader.
+	**/
+	bool Start();
+
+	//! \brief Returns true if the worker thread has completed all of its work
+	bool IsFinished();
+
+	//! \brief Blocks until the worker thread has completed all of its work
+	void Finish();
+
+	/** \brief Returns the number of bytes of memory held by the decoded images and sounds and the binary map file
+	*** \note The returned value is only complete once the worker thread has finished
+	**/
+	size_t GetMemoryUsage() const;
+
+	//! \name Class Member Accessor Methods
+	//@{
+	const std::string& GetScriptFilename() const
+		{ return _script_filename; }
+
+	//! \brief Returns the opened binary map file, or nullptr if no valid binary map file exists for the map
+	const MapBinaryFile* GetBinaryFile() const
+		{ return _binary_file.IsOpen() ? &_binary_file : nullptr; }
+
+	/** \brief Retrieves the decoded data of a tileset image
+	*** \param filename The filename of the tileset image
+	*** \return A pointer to the image data, or nullptr if the image was not decoded by the loader
+	*** \note The image data remains owned by the loader
+	**/
+	hoa_video::private_video::ImageMemory* GetTilesetImage(const std::string& filename) const;
+
+	/** \brief Retrieves the decoded data of a sound
+	*** \param filename The filename of the sound
+	*** \return A pointer to the decoded sound, or nullptr if the sound was not decoded by the loader
+	*** \note The sound data remains owned by the loader
+	**/
+	const hoa_audio::private_audio::AudioMemory* GetSound(const std::string& filename) const;
+	//@}
+
+private:
+	//! \brief The name of the map script file
+	std::string _script_filename;
+
+	//! \brief The opened binary map file of the map, if one exists
+	MapBinaryFile _binary_file;
+
+	//! \brief The filenames of all tileset images to decode on the worker thread
+	std::vector<std::string> _image_filenames;
+
+	//! \brief The decoded tileset images, with the same size and order as _image_filenames. Images that failed to decode have no pixel data.
+	std::vector<hoa_video::private_video::ImageMemory*> _images;
+
+	//! \brief The filenames of all sound files to decode on the worker thread
+	std::vector<std::string> _sound_filenames;
+
+	//! \brief The decoded sounds, with the same size and order as _sound_filenames. Sounds that failed to decode are nullptr.
+	std::vector<hoa_audio::private_audio::AudioMemory*> _sounds;
+
+	//! \brief The filenames of all music files used by the map
+	std::vector<std::string> _music_filenames;
+
+	//! \brief The worker thread, or nullptr if it has not been started or has already been joined
+	SDL_Thread* _thread;
+
+	//! \brief Guards access to the _finished member between the worker and main threads
+	Semaphore* _finished_lock;
+
+	//! \brief Set to true by the worker thread when all of its work is complete
+	bool _finished;
+
+	//! \brief The function executed by the worker thread
+	void _LoadResources();
+
+	/** \brief The entry point of the worker thread, which calls _LoadResources()
+	*** \param loader A pointer to the MapLoader that started the thread
+	***
+	*** SystemEngine::SpawnThread() is not used because it passes the same static object to every thread it starts,
+	*** which is overwritten if two loaders are started before the first thread has read it.
+	**/
+	static int _LoadThread(void* loader);
+}; // class MapLoader
+
+
+/** ****************************************************************************
+*** \brief Keeps the resources of maps adjacent to the current map loaded in the background
+***
+*** Whenever a map is loaded, it gives the cache the names of every map that its
+*** transition events lead to. The cache then runs a MapLoader for each of these
+*** maps in turn, one at a time, so that by the time the player reaches an exit
+*** the new map's resources are usually already in memory. A MapTransitionEvent
+*** retrieves the loader for its map from the cache before creating one of its own.
+*** Maps that have no preload file are skipped.
+***
+*** Loaders are kept in least recently used order, and each one keeps its binary
+*** map file, decoded tileset images, and decoded sounds, so a map that is found
+*** in the cache does not read or decode any of them again. Whenever the memory
+*** held by the finished loaders exceeds the memory budget, the least recently
+*** used loaders are destroyed until the cache is within budget again.
+***
+*** \note The cache is owned by MapMode and exists only while at least one map exists.
+*** ***************************************************************************/
+class MapLoaderCache {
+public:
+	MapLoaderCache();
+
+	~MapLoaderCache();
+
+	/** \brief Sets the list of maps to preload
+	*** \param script_filenames The names of the map script files of each map to preload, in the order they should be loaded
+	*** This replaces any maps that were waiting to be preloaded. Maps that are already cached are left untouched.
+	**/
+	void Preload(const std::vector<std::string>& script_filenames);
+
+	/** \brief Removes the loader for a map from the cache and passes ownership of it to the caller
+	*** \param script_filename The name of the map script file of the map
+	*** \return A pointer to the loader, which may not have finished yet, or nullptr if the map was not cached
+	*** \note Each call is recorded as either a cache hit or a cache miss
+	**/
+	MapLoader* Retrieve(const std::string& script_filename);
+
+	/** \brief Adds a loader to the cache as the most recently used entry
+	*** \param loader A pointer to the loader, which must have been started. The cache takes ownership of the loader.
+	*** If a loader for the same map is already cached, the older loader is destroyed.
+	**/
+	void Store(MapLoader* loader);
+
+	//! \brief Starts loading the next map waiting to be preloaded and enforces the memory budget. Should be called once every frame.
+	void Update();
+
+	//! \brief Destroys all cached loaders and clears the list of maps waiting to be preloaded
+	void Clear();
+
+	//! \brief Returns the number of bytes of memory held by all finished loaders in the cache
+	size_t GetMemoryUsage() const;
+
+	//! \name Class Member Access Methods
+	//@{
+	size_t GetMemoryBudget() const
+		{ return _memory_budget; }
+
+	uint32 GetHitCount() const
+		{ return _hit_count; }
+
+	uint32 GetMissCount() const
+		{ return _miss_count; }
+
+	//! \param budget The maximum number of bytes that the cached loaders may occupy. Zero disables preloading.
+	void SetMemoryBudget(size_t budget)
+		{ _memory_budget = budget; }
+	//@}
+
+private:
+	//! \brief All cached loaders, from most to least recently used
+	std::list<MapLoader*> _loaders;
+
+	//! \brief The names of the map script files waiting to be preloaded
+	std::list<std::string> _pending_filenames;
+
+	//! \brief The loader that is currently running in the background, or nullptr if none is running. This loader is also in _loaders.
+	MapLoader* _active_loader;
+
+	//! \brief The maximum number of bytes that the cached loaders may occupy
+	size_t _memory_budget;
+
+	//! \brief The number of times that a loader was requested and found or not found in the cache
+	uint32 _hit_count, _miss_count;
+
+	/** \brief Finds a cached loader
+	*** \param script_filename The name of the map script file of the map
+	*** \return An iterator to the loader in _loaders, or _loaders.end() if the map is not cached
+	**/
+	std::list<MapLoader*>::iterator _FindLoader(const std::string& script_filename);
+
+	//! \brief Destroys the least recently used finished loaders until the cache is within its memory budget
+	void _EnforceMemoryBudget();
+}; // class MapLoaderCache
+
+} // namespace private_map
+
+} // namespace hoa_map
@@ -18,6 +18,7 @@
 
 // Allacrost engines
 #include "audio.h"
+#include "profiler.h"
 #include "system.h"
 #include "video.h"
 
@@ -26,6 +27,7 @@
 
 // Local map mode headers
 #include "map.h"
+#include "map_binary.h"
 #include "map_dialogue.h"
 #include "map_objects.h"
 #include "map_sprites.h"
@@ -429,7 +431,23 @@ void ObjectSupervisor::Load(ReadScriptDescriptor& map_file) {
 
 
 
+void ObjectSupervisor::Load(const MapBinaryFile& binary_file) {
+	const MapBinaryHeader& header = binary_file.GetHeader();
+	const uint32* collision_data = binary_file.GetCollisionData();
+
+	_num_grid_rows = header.collision_row_count;
+	_num_grid_cols = header.collision_column_count;
+	for (uint16 r = 0; r < _num_grid_rows; ++r) {
+		const uint32* row = collision_data + r * _num_grid_cols;
+		_collision_grid.push_back(vector<uint32>(row, row + _num_grid_cols));
+	}
+}
+
+
+
 void ObjectSupervisor::Update() {
+	PROFILE_ZONE("ObjectSupervisor::Update");
+
 	for (uint32 i = 0; i < _object_layers.size(); ++i) {
 		_object_layers[i].Update();
 	}
@@ -506,6 +524,8 @@ void ObjectSupervisor::MoveObjectToLayer(MapObject* object, uint32 layer_id) {
 
 
 void ObjectSupervisor::SortObjectLayers() {
+	PROFILE_ZONE("ObjectSupervisor::SortObjectLayers");
+
 	for (vector<ObjectLayer>::iterator i = _object_layers.begin(); i != _object_layers.end(); ++i) {
 		i->SortObjects();
 	}
@@ -547,6 +547,11 @@ public:
 	**/
 	void Load(hoa_script::ReadScriptDescriptor& map_file);
 
+	/** \brief Loads the collision grid data from a compiled binary map file instead of the map data file
+	*** \param binary_file A reference to the opened and validated binary map file
+	**/
+	void Load(const MapBinaryFile& binary_file);
+
 	//! \brief Updates the state of all map zones and objects across all layers
 	void Update();
 
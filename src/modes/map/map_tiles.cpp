@@ -19,6 +19,8 @@
 
 // Local map mode headers
 #include "map.h"
+#include "map_binary.h"
+#include "map_loader.h"
 #include "map_tiles.h"
 
 using namespace std;
@@ -38,7 +40,10 @@ void TileLayer::Draw(MAP_CONTEXT context) const {
 
 TileSupervisor::TileSupervisor() :
 	_row_count(0),
-	_column_count(0)
+	_column_count(0),
+	_context_count(0),
+	_chunk_row_count(0),
+	_chunk_column_count(0)
 {}
 
 
@@ -49,6 +54,7 @@ TileSupervisor::~TileSupervisor() {
 	for (uint32 i = 0; i < _tile_images.size(); i++)
 		delete(_tile_images[i]);
 
+	_tile_chunks.clear();
 	_tile_grid.clear();
 	_tile_images.clear();
 	_animated_tile_images.clear();
@@ -69,6 +75,41 @@ MAP_CONTEXT TileSupervisor::GetInheritedContext(MAP_CONTEXT context) {
 
 
 
+int16 TileSupervisor::GetTile(MAP_CONTEXT context, uint32 layer_index, uint32 row, uint32 col) const {
+	int32 context_index = _ContextIndex(context);
+	if (context_index < 0 || layer_index >= _tile_layers.size() || row >= _row_count || col >= _column_count) {
+		IF_PRINT_WARNING(MAP_DEBUG) << "invalid tile requested for context " << context << ", layer " << layer_index
+			<< ", row " << row << ", column " << col << endl;
+		return UNREFERENCED_TILE;
+	}
+
+	return _tile_grid[_TileIndex(context_index, layer_index, row, col)];
+}
+
+
+
+size_t TileSupervisor::GetMemoryUsage() const {
+	size_t bytes = sizeof(TileSupervisor);
+	bytes += _tile_grid.capacity() * sizeof(int16);
+	bytes += _tile_layers.capacity() * sizeof(TileLayer);
+	bytes += _tile_images.capacity() * sizeof(ImageDescriptor*);
+	bytes += _animated_tile_images.capacity() * sizeof(AnimatedImage*);
+	bytes += _animated_tile_frames.capacity() * sizeof(uint32);
+
+	for (uint32 i = 0; i < _animated_tile_quads.size(); ++i) {
+		bytes += sizeof(vector<AnimatedTileQuad>) + _animated_tile_quads[i].capacity() * sizeof(AnimatedTileQuad);
+	}
+	for (uint32 i = 0; i < _tile_chunks.size(); ++i) {
+		for (uint32 j = 0; j < _tile_chunks[i].size(); ++j) {
+			bytes += _tile_chunks[i][j].GetMemoryUsage();
+		}
+	}
+
+	return bytes;
+}
+
+
+
 void TileSupervisor::Load(ReadScriptDescriptor& map_file) {
 	// TODO: Add some more error checking in this function (such as checking for script errors after reading blocks of data from the map file)
 
@@ -107,31 +148,199 @@ void TileSupervisor::Load(ReadScriptDescriptor& map_file) {
 	}
 
 	// ---------- (2) Construct the tile layer and map context containers
-	for (uint32 i = 0; i < tile_layer_count; ++i)
-		_tile_layers.push_back(TileLayer(i));
-
-	vector<MAP_CONTEXT> map_contexts;
 	vector<int32> context_inheritance;
 	map_file.ReadIntVector("map_context_inheritance", context_inheritance);
+	_CreateLayersAndContexts(tile_layer_count, context_inheritance);
+
+	// ---------- (3) Read in the map tile data for all layers and all contexts
+	// Tilesets contain a total of 256 tiles each, so 0-255 correspond to the first tileset, 256-511 the second, etc. The tile location
+	// within the tileset is also determined by the value, where the first 16 indeces in the tileset range are the tiles of the first row
+	// (left to right), and so on.
+	vector<int32> tile_data;
+	map_file.OpenTable("map_tiles");
+	for (uint32 y = 0; y < _row_count; ++y) {
+		map_file.OpenTable(y);
+		for (uint32 x = 0; x < _column_count; ++x) {
+			tile_data.clear();
+			map_file.ReadIntVector(x, tile_data);
+			for (uint32 c = 0; c < map_context_count; ++c) {
+				for (uint32 l = 0, data_index = c * tile_layer_count; l < tile_layer_count; ++l, ++data_index) {
+					_tile_grid[_TileIndex(c, l, y, x)] = tile_data[data_index];
+				}
+			}
+		}
+		map_file.CloseTable();
+	}
+	map_file.CloseTable();
 
-	// For each context, populate the map_context vector and the _inherited_contexts map
-	for (uint32 i = 0; i < map_context_count; ++i) {
-		context_inheritance[i] -= 1; // The map file enumerates contexts from 1..n, so we decrement this value to the range 0..n-1
+	// ---------- (4) Load the tilesets and construct all tile images
+	vector<string> tileset_definition_filenames;
+	map_file.ReadStringVector("tileset_filenames", tileset_definition_filenames);
+	_LoadTiles(tileset_definition_filenames, nullptr);
+} // void TileSupervisor::Load(ReadScriptDescriptor& map_file)
+
+
+
+bool TileSupervisor::Load(const MapBinaryFile& binary_file, const MapLoader* loader) {
+	const MapBinaryHeader& header = binary_file.GetHeader();
+	if (header.row_count > 0xFFFF || header.column_count > 0xFFFF || header.collision_row_count != header.row_count * 2 ||
+		header.collision_column_count != header.column_count * 2)
+	{
+		PRINT_ERROR << "binary map file contained invalid map dimensions" << endl;
+		return false;
+	}
+
+	// Every tile must refer to a tile in one of the map's tilesets, since _LoadTiles() uses the values as indeces
+	const int16* tile_data = binary_file.GetTileData();
+	uint64_t tile_count = static_cast<uint64_t>(header.context_count) * header.tile_layer_count * header.row_count * header.column_count;
+	uint64_t tileset_tile_count = static_cast<uint64_t>(binary_file.GetTilesetFilenames().size()) * TILES_PER_TILESET;
+	for (uint64_t i = 0; i < tile_count; ++i) {
+		if (tile_data[i] >= 0 && static_cast<uint64_t>(tile_data[i]) >= tileset_tile_count) {
+			PRINT_ERROR << "binary map file contained a tile that does not exist in any of its tilesets: " << tile_data[i] << endl;
+			return false;
+		}
+	}
+
+	_row_count = header.row_count;
+	_column_count = header.column_count;
+	const int32* inheritance = binary_file.GetContextInheritance();
+	_CreateLayersAndContexts(header.tile_layer_count, vector<int32>(inheritance, inheritance + header.context_count));
+
+	// The tile layers are stored in the binary file in the same layout as the tile grid, so they can be copied in directly
+	if (_tile_grid.empty() == false)
+		memcpy(&_tile_grid[0], binary_file.GetTileData(), _tile_grid.size() * sizeof(int16));
+
+	_LoadTiles(binary_file.GetTilesetFilenames(), loader);
+	return true;
+} // bool TileSupervisor::Load(const MapBinaryFile& binary_file, const MapLoader* loader)
+
+
+
+void TileSupervisor::Update() {
+	for (uint32 i = 0; i < _animated_tile_images.size(); i++) {
+		_animated_tile_images[i]->Update();
+
+		// When the animation changes frames, only the texture coordinates of the quads that display it need to be updated
+		uint32 frame_index = _animated_tile_images[i]->GetCurrentFrameIndex();
+		if (frame_index == _animated_tile_frames[i])
+			continue;
+
+		_animated_tile_frames[i] = frame_index;
+		StillImage* frame = _animated_tile_images[i]->GetCurrentFrame();
+		for (uint32 j = 0; j < _animated_tile_quads[i].size(); j++) {
+			AnimatedTileQuad& tile_quad = _animated_tile_quads[i][j];
+			_tile_chunks[tile_quad.context_index][tile_quad.chunk_index].SetQuadImage(tile_quad.quad_id, *frame);
+		}
+	}
+}
+
+
+
+void TileSupervisor::DrawTileLayer(uint16 layer_index, MAP_CONTEXT context) {
+	if (layer_index >= _tile_layers.size()) {
+		PRINT_ERROR << "tried to draw a tile layer at an invalid index: " << layer_index << endl;
+		return;
+	}
+	if (context == MAP_CONTEXT_NONE || context == MAP_CONTEXT_ALL) {
+		PRINT_ERROR << "invalid context argument: " << context << endl;
+		return;
+	}
+
+	int32 context_index = _ContextIndex(context);
+	if (context_index < 0) {
+		PRINT_ERROR << "map does not contain the context: " << context << endl;
+		return;
+	}
+	vector<QuadBuffer>& chunks = _tile_chunks[context_index];
+	if (chunks.empty() == true)
+		return;
+
+	// Determine the range of chunks that intersect the map frame
+	const MapFrame& frame = MapMode::CurrentInstance()->GetMapFrame();
+	uint32 starting_row = static_cast<uint32>(max(static_cast<int16>(0), frame.starting_row));
+	uint32 starting_col = static_cast<uint32>(max(static_cast<int16>(0), frame.starting_col));
+	uint32 first_chunk_row = starting_row / TILE_CHUNK_LENGTH;
+	uint32 first_chunk_col = starting_col / TILE_CHUNK_LENGTH;
+	uint32 last_chunk_row = min(static_cast<uint32>(_chunk_row_count - 1), (starting_row + frame.num_draw_rows - 1) / TILE_CHUNK_LENGTH);
+	uint32 last_chunk_col = min(static_cast<uint32>(_chunk_column_count - 1), (starting_col + frame.num_draw_cols - 1) / TILE_CHUNK_LENGTH);
+
+	// The frame's tile draw position refers to the bottom center of the first tile drawn. Chunk quads are positioned relative
+	// to the top left corner of the first tile in the chunk.
+	float x_origin = frame.tile_x_start - 1.0f - static_cast<float>(frame.starting_col * 2);
+	float y_origin = frame.tile_y_start - 2.0f - static_cast<float>(frame.starting_row * 2);
+
+	VideoManager->SetDrawFlags(VIDEO_BLEND, 0);
+	for (uint32 r = first_chunk_row; r <= last_chunk_row; ++r) {
+		for (uint32 c = first_chunk_col; c <= last_chunk_col; ++c) {
+			VideoManager->Move(x_origin + static_cast<float>(c * TILE_CHUNK_LENGTH * 2), y_origin + static_cast<float>(r * TILE_CHUNK_LENGTH * 2));
+			chunks[_ChunkIndex(layer_index, r, c)].Draw();
+		}
+	}
+} // void TileSupervisor::DrawTileLayer(uint16 layer_index, MAP_CONTEXT context)
+
+
+
+void TileSupervisor::_CreateLayersAndContexts(uint32 tile_layer_count, const vector<int32>& context_inheritance) {
+	for (uint32 i = 0; i < tile_layer_count; ++i)
+		_tile_layers.push_back(TileLayer(i));
+
+	// For each context, populate the _inherited_contexts map
+	_context_count = context_inheritance.size();
+	for (uint32 i = 0; i < _context_count; ++i) {
+		// The map file enumerates contexts from 1..n, so we decrement this value to the range 0..n-1
+		int32 inherited_index = context_inheritance[i] - 1;
 
 		MAP_CONTEXT context = static_cast<MAP_CONTEXT>(1 << (i));
 		MAP_CONTEXT inherited_context = MAP_CONTEXT_NONE;
 		// Check if this context inherits or not. If so, translate the integer value into the context ID
-		if (context_inheritance[i] >= 0) {
-			inherited_context = static_cast<MAP_CONTEXT>(1 << (context_inheritance[i]));
+		if (inherited_index >= 0) {
+			inherited_context = static_cast<MAP_CONTEXT>(1 << (inherited_index));
 		}
 
-		map_contexts.push_back(context);
 		_inherited_contexts.insert(pair<MAP_CONTEXT, MAP_CONTEXT>(context, inherited_context));
 	}
 
-	// ---------- (3) Load all of the tileset images that are used by this map
-	// Contains all of the definition filenames used for each tileset
-	vector<string> tileset_definition_filenames;
+	// Allocate the entire tile grid for all contexts. The caller is responsible for filling in the tile data
+	_tile_grid.assign(_context_count * tile_layer_count * _row_count * _column_count, UNREFERENCED_TILE);
+} // void TileSupervisor::_CreateLayersAndContexts(uint32 tile_layer_count, const vector<int32>& context_inheritance)
+
+
+
+void TileSupervisor::_LoadTiles(const vector<string>& tileset_definition_filenames, const MapLoader* loader) {
+	uint32 tileset_count = tileset_definition_filenames.size();
+	uint32 tile_layer_count = _tile_layers.size();
+	uint32 map_context_count = _context_count;
+
+	// ---------- (1) Resolve all inherited tiles
+	// Replace every inherited tile with the tile from the context that it inherits from. The inherited context may itself
+	// inherit the same tile, so the chain of inheritance is followed until a non-inherited tile is found. A context can not
+	// inherit from itself, so the chain is never longer than the number of contexts.
+	for (uint32 c = 0; c < map_context_count; ++c) {
+		for (uint32 l = 0; l < tile_layer_count; ++l) {
+			for (uint32 r = 0; r < _row_count; ++r) {
+				for (uint32 x = 0; x < _column_count; ++x) {
+					int16& tile = _tile_grid[_TileIndex(c, l, r, x)];
+					MAP_CONTEXT inherited_context = _inherited_contexts[static_cast<MAP_CONTEXT>(1 << c)];
+					for (uint32 i = 0; tile == INHERITED_TILE && i < map_context_count; ++i) {
+						int32 inherited_index = _ContextIndex(inherited_context);
+						if (inherited_index < 0) {
+							tile = UNREFERENCED_TILE;
+							break;
+						}
+						tile = _tile_grid[_TileIndex(inherited_index, l, r, x)];
+						inherited_context = _inherited_contexts[inherited_context];
+					}
+
+					if (tile == INHERITED_TILE) {
+						IF_PRINT_WARNING(MAP_DEBUG) << "circular context inheritance detected for context: " << (1 << c) << endl;
+						tile = UNREFERENCED_TILE;
+					}
+				}
+			}
+		}
+	}
+
+	// ---------- (2) Load all of the tileset images that are used by this map
 	// The image filename corresponding to each tileset definition
 	vector<string> image_filenames;
 	// Temporarily retains all tile images loaded for each tileset. Each inner vector contains 256 StillImage objects
@@ -139,7 +348,6 @@ void TileSupervisor::Load(ReadScriptDescriptor& map_file) {
 
 	// First we have to load the definition file for each tileset and retrieve the corresponding image filename in it
 	ReadScriptDescriptor definition_file;
-	map_file.ReadStringVector("tileset_filenames", tileset_definition_filenames);
 	for (uint32 i = 0; i < tileset_count; ++i) {
 		if (definition_file.OpenFile(tileset_definition_filenames[i]) == false) {
 			PRINT_ERROR << "failed to load tileset definition file: " << tileset_definition_filenames[i] << endl;
@@ -159,63 +367,26 @@ void TileSupervisor::Load(ReadScriptDescriptor& map_file) {
 		}
 
 		// Each tileset image is 512x512 pixels, yielding 16 * 16 (== 256) tiles of 32x32 pixels each
-		if (ImageDescriptor::LoadMultiImageFromElementGrid(tileset_images[i], image_filenames[i], 16, 16) == false) {
+		// Use the image data already decoded by the map loader when it is available
+		private_video::ImageMemory* decoded_image = (loader != nullptr) ? loader->GetTilesetImage(image_filenames[i]) : nullptr;
+		if (ImageDescriptor::LoadMultiImageFromElementGrid(tileset_images[i], image_filenames[i], 16, 16, decoded_image) == false) {
 			PRINT_ERROR << "failed to load tileset image: " << image_filenames[i] << endl;
 			exit(1);
 		}
 	}
 
-	// ---------- (4) Read in the map tile data for all layers and all contexts
-	// Tilesets contain a total of 256 tiles each, so 0-255 correspond to the first tileset, 256-511 the second, etc. The tile location
-	// within the tileset is also determined by the value, where the first 16 indeces in the tileset range are the tiles of the first row
-	// (left to right), and so on.
-
-	// First allocate all of the tile objects needed for each context before reading in the tile data
-	MapTile blank_tile(tile_layer_count); // Used to size each MapTile in the _tile_grid appropriately
-	for (uint32 i = 0; i < map_context_count; ++i) {
-		_tile_grid.insert(make_pair(map_contexts[i], vector<vector<MapTile> >(_row_count)));
-		for (uint32 r = 0; r < _row_count; r++) {
-			_tile_grid[map_contexts[i]][r].resize(_column_count, blank_tile);
-		}
-	}
-
-	// Now read in all of the tile data and write it to the correct location in the _tile_grid
-	vector<int32> tile_data;
-	map_file.OpenTable("map_tiles");
-	for (uint32 y = 0; y < _row_count; ++y) {
-		map_file.OpenTable(y);
-		for (uint32 x = 0; x < _column_count; ++x) {
-			tile_data.clear();
-			map_file.ReadIntVector(x, tile_data);
-			for (uint32 c = 0; c < map_context_count; ++c) {
-				MAP_CONTEXT context = map_contexts[c];
-				for (uint32 l = 0, data_index = c * tile_layer_count; l < tile_layer_count; ++l, ++data_index) {
-					_tile_grid[context][y][x].tile_layers[l] = tile_data[data_index];
-				}
-			}
-		}
-		map_file.CloseTable();
-	}
-	map_file.CloseTable();
-
-	// ---------- (5) Determine which tiles in each tileset are referenced in this map
+	// ---------- (3) Determine which tiles in each tileset are referenced in this map
 	// Used to determine whether each tile is used by the map or not. An entry of UNREFERENCED_TILE indicates that particular tile is not used
 	vector<int16> tile_references;
 	// Set size to be equal to the total number of tiles and initialize all entries to unrefereced
 	tile_references.assign(tileset_count * TILES_PER_TILESET, UNREFERENCED_TILE);
 
-	for (map<MAP_CONTEXT, vector<vector<MapTile> > >::iterator i = _tile_grid.begin(); i != _tile_grid.end(); i++) {
-		for (uint32 r = 0; r < _row_count; r++) {
-			for (uint32 c = 0; c < _column_count; c++) {
-				for (uint32 l = 0; l < tile_layer_count; l++) {
-					if ((i->second)[r][c].tile_layers[l] >= 0)
-						tile_references[(i->second)[r][c].tile_layers[l]] = 0;
-				}
-			}
-		}
+	for (uint32 i = 0; i < _tile_grid.size(); i++) {
+		if (_tile_grid[i] >= 0)
+			tile_references[_tile_grid[i]] = 0;
 	}
 
-	// ---------- (6) Translate the tileset tile indeces into indeces for the vector of tile images
+	// ---------- (4) Translate the tileset tile indeces into indeces for the vector of tile images
 	// Here, we have to convert the original tile indeces defined in the map file into a new form. The original index
 	// indicates the tileset where the tile is used and its location in that tileset. We need to convert those indeces
 	// so that they serve as an index to the MapMode::_tile_images vector, where the tile images will soon be stored.
@@ -231,18 +402,12 @@ void TileSupervisor::Load(ReadScriptDescriptor& map_file) {
 	}
 
 	// Now, go back and re-assign all tile layer indeces with the translated indeces
-	for (map<MAP_CONTEXT, vector<vector<MapTile> > >::iterator i = _tile_grid.begin(); i != _tile_grid.end(); i++) {
-		for (uint32 r = 0; r < _row_count; r++) {
-			for (uint32 c = 0; c < _column_count; c++) {
-				for (uint32 l = 0; l < tile_layer_count; l++) {
-					if ((i->second)[r][c].tile_layers[l] >= 0)
-						(i->second)[r][c].tile_layers[l] = tile_references[(i->second)[r][c].tile_layers[l]];
-				}
-			}
-		}
+	for (uint32 i = 0; i < _tile_grid.size(); i++) {
+		if (_tile_grid[i] >= 0)
+			_tile_grid[i] = tile_references[_tile_grid[i]];
 	}
 
-	// ---------- (7) Parse all of the tileset definition files and create any animated tile images that will be used
+	// ---------- (5) Parse all of the tileset definition files and create any animated tile images that will be used
 	// Temporarily retains the animation data (every two elements corresponds to a pair of tile frame index and display time)
 	vector<uint32> animation_info;
 	// Temporarily holds all animated tile images. The map key is the value of the tile index, before reference translation is done in the next step
@@ -286,7 +451,7 @@ void TileSupervisor::Load(ReadScriptDescriptor& map_file) {
 		definition_file.CloseFile();
 	}
 
-	// ---------- (8) Add all referenced tiles to the _tile_images vector, in the proper order
+	// ---------- (6) Add all referenced tiles to the _tile_images vector, in the proper order
 	for (uint32 i = 0; i < tileset_images.size(); i++) {
 		for (uint32 j = 0; j < TILES_PER_TILESET; j++) {
 			uint32 reference = (i * TILES_PER_TILESET) + j;
@@ -311,51 +476,91 @@ void TileSupervisor::Load(ReadScriptDescriptor& map_file) {
 		IF_PRINT_WARNING(MAP_DEBUG) << "one or more tile animations that were created were not added into the map -- this is a memory leak" << endl;
 	}
 
+	// ---------- (7) Compile the tile layers of every context into chunks that can be drawn with a few draw calls each
+	_BuildTileChunks();
+
 	// Remove all tileset images. Any tiles which were not added to _tile_images will no longer exist in memory
 	tileset_images.clear();
-} // void TileSupervisor::Load(ReadScriptDescriptor& map_file)
 
+	IF_PRINT_DEBUG(MAP_DEBUG) << "tile data for " << _row_count << "x" << _column_count << " map with " << map_context_count << " contexts and "
+		<< tile_layer_count << " tile layers uses " << GetMemoryUsage() << " bytes (tile grid: " << (_tile_grid.size() * sizeof(int16))
+		<< " bytes)" << endl;
+} // void TileSupervisor::_LoadTiles(const vector<string>& tileset_definition_filenames, const MapLoader* loader)
 
 
-void TileSupervisor::Update() {
-	for (uint32 i = 0; i < _animated_tile_images.size(); i++) {
-		_animated_tile_images[i]->Update();
+
+int32 TileSupervisor::_ContextIndex(MAP_CONTEXT context) const {
+	// Contexts are single bit flags, and the map uses the first _context_count of them
+	for (uint32 i = 0; i < _context_count; ++i) {
+		if (static_cast<uint32>(context) == (1u << i))
+			return static_cast<int32>(i);
 	}
+	return -1;
 }
 
 
 
-void TileSupervisor::DrawTileLayer(uint16 layer_index, MAP_CONTEXT context) {
-	if (layer_index >= _tile_layers.size()) {
-		PRINT_ERROR << "tried to draw a tile layer at an invalid index: " << layer_index << endl;
-		return;
-	}
-	if (context == MAP_CONTEXT_NONE || context == MAP_CONTEXT_ALL) {
-		PRINT_ERROR << "invalid context argument: " << context << endl;
-		return;
+void TileSupervisor::_BuildTileChunks() {
+	_chunk_row_count = (_row_count + TILE_CHUNK_LENGTH - 1) / TILE_CHUNK_LENGTH;
+	_chunk_column_count = (_column_count + TILE_CHUNK_LENGTH - 1) / TILE_CHUNK_LENGTH;
+	uint32 tile_layer_count = _tile_layers.size();
+	uint32 chunk_count = tile_layer_count * _chunk_row_count * _chunk_column_count;
+
+	// Maps each index of _tile_images to its index in _animated_tile_images, or -1 if the tile is not animated
+	vector<int32> animation_indeces(_tile_images.size(), -1);
+	for (uint32 i = 0, j = 0; i < _tile_images.size() && j < _animated_tile_images.size(); ++i) {
+		if (_tile_images[i] == _animated_tile_images[j]) {
+			animation_indeces[i] = j;
+			++j;
+		}
 	}
 
-	const MapFrame& frame = MapMode::CurrentInstance()->GetMapFrame();
-	MAP_CONTEXT inherited_context = GetInheritedContext(context);
+	_tile_chunks.assign(_context_count, vector<QuadBuffer>(chunk_count));
+	_animated_tile_quads.assign(_animated_tile_images.size(), vector<AnimatedTileQuad>());
+	_animated_tile_frames.assign(_animated_tile_images.size(), 0);
+	for (uint32 i = 0; i < _animated_tile_images.size(); ++i) {
+		_animated_tile_frames[i] = _animated_tile_images[i]->GetCurrentFrameIndex();
+	}
 
-	VideoManager->SetDrawFlags(VIDEO_BLEND, 0);
-	VideoManager->Move(frame.tile_x_start, frame.tile_y_start);
-	for (uint32 r = static_cast<uint32>(frame.starting_row); r < static_cast<uint32>(frame.starting_row + frame.num_draw_rows); ++r)	{
-		for (uint32 c = static_cast<uint32>(frame.starting_col); c < static_cast<uint32>(frame.starting_col + frame.num_draw_cols); ++c)	{
-			// Draw a tile image if it exists at this location
-			if (_tile_grid[context][r][c].tile_layers[layer_index] >= 0) {
-				_tile_images[_tile_grid[context][r][c].tile_layers[layer_index]]->Draw();
-			}
-			else if (_tile_grid[context][r][c].tile_layers[layer_index] == INHERITED_TILE) {
-				if (_tile_grid[inherited_context][r][c].tile_layers[layer_index] >= 0) {
-					_tile_images[_tile_grid[inherited_context][r][c].tile_layers[layer_index]]->Draw();
+	uint32 quad_count = 0;
+	for (uint32 i = 0; i < _context_count; ++i) {
+		vector<QuadBuffer>& chunks = _tile_chunks[i];
+
+		for (uint32 l = 0; l < tile_layer_count; ++l) {
+			// All tiles of a layer are contiguous in the grid, so they are visited in memory order
+			const int16* layer_tiles = &_tile_grid[_TileIndex(i, l, 0, 0)];
+			for (uint32 r = 0; r < _row_count; ++r) {
+				for (uint32 c = 0; c < _column_count; ++c) {
+					int32 tile_index = layer_tiles[r * _column_count + c];
+					if (tile_index < 0)
+						continue;
+
+					uint32 chunk_index = _ChunkIndex(l, r / TILE_CHUNK_LENGTH, c / TILE_CHUNK_LENGTH);
+					float x = static_cast<float>((c % TILE_CHUNK_LENGTH) * 2);
+					float y = static_cast<float>((r % TILE_CHUNK_LENGTH) * 2);
+					int32 animation_index = animation_indeces[tile_index];
+
+					if (animation_index < 0) {
+						chunks[chunk_index].AddQuad(*static_cast<StillImage*>(_tile_images[tile_index]), x, y);
+					}
+					else {
+						int32 quad_id = chunks[chunk_index].AddQuad(*_animated_tile_images[animation_index]->GetCurrentFrame(), x, y);
+						if (quad_id >= 0) {
+							AnimatedTileQuad tile_quad;
+							tile_quad.context_index = i;
+							tile_quad.chunk_index = chunk_index;
+							tile_quad.quad_id = static_cast<uint32>(quad_id);
+							_animated_tile_quads[animation_index].push_back(tile_quad);
+						}
+					}
+					++quad_count;
 				}
 			}
-			VideoManager->MoveRelative(2.0f, 0.0f);
 		}
-		VideoManager->MoveRelative(-static_cast<float>(frame.num_draw_cols * 2), 2.0f);
 	}
-}
+
+	IF_PRINT_DEBUG(MAP_DEBUG) << "built " << (chunk_count * _context_count) << " tile chunks containing " << quad_count << " tile quads" << endl;
+} // void TileSupervisor::_BuildTileChunks()
 
 } // namespace private_map
 
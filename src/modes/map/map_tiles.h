@@ -29,36 +29,6 @@ namespace hoa_map {
 
 namespace private_map {
 
-/** ****************************************************************************
-*** \brief Holds the indeces to the images used for a particular tile on the map
-***
-*** The images that a tile uses are not stored within this class. This class
-*** only holds indices to the container class holding those images. This class
-*** also does not contain any information about the collision grid. That information
-*** is maintained in the map object manager.
-***
-*** \note The reason that tiles do not contain collision information is that
-*** each tile is 32x32 pixels, but collision is defined on a 16x16 granularity,
-*** meaning that there are four collision sections to each tile. Certain code
-*** such as pathfinding is more simple if all collision information is kept in
-*** in another form of container.
-*** ***************************************************************************/
-class MapTile {
-public:
-	/** \name Tile Layer Indeces
-	*** \brief Indeces to the tile image container, where each element corresponds to a different tile layer
-	*** \note A negative value means that no image is registered to that tile layer
-	**/
-	std::vector<int16> tile_layers;
-
-	MapTile()
-		{}
-
-	MapTile(uint32 layer_count) :
-		tile_layers(layer_count, -1) { tile_layers.shrink_to_fit(); }
-}; // class MapTile
-
-
 /** ****************************************************************************
 *** \brief Represents a layer of tiles on a map independently of any map context
 ***
@@ -130,6 +100,20 @@ public:
 	*** \return The inherited context ID. If the context does not inherit or does not exist, returns MAP_CONTEXT_NONE
 	**/
 	MAP_CONTEXT GetInheritedContext(MAP_CONTEXT context);
+
+	/** \brief Retrieves the index of the tile image drawn at a location
+	*** \param context The context of the tile
+	*** \param layer_index The index of the tile layer
+	*** \param row The row of the tile
+	*** \param col The column of the tile
+	*** \return The index into the tile image container, or a negative value if no tile is drawn at that location
+	***
+	*** \note Tiles inherited from another context have already been resolved, so this function never returns INHERITED_TILE
+	**/
+	int16 GetTile(MAP_CONTEXT context, uint32 layer_index, uint32 row, uint32 col) const;
+
+	//! \brief Returns the approximate number of bytes of memory used by the tile grid, tile chunks, and tile bookkeeping (excluding textures)
+	size_t GetMemoryUsage() const;
 	//@}
 
 	/** \brief Handles all operations on loading tilesets and tile images from the map data file
@@ -138,6 +122,13 @@ public:
 	**/
 	void Load(hoa_script::ReadScriptDescriptor& map_file);
 
+	/** \brief Loads the tile data from a compiled binary map file instead of the map data file
+	*** \param binary_file A reference to the opened and validated binary map file
+	*** \param loader An optional pointer to a finished loader holding the already decoded tileset images
+	*** \return False if the binary file contained data that could not be loaded
+	**/
+	bool Load(const MapBinaryFile& binary_file, const MapLoader* loader = nullptr);
+
 	//! \brief Updates all animated tile images
 	void Update();
 
@@ -145,6 +136,8 @@ public:
 	*** \param layer_index The index of the layer that should be drawn
 	*** \param context The context of the tile layer that should be drawn
 	***
+	*** Only the chunks of the layer which are at least partially visible in the current map frame are drawn.
+	***
 	*** \note This function does not reset the coordinate system and hence require that the proper coordinate system is
 	*** already set prior to this function call (0.0f, SCREEN_COLS, SCREEN_ROWS, 0.0f). These functions do make
 	*** modifications to the blending draw flag and the draw cursor position which are not restored by the function upon
@@ -169,12 +162,19 @@ private:
 	//! \brief A mapping of each context to the context that it inherits from. Set to MAP_CONTEXT_NONE for a context that does not inherit
 	std::map<MAP_CONTEXT, MAP_CONTEXT> _inherited_contexts;
 
-	/** \brief A map of 2D vectors that contains all of the map's tile objects.
-	*** Each key-value pair in the std::map represents a map context, thus the size of the std::map is equal to
-	*** number of contexts in the game map (up to 32). The 2D vector represents the rows and columns of tiles,
-	*** respectively, for the given map context.
+	//! \brief The number of map contexts that the tile grid holds tiles for
+	uint32 _context_count;
+
+	/** \brief A single contiguous buffer that contains the tile image indeces of every tile on the map
+	*** The buffer is indexed by [context][layer][row][col], so each tile layer of each context occupies a contiguous
+	*** plane of _row_count * _column_count elements. Use the _TileIndex() method to compute the location of a tile.
+	*** Each element is an index into the _tile_images container, or a negative value if no image is drawn there.
+	*** Tiles that are inherited from another context are replaced with the tile of that context when the map is loaded.
+	***
+	*** \note Collision information is not stored here. Collision is defined on a 16x16 pixel granularity, meaning that
+	*** there are four collision sections to each tile, and is maintained by the map object supervisor.
 	**/
-	std::map<MAP_CONTEXT, std::vector<std::vector<MapTile> > > _tile_grid;
+	std::vector<int16> _tile_grid;
 
 	//! \brief Contains the image objects for all map tiles, both still and animated.
 	std::vector<hoa_video::ImageDescriptor*> _tile_images;
@@ -184,6 +184,82 @@ private:
 	*** _tile_images vector, which contains both still and animated images.
 	**/
 	std::vector<hoa_video::AnimatedImage*> _animated_tile_images;
+
+	//! \brief The number of rows and columns of tile chunks that each tile layer is divided into
+	uint16 _chunk_row_count, _chunk_column_count;
+
+	/** \brief Prebuilt quad buffers holding the tile images of every chunk of every tile layer, for each context
+	*** The outer vector is indexed by context index. Each inner vector holds the chunks of all tile layers for the
+	*** context, indexed by layer, then chunk row, then chunk column. Use the _ChunkIndex() method to compute the index
+	*** of a chunk.
+	**/
+	std::vector<std::vector<hoa_video::QuadBuffer> > _tile_chunks;
+
+	//! \brief Identifies a single quad in the tile chunks that displays an animated tile
+	class AnimatedTileQuad {
+	public:
+		//! \brief The index of the context of the chunk containing the quad
+		uint32 context_index;
+
+		//! \brief The index of the chunk in the _tile_chunks vector for the context
+		uint32 chunk_index;
+
+		//! \brief The ID of the quad within the chunk
+		uint32 quad_id;
+	};
+
+	/** \brief Holds all of the chunk quads that display each animated tile
+	*** This vector is the same size as _animated_tile_images, and each element corresponds to the image in that container.
+	**/
+	std::vector<std::vector<AnimatedTileQuad> > _animated_tile_quads;
+
+	//! \brief The frame index of each animated tile image that is currently displayed by the tile chunks
+	std::vector<uint32> _animated_tile_frames;
+
+	/** \brief Returns the index of a context in the tile grid and chunk containers
+	*** \param context The context to retrieve the index for
+	*** \return The context index, or -1 if the context is not a single context used by the map
+	**/
+	int32 _ContextIndex(MAP_CONTEXT context) const;
+
+	/** \brief Returns the index into the _tile_grid buffer of a tile
+	*** \param context_index The index of the context, as returned by _ContextIndex()
+	*** \param layer The tile layer index
+	*** \param row The row of the tile
+	*** \param col The column of the tile
+	**/
+	uint32 _TileIndex(uint32 context_index, uint32 layer, uint32 row, uint32 col) const
+		{ return ((context_index * _tile_layers.size() + layer) * _row_count + row) * _column_count + col; }
+
+	/** \brief Returns the index into a context's chunk vector of a chunk
+	*** \param layer The tile layer index
+	*** \param chunk_row The row of the chunk
+	*** \param chunk_col The column of the chunk
+	**/
+	uint32 _ChunkIndex(uint32 layer, uint32 chunk_row, uint32 chunk_col) const
+		{ return (layer * _chunk_row_count + chunk_row) * _chunk_column_count + chunk_col; }
+
+	/** \brief Creates the tile layers and the context inheritance mapping, and allocates the tile grid
+	*** \param tile_layer_count The number of tile layers in the map
+	*** \param context_inheritance The context that each context inherits from, as enumerated in the map data file
+	*** \note The row and column counts must be set before this function is called
+	**/
+	void _CreateLayersAndContexts(uint32 tile_layer_count, const std::vector<int32>& context_inheritance);
+
+	/** \brief Loads all tileset images and prepares the tile grid for drawing after the tile data has been read in
+	*** \param tileset_definition_filenames The names of the definition files of each tileset used by the map
+	*** \param loader A pointer to a finished loader holding decoded tileset images, or nullptr to read the images from disk
+	***
+	*** This performs all of the work of loading a map that is common to both the map data file and binary map file.
+	*** It resolves inherited tiles, translates tileset indeces into tile image indeces, creates all still and animated
+	*** tile images, and builds the tile chunks.
+	**/
+	void _LoadTiles(const std::vector<std::string>& tileset_definition_filenames, const MapLoader* loader);
+
+	/** \brief Builds the quad buffers for all tile chunks from the tile grid
+	*** This should be called once by Load() after the tile grid and all tile images have been constructed.
+	**/
+	void _BuildTileChunks();
 }; // class TileSupervisor
 
 } // namespace private_map
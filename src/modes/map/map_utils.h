@@ -77,6 +77,9 @@ const int32 UNREFERENCED_TILE = -1;
 //! \brief Indicates that the tile drawn at this location should be the corresponding tile from the inhertiting context
 const int32 INHERITED_TILE = -2;
 
+//! \brief The number of rows and columns of tiles that are grouped together into a single chunk for drawing
+const uint16 TILE_CHUNK_LENGTH = 16;
+
 
 /** \name Map State Enum
 *** \brief Represents the current state of operation during map mode.
@@ -305,6 +308,9 @@ const uint32 MAX_DIALOGUE_OPTIONS = 5;
 //! \brief The number of milliseconds to take to fade out the map
 const uint32 MAP_FADE_OUT_TIME = 2000;
 
+//! \brief The default number of bytes of memory that maps preloaded in the background may occupy
+const uint32 MAP_PRELOAD_MEMORY_BUDGET = 64 * 1024 * 1024;
+
 //! \brief The standard number of milliseconds it takes for enemies to spawn in an enemy zone
 const uint32 STANDARD_ENEMY_SPAWN_TIME = 3000;
 
@@ -270,6 +270,7 @@ void BindModeCode() {
 			.def("GetGlobalRecordGroup", &MapMode::GetGlobalRecordGroup)
 			.def("GetLocalRecordGroup", &MapMode::GetLocalRecordGroup)
 			.def("DrawMapLayers", &MapMode::_DrawMapLayers)
+			.def("DrawLight", &MapMode::DrawLight)
 
 			// Namespace constants
 			.enum_("constants") [
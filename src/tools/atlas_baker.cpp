@@ -0,0 +1,522 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    atlas_baker.cpp
+*** \author  agent
+*** \brief   Source file for the allacrost-atlas command-line tool
+***
+*** This tool packs every tileset image (named by lua/data/tilesets/\*.lua) and
+*** every map sprite animation image (named by lua/data/actors/map_sprites_stock.lua)
+*** into texture atlas pages, and writes the index that the TextureController uses
+*** to find each tile and sprite frame in those pages. It must be run from the
+*** directory containing the game data, since all filenames are stored relative
+*** to it.
+***
+*** Usage: allacrost-atlas [--force] [--page-size SIZE]
+***
+*** Each multi image is packed whole, so its elements keep their positions
+*** relative to one another. Images are placed on pages with a shelf packer,
+*** tallest images first. By default, the atlas is not rebuilt when every image
+*** in it is up to date. The --force option rebuilds the atlas regardless.
+*** ***************************************************************************/
+
+#ifdef _WIN32
+	#include <direct.h>
+#else
+	#include <dirent.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <png.h>
+
+#include "utils.h"
+#include "script.h"
+
+#include "texture_atlas.h"
+
+#if defined(main) && !defined(_WIN32)
+	#undef main
+#endif
+
+using namespace std;
+using namespace hoa_utils;
+using namespace hoa_script;
+using namespace hoa_video::private_video;
+
+//! \brief The directory that contains all tileset definition files
+const string TILESET_DIRECTORY = "lua/data/tilesets/";
+
+//! \brief The file that defines the animation images of every map sprite
+const string MAP_SPRITES_FILENAME = "lua/data/actors/map_sprites_stock.lua";
+
+//! \brief The default width and height of each atlas page, in pixels
+const uint32 DEFAULT_PAGE_SIZE = 2048;
+
+//! \brief A multi image to be packed into the atlas
+class AtlasImage {
+public:
+	AtlasImage() :
+		rows(0), cols(0), width(0), height(0), page(0), x(0), y(0) {}
+
+	std::string filename;
+
+	//! \brief The grid of elements that the game divides the image into
+	uint32 rows, cols;
+
+	//! \brief The dimensions of the image, in pixels
+	uint32 width, height;
+
+	//! \brief The RGBA pixel data of the image
+	std::vector<uint8> pixels;
+
+	//! \brief The page that the image was placed on, and the location of its upper left corner in that page
+	uint32 page, x, y;
+};
+
+
+
+//! \brief Sorts images from tallest to shortest, then from widest to narrowest
+bool CompareImageSize(const AtlasImage* a, const AtlasImage* b) {
+	if (a->height != b->height)
+		return a->height > b->height;
+	return a->width > b->width;
+}
+
+
+
+/** \brief Reads a PNG image as RGBA pixel data
+*** \param image The image to read, whose filename member must be set
+*** \return False if the file could not be read
+**/
+bool ReadPNG(AtlasImage& image) {
+	FILE* fp = fopen(image.filename.c_str(), "rb");
+	if (fp == nullptr)
+		return false;
+
+	uint8 signature[8];
+	if (fread(signature, 1, 8, fp) != 8 || png_sig_cmp(signature, 0, 8) != 0) {
+		fclose(fp);
+		return false;
+	}
+
+	// Declared before the error handler is set up so that it is destroyed normally if libpng reports an error
+	vector<png_bytep> row_pointers;
+
+	png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+	png_infop info_ptr = (png_ptr != nullptr) ? png_create_info_struct(png_ptr) : nullptr;
+	if (info_ptr == nullptr || setjmp(png_jmpbuf(png_ptr))) {
+		png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
+		fclose(fp);
+		return false;
+	}
+
+	png_init_io(png_ptr, fp);
+	png_set_sig_bytes(png_ptr, 8);
+	png_read_info(png_ptr, info_ptr);
+
+	// Convert every color type and bit depth to 8-bit RGBA, the same format that the game loads images in
+	png_set_expand(png_ptr);
+	png_set_strip_16(png_ptr);
+	png_set_gray_to_rgb(png_ptr);
+	png_set_filler(png_ptr, 0xFF, PNG_FILLER_AFTER);
+	png_read_update_info(png_ptr, info_ptr);
+
+	image.width = png_get_image_width(png_ptr, info_ptr);
+	image.height = png_get_image_height(png_ptr, info_ptr);
+	image.pixels.resize(image.width * image.height * 4);
+
+	row_pointers.resize(image.height);
+	for (uint32 i = 0; i < image.height; ++i) {
+		row_pointers[i] = &image.pixels[i * image.width * 4];
+	}
+	png_read_image(png_ptr, &row_pointers[0]);
+	png_read_end(png_ptr, nullptr);
+
+	png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
+	fclose(fp);
+	return true;
+} // bool ReadPNG(AtlasImage& image)
+
+
+
+/** \brief Writes RGBA pixel data to a PNG image
+*** \param filename The name of the file to write
+*** \param width The width of the image
+*** \param height The height of the image
+*** \param pixels The pixel data, containing width * height * 4 bytes
+*** \return False if the file could not be written
+**/
+bool WritePNG(const string& filename, uint32 width, uint32 height, const vector<uint8>& pixels) {
+	FILE* fp = fopen(filename.c_str(), "wb");
+	if (fp == nullptr)
+		return false;
+
+	png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+	png_infop info_ptr = (png_ptr != nullptr) ? png_create_info_struct(png_ptr) : nullptr;
+	if (info_ptr == nullptr || setjmp(png_jmpbuf(png_ptr))) {
+		png_destroy_write_struct(&png_ptr, &info_ptr);
+		fclose(fp);
+		return false;
+	}
+
+	png_init_io(png_ptr, fp);
+	png_set_IHDR(png_ptr, info_ptr, width, height, 8, PNG_COLOR_TYPE_RGB_ALPHA,
+		PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(png_ptr, info_ptr);
+
+	for (uint32 i = 0; i < height; ++i) {
+		png_write_row(png_ptr, const_cast<png_bytep>(&pixels[i * width * 4]));
+	}
+
+	png_write_end(png_ptr, nullptr);
+	png_destroy_write_struct(&png_ptr, &info_ptr);
+	fclose(fp);
+	return true;
+} // bool WritePNG(...)
+
+
+
+//! \brief Returns the names of all tileset definition files in the tileset directory
+vector<string> FindTilesetDefinitionFiles() {
+	vector<string> filenames;
+
+#ifdef _WIN32
+	WIN32_FIND_DATAA file_data;
+	HANDLE search = FindFirstFileA((TILESET_DIRECTORY + "*.lua").c_str(), &file_data);
+	if (search != INVALID_HANDLE_VALUE) {
+		do {
+			filenames.push_back(TILESET_DIRECTORY + file_data.cFileName);
+		} while (FindNextFileA(search, &file_data) != 0);
+		FindClose(search);
+	}
+#else
+	DIR* directory = opendir(TILESET_DIRECTORY.c_str());
+	if (directory != nullptr) {
+		struct dirent* entry;
+		while ((entry = readdir(directory)) != nullptr) {
+			string name = entry->d_name;
+			if (name.length() > 4 && name.compare(name.length() - 4, 4, ".lua") == 0)
+				filenames.push_back(TILESET_DIRECTORY + name);
+		}
+		closedir(directory);
+	}
+#endif
+
+	sort(filenames.begin(), filenames.end());
+	return filenames;
+}
+
+
+
+/** \brief Adds an image to the list of images to pack, unless the same image with the same grid is already in it
+*** \param images The list of images to pack
+*** \param filename The filename of the image
+*** \param rows The number of rows of elements that the game divides the image into
+*** \param cols The number of columns of elements that the game divides the image into
+**/
+void AddImage(vector<AtlasImage>& images, const string& filename, uint32 rows, uint32 cols) {
+	for (uint32 i = 0; i < images.size(); ++i) {
+		if (images[i].filename == filename && images[i].rows == rows && images[i].cols == cols)
+			return;
+	}
+
+	images.push_back(AtlasImage());
+	images.back().filename = filename;
+	images.back().rows = rows;
+	images.back().cols = cols;
+}
+
+
+
+//! \brief Adds the image of every tileset to the list of images to pack
+void FindTilesetImages(vector<AtlasImage>& images) {
+	vector<string> definition_files = FindTilesetDefinitionFiles();
+	for (uint32 i = 0; i < definition_files.size(); ++i) {
+		ReadScriptDescriptor definition_file;
+		if (definition_file.OpenFile(definition_files[i]) == false) {
+			cerr << "failed to open tileset definition file: " << definition_files[i] << endl;
+			continue;
+		}
+
+		// Not every file in the directory defines a tileset
+		string tablespace = DetermineLuaFileTablespaceName(definition_files[i]);
+		if (definition_file.DoesTableExist(tablespace) == true) {
+			definition_file.OpenTable(tablespace);
+			if (definition_file.DoesStringExist("image") == true) {
+				// Each tileset image is divided into 16 * 16 tiles, as loaded by the map mode TileSupervisor
+				AddImage(images, definition_file.ReadString("image"), 16, 16);
+			}
+			definition_file.CloseTable();
+		}
+		definition_file.CloseFile();
+	}
+}
+
+
+
+//! \brief Adds every animation image of every map sprite and enemy sprite to the list of images to pack
+void FindSpriteImages(vector<AtlasImage>& images) {
+	// The sprite definitions refer to a few names bound by the game engine. Define stand-ins for them so that the file can execute.
+	if (luaL_dostring(ScriptManager->GetGlobalState(), "hoa_map = { MapMode = {} } hoa_system = { Translate = function(text) return text end }") != 0) {
+		cerr << "failed to define stand-in bindings for " << MAP_SPRITES_FILENAME << endl;
+		return;
+	}
+
+	ReadScriptDescriptor sprite_file;
+	if (sprite_file.OpenFile(MAP_SPRITES_FILENAME) == false) {
+		cerr << "failed to open map sprite definition file: " << MAP_SPRITES_FILENAME << endl;
+		return;
+	}
+
+	const char* tables[] = { "sprites", "enemies" };
+	for (uint32 i = 0; i < 2; ++i) {
+		vector<string> names;
+		sprite_file.OpenTable(tables[i]);
+		sprite_file.ReadTableKeys(names);
+		for (uint32 j = 0; j < names.size(); ++j) {
+			sprite_file.OpenTable(names[j]);
+			// The grid sizes are those used by MapSprite::LoadStandardAnimations() and MapSprite::LoadRunningAnimations()
+			if (sprite_file.DoesStringExist("standard_animations") == true) {
+				string filename = sprite_file.ReadString("standard_animations");
+				AddImage(images, filename, 4, (filename == "img/sprites/creatures/mak_hound.png") ? 7 : 6);
+			}
+			if (sprite_file.DoesStringExist("running_animations") == true) {
+				AddImage(images, sprite_file.ReadString("running_animations"), 4, 6);
+			}
+			sprite_file.CloseTable();
+		}
+		sprite_file.CloseTable();
+	}
+
+	sprite_file.CloseFile();
+} // void FindSpriteImages(vector<AtlasImage>& images)
+
+
+
+/** \brief Determines whether the existing atlas already contains every image with its current contents
+*** \param images The list of images to pack
+*** \return True if the atlas does not need to be rebuilt
+**/
+bool IsAtlasCurrent(const vector<AtlasImage>& images) {
+	TextureAtlasIndex index;
+	if (DoesFileExist(TEXTURE_ATLAS_INDEX_FILENAME) == false || index.Load(TEXTURE_ATLAS_INDEX_FILENAME) == false)
+		return false;
+
+	if (index.GetSources().size() != images.size())
+		return false;
+
+	for (uint32 i = 0; i < images.size(); ++i) {
+		const TextureAtlasSource* source = index.FindSource(images[i].filename, images[i].rows, images[i].cols);
+		if (source == nullptr || source->IsCurrent() == false)
+			return false;
+	}
+
+	for (uint32 i = 0; i < index.GetPages().size(); ++i) {
+		if (DoesFileExist(index.GetPages()[i].filename) == false)
+			return false;
+	}
+
+	return true;
+}
+
+
+
+/** \brief Places every image on a page with a shelf packer
+*** \param images Pointers to the images to place, sorted by CompareImageSize()
+*** \param page_size The width and height of each page
+*** \param page_heights A reference to store the height of each page in, rounded up to a power of two
+**/
+void PackImages(const vector<AtlasImage*>& images, uint32 page_size, vector<uint32>& page_heights) {
+	uint32 page = 0;
+	uint32 shelf_x = 0, shelf_y = 0, shelf_height = 0;
+	page_heights.clear();
+
+	for (uint32 i = 0; i < images.size(); ++i) {
+		AtlasImage* image = images[i];
+
+		// Start a new shelf when the image does not fit on the current one, and a new page when there is no room for the shelf
+		if (shelf_x + image->width > page_size) {
+			shelf_x = 0;
+			shelf_y += shelf_height;
+			shelf_height = 0;
+		}
+		if (shelf_y + image->height > page_size) {
+			page_heights.push_back(page_size);
+			page++;
+			shelf_x = 0;
+			shelf_y = 0;
+			shelf_height = 0;
+		}
+
+		image->page = page;
+		image->x = shelf_x;
+		image->y = shelf_y;
+		shelf_x += image->width;
+		shelf_height = max(shelf_height, image->height);
+	}
+
+	// The last page is only as tall as it needs to be
+	if (images.empty() == false)
+		page_heights.push_back(RoundUpPow2(shelf_y + shelf_height));
+} // void PackImages(...)
+
+
+
+/** \brief Reads all images, packs them into pages, and writes the pages and index
+*** \param images The list of images to pack
+*** \param page_size The width and height of each page
+*** \return False if the atlas could not be built
+**/
+bool BuildAtlas(vector<AtlasImage>& images, uint32 page_size) {
+	vector<AtlasImage*> packed_images;
+	for (uint32 i = 0; i < images.size(); ++i) {
+		AtlasImage& image = images[i];
+		if (ReadPNG(image) == false) {
+			cerr << "failed to read image, it will not be added to the atlas: " << image.filename << endl;
+			continue;
+		}
+		if (image.width > page_size || image.height > page_size) {
+			cerr << "image is larger than the page size, it will not be added to the atlas: " << image.filename << endl;
+			continue;
+		}
+		if (image.width % image.cols != 0 || image.height % image.rows != 0) {
+			cerr << "image dimensions are not a multiple of its grid size, it will not be added to the atlas: " << image.filename << endl;
+			continue;
+		}
+		packed_images.push_back(&image);
+	}
+
+	stable_sort(packed_images.begin(), packed_images.end(), CompareImageSize);
+	vector<uint32> page_heights;
+	PackImages(packed_images, page_size, page_heights);
+
+	if (MakeDirectory(TEXTURE_ATLAS_DIRECTORY) == false) {
+		cerr << "failed to create the atlas directory: " << TEXTURE_ATLAS_DIRECTORY << endl;
+		return false;
+	}
+
+	TextureAtlasIndex index;
+	for (uint32 page = 0; page < page_heights.size(); ++page) {
+		TextureAtlasPage atlas_page;
+		atlas_page.filename = TEXTURE_ATLAS_DIRECTORY + "page_" + NumberToString(page) + ".png";
+		atlas_page.width = page_size;
+		atlas_page.height = page_heights[page];
+
+		// Copy every image on this page into the page pixels, leaving unused space fully transparent
+		vector<uint8> pixels(atlas_page.width * atlas_page.height * 4, 0);
+		for (uint32 i = 0; i < packed_images.size(); ++i) {
+			const AtlasImage* image = packed_images[i];
+			if (image->page != page)
+				continue;
+			for (uint32 row = 0; row < image->height; ++row) {
+				memcpy(&pixels[((image->y + row) * atlas_page.width + image->x) * 4], &image->pixels[row * image->width * 4], image->width * 4);
+			}
+		}
+
+		if (WritePNG(atlas_page.filename, atlas_page.width, atlas_page.height, pixels) == false) {
+			cerr << "failed to write atlas page: " << atlas_page.filename << endl;
+			return false;
+		}
+		index.AddPage(atlas_page);
+		cout << "wrote " << atlas_page.filename << " (" << atlas_page.width << "x" << atlas_page.height << ")" << endl;
+	}
+
+	for (uint32 i = 0; i < packed_images.size(); ++i) {
+		const AtlasImage* image = packed_images[i];
+		TextureAtlasSource source;
+		source.filename = image->filename;
+		GetFileStatus(image->filename, source.file_size, source.modify_time);
+		source.rows = image->rows;
+		source.cols = image->cols;
+		source.element_width = image->width / image->cols;
+		source.element_height = image->height / image->rows;
+
+		vector<TextureAtlasEntry> entries;
+		for (uint32 row = 0; row < image->rows; ++row) {
+			for (uint32 col = 0; col < image->cols; ++col) {
+				entries.push_back(TextureAtlasEntry(image->page, image->x + col * source.element_width, image->y + row * source.element_height));
+			}
+		}
+		index.AddSource(source, entries);
+	}
+
+	if (index.Save(TEXTURE_ATLAS_INDEX_FILENAME) == false)
+		return false;
+
+	cout << "packed " << packed_images.size() << " images onto " << page_heights.size() << " pages -> " << TEXTURE_ATLAS_INDEX_FILENAME << endl;
+	return (packed_images.size() == images.size());
+} // bool BuildAtlas(vector<AtlasImage>& images, uint32 page_size)
+
+
+
+void PrintUsage() {
+	cout << "usage: allacrost-atlas [--force] [--page-size SIZE]" << endl;
+	cout << endl;
+	cout << "Packs all tileset and map sprite images into texture atlas pages in " << TEXTURE_ATLAS_DIRECTORY << endl;
+	cout << "  --force            rebuild the atlas even if it is up to date" << endl;
+	cout << "  --page-size SIZE   the width and height of each page, a power of two (default: " << DEFAULT_PAGE_SIZE << ")" << endl;
+}
+
+
+
+int main(int argc, char *argv[]) {
+	bool force = false;
+	uint32 page_size = DEFAULT_PAGE_SIZE;
+
+	for (int32 i = 1; i < argc; ++i) {
+		string argument = argv[i];
+		if (argument == "--force") {
+			force = true;
+		}
+		else if (argument == "--page-size" && i + 1 < argc) {
+			page_size = atoi(argv[++i]);
+		}
+		else if (argument == "--help" || argument == "-h") {
+			PrintUsage();
+			return EXIT_SUCCESS;
+		}
+		else {
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	// Atlas entries store coordinates as 16-bit values
+	if (IsPowerOfTwo(page_size) == false || page_size < 64 || page_size > 32768) {
+		cerr << "page size must be a power of two between 64 and 32768" << endl;
+		return EXIT_FAILURE;
+	}
+
+	ScriptManager = ScriptEngine::SingletonCreate();
+	if (ScriptManager->SingletonInitialize() == false) {
+		cerr << "unable to initialize the script engine" << endl;
+		return EXIT_FAILURE;
+	}
+
+	vector<AtlasImage> images;
+	FindTilesetImages(images);
+	FindSpriteImages(images);
+
+	bool success = true;
+	if (images.empty() == true) {
+		cerr << "no images were found to pack into the atlas" << endl;
+		success = false;
+	}
+	else if (force == false && IsAtlasCurrent(images) == true) {
+		cout << TEXTURE_ATLAS_INDEX_FILENAME << " is up to date" << endl;
+	}
+	else {
+		success = BuildAtlas(images, page_size);
+	}
+
+	ScriptEngine::SingletonDestroy();
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
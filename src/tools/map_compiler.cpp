@@ -0,0 +1,219 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    map_compiler.cpp
+*** \author  agent
+*** \brief   Source file for the allacrost-mapc command-line tool
+***
+*** This tool compiles map data files (lua/data/maps/\*.lua) into the binary
+*** map format that map mode loads in place of the map data file, and map scripts
+*** (lua/scripts/maps/\*.lua) into the preload files that allow a map to be
+*** loaded in the background. It must be run from the directory containing the
+*** game data (the same directory that the game is run from), since filenames
+*** are stored relative to it. When MAP_COMPILER is enabled, the map-data build
+*** target runs it with --all.
+***
+*** Usage: allacrost-mapc [--force] MAP_FILE [OUTPUT_FILE]
+***        allacrost-mapc [--force] --all
+***
+*** A MAP_FILE inside lua/scripts/maps/ is compiled into a preload file, and any
+*** other file is compiled into a binary map file. By default, a file that is
+*** already up to date with its source file is not compiled again. The --force
+*** option compiles every file regardless.
+*** ***************************************************************************/
+
+#ifdef _WIN32
+	#include <direct.h>
+#else
+	#include <dirent.h>
+#endif
+
+#include <algorithm>
+
+#include "utils.h"
+#include "script.h"
+
+#include "map_binary.h"
+
+#if defined(main) && !defined(_WIN32)
+	#undef main
+#endif
+
+using namespace std;
+using namespace hoa_utils;
+using namespace hoa_script;
+using namespace hoa_map::private_map;
+
+//! \brief The directory that contains all map data files
+const string MAP_DATA_DIRECTORY = "lua/data/maps/";
+
+//! \brief The directory that contains all map scripts
+const string MAP_SCRIPT_DIRECTORY = "lua/scripts/maps/";
+
+/** \brief Compiles a single map data file
+*** \param source_filename The map data file to compile
+*** \param binary_filename The binary file to write
+*** \param force If true, the file is compiled even when the existing binary file is up to date
+*** \return False if the file failed to compile
+**/
+bool CompileMap(const string& source_filename, const string& binary_filename, bool force) {
+	if (force == false) {
+		MapBinaryFile existing_file;
+		if (existing_file.Open(binary_filename, source_filename) == true) {
+			cout << binary_filename << " is up to date" << endl;
+			return true;
+		}
+	}
+
+	if (CompileMapBinaryFile(source_filename, binary_filename) == false) {
+		cerr << "failed to compile " << source_filename << endl;
+		return false;
+	}
+
+	cout << "compiled " << source_filename << " -> " << binary_filename << endl;
+	return true;
+}
+
+
+
+/** \brief Compiles the preload file of a single map script
+*** \param script_filename The map script to compile
+*** \param preload_filename The preload file to write
+*** \param force If true, the file is compiled even when the existing preload file is up to date
+*** \return False if the file failed to compile
+**/
+bool CompilePreload(const string& script_filename, const string& preload_filename, bool force) {
+	if (force == false) {
+		MapPreloadFile existing_file;
+		if (existing_file.Open(preload_filename, script_filename) == true) {
+			cout << preload_filename << " is up to date" << endl;
+			return true;
+		}
+	}
+
+	if (CompileMapPreloadFile(script_filename, preload_filename) == false) {
+		cerr << "failed to compile " << script_filename << endl;
+		return false;
+	}
+
+	cout << "compiled " << script_filename << " -> " << preload_filename << endl;
+	return true;
+}
+
+
+
+//! \brief Returns the names of all Lua files in a directory, which must end with a '/'
+vector<string> FindLuaFiles(const string& directory_name) {
+	vector<string> filenames;
+
+#ifdef _WIN32
+	WIN32_FIND_DATAA file_data;
+	HANDLE search = FindFirstFileA((directory_name + "*.lua").c_str(), &file_data);
+	if (search != INVALID_HANDLE_VALUE) {
+		do {
+			filenames.push_back(directory_name + file_data.cFileName);
+		} while (FindNextFileA(search, &file_data) != 0);
+		FindClose(search);
+	}
+#else
+	DIR* directory = opendir(directory_name.c_str());
+	if (directory != nullptr) {
+		struct dirent* entry;
+		while ((entry = readdir(directory)) != nullptr) {
+			string name = entry->d_name;
+			if (name.length() > 4 && name.compare(name.length() - 4, 4, ".lua") == 0)
+				filenames.push_back(directory_name + name);
+		}
+		closedir(directory);
+	}
+#endif
+
+	sort(filenames.begin(), filenames.end());
+	return filenames;
+}
+
+
+
+void PrintUsage() {
+	cout << "usage: allacrost-mapc [--force] MAP_FILE [OUTPUT_FILE]" << endl;
+	cout << "       allacrost-mapc [--force] --all" << endl;
+	cout << endl;
+	cout << "Compiles map data files into binary map files that are loaded in their place, and map scripts in" << endl;
+	cout << MAP_SCRIPT_DIRECTORY << " into preload files that allow maps to be loaded in the background." << endl;
+	cout << "  --all      compile every map data file in " << MAP_DATA_DIRECTORY << " and every map script in " << MAP_SCRIPT_DIRECTORY << endl;
+	cout << "  --force    compile files even if their compiled file is up to date" << endl;
+}
+
+
+
+int main(int argc, char *argv[]) {
+	bool force = false;
+	bool compile_all = false;
+	vector<string> filenames;
+
+	for (int32 i = 1; i < argc; ++i) {
+		string argument = argv[i];
+		if (argument == "--force") {
+			force = true;
+		}
+		else if (argument == "--all") {
+			compile_all = true;
+		}
+		else if (argument == "--help" || argument == "-h") {
+			PrintUsage();
+			return EXIT_SUCCESS;
+		}
+		else {
+			filenames.push_back(argument);
+		}
+	}
+
+	if ((compile_all == true && filenames.empty() == false) || (compile_all == false && (filenames.empty() == true || filenames.size() > 2))) {
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	ScriptManager = ScriptEngine::SingletonCreate();
+	if (ScriptManager->SingletonInitialize() == false) {
+		cerr << "unable to initialize the script engine" << endl;
+		return EXIT_FAILURE;
+	}
+
+	bool success = true;
+	if (compile_all == true) {
+		vector<string> map_files = FindLuaFiles(MAP_DATA_DIRECTORY);
+		if (map_files.empty() == true) {
+			cerr << "no map data files were found in " << MAP_DATA_DIRECTORY << endl;
+			success = false;
+		}
+		for (uint32 i = 0; i < map_files.size(); ++i) {
+			if (CompileMap(map_files[i], MakeMapBinaryFilename(map_files[i]), force) == false)
+				success = false;
+		}
+
+		// Preload files are compiled after the binary map files, as they are only useful for maps that have one
+		vector<string> script_files = FindLuaFiles(MAP_SCRIPT_DIRECTORY);
+		for (uint32 i = 0; i < script_files.size(); ++i) {
+			if (CompilePreload(script_files[i], MakeMapPreloadFilename(script_files[i]), force) == false)
+				success = false;
+		}
+	}
+	else if (filenames[0].compare(0, MAP_SCRIPT_DIRECTORY.length(), MAP_SCRIPT_DIRECTORY) == 0) {
+		string preload_filename = (filenames.size() == 2) ? filenames[1] : MakeMapPreloadFilename(filenames[0]);
+		success = CompilePreload(filenames[0], preload_filename, force);
+	}
+	else {
+		string binary_filename = (filenames.size() == 2) ? filenames[1] : MakeMapBinaryFilename(filenames[0]);
+		success = CompileMap(filenames[0], binary_filename, force);
+	}
+
+	ScriptEngine::SingletonDestroy();
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
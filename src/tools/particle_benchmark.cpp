@@ -0,0 +1,413 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    particle_benchmark.cpp
+*** \author  agent
+*** \brief   Source file for the allacrost-particlebench command-line tool
+***
+*** This tool measures how long it takes to update the particles of a system.
+*** It emits the same particles into two layouts: the array of particle structures
+*** that particle systems used to keep, which is updated one particle at a time
+*** with a linear search for the current keyframe, and the ParticleArrays layout
+*** that is updated by the kernels in particle_kernels.h. Both are then advanced
+*** through the same number of frames and the average update time per particle
+*** of each is reported.
+***
+*** Usage: allacrost-particlebench [--count PARTICLES] [--frames FRAMES]
+***
+*** The particles use every feature that the update handles: several keyframes
+*** with variations, wave motion, wind, radial and tangential acceleration with
+*** an attractor falloff, and varying damping. The largest difference between
+*** the positions computed by the two updates is reported as well. It should
+*** only be a small fraction of a pixel, caused by floating point rounding.
+*** ***************************************************************************/
+
+#include <SDL2/SDL.h>
+
+#include "utils.h"
+
+#include "particle_keyframe.h"
+#include "particle_kernels.h"
+
+#if defined(main) && !defined(_WIN32)
+	#undef main
+#endif
+
+using namespace std;
+using namespace hoa_utils;
+using namespace hoa_video;
+using namespace hoa_video::private_video;
+
+//! \brief The default number of particles to emit
+const uint32 DEFAULT_COUNT = 100000;
+
+//! \brief The default number of frames to update the particles for
+const uint32 DEFAULT_FRAMES = 120;
+
+//! \brief The time that each frame advances the particles by, in seconds
+const float FRAME_TIME = 1.0f / 60.0f;
+
+//! \brief The properties of the system that the particles are emitted from
+const float EMITTER_X = 512.0f;
+const float EMITTER_Y = 384.0f;
+const float ATTRACTOR_FALLOFF = 0.001f;
+
+/** ****************************************************************************
+*** \brief A particle in the layout that particle systems used before they stored ParticleArrays
+*** ***************************************************************************/
+class LegacyParticle {
+public:
+	float x, y;
+	float size_x, size_y;
+	float velocity_x, velocity_y;
+	float combined_velocity_x, combined_velocity_y;
+	Color color;
+	float rotation_angle;
+	float rotation_speed;
+	float time;
+	float lifetime;
+	float wave_length_coefficient;
+	float wave_half_amplitude;
+	float acceleration_x, acceleration_y;
+	float tangential_acceleration;
+	float radial_acceleration;
+	float wind_velocity_x, wind_velocity_y;
+	float damping;
+	float rotation_direction;
+	float current_size_variation_x, current_size_variation_y;
+	float next_size_variation_x, next_size_variation_y;
+	float current_rotation_speed_variation, next_rotation_speed_variation;
+	Color current_color_variation, next_color_variation;
+	ParticleKeyframe* current_keyframe;
+	ParticleKeyframe* next_keyframe;
+};
+
+
+
+//! \brief The same interpolation as the Lerp function of the video engine
+static float _Lerp(float alpha, float initial, float final) {
+	return alpha * final + (1.0f - alpha) * initial;
+}
+
+
+
+/** \brief Updates particles the way that particle systems did before they stored ParticleArrays
+*** This is the loop from ParticleSystem::_UpdateParticles, with the properties of the
+*** system definition replaced by the constant properties of the benchmark system.
+**/
+void LegacyUpdate(vector<LegacyParticle>& particles, const vector<ParticleKeyframe*>& keyframes, float t) {
+	for (uint32 j = 0; j < particles.size(); ++j) {
+		LegacyParticle& p = particles[j];
+		float scaled_time = p.time / p.lifetime;
+
+		if (p.next_keyframe) {
+			ParticleKeyframe* old_next = p.next_keyframe;
+
+			if (scaled_time >= p.next_keyframe->time) {
+				size_t num_keyframes = keyframes.size();
+				size_t k;
+				for (k = 0; k < num_keyframes; ++k) {
+					if (keyframes[k]->time > scaled_time) {
+						p.current_keyframe = keyframes[k - 1];
+						p.next_keyframe = keyframes[k];
+						break;
+					}
+				}
+
+				if (k == num_keyframes) {
+					p.current_keyframe = keyframes[k - 1];
+					p.next_keyframe = nullptr;
+					p.color = p.current_keyframe->color;
+					p.rotation_speed = p.current_keyframe->rotation_speed;
+					p.size_x = p.current_keyframe->size_x;
+					p.size_y = p.current_keyframe->size_y;
+				}
+
+				if (p.current_keyframe == old_next) {
+					p.current_color_variation = p.next_color_variation;
+					p.current_rotation_speed_variation = p.next_rotation_speed_variation;
+					p.current_size_variation_x = p.next_size_variation_x;
+					p.current_size_variation_y = p.next_size_variation_y;
+				}
+				else {
+					p.current_rotation_speed_variation = RandomFloat(-p.current_keyframe->rotation_speed_variation, p.current_keyframe->rotation_speed_variation);
+					for (int32 c = 0; c < 4; ++c)
+						p.current_color_variation[c] = RandomFloat(-p.current_keyframe->color_variation[c], p.current_keyframe->color_variation[c]);
+					p.current_size_variation_x = RandomFloat(-p.current_keyframe->size_variation_x, p.current_keyframe->size_variation_x);
+					p.current_size_variation_y = RandomFloat(-p.current_keyframe->size_variation_y, p.current_keyframe->size_variation_y);
+				}
+
+				if (p.next_keyframe) {
+					p.next_rotation_speed_variation = RandomFloat(-p.next_keyframe->rotation_speed_variation, p.next_keyframe->rotation_speed_variation);
+					for (int32 c = 0; c < 4; ++c)
+						p.next_color_variation[c] = RandomFloat(-p.next_keyframe->color_variation[c], p.next_keyframe->color_variation[c]);
+					p.next_size_variation_x = RandomFloat(-p.next_keyframe->size_variation_x, p.next_keyframe->size_variation_x);
+					p.next_size_variation_y = RandomFloat(-p.next_keyframe->size_variation_y, p.next_keyframe->size_variation_y);
+				}
+			}
+		}
+
+		if (p.next_keyframe) {
+			float a = (scaled_time - p.current_keyframe->time) / (p.next_keyframe->time - p.current_keyframe->time);
+			p.rotation_speed = _Lerp(a, p.current_keyframe->rotation_speed + p.current_rotation_speed_variation, p.next_keyframe->rotation_speed + p.next_rotation_speed_variation);
+			p.size_x = _Lerp(a, p.current_keyframe->size_x + p.current_size_variation_x, p.next_keyframe->size_x + p.next_size_variation_x);
+			p.size_y = _Lerp(a, p.current_keyframe->size_y + p.current_size_variation_y, p.next_keyframe->size_y + p.next_size_variation_y);
+			for (int32 c = 0; c < 4; ++c)
+				p.color[c] = _Lerp(a, p.current_keyframe->color[c] + p.current_color_variation[c], p.next_keyframe->color[c] + p.next_color_variation[c]);
+		}
+
+		p.rotation_angle += p.rotation_speed * p.rotation_direction * t;
+		p.combined_velocity_x = p.velocity_x + p.wind_velocity_x;
+		p.combined_velocity_y = p.velocity_y + p.wind_velocity_y;
+
+		if (p.wave_half_amplitude > 0.0f) {
+			float wave_speed = p.wave_half_amplitude * sinf(p.wave_length_coefficient * p.time);
+			float tangent_x = -p.combined_velocity_y;
+			float tangent_y = p.combined_velocity_x;
+			float speed = sqrtf(tangent_x * tangent_x + tangent_y * tangent_y);
+			tangent_x /= speed;
+			tangent_y /= speed;
+			p.combined_velocity_x += tangent_x * wave_speed;
+			p.combined_velocity_y += tangent_y * wave_speed;
+		}
+
+		p.x += p.combined_velocity_x * t;
+		p.y += p.combined_velocity_y * t;
+		p.velocity_x += p.acceleration_x * t;
+		p.velocity_y += p.acceleration_y * t;
+
+		bool use_radial = (p.radial_acceleration != 0.0f);
+		bool use_tangential = (p.tangential_acceleration != 0.0f);
+		if (use_radial || use_tangential) {
+			float attractor_to_particle_x = p.x - EMITTER_X;
+			float attractor_to_particle_y = p.y - EMITTER_Y;
+			float distance = sqrtf(attractor_to_particle_x * attractor_to_particle_x + attractor_to_particle_y * attractor_to_particle_y);
+			if (distance != 0.0f) {
+				attractor_to_particle_x /= distance;
+				attractor_to_particle_y /= distance;
+			}
+
+			if (use_radial) {
+				float attraction = 1.0f - ATTRACTOR_FALLOFF * distance;
+				if (attraction > 0.0f) {
+					p.velocity_x += attractor_to_particle_x * p.radial_acceleration * t * attraction;
+					p.velocity_y += attractor_to_particle_y * p.radial_acceleration * t * attraction;
+				}
+			}
+
+			if (use_tangential) {
+				p.velocity_x += -attractor_to_particle_y * p.tangential_acceleration * t;
+				p.velocity_y += attractor_to_particle_x * p.tangential_acceleration * t;
+			}
+		}
+
+		if (p.damping != 1.0f) {
+			p.velocity_x *= pow(p.damping, t);
+			p.velocity_y *= pow(p.damping, t);
+		}
+
+		p.time += t;
+	}
+} // void LegacyUpdate(...)
+
+
+
+/** \brief Emits the same particles into both layouts
+*** \param count The number of particles to emit
+*** \param keyframes The keyframes of the benchmark system
+*** \param keyframe_times The time of each keyframe
+*** \param legacy Set to the particles in the legacy layout
+*** \param arrays Set to the particles in the ParticleArrays layout
+*** \param random The random number generator used for the keyframe variations of the ParticleArrays layout
+**/
+void EmitParticles(uint32 count, const vector<ParticleKeyframe*>& keyframes, const vector<float>& keyframe_times,
+	vector<LegacyParticle>& legacy, ParticleArrays& arrays, ParticleRandom& random)
+{
+	legacy.resize(count);
+	arrays.Resize(count);
+
+	for (uint32 i = 0; i < count; ++i) {
+		float angle = RandomFloat(0.0f, UTILS_2PI);
+		float speed = RandomFloat(50.0f, 150.0f);
+
+		LegacyParticle& p = legacy[i];
+		p.x = EMITTER_X + RandomFloat(-8.0f, 8.0f);
+		p.y = EMITTER_Y + RandomFloat(-8.0f, 8.0f);
+		p.velocity_x = speed * cosf(angle);
+		p.velocity_y = speed * sinf(angle);
+		p.combined_velocity_x = p.velocity_x;
+		p.combined_velocity_y = p.velocity_y;
+		p.rotation_angle = 0.0f;
+		p.rotation_direction = (i % 2 == 0) ? 1.0f : -1.0f;
+		p.time = 0.0f;
+		p.lifetime = RandomFloat(1.0f, 3.0f);
+		p.wave_length_coefficient = UTILS_2PI / RandomFloat(0.5f, 1.0f);
+		p.wave_half_amplitude = RandomFloat(5.0f, 15.0f);
+		p.acceleration_x = 0.0f;
+		p.acceleration_y = RandomFloat(20.0f, 40.0f);
+		p.tangential_acceleration = RandomFloat(10.0f, 30.0f);
+		p.radial_acceleration = RandomFloat(-30.0f, -10.0f);
+		p.wind_velocity_x = RandomFloat(5.0f, 15.0f);
+		p.wind_velocity_y = 0.0f;
+		p.damping = RandomFloat(0.7f, 0.9f);
+
+		p.current_keyframe = keyframes[0];
+		p.next_keyframe = keyframes[1];
+		p.color = keyframes[0]->color;
+		p.size_x = keyframes[0]->size_x;
+		p.size_y = keyframes[0]->size_y;
+		p.rotation_speed = keyframes[0]->rotation_speed;
+		p.current_size_variation_x = RandomFloat(-keyframes[0]->size_variation_x, keyframes[0]->size_variation_x);
+		p.current_size_variation_y = RandomFloat(-keyframes[0]->size_variation_y, keyframes[0]->size_variation_y);
+		p.current_rotation_speed_variation = RandomFloat(-keyframes[0]->rotation_speed_variation, keyframes[0]->rotation_speed_variation);
+		p.next_size_variation_x = RandomFloat(-keyframes[1]->size_variation_x, keyframes[1]->size_variation_x);
+		p.next_size_variation_y = RandomFloat(-keyframes[1]->size_variation_y, keyframes[1]->size_variation_y);
+		p.next_rotation_speed_variation = RandomFloat(-keyframes[1]->rotation_speed_variation, keyframes[1]->rotation_speed_variation);
+		for (uint32 c = 0; c < 4; ++c) {
+			p.current_color_variation[c] = RandomFloat(-keyframes[0]->color_variation[c], keyframes[0]->color_variation[c]);
+			p.next_color_variation[c] = RandomFloat(-keyframes[1]->color_variation[c], keyframes[1]->color_variation[c]);
+		}
+
+		arrays.x[i] = p.x;
+		arrays.y[i] = p.y;
+		arrays.velocity_x[i] = p.velocity_x;
+		arrays.velocity_y[i] = p.velocity_y;
+		arrays.combined_velocity_x[i] = p.combined_velocity_x;
+		arrays.combined_velocity_y[i] = p.combined_velocity_y;
+		arrays.rotation_angle[i] = p.rotation_angle;
+		arrays.rotation_direction[i] = p.rotation_direction;
+		arrays.time[i] = p.time;
+		arrays.lifetime[i] = p.lifetime;
+		arrays.inverse_lifetime[i] = 1.0f / p.lifetime;
+		arrays.wave_length_coefficient[i] = p.wave_length_coefficient;
+		arrays.wave_half_amplitude[i] = p.wave_half_amplitude;
+		arrays.acceleration_x[i] = p.acceleration_x;
+		arrays.acceleration_y[i] = p.acceleration_y;
+		arrays.tangential_acceleration[i] = p.tangential_acceleration;
+		arrays.radial_acceleration[i] = p.radial_acceleration;
+		arrays.wind_velocity_x[i] = p.wind_velocity_x;
+		arrays.wind_velocity_y[i] = p.wind_velocity_y;
+		arrays.damping[i] = p.damping;
+		SetParticleKeyframe(arrays, i, 0, keyframes, keyframe_times, true, random);
+	}
+} // void EmitParticles(...)
+
+
+
+void PrintUsage() {
+	cout << "usage: allacrost-particlebench [--count PARTICLES] [--frames FRAMES]" << endl;
+	cout << endl;
+	cout << "Measures the time taken to update particles in the previous and the current particle layouts" << endl;
+	cout << "  --count PARTICLES       the number of particles to emit (default: " << DEFAULT_COUNT << ")" << endl;
+	cout << "  --frames FRAMES         the number of frames to update the particles for (default: " << DEFAULT_FRAMES << ")" << endl;
+}
+
+
+
+int main(int argc, char *argv[]) {
+	uint32 count = DEFAULT_COUNT;
+	uint32 frames = DEFAULT_FRAMES;
+
+	for (int32 i = 1; i < argc; ++i) {
+		string argument = argv[i];
+		if (argument == "--count" && i + 1 < argc) {
+			count = atoi(argv[++i]);
+			if (count == 0) {
+				PrintUsage();
+				return EXIT_FAILURE;
+			}
+		}
+		else if (argument == "--frames" && i + 1 < argc) {
+			frames = atoi(argv[++i]);
+			if (frames == 0) {
+				PrintUsage();
+				return EXIT_FAILURE;
+			}
+		}
+		else if (argument == "--help" || argument == "-h") {
+			PrintUsage();
+			return EXIT_SUCCESS;
+		}
+		else {
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	// Particles grow and fade in, change color halfway through their life and then fade out
+	ParticleKeyframe keyframe_data[3];
+	keyframe_data[0].time = 0.0f;
+	keyframe_data[0].size_x = keyframe_data[0].size_y = 0.5f;
+	keyframe_data[0].color = Color(1.0f, 0.8f, 0.2f, 0.0f);
+	keyframe_data[1].time = 0.5f;
+	keyframe_data[1].size_x = keyframe_data[1].size_y = 1.0f;
+	keyframe_data[1].color = Color(1.0f, 0.4f, 0.1f, 1.0f);
+	keyframe_data[1].rotation_speed = 2.0f;
+	keyframe_data[2].time = 1.0f;
+	keyframe_data[2].size_x = keyframe_data[2].size_y = 1.5f;
+	keyframe_data[2].color = Color(0.5f, 0.1f, 0.1f, 0.0f);
+	for (uint32 i = 0; i < 3; ++i) {
+		keyframe_data[i].size_variation_x = keyframe_data[i].size_variation_y = 0.1f;
+		keyframe_data[i].rotation_speed_variation = 0.5f;
+		keyframe_data[i].color_variation = Color(0.1f, 0.1f, 0.1f, 0.0f);
+	}
+
+	vector<ParticleKeyframe*> keyframes;
+	vector<float> keyframe_times;
+	for (uint32 i = 0; i < 3; ++i) {
+		keyframes.push_back(&keyframe_data[i]);
+		keyframe_times.push_back(keyframe_data[i].time);
+	}
+
+	vector<LegacyParticle> legacy;
+	ParticleArrays arrays;
+	ParticleRandom random;
+	EmitParticles(count, keyframes, keyframe_times, legacy, arrays, random);
+
+	ParticleStep step;
+	step.time = FRAME_TIME;
+	step.wave_motion = true;
+	step.attractor_forces = true;
+	step.attractor_x = EMITTER_X;
+	step.attractor_y = EMITTER_Y;
+	step.attractor_falloff = ATTRACTOR_FALLOFF;
+	step.uniform_damping = false;
+
+	Uint64 legacy_time = 0;
+	Uint64 arrays_time = 0;
+	for (uint32 i = 0; i < frames; ++i) {
+		Uint64 start = SDL_GetPerformanceCounter();
+		LegacyUpdate(legacy, keyframes, FRAME_TIME);
+		Uint64 middle = SDL_GetPerformanceCounter();
+		UpdateParticles(arrays, count, keyframes, keyframe_times, step, random);
+		Uint64 end = SDL_GetPerformanceCounter();
+
+		legacy_time += middle - start;
+		arrays_time += end - middle;
+	}
+
+	float largest_difference = 0.0f;
+	for (uint32 i = 0; i < count; ++i) {
+		largest_difference = max(largest_difference, fabsf(legacy[i].x - arrays.x[i]));
+		largest_difference = max(largest_difference, fabsf(legacy[i].y - arrays.y[i]));
+	}
+
+	double nanoseconds = 1000000000.0 / static_cast<double>(SDL_GetPerformanceFrequency()) / (static_cast<double>(count) * frames);
+	double legacy_nanoseconds = static_cast<double>(legacy_time) * nanoseconds;
+	double arrays_nanoseconds = static_cast<double>(arrays_time) * nanoseconds;
+
+	cout << "updated " << count << " particles for " << frames << " frames" << endl;
+	printf("%-36s%10.2f ns/particle\n", "before (array of particles)", legacy_nanoseconds);
+	printf("%-36s%10.2f ns/particle\n", (string("after (particle arrays, ") + GetParticleKernelName() + ")").c_str(), arrays_nanoseconds);
+	printf("%-36s%10.2fx\n", "speedup", legacy_nanoseconds / arrays_nanoseconds);
+	printf("%-36s%10.6f pixels\n", "largest position difference", largest_difference);
+
+	return EXIT_SUCCESS;
+} // int main(int argc, char *argv[])
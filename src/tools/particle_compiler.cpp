@@ -0,0 +1,153 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    particle_compiler.cpp
+*** \author  agent
+*** \brief   Source file for the allacrost-particlec command-line tool
+***
+*** This tool compiles particle definition files (lua/graphics/particles/\*.lua)
+*** into the binary particle format that the particle manager loads in place of
+*** the definition file. It must be run from the directory containing the game
+*** data (the same directory that the game is run from), since animation frame
+*** filenames are stored relative to it and are checked for existence.
+***
+*** Usage: allacrost-particlec [--force] PARTICLE_FILE [OUTPUT_FILE]
+***        allacrost-particlec [--force] --all
+***
+*** By default, a binary file that is already up to date with its definition
+*** file is not compiled again. The --force option compiles every file regardless.
+*** ***************************************************************************/
+
+#include <algorithm>
+
+#include "utils.h"
+#include "script.h"
+
+#include "particle_binary.h"
+
+#if defined(main) && !defined(_WIN32)
+	#undef main
+#endif
+
+using namespace std;
+using namespace hoa_utils;
+using namespace hoa_script;
+using namespace hoa_video::private_video;
+
+//! \brief The directory that contains all particle definition files
+const string PARTICLE_DIRECTORY = "lua/graphics/particles/";
+
+/** \brief Compiles a single particle definition file
+*** \param source_filename The particle definition file to compile
+*** \param binary_filename The binary file to write
+*** \param force If true, the file is compiled even when the existing binary file is up to date
+*** \return False if the file failed to compile
+**/
+bool CompileParticleFile(const string& source_filename, const string& binary_filename, bool force) {
+	ParticleBinaryData data;
+
+	if (force == false && DoesFileExist(binary_filename) == true && data.ReadBinary(binary_filename, source_filename) == true) {
+		cout << binary_filename << " is up to date" << endl;
+		return true;
+	}
+
+	if (data.ReadScript(source_filename) == false || data.WriteBinary(binary_filename) == false) {
+		cerr << "failed to compile " << source_filename << endl;
+		return false;
+	}
+
+	cout << "compiled " << source_filename << " -> " << binary_filename << " (" << data.systems.size() << " systems, "
+		<< data.filenames.size() << " frame images)" << endl;
+	return true;
+}
+
+
+
+//! \brief Returns the names of all particle definition files in the particle directory
+vector<string> FindParticleFiles() {
+	vector<string> filenames;
+	vector<string> directory_list = ListDirectory(PARTICLE_DIRECTORY, ".lua");
+
+	for (uint32 i = 0; i < directory_list.size(); ++i) {
+		const string& name = directory_list[i];
+		if (name.length() > 4 && name.compare(name.length() - 4, 4, ".lua") == 0)
+			filenames.push_back(PARTICLE_DIRECTORY + name);
+	}
+
+	sort(filenames.begin(), filenames.end());
+	return filenames;
+}
+
+
+
+void PrintUsage() {
+	cout << "usage: allacrost-particlec [--force] PARTICLE_FILE [OUTPUT_FILE]" << endl;
+	cout << "       allacrost-particlec [--force] --all" << endl;
+	cout << endl;
+	cout << "Compiles particle definition files into binary particle files that are loaded in their place." << endl;
+	cout << "  --all      compile every particle definition file in " << PARTICLE_DIRECTORY << endl;
+	cout << "  --force    compile files even if their binary file is up to date" << endl;
+}
+
+
+
+int main(int argc, char *argv[]) {
+	bool force = false;
+	bool compile_all = false;
+	vector<string> filenames;
+
+	for (int32 i = 1; i < argc; ++i) {
+		string argument = argv[i];
+		if (argument == "--force") {
+			force = true;
+		}
+		else if (argument == "--all") {
+			compile_all = true;
+		}
+		else if (argument == "--help" || argument == "-h") {
+			PrintUsage();
+			return EXIT_SUCCESS;
+		}
+		else {
+			filenames.push_back(argument);
+		}
+	}
+
+	if ((compile_all == true && filenames.empty() == false) || (compile_all == false && (filenames.empty() == true || filenames.size() > 2))) {
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	ScriptManager = ScriptEngine::SingletonCreate();
+	if (ScriptManager->SingletonInitialize() == false) {
+		cerr << "unable to initialize the script engine" << endl;
+		return EXIT_FAILURE;
+	}
+
+	bool success = true;
+	if (compile_all == true) {
+		vector<string> particle_files = FindParticleFiles();
+		if (particle_files.empty() == true) {
+			cerr << "no particle definition files were found in " << PARTICLE_DIRECTORY << endl;
+			success = false;
+		}
+		for (uint32 i = 0; i < particle_files.size(); ++i) {
+			if (CompileParticleFile(particle_files[i], MakeParticleBinaryFilename(particle_files[i]), force) == false)
+				success = false;
+		}
+	}
+	else {
+		string binary_filename = (filenames.size() == 2) ? filenames[1] : MakeParticleBinaryFilename(filenames[0]);
+		success = CompileParticleFile(filenames[0], binary_filename, force);
+	}
+
+	ScriptEngine::SingletonDestroy();
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,307 @@
+///////////////////////////////////////////////////////////////////////////////
+//            Copyright (C) 2004-2018 by The Allacrost Project
+//                         All Rights Reserved
+//
+// This code is licensed under the GNU GPL version 2. It is free software
+// and you may modify it and/or redistribute it under the terms of this license.
+// See http://www.gnu.org/copyleft/gpl.html for details.
+///////////////////////////////////////////////////////////////////////////////
+
+/** ****************************************************************************
+*** \file    pixel_benchmark.cpp
+*** \author  agent
+*** \brief   Source file for the allacrost-pixelbench command-line tool
+***
+*** This tool verifies that every vectorized pixel kernel that the processor
+*** supports produces exactly the same output as the scalar kernel, and then
+*** measures the speed of each kernel at every supported instruction set.
+***
+*** Usage: allacrost-pixelbench [--verify-only] [--size WIDTHxHEIGHT] [--iterations COUNT]
+***
+*** The kernels are verified with random pixel data over a range of pixel counts,
+*** so that the scalar code which handles the pixels remaining after the last
+*** full vector is also exercised. The RGBA grayscale kernel is additionally
+*** verified with every possible RGB color. The tool exits with a failure status
+*** if any output differs.
+*** ***************************************************************************/
+
+#include <SDL2/SDL.h>
+
+#include "utils.h"
+
+#include "pixel_kernels.h"
+
+#if defined(main) && !defined(_WIN32)
+	#undef main
+#endif
+
+using namespace std;
+using namespace hoa_utils;
+using namespace hoa_video::private_video;
+
+//! \brief The default dimensions of the image that the kernels are timed with, in pixels
+const uint32 DEFAULT_WIDTH = 1024;
+const uint32 DEFAULT_HEIGHT = 1024;
+
+//! \brief The default number of times that each kernel is run when it is timed
+const uint32 DEFAULT_ITERATIONS = 100;
+
+//! \brief Every pixel count from one up to this value is verified
+const uint32 MAX_VERIFY_PIXELS = 160;
+
+//! \brief Identifies each of the kernels in a PixelKernels object
+enum KernelType {
+	RGB_TO_RGBA,
+	RGBA_TO_RGB,
+	GREY_TO_RGBA,
+	CLEAR_TRANSPARENT_RGBA,
+	GRAYSCALE_RGBA,
+	GRAYSCALE_RGB,
+	FLIP_VERTICAL,
+	KERNEL_TOTAL
+};
+
+//! \brief The name of each kernel, in the order of KernelType
+const char* KERNEL_NAMES[KERNEL_TOTAL] = {
+	"rgb_to_rgba",
+	"rgba_to_rgb",
+	"grey_to_rgba",
+	"clear_transparent_rgba",
+	"grayscale_rgba",
+	"grayscale_rgb",
+	"flip_vertical"
+};
+
+//! \brief The number of bytes per pixel that each kernel reads, in the order of KernelType
+const uint32 KERNEL_SOURCE_BYTES[KERNEL_TOTAL] = { 3, 4, 1, 4, 4, 3, 4 };
+
+//! \brief The number of bytes per pixel that each kernel writes, in the order of KernelType
+const uint32 KERNEL_DESTINATION_BYTES[KERNEL_TOTAL] = { 4, 3, 4, 4, 4, 3, 4 };
+
+/** \brief Fills a buffer with pseudo-random bytes
+*** About a quarter of all bytes are set to zero, so that the kernels which treat fully
+*** transparent pixels differently see many of them.
+**/
+void FillRandom(vector<uint8>& data, uint32& seed) {
+	for (uint32 i = 0; i < data.size(); ++i) {
+		// xorshift32
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+		data[i] = ((seed >> 24) < 64) ? 0 : static_cast<uint8>(seed);
+	}
+}
+
+
+
+/** \brief Runs a single kernel over a number of pixels
+*** \param kernels The set of kernels to run the kernel from
+*** \param type The kernel to run
+*** \param source The source pixels. Kernels that operate in place modify this buffer.
+*** \param destination The destination pixels, which must be large enough for the kernel output
+*** \param width The number of pixels in each row. Only the flip kernel treats the pixels as more than one row.
+*** \param height The number of rows
+**/
+void RunKernel(const PixelKernels& kernels, KernelType type, vector<uint8>& source, vector<uint8>& destination, uint32 width, uint32 height) {
+	uint32 pixel_count = width * height;
+
+	switch (type) {
+		case RGB_TO_RGBA:
+			kernels.rgb_to_rgba(&source[0], &destination[0], pixel_count);
+			break;
+		case RGBA_TO_RGB:
+			// The game converts images to RGB in place, so that is what is verified and timed here
+			kernels.rgba_to_rgb(&source[0], &source[0], pixel_count);
+			break;
+		case GREY_TO_RGBA:
+			kernels.grey_to_rgba(&source[0], &destination[0], pixel_count);
+			break;
+		case CLEAR_TRANSPARENT_RGBA:
+			kernels.clear_transparent_rgba(&source[0], &destination[0], pixel_count);
+			break;
+		case GRAYSCALE_RGBA:
+			kernels.grayscale_rgba(&source[0], pixel_count);
+			break;
+		case GRAYSCALE_RGB:
+			kernels.grayscale_rgb(&source[0], pixel_count);
+			break;
+		case FLIP_VERTICAL:
+			kernels.flip_vertical(&source[0], width * 4, height);
+			break;
+		default:
+			break;
+	}
+}
+
+
+
+/** \brief Verifies that every kernel in a set produces the same output as the scalar kernel
+*** \param kernels The kernels to verify
+*** \return False if the output of any kernel differed
+**/
+bool VerifyKernels(const PixelKernels& kernels) {
+	PixelKernels scalar;
+	bool success = true;
+
+	for (uint32 type = 0; type < KERNEL_TOTAL; ++type) {
+		uint32 seed = 0x12345678;
+		uint32 failures = 0;
+
+		for (uint32 pixel_count = 1; pixel_count <= MAX_VERIFY_PIXELS; ++pixel_count) {
+			// Flip rows of a varying width, for a varying number of rows
+			uint32 width = pixel_count;
+			uint32 height = (type == FLIP_VERTICAL) ? (pixel_count % 7) + 1 : 1;
+			uint32 size = width * height;
+
+			vector<uint8> source(size * KERNEL_SOURCE_BYTES[type]);
+			FillRandom(source, seed);
+			// One extra byte after the output detects kernels that write past the end of their destination
+			vector<uint8> destination(size * KERNEL_DESTINATION_BYTES[type] + 1, 0xA5);
+
+			vector<uint8> expected_source = source;
+			vector<uint8> expected_destination = destination;
+			RunKernel(scalar, static_cast<KernelType>(type), expected_source, expected_destination, width, height);
+			RunKernel(kernels, static_cast<KernelType>(type), source, destination, width, height);
+
+			if (source != expected_source || destination != expected_destination)
+				failures++;
+		}
+
+		if (failures > 0) {
+			cerr << "  " << KERNEL_NAMES[type] << ": output differed from the scalar kernel for " << failures << " pixel counts" << endl;
+			success = false;
+		}
+	}
+
+	// Convert every possible RGB color to grayscale
+	vector<uint8> every_color(256 * 256 * 256 * 4);
+	for (uint32 i = 0; i < 256 * 256 * 256; ++i) {
+		every_color[i * 4] = static_cast<uint8>(i >> 16);
+		every_color[i * 4 + 1] = static_cast<uint8>(i >> 8);
+		every_color[i * 4 + 2] = static_cast<uint8>(i);
+		every_color[i * 4 + 3] = static_cast<uint8>(i * 7);
+	}
+	vector<uint8> expected = every_color;
+	scalar.grayscale_rgba(&expected[0], 256 * 256 * 256);
+	kernels.grayscale_rgba(&every_color[0], 256 * 256 * 256);
+	if (every_color != expected) {
+		cerr << "  " << KERNEL_NAMES[GRAYSCALE_RGBA] << ": output differed from the scalar kernel for at least one color" << endl;
+		success = false;
+	}
+
+	return success;
+} // bool VerifyKernels(const PixelKernels& kernels)
+
+
+
+/** \brief Measures how long a kernel takes to process an image
+*** \return The average time that each run of the kernel took, in milliseconds
+**/
+double TimeKernel(const PixelKernels& kernels, KernelType type, uint32 width, uint32 height, uint32 iterations) {
+	uint32 seed = 0x9E3779B9;
+	vector<uint8> source(width * height * KERNEL_SOURCE_BYTES[type]);
+	vector<uint8> destination(width * height * KERNEL_DESTINATION_BYTES[type]);
+	FillRandom(source, seed);
+	vector<uint8> original = source;
+
+	double total_time = 0.0;
+	for (uint32 i = 0; i < iterations; ++i) {
+		// Kernels that work in place need fresh pixels for every run, so restoring them is not timed
+		memcpy(&source[0], &original[0], source.size());
+
+		Uint64 start = SDL_GetPerformanceCounter();
+		RunKernel(kernels, type, source, destination, width, height);
+		total_time += static_cast<double>(SDL_GetPerformanceCounter() - start);
+	}
+
+	return total_time * 1000.0 / static_cast<double>(SDL_GetPerformanceFrequency()) / iterations;
+}
+
+
+
+void PrintUsage() {
+	cout << "usage: allacrost-pixelbench [--verify-only] [--size WIDTHxHEIGHT] [--iterations COUNT]" << endl;
+	cout << endl;
+	cout << "Verifies the vectorized pixel kernels against the scalar kernels and measures their speed" << endl;
+	cout << "  --verify-only           do not measure the speed of the kernels" << endl;
+	cout << "  --size WIDTHxHEIGHT     the dimensions of the image to time the kernels with (default: " << DEFAULT_WIDTH << "x" << DEFAULT_HEIGHT << ")" << endl;
+	cout << "  --iterations COUNT      the number of times to run each kernel (default: " << DEFAULT_ITERATIONS << ")" << endl;
+}
+
+
+
+int main(int argc, char *argv[]) {
+	bool verify_only = false;
+	uint32 width = DEFAULT_WIDTH;
+	uint32 height = DEFAULT_HEIGHT;
+	uint32 iterations = DEFAULT_ITERATIONS;
+
+	for (int32 i = 1; i < argc; ++i) {
+		string argument = argv[i];
+		if (argument == "--verify-only") {
+			verify_only = true;
+		}
+		else if (argument == "--size" && i + 1 < argc) {
+			if (sscanf(argv[++i], "%ux%u", &width, &height) != 2 || width == 0 || height == 0) {
+				PrintUsage();
+				return EXIT_FAILURE;
+			}
+		}
+		else if (argument == "--iterations" && i + 1 < argc) {
+			iterations = atoi(argv[++i]);
+			if (iterations == 0) {
+				PrintUsage();
+				return EXIT_FAILURE;
+			}
+		}
+		else if (argument == "--help" || argument == "-h") {
+			PrintUsage();
+			return EXIT_SUCCESS;
+		}
+		else {
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	vector<PixelKernels> supported;
+	for (uint32 level = 0; level < PIXEL_KERNEL_TOTAL; ++level) {
+		PixelKernels kernels;
+		if (GetPixelKernels(static_cast<PixelKernelLevel>(level), kernels) == true)
+			supported.push_back(kernels);
+		else
+			cout << GetPixelKernelLevelName(static_cast<PixelKernelLevel>(level)) << " kernels are not supported by this processor" << endl;
+	}
+	cout << "the game will use the " << GetPixelKernelLevelName(GetPixelKernels().level) << " kernels" << endl;
+
+	bool success = true;
+	for (uint32 i = 1; i < supported.size(); ++i) {
+		cout << "verifying " << GetPixelKernelLevelName(supported[i].level) << " kernels" << endl;
+		if (VerifyKernels(supported[i]) == false)
+			success = false;
+	}
+
+	if (verify_only == false) {
+		cout << endl << "average time in milliseconds to process a " << width << "x" << height << " image over " << iterations << " runs" << endl;
+		printf("%-24s", "kernel");
+		for (uint32 i = 0; i < supported.size(); ++i) {
+			printf("%12s", GetPixelKernelLevelName(supported[i].level));
+		}
+		printf("\n");
+
+		for (uint32 type = 0; type < KERNEL_TOTAL; ++type) {
+			printf("%-24s", KERNEL_NAMES[type]);
+			for (uint32 i = 0; i < supported.size(); ++i) {
+				printf("%12.3f", TimeKernel(supported[i], static_cast<KernelType>(type), width, height, iterations));
+			}
+			printf("\n");
+		}
+	}
+
+	if (success == false) {
+		cerr << "one or more kernels did not match the scalar kernels" << endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+} // int main(int argc, char *argv[])
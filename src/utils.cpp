@@ -574,6 +574,45 @@ bool DoesFileExist(const std::string& file_name) {
 
 
 
+bool GetFileStatus(const std::string& file_name, uint64_t& size, uint64_t& modify_time) {
+	struct stat buf;
+	if (stat(file_name.c_str(), &buf) != 0)
+		return false;
+
+	size = static_cast<uint64_t>(buf.st_size);
+	modify_time = static_cast<uint64_t>(buf.st_mtime);
+	return true;
+}
+
+
+
+bool ComputeFileChecksum(const std::string& file_name, uint32& checksum, uint32& size) {
+	ifstream file(file_name.c_str(), ios::in | ios::binary);
+	if (file.fail()) {
+		return false;
+	}
+
+	const uint32 FNV_OFFSET_BASIS = 2166136261u;
+	const uint32 FNV_PRIME = 16777619u;
+
+	checksum = FNV_OFFSET_BASIS;
+	size = 0;
+	char buffer[8192];
+	while (file.good()) {
+		file.read(buffer, sizeof(buffer));
+		streamsize count = file.gcount();
+		for (streamsize i = 0; i < count; ++i) {
+			checksum ^= static_cast<uint8>(buffer[i]);
+			checksum *= FNV_PRIME;
+		}
+		size += static_cast<uint32>(count);
+	}
+
+	return true;
+}
+
+
+
 bool MoveFile(const std::string& source_name, const std::string& destination_name) {
 	if (DoesFileExist(destination_name))
 		remove(destination_name.c_str());
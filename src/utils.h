@@ -604,6 +604,27 @@ void InsertionSort(std::vector<T>& swap_vec) {
 **/
 bool DoesFileExist(const std::string& file_name);
 
+/** \brief Retrieves the size and last modification time of a file
+*** \param file_name The name of the file to examine
+*** \param size A reference to store the size of the file in, in bytes
+*** \param modify_time A reference to store the time that the file was last modified in, in seconds since the epoch
+*** \return False if the file does not exist or could not be examined
+***
+*** This is much cheaper than reading the file and is useful for determining whether data derived from a file is stale.
+**/
+bool GetFileStatus(const std::string& file_name, uint64_t& size, uint64_t& modify_time);
+
+/** \brief Computes the checksum of the contents of a file
+*** \param file_name The name of the file
+*** \param checksum A reference to store the checksum in
+*** \param size A reference to store the size of the file in, in bytes
+*** \return False if the file could not be read
+***
+*** The checksum is a 32-bit FNV-1a hash of the file contents. It is used to determine whether a compiled
+*** binary file is up to date with the source file that it was compiled from.
+**/
+bool ComputeFileChecksum(const std::string& file_name, uint32& checksum, uint32& size);
+
 /** \brief Moves a file from one location to another
 *** \param source_name The name of the file that is to be moved
 *** \param destination_name The location name to where the file should be moved to